@@ -0,0 +1,299 @@
+/*
+  batchanalysis.cpp
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "batchanalysis.h"
+
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cstring>
+
+#include "models/arrowexport.h"
+#include "models/profileexport.h"
+#include "parsers/perf/perfparser.h"
+#include "util.h"
+
+namespace {
+QVector<const Data::BottomUp*> topSymbols(const Data::BottomUpResults& results, int count)
+{
+    QVector<const Data::BottomUp*> symbols;
+    symbols.reserve(results.root.children.size());
+    for (const auto& leaf : results.root.children) {
+        symbols.push_back(&leaf);
+    }
+    if (!results.costs.numTypes()) {
+        return {};
+    }
+    // the direct children of the bottom-up root carry the self cost of every symbol
+    const auto byCost = [&results](const Data::BottomUp* lhs, const Data::BottomUp* rhs) {
+        return results.costs.cost(0, lhs->id) > results.costs.cost(0, rhs->id);
+    };
+    if (count < symbols.size()) {
+        std::partial_sort(symbols.begin(), symbols.begin() + count, symbols.end(), byCost);
+        symbols.resize(count);
+    } else {
+        std::sort(symbols.begin(), symbols.end(), byCost);
+    }
+    return symbols;
+}
+
+QJsonObject toJson(const Data::Costs& costs, quint32 id)
+{
+    QJsonObject ret;
+    for (int type = 0, c = costs.numTypes(); type < c; ++type) {
+        ret.insert(costs.typeName(type), static_cast<double>(costs.cost(type, id)));
+    }
+    return ret;
+}
+
+QByteArray toJson(const Data::Summary& summary, const Data::BottomUpResults& results, int numTopSymbols)
+{
+    const auto& costs = results.costs;
+
+    QJsonObject totals;
+    for (int type = 0, c = costs.numTypes(); type < c; ++type) {
+        totals.insert(costs.typeName(type), static_cast<double>(costs.totalCost(type)));
+    }
+
+    QJsonArray symbols;
+    for (const auto* symbol : topSymbols(results, numTopSymbols)) {
+        symbols.append(QJsonObject {{QStringLiteral("symbol"), Util::formatSymbol(symbol->symbol)},
+                                    {QStringLiteral("binary"), symbol->symbol.binary},
+                                    {QStringLiteral("selfCosts"), toJson(costs, symbol->id)}});
+    }
+
+    QJsonArray stacks;
+    ProfileExport::forEachCollapsedStack(results, [&](const QString& stack, const QVector<qint64>& stackCosts) {
+        QJsonObject costsObject;
+        for (int type = 0, c = stackCosts.size(); type < c; ++type) {
+            costsObject.insert(costs.typeName(type), static_cast<double>(stackCosts[type]));
+        }
+        stacks.append(QJsonObject {{QStringLiteral("stack"), stack}, {QStringLiteral("costs"), costsObject}});
+    });
+
+    const QJsonObject root = {
+        {QStringLiteral("summary"),
+         QJsonObject {{QStringLiteral("command"), summary.command},
+                      {QStringLiteral("applicationRunningTime"), static_cast<double>(summary.applicationRunningTime)},
+                      {QStringLiteral("sampleCount"), static_cast<double>(summary.sampleCount)},
+                      {QStringLiteral("lostChunks"), static_cast<double>(summary.lostChunks)},
+                      {QStringLiteral("stageTimes"),
+                       QJsonObject {{QStringLiteral("parsing"), static_cast<double>(summary.stageTimes.parsing)},
+                                    {QStringLiteral("aggregation"),
+                                     static_cast<double>(summary.stageTimes.aggregation)},
+                                    {QStringLiteral("topDown"), static_cast<double>(summary.stageTimes.topDown)},
+                                    {QStringLiteral("callerCallee"),
+                                     static_cast<double>(summary.stageTimes.callerCallee)}}},
+                      {QStringLiteral("totalCosts"), totals}}},
+        {QStringLiteral("topSymbols"), symbols},
+        {QStringLiteral("stacks"), stacks}};
+    return QJsonDocument(root).toJson();
+}
+
+QString escapeCsv(const QString& value)
+{
+    if (!value.contains(QLatin1Char(',')) && !value.contains(QLatin1Char('"')) && !value.contains(QLatin1Char('\n'))) {
+        return value;
+    }
+    auto escaped = value;
+    escaped.replace(QLatin1Char('"'), QLatin1String("\"\""));
+    return QLatin1Char('"') + escaped + QLatin1Char('"');
+}
+
+// a single table for all parts of the results, the first column tells them apart
+QByteArray toCsv(const Data::BottomUpResults& results, int numTopSymbols)
+{
+    const auto& costs = results.costs;
+
+    QByteArray csv;
+    QTextStream stream(&csv);
+    stream << "kind,symbol,binary";
+    for (int type = 0, c = costs.numTypes(); type < c; ++type) {
+        stream << ',' << escapeCsv(costs.typeName(type));
+    }
+    stream << '\n';
+
+    stream << "total,,";
+    for (int type = 0, c = costs.numTypes(); type < c; ++type) {
+        stream << ',' << costs.totalCost(type);
+    }
+    stream << '\n';
+
+    for (const auto* symbol : topSymbols(results, numTopSymbols)) {
+        stream << "symbol," << escapeCsv(Util::formatSymbol(symbol->symbol)) << ','
+               << escapeCsv(symbol->symbol.binary);
+        for (int type = 0, c = costs.numTypes(); type < c; ++type) {
+            stream << ',' << costs.cost(type, symbol->id);
+        }
+        stream << '\n';
+    }
+
+    ProfileExport::forEachCollapsedStack(results, [&stream](const QString& stack, const QVector<qint64>& costs) {
+        stream << "stack," << escapeCsv(stack) << ',';
+        for (auto cost : costs) {
+            stream << ',' << cost;
+        }
+        stream << '\n';
+    });
+    stream.flush();
+    return csv;
+}
+
+QSet<Data::Symbol> findSymbols(const Data::BottomUpResults& results, const QStringList& names)
+{
+    QSet<Data::Symbol> symbols;
+    for (const auto& symbol : results.symbols) {
+        if (symbol.isValid() && (names.contains(symbol.symbol) || names.contains(symbol.prettySymbol))) {
+            symbols.insert(symbol);
+        }
+    }
+    return symbols;
+}
+}
+
+bool BatchAnalysis::isRequested(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--export") || !strncmp(argv[i], "--export=", 9) || !strcmp(argv[i], "--export-script")
+            || !strncmp(argv[i], "--export-script=", 16) || !strcmp(argv[i], "--export-arrow")
+            || !strncmp(argv[i], "--export-arrow=", 15)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int BatchAnalysis::run(const Options& options)
+{
+    QTextStream err(stderr);
+    if (options.inputFiles.isEmpty()) {
+        err << "no input file given\n";
+        return Failure;
+    }
+
+    PerfParser parser;
+    QEventLoop loop;
+    Data::Summary summary;
+    Data::BottomUpResults results;
+    Data::EventResults events;
+    QString error;
+    bool filtered = false;
+
+    QObject::connect(&parser, &PerfParser::summaryDataAvailable, &loop,
+                     [&summary](const Data::Summary& data) { summary = data; });
+    QObject::connect(&parser, &PerfParser::bottomUpDataAvailable, &loop,
+                     [&results](const Data::BottomUpResults& data) { results = data; });
+    QObject::connect(&parser, &PerfParser::eventsAvailable, &loop,
+                     [&events](const Data::EventResults& data) { events = data; });
+    QObject::connect(&parser, &PerfParser::parsingFailed, &loop, [&](const QString& message) {
+        error = message;
+        loop.quit();
+    });
+    QObject::connect(&parser, &PerfParser::parsingFinished, &loop, [&]() {
+        auto filter = options.filter;
+        if (!filtered) {
+            filtered = true;
+            filter.includeSymbols = findSymbols(results, options.includeSymbols);
+            filter.excludeSymbols = findSymbols(results, options.excludeSymbols);
+            if (!options.includeSymbols.isEmpty() && filter.includeSymbols.isEmpty()) {
+                error = QStringLiteral("none of the included symbols got recorded");
+                loop.quit();
+                return;
+            }
+            if (filter.isValid()) {
+                parser.filterResults(filter);
+                return;
+            }
+        }
+        loop.quit();
+    });
+
+    if (!options.scriptOutputFile.isEmpty()) {
+        parser.setScriptOutput(options.scriptOutputFile);
+    }
+    parser.setTimeAlignment(options.alignFileStarts ? PerfParser::TimeAlignment::Start
+                                                    : PerfParser::TimeAlignment::Clock,
+                            options.timeOffsets);
+
+    const auto cacheMode =
+        options.useResultsCache ? PerfParser::ResultsCacheMode::Use : PerfParser::ResultsCacheMode::Ignore;
+    parser.startParseFiles(options.inputFiles, options.sysroot, options.kallsyms, options.debugPaths,
+                           options.extraLibPaths, options.appPath, options.arch, cacheMode);
+    loop.exec();
+
+    if (!error.isEmpty()) {
+        err << "failed to analyze " << options.inputFiles.join(QLatin1String(", ")) << ": " << error << '\n';
+        return Failure;
+    }
+
+    if (!options.outputFile.isEmpty()) {
+        QFile file(options.outputFile);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            err << "failed to write " << options.outputFile << ": " << file.errorString() << '\n';
+            return Failure;
+        }
+        if (options.outputFile.endsWith(QLatin1String(".csv"), Qt::CaseInsensitive)) {
+            file.write(toCsv(results, options.topSymbols));
+        } else {
+            file.write(toJson(summary, results, options.topSymbols));
+        }
+    }
+
+    if (!options.arrowDirectory.isEmpty()) {
+        const auto arrowError = ArrowExport::writeDirectory(options.arrowDirectory, results, events);
+        if (!arrowError.isEmpty()) {
+            err << "failed to write the Arrow streams to " << arrowError << '\n';
+            return Failure;
+        }
+    }
+
+    int exitCode = Success;
+    for (auto it = options.maxCosts.begin(), end = options.maxCosts.end(); it != end; ++it) {
+        int type = -1;
+        for (int i = 0, c = results.costs.numTypes(); i < c; ++i) {
+            if (results.costs.typeName(i) == it.key()) {
+                type = i;
+                break;
+            }
+        }
+        if (type == -1) {
+            err << "unknown cost type " << it.key() << '\n';
+            return Failure;
+        }
+        const auto cost = results.costs.totalCost(type);
+        if (cost > it.value()) {
+            err << it.key() << " cost " << cost << " exceeds the threshold of " << it.value() << '\n';
+            exitCode = ThresholdExceeded;
+        }
+    }
+    return exitCode;
+}
@@ -0,0 +1,82 @@
+/*
+  batchanalysis.h
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+#include "models/data.h"
+
+// parses perf data files without any widgets and writes the results to a file, for use in scripts and CI jobs
+namespace BatchAnalysis {
+enum ExitCode
+{
+    Success = 0,
+    Failure = 1,
+    ThresholdExceeded = 2
+};
+
+struct Options
+{
+    QStringList inputFiles;
+    QString sysroot;
+    QString kallsyms;
+    QString debugPaths;
+    QString extraLibPaths;
+    QString appPath;
+    QString arch;
+    bool useResultsCache = true;
+    // how the time lines of several input files get aligned, see PerfParser::setTimeAlignment
+    bool alignFileStarts = false;
+    QVector<qint64> timeOffsets;
+
+    // the results get written as JSON, unless the file name ends with .csv
+    QString outputFile;
+    // the samples get written in the text format of `perf script`, "-" writes them to stdout
+    QString scriptOutputFile;
+    // the events and the tables they reference get written as Arrow IPC streams into this directory
+    QString arrowDirectory;
+    // number of bottom-up symbols with the highest self cost to export
+    int topSymbols = 20;
+    // the symbols get resolved by their name once the file got parsed, as they are interned by their binary too
+    QStringList includeSymbols;
+    QStringList excludeSymbols;
+    // applied after parsing, just like filtering in the GUI
+    Data::FilterAction filter;
+    // the maximum total cost of each cost type, keyed by the name of the cost type
+    QHash<QString, qint64> maxCosts;
+};
+
+// @return true when @p arguments ask for the batch mode, checked before any application object exists
+bool isRequested(int argc, char** argv);
+
+// parse the input files, apply the filter and write the results
+// @return one of the ExitCode values, ThresholdExceeded when any total cost exceeds its configured maximum
+int run(const Options& options);
+}
@@ -0,0 +1,199 @@
+/*
+  cpuheatmap.cpp
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cpuheatmap.h"
+
+#include <QHelpEvent>
+#include <QPainter>
+#include <QToolTip>
+
+#include <algorithm>
+
+#include "util.h"
+
+namespace {
+const int NumBuckets = 200;
+const int NodeSpacing = 4;
+
+// the first cost type which isn't measured in time, as context switches don't tell anything about the utilization
+int utilizationCostType(const Data::EventResults& events)
+{
+    for (int i = 0, c = events.totalCosts.size(); i < c; ++i) {
+        if (i != events.offCpuTimeCostId && events.totalCosts[i].unit != Data::Costs::Unit::Time) {
+            return i;
+        }
+    }
+    return -1;
+}
+}
+
+CpuHeatMap::CpuHeatMap(QWidget* parent)
+    : QWidget(parent)
+{
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+}
+
+CpuHeatMap::~CpuHeatMap() = default;
+
+void CpuHeatMap::setEvents(const Data::EventResults& events)
+{
+    m_utilization = {};
+    m_costLabel.clear();
+
+    const auto type = utilizationCostType(events);
+    if (type != -1 && !events.threads.isEmpty()) {
+        auto time = events.threads.first().time;
+        for (const auto& thread : events.threads) {
+            time.start = std::min(time.start, thread.time.start);
+            time.end = std::max(time.end, thread.time.end);
+        }
+        m_utilization = events.cpuUtilization(type, time, NumBuckets);
+        m_costLabel = events.totalCosts[type].label;
+    }
+
+    m_numNodeChanges.clear();
+    const auto& numaNodes = m_utilization.numaNodes;
+    for (int row = 0, c = numaNodes.size(); row < c; ++row) {
+        const bool isNewNode = row > 0 && numaNodes[row] != numaNodes[row - 1];
+        m_numNodeChanges.push_back((row > 0 ? m_numNodeChanges.last() : 0) + (isNewNode ? 1 : 0));
+    }
+
+    updateGeometry();
+    update();
+}
+
+bool CpuHeatMap::hasData() const
+{
+    return !m_utilization.cpuIds.isEmpty();
+}
+
+QSize CpuHeatMap::sizeHint() const
+{
+    const auto numNodeChanges = m_numNodeChanges.isEmpty() ? 0 : m_numNodeChanges.last();
+    return {labelWidth() + NumBuckets, m_utilization.cpuIds.size() * rowHeight() + numNodeChanges * NodeSpacing};
+}
+
+bool CpuHeatMap::event(QEvent* event)
+{
+    if (event->type() != QEvent::ToolTip) {
+        return QWidget::event(event);
+    }
+
+    const auto* helpEvent = static_cast<QHelpEvent*>(event);
+    const auto rect = heatMapRect();
+    const auto row = rowAt(helpEvent->pos());
+    if (row == -1 || !rect.contains(helpEvent->pos())) {
+        QToolTip::hideText();
+        event->ignore();
+        return true;
+    }
+
+    const auto bucket = std::min(m_utilization.numBuckets - 1,
+                                 (helpEvent->pos().x() - rect.left()) * m_utilization.numBuckets / rect.width());
+    const auto start = bucket * m_utilization.bucketDuration;
+    const auto cost = m_utilization.cost(row, bucket);
+    const auto node = m_utilization.numaNodes[row];
+    auto text = tr("CPU #%1").arg(m_utilization.cpuIds[row]);
+    if (node != -1) {
+        text += tr(", NUMA node %1").arg(node);
+    }
+    text += QLatin1Char('\n')
+        + tr("%1 to %2: %3 %4 (%5% of the maximum)")
+              .arg(Util::formatTimeString(start), Util::formatTimeString(start + m_utilization.bucketDuration),
+                   Util::formatCost(cost), m_costLabel, Util::formatCostRelative(cost, m_utilization.maxCost));
+    QToolTip::showText(helpEvent->globalPos(), text, this);
+    return true;
+}
+
+void CpuHeatMap::paintEvent(QPaintEvent* /*event*/)
+{
+    if (!hasData()) {
+        return;
+    }
+
+    QPainter painter(this);
+    const auto& utilization = m_utilization;
+    const auto maxCost = std::max(quint64(1), utilization.maxCost);
+    for (int row = 0, c = utilization.cpuIds.size(); row < c; ++row) {
+        const auto rowRect = cellRect(row, 0);
+        const auto labelRect = QRect(0, rowRect.top(), labelWidth() - NodeSpacing, rowRect.height());
+        auto label = tr("CPU #%1").arg(utilization.cpuIds[row]);
+        const auto node = utilization.numaNodes[row];
+        if (node != -1 && (row == 0 || node != utilization.numaNodes[row - 1])) {
+            label = tr("Node %1: %2").arg(QString::number(node), label);
+        }
+        painter.drawText(labelRect, Qt::AlignRight | Qt::AlignVCenter, label);
+
+        for (int bucket = 0; bucket < utilization.numBuckets; ++bucket) {
+            const auto cost = utilization.cost(row, bucket);
+            if (!cost) {
+                continue;
+            }
+            // the hotter a cell, the more saturated its red
+            const auto fraction = static_cast<double>(cost) / maxCost;
+            painter.fillRect(cellRect(row, bucket), QColor::fromHsvF(0, 0.1 + 0.9 * fraction, 1));
+        }
+    }
+}
+
+QRect CpuHeatMap::heatMapRect() const
+{
+    const auto left = labelWidth();
+    return QRect(left, 0, std::max(1, width() - left), height());
+}
+
+QRect CpuHeatMap::cellRect(int row, int bucket) const
+{
+    const auto rect = heatMapRect();
+    const auto left = rect.left() + bucket * rect.width() / m_utilization.numBuckets;
+    const auto right = rect.left() + (bucket + 1) * rect.width() / m_utilization.numBuckets;
+    // leave some space between the CPUs of different NUMA nodes
+    const auto top = row * rowHeight() + m_numNodeChanges[row] * NodeSpacing;
+    return QRect(left, top, std::max(1, right - left), rowHeight());
+}
+
+int CpuHeatMap::rowAt(const QPoint& pos) const
+{
+    for (int row = 0, c = m_utilization.cpuIds.size(); row < c; ++row) {
+        const auto rect = cellRect(row, 0);
+        if (pos.y() >= rect.top() && pos.y() <= rect.bottom()) {
+            return row;
+        }
+    }
+    return -1;
+}
+
+int CpuHeatMap::rowHeight() const
+{
+    return fontMetrics().height();
+}
+
+int CpuHeatMap::labelWidth() const
+{
+    return fontMetrics().width(tr("Node %1: %2").arg(QStringLiteral("00"), tr("CPU #%1").arg(QStringLiteral("000"))))
+        + NodeSpacing;
+}
@@ -0,0 +1,68 @@
+/*
+  cpuheatmap.h
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <QWidget>
+
+#include "models/data.h"
+
+/**
+ * A heat map of the cost of every CPU over time, the CPUs are grouped by their NUMA node.
+ *
+ * The utilization is computed once for a fixed number of buckets, painting then doesn't need to look at any event.
+ */
+class CpuHeatMap : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit CpuHeatMap(QWidget* parent = nullptr);
+    ~CpuHeatMap();
+
+    void setEvents(const Data::EventResults& events);
+
+    // @return true when there are CPUs with events to show
+    bool hasData() const;
+
+    QSize sizeHint() const override;
+
+protected:
+    bool event(QEvent* event) override;
+    void paintEvent(QPaintEvent* event) override;
+
+private:
+    QRect heatMapRect() const;
+    QRect cellRect(int row, int bucket) const;
+    int rowAt(const QPoint& pos) const;
+    int rowHeight() const;
+    int labelWidth() const;
+
+    Data::CpuUtilization m_utilization;
+    // the number of NUMA node boundaries above each row
+    QVector<int> m_numNodeChanges;
+    QString m_costLabel;
+};
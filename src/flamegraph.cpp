@@ -27,35 +27,39 @@
 
 #include "flamegraph.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include <QAction>
+#include <QBitArray>
 #include <QCheckBox>
 #include <QComboBox>
 #include <QCursor>
 #include <QDebug>
 #include <QDoubleSpinBox>
 #include <QEvent>
-#include <QGraphicsRectItem>
-#include <QGraphicsScene>
-#include <QGraphicsView>
+#include <QFile>
 #include <QLabel>
 #include <QLineEdit>
 #include <QMenu>
+#include <QPainter>
+#include <QPaintEvent>
 #include <QPushButton>
-#include <QScrollBar>
-#include <QStyleOption>
+#include <QScrollArea>
+#include <QSharedPointer>
+#include <QSignalBlocker>
+#include <QTextStream>
+#include <QTimer>
 #include <QToolTip>
 #include <QVBoxLayout>
 #include <QWheelEvent>
-#include <QSvgGenerator>
 
 #include <KColorScheme>
 #include <KLocalizedString>
 #include <KStandardAction>
-#include <ThreadWeaver/ThreadWeaver>
 
 #include "models/filterandzoomstack.h"
+#include "models/instrumentation.h"
 #include "resultsutil.h"
 #include "settings.h"
 
@@ -68,156 +72,76 @@ enum SearchMatchType
     ChildMatch
 };
 }
-class FrameGraphicsItem : public QGraphicsRectItem
-{
-public:
-    FrameGraphicsItem(const qint64 cost, Data::Costs::Unit unit, const Data::Symbol& symbol, FrameGraphicsItem* parent = nullptr);
-
-    qint64 cost() const;
-    void setCost(qint64 cost);
-    Data::Symbol symbol() const;
-
-    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget = nullptr) override;
-
-    QString description() const;
-    void setSearchMatchType(SearchMatchType matchType);
-
-protected:
-    void hoverEnterEvent(QGraphicsSceneHoverEvent* event) override;
-    void hoverLeaveEvent(QGraphicsSceneHoverEvent* event) override;
-
-private:
-    qint64 m_cost;
-    Data::Symbol m_symbol;
-    bool m_isHovered;
-    SearchMatchType m_searchMatch = NoSearch;
-    Data::Costs::Unit m_unit;
-};
-
-Q_DECLARE_METATYPE(FrameGraphicsItem*)
-
-FrameGraphicsItem::FrameGraphicsItem(const qint64 cost, Data::Costs::Unit unit, const Data::Symbol& symbol, FrameGraphicsItem* parent)
-    : QGraphicsRectItem(parent)
-    , m_cost(cost)
-    , m_symbol(symbol)
-    , m_isHovered(false)
-    , m_unit(unit)
-{
-    setFlag(QGraphicsItem::ItemIsSelectable);
-    setAcceptHoverEvents(true);
-}
-
-qint64 FrameGraphicsItem::cost() const
-{
-    return m_cost;
-}
-
-void FrameGraphicsItem::setCost(qint64 cost)
-{
-    m_cost = cost;
-}
-
-Data::Symbol FrameGraphicsItem::symbol() const
-{
-    return m_symbol;
-}
-
-void FrameGraphicsItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* /*widget*/)
-{
-    if (isSelected() || m_isHovered || m_searchMatch == DirectMatch) {
-        auto selectedColor = brush().color();
-        selectedColor.setAlpha(255);
-        painter->fillRect(rect(), selectedColor);
-    } else if (m_searchMatch == NoMatch) {
-        auto noMatchColor = brush().color();
-        noMatchColor.setAlpha(50);
-        painter->fillRect(rect(), noMatchColor);
-    } else { // default, when no search is running, or a sub-item is matched
-        painter->fillRect(rect(), brush());
-    }
-
-    const QPen oldPen = painter->pen();
-    auto pen = oldPen;
-    if (m_searchMatch != NoMatch) {
-        pen.setColor(brush().color());
-        if (isSelected()) {
-            pen.setWidth(2);
-        }
-        painter->setPen(pen);
-        painter->drawRect(rect());
-        painter->setPen(oldPen);
-    }
-
-    const int margin = 4;
-    const int width = rect().width() - 2 * margin;
-    if (width < option->fontMetrics.averageCharWidth() * 6) {
-        // text is too wide for the current LOD, don't paint it
-        return;
-    }
-
-    if (m_searchMatch == NoMatch) {
-        auto color = oldPen.color();
-        color.setAlpha(125);
-        pen.setColor(color);
-        painter->setPen(pen);
-    }
-
-    const int height = rect().height();
-    const auto binary = Util::formatString(m_symbol.binary);
-    const auto symbol = Util::formatSymbol(m_symbol, false);
-    const auto symbolText = symbol.isEmpty() ? QObject::tr("?? [%1]").arg(binary) : symbol;
-    painter->drawText(margin + rect().x(), rect().y(), width, height,
-                      Qt::AlignVCenter | Qt::AlignLeft | Qt::TextSingleLine,
-                      option->fontMetrics.elidedText(symbolText, Qt::ElideRight, width));
-
-    if (m_searchMatch == NoMatch) {
-        painter->setPen(oldPen);
-    }
-}
 
-void FrameGraphicsItem::hoverEnterEvent(QGraphicsSceneHoverEvent* event)
-{
-    QGraphicsRectItem::hoverEnterEvent(event);
-    m_isHovered = true;
-    update();
-}
-
-void FrameGraphicsItem::hoverLeaveEvent(QGraphicsSceneHoverEvent* event)
-{
-    QGraphicsRectItem::hoverLeaveEvent(event);
-    m_isHovered = false;
-    update();
-}
-
-QString FrameGraphicsItem::description() const
+/**
+ * The flame graph as a flat list of frames in breadth-first order.
+ *
+ * This keeps the frames of each depth contiguous and sorted by their offset, which allows us to find the frame
+ * at a given position with a binary search. The children of every frame are contiguous too.
+ *
+ * The frames are shared by all cost types, which each get their own layout. No cost threshold is applied when
+ * building the frames, instead the view hides the children of frames below the threshold. Thus switching the cost
+ * type or changing the threshold doesn't require rebuilding anything.
+ */
+struct FlameGraphFrames
 {
-    // we build the tooltip text on demand, which is much faster than doing that for potentially thousands of items when
-    // we load the data
-    qint64 totalCost = 0;
+    struct Frame
     {
-        auto item = this;
-        while (item->parentItem()) {
-            item = static_cast<const FrameGraphicsItem*>(item->parentItem());
-        }
-        totalCost = item->cost();
-    }
-    const auto symbol = Util::formatSymbol(m_symbol);
-    if (!parentItem()) {
-        return symbol;
-    }
+        // index into symbols
+        int symbol = 0;
+        int parent = -1;
+        int firstChild = 0;
+        int numChildren = 0;
+        int depth = 0;
+        uint hash = 0;
+    };
+
+    struct Layout
+    {
+        QString label;
+        Data::Costs::Unit unit = Data::Costs::Unit::Unknown;
+        QVector<qint64> costs;
+        // the summed up cost of all frames left of a frame on the same depth, i.e. its horizontal position
+        QVector<qint64> offsets;
+        // the children of each frame sorted by descending cost, at the same positions as the children themselves.
+        // this allows painting only the children that are wide enough without looking at the others
+        QVector<int> childrenByCost;
+        // only set for the types with negative costs, i.e. a diff: the signed cost change of each frame, which it
+        // gets colored by. the costs then hold the absolute changes in and below each frame instead, so that the
+        // improvements take up room too
+        QVector<qint64> deltas;
+    };
+
+    QVector<Frame> frames;
+    // the unique symbols of all frames, the first one is used for the root frame
+    QVector<Data::Symbol> symbols;
+    // the index of the first frame of each depth, followed by the total number of frames
+    QVector<int> depthBegins;
+    // one layout per cost type
+    QVector<Layout> layouts;
+
+    // the data these frames were built from, see FlameGraph::setData
+    uint generation = 0;
+    bool bottomUp = false;
+};
 
-    return i18nc("%1: aggregated sample costs, %2: relative number, %3: function label, %4: binary",
-                 "%1 (%2%) aggregated sample costs in %3 (%4) and below.", Data::Costs::formatCost(m_unit, m_cost),
-                 Util::formatCostRelative(m_cost, totalCost), symbol, m_symbol.binary);
-}
+Q_DECLARE_METATYPE(FlameGraphFrames*)
 
-void FrameGraphicsItem::setSearchMatchType(SearchMatchType matchType)
+/**
+ * The frames matched by a search, see applySearch.
+ */
+struct FlameGraphSearchResults
 {
-    if (m_searchMatch != matchType) {
-        m_searchMatch = matchType;
-        update();
-    }
-}
+    uint generation = 0;
+    // frames whose symbol matches the search
+    QBitArray directMatches;
+    // frames with a matching frame below them
+    QBitArray childMatches;
+    // the cost of all directly matched frames, not counting nested matches twice
+    qint64 directCost = 0;
+};
+
+Q_DECLARE_METATYPE(FlameGraphSearchResults*)
 
 namespace {
 
@@ -238,11 +162,13 @@ QBrush hotBrush()
                   125);
 }
 
+const int NumBrushes = 100;
+
 template<typename Generator>
 QVector<QBrush> generateBrushes(Generator generator)
 {
     QVector<QBrush> ret;
-    std::generate_n(std::back_inserter(ret), 100, generator);
+    std::generate_n(std::back_inserter(ret), NumBrushes, generator);
     return ret;
 }
 
@@ -264,156 +190,1013 @@ QBrush brushImpl(uint hash, BrushType type)
     return brushes.at(hash % brushes.size());
 }
 
-template<typename T>
-QBrush brush(const T& entry, BrushType type)
+const int NumMetricBrushes = 21;
+
+/**
+ * Generate a brush for a derived metric, from red for the worst to green for the best values
+ *
+ * @p bucket is in the range [0, NumMetricBrushes), or -1 for frames without a value
+ */
+QBrush metricBrush(int bucket)
 {
-    return brushImpl(qHash(entry), type);
+    static const QVector<QBrush> brushes = []() {
+        QVector<QBrush> ret;
+        for (int i = 0; i < NumMetricBrushes; ++i) {
+            ret.append(QColor::fromHsv(120 * i / (NumMetricBrushes - 1), 255, 255, 125));
+        }
+        return ret;
+    }();
+    return bucket == -1 ? QBrush(QColor(192, 192, 192, 125)) : brushes.at(bucket);
 }
 
 /**
- * Layout the flame graph and hide tiny items.
+ * Generate a brush for the cost change of a diff, from blue for improvements over white to red for regressions
+ *
+ * @p bucket is in the range [0, NumMetricBrushes), the middle one stands for no change
  */
-void layoutItems(FrameGraphicsItem* parent)
-{
-    const auto& parentRect = parent->rect();
-    const auto pos = parentRect.topLeft();
-    const qreal maxWidth = parentRect.width();
-    const qreal h = parentRect.height();
-    const qreal y_margin = 2.;
-    const qreal y = pos.y() - h - y_margin;
-    qreal x = pos.x();
-
-    auto children = parent->childItems();
-    // sort to get reproducible graphs
-    std::sort(children.begin(), children.end(), [](const QGraphicsItem* lhs, const QGraphicsItem* rhs) {
-        return static_cast<const FrameGraphicsItem*>(lhs)->symbol()
-            < static_cast<const FrameGraphicsItem*>(rhs)->symbol();
-    });
+QBrush deltaBrush(int bucket)
+{
+    static const QVector<QBrush> brushes = []() {
+        QVector<QBrush> ret;
+        for (int i = 0; i < NumMetricBrushes; ++i) {
+            const auto relative = 2. * i / (NumMetricBrushes - 1) - 1;
+            ret.append(QColor::fromHsv(relative < 0 ? 240 : 0, qRound(255 * std::abs(relative)), 255, 125));
+        }
+        return ret;
+    }();
+    return brushes.at(bucket);
+}
+
+struct FrameNode
+{
+    Data::Symbol symbol;
+    QVector<qint64> costs;
+    QVector<int> children;
+};
 
-    foreach (auto child, children) {
-        auto frameChild = static_cast<FrameGraphicsItem*>(child);
-        const qreal w = maxWidth * double(frameChild->cost()) / parent->cost();
-        frameChild->setVisible(w > 1);
-        if (frameChild->isVisible()) {
-            frameChild->setRect(QRectF(x, y, w, h));
-            layoutItems(frameChild);
-            x += w;
+bool hasCost(const Data::Costs& costs, quint32 id)
+{
+    for (int type = 0, c = costs.numTypes(); type < c; ++type) {
+        if (costs.cost(type, id) != 0) {
+            return true;
         }
     }
+    return false;
 }
 
-FrameGraphicsItem* findItemBySymbol(const QList<QGraphicsItem*>& items, const Data::Symbol& symbol)
+/**
+ * Convert the top-down graph into a tree of FrameNode, accumulating the costs of all types at once.
+ *
+ * This iterates instead of recursing over the rows, as the graph can be deeper than the call stack allows.
+ *
+ * @return false when @p isCanceled returned true before all rows got converted
+ */
+template<typename Tree, typename IsCanceled>
+bool toFrameNodes(const Data::Costs& costs, const QVector<Tree>& data, IsCanceled isCanceled,
+                  QVector<FrameNode>* nodes)
 {
-    foreach (auto item_, items) {
-        auto item = static_cast<FrameGraphicsItem*>(item_);
-        if (item->symbol() == symbol) {
-            return item;
+    const auto numTypes = costs.numTypes();
+    // the rows still to convert, along with the index of their parent node
+    QVector<QPair<const Tree*, int>> pending;
+    for (int i = data.size() - 1; i >= 0; --i) {
+        pending.append(qMakePair(&data[i], 0));
+    }
+    while (!pending.isEmpty()) {
+        if (nodes->size() % 4096 == 0 && isCanceled()) {
+            return false;
+        }
+        const auto next = pending.takeLast();
+        const auto& row = *next.first;
+        // the symbols of the children are unique, recursions already got collapsed while aggregating, if requested
+        const int node = nodes->size();
+        FrameNode frameNode;
+        frameNode.symbol = row.symbol;
+        frameNode.costs.resize(numTypes);
+        for (int type = 0; type < numTypes; ++type) {
+            frameNode.costs[type] = costs.cost(type, row.id);
+        }
+        nodes->append(frameNode);
+        (*nodes)[next.second].children.append(node);
+
+        if (hasCost(costs, row.id)) {
+            // push the children in reverse, to convert them in their order
+            for (int i = row.children.size() - 1; i >= 0; --i) {
+                pending.append(qMakePair(&row.children[i], node));
+            }
         }
     }
-    return nullptr;
+    return true;
 }
 
 /**
- * Convert the top-down graph into a tree of FrameGraphicsItem.
+ * @return the frames of @p topDownData, or nullptr when @p isCanceled returned true before they got built
  */
-template<typename Tree>
-void toGraphicsItems(const Data::Costs& costs, int type, const QVector<Tree>& data, FrameGraphicsItem* parent,
-                     const double costThreshold, bool collapseRecursion)
-{
-    foreach (const auto& row, data) {
-        if (collapseRecursion && !row.symbol.symbol.isEmpty() && row.symbol == parent->symbol()) {
-            if (costs.cost(type, row.id) > costThreshold) {
-                toGraphicsItems(costs, type, row.children, parent, costThreshold, collapseRecursion);
-            }
+template<typename Tree, typename IsCanceled>
+FlameGraphFrames* parseData(const Data::Costs& costs, const QVector<Tree>& topDownData, IsCanceled isCanceled)
+{
+    const auto numTypes = costs.numTypes();
+
+    QVector<FrameNode> nodes(1);
+    nodes[0].costs = costs.totalCosts();
+    if (!toFrameNodes(costs, topDownData, isCanceled, &nodes)) {
+        return nullptr;
+    }
+
+    // the absolute changes in and below each node of the types with negative costs. the children always come after
+    // their parent, so walking the nodes backwards sums up the children first
+    QVector<QVector<qint64>> changes(numTypes);
+    for (int type = 0; type < numTypes; ++type) {
+        const bool isDiff =
+            std::any_of(nodes.begin() + 1, nodes.end(), [type](const FrameNode& node) { return node.costs[type] < 0; });
+        if (!isDiff) {
             continue;
         }
-        auto item = findItemBySymbol(parent->childItems(), row.symbol);
-        if (!item) {
-            item = new FrameGraphicsItem(costs.cost(type, row.id), costs.unit(type), row.symbol, parent);
-            item->setPen(parent->pen());
-            item->setBrush(brush(row.symbol, BrushType::Hot));
-        } else {
-            item->setCost(item->cost() + costs.cost(type, row.id));
+        auto& change = changes[type];
+        change.resize(nodes.size());
+        for (int i = nodes.size() - 1; i > 0; --i) {
+            auto selfCost = nodes[i].costs[type];
+            for (const auto child : nodes[i].children) {
+                selfCost -= nodes[child].costs[type];
+                change[i] += change[child];
+            }
+            change[i] += std::abs(selfCost);
+        }
+        // the root has no change of its own, its cost is the total of the baseline
+        for (const auto child : nodes[0].children) {
+            change[0] += change[child];
+        }
+    }
+
+    // flatten the tree in breadth-first order, the children get sorted to get reproducible graphs
+    auto* ret = new FlameGraphFrames;
+    auto& frames = ret->frames;
+    frames.reserve(nodes.size());
+    ret->layouts.resize(numTypes);
+    for (int type = 0; type < numTypes; ++type) {
+        auto& layout = ret->layouts[type];
+        layout.label = i18n("%1 aggregated %2 cost in total", costs.formatCost(type, costs.totalCost(type)),
+                            costs.typeName(type));
+        layout.unit = costs.unit(type);
+        layout.costs.reserve(nodes.size());
+        layout.offsets.reserve(nodes.size());
+        layout.childrenByCost.reserve(nodes.size());
+        layout.costs.append(changes[type].isEmpty() ? costs.totalCost(type) : changes[type].first());
+        layout.offsets.append(0);
+        layout.childrenByCost.append(0);
+        if (!changes[type].isEmpty()) {
+            layout.deltas.reserve(nodes.size());
+            layout.deltas.append(costs.totalCost(type));
+        }
+    }
+
+    QVector<int> frameNodes;
+    frameNodes.reserve(nodes.size());
+
+    QHash<Data::Symbol, int> symbolIds;
+    auto& symbols = ret->symbols;
+    symbols.append({});
+
+    frames.append({});
+    frameNodes.append(0);
+
+    for (int i = 0; i < frames.size(); ++i) {
+        if (i % 4096 == 0 && isCanceled()) {
+            delete ret;
+            return nullptr;
         }
-        if (item->cost() > costThreshold) {
-            toGraphicsItems(costs, type, row.children, item, costThreshold, collapseRecursion);
+        auto children = nodes[frameNodes[i]].children;
+        std::sort(children.begin(), children.end(),
+                  [&nodes](int lhs, int rhs) { return nodes.at(lhs).symbol < nodes.at(rhs).symbol; });
+
+        const int firstChild = frames.size();
+        const int depth = frames[i].depth + 1;
+        frames[i].firstChild = firstChild;
+        frames[i].numChildren = children.size();
+
+        for (const auto child : children) {
+            const auto& node = nodes[child];
+            auto symbolId = symbolIds.find(node.symbol);
+            if (symbolId == symbolIds.end()) {
+                symbolId = symbolIds.insert(node.symbol, symbols.size());
+                symbols.append(node.symbol);
+            }
+            FlameGraphFrames::Frame frame;
+            frame.symbol = symbolId.value();
+            frame.parent = i;
+            frame.depth = depth;
+            frame.hash = qHash(node.symbol);
+            frames.append(frame);
+            frameNodes.append(child);
         }
+
+        for (int type = 0; type < numTypes; ++type) {
+            auto& layout = ret->layouts[type];
+            auto offset = layout.offsets[i];
+            const auto& change = changes[type];
+            for (const auto child : children) {
+                const auto cost = change.isEmpty() ? nodes[child].costs[type] : change[child];
+                if (!change.isEmpty()) {
+                    layout.deltas.append(nodes[child].costs[type]);
+                }
+                layout.costs.append(cost);
+                layout.offsets.append(offset);
+                layout.childrenByCost.append(layout.costs.size() - 1);
+                offset += cost;
+            }
+            const auto& layoutCosts = layout.costs;
+            std::stable_sort(layout.childrenByCost.begin() + firstChild, layout.childrenByCost.end(),
+                             [&layoutCosts](int lhs, int rhs) { return layoutCosts[lhs] > layoutCosts[rhs]; });
+        }
+
+        // the node isn't needed anymore, release its memory early
+        nodes[frameNodes[i]] = {};
     }
+
+    for (int i = 0; i < frames.size(); ++i) {
+        if (i == 0 || frames[i].depth != frames[i - 1].depth) {
+            ret->depthBegins.append(i);
+        }
+    }
+    ret->depthBegins.append(frames.size());
+    return ret;
 }
 
-template<typename Tree>
-FrameGraphicsItem* parseData(const Data::Costs& costs, int type, const QVector<Tree>& topDownData, double costThreshold,
-                             bool collapseRecursion)
+bool matchesSearch(const Data::Symbol& symbol, const QString& searchValue)
 {
-    const auto totalCost = costs.totalCost(type);
+    return symbol.symbol.contains(searchValue, Qt::CaseInsensitive)
+        || (searchValue == QLatin1String("??") && symbol.symbol.isEmpty())
+        || symbol.binary.contains(searchValue, Qt::CaseInsensitive);
+}
+
+/**
+ * Search all frames for @p searchValue.
+ *
+ * Every unique symbol is only matched once, the frames then just look up the result of their symbol.
+ *
+ * @return false when @p isCanceled returned true before the search finished
+ */
+template<typename IsCanceled>
+bool applySearch(const FlameGraphFrames& frames, int type, const QString& searchValue, IsCanceled isCanceled,
+                 FlameGraphSearchResults* results)
+{
+    const auto& symbols = frames.symbols;
+    QBitArray symbolMatches(symbols.size());
+    // the first symbol is a placeholder for the root frame, which never matches
+    for (int i = 1, c = symbols.size(); i < c; ++i) {
+        if (i % 1024 == 0 && isCanceled()) {
+            return false;
+        }
+        if (matchesSearch(symbols[i], searchValue)) {
+            symbolMatches.setBit(i);
+        }
+    }
+
+    const auto& allFrames = frames.frames;
+    const auto& costs = frames.layouts[type].costs;
+    auto& directMatches = results->directMatches;
+    auto& childMatches = results->childMatches;
+    directMatches.resize(allFrames.size());
+    childMatches.resize(allFrames.size());
+    // frames below a direct match, whose cost is already accounted for
+    QBitArray nestedMatches(allFrames.size());
+
+    // the parents come before their children, so we can propagate the direct matches down in order
+    for (int i = 1, c = allFrames.size(); i < c; ++i) {
+        const auto parent = allFrames[i].parent;
+        const bool isNested = directMatches.testBit(parent) || nestedMatches.testBit(parent);
+        if (isNested) {
+            nestedMatches.setBit(i);
+        }
+        if (symbolMatches.testBit(allFrames[i].symbol)) {
+            directMatches.setBit(i);
+            if (!isNested) {
+                results->directCost += costs[i];
+            }
+        }
+    }
+
+    // and the matches up in reverse order
+    for (int i = allFrames.size() - 1; i > 0; --i) {
+        const auto parent = allFrames[i].parent;
+        if (!directMatches.testBit(parent) && (directMatches.testBit(i) || childMatches.testBit(i))) {
+            childMatches.setBit(parent);
+        }
+    }
 
-    KColorScheme scheme(QPalette::Active);
-    const QPen pen(scheme.foreground().color());
+    return true;
+}
 
-    QString label = i18n("%1 aggregated %2 cost in total", costs.formatCost(type, totalCost), costs.typeName(type));
-    auto rootItem = new FrameGraphicsItem(totalCost, costs.unit(type), {label, {}});
-    rootItem->setBrush(scheme.background());
-    rootItem->setPen(pen);
-    toGraphicsItems(costs, type, topDownData, rootItem, static_cast<double>(totalCost) * costThreshold / 100., collapseRecursion);
-    return rootItem;
+/**
+ * @return the symbol of @p index, the root frame is labeled with the total cost of @p type
+ */
+Data::Symbol frameSymbol(const FlameGraphFrames& frames, int type, int index)
+{
+    if (index == 0) {
+        return {frames.layouts[type].label, {}};
+    }
+    return frames.symbols[frames.frames[index].symbol];
 }
 
-struct SearchResults
+QString frameDescription(const FlameGraphFrames& frames, int type, int index)
 {
-    SearchMatchType matchType = NoMatch;
-    qint64 directCost = 0;
-};
+    // we build the tooltip text on demand, which is much faster than doing that for potentially thousands of items when
+    // we load the data
+    const auto& layout = frames.layouts[type];
+    const auto data = frameSymbol(frames, type, index);
+    const auto symbol = Util::formatSymbol(data);
+    if (index == 0) {
+        return symbol;
+    }
 
-SearchResults applySearch(FrameGraphicsItem* item, const QString& searchValue)
+    if (!layout.deltas.isEmpty()) {
+        const auto delta = layout.deltas[index];
+        return i18nc("%1: change of the aggregated sample costs, %2: relative number, %3: function label, %4: binary",
+                     "%1 (%2%) change of the aggregated sample costs in %3 (%4) and below.",
+                     Data::Costs::formatCost(layout.unit, delta),
+                     Util::formatCostRelative(delta, layout.deltas.first()), symbol, data.binary);
+    }
+
+    const auto cost = layout.costs[index];
+    return i18nc("%1: aggregated sample costs, %2: relative number, %3: function label, %4: binary",
+                 "%1 (%2%) aggregated sample costs in %3 (%4) and below.", Data::Costs::formatCost(layout.unit, cost),
+                 Util::formatCostRelative(cost, layout.costs.first()), symbol, data.binary);
+}
+}
+
+/**
+ * Paints the frames of a flame graph without creating any per-frame objects.
+ *
+ * Only the frames that intersect the exposed area and are wider than a pixel get painted. Since the children of every
+ * frame are known in order of descending cost, the narrow ones get skipped without looking at them.
+ */
+class FlameGraphView : public QWidget
 {
-    SearchResults result;
-    if (searchValue.isEmpty()) {
-        result.matchType = NoSearch;
-    } else if (item->symbol().symbol.contains(searchValue, Qt::CaseInsensitive)
-               || (searchValue == QLatin1String("??") && item->symbol().symbol.isEmpty())
-               || item->symbol().binary.contains(searchValue, Qt::CaseInsensitive)) {
-        result.directCost += item->cost();
-        result.matchType = DirectMatch;
+public:
+    explicit FlameGraphView(QWidget* parent = nullptr)
+        : QWidget(parent)
+    {
+        setMouseTracking(true);
+    }
+
+    // a null value shows a busy message
+    void setFrames(const QSharedPointer<const FlameGraphFrames>& frames)
+    {
+        m_frames = frames;
+        m_selectedFrame = 0;
+        m_hoveredFrame = -1;
+        m_directMatches.clear();
+        m_childMatches.clear();
+        if (m_frames && m_type >= m_frames->layouts.size()) {
+            m_type = 0;
+        }
+        clearTextCache();
+        updateThreshold();
+    }
+
+    // needs to be called when the formatting of the symbols changes
+    void clearTextCache()
+    {
+        m_symbolTexts.clear();
+        m_elidedTexts.clear();
+        if (m_frames) {
+            m_symbolTexts.resize(m_frames->symbols.size());
+            m_elidedTexts.resize(m_frames->frames.size());
+        }
+        m_minTextWidth = fontMetrics().averageCharWidth() * 6;
+        update();
+    }
+
+    const FlameGraphFrames* frames() const
+    {
+        return m_frames.data();
+    }
+
+    QSharedPointer<const FlameGraphFrames> sharedFrames() const
+    {
+        return m_frames;
+    }
+
+    void setCostType(int type)
+    {
+        m_type = m_frames && (type < 0 || type >= m_frames->layouts.size()) ? 0 : type;
+        if (m_frames) {
+            // only the label of the root frame depends on the cost type
+            m_symbolTexts[0].clear();
+            m_elidedTexts[0] = {};
+        }
+        updateThreshold();
+    }
+
+    int costType() const
+    {
+        return m_type;
+    }
+
+    // colors the frames by the value of @p metric instead of their symbol when it is valid
+    void setColorMetric(const Data::DerivedMetric& metric)
+    {
+        m_colorMetric = metric;
+        update();
+    }
+
+    // the children of frames with a relative cost below @p threshold percent are hidden
+    void setCostThreshold(double threshold)
+    {
+        m_threshold = threshold;
+        updateThreshold();
+    }
+
+    void setSelectedFrame(int frame)
+    {
+        m_selectedFrame = frame;
+        updateHeight();
+        update();
+    }
+
+    void setHoveredFrame(int frame)
+    {
+        if (frame != m_hoveredFrame) {
+            m_hoveredFrame = frame;
+            update();
+        }
+    }
+
+    // empty bit arrays disable the search highlighting
+    void setSearchMatches(const QBitArray& directMatches, const QBitArray& childMatches)
+    {
+        m_directMatches = directMatches;
+        m_childMatches = childMatches;
+        update();
+    }
+
+    // @return the index of the visible frame at @p pos or -1
+    int frameAt(const QPoint& pos) const
+    {
+        if (!m_frames || pos.y() >= height()) {
+            return -1;
+        }
+
+        const auto& frames = m_frames->frames;
+        const auto& offsets = layout().offsets;
+        const int depth = (height() - 1 - pos.y()) / rowStride();
+        if (depth >= m_frames->depthBegins.size() - 1) {
+            return -1;
+        }
+
+        int ret = -1;
+        if (depth <= frames[m_selectedFrame].depth) {
+            // one of the parents of the selected frame, which span the whole width
+            ret = m_selectedFrame;
+            while (frames[ret].depth > depth) {
+                ret = frames[ret].parent;
+            }
+        } else {
+            const auto selectedOffset = offsets[m_selectedFrame];
+            const auto offset = selectedOffset + (pos.x() - Padding) / scale();
+            if (offset < selectedOffset || offset >= selectedOffset + layout().costs[m_selectedFrame]) {
+                return -1;
+            }
+            const auto begin = offsets.begin() + m_frames->depthBegins[depth];
+            const auto end = offsets.begin() + m_frames->depthBegins[depth + 1];
+            auto it = std::upper_bound(begin, end, offset);
+            if (it == begin) {
+                return -1;
+            }
+            ret = static_cast<int>(std::distance(offsets.begin(), it)) - 1;
+            // frames without any cost of this type share their offset with the next one
+            while (ret > m_frames->depthBegins[depth] && layout().costs[ret] == 0 && offsets[ret - 1] == offsets[ret]) {
+                --ret;
+            }
+            if (offset >= offsets[ret] + layout().costs[ret] || !isFrameVisible(ret)) {
+                return -1;
+            }
+        }
+        return frameRect(ret).contains(pos) ? ret : -1;
     }
 
-    // recurse into the child items, we always need to update all items
-    for (auto* child : item->childItems()) {
-        auto* childFrame = static_cast<FrameGraphicsItem*>(child);
-        auto childMatch = applySearch(childFrame, searchValue);
-        if (result.matchType != DirectMatch
-            && (childMatch.matchType == DirectMatch || childMatch.matchType == ChildMatch)) {
-            result.matchType = ChildMatch;
-            result.directCost += childMatch.directCost;
+    QRectF frameRect(int index) const
+    {
+        const auto& frame = m_frames->frames[index];
+        const int y = height() - (frame.depth + 1) * rowStride();
+        if (frame.depth <= m_frames->frames[m_selectedFrame].depth) {
+            return QRectF(Padding, y, availableWidth(), rowHeight());
         }
+        const auto s = scale();
+        const auto& layout = this->layout();
+        return QRectF(Padding + (layout.offsets[index] - layout.offsets[m_selectedFrame]) * s, y,
+                      layout.costs[index] * s, rowHeight());
     }
 
-    item->setSearchMatchType(result.matchType);
-    return result;
+    void paintFrames(QPainter* painter, const QRect& exposed, bool exporting) const
+    {
+        if (!m_frames) {
+            return;
+        }
+
+        KColorScheme scheme(QPalette::Active);
+        const QPen pen(exporting ? QColor(Qt::black) : scheme.foreground().color());
+        auto dimmedColor = pen.color();
+        dimmedColor.setAlpha(125);
+        const QPen dimmedPen(dimmedColor);
+        const auto rootBrush = exporting ? QBrush(Qt::white) : scheme.background();
+
+        // the selected frame and its parents span the complete width
+        const auto& frames = m_frames->frames;
+        for (int i = m_selectedFrame; i != -1; i = frames[i].parent) {
+            const auto rect = frameRect(i);
+            if (rect.intersects(exposed)) {
+                paintFrame(painter, i, rect, i == 0 ? rootBrush : frameBrush(i), pen, dimmedPen);
+            }
+        }
+
+        // then paint all frames below the selected one which are wide enough to be seen
+        // the stack is reused to not allocate anything while painting
+        auto& stack = m_paintStack;
+        stack.clear();
+        stack.append(m_selectedFrame);
+        while (!stack.isEmpty()) {
+            const auto parent = stack.takeLast();
+            forEachVisibleChild(parent, [&](int child) {
+                const auto rect = frameRect(child);
+                if (rect.bottom() < exposed.top() || rect.right() < exposed.left() || rect.left() > exposed.right()) {
+                    // the children lie above this frame and within its horizontal range, so they aren't exposed either
+                    return;
+                }
+                if (rect.top() <= exposed.bottom()) {
+                    paintFrame(painter, child, rect, frameBrush(child), pen, dimmedPen);
+                }
+                stack.append(child);
+            });
+        }
+    }
+
+    /**
+     * Writes the frames as they are currently shown as SVG, without going through QPainter.
+     *
+     * Every frame references one of the shared fill classes instead of carrying its own style, and the runs of
+     * siblings which are too narrow to be painted get merged into a single frame. Thus the size of the output is
+     * bounded by the width of the view, no matter how many frames the graph has.
+     */
+    void writeSvg(QIODevice* device, const QString& title, const QString& description, bool interactive) const
+    {
+        if (!m_frames) {
+            return;
+        }
+
+        const auto& frames = m_frames->frames;
+        const auto& layout = this->layout();
+        const auto metrics = fontMetrics();
+        const auto fontSize = font().pixelSize() > 0 ? QString::number(font().pixelSize()) + QLatin1String("px")
+                                                     : QString::number(font().pointSizeF()) + QLatin1String("pt");
+
+        QTextStream stream(device);
+        stream.setCodec("UTF-8");
+        stream << "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n"
+               << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << width() << "\" height=\"" << height()
+               << "\" viewBox=\"0 0 " << width() << ' ' << height() << "\">\n"
+               << "<title>" << title.toHtmlEscaped() << "</title>\n"
+               << "<desc>" << description.toHtmlEscaped() << "</desc>\n"
+               << "<style>\n"
+               << "text { font-family: " << font().family().toHtmlEscaped() << "; font-size: " << fontSize
+               << "; dominant-baseline: central; pointer-events: none; }\n"
+               << ".r { fill: #ffffff; stroke: #000000; }\n"
+               << ".m { fill: #c0c0c0; fill-opacity: 0.5; }\n";
+        for (int i = 0; i < NumBrushes; ++i) {
+            const auto color = brushImpl(i, BrushType::Hot).color();
+            stream << ".c" << i << " { fill: " << color.name() << "; fill-opacity: " << color.alphaF() << "; }\n";
+        }
+        if (hasColorMetric()) {
+            for (int i = -1; i < NumMetricBrushes; ++i) {
+                const auto color = metricBrush(i).color();
+                stream << ".d" << (i + 1) << " { fill: " << color.name() << "; fill-opacity: " << color.alphaF()
+                       << "; }\n";
+            }
+        } else if (hasDeltas()) {
+            for (int i = 0; i < NumMetricBrushes; ++i) {
+                const auto color = deltaBrush(i).color();
+                stream << ".e" << i << " { fill: " << color.name() << "; fill-opacity: " << color.alphaF() << "; }\n";
+            }
+        }
+        if (interactive) {
+            stream << "g { cursor: pointer; }\n";
+        }
+        stream << "</style>\n";
+
+        const int margin = 4;
+        auto writeFrame = [&](const QRectF& rect, const QString& styleClass, const QString& tooltip,
+                              const QString& label, const QString& text) {
+            stream << "<g";
+            if (interactive) {
+                stream << " class=\"f\" data-l=\"" << label.toHtmlEscaped() << '"';
+            }
+            stream << "><title>" << tooltip.toHtmlEscaped() << "</title><rect class=\"" << styleClass << "\" x=\""
+                   << rect.x() << "\" y=\"" << rect.y() << "\" width=\"" << rect.width() << "\" height=\""
+                   << rect.height() << "\"/>";
+            if (!text.isEmpty()) {
+                stream << "<text x=\"" << rect.x() + margin << "\" y=\"" << rect.center().y() << "\">"
+                       << text.toHtmlEscaped() << "</text>";
+            }
+            stream << "</g>\n";
+        };
+        auto writeSymbolFrame = [&](int index, const QRectF& rect) {
+            const int textWidth = rect.width() - 2 * margin;
+            const auto text = textWidth < m_minTextWidth ? QString() : elidedText(index, textWidth);
+            auto styleClass = QStringLiteral("r");
+            if (index != 0 && hasColorMetric()) {
+                styleClass = QLatin1Char('d') + QString::number(metricBucket(index) + 1);
+            } else if (index != 0 && hasDeltas()) {
+                styleClass = QLatin1Char('e') + QString::number(deltaBucket(index));
+            } else if (index != 0) {
+                styleClass = QLatin1Char('c') + QString::number(frames[index].hash % NumBrushes);
+            }
+            writeFrame(rect, styleClass, frameDescription(*m_frames, m_type, index), symbolText(index), text);
+        };
+
+        for (int i = m_selectedFrame; i != -1; i = frames[i].parent) {
+            writeSymbolFrame(i, frameRect(i));
+        }
+
+        QVector<int> stack = {m_selectedFrame};
+        while (!stack.isEmpty()) {
+            const auto parent = stack.takeLast();
+            if (layout.costs[parent] <= m_thresholdCost) {
+                continue;
+            }
+
+            // walk the children in the order they are laid out, to find the adjacent ones that are too narrow
+            QRectF merged;
+            int numMerged = 0;
+            auto writeMerged = [&]() {
+                if (numMerged && merged.width() >= 1) {
+                    const auto text = i18np("%1 frame narrower than a pixel", "%1 frames narrower than a pixel",
+                                            numMerged);
+                    writeFrame(merged, QStringLiteral("m"), text, text, {});
+                }
+                merged = {};
+                numMerged = 0;
+            };
+            const auto& frame = frames[parent];
+            for (int child = frame.firstChild, c = frame.firstChild + frame.numChildren; child < c; ++child) {
+                if (!layout.costs[child]) {
+                    continue;
+                }
+                const auto rect = frameRect(child);
+                if (isWideEnough(child)) {
+                    writeMerged();
+                    writeSymbolFrame(child, rect);
+                    stack.append(child);
+                } else {
+                    merged = numMerged ? merged.united(rect) : rect;
+                    ++numMerged;
+                }
+            }
+            writeMerged();
+        }
+
+        if (interactive) {
+            // clicking a frame stretches it and the frames above it to the full width, clicking the root resets
+            stream << "<script><![CDATA[\n"
+                   << "var W = " << availableWidth() << ", P = " << Padding << ", M = " << margin
+                   << ", C = " << metrics.averageCharWidth() << ", frames = [];\n"
+                   << R"(function fit(label, width) {
+    var n = Math.floor(width / C);
+    return n >= label.length ? label : (n > 2 ? label.substr(0, n - 2) + '..' : '');
 }
+function zoom(f) {
+    var s = W / f.w;
+    frames.forEach(function(o) {
+        var x = 0, w = 0;
+        if (o.y > f.y && o.x <= f.x + 0.01 && o.x + o.w >= f.x + f.w - 0.01) {
+            x = P; w = W;
+        } else if (o.y <= f.y && o.x >= f.x - 0.01 && o.x + o.w <= f.x + f.w + 0.01) {
+            x = P + (o.x - f.x) * s; w = o.w * s;
+        }
+        o.g.style.display = w ? '' : 'none';
+        if (!w) return;
+        o.r.setAttribute('x', x);
+        o.r.setAttribute('width', w);
+        if (!o.t) {
+            o.t = document.createElementNS('http://www.w3.org/2000/svg', 'text');
+            o.t.setAttribute('y', o.y + o.r.getAttribute('height') / 2);
+            o.g.appendChild(o.t);
+        }
+        o.t.setAttribute('x', x + M);
+        o.t.textContent = fit(o.g.getAttribute('data-l'), w - 2 * M);
+    });
 }
+[].forEach.call(document.querySelectorAll('g.f'), function(g) {
+    var r = g.querySelector('rect');
+    var f = {g: g, r: r, t: g.querySelector('text'), x: +r.getAttribute('x'), y: +r.getAttribute('y'),
+             w: +r.getAttribute('width')};
+    frames.push(f);
+    g.onclick = function() { zoom(f); };
+});
+]]></script>
+)";
+        }
+        stream << "</svg>\n";
+    }
+
+protected:
+    void paintEvent(QPaintEvent* event) override
+    {
+        QPainter painter(this);
+        if (!m_frames) {
+            painter.drawText(rect(), Qt::AlignCenter, i18n("generating flame graph..."));
+            return;
+        }
+        paintFrames(&painter, event->rect(), false);
+    }
+
+    void changeEvent(QEvent* event) override
+    {
+        QWidget::changeEvent(event);
+        if (event->type() == QEvent::FontChange) {
+            clearTextCache();
+            updateHeight();
+        }
+    }
+
+    void resizeEvent(QResizeEvent* event) override
+    {
+        QWidget::resizeEvent(event);
+        if (event->size().width() != event->oldSize().width()) {
+            updateHeight();
+        }
+    }
+
+private:
+    static const int Padding = 8;
+    static const int RowMargin = 2;
+
+    const FlameGraphFrames::Layout& layout() const
+    {
+        return m_frames->layouts[m_type];
+    }
+
+    bool hasColorMetric() const
+    {
+        return m_colorMetric.isValid() && m_colorMetric.numerator < m_frames->layouts.size()
+            && m_colorMetric.denominator < m_frames->layouts.size();
+    }
+
+    // the bucket of the metric value of the frame at @p index relative to the value of the whole graph,
+    // or -1 when there is none. twice or half the overall value saturates the colors
+    int metricBucket(int index) const
+    {
+        const auto& numerator = m_frames->layouts[m_colorMetric.numerator].costs;
+        const auto& denominator = m_frames->layouts[m_colorMetric.denominator].costs;
+        const auto value = m_colorMetric.value(numerator[index], denominator[index]);
+        const auto total = m_colorMetric.value(numerator.first(), denominator.first());
+        if (std::isnan(value) || std::isnan(total) || total <= 0) {
+            return -1;
+        }
+        auto relative = value > 0 ? std::max(-1., std::min(1., std::log2(value / total))) : -1.;
+        if (!m_colorMetric.higherIsBetter) {
+            relative = -relative;
+        }
+        return qRound((relative + 1) / 2 * (NumMetricBrushes - 1));
+    }
+
+    bool hasDeltas() const
+    {
+        return !layout().deltas.isEmpty();
+    }
+
+    // the bucket of the cost change of the frame at @p index relative to all changes of the graph. the square root
+    // keeps the small changes visible, which would otherwise be indistinguishable from no change at all
+    int deltaBucket(int index) const
+    {
+        const auto& layout = this->layout();
+        const auto total = std::max(qint64(1), layout.costs.first());
+        const auto delta = layout.deltas[index];
+        const auto relative = std::min(1., std::sqrt(static_cast<double>(std::abs(delta)) / total));
+        return qRound(((delta < 0 ? -relative : relative) + 1) / 2 * (NumMetricBrushes - 1));
+    }
+
+    QBrush frameBrush(int index) const
+    {
+        if (hasColorMetric()) {
+            return metricBrush(metricBucket(index));
+        } else if (hasDeltas()) {
+            return deltaBrush(deltaBucket(index));
+        }
+        return brushImpl(m_frames->frames[index].hash, BrushType::Hot);
+    }
+
+    int rowHeight() const
+    {
+        return fontMetrics().height() + 4;
+    }
+
+    int rowStride() const
+    {
+        return rowHeight() + RowMargin;
+    }
+
+    qreal availableWidth() const
+    {
+        return std::max(1, width() - 2 * Padding);
+    }
+
+    // @return the width in pixels per cost, relative to the selected frame
+    qreal scale() const
+    {
+        return availableWidth() / std::max(qint64(1), layout().costs[m_selectedFrame]);
+    }
+
+    bool isWideEnough(int index) const
+    {
+        return layout().costs[index] * scale() > 1;
+    }
+
+    // the costs decrease towards the leaves, so it's enough to look at the direct parent
+    bool isFrameVisible(int index) const
+    {
+        const auto parent = m_frames->frames[index].parent;
+        return parent == -1 || (layout().costs[parent] > m_thresholdCost && isWideEnough(index));
+    }
+
+    template<typename Callback>
+    void forEachVisibleChild(int index, Callback callback) const
+    {
+        if (layout().costs[index] <= m_thresholdCost) {
+            return;
+        }
+
+        const auto& frame = m_frames->frames[index];
+        const auto& childrenByCost = layout().childrenByCost;
+        for (int i = frame.firstChild, c = frame.firstChild + frame.numChildren; i < c; ++i) {
+            const auto child = childrenByCost[i];
+            if (!isWideEnough(child)) {
+                // all remaining children are even smaller
+                break;
+            }
+            callback(child);
+        }
+    }
+
+    void updateThreshold()
+    {
+        m_thresholdCost = m_frames ? static_cast<double>(layout().costs.first()) * m_threshold / 100. : 0;
+        updateHeight();
+        update();
+    }
+
+    void updateHeight()
+    {
+        int maxDepth = 0;
+        if (m_frames) {
+            const auto& frames = m_frames->frames;
+            maxDepth = frames[m_selectedFrame].depth;
+            QVector<int> stack = {m_selectedFrame};
+            while (!stack.isEmpty()) {
+                forEachVisibleChild(stack.takeLast(), [&](int child) {
+                    maxDepth = std::max(maxDepth, frames[child].depth);
+                    stack.append(child);
+                });
+            }
+        }
+        setMinimumHeight((maxDepth + 1) * rowStride());
+    }
+
+    SearchMatchType searchMatchType(int index) const
+    {
+        if (m_directMatches.isEmpty()) {
+            return NoSearch;
+        } else if (m_directMatches.testBit(index)) {
+            return DirectMatch;
+        } else if (m_childMatches.testBit(index)) {
+            return ChildMatch;
+        }
+        return NoMatch;
+    }
+
+    void paintFrame(QPainter* painter, int index, const QRectF& rect, const QBrush& brush, const QPen& pen,
+                    const QPen& dimmedPen) const
+    {
+        const auto searchMatch = searchMatchType(index);
+        const bool isSelected = index == m_selectedFrame && index != 0;
+
+        if (isSelected || index == m_hoveredFrame || searchMatch == DirectMatch) {
+            auto selectedColor = brush.color();
+            selectedColor.setAlpha(255);
+            painter->fillRect(rect, selectedColor);
+        } else if (searchMatch == NoMatch) {
+            auto noMatchColor = brush.color();
+            noMatchColor.setAlpha(50);
+            painter->fillRect(rect, noMatchColor);
+        } else { // default, when no search is running, or a sub-item is matched
+            painter->fillRect(rect, brush);
+        }
+
+        if (searchMatch != NoMatch) {
+            auto outlinePen = pen;
+            outlinePen.setColor(brush.color());
+            if (isSelected) {
+                outlinePen.setWidth(2);
+            }
+            painter->setPen(outlinePen);
+            painter->setBrush({});
+            painter->drawRect(rect);
+        }
+
+        const int margin = 4;
+        const int width = rect.width() - 2 * margin;
+        if (width < m_minTextWidth) {
+            // text is too wide for the current LOD, don't paint it
+            return;
+        }
+
+        painter->setPen(searchMatch == NoMatch ? dimmedPen : pen);
+        painter->drawText(QRectF(margin + rect.x(), rect.y(), width, rect.height()),
+                          Qt::AlignVCenter | Qt::AlignLeft | Qt::TextSingleLine, elidedText(index, width));
+    }
+
+    const QString& symbolText(int index) const
+    {
+        const auto symbolId = m_frames->frames[index].symbol;
+        auto& text = m_symbolTexts[symbolId];
+        if (text.isNull()) {
+            const auto data = frameSymbol(*m_frames, m_type, index);
+            const auto symbol = Util::formatSymbol(data, false);
+            text = symbol.isEmpty() ? QObject::tr("?? [%1]").arg(Util::formatString(data.binary)) : symbol;
+        }
+        return text;
+    }
+
+    // the texts only get elided again when the width of a frame changes
+    const QString& elidedText(int index, int width) const
+    {
+        auto& text = m_elidedTexts[index];
+        if (text.width != width) {
+            text.width = width;
+            text.text = fontMetrics().elidedText(symbolText(index), Qt::ElideRight, width);
+        }
+        return text.text;
+    }
+
+    struct ElidedText
+    {
+        int width = -1;
+        QString text;
+    };
+
+    QSharedPointer<const FlameGraphFrames> m_frames;
+    QBitArray m_directMatches;
+    QBitArray m_childMatches;
+    // the formatted text of every unique symbol
+    mutable QVector<QString> m_symbolTexts;
+    // the elided text of every frame, with the width it was elided for
+    mutable QVector<ElidedText> m_elidedTexts;
+    mutable QVector<int> m_paintStack;
+    int m_minTextWidth = 0;
+    int m_type = 0;
+    Data::DerivedMetric m_colorMetric;
+    double m_threshold = 0;
+    double m_thresholdCost = 0;
+    int m_selectedFrame = 0;
+    int m_hoveredFrame = -1;
+};
 
 FlameGraph::FlameGraph(QWidget* parent, Qt::WindowFlags flags)
     : QWidget(parent, flags)
     , m_costSource(new QComboBox(this))
-    , m_scene(new QGraphicsScene(this))
-    , m_view(new QGraphicsView(this))
+    , m_colorSource(new QComboBox(this))
+    , m_scrollArea(new QScrollArea(this))
+    , m_view(new FlameGraphView(m_scrollArea))
     , m_displayLabel(new QLabel)
     , m_searchResultsLabel(new QLabel)
+    , m_searchTimer(new QTimer(this))
 {
-    qRegisterMetaType<FrameGraphicsItem*>();
+    qRegisterMetaType<FlameGraphFrames*>();
+    qRegisterMetaType<FlameGraphSearchResults*>();
 
     m_costSource->setToolTip(i18n("Select the data source that should be visualized in the flame graph."));
+    m_colorSource->setToolTip(i18n("Select how the frames get colored. The derived metrics color them from red to "
+                                   "green, depending on how they compare to the value of the whole graph."));
+    m_colorSource->addItem(i18n("Color by Symbol"), -1);
+    // only shown once any metric can be derived from the recorded events
+    m_colorSource->hide();
+    connect(m_colorSource, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this,
+            [this](int index) {
+                const auto metric = m_colorSource->itemData(index).toInt();
+                m_view->setColorMetric(m_colorMetrics.value(metric));
+            });
 
     connect(Settings::instance(), &Settings::prettifySymbolsChanged, this, [this]() {
-        m_scene->update(m_scene->sceneRect());
+        m_view->clearTextCache();
         updateTooltip();
     });
 
-    m_scene->setItemIndexMethod(QGraphicsScene::NoIndex);
-    m_view->setScene(m_scene);
-    m_view->viewport()->installEventFilter(this);
-    m_view->viewport()->setMouseTracking(true);
+    m_view->installEventFilter(this);
+    m_view->setCostThreshold(m_costThreshold);
     m_view->setFont(QFont(QStringLiteral("monospace")));
+    m_scrollArea->setWidget(m_view);
+    m_scrollArea->setWidgetResizable(true);
+    // always reserve space for the scroll bar, otherwise it could toggle whenever the height changes with the width
+    m_scrollArea->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
+    m_scrollArea->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
 
     m_backButton = new QPushButton(this);
     m_backButton->setIcon(QIcon::fromTheme(QStringLiteral("go-previous")));
@@ -434,18 +1217,12 @@ FlameGraph::FlameGraph(QWidget* parent, Qt::WindowFlags flags)
         showData();
     });
 
-    auto collapseRecursionCheckbox = new QCheckBox(i18n("Collapse Recursion"), this);
-    connect(this, &FlameGraph::uiResetRequested, collapseRecursionCheckbox, [collapseRecursionCheckbox](){
-        collapseRecursionCheckbox->setChecked(false);
-    });
-    collapseRecursionCheckbox->setChecked(m_collapseRecursion);
-    collapseRecursionCheckbox->setToolTip(
+    // the recursions get collapsed while aggregating the events, which applies to all views, see setFilterStack
+    m_collapseRecursionCheckbox = new QCheckBox(i18n("Collapse Recursion"), this);
+    m_collapseRecursionCheckbox->setToolTip(
         i18n("Collapse stack frames for functions calling themselves. "
              "When this is unchecked, recursive frames will be visualized separately."));
-    connect(collapseRecursionCheckbox, &QCheckBox::toggled, this, [this, collapseRecursionCheckbox] {
-        m_collapseRecursion = collapseRecursionCheckbox->isChecked();
-        showData();
-    });
+    m_collapseRecursionCheckbox->setEnabled(false);
 
     auto costThreshold = new QDoubleSpinBox(this);
     costThreshold->setDecimals(2);
@@ -461,19 +1238,25 @@ FlameGraph::FlameGraph(QWidget* parent, Qt::WindowFlags flags)
     costThreshold->setToolTip(
         i18n("<qt>The cost threshold defines a fractional cut-off value. "
              "Items with a relative cost below this value will not be shown in the flame graph. "
-             "This is done as an optimization to quickly generate graphs for large data sets with "
-             "low memory overhead. If you need more details, decrease the threshold value, or set it to zero.</qt>"));
+             "If you need more details, decrease the threshold value, or set it to zero.</qt>"));
     connect(costThreshold, static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged), this,
             [this](double threshold) {
                 m_costThreshold = threshold;
-                showData();
+                m_view->setCostThreshold(threshold);
+                if (m_view->frames()) {
+                    selectFrame(m_selectionHistory.at(m_selectedItem));
+                }
             });
 
     m_searchInput = new QLineEdit(this);
     m_searchInput->setPlaceholderText(i18n("Search..."));
     m_searchInput->setToolTip(i18n("<qt>Search the flame graph for a symbol.</qt>"));
     m_searchInput->setClearButtonEnabled(true);
-    connect(m_searchInput, &QLineEdit::textChanged, this, &FlameGraph::setSearchValue);
+    // wait for the user to stop typing before searching, the search itself runs in the background
+    m_searchTimer->setSingleShot(true);
+    m_searchTimer->setInterval(150);
+    connect(m_searchTimer, &QTimer::timeout, this, &FlameGraph::startSearch);
+    connect(m_searchInput, &QLineEdit::textChanged, m_searchTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
     connect(this, &FlameGraph::uiResetRequested, this, [this](){
         m_searchInput->clear();
     });
@@ -483,8 +1266,9 @@ FlameGraph::FlameGraph(QWidget* parent, Qt::WindowFlags flags)
     controls->layout()->addWidget(m_backButton);
     controls->layout()->addWidget(m_forwardButton);
     controls->layout()->addWidget(m_costSource);
+    controls->layout()->addWidget(m_colorSource);
     controls->layout()->addWidget(bottomUpCheckbox);
-    controls->layout()->addWidget(collapseRecursionCheckbox);
+    controls->layout()->addWidget(m_collapseRecursionCheckbox);
     controls->layout()->addWidget(costThreshold);
     controls->layout()->addWidget(m_searchInput);
 
@@ -498,7 +1282,7 @@ FlameGraph::FlameGraph(QWidget* parent, Qt::WindowFlags flags)
 
     setLayout(new QVBoxLayout);
     layout()->addWidget(controls);
-    layout()->addWidget(m_view);
+    layout()->addWidget(m_scrollArea);
     layout()->addWidget(m_displayLabel);
     layout()->addWidget(m_searchResultsLabel);
 
@@ -512,7 +1296,7 @@ FlameGraph::FlameGraph(QWidget* parent, Qt::WindowFlags flags)
 
     m_resetAction = new QAction(QIcon::fromTheme(QStringLiteral("go-first")), tr("Reset View"), this);
     m_resetAction->setShortcut(Qt::Key_Escape);
-    connect(m_resetAction, &QAction::triggered, this, [this]() { selectItem(0); });
+    connect(m_resetAction, &QAction::triggered, this, [this]() { selectHistoryEntry(0); });
     addAction(m_resetAction);
     updateNavigationActions();
 }
@@ -522,6 +1306,12 @@ FlameGraph::~FlameGraph() = default;
 void FlameGraph::setFilterStack(FilterAndZoomStack* filterStack)
 {
     m_filterStack = filterStack;
+
+    auto* action = filterStack->actions().collapseRecursion;
+    m_collapseRecursionCheckbox->setEnabled(true);
+    m_collapseRecursionCheckbox->setChecked(action->isChecked());
+    connect(m_collapseRecursionCheckbox, &QCheckBox::toggled, action, &QAction::setChecked);
+    connect(action, &QAction::toggled, m_collapseRecursionCheckbox, &QCheckBox::setChecked);
 }
 
 bool FlameGraph::eventFilter(QObject* object, QEvent* event)
@@ -531,14 +1321,14 @@ bool FlameGraph::eventFilter(QObject* object, QEvent* event)
     if (event->type() == QEvent::MouseButtonRelease) {
         QMouseEvent* mouseEvent = static_cast<QMouseEvent*>(event);
         if (mouseEvent->button() == Qt::LeftButton) {
-            auto item = static_cast<FrameGraphicsItem*>(m_view->itemAt(mouseEvent->pos()));
-            if (item && item != m_selectionHistory.at(m_selectedItem)) {
-                selectItem(item);
+            const auto frame = m_view->frameAt(mouseEvent->pos());
+            if (frame != -1 && frame != m_selectionHistory.at(m_selectedItem)) {
+                selectFrame(frame);
                 if (m_selectedItem != m_selectionHistory.size() - 1) {
                     m_selectionHistory.remove(m_selectedItem + 1, m_selectionHistory.size() - m_selectedItem - 1);
                 }
                 m_selectedItem = m_selectionHistory.size();
-                m_selectionHistory.push_back(item);
+                m_selectionHistory.push_back(frame);
                 updateNavigationActions();
             }
         } else if (mouseEvent->button() == Qt::BackButton) {
@@ -548,32 +1338,32 @@ bool FlameGraph::eventFilter(QObject* object, QEvent* event)
         }
     } else if (event->type() == QEvent::MouseMove) {
         QMouseEvent* mouseEvent = static_cast<QMouseEvent*>(event);
-        auto item = static_cast<FrameGraphicsItem*>(m_view->itemAt(mouseEvent->pos()));
-        setTooltipItem(item);
+        const auto frame = m_view->frameAt(mouseEvent->pos());
+        m_view->setHoveredFrame(frame);
+        setTooltipFrame(frame);
     } else if (event->type() == QEvent::Leave) {
-        setTooltipItem(nullptr);
+        m_view->setHoveredFrame(-1);
+        setTooltipFrame(-1);
     } else if (event->type() == QEvent::Resize || event->type() == QEvent::Show) {
-        if (!m_rootItem) {
-            if (!m_buildingScene) {
-                showData();
-            }
-        } else {
-            selectItem(m_selectionHistory.at(m_selectedItem));
+        if (!m_view->frames()) {
+            showData();
         }
         updateTooltip();
     } else if (event->type() == QEvent::ContextMenu) {
         QContextMenuEvent* contextEvent = static_cast<QContextMenuEvent*>(event);
-        auto item = static_cast<FrameGraphicsItem*>(m_view->itemAt(m_view->mapFromGlobal(contextEvent->globalPos())));
+        const auto frame = m_view->frameAt(contextEvent->pos());
+        const auto* frames = m_view->frames();
+        const auto symbol = frame > 0 ? frames->symbols[frames->frames[frame].symbol] : Data::Symbol();
 
         QMenu contextMenu;
-        if (item) {
+        if (frame > 0) {
             auto* viewCallerCallee = contextMenu.addAction(tr("View Caller/Callee"));
-            connect(viewCallerCallee, &QAction::triggered, this, [this, item](){
-                emit jumpToCallerCallee(item->symbol());
+            connect(viewCallerCallee, &QAction::triggered, this, [this, symbol](){
+                emit jumpToCallerCallee(symbol);
             });
             contextMenu.addSeparator();
         }
-        ResultsUtil::addFilterActions(&contextMenu, item ? item->symbol() : Data::Symbol(), m_filterStack);
+        ResultsUtil::addFilterActions(&contextMenu, symbol, m_filterStack);
         contextMenu.addSeparator();
         contextMenu.addActions(actions());
 
@@ -596,23 +1386,40 @@ bool FlameGraph::eventFilter(QObject* object, QEvent* event)
 void FlameGraph::setTopDownData(const Data::TopDownResults& topDownData)
 {
     m_topDownData = topDownData;
+    clearFrames(false);
 
     if (isVisible()) {
         showData();
-    } else {
-        setData(nullptr);
     }
 }
 
 void FlameGraph::setBottomUpData(const Data::BottomUpResults& bottomUpData)
 {
     m_bottomUpData = bottomUpData;
+    clearFrames(true);
 
     disconnect(m_costSource, nullptr, this, nullptr);
     ResultsUtil::fillEventSourceComboBox(m_costSource, bottomUpData.costs,
                                          ki18n("Show a flame graph over the aggregated %1 sample costs."));
     connect(m_costSource, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this,
-            &FlameGraph::showData);
+            &FlameGraph::showCostType);
+
+    // the metrics are computed from the costs of the frames, which share the types of the bottom up data
+    const auto oldMetric = m_colorSource->currentText();
+    m_colorMetrics = Data::derivedMetrics(bottomUpData.costs);
+    {
+        const QSignalBlocker blocker(m_colorSource);
+        while (m_colorSource->count() > 1) {
+            m_colorSource->removeItem(1);
+        }
+        for (int i = 0, c = m_colorMetrics.size(); i < c; ++i) {
+            m_colorSource->addItem(i18n("Color by %1", m_colorMetrics[i].name), i);
+            m_colorSource->setItemData(i + 1, m_colorMetrics[i].formula, Qt::ToolTipRole);
+        }
+        m_colorSource->setCurrentIndex(std::max(0, m_colorSource->findText(oldMetric)));
+    }
+    m_colorSource->setVisible(!m_colorMetrics.isEmpty());
+    m_view->setColorMetric(m_colorMetrics.value(m_colorSource->currentData().toInt()));
 }
 
 void FlameGraph::clear()
@@ -622,46 +1429,32 @@ void FlameGraph::clear()
 
 QImage FlameGraph::toImage() const
 {
-    if (!m_rootItem)
+    if (!m_view->frames())
         return {};
 
-    const auto sceneRect = m_scene->sceneRect();
-    QImage image(sceneRect.size().toSize(), QImage::Format_ARGB32_Premultiplied);
+    QImage image(m_view->size(), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
     QPainter painter(&image);
-    m_scene->render(&painter, {{0, 0}, sceneRect.size()}, sceneRect);
+    painter.setFont(m_view->font());
+    m_view->paintFrames(&painter, m_view->rect(), false);
     return image;
 }
 
-void FlameGraph::saveSvg(const QString &fileName) const
+bool FlameGraph::saveSvg(const QString& fileName, bool interactive) const
 {
-    if (!m_rootItem)
-        return;
+    if (!m_view->frames())
+        return false;
 
-    const auto sceneRect = m_scene->sceneRect();
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
 
-    QSvgGenerator generator;
-    generator.setSize(sceneRect.size().toSize());
-    generator.setViewBox({{0, 0}, sceneRect.size()});
-    generator.setFileName(fileName);
-    if (m_showBottomUpData)
-        generator.setTitle(tr("Bottom Up FlameGraph"));
-    else
-        generator.setTitle(tr("Top Down FlameGraph"));
+    const auto title = m_showBottomUpData ? tr("Bottom Up FlameGraph") : tr("Top Down FlameGraph");
     const auto costType = m_bottomUpData.costs.typeName(m_costSource->currentData().value<int>());
-    generator.setDescription(tr("Cost type: %1, cost threshold: %2\n%3")
-                                .arg(costType, QString::number(m_costThreshold),
-                                     m_displayLabel->text()));
-
-    const auto oldPen = m_rootItem->pen();
-    const auto oldBrush = m_rootItem->brush();
-    m_rootItem->setPen(QPen(Qt::black));
-    m_rootItem->setBrush(QBrush(Qt::white));
-
-    QPainter painter(&generator);
-    m_scene->render(&painter, generator.viewBoxF(), sceneRect);
-
-    m_rootItem->setPen(oldPen);
-    m_rootItem->setBrush(oldBrush);
+    const auto description = tr("Cost type: %1, cost threshold: %2\n%3")
+                                 .arg(costType, QString::number(m_costThreshold), m_displayLabel->text());
+    m_view->writeSvg(&file, title, description, interactive);
+    return file.error() == QFileDevice::NoError;
 }
 
 void FlameGraph::showData()
@@ -673,152 +1466,207 @@ void FlameGraph::showData()
         return;
     }
 
-    setData(nullptr);
+    const auto& frames = m_frames[showBottomUpData];
+    if (frames) {
+        // the frames contain the layouts of all cost types, without any threshold applied
+        showFrames(frames);
+        return;
+    }
+
+    showFrames({});
+    updateNavigationActions();
+    if (m_buildingScene[showBottomUpData]) {
+        return;
+    }
 
-    m_buildingScene = true;
-    using namespace ThreadWeaver;
+    m_buildingScene[showBottomUpData] = true;
     auto bottomUpData = m_bottomUpData;
     auto topDownData = m_topDownData;
-    bool collapseRecursion = m_collapseRecursion;
-    auto type = m_costSource->currentData().value<int>();
-    auto threshold = m_costThreshold;
-    stream() << make_job([showBottomUpData, bottomUpData, topDownData, type, threshold, collapseRecursion, this]() {
-        FrameGraphicsItem* parsedData = nullptr;
+    const auto buildFrames = [showBottomUpData, bottomUpData, topDownData, this](const JobScheduler::Token& token) {
+        Instrumentation::ScopedTimer instrumentation("FlameGraph::showData");
+        auto isCanceled = [&token]() { return token.isCanceled(); };
+        FlameGraphFrames* parsedData = nullptr;
         if (showBottomUpData) {
-            parsedData = parseData(bottomUpData.costs, type, bottomUpData.root.children, threshold, collapseRecursion);
+            parsedData = parseData(bottomUpData.costs, bottomUpData.root.children, isCanceled);
         } else {
-            parsedData =
-                parseData(topDownData.inclusiveCosts, type, topDownData.root.children, threshold, collapseRecursion);
+            parsedData = parseData(topDownData.inclusiveCosts, topDownData.root.children, isCanceled);
         }
-        QMetaObject::invokeMethod(this, "setData", Qt::QueuedConnection, Q_ARG(FrameGraphicsItem*, parsedData));
-    });
-    updateNavigationActions();
+        if (!parsedData || token.isCanceled()) {
+            // the data changed in the meantime
+            delete parsedData;
+            return;
+        }
+        parsedData->generation = token.generation();
+        parsedData->bottomUp = showBottomUpData;
+        QMetaObject::invokeMethod(this, "setData", Qt::QueuedConnection, Q_ARG(FlameGraphFrames*, parsedData));
+    };
+    // the frames get built for the view that is shown or about to be shown
+    m_buildJobs[showBottomUpData].schedule(JobScheduler::Priority::Visible, buildFrames);
+}
+
+void FlameGraph::showCostType()
+{
+    if (m_view->frames()) {
+        m_view->setCostType(m_costSource->currentData().value<int>());
+        startSearch();
+        selectFrame(m_selectionHistory.at(m_selectedItem));
+    } else {
+        showData();
+    }
+}
+
+void FlameGraph::clearFrames(bool bottomUp)
+{
+    m_buildJobs[bottomUp].cancel();
+    m_frames[bottomUp].reset();
+    m_buildingScene[bottomUp] = false;
+    if (bottomUp == m_showBottomUpData) {
+        showFrames({});
+    }
 }
 
-void FlameGraph::setTooltipItem(const FrameGraphicsItem* item)
+void FlameGraph::setTooltipFrame(int frame)
 {
-    if (!item && m_selectedItem != -1 && m_selectionHistory.at(m_selectedItem)) {
-        item = m_selectionHistory.at(m_selectedItem);
+    if (frame == -1 && m_selectedItem != -1 && m_view->frames()) {
+        frame = m_selectionHistory.at(m_selectedItem);
         m_view->setCursor(Qt::ArrowCursor);
     } else {
         m_view->setCursor(Qt::PointingHandCursor);
     }
-    m_tooltipItem = item;
+    m_tooltipFrame = frame;
     updateTooltip();
 }
 
 void FlameGraph::updateTooltip()
 {
-    const auto text = m_tooltipItem ? m_tooltipItem->description() : QString();
+    const auto* frames = m_view->frames();
+    const auto text =
+        frames && m_tooltipFrame != -1 ? frameDescription(*frames, m_view->costType(), m_tooltipFrame) : QString();
     m_displayLabel->setToolTip(text);
     const auto metrics = m_displayLabel->fontMetrics();
     m_displayLabel->setText(metrics.elidedText(text, Qt::ElideRight, m_displayLabel->width()));
 }
 
-void FlameGraph::setData(FrameGraphicsItem* rootItem)
+void FlameGraph::setData(FlameGraphFrames* frames)
 {
-    m_scene->clear();
-    m_buildingScene = false;
-    m_tooltipItem = nullptr;
-    m_rootItem = rootItem;
+    QSharedPointer<const FlameGraphFrames> sharedFrames(frames);
+    if (!m_buildJobs[frames->bottomUp].isCurrent(frames->generation)) {
+        // the data changed while these frames got built
+        return;
+    }
+
+    m_buildingScene[frames->bottomUp] = false;
+    m_frames[frames->bottomUp] = sharedFrames;
+    if (frames->bottomUp == m_showBottomUpData) {
+        showFrames(sharedFrames);
+    }
+}
+
+void FlameGraph::showFrames(const QSharedPointer<const FlameGraphFrames>& frames)
+{
+    m_tooltipFrame = -1;
+    m_view->setFrames(frames);
     m_selectionHistory.clear();
-    m_selectionHistory.push_back(rootItem);
+    m_selectionHistory.push_back(0);
     m_selectedItem = 0;
-    if (!rootItem) {
-        auto text = m_scene->addText(i18n("generating flame graph..."));
-        m_view->centerOn(text);
+    if (!frames) {
         m_view->setCursor(Qt::BusyCursor);
+        updateTooltip();
         return;
     }
 
     m_view->setCursor(Qt::ArrowCursor);
-    // layouting needs a root item with a given height, the rest will be overwritten later
-    rootItem->setRect(0, 0, 800, m_view->fontMetrics().height() + 4);
-    m_scene->addItem(rootItem);
-
-    if (!m_searchInput->text().isEmpty()) {
-        setSearchValue(m_searchInput->text());
-    }
+    m_view->setCostType(m_costSource->currentData().value<int>());
+    startSearch();
 
-    if (isVisible()) {
-        selectItem(m_rootItem);
-    }
+    selectFrame(0);
+    updateNavigationActions();
 }
 
-void FlameGraph::selectItem(int item)
+void FlameGraph::selectHistoryEntry(int item)
 {
     m_selectedItem = item;
     updateNavigationActions();
-    selectItem(m_selectionHistory.at(m_selectedItem));
+    selectFrame(m_selectionHistory.at(m_selectedItem));
 }
 
-void FlameGraph::selectItem(FrameGraphicsItem* item)
+void FlameGraph::selectFrame(int frame)
 {
-    if (!item) {
+    if (!m_view->frames()) {
         return;
     }
 
-    // scale item and its parents to the maximum available width
-    // also hide all siblings of the parent items
-    const auto padding = 8;
-    const auto rootWidth = m_view->viewport()->width() - padding * 2
-        - (m_view->verticalScrollBar()->isVisible() ? 0 : m_view->verticalScrollBar()->sizeHint().width());
-    auto parent = item;
-    while (parent) {
-        auto rect = parent->rect();
-        rect.setLeft(0);
-        rect.setWidth(rootWidth);
-        parent->setRect(rect);
-        if (parent->parentItem()) {
-            foreach (auto sibling, parent->parentItem()->childItems()) {
-                sibling->setVisible(sibling == parent);
-            }
-        }
-        parent = static_cast<FrameGraphicsItem*>(parent->parentItem());
-    }
+    // the selected frame and its parents span the complete width, the frames below it are scaled accordingly
+    m_view->setSelectedFrame(frame);
 
-    // then layout all items below the selected on
-    layoutItems(item);
+    // and make sure it's visible, resizing right away updates the scroll range
+    const auto viewport = m_scrollArea->viewport();
+    m_view->resize(viewport->width(), std::max(m_view->minimumHeight(), viewport->height()));
+    const auto center = m_view->frameRect(frame).center().toPoint();
+    m_scrollArea->ensureVisible(center.x(), center.y(), 0, viewport->height() / 2);
 
-    // Triggers a refresh of the scene's bounding rect without going via the
-    // event loop. This makes the centerOn call below work as expected in all cases.
-    m_scene->sceneRect();
+    setTooltipFrame(frame);
+}
 
-    // and make sure it's visible
-    m_view->centerOn(item);
+void FlameGraph::startSearch()
+{
+    m_searchTimer->stop();
+    // cancel any search that is still running
+    m_searchJobs.cancel();
+
+    const auto frames = m_view->sharedFrames();
+    const auto value = m_searchInput->text();
+    if (!frames || value.isEmpty()) {
+        m_view->setSearchMatches({}, {});
+        m_searchResultsLabel->hide();
+        return;
+    }
 
-    setTooltipItem(item);
+    const auto type = m_view->costType();
+    const auto search = [frames, type, value, this](const JobScheduler::Token& token) {
+        auto isCanceled = [&token]() { return token.isCanceled(); };
+        auto* results = new FlameGraphSearchResults;
+        results->generation = token.generation();
+        if (!applySearch(*frames, type, value, isCanceled, results)) {
+            delete results;
+            return;
+        }
+        QMetaObject::invokeMethod(this, "setSearchResults", Qt::QueuedConnection,
+                                  Q_ARG(FlameGraphSearchResults*, results));
+    };
+    m_searchJobs.schedule(JobScheduler::Priority::Visible, search);
 }
 
-void FlameGraph::setSearchValue(const QString& value)
+void FlameGraph::setSearchResults(FlameGraphSearchResults* results)
 {
-    if (!m_rootItem) {
+    QScopedPointer<FlameGraphSearchResults> cleanup(results);
+    const auto* frames = m_view->frames();
+    if (!frames || !m_searchJobs.isCurrent(results->generation)) {
+        // the search value, cost type or frames changed in the meantime
         return;
     }
 
-    auto match = applySearch(m_rootItem, value);
+    m_view->setSearchMatches(results->directMatches, results->childMatches);
 
-    if (value.isEmpty()) {
-        m_searchResultsLabel->hide();
-    } else {
-        m_searchResultsLabel->setText(
-            i18n("%1 (%2% of total of %3) aggregated costs matched by search.", Util::formatCost(match.directCost),
-                 Util::formatCostRelative(match.directCost, m_rootItem->cost()), m_rootItem->cost()));
-        m_searchResultsLabel->show();
-    }
+    const auto directCost = results->directCost;
+    const auto totalCost = frames->layouts[m_view->costType()].costs.first();
+    m_searchResultsLabel->setText(i18n("%1 (%2% of total of %3) aggregated costs matched by search.",
+                                       Util::formatCost(directCost), Util::formatCostRelative(directCost, totalCost),
+                                       totalCost));
+    m_searchResultsLabel->show();
 }
 
 void FlameGraph::navigateBack()
 {
     if (m_selectedItem > 0) {
-        selectItem(m_selectedItem - 1);
+        selectHistoryEntry(m_selectedItem - 1);
     }
 }
 
 void FlameGraph::navigateForward()
 {
     if ((m_selectedItem + 1) < m_selectionHistory.size()) {
-        selectItem(m_selectedItem + 1);
+        selectHistoryEntry(m_selectedItem + 1);
     }
 }
 
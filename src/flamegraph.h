@@ -28,19 +28,24 @@
 #ifndef FLAMEGRAPH_H
 #define FLAMEGRAPH_H
 
+#include <QSharedPointer>
 #include <QVector>
 #include <QWidget>
 
 #include <models/data.h>
+#include <models/jobscheduler.h>
 
-class QGraphicsScene;
-class QGraphicsView;
+class QCheckBox;
 class QComboBox;
 class QLabel;
 class QLineEdit;
 class QPushButton;
+class QScrollArea;
+class QTimer;
 
-class FrameGraphicsItem;
+struct FlameGraphFrames;
+struct FlameGraphSearchResults;
+class FlameGraphView;
 class FilterAndZoomStack;
 
 class FlameGraph : public QWidget
@@ -56,14 +61,15 @@ public:
     void clear();
 
     QImage toImage() const;
-    void saveSvg(const QString &fileName) const;
+    // @p interactive adds a script which zooms into frames when clicking them in a browser
+    bool saveSvg(const QString& fileName, bool interactive) const;
 
 protected:
     bool eventFilter(QObject* object, QEvent* event) override;
 
 private slots:
-    void setData(FrameGraphicsItem* rootItem);
-    void setSearchValue(const QString& value);
+    void setData(FlameGraphFrames* frames);
+    void setSearchResults(FlameGraphSearchResults* results);
     void navigateBack();
     void navigateForward();
 
@@ -72,11 +78,15 @@ signals:
     void uiResetRequested();
 
 private:
-    void setTooltipItem(const FrameGraphicsItem* item);
+    void setTooltipFrame(int frame);
     void updateTooltip();
     void showData();
-    void selectItem(int item);
-    void selectItem(FrameGraphicsItem* item);
+    void startSearch();
+    void showCostType();
+    void showFrames(const QSharedPointer<const FlameGraphFrames>& frames);
+    void clearFrames(bool bottomUp);
+    void selectHistoryEntry(int item);
+    void selectFrame(int frame);
     void updateNavigationActions();
 
     Data::TopDownResults m_topDownData;
@@ -84,24 +94,34 @@ private:
 
     FilterAndZoomStack* m_filterStack = nullptr;
     QComboBox* m_costSource;
-    QGraphicsScene* m_scene;
-    QGraphicsView* m_view;
+    QComboBox* m_colorSource;
+    QVector<Data::DerivedMetric> m_colorMetrics;
+    QScrollArea* m_scrollArea;
+    FlameGraphView* m_view;
     QLabel* m_displayLabel;
     QLabel* m_searchResultsLabel;
     QLineEdit* m_searchInput = nullptr;
+    QTimer* m_searchTimer;
+    // every search supersedes the previous one, allowing outdated searches to stop early
+    JobScheduler m_searchJobs;
     QAction* m_forwardAction = nullptr;
     QAction* m_backAction = nullptr;
     QAction* m_resetAction = nullptr;
     QPushButton* m_backButton = nullptr;
     QPushButton* m_forwardButton = nullptr;
-    const FrameGraphicsItem* m_tooltipItem = nullptr;
-    FrameGraphicsItem* m_rootItem = nullptr;
-    QVector<FrameGraphicsItem*> m_selectionHistory;
+    // the index of the frame shown in the display label
+    int m_tooltipFrame = -1;
+    // indices of the selected frames
+    QVector<int> m_selectionHistory;
     int m_selectedItem = -1;
     int m_minRootWidth = 0;
     bool m_showBottomUpData = false;
-    bool m_collapseRecursion = false;
-    bool m_buildingScene = false;
+    QCheckBox* m_collapseRecursionCheckbox = nullptr;
+    // the frames that were built so far, indexed by bottom up
+    QSharedPointer<const FlameGraphFrames> m_frames[2];
+    bool m_buildingScene[2] = {false, false};
+    // builds the frames, superseded whenever the top down or bottom up data changes, to discard outdated frames
+    JobScheduler m_buildJobs[2];
     // cost threshold in percent, items below that value will not be shown
     static const constexpr double DEFAULT_COST_THRESHOLD = 0.1;
     double m_costThreshold = DEFAULT_COST_THRESHOLD;
@@ -30,9 +30,16 @@
 #include <QProcessEnvironment>
 #include <QFile>
 
+#include <memory>
+
+#include "batchanalysis.h"
 #include "hotspot-config.h"
 #include "mainwindow.h"
 #include "models/data.h"
+#include "models/disassembly.h"
+#include "models/latencies.h"
+#include "parsers/perf/perfheader.h"
+#include "settings.h"
 #include "util.h"
 
 #include <ThreadWeaver/ThreadWeaver>
@@ -45,7 +52,10 @@ int main(int argc, char** argv)
     QCoreApplication::setApplicationName(QStringLiteral("hotspot"));
     QCoreApplication::setApplicationVersion(QStringLiteral(HOTSPOT_VERSION_STRING));
 
-    QApplication app(argc, argv);
+    // the batch mode must also work without any display server
+    const bool batchMode = BatchAnalysis::isRequested(argc, argv);
+    std::unique_ptr<QCoreApplication> app(batchMode ? new QCoreApplication(argc, argv)
+                                                    : new QApplication(argc, argv));
 
     // init
     Util::appImageEnvironment();
@@ -60,7 +70,9 @@ int main(int argc, char** argv)
     qputenv("LD_LIBRARY_PATH", LD_LIBRARY_PATH);
 #endif
 
-    app.setWindowIcon(QIcon(QStringLiteral(":/images/icons/512-hotspot_app_icon.png")));
+    if (!batchMode) {
+        QApplication::setWindowIcon(QIcon(QStringLiteral(":/images/icons/512-hotspot_app_icon.png")));
+    }
     qRegisterMetaType<Data::Summary>();
     qRegisterMetaType<Data::BottomUp>();
     qRegisterMetaType<Data::TopDown>();
@@ -69,10 +81,19 @@ int main(int argc, char** argv)
     qRegisterMetaType<Data::TopDownResults>();
     qRegisterMetaType<Data::CallerCalleeResults>();
     qRegisterMetaType<Data::EventResults>();
+    qRegisterMetaType<Data::LatencyResults>();
+    qRegisterMetaType<Data::DisassemblyResults>();
+    qRegisterMetaType<Data::SymbolStackIndex>();
+    qRegisterMetaType<Data::FilterCacheStats>();
+    qRegisterMetaType<Data::ApproximationStats>();
+    qRegisterMetaType<Data::ParseProgress>();
+    qRegisterMetaType<PerfHeader::Info>();
 
 #if APPIMAGE_BUILD
-    QIcon::setThemeSearchPaths({app.applicationDirPath() + QLatin1String("/../share/icons/")});
-    QIcon::setThemeName(QStringLiteral("breeze"));
+    if (!batchMode) {
+        QIcon::setThemeSearchPaths({app->applicationDirPath() + QLatin1String("/../share/icons/")});
+        QIcon::setThemeName(QStringLiteral("breeze"));
+    }
 #endif
 
     QCommandLineParser parser;
@@ -114,15 +135,171 @@ int main(int argc, char** argv)
                             QLatin1String("path"));
     parser.addOption(arch);
 
+    QCommandLineOption noCache(
+        QLatin1String("no-cache"),
+        QCoreApplication::translate("main", "Neither load nor store the parse results cached next to the input files."));
+    parser.addOption(noCache);
+
+    QCommandLineOption merge(
+        QLatin1String("merge"),
+        QCoreApplication::translate("main", "Open all input files in a single window and merge their results."));
+    parser.addOption(merge);
+
+    QCommandLineOption alignStarts(
+        QLatin1String("align-starts"),
+        QCoreApplication::translate("main",
+                                    "Align the time lines of merged input files by their start, instead of "
+                                    "comparing their recorded times directly. Use this when the files got recorded "
+                                    "on different hosts or without a common clock like CLOCK_MONOTONIC."));
+    parser.addOption(alignStarts);
+
+    QCommandLineOption timeOffset(
+        QLatin1String("time-offset"),
+        QCoreApplication::translate("main",
+                                    "Shift the time line of a merged input file by the given number of "
+                                    "nanoseconds, which can be negative. Give it once per input file, in order."),
+        QLatin1String("nanoseconds"));
+    parser.addOption(timeOffset);
+
+    QCommandLineOption diffBaseline(
+        QLatin1String("diff"),
+        QCoreApplication::translate("main", "Show how the costs of the input file changed compared to a baseline."),
+        QLatin1String("baseline"));
+    parser.addOption(diffBaseline);
+
+    QCommandLineOption exportFile(
+        QLatin1String("export"),
+        QCoreApplication::translate("main",
+                                    "Analyze the input files without showing a window and write the results to "
+                                    "the given file, as CSV if its name ends with .csv and as JSON otherwise."),
+        QLatin1String("file"));
+    parser.addOption(exportFile);
+
+    QCommandLineOption exportScript(
+        QLatin1String("export-script"),
+        QCoreApplication::translate("main",
+                                    "Analyze the input files without showing a window and write their samples in "
+                                    "the text format of perf script to the given file, or to stdout for \"-\"."),
+        QLatin1String("file"));
+    parser.addOption(exportScript);
+
+    QCommandLineOption exportArrow(
+        QLatin1String("export-arrow"),
+        QCoreApplication::translate("main",
+                                    "Analyze the input files without showing a window and write their events, threads, "
+                                    "stacks, locations and symbols as Arrow IPC streams into the given directory."),
+        QLatin1String("directory"));
+    parser.addOption(exportArrow);
+
+    QCommandLineOption topSymbols(
+        QLatin1String("top"),
+        QCoreApplication::translate("main", "Number of symbols with the highest self cost to export (default: 20)."),
+        QLatin1String("count"));
+    parser.addOption(topSymbols);
+
+    QCommandLineOption filterProcess(QLatin1String("filter-process"),
+                                     QCoreApplication::translate("main", "Only export the costs of the given process."),
+                                     QLatin1String("pid"));
+    parser.addOption(filterProcess);
+
+    QCommandLineOption filterThread(QLatin1String("filter-thread"),
+                                    QCoreApplication::translate("main", "Only export the costs of the given thread."),
+                                    QLatin1String("tid"));
+    parser.addOption(filterThread);
+
+    QCommandLineOption filterCpu(QLatin1String("filter-cpu"),
+                                 QCoreApplication::translate("main", "Only export the costs of the given CPU."),
+                                 QLatin1String("cpu"));
+    parser.addOption(filterCpu);
+
+    QCommandLineOption includeSymbol(
+        QLatin1String("include-symbol"),
+        QCoreApplication::translate("main", "Only export the costs of stacks containing the given symbol."),
+        QLatin1String("symbol"));
+    parser.addOption(includeSymbol);
+
+    QCommandLineOption excludeSymbol(
+        QLatin1String("exclude-symbol"),
+        QCoreApplication::translate("main", "Do not export the costs of stacks containing the given symbol."),
+        QLatin1String("symbol"));
+    parser.addOption(excludeSymbol);
+
+    QCommandLineOption maxCost(
+        QLatin1String("max-cost"),
+        QCoreApplication::translate("main",
+                                    "Exit with code 2 when the total cost of the given cost type exceeds the "
+                                    "maximum, e.g. \"cycles=1000000\"."),
+        QLatin1String("type=value"));
+    parser.addOption(maxCost);
+
     parser.addPositionalArgument(
         QStringLiteral("files"),
         QCoreApplication::translate("main", "Optional input files to open on startup, i.e. perf.data files."),
         QStringLiteral("[files...]"));
 
-    parser.process(app);
+    parser.process(*app);
 
     ThreadWeaver::Queue::instance()->setMaximumNumberOfThreads(QThread::idealThreadCount());
 
+    QVector<qint64> timeOffsets;
+    for (const auto& value : parser.values(timeOffset)) {
+        bool ok = false;
+        timeOffsets.append(value.toLongLong(&ok));
+        if (!ok) {
+            qWarning("invalid --time-offset value: %s", qPrintable(value));
+            return batchMode ? BatchAnalysis::Failure : 1;
+        }
+    }
+
+    if (batchMode) {
+        BatchAnalysis::Options options;
+        options.inputFiles = parser.positionalArguments();
+        if (options.inputFiles.isEmpty() && QFile::exists(QStringLiteral("perf.data"))) {
+            options.inputFiles = {QStringLiteral("perf.data")};
+        }
+        options.sysroot = parser.value(sysroot);
+        options.kallsyms = parser.value(kallsyms);
+        options.debugPaths = parser.value(debugPaths);
+        options.extraLibPaths = parser.value(extraLibPaths);
+        options.appPath = parser.value(appPath);
+        options.arch = parser.value(arch);
+        options.useResultsCache = !parser.isSet(noCache);
+        options.alignFileStarts = parser.isSet(alignStarts);
+        options.timeOffsets = timeOffsets;
+        options.outputFile = parser.value(exportFile);
+        options.scriptOutputFile = parser.value(exportScript);
+        options.arrowDirectory = parser.value(exportArrow);
+        if (parser.isSet(topSymbols)) {
+            options.topSymbols = parser.value(topSymbols).toInt();
+        }
+        if (parser.isSet(filterProcess)) {
+            options.filter.processId = parser.value(filterProcess).toInt();
+        }
+        if (parser.isSet(filterThread)) {
+            options.filter.threadId = parser.value(filterThread).toInt();
+        }
+        if (parser.isSet(filterCpu)) {
+            options.filter.cpuId = parser.value(filterCpu).toUInt();
+        }
+        options.includeSymbols = parser.values(includeSymbol);
+        options.excludeSymbols = parser.values(excludeSymbol);
+        for (const auto& value : parser.values(maxCost)) {
+            const auto separator = value.lastIndexOf(QLatin1Char('='));
+            bool ok = false;
+            const auto cost = value.midRef(separator + 1).toLongLong(&ok);
+            if (separator <= 0 || !ok) {
+                qWarning("invalid --max-cost value: %s", qPrintable(value));
+                return BatchAnalysis::Failure;
+            }
+            options.maxCosts.insert(value.left(separator), cost);
+        }
+        return BatchAnalysis::run(options);
+    }
+
+    if (parser.isSet(noCache)) {
+        Settings::instance()->setUseResultsCache(false);
+    }
+
     auto applyCliArgs = [&](MainWindow* window) {
         if (parser.isSet(sysroot)) {
             window->setSysroot(parser.value(sysroot));
@@ -142,13 +319,26 @@ int main(int argc, char** argv)
         if (parser.isSet(arch)) {
             window->setArch(parser.value(arch));
         }
+        window->setTimeAlignment(parser.isSet(alignStarts), timeOffsets);
     };
 
-    for (const auto& file : parser.positionalArguments()) {
+    if (parser.isSet(diffBaseline) && parser.positionalArguments().size() == 1) {
         auto window = new MainWindow;
         applyCliArgs(window);
-        window->openFile(file);
+        window->openDiff(parser.value(diffBaseline), parser.positionalArguments().first());
         window->show();
+    } else if (parser.isSet(merge) && !parser.positionalArguments().isEmpty()) {
+        auto window = new MainWindow;
+        applyCliArgs(window);
+        window->openFiles(parser.positionalArguments());
+        window->show();
+    } else {
+        for (const auto& file : parser.positionalArguments()) {
+            auto window = new MainWindow;
+            applyCliArgs(window);
+            window->openFile(file);
+            window->show();
+        }
     }
 
     // show at least one mainwindow
@@ -166,5 +356,5 @@ int main(int argc, char** argv)
         window->show();
     }
 
-    return app.exec();
+    return app->exec();
 }
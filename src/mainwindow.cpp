@@ -33,6 +33,7 @@
 #include "ui_mainwindow.h"
 
 #include <QApplication>
+#include <QDataStream>
 #include <QFileDialog>
 #include <QStackedWidget>
 #include <QVBoxLayout>
@@ -41,8 +42,12 @@
 #include <QInputDialog>
 #include <QLabel>
 #include <QLineEdit>
+#include <QMessageBox>
 #include <QProcess>
+#include <QSaveFile>
+#include <QSpinBox>
 #include <QStandardPaths>
+#include <QThread>
 #include <QWidgetAction>
 
 #include <KConfigGroup>
@@ -51,11 +56,17 @@
 
 #include "aboutdialog.h"
 
+#include "models/cputopology.h"
 #include "parsers/perf/perfparser.h"
 
 #include <functional>
+#include <limits>
 
 namespace {
+const quint32 SessionMagic = 0x48535345; // "HSSE"
+// bump this whenever the serialized data changes
+const quint32 SessionVersion = 1;
+
 struct IdeSettings
 {
     const char* const app;
@@ -125,14 +136,57 @@ MainWindow::MainWindow(QWidget* parent)
     connect(m_startPage, &StartPage::recordButtonClicked, this, &MainWindow::onRecordButtonClicked);
     connect(m_startPage, &StartPage::stopParseButtonClicked, this, &MainWindow::clear);
     connect(m_parser, &PerfParser::progress, m_startPage, &StartPage::onParseFileProgress);
+    connect(m_parser, &PerfParser::parseProgress, m_startPage, &StartPage::onParseProgress);
     connect(this, &MainWindow::openFileError, m_startPage, &StartPage::onOpenFileError);
     connect(m_recordPage, &RecordPage::homeButtonClicked, this, &MainWindow::onHomeButtonClicked);
     connect(m_recordPage, &RecordPage::openFile, this,
             static_cast<void (MainWindow::*)(const QString&)>(&MainWindow::openFile));
-
-    connect(m_parser, &PerfParser::parsingFinished, this, [this]() { m_pageStack->setCurrentWidget(m_resultsPage); });
+    connect(m_recordPage, &RecordPage::openFiles, this, &MainWindow::openFiles);
+    connect(m_recordPage, &RecordPage::openLiveRecording, this, &MainWindow::openLiveRecording);
+    connect(m_recordPage, &RecordPage::liveRecordingFailed, this, [this]() {
+        // the parser may still be waiting for data on the named pipe
+        m_parser->stop();
+        m_stopLiveRecordingAction->setEnabled(false);
+        m_pageStack->setCurrentWidget(m_recordPage);
+    });
+
+    connect(m_parser, &PerfParser::parsingFinished, this, [this]() {
+        m_stopLiveRecordingAction->setEnabled(false);
+        m_pageStack->setCurrentWidget(m_resultsPage);
+        if (m_hasPendingFilterState) {
+            // apply the filters once their saved results got loaded, which makes them show up right away
+            m_hasPendingFilterState = false;
+            m_loadingFilterSnapshots = true;
+            m_parser->loadFilterSnapshots();
+        }
+    });
+    connect(m_parser, &PerfParser::filterSnapshotsLoaded, this, [this]() {
+        if (m_loadingFilterSnapshots) {
+            m_loadingFilterSnapshots = false;
+            m_resultsPage->filterAndZoomStack()->restoreState(m_pendingFilterState);
+            m_pendingFilterState = {};
+        }
+    });
+    // show the partial results of long parses, the results page indicates that parsing is still ongoing
+    auto showPartialResults = [this]() {
+        if (m_pageStack->currentWidget() == m_startPage) {
+            m_pageStack->setCurrentWidget(m_resultsPage);
+        }
+    };
+    connect(m_parser, &PerfParser::partialBottomUpDataAvailable, this, showPartialResults);
+    // the summary of the system shows up right away when the file header could be read
+    connect(m_parser, &PerfParser::headerDataAvailable, this, showPartialResults);
     connect(m_parser, &PerfParser::parsingFailed, this,
-            [this](const QString& errorMessage) { emit openFileError(errorMessage); });
+            [this](const QString& errorMessage) {
+                const bool wasLive = m_stopLiveRecordingAction->isEnabled();
+                m_hasPendingFilterState = false;
+                m_stopLiveRecordingAction->setEnabled(false);
+                // the results page may already show the summary of the file header, go back to report the error
+                if (!wasLive && m_pageStack->currentWidget() == m_resultsPage) {
+                    m_pageStack->setCurrentWidget(m_startPage);
+                }
+                emit openFileError(errorMessage);
+            });
 
     auto* recordDataAction = new QAction(this);
     recordDataAction->setText(tr("&Record Data"));
@@ -140,15 +194,54 @@ MainWindow::MainWindow(QWidget* parent)
     recordDataAction->setShortcut(Qt::CTRL + Qt::Key_R);
     ui->fileMenu->addAction(recordDataAction);
     connect(recordDataAction, &QAction::triggered, this, &MainWindow::onRecordButtonClicked);
+    m_stopLiveRecordingAction = ui->fileMenu->addAction(QIcon::fromTheme(QStringLiteral("media-playback-stop")),
+                                                        tr("&Stop Live Recording"));
+    m_stopLiveRecordingAction->setToolTip(tr("Stop the live recording, which finishes parsing its data."));
+    m_stopLiveRecordingAction->setEnabled(false);
+    connect(m_stopLiveRecordingAction, &QAction::triggered, m_recordPage, &RecordPage::stopRecording);
 
     connect(m_resultsPage, &ResultsPage::navigateToCode, this, &MainWindow::navigateToCode);
     ui->fileMenu->addAction(KStandardAction::open(this, SLOT(onOpenFileButtonClicked()), this));
     m_recentFilesAction = KStandardAction::openRecent(this, SLOT(openFile(QUrl)), this);
     m_recentFilesAction->loadEntries(m_config->group("RecentFiles"));
     ui->fileMenu->addAction(m_recentFilesAction);
+    auto* compareFilesAction = ui->fileMenu->addAction(QIcon::fromTheme(QStringLiteral("document-compare")),
+                                                       tr("Compare Files..."));
+    compareFilesAction->setToolTip(tr("Show how the costs of a candidate recording changed compared to a baseline."));
+    connect(compareFilesAction, &QAction::triggered, this, &MainWindow::onCompareFilesClicked);
+    auto* openSessionAction =
+        ui->fileMenu->addAction(QIcon::fromTheme(QStringLiteral("document-open")), tr("Open Session..."));
+    openSessionAction->setToolTip(tr("Open the files of a saved session and apply its filters and zoom levels."));
+    connect(openSessionAction, &QAction::triggered, this, &MainWindow::onOpenSessionClicked);
+    m_saveSessionAction =
+        ui->fileMenu->addAction(QIcon::fromTheme(QStringLiteral("document-save-as")), tr("Save Session..."));
+    m_saveSessionAction->setToolTip(tr("Save the opened files with the current filters and zoom levels."));
+    m_saveSessionAction->setEnabled(false);
+    connect(m_saveSessionAction, &QAction::triggered, this, &MainWindow::onSaveSessionClicked);
     m_reloadAction = KStandardAction::redisplay(this, SLOT(reload()), this);
     m_reloadAction->setText(tr("Reload"));
     ui->fileMenu->addAction(m_reloadAction);
+    m_reloadWithoutCacheAction = ui->fileMenu->addAction(QIcon::fromTheme(QStringLiteral("view-refresh")),
+                                                         tr("Reload Without Cache"));
+    m_reloadWithoutCacheAction->setToolTip(
+        tr("Parse the file again, ignoring and then updating the cached results stored next to it."));
+    connect(m_reloadWithoutCacheAction, &QAction::triggered, this, &MainWindow::reloadWithoutCache);
+    auto* useResultsCacheAction = ui->fileMenu->addAction(tr("Cache Parse Results"));
+    useResultsCacheAction->setCheckable(true);
+    useResultsCacheAction->setChecked(Settings::instance()->useResultsCache());
+    useResultsCacheAction->setToolTip(
+        tr("Store the parse results next to the opened file, which makes opening it again with the same settings "
+           "much faster."));
+    connect(useResultsCacheAction, &QAction::toggled, Settings::instance(), &Settings::setUseResultsCache);
+    auto* storeFilterSnapshotsAction = ui->fileMenu->addAction(tr("Store Filter Results With Sessions"));
+    storeFilterSnapshotsAction->setCheckable(true);
+    storeFilterSnapshotsAction->setChecked(Settings::instance()->storeFilterSnapshots());
+    storeFilterSnapshotsAction->setToolTip(
+        tr("Also store the results of the filters of saved sessions next to the opened file, which makes opening "
+           "the session again with the same settings show them right away."));
+    connect(storeFilterSnapshotsAction, &QAction::toggled, Settings::instance(),
+            &Settings::setStoreFilterSnapshots);
+    setupParseSettingsMenu();
     ui->fileMenu->addAction(KStandardAction::close(this, SLOT(clear()), this));
     ui->fileMenu->addAction(KStandardAction::quit(this, SLOT(close()), this));
     connect(ui->actionAbout_Qt, &QAction::triggered, qApp, &QApplication::aboutQt);
@@ -232,15 +325,21 @@ void MainWindow::setArch(const QString& arch)
     emit archChanged(m_arch);
 }
 
+void MainWindow::setTimeAlignment(bool alignStarts, const QVector<qint64>& offsets)
+{
+    m_parser->setTimeAlignment(alignStarts ? PerfParser::TimeAlignment::Start : PerfParser::TimeAlignment::Clock,
+                               offsets);
+}
+
 void MainWindow::onOpenFileButtonClicked()
 {
-    const auto fileName = QFileDialog::getOpenFileName(this, tr("Open File"), QDir::currentPath(),
-                                                       tr("Data Files (perf*.data perf.data.*);;All Files (*)"));
-    if (fileName.isEmpty()) {
+    const auto fileNames = QFileDialog::getOpenFileNames(this, tr("Open File"), QDir::currentPath(),
+                                                         tr("Data Files (perf*.data perf.data.*);;All Files (*)"));
+    if (fileNames.isEmpty()) {
         return;
     }
 
-    openFile(fileName);
+    openFiles(fileNames);
 }
 
 void MainWindow::onHomeButtonClicked()
@@ -258,33 +357,121 @@ void MainWindow::onRecordButtonClicked()
 }
 
 void MainWindow::clear()
+{
+    m_recordPage->stopRecording();
+    clearResults();
+}
+
+void MainWindow::clearResults()
 {
     m_parser->stop();
     setWindowTitle(tr("Hotspot"));
     m_startPage->showStartPage();
     m_pageStack->setCurrentWidget(m_startPage);
-    m_recordPage->stopRecording();
     m_resultsPage->selectSummaryTab();
     m_resultsPage->clear();
     m_reloadAction->setEnabled(false);
+    m_reloadWithoutCacheAction->setEnabled(false);
+    m_stopLiveRecordingAction->setEnabled(false);
+    m_saveSessionAction->setEnabled(false);
+    m_pendingFilterState = {};
+    m_hasPendingFilterState = false;
+    m_loadingFilterSnapshots = false;
+}
+
+void MainWindow::openLiveRecording(const QString& fifoPath)
+{
+    // keep the recording running, its data gets streamed through the named pipe
+    clearResults();
+
+    setWindowTitle(tr("Live Recording - Hotspot"));
+
+    m_startPage->showParseFileProgress();
+    m_pageStack->setCurrentWidget(m_startPage);
+
+    // there is no file to reload or cache, the data is gone once it was read from the pipe
+    m_parser->startParseFile(fifoPath, m_sysroot, m_kallsyms, m_debugPaths, m_extraLibPaths, m_appPath, m_arch,
+                             PerfParser::ResultsCacheMode::Ignore);
+    m_stopLiveRecordingAction->setEnabled(true);
+}
+
+void MainWindow::onCompareFilesClicked()
+{
+    const auto filter = tr("Data Files (perf*.data perf.data.*);;All Files (*)");
+    const auto baseline = QFileDialog::getOpenFileName(this, tr("Open Baseline"), QDir::currentPath(), filter);
+    if (baseline.isEmpty()) {
+        return;
+    }
+    const auto candidate =
+        QFileDialog::getOpenFileName(this, tr("Open Candidate"), QFileInfo(baseline).absolutePath(), filter);
+    if (candidate.isEmpty()) {
+        return;
+    }
+
+    openDiff(baseline, candidate);
+}
+
+void MainWindow::openDiff(const QString& baselinePath, const QString& candidatePath)
+{
+    clear();
+
+    setWindowTitle(tr("%1 vs. %2 - Hotspot")
+                       .arg(QFileInfo(candidatePath).fileName(), QFileInfo(baselinePath).fileName()));
+
+    m_startPage->showParseFileProgress();
+    m_pageStack->setCurrentWidget(m_startPage);
+
+    const auto cacheMode = Settings::instance()->useResultsCache() ? PerfParser::ResultsCacheMode::Use
+                                                                   : PerfParser::ResultsCacheMode::Ignore;
+    m_parser->startDiffFiles(baselinePath, candidatePath, m_sysroot, m_kallsyms, m_debugPaths, m_extraLibPaths,
+                             m_appPath, m_arch, cacheMode);
 }
 
 void MainWindow::openFile(const QString& path)
+{
+    parseFiles({path}, false);
+}
+
+void MainWindow::openFiles(const QStringList& paths)
+{
+    parseFiles(paths, false);
+}
+
+void MainWindow::parseFiles(const QStringList& paths, bool refreshCache,
+                            const FilterAndZoomStack::State* filterState)
 {
     clear();
+    if (filterState) {
+        m_pendingFilterState = *filterState;
+        m_hasPendingFilterState = true;
+    }
 
-    QFileInfo file(path);
-    setWindowTitle(tr("%1 - Hotspot").arg(file.fileName()));
+    if (paths.size() == 1) {
+        setWindowTitle(tr("%1 - Hotspot").arg(QFileInfo(paths.first()).fileName()));
+    } else {
+        setWindowTitle(tr("%1 Files - Hotspot").arg(paths.size()));
+    }
 
     m_startPage->showParseFileProgress();
     m_pageStack->setCurrentWidget(m_startPage);
 
     // TODO: support input files of different types via plugins
-    m_parser->startParseFile(path, m_sysroot, m_kallsyms, m_debugPaths, m_extraLibPaths, m_appPath, m_arch);
+    auto cacheMode = PerfParser::ResultsCacheMode::Ignore;
+    if (refreshCache) {
+        cacheMode = PerfParser::ResultsCacheMode::Refresh;
+    } else if (Settings::instance()->useResultsCache()) {
+        cacheMode = PerfParser::ResultsCacheMode::Use;
+    }
+    m_parser->startParseFiles(paths, m_sysroot, m_kallsyms, m_debugPaths, m_extraLibPaths, m_appPath, m_arch,
+                              cacheMode);
     m_reloadAction->setEnabled(true);
-    m_reloadAction->setData(path);
+    m_reloadAction->setData(paths);
+    m_reloadWithoutCacheAction->setEnabled(true);
+    m_saveSessionAction->setEnabled(true);
 
-    m_recentFilesAction->addUrl(QUrl::fromLocalFile(file.absoluteFilePath()));
+    for (const auto& path : paths) {
+        m_recentFilesAction->addUrl(QUrl::fromLocalFile(QFileInfo(path).absoluteFilePath()));
+    }
     m_recentFilesAction->saveEntries(m_config->group("RecentFiles"));
     m_config->sync();
 }
@@ -300,7 +487,95 @@ void MainWindow::openFile(const QUrl& url)
 
 void MainWindow::reload()
 {
-    openFile(m_reloadAction->data().toString());
+    // parsing again drops the filters, keep them
+    const auto filterState = m_resultsPage->filterAndZoomStack()->state();
+    parseFiles(m_reloadAction->data().toStringList(), false, &filterState);
+}
+
+void MainWindow::reloadWithoutCache()
+{
+    const auto filterState = m_resultsPage->filterAndZoomStack()->state();
+    parseFiles(m_reloadAction->data().toStringList(), true, &filterState);
+}
+
+void MainWindow::onOpenSessionClicked()
+{
+    const auto fileName = QFileDialog::getOpenFileName(this, tr("Open Session"), QDir::currentPath(),
+                                                       tr("Hotspot Sessions (*.hotspot-session);;All Files (*)"));
+    if (!fileName.isEmpty()) {
+        openSession(fileName);
+    }
+}
+
+void MainWindow::onSaveSessionClicked()
+{
+    const auto paths = m_reloadAction->data().toStringList();
+    const auto directory = paths.isEmpty() ? QDir::currentPath() : QFileInfo(paths.first()).absolutePath();
+    const auto fileName = QFileDialog::getSaveFileName(this, tr("Save Session"), directory,
+                                                       tr("Hotspot Sessions (*.hotspot-session)"));
+    if (!fileName.isEmpty()) {
+        saveSession(fileName);
+    }
+}
+
+void MainWindow::openSession(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        emit openFileError(tr("Failed to open session %1: %2").arg(path, file.errorString()));
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_7);
+    quint32 magic = 0;
+    quint32 version = 0;
+    QStringList paths;
+    FilterAndZoomStack::State filterState;
+    stream >> magic >> version;
+    if (magic == SessionMagic && version == SessionVersion) {
+        stream >> paths >> filterState;
+    }
+    if (magic != SessionMagic || version != SessionVersion || stream.status() != QDataStream::Ok
+        || paths.isEmpty()) {
+        emit openFileError(tr("Failed to open session %1: unsupported or corrupt file.").arg(path));
+        return;
+    }
+
+    const auto sessionDirectory = QFileInfo(path).absoluteDir();
+    for (auto& dataPath : paths) {
+        dataPath = sessionDirectory.absoluteFilePath(dataPath);
+    }
+    parseFiles(paths, false, &filterState);
+}
+
+void MainWindow::saveSession(const QString& path)
+{
+    const auto filterState = m_resultsPage->filterAndZoomStack()->state();
+    // the files are stored relative to the session, such that it can be shared along with them
+    const auto sessionDirectory = QFileInfo(path).absoluteDir();
+    QStringList paths;
+    for (const auto& dataPath : m_reloadAction->data().toStringList()) {
+        paths.push_back(sessionDirectory.relativeFilePath(QFileInfo(dataPath).absoluteFilePath()));
+    }
+
+    QSaveFile file(path);
+    bool saved = file.open(QIODevice::WriteOnly);
+    if (saved) {
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_7);
+        stream << SessionMagic << SessionVersion << paths << filterState;
+        saved = stream.status() == QDataStream::Ok && file.commit();
+    }
+    if (!saved) {
+        QMessageBox::warning(this, tr("Failed to save session"),
+                             tr("Failed to save the session to %1:\n%2").arg(path, file.errorString()));
+        return;
+    }
+
+    if (Settings::instance()->storeFilterSnapshots()) {
+        m_parser->saveFilterSnapshots(filterState.appliedFilters());
+    }
 }
 
 void MainWindow::aboutKDAB()
@@ -380,6 +655,118 @@ void MainWindow::setupPathSettingsMenu()
     m_startPage->setPathSettingsMenu(menu);
 }
 
+void MainWindow::setupParseSettingsMenu()
+{
+    // until they get changed here, the settings default to the environment variables read by the parser
+    const auto defaults = PerfParser::ParseOptions::fromEnvironment();
+    const auto config = m_config->group("ParseSettings");
+    auto* settings = Settings::instance();
+    settings->setEventRetentionSeconds(config.readEntry("eventRetentionSeconds", defaults.eventRetentionSeconds));
+    settings->setMaxEventsPerThread(config.readEntry("maxEventsPerThread", defaults.maxEventsPerThread));
+    settings->setMemoryBudgetMB(config.readEntry("memoryBudgetMB", defaults.memoryBudgetMB));
+    settings->setPartialResultsIntervalMs(
+        config.readEntry("partialResultsIntervalMs", defaults.partialResultsIntervalMs));
+    settings->setIngestTopDown(config.readEntry("ingestTopDown", defaults.ingestTopDown));
+    settings->setAggregationThreads(config.readEntry("aggregationThreads", defaults.aggregationThreads));
+    settings->setPinWorkers(config.readEntry("pinWorkers", CpuTopology::isPinningEnabled()));
+    CpuTopology::setPinningEnabled(settings->pinWorkers());
+    updateParseOptions();
+
+    auto* menu = ui->fileMenu->addMenu(tr("Parse Settings"));
+    auto addSpinBoxAction = [this, menu, settings](const QString& label, const QString& tooltip, const QString& suffix,
+                                                   const QString& zeroText, int (Settings::*value)() const,
+                                                   void (Settings::*setValue)(int),
+                                                   void (Settings::*valueChanged)(int), const QString& configKey) {
+        auto action = new QWidgetAction(menu);
+        auto container = new QWidget;
+        auto layout = new QHBoxLayout;
+        layout->addWidget(new QLabel(label));
+        auto spinBox = new QSpinBox;
+        spinBox->setRange(0, std::numeric_limits<int>::max());
+        spinBox->setSuffix(suffix);
+        spinBox->setSpecialValueText(zeroText);
+        spinBox->setValue((settings->*value)());
+        connect(spinBox, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), settings, setValue);
+        connect(settings, valueChanged, spinBox, &QSpinBox::setValue);
+        connect(settings, valueChanged, this, [this, configKey](int newValue) {
+            m_config->group("ParseSettings").writeEntry(configKey, newValue);
+            updateParseOptions();
+        });
+        layout->addWidget(spinBox);
+        container->setToolTip(tooltip);
+        container->setLayout(layout);
+        action->setDefaultWidget(container);
+        menu->addAction(action);
+        return spinBox;
+    };
+    addSpinBoxAction(tr("Keep Events For:"),
+                     tr("Only keep the events of the last seconds of a recording for the timeline, which bounds the "
+                        "memory used by long captures. The aggregated costs still cover the whole recording."),
+                     tr(" s"), tr("unlimited"), &Settings::eventRetentionSeconds, &Settings::setEventRetentionSeconds,
+                     &Settings::eventRetentionSecondsChanged, QStringLiteral("eventRetentionSeconds"));
+    addSpinBoxAction(tr("Events per Thread:"),
+                     tr("Only keep the latest events of every thread for the timeline. The aggregated costs still "
+                        "cover the whole recording."),
+                     {}, tr("unlimited"), &Settings::maxEventsPerThread, &Settings::setMaxEventsPerThread,
+                     &Settings::maxEventsPerThreadChanged, QStringLiteral("maxEventsPerThread"));
+    addSpinBoxAction(tr("Memory Budget:"),
+                     tr("Drop the oldest events once the parse results take more memory than this. The aggregated "
+                        "costs still cover the whole recording."),
+                     tr(" MiB"), tr("unlimited"), &Settings::memoryBudgetMB, &Settings::setMemoryBudgetMB,
+                     &Settings::memoryBudgetMBChanged, QStringLiteral("memoryBudgetMB"));
+    addSpinBoxAction(tr("Partial Results Every:"),
+                     tr("Show the results aggregated so far while parsing a large file, such that it can be looked at "
+                        "early on."),
+                     tr(" ms"), tr("never"), &Settings::partialResultsIntervalMs,
+                     &Settings::setPartialResultsIntervalMs, &Settings::partialResultsIntervalMsChanged,
+                     QStringLiteral("partialResultsIntervalMs"));
+    auto* aggregationThreads = addSpinBoxAction(
+        tr("Aggregation Threads:"),
+        tr("Aggregate the samples on this many threads while parsing, next to the one decoding them. This speeds up "
+           "the parsing of large files on hosts with enough cores."),
+        {}, tr("none"), &Settings::aggregationThreads, &Settings::setAggregationThreads,
+        &Settings::aggregationThreadsChanged, QStringLiteral("aggregationThreads"));
+    aggregationThreads->setMaximum(std::max(QThread::idealThreadCount(), settings->aggregationThreads()));
+
+    auto* ingestTopDownAction = menu->addAction(tr("Build Top-Down Tree While Parsing"));
+    ingestTopDownAction->setCheckable(true);
+    ingestTopDownAction->setChecked(settings->ingestTopDown());
+    ingestTopDownAction->setToolTip(
+        tr("Skip the pass over the bottom-up tree at the end of the parse and also show partial top-down results, "
+           "at the cost of a slower and more memory hungry parse."));
+    connect(ingestTopDownAction, &QAction::toggled, settings, &Settings::setIngestTopDown);
+    connect(settings, &Settings::ingestTopDownChanged, this, [this](bool ingestTopDown) {
+        m_config->group("ParseSettings").writeEntry("ingestTopDown", ingestTopDown);
+        updateParseOptions();
+    });
+
+    auto* pinWorkersAction = menu->addAction(tr("Pin Workers to NUMA Nodes"));
+    pinWorkersAction->setCheckable(true);
+    pinWorkersAction->setChecked(settings->pinWorkers());
+    pinWorkersAction->setToolTip(
+        tr("Keep the threads that aggregate and filter the samples on the NUMA node of the data they work on. This "
+           "only helps on hosts with several NUMA nodes."));
+    pinWorkersAction->setEnabled(CpuTopology::numaNodes().size() > 1 || settings->pinWorkers());
+    connect(pinWorkersAction, &QAction::toggled, settings, &Settings::setPinWorkers);
+    connect(settings, &Settings::pinWorkersChanged, this, [this](bool pinWorkers) {
+        m_config->group("ParseSettings").writeEntry("pinWorkers", pinWorkers);
+        CpuTopology::setPinningEnabled(pinWorkers);
+    });
+}
+
+void MainWindow::updateParseOptions()
+{
+    auto options = m_parser->parseOptions();
+    const auto* settings = Settings::instance();
+    options.eventRetentionSeconds = settings->eventRetentionSeconds();
+    options.maxEventsPerThread = settings->maxEventsPerThread();
+    options.memoryBudgetMB = settings->memoryBudgetMB();
+    options.partialResultsIntervalMs = settings->partialResultsIntervalMs();
+    options.ingestTopDown = settings->ingestTopDown();
+    options.aggregationThreads = settings->aggregationThreads();
+    m_parser->setParseOptions(options);
+}
+
 void MainWindow::setupCodeNavigationMenu()
 {
     // Code Navigation
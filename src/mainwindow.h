@@ -33,6 +33,8 @@
 
 #include <KSharedConfig>
 
+#include "models/filterandzoomstack.h"
+
 namespace Ui {
 class MainWindow;
 }
@@ -61,13 +63,28 @@ public slots:
     void setExtraLibPaths(const QString& paths);
     void setAppPath(const QString& path);
     void setArch(const QString& arch);
+    // align the files opened at once by their start instead of their recorded times, then shift each of them by
+    // its entry in @p offsets, see PerfParser::setTimeAlignment
+    void setTimeAlignment(bool alignStarts, const QVector<qint64>& offsets);
 
     void clear();
     void openFile(const QString& path);
     void openFile(const QUrl& url);
+    // open all @p paths at once, merging their results into a single view
+    void openFiles(const QStringList& paths);
+    // show the change of the costs in @p candidatePath compared to @p baselinePath
+    void openDiff(const QString& baselinePath, const QString& candidatePath);
     void reload();
+    void reloadWithoutCache();
+    // a session stores the opened files and the filters and zoom levels applied to them, optionally along with
+    // the filter results, see PerfParser::saveFilterSnapshots
+    void openSession(const QString& path);
+    void saveSession(const QString& path);
 
     void onOpenFileButtonClicked();
+    void onCompareFilesClicked();
+    void onOpenSessionClicked();
+    void onSaveSessionClicked();
     void onRecordButtonClicked();
     void onHomeButtonClicked();
 
@@ -90,6 +107,14 @@ private:
     void closeEvent(QCloseEvent* event) override;
     void setupCodeNavigationMenu();
     void setupPathSettingsMenu();
+    // the limits of the parser, which get stored in the config and applied to the following parses
+    void setupParseSettingsMenu();
+    void updateParseOptions();
+    // applies @p filterState once the files got parsed, when it is set
+    void parseFiles(const QStringList& paths, bool refreshCache,
+                    const FilterAndZoomStack::State* filterState = nullptr);
+    void clearResults();
+    void openLiveRecording(const QString& fifoPath);
 
     QScopedPointer<Ui::MainWindow> ui;
     PerfParser* m_parser;
@@ -107,4 +132,11 @@ private:
     QString m_arch;
     KRecentFilesAction* m_recentFilesAction = nullptr;
     QAction* m_reloadAction = nullptr;
+    QAction* m_reloadWithoutCacheAction = nullptr;
+    QAction* m_stopLiveRecordingAction = nullptr;
+    QAction* m_saveSessionAction = nullptr;
+    // the filters to apply once the files got parsed and the snapshots of their results got loaded
+    FilterAndZoomStack::State m_pendingFilterState;
+    bool m_hasPendingFilterState = false;
+    bool m_loadingFilterSnapshots = false;
 };
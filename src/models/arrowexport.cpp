@@ -0,0 +1,611 @@
+/*
+  arrowexport.cpp
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "arrowexport.h"
+
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSet>
+#include <QtEndian>
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+// a minimal builder for the flatbuffers that hold the metadata of the Arrow messages. like the reference
+// implementation it builds the buffer back to front, such that objects only ever reference the ones after them
+class FlatBufferBuilder
+{
+public:
+    // the position of an object, counted from the end of the buffer
+    using Offset = quint32;
+
+    Offset createString(const QByteArray& string)
+    {
+        align(sizeof(quint32), string.size() + 1);
+        m_buffer.prepend('\0');
+        m_buffer.prepend(string);
+        push<quint32>(string.size());
+        return size();
+    }
+
+    Offset createOffsetVector(const QVector<Offset>& offsets)
+    {
+        align(sizeof(quint32), sizeof(quint32) * offsets.size());
+        for (int i = offsets.size() - 1; i >= 0; --i) {
+            pushOffset(offsets[i]);
+        }
+        push<quint32>(offsets.size());
+        return size();
+    }
+
+    // a vector of structs made up of two 64-bit integers, like the FieldNode and Buffer structs of Arrow
+    Offset createPairVector(const QVector<QPair<qint64, qint64>>& pairs)
+    {
+        align(sizeof(qint64), 2 * sizeof(qint64) * pairs.size());
+        for (int i = pairs.size() - 1; i >= 0; --i) {
+            push<qint64>(pairs[i].second);
+            push<qint64>(pairs[i].first);
+        }
+        push<quint32>(pairs.size());
+        return size();
+    }
+
+    // the strings, vectors and tables referenced by a table must be created before starting it
+    void startTable()
+    {
+        m_fields.clear();
+        m_tableStart = size();
+    }
+
+    template<typename T>
+    void addScalar(int id, T value)
+    {
+        push<T>(value);
+        m_fields.append(qMakePair(id, size()));
+    }
+
+    void addOffset(int id, Offset offset)
+    {
+        pushOffset(offset);
+        m_fields.append(qMakePair(id, size()));
+    }
+
+    Offset endTable()
+    {
+        // the table starts with the signed distance to its vtable, which gets written right in front of it
+        push<qint32>(0);
+        const auto table = size();
+
+        int numFields = 0;
+        for (const auto& field : m_fields) {
+            numFields = std::max(numFields, field.first + 1);
+        }
+        QVector<quint16> fieldOffsets(numFields, 0);
+        for (const auto& field : m_fields) {
+            fieldOffsets[field.first] = table - field.second;
+        }
+        for (int i = numFields - 1; i >= 0; --i) {
+            push<quint16>(fieldOffsets[i]);
+        }
+        push<quint16>(table - m_tableStart);
+        push<quint16>(sizeof(quint16) * (numFields + 2));
+
+        qToLittleEndian<qint32>(size() - table, m_buffer.data() + m_buffer.size() - table);
+        return table;
+    }
+
+    QByteArray finish(Offset root)
+    {
+        align(m_minAlignment, sizeof(quint32));
+        pushOffset(root);
+        return m_buffer;
+    }
+
+private:
+    Offset size() const
+    {
+        return m_buffer.size();
+    }
+
+    // pad the front such that it is aligned to @p alignment once @p numBytes got added
+    void align(int alignment, int numBytes = 0)
+    {
+        m_minAlignment = std::max(m_minAlignment, alignment);
+        const int padding = (alignment - (m_buffer.size() + numBytes) % alignment) % alignment;
+        m_buffer.prepend(QByteArray(padding, '\0'));
+    }
+
+    template<typename T>
+    void push(T value)
+    {
+        align(sizeof(T));
+        char bytes[sizeof(T)];
+        qToLittleEndian<T>(value, bytes);
+        m_buffer.prepend(bytes, sizeof(T));
+    }
+
+    // offsets are unsigned and relative to their own position
+    void pushOffset(Offset offset)
+    {
+        align(sizeof(quint32));
+        push<quint32>(size() + sizeof(quint32) - offset);
+    }
+
+    QByteArray m_buffer;
+    int m_minAlignment = 1;
+    Offset m_tableStart = 0;
+    // the id and position of every field of the current table
+    QVector<QPair<int, Offset>> m_fields;
+};
+
+// the ids of the unions and enums in Arrow's Schema.fbs and Message.fbs
+enum ArrowId
+{
+    MetadataVersion_V5 = 4,
+    MessageHeader_Schema = 1,
+    MessageHeader_RecordBatch = 3,
+    Type_Int = 2,
+    Type_Utf8 = 5,
+    Type_List = 12,
+    Endianness_Little = 0,
+    Endianness_Big = 1
+};
+
+enum class ColumnType
+{
+    Int32,
+    UInt32,
+    Int64,
+    UInt64,
+    Utf8,
+    Int32List
+};
+
+struct Column
+{
+    QByteArray name;
+    ColumnType type;
+};
+
+struct BufferView
+{
+    const char* data;
+    qint64 size;
+};
+
+// the buffers of a column within a record batch, they are written as they are
+struct ColumnData
+{
+    // the length of the column, followed by the one of its child column if it has any
+    QVector<qint64> lengths;
+    // the buffers of the column followed by the ones of its child, the validity bitmaps are empty as nothing is null
+    QVector<BufferView> buffers;
+};
+
+template<typename T>
+ColumnData primitiveColumn(const T* values, int length)
+{
+    return {{length}, {{nullptr, 0}, {reinterpret_cast<const char*>(values), qint64(sizeof(T)) * length}}};
+}
+
+template<typename T>
+ColumnData primitiveColumn(const QVector<T>& values)
+{
+    return primitiveColumn(values.constData(), values.size());
+}
+
+template<typename T>
+BufferView bufferView(const QVector<T>& values)
+{
+    return {reinterpret_cast<const char*>(values.constData()), qint64(sizeof(T)) * values.size()};
+}
+
+// the UTF-8 encoded strings of a column, concatenated and delimited by their offsets
+class StringColumn
+{
+public:
+    StringColumn()
+        : m_offsets({0})
+    {
+    }
+
+    void append(const QString& string)
+    {
+        m_data += string.toUtf8();
+        m_offsets.append(m_data.size());
+    }
+
+    ColumnData data() const
+    {
+        return {{m_offsets.size() - 1}, {{nullptr, 0}, bufferView(m_offsets), {m_data.constData(), m_data.size()}}};
+    }
+
+private:
+    QVector<qint32> m_offsets;
+    QByteArray m_data;
+};
+
+class ArrowStreamWriter
+{
+public:
+    explicit ArrowStreamWriter(QIODevice* device)
+        : m_device(device)
+    {
+    }
+
+    bool writeSchema(const QVector<Column>& columns, const QVector<QPair<QByteArray, QByteArray>>& metadata = {})
+    {
+        FlatBufferBuilder builder;
+
+        QVector<FlatBufferBuilder::Offset> fields;
+        for (const auto& column : columns) {
+            fields.append(createField(&builder, column));
+        }
+        const auto fieldsVector = builder.createOffsetVector(fields);
+
+        QVector<FlatBufferBuilder::Offset> keyValues;
+        for (const auto& keyValue : metadata) {
+            const auto key = builder.createString(keyValue.first);
+            const auto value = builder.createString(keyValue.second);
+            builder.startTable();
+            builder.addOffset(0, key);
+            builder.addOffset(1, value);
+            keyValues.append(builder.endTable());
+        }
+        const auto keyValuesVector = builder.createOffsetVector(keyValues);
+
+        // the columns get written from memory as they are
+        builder.startTable();
+        builder.addScalar<qint16>(0, Q_BYTE_ORDER == Q_LITTLE_ENDIAN ? Endianness_Little : Endianness_Big);
+        builder.addOffset(1, fieldsVector);
+        builder.addOffset(2, keyValuesVector);
+        const auto schema = builder.endTable();
+
+        return writeMessage(&builder, MessageHeader_Schema, schema, {});
+    }
+
+    bool writeBatch(qint64 length, const QVector<ColumnData>& columns)
+    {
+        // the buffers are laid out one after the other in the body, each padded to a multiple of 8 bytes
+        QVector<QPair<qint64, qint64>> nodes;
+        QVector<QPair<qint64, qint64>> buffers;
+        QVector<BufferView> body;
+        qint64 bodyLength = 0;
+        for (const auto& column : columns) {
+            for (auto nodeLength : column.lengths) {
+                nodes.append(qMakePair(nodeLength, qint64(0)));
+            }
+            for (const auto& buffer : column.buffers) {
+                buffers.append(qMakePair(bodyLength, buffer.size));
+                body.append(buffer);
+                bodyLength += padded(buffer.size);
+            }
+        }
+
+        FlatBufferBuilder builder;
+        const auto nodesVector = builder.createPairVector(nodes);
+        const auto buffersVector = builder.createPairVector(buffers);
+        builder.startTable();
+        builder.addScalar<qint64>(0, length);
+        builder.addOffset(1, nodesVector);
+        builder.addOffset(2, buffersVector);
+        const auto recordBatch = builder.endTable();
+
+        return writeMessage(&builder, MessageHeader_RecordBatch, recordBatch, body);
+    }
+
+    bool finish()
+    {
+        return writeInt32(-1) && writeInt32(0);
+    }
+
+private:
+    static qint64 padded(qint64 size)
+    {
+        return (size + 7) & ~qint64(7);
+    }
+
+    static FlatBufferBuilder::Offset createType(FlatBufferBuilder* builder, int bitWidth, bool isSigned)
+    {
+        builder->startTable();
+        builder->addScalar<qint32>(0, bitWidth);
+        builder->addScalar<quint8>(1, isSigned);
+        return builder->endTable();
+    }
+
+    static FlatBufferBuilder::Offset createField(FlatBufferBuilder* builder, const Column& column)
+    {
+        // readers insist on the children, even when there are none
+        QVector<FlatBufferBuilder::Offset> children;
+        if (column.type == ColumnType::Int32List) {
+            children.append(createField(builder, {QByteArrayLiteral("item"), ColumnType::Int32}));
+        }
+        const auto childrenVector = builder->createOffsetVector(children);
+        const auto name = builder->createString(column.name);
+
+        quint8 typeId = Type_Int;
+        FlatBufferBuilder::Offset type = 0;
+        switch (column.type) {
+        case ColumnType::Int32:
+            type = createType(builder, 32, true);
+            break;
+        case ColumnType::UInt32:
+            type = createType(builder, 32, false);
+            break;
+        case ColumnType::Int64:
+            type = createType(builder, 64, true);
+            break;
+        case ColumnType::UInt64:
+            type = createType(builder, 64, false);
+            break;
+        case ColumnType::Utf8:
+        case ColumnType::Int32List:
+            // neither of these types has any parameters
+            typeId = column.type == ColumnType::Utf8 ? Type_Utf8 : Type_List;
+            builder->startTable();
+            type = builder->endTable();
+            break;
+        }
+
+        builder->startTable();
+        builder->addOffset(0, name);
+        builder->addScalar<quint8>(1, false);
+        builder->addScalar<quint8>(2, typeId);
+        builder->addOffset(3, type);
+        builder->addOffset(5, childrenVector);
+        return builder->endTable();
+    }
+
+    bool writeInt32(qint32 value)
+    {
+        char bytes[sizeof(value)];
+        qToLittleEndian(value, bytes);
+        return m_device->write(bytes, sizeof(value)) == sizeof(value);
+    }
+
+    bool writePadding(qint64 size)
+    {
+        static const char zeros[8] = {};
+        const auto padding = padded(size) - size;
+        return !padding || m_device->write(zeros, padding) == padding;
+    }
+
+    // an encapsulated message: a continuation marker, the size of the metadata, the metadata and the body
+    bool writeMessage(FlatBufferBuilder* builder, quint8 headerType, FlatBufferBuilder::Offset header,
+                      const QVector<BufferView>& body)
+    {
+        qint64 bodyLength = 0;
+        for (const auto& buffer : body) {
+            bodyLength += padded(buffer.size);
+        }
+
+        builder->startTable();
+        builder->addScalar<qint16>(0, MetadataVersion_V5);
+        builder->addScalar<quint8>(1, headerType);
+        builder->addOffset(2, header);
+        builder->addScalar<qint64>(3, bodyLength);
+        const auto metadata = builder->finish(builder->endTable());
+
+        // the marker and size take 8 bytes, padding the metadata keeps the body aligned to 8 bytes
+        bool ok = writeInt32(-1) && writeInt32(padded(metadata.size()));
+        ok = ok && m_device->write(metadata) == metadata.size() && writePadding(metadata.size());
+        for (const auto& buffer : body) {
+            if (!ok) {
+                break;
+            }
+            ok = !buffer.size || m_device->write(buffer.data, buffer.size) == buffer.size;
+            ok = ok && writePadding(buffer.size);
+        }
+        return ok;
+    }
+
+    QIODevice* m_device;
+};
+
+// larger threads get split into several record batches, which bounds the memory of the constant columns
+const int MAX_BATCH_LENGTH = 65536;
+}
+
+bool ArrowExport::writeEvents(QIODevice* device, const Data::EventResults& events)
+{
+    QJsonArray costTypes;
+    for (const auto& cost : events.totalCosts) {
+        costTypes.append(cost.label);
+    }
+
+    ArrowStreamWriter writer(device);
+    bool ok = writer.writeSchema({{QByteArrayLiteral("time"), ColumnType::UInt64},
+                                  {QByteArrayLiteral("cost"), ColumnType::UInt64},
+                                  {QByteArrayLiteral("type"), ColumnType::Int32},
+                                  {QByteArrayLiteral("stack_id"), ColumnType::Int32},
+                                  {QByteArrayLiteral("cpu_id"), ColumnType::UInt32},
+                                  {QByteArrayLiteral("pid"), ColumnType::Int32},
+                                  {QByteArrayLiteral("tid"), ColumnType::Int32}},
+                                 {{QByteArrayLiteral("hotspot.cost_types"),
+                                   QJsonDocument(costTypes).toJson(QJsonDocument::Compact)}});
+
+    QVector<qint32> pids;
+    QVector<qint32> tids;
+    for (const auto& thread : events.threads) {
+        const auto& threadEvents = thread.events;
+        for (int begin = 0, size = threadEvents.size(); ok && begin < size; begin += MAX_BATCH_LENGTH) {
+            const int length = std::min(MAX_BATCH_LENGTH, size - begin);
+            pids.fill(thread.pid, length);
+            tids.fill(thread.tid, length);
+            ok = writer.writeBatch(length, {primitiveColumn(threadEvents.times().constData() + begin, length),
+                                            primitiveColumn(threadEvents.costs().constData() + begin, length),
+                                            primitiveColumn(threadEvents.types().constData() + begin, length),
+                                            primitiveColumn(threadEvents.stackIds().constData() + begin, length),
+                                            primitiveColumn(threadEvents.cpuIds().constData() + begin, length),
+                                            primitiveColumn(pids), primitiveColumn(tids)});
+        }
+    }
+    return ok && writer.finish();
+}
+
+bool ArrowExport::writeThreads(QIODevice* device, const Data::EventResults& events)
+{
+    QVector<qint32> pids;
+    QVector<qint32> tids;
+    QVector<qint32> fileIds;
+    StringColumn names;
+    QVector<quint64> startTimes;
+    QVector<quint64> endTimes;
+    QVector<quint64> offCpuTimes;
+    for (const auto& thread : events.threads) {
+        pids.append(thread.pid);
+        tids.append(thread.tid);
+        fileIds.append(thread.fileId);
+        names.append(thread.name);
+        startTimes.append(thread.time.start);
+        endTimes.append(thread.time.end);
+        offCpuTimes.append(thread.offCpuTime);
+    }
+
+    ArrowStreamWriter writer(device);
+    return writer.writeSchema({{QByteArrayLiteral("pid"), ColumnType::Int32},
+                               {QByteArrayLiteral("tid"), ColumnType::Int32},
+                               {QByteArrayLiteral("file_id"), ColumnType::Int32},
+                               {QByteArrayLiteral("name"), ColumnType::Utf8},
+                               {QByteArrayLiteral("start_time"), ColumnType::UInt64},
+                               {QByteArrayLiteral("end_time"), ColumnType::UInt64},
+                               {QByteArrayLiteral("off_cpu_time"), ColumnType::UInt64}})
+        && writer.writeBatch(events.threads.size(),
+                             {primitiveColumn(pids), primitiveColumn(tids), primitiveColumn(fileIds), names.data(),
+                              primitiveColumn(startTimes), primitiveColumn(endTimes), primitiveColumn(offCpuTimes)})
+        && writer.finish();
+}
+
+bool ArrowExport::writeStacks(QIODevice* device, const Data::EventResults& events)
+{
+    QVector<qint32> stackIds;
+    QVector<qint32> offsets = {0};
+    QVector<qint32> locationIds;
+    for (int stackId = 0, c = events.stacks.size(); stackId < c; ++stackId) {
+        stackIds.append(stackId);
+        locationIds += events.stacks[stackId];
+        offsets.append(locationIds.size());
+    }
+
+    const ColumnData locationIdsColumn = {
+        {stackIds.size(), locationIds.size()},
+        {{nullptr, 0}, bufferView(offsets), {nullptr, 0}, bufferView(locationIds)}};
+
+    ArrowStreamWriter writer(device);
+    return writer.writeSchema({{QByteArrayLiteral("stack_id"), ColumnType::Int32},
+                               {QByteArrayLiteral("location_ids"), ColumnType::Int32List}})
+        && writer.writeBatch(stackIds.size(), {primitiveColumn(stackIds), locationIdsColumn}) && writer.finish();
+}
+
+bool ArrowExport::writeLocations(QIODevice* device, const Data::BottomUpResults& results)
+{
+    QVector<qint32> locationIds;
+    QVector<qint32> parentLocationIds;
+    QVector<quint64> addresses;
+    StringColumn sourceLocations;
+    QVector<quint32> symbolIds;
+    for (int locationId = 0, c = results.locations.size(); locationId < c; ++locationId) {
+        const auto& location = results.locations[locationId];
+        locationIds.append(locationId);
+        parentLocationIds.append(location.parentLocationId);
+        addresses.append(location.location.address);
+        sourceLocations.append(location.location.location);
+        symbolIds.append(results.symbols.value(locationId).id);
+    }
+
+    ArrowStreamWriter writer(device);
+    return writer.writeSchema({{QByteArrayLiteral("location_id"), ColumnType::Int32},
+                               {QByteArrayLiteral("parent_location_id"), ColumnType::Int32},
+                               {QByteArrayLiteral("address"), ColumnType::UInt64},
+                               {QByteArrayLiteral("source_location"), ColumnType::Utf8},
+                               {QByteArrayLiteral("symbol_id"), ColumnType::UInt32}})
+        && writer.writeBatch(locationIds.size(),
+                             {primitiveColumn(locationIds), primitiveColumn(parentLocationIds),
+                              primitiveColumn(addresses), sourceLocations.data(), primitiveColumn(symbolIds)})
+        && writer.finish();
+}
+
+bool ArrowExport::writeSymbols(QIODevice* device, const Data::BottomUpResults& results)
+{
+    // the locations reference the interned ids, every symbol only shows up once
+    QSet<quint32> writtenSymbols;
+    QVector<quint32> symbolIds;
+    StringColumn symbols;
+    StringColumn prettySymbols;
+    StringColumn binaries;
+    StringColumn paths;
+    for (const auto& symbol : results.symbols) {
+        if (!symbol.isValid() || writtenSymbols.contains(symbol.id)) {
+            continue;
+        }
+        writtenSymbols.insert(symbol.id);
+        symbolIds.append(symbol.id);
+        symbols.append(symbol.symbol);
+        prettySymbols.append(symbol.prettySymbol);
+        binaries.append(symbol.binary);
+        paths.append(symbol.path);
+    }
+
+    ArrowStreamWriter writer(device);
+    return writer.writeSchema({{QByteArrayLiteral("symbol_id"), ColumnType::UInt32},
+                               {QByteArrayLiteral("symbol"), ColumnType::Utf8},
+                               {QByteArrayLiteral("pretty_symbol"), ColumnType::Utf8},
+                               {QByteArrayLiteral("binary"), ColumnType::Utf8},
+                               {QByteArrayLiteral("path"), ColumnType::Utf8}})
+        && writer.writeBatch(symbolIds.size(),
+                             {primitiveColumn(symbolIds), symbols.data(), prettySymbols.data(), binaries.data(),
+                              paths.data()})
+        && writer.finish();
+}
+
+QString ArrowExport::writeDirectory(const QString& directory, const Data::BottomUpResults& results,
+                                    const Data::EventResults& events)
+{
+    QDir dir(directory);
+    if (!dir.mkpath(QStringLiteral("."))) {
+        return QStringLiteral("failed to create %1").arg(directory);
+    }
+
+    using Writer = std::function<bool(QIODevice*)>;
+    const QVector<QPair<QString, Writer>> tables = {
+        {QStringLiteral("events"), [&events](QIODevice* device) { return writeEvents(device, events); }},
+        {QStringLiteral("threads"), [&events](QIODevice* device) { return writeThreads(device, events); }},
+        {QStringLiteral("stacks"), [&events](QIODevice* device) { return writeStacks(device, events); }},
+        {QStringLiteral("locations"), [&results](QIODevice* device) { return writeLocations(device, results); }},
+        {QStringLiteral("symbols"), [&results](QIODevice* device) { return writeSymbols(device, results); }}};
+    for (const auto& table : tables) {
+        QFile file(dir.filePath(table.first + QLatin1String(".arrows")));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || !table.second(&file)) {
+            return QStringLiteral("%1: %2").arg(file.fileName(), file.errorString());
+        }
+    }
+    return {};
+}
@@ -0,0 +1,61 @@
+/*
+  arrowexport.h
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "data.h"
+
+class QIODevice;
+
+// exporters that write the events and the tables they reference as Arrow IPC streams, i.e. the format read by
+// pyarrow.ipc.open_stream. the columns of the events are written straight from their storage, without building rows
+// see https://arrow.apache.org/docs/format/Columnar.html#ipc-streaming-format
+namespace ArrowExport {
+// one row per event with the columns time, cost, type, stack_id, cpu_id, pid and tid, in one or more record batches
+// per thread. the names of the cost types the type column indexes into are stored in the hotspot.cost_types metadata
+bool writeEvents(QIODevice* device, const Data::EventResults& events);
+
+// one row per thread with the columns pid, tid, file_id, name, start_time, end_time and off_cpu_time
+bool writeThreads(QIODevice* device, const Data::EventResults& events);
+
+// one row per stack with the columns stack_id and location_ids, the latter ranging from the sampled location to the
+// outermost caller
+bool writeStacks(QIODevice* device, const Data::EventResults& events);
+
+// one row per location with the columns location_id, parent_location_id, address, source_location and symbol_id
+// the parent of an inlined frame is the location it got inlined into, or -1
+bool writeLocations(QIODevice* device, const Data::BottomUpResults& results);
+
+// one row per unique symbol with the columns symbol_id, symbol, pretty_symbol, binary and path
+bool writeSymbols(QIODevice* device, const Data::BottomUpResults& results);
+
+// writes all of the above to events.arrows, threads.arrows, stacks.arrows, locations.arrows and symbols.arrows
+// in @p directory, which gets created when needed. @return an error message, or an empty string on success
+QString writeDirectory(const QString& directory, const Data::BottomUpResults& results,
+                       const Data::EventResults& events);
+}
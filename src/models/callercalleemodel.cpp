@@ -27,9 +27,12 @@
 
 #include "callercalleemodel.h"
 #include "../util.h"
+#include "instrumentation.h"
 
 #include <QDebug>
 
+#include <cmath>
+
 CallerCalleeModel::CallerCalleeModel(QObject* parent)
     : HashModel(parent)
 {
@@ -38,6 +41,7 @@ CallerCalleeModel::CallerCalleeModel(QObject* parent)
             return;
         }
         emit dataChanged(index(0, Symbol), index(rowCount() - 1, Symbol));
+        invalidateSortOrder(Symbol);
     });
 }
 
@@ -45,7 +49,9 @@ CallerCalleeModel::~CallerCalleeModel() = default;
 
 void CallerCalleeModel::setResults(const Data::CallerCalleeResults& results)
 {
+    Instrumentation::ScopedTimer instrumentation("CallerCalleeModel::setResults");
     m_results = results;
+    m_metrics = Data::DerivedMetricValues(results.inclusiveCosts);
     setRows(results.entries);
 }
 
@@ -65,6 +71,9 @@ QVariant CallerCalleeModel::headerCell(int column, int role) const
             return tr("%1 (self)").arg(m_results.selfCosts.typeName(column));
         }
         column -= m_results.selfCosts.numTypes();
+        if (column >= m_results.inclusiveCosts.numTypes()) {
+            return m_metrics.metric(column - m_results.inclusiveCosts.numTypes()).name;
+        }
         return tr("%1 (incl.)").arg(m_results.inclusiveCosts.typeName(column));
     } else if (role == Qt::ToolTipRole) {
         switch (column) {
@@ -79,6 +88,12 @@ QVariant CallerCalleeModel::headerCell(int column, int role) const
         if (column < m_results.selfCosts.numTypes()) {
             return tr("The aggregated sample costs directly attributed to this symbol.");
         }
+        column -= m_results.selfCosts.numTypes();
+        if (column >= m_results.inclusiveCosts.numTypes()) {
+            const auto& metric = m_metrics.metric(column - m_results.inclusiveCosts.numTypes());
+            return tr("The metric \"%1\" derived from the inclusive costs of this symbol, computed as %2.")
+                .arg(metric.name, metric.formula);
+        }
         return tr("The aggregated sample costs attributed to this symbol, both directly and indirectly. This includes "
                   "the costs of all functions called by this symbol plus its self cost.");
     }
@@ -103,6 +118,11 @@ QVariant CallerCalleeModel::cell(int column, int role, const Data::Symbol& symbo
             return m_results.selfCosts.cost(column, entry.id);
         }
         column -= m_results.selfCosts.numTypes();
+        if (column >= m_results.inclusiveCosts.numTypes()) {
+            // sort the symbols without a value last
+            const auto value = m_metrics.value(column - m_results.inclusiveCosts.numTypes(), entry.id);
+            return std::isnan(value) ? -1. : value;
+        }
         return m_results.inclusiveCosts.cost(column, entry.id);
     } else if (role == TotalCostRole && column >= NUM_BASE_COLUMNS) {
         column -= NUM_BASE_COLUMNS;
@@ -111,6 +131,9 @@ QVariant CallerCalleeModel::cell(int column, int role, const Data::Symbol& symbo
         }
 
         column -= m_results.selfCosts.numTypes();
+        if (column >= m_results.inclusiveCosts.numTypes()) {
+            return {};
+        }
         return m_results.inclusiveCosts.totalCost(column);
     } else if (role == FilterRole) {
         // TODO: optimize this
@@ -128,14 +151,18 @@ QVariant CallerCalleeModel::cell(int column, int role, const Data::Symbol& symbo
                                             m_results.selfCosts.totalCost(column), true);
         }
         column -= m_results.selfCosts.numTypes();
+        if (column >= m_results.inclusiveCosts.numTypes()) {
+            column -= m_results.inclusiveCosts.numTypes();
+            return m_metrics.metric(column).formatValue(m_metrics.value(column, entry.id));
+        }
         return Util::formatCostRelative(m_results.inclusiveCosts.cost(column, entry.id),
                                         m_results.inclusiveCosts.totalCost(column), true);
     } else if (role == CalleesRole) {
-        return QVariant::fromValue(entry.callees);
+        return QVariant::fromValue(m_results.callees(entry.id));
     } else if (role == CallersRole) {
-        return QVariant::fromValue(entry.callers);
+        return QVariant::fromValue(m_results.callers(entry.id));
     } else if (role == SourceMapRole) {
-        return QVariant::fromValue(entry.sourceMap);
+        return QVariant::fromValue(m_results.sourceMap(entry.id));
     } else if (role == SelfCostsRole) {
         return QVariant::fromValue(m_results.selfCosts);
     } else if (role == InclusiveCostsRole) {
@@ -152,6 +179,41 @@ QModelIndex CallerCalleeModel::indexForSymbol(const Data::Symbol& symbol) const
     return indexForKey(symbol);
 }
 
+AbstractHashModel::LessThan CallerCalleeModel::rowLessThan(int column) const
+{
+    const auto keys = m_keys;
+    switch (column) {
+    case Symbol: {
+        const bool prettify = Settings::instance()->prettifySymbols();
+        return [keys, prettify](int lhs, int rhs) {
+            return Util::formatString(prettify ? keys[lhs].prettySymbol : keys[lhs].symbol)
+                < Util::formatString(prettify ? keys[rhs].prettySymbol : keys[rhs].symbol);
+        };
+    }
+    case Binary:
+        return [keys](int lhs, int rhs) { return keys[lhs].binary < keys[rhs].binary; };
+    }
+
+    const auto values = m_values;
+    column -= NUM_BASE_COLUMNS;
+    const auto metric = column - m_results.selfCosts.numTypes() - m_results.inclusiveCosts.numTypes();
+    if (metric >= 0) {
+        const auto metrics = m_metrics;
+        return [values, metrics, metric](int lhs, int rhs) {
+            // NaN compares false with everything, order it before all values
+            const auto lhsValue = metrics.value(metric, values[lhs].id);
+            const auto rhsValue = metrics.value(metric, values[rhs].id);
+            return std::isnan(lhsValue) ? !std::isnan(rhsValue) : lhsValue < rhsValue;
+        };
+    }
+    const bool isSelfCost = column < m_results.selfCosts.numTypes();
+    const auto costs = isSelfCost ? m_results.selfCosts : m_results.inclusiveCosts;
+    const int type = isSelfCost ? column : column - m_results.selfCosts.numTypes();
+    return [values, costs, type](int lhs, int rhs) {
+        return costs.cost(type, values[lhs].id) < costs.cost(type, values[rhs].id);
+    };
+}
+
 CallerModel::CallerModel(QObject* parent)
     : SymbolCostModelImpl(parent)
 {
@@ -183,7 +245,28 @@ SourceMapModel::SourceMapModel(QObject* parent)
 
 SourceMapModel::~SourceMapModel() = default;
 
+bool CallerCalleeModel::entryCost(int column, const Data::CallerCalleeEntry& entry, qint64* cost,
+                                  qint64* totalCost) const
+{
+    column -= NUM_BASE_COLUMNS;
+    if (column < 0) {
+        return false;
+    }
+    const auto* costs = &m_results.selfCosts;
+    if (column >= costs->numTypes()) {
+        column -= costs->numTypes();
+        costs = &m_results.inclusiveCosts;
+        if (column >= costs->numTypes()) {
+            return false;
+        }
+    }
+    *cost = costs->cost(column, entry.id);
+    *totalCost = costs->totalCost(column);
+    return true;
+}
+
 int CallerCalleeModel::numColumns() const
 {
-    return NUM_BASE_COLUMNS + m_results.inclusiveCosts.numTypes() + m_results.selfCosts.numTypes();
+    return NUM_BASE_COLUMNS + m_results.inclusiveCosts.numTypes() + m_results.selfCosts.numTypes()
+        + m_metrics.numMetrics();
 }
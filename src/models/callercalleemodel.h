@@ -70,11 +70,18 @@ public:
     QVariant headerCell(int column, int role) const final override;
     QVariant cell(int column, int role, const Data::Symbol& symbol,
                   const Data::CallerCalleeEntry& entry) const final override;
+    bool entryCost(int column, const Data::CallerCalleeEntry& entry, qint64* cost,
+                   qint64* totalCost) const final override;
     int numColumns() const final override;
     QModelIndex indexForSymbol(const Data::Symbol& symbol) const;
 
+protected:
+    LessThan rowLessThan(int column) const final override;
+
 private:
     Data::CallerCalleeResults m_results;
+    // the metrics derived from the inclusive costs, their columns follow the cost columns
+    Data::DerivedMetricValues m_metrics;
 };
 
 template<typename ModelImpl>
@@ -90,6 +97,7 @@ public:
                 return;
             }
             emit Parent::dataChanged(Parent::index(0, Symbol), Parent::index(Parent::rowCount() - 1, Symbol));
+            Parent::invalidateSortOrder(Symbol);
         });
     }
 
@@ -181,11 +189,42 @@ public:
         return {};
     }
 
+    bool entryCost(int column, const Data::ItemCost& costs, qint64* cost, qint64* totalCost) const final override
+    {
+        column -= NUM_BASE_COLUMNS;
+        if (column < 0 || column >= m_costs.numTypes()) {
+            return false;
+        }
+        *cost = costs[column];
+        *totalCost = m_costs.totalCost(column);
+        return true;
+    }
+
     int numColumns() const final override
     {
         return NUM_BASE_COLUMNS + m_costs.numTypes();
     }
 
+protected:
+    AbstractHashModel::LessThan rowLessThan(int column) const final override
+    {
+        const auto keys = this->m_keys;
+        switch (column) {
+        case Symbol: {
+            const bool prettify = Settings::instance()->prettifySymbols();
+            return [keys, prettify](int lhs, int rhs) {
+                return Util::formatString(prettify ? keys[lhs].prettySymbol : keys[lhs].symbol)
+                    < Util::formatString(prettify ? keys[rhs].prettySymbol : keys[rhs].symbol);
+            };
+        }
+        case Binary:
+            return [keys](int lhs, int rhs) { return keys[lhs].binary < keys[rhs].binary; };
+        }
+        const auto values = this->m_values;
+        const int type = column - NUM_BASE_COLUMNS;
+        return [values, type](int lhs, int rhs) { return values[lhs][type] < values[rhs][type]; };
+    }
+
 private:
     virtual QString symbolHeader() const = 0;
 
@@ -322,11 +361,48 @@ public:
         return {};
     }
 
+    bool entryCost(int column, const Data::LocationCost& costs, qint64* cost,
+                   qint64* totalCost) const final override
+    {
+        column -= NUM_BASE_COLUMNS;
+        if (column < 0 || column >= 2 * m_totalCosts.numTypes()) {
+            return false;
+        }
+        if (column < m_totalCosts.numTypes()) {
+            *cost = costs.selfCost[column];
+        } else {
+            column -= m_totalCosts.numTypes();
+            *cost = costs.inclusiveCost[column];
+        }
+        *totalCost = m_totalCosts.totalCost(column);
+        return true;
+    }
+
     int numColumns() const final override
     {
         return 1 + m_totalCosts.numTypes() * 2;
     }
 
+protected:
+    AbstractHashModel::LessThan rowLessThan(int column) const final override
+    {
+        if (column == Location) {
+            const auto keys = this->m_keys;
+            return [keys](int lhs, int rhs) { return keys[lhs] < keys[rhs]; };
+        }
+        const auto values = this->m_values;
+        column -= NUM_BASE_COLUMNS;
+        if (column < m_totalCosts.numTypes()) {
+            return [values, column](int lhs, int rhs) {
+                return values[lhs].selfCost[column] < values[rhs].selfCost[column];
+            };
+        }
+        column -= m_totalCosts.numTypes();
+        return [values, column](int lhs, int rhs) {
+            return values[lhs].inclusiveCost[column] < values[rhs].inclusiveCost[column];
+        };
+    }
+
 private:
     Data::Costs m_totalCosts;
 };
@@ -27,11 +27,28 @@
 
 #include "costdelegate.h"
 
+#include <QAbstractProxyModel>
 #include <QDebug>
 #include <QPainter>
 
+#include <algorithm>
 #include <cmath>
 
+namespace {
+// walks down the proxies to the model of the cells, which may provide their costs directly
+const CostCellProvider* costCellProvider(QModelIndex* index)
+{
+    auto model = index->model();
+    while (auto proxy = qobject_cast<const QAbstractProxyModel*>(model)) {
+        *index = proxy->mapToSource(*index);
+        model = proxy->sourceModel();
+    }
+    return dynamic_cast<const CostCellProvider*>(model);
+}
+}
+
+CostCellProvider::~CostCellProvider() = default;
+
 CostDelegate::CostDelegate(quint32 sortRole, quint32 totalCostRole, QObject* parent)
     : QStyledItemDelegate(parent)
     , m_sortRole(sortRole)
@@ -43,15 +60,32 @@ CostDelegate::~CostDelegate() = default;
 
 void CostDelegate::paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const
 {
-    // TODO: handle negative values
-    const auto cost = index.data(m_sortRole).toULongLong();
-    if (cost == 0) {
+    // cells outside of the repainted region don't need to get their text formatted at all
+    if (painter->hasClipping() && !painter->clipBoundingRect().intersects(option.rect)) {
+        return;
+    }
+
+    // negative costs only show up when diffing two results, they denote an improvement
+    qint64 cost = 0;
+    qint64 totalCost = 0;
+    bool hasCostBar = false;
+    auto sourceIndex = index;
+    if (const auto* provider = costCellProvider(&sourceIndex)) {
+        hasCostBar = provider->cellCost(sourceIndex, &cost, &totalCost);
+    } else {
+        cost = index.data(m_sortRole).toLongLong();
+        // columns without a total, like the derived metrics, don't get a cost bar
+        const auto totalCostData = index.data(m_totalCostRole);
+        hasCostBar = totalCostData.isValid();
+        totalCost = totalCostData.toLongLong();
+    }
+    if (cost == 0 || !hasCostBar) {
         QStyledItemDelegate::paint(painter, option, index);
         return;
     }
 
-    const auto totalCost = index.data(m_totalCostRole).toULongLong();
-    const auto fraction = std::abs(float(cost) / totalCost);
+    // a regression can be larger than the total cost of the baseline
+    const auto fraction = std::min(1.f, std::abs(float(cost) / totalCost));
 
     auto rect = option.rect;
     rect.setWidth(rect.width() * fraction);
@@ -68,7 +102,9 @@ void CostDelegate::paint(QPainter* painter, const QStyleOptionViewItem& option,
         painter->drawRect(option.rect);
     }
 
-    auto color = QColor::fromHsv(120 - fraction * 120, 255, 255, (-((fraction - 1) * (fraction - 1))) * 120 + 120);
+    const auto alpha = (-((fraction - 1) * (fraction - 1))) * 120 + 120;
+    auto color =
+        cost < 0 ? QColor::fromHsv(240, 255, 255, alpha) : QColor::fromHsv(120 - fraction * 120, 255, 255, alpha);
     painter->setBrush(color);
     painter->drawRect(rect);
 
@@ -29,6 +29,17 @@
 
 #include <QStyledItemDelegate>
 
+// implemented by the models whose cost columns get painted by the CostDelegate, which then reads the costs of the
+// visible cells directly instead of boxing them into QVariants for the sort and total cost roles
+class CostCellProvider
+{
+public:
+    virtual ~CostCellProvider();
+
+    // @return false when the cell at @p index has no cost bar, e.g. for the columns of the derived metrics
+    virtual bool cellCost(const QModelIndex& index, qint64* cost, qint64* totalCost) const = 0;
+};
+
 class CostDelegate : public QStyledItemDelegate
 {
     Q_OBJECT
@@ -0,0 +1,246 @@
+/*
+  cputopology.cpp
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "cputopology.h"
+
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+
+#include <algorithm>
+#include <atomic>
+
+#ifdef Q_OS_LINUX
+#include <sched.h>
+#endif
+
+namespace {
+#ifdef Q_OS_LINUX
+QVector<int> toCpus(const cpu_set_t& set)
+{
+    QVector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set)) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+bool toCpuSet(const QVector<int>& cpus, cpu_set_t* set)
+{
+    CPU_ZERO(set);
+    for (auto cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, set);
+        }
+    }
+    return CPU_COUNT(set) > 0;
+}
+#endif
+
+QVector<QVector<int>> readNumaNodes()
+{
+    const auto allowed = CpuTopology::threadAffinity();
+
+    // the directories are named after the node id, which needn't be contiguous
+    QVector<QPair<int, QVector<int>>> nodes;
+    const QDir sysNodes(QStringLiteral("/sys/devices/system/node"));
+    for (const auto& entry : sysNodes.entryList({QStringLiteral("node*")}, QDir::Dirs)) {
+        bool ok = false;
+        const auto nodeId = entry.midRef(4).toInt(&ok);
+        QFile cpuList(sysNodes.filePath(entry + QLatin1String("/cpulist")));
+        if (!ok || !cpuList.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+#ifdef Q_OS_LINUX
+        // CPUs beyond that can't be put into an affinity mask anyway
+        auto cpus = CpuTopology::parseCpuList(cpuList.readAll(), CPU_SETSIZE);
+#else
+        auto cpus = CpuTopology::parseCpuList(cpuList.readAll());
+#endif
+        if (!allowed.isEmpty()) {
+            cpus.erase(std::remove_if(cpus.begin(), cpus.end(), [&allowed](int cpu) { return !allowed.contains(cpu); }),
+                       cpus.end());
+        }
+        if (!cpus.isEmpty()) {
+            nodes.push_back(qMakePair(nodeId, cpus));
+        }
+    }
+    std::sort(nodes.begin(), nodes.end(),
+              [](const QPair<int, QVector<int>>& lhs, const QPair<int, QVector<int>>& rhs) {
+                  return lhs.first < rhs.first;
+              });
+
+    QVector<QVector<int>> ret;
+    ret.reserve(nodes.size());
+    for (const auto& node : nodes) {
+        ret.push_back(node.second);
+    }
+    if (ret.isEmpty()) {
+        ret.push_back(allowed);
+    }
+    return ret;
+}
+}
+
+QVector<int> CpuTopology::parseCpuList(const QByteArray& list, int maxCpus)
+{
+    QVector<int> cpus;
+    for (const auto& range : list.split(',')) {
+        const auto bounds = range.trimmed().split('-');
+        bool firstOk = false;
+        bool lastOk = true;
+        const auto first = bounds.first().toInt(&firstOk);
+        const auto last = bounds.size() > 1 ? bounds.at(1).toInt(&lastOk) : first;
+        if (!firstOk || !lastOk || first < 0 || last < first || last >= maxCpus) {
+            continue;
+        }
+        for (auto cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+const QVector<QVector<int>>& CpuTopology::numaNodes()
+{
+    static const auto nodes = readNumaNodes();
+    return nodes;
+}
+
+namespace {
+std::atomic<bool>& pinningEnabled()
+{
+    // read from the parser and filter threads, while the GUI thread may change it
+    static std::atomic<bool> enabled(qEnvironmentVariableIntValue("HOTSPOT_PIN_WORKERS") > 0);
+    return enabled;
+}
+}
+
+bool CpuTopology::isPinningEnabled()
+{
+    return pinningEnabled();
+}
+
+void CpuTopology::setPinningEnabled(bool enabled)
+{
+    pinningEnabled() = enabled;
+}
+
+int CpuTopology::workerNode(int worker, int numWorkers)
+{
+    const auto numNodes = numaNodes().size();
+    if (numWorkers <= numNodes) {
+        return worker % numNodes;
+    }
+    return static_cast<int>(static_cast<qint64>(worker) * numNodes / numWorkers);
+}
+
+int CpuTopology::currentNode()
+{
+#ifdef Q_OS_LINUX
+    const auto cpu = sched_getcpu();
+    const auto& nodes = numaNodes();
+    for (int i = 0, c = nodes.size(); i < c; ++i) {
+        if (nodes[i].contains(cpu)) {
+            return i;
+        }
+    }
+#endif
+    return 0;
+}
+
+QVector<int> CpuTopology::threadAffinity()
+{
+#ifdef Q_OS_LINUX
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        return toCpus(set);
+    }
+#endif
+    return {};
+}
+
+bool CpuTopology::setThreadAffinity(const QVector<int>& cpus)
+{
+    // for sched_setaffinity, pid 0 refers to the calling thread and not to the whole process
+    return setProcessAffinity(0, cpus);
+}
+
+bool CpuTopology::setProcessAffinity(qint64 pid, const QVector<int>& cpus)
+{
+#ifdef Q_OS_LINUX
+    cpu_set_t set;
+    return toCpuSet(cpus, &set) && sched_setaffinity(static_cast<pid_t>(pid), sizeof(set), &set) == 0;
+#else
+    Q_UNUSED(pid);
+    Q_UNUSED(cpus);
+    return false;
+#endif
+}
+
+void CpuTopology::pinWorker(int worker, int numWorkers)
+{
+    if (!isPinningEnabled() || numWorkers <= 0) {
+        return;
+    }
+
+    const auto node = workerNode(worker, numWorkers);
+    int index = 0;
+    int workersOnNode = 0;
+    for (int i = 0; i < numWorkers; ++i) {
+        if (workerNode(i, numWorkers) == node) {
+            if (i < worker) {
+                ++index;
+            }
+            ++workersOnNode;
+        }
+    }
+
+    // a core of its own when there are enough of them, the memory these workers allocate afterwards then gets
+    // placed on their node by the kernel's first-touch policy
+    const auto& cpus = numaNodes().at(node);
+    if (workersOnNode <= cpus.size()) {
+        setThreadAffinity({cpus.at(index)});
+    } else {
+        setThreadAffinity(cpus);
+    }
+}
+
+CpuTopology::ScopedAffinity::ScopedAffinity()
+    : m_cpus(threadAffinity())
+{
+}
+
+CpuTopology::ScopedAffinity::~ScopedAffinity()
+{
+    if (!m_cpus.isEmpty()) {
+        setThreadAffinity(m_cpus);
+    }
+}
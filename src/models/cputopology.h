@@ -0,0 +1,85 @@
+/*
+  cputopology.h
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <QVector>
+
+class QByteArray;
+
+// the NUMA topology of the host hotspot runs on, used to place the worker threads of the parser and the filters.
+// this is opt-in via setPinningEnabled or HOTSPOT_PIN_WORKERS, by default the scheduler is free to move all threads
+// around
+namespace CpuTopology {
+// the largest number of CPUs a Linux kernel can be configured for (NR_CPUS)
+const int MaxCpus = 8192;
+
+// @return the CPUs of a list like "0-3,8,10-11", as found in /sys and in the perf.data header. the lists come from
+// untrusted sources, so ranges that reach @p maxCpus or beyond are dropped
+QVector<int> parseCpuList(const QByteArray& list, int maxCpus = MaxCpus);
+
+// @return the CPUs this process may run on, grouped by their NUMA node. there is a single group when the host has
+// no NUMA topology or it can't be read, nodes without any usable CPU are left out
+const QVector<QVector<int>>& numaNodes();
+
+// @return true after setPinningEnabled(true), initially when HOTSPOT_PIN_WORKERS is set
+bool isPinningEnabled();
+
+// takes effect for the workers started afterwards, the running ones stay where they are
+void setPinningEnabled(bool enabled);
+
+// @return the index into numaNodes() for the @p worker out of @p numWorkers. the workers get spread over the nodes
+// in contiguous groups, such that neighboring workers share a node
+int workerNode(int worker, int numWorkers);
+
+// @return the index into numaNodes() of the CPU the calling thread currently runs on
+int currentNode();
+
+// @return the CPUs the calling thread may run on
+QVector<int> threadAffinity();
+
+// restrict the calling thread, or the process with @p pid, to @p cpus. @return false when that failed
+bool setThreadAffinity(const QVector<int>& cpus);
+bool setProcessAffinity(qint64 pid, const QVector<int>& cpus);
+
+// pin the calling thread to a core of its node, see workerNode, or to the whole node when it has fewer cores than
+// workers got placed on it. this does nothing unless pinning is enabled
+void pinWorker(int worker, int numWorkers);
+
+// restores the CPU affinity of the calling thread when going out of scope, for threads that get pinned temporarily
+class ScopedAffinity
+{
+public:
+    ScopedAffinity();
+    ~ScopedAffinity();
+
+private:
+    Q_DISABLE_COPY(ScopedAffinity)
+    QVector<int> m_cpus;
+};
+}
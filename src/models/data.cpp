@@ -26,112 +26,462 @@
 */
 
 #include "data.h"
+#include "instrumentation.h"
 
+#include <QCoreApplication>
+#include <QDataStream>
 #include <QDebug>
+#include <QIODevice>
+#include <QReadWriteLock>
 #include <QSet>
 
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+
 using namespace Data;
 
 namespace {
 
-ItemCost buildTopDownResult(const BottomUp& bottomUpData, const Costs& bottomUpCosts, TopDown* topDownData,
-                            Costs* inclusiveCosts, Costs* selfCosts, quint32* maxId)
-{
-    ItemCost totalCost;
-    totalCost.resize(bottomUpCosts.numTypes(), 0);
-    for (const auto& row : bottomUpData.children) {
-        // recurse and find the cost attributed to children
-        const auto childCost = buildTopDownResult(row, bottomUpCosts, topDownData, inclusiveCosts, selfCosts, maxId);
-        const auto rowCost = bottomUpCosts.itemCost(row.id);
-        const auto diff = rowCost - childCost;
-        if (diff.sum() != 0) {
-            // this row is (partially) a leaf
-            // bubble up the parent chain to build a top-down tree
-            auto node = &row;
-            auto stack = topDownData;
-            while (node) {
-                auto frame = stack->entryForSymbol(node->symbol, maxId);
+// all symbols share the strings of their entry: the binaries and paths are only stored once for all symbols of a DSO
+// and the prettified name only gets its own string when it differs from the symbol
+class SymbolTable
+{
+public:
+    struct Entry
+    {
+        quint32 id;
+        QString symbol;
+        QString prettySymbol;
+        QString binary;
+        QString path;
+    };
 
-                // always use the leaf node's cost and propagate that one up the chain
-                // otherwise we'd count the cost of some nodes multiple times
-                inclusiveCosts->add(frame->id, diff);
-                if (!node->parent) {
-                    selfCosts->add(frame->id, diff);
-                }
-                stack = frame;
-                node = node->parent;
+    Entry intern(const QString& symbol, const QString& binary, const QString& path)
+    {
+        const Entry key = {0, symbol, {}, binary, path};
+        {
+            QReadLocker locker(&m_lock);
+            auto it = m_entries.constFind(key);
+            if (it != m_entries.constEnd()) {
+                return resolved(*it);
+            }
+        }
+
+        QWriteLocker locker(&m_lock);
+        auto it = m_entries.constFind(key);
+        if (it != m_entries.constEnd()) {
+            return resolved(*it);
+        }
+        Entry entry;
+        // the id zero is reserved for the empty symbol. ids never get reused, as symbols of released entries may
+        // still be compared against new ones
+        entry.id = ++m_lastId;
+        // the names are mostly unique, so only the binaries and paths are worth deduplicating
+        entry.symbol = symbol;
+        // only stored when it differs, such that the table never holds more than one reference to the symbol
+        const auto prettySymbol = Data::prettifySymbol(entry.symbol);
+        if (prettySymbol.constData() != entry.symbol.constData()) {
+            entry.prettySymbol = prettySymbol;
+        }
+        entry.binary = internString(binary);
+        entry.path = internString(path);
+        m_entries.insert(entry);
+        return resolved(entry);
+    }
+
+    // drop all entries whose strings are only referenced by the table itself, i.e. no symbol uses them anymore
+    int releaseUnused()
+    {
+        QWriteLocker locker(&m_lock);
+        int released = 0;
+        for (auto it = m_entries.begin(); it != m_entries.end();) {
+            // the literals and the empty symbol are never detached, such entries are cheap to keep
+            if (it->symbol.isDetached()) {
+                it = m_entries.erase(it);
+                ++released;
+            } else {
+                ++it;
+            }
+        }
+        for (auto it = m_strings.begin(); it != m_strings.end();) {
+            if (it->isDetached()) {
+                it = m_strings.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        return released;
+    }
+
+private:
+    static Entry resolved(Entry entry)
+    {
+        if (entry.prettySymbol.isNull()) {
+            entry.prettySymbol = entry.symbol;
+        }
+        return entry;
+    }
+
+    // the entries are identified by their symbol, binary and path alone
+    friend bool operator==(const Entry& lhs, const Entry& rhs)
+    {
+        return std::tie(lhs.symbol, lhs.binary, lhs.path) == std::tie(rhs.symbol, rhs.binary, rhs.path);
+    }
+
+    friend uint qHash(const Entry& entry, uint seed)
+    {
+        Util::HashCombine hash;
+        seed = hash(seed, entry.symbol);
+        seed = hash(seed, entry.binary);
+        seed = hash(seed, entry.path);
+        return seed;
+    }
+
+    // must only be called while holding the write lock
+    QString internString(const QString& string)
+    {
+        auto it = m_strings.constFind(string);
+        if (it != m_strings.constEnd()) {
+            return *it;
+        }
+        m_strings.insert(string);
+        return string;
+    }
+
+    QReadWriteLock m_lock;
+    QSet<Entry> m_entries;
+    QSet<QString> m_strings;
+    quint32 m_lastId = 0;
+};
+
+SymbolTable& symbolTable()
+{
+    static SymbolTable table;
+    return table;
+}
+
+// writes the cost of @p row that is not attributed to any of its children into @p diff
+// returns true when that cost is non-zero, i.e. when @p row is (partially) a leaf
+bool leafCost(const BottomUp& row, const Costs& bottomUpCosts, QVector<qint64>* diff)
+{
+    const auto numTypes = bottomUpCosts.numTypes();
+    diff->fill(0, numTypes);
+    auto* cost = diff->data();
+    bottomUpCosts.itemCostView(row.id).addTo(cost, numTypes);
+    for (const auto& child : row.children) {
+        bottomUpCosts.itemCostView(child.id).subtractFrom(cost, numTypes);
+    }
+    // the costs of a diff can be negative, so check them one by one instead of their sum
+    return std::any_of(cost, cost + numTypes, [](qint64 typeCost) { return typeCost != 0; });
+}
+
+template<typename Tree>
+using NodeStack = QVector<QPair<const Tree*, int>>;
+
+// calls @p visit for @p node and all nodes below it, the children before their parents and in their order
+// this doesn't recurse to not overflow the stack for deep trees, @p stack is scratch space that can be reused
+template<typename Tree, typename Visitor>
+void forEachNodePostOrder(const Tree& node, NodeStack<Tree>* stack, Visitor visit)
+{
+    // every entry holds a node and the index of the next child to descend into
+    stack->resize(0);
+    stack->append(qMakePair(&node, 0));
+    while (!stack->isEmpty()) {
+        auto& top = stack->last();
+        if (top.second < top.first->children.size()) {
+            const auto* child = &top.first->children[top.second++];
+            stack->append(qMakePair(child, 0));
+        } else {
+            visit(*top.first);
+            stack->removeLast();
+        }
+    }
+}
+
+// replaces all children of every node in the tree below @p root for which @p isSignificant returns false by a single
+// "[other]" node, @p fold gets the id of that node and of every child it replaces to move its costs over
+// the subtrees of the replaced children are dropped, their costs are at most the ones of their root
+template<typename Tree, typename IsSignificant, typename Fold>
+void pruneTree(Tree* root, quint32* maxId, IsSignificant isSignificant, Fold fold)
+{
+    // the ids of results read back from a cache don't necessarily match the counter
+    NodeStack<Tree> stack;
+    for (const auto& child : root->children) {
+        forEachNodePostOrder(child, &stack, [maxId](const Tree& node) { *maxId = std::max(*maxId, node.id + 1); });
+    }
+
+    const Symbol otherSymbol(QStringLiteral("[other]"));
+    QVector<Tree*> pending = {root};
+    while (!pending.isEmpty()) {
+        auto* node = pending.takeLast();
+        const auto isPruned = [&isSignificant](const Tree& child) { return !isSignificant(child); };
+        if (std::none_of(node->children.cbegin(), node->children.cend(), isPruned)) {
+            for (auto& child : node->children) {
+                pending.append(&child);
+            }
+            continue;
+        }
+
+        Tree other;
+        other.symbol = otherSymbol;
+        other.id = (*maxId)++;
+        QVector<Tree> children;
+        for (const auto& child : node->children) {
+            if (isPruned(child)) {
+                fold(other.id, child.id);
+            } else {
+                children.append(child);
             }
         }
-        totalCost += rowCost;
+        children.append(other);
+        node->children = children;
+        // only the significant children need to be looked at, the [other] node has no children
+        for (int i = 0, c = children.size() - 1; i < c; ++i) {
+            pending.append(&node->children[i]);
+        }
+    }
+    Tree::initializeParents(root);
+}
+
+// @return true when any of the @p costs of @p id is at least @p threshold of the total cost of its type
+bool isSignificantCost(const Costs& costs, quint32 id, double threshold)
+{
+    for (int type = 0, c = costs.numTypes(); type < c; ++type) {
+        const auto totalCost = costs.totalCost(type);
+        if (totalCost && std::abs(costs.cost(type, id)) >= threshold * std::abs(totalCost)) {
+            return true;
+        }
     }
-    return totalCost;
+    return false;
+}
+
+// adds @p row and all rows below it to the top-down tree
+// @p diff and @p nodeStack are scratch space, reused for all rows to not allocate per node
+void buildTopDownResult(const BottomUp& row, const Costs& bottomUpCosts, TopDown* topDownData,
+                        Costs* inclusiveCosts, Costs* selfCosts, quint32* maxId, SymbolTreeIndex* index,
+                        QVector<qint64>* diff, NodeStack<BottomUp>* nodeStack)
+{
+    forEachNodePostOrder(row, nodeStack, [&](const BottomUp& leaf) {
+        if (!leafCost(leaf, bottomUpCosts, diff)) {
+            return;
+        }
+        // this row is (partially) a leaf
+        // bubble up the parent chain to build a top-down tree
+        auto node = &leaf;
+        auto stack = topDownData;
+        while (node) {
+            auto frame = stack->entryForSymbol(node->symbol, maxId, index);
+
+            // always use the leaf node's cost and propagate that one up the chain
+            // otherwise we'd count the cost of some nodes multiple times
+            inclusiveCosts->add(frame->id, diff->constData());
+            if (!node->parent) {
+                selfCosts->add(frame->id, diff->constData());
+            }
+            stack = frame;
+            node = node->parent;
+        }
+    });
+}
+
+int countNodes(const BottomUp& node, NodeStack<BottomUp>* nodeStack)
+{
+    int count = 0;
+    forEachNodePostOrder(node, nodeStack, [&count](const BottomUp&) { ++count; });
+    return count;
 }
 
-void add(ItemCost& lhs, const ItemCost& rhs)
+void add(ItemCost& lhs, const QVector<qint64>& rhs)
 {
     if (!lhs.size()) {
-        lhs = rhs;
-    } else {
-        Q_ASSERT(lhs.size() == rhs.size());
-        lhs += rhs;
+        lhs.resize(rhs.size(), 0);
     }
+    Q_ASSERT(lhs.size() == static_cast<size_t>(rhs.size()));
+    addCostRow(std::begin(lhs), rhs.constData(), rhs.size());
 }
 
-ItemCost buildCallerCalleeResult(const BottomUp& data, const Costs& bottomUpCosts, CallerCalleeResults* results)
+struct CallerCalleeGuards
 {
-    ItemCost totalCost;
-    totalCost.resize(bottomUpCosts.numTypes(), 0);
-    for (const auto& row : data.children) {
-        // recurse to find a leaf
-        const auto childCost = buildCallerCalleeResult(row, bottomUpCosts, results);
-        const auto rowCost = bottomUpCosts.itemCost(row.id);
-        const auto diff = rowCost - childCost;
-        if (diff.sum() != 0) {
+    RecursionGuard symbols;
+    // the (caller, callee) id pairs of the current stack, a pair can only repeat for recursive symbols
+    QVector<QPair<quint32, quint32>> pairs;
+};
+
+// @p diff and @p nodeStack are scratch space, reused for all rows to not allocate per node
+void buildCallerCalleeResult(const BottomUp& data, const Costs& bottomUpCosts, CallerCalleeResults* results,
+                             CallerCalleeGuards* guards, QVector<qint64>* diff, NodeStack<BottomUp>* nodeStack)
+{
+    // go down to find the leaves
+    const auto visit = [&](const BottomUp& row) {
+        if (leafCost(row, bottomUpCosts, diff)) {
             // this row is (partially) a leaf
 
             // leaf node found, bubble up the parent chain to add cost for all frames
             // to the caller/callee data. this is done top-down since we must not count
             // symbols more than once in the caller-callee data
-            QSet<Symbol> recursionGuard;
+            guards->symbols.reset();
+            guards->pairs.resize(0);
             auto node = &row;
 
-            QSet<QPair<Symbol, Symbol>> callerCalleeRecursionGuard;
             Data::Symbol lastSymbol;
-            Data::CallerCalleeEntry* lastEntry = nullptr;
+            bool lastSymbolRepeated = false;
+            const Data::CallerCalleeEntry* lastEntry = nullptr;
 
             while (node) {
                 const auto& symbol = node->symbol;
                 // aggregate caller-callee data
                 auto& entry = results->entry(symbol);
 
-                if (!recursionGuard.contains(symbol)) {
+                const bool isNewSymbol = guards->symbols.insert(symbol);
+                if (isNewSymbol) {
                     // only increment inclusive cost once for a given stack
-                    results->inclusiveCosts.add(entry.id, diff);
-                    recursionGuard.insert(symbol);
+                    results->inclusiveCosts.add(entry.id, diff->constData());
                 }
                 if (!node->parent) {
                     // always increment the self cost
-                    results->selfCosts.add(entry.id, diff);
+                    results->selfCosts.add(entry.id, diff->constData());
                 }
                 // add current entry as callee to last entry
                 // and last entry as caller to current entry
                 if (lastEntry) {
-                    const auto callerCalleePair = qMakePair(symbol, lastSymbol);
-                    if (!callerCalleeRecursionGuard.contains(callerCalleePair)) {
-                        add(lastEntry->callee(symbol, bottomUpCosts.numTypes()), diff);
-                        add(entry.caller(lastSymbol, bottomUpCosts.numTypes()), diff);
-                        callerCalleeRecursionGuard.insert(callerCalleePair);
+                    const auto callerCalleePair = qMakePair(symbol.id, lastSymbol.id);
+                    // a pair can only have been seen before when both of its symbols were
+                    const bool isNewPair = isNewSymbol || !lastSymbolRepeated
+                        || !std::any_of(guards->pairs.cbegin(), guards->pairs.cend(),
+                                        [&callerCalleePair](const QPair<quint32, quint32>& pair) {
+                                            return pair == callerCalleePair;
+                                        });
+                    if (isNewPair) {
+                        results->addCallerCallee(lastEntry->id, entry.id, diff->constData());
+                        guards->pairs.append(callerCalleePair);
                     }
                 }
 
                 node = node->parent;
                 lastSymbol = symbol;
+                lastSymbolRepeated = !isNewSymbol;
                 lastEntry = &entry;
             }
         }
-        totalCost += rowCost;
+    };
+    for (const auto& row : data.children) {
+        forEachNodePostOrder(row, nodeStack, visit);
+    }
+}
+
+template<typename Tree>
+void collectSubtreeIds(const Tree& node, QVector<quint32>* ids)
+{
+    // the ids get sorted afterwards, so the order doesn't matter here
+    NodeStack<Tree> stack;
+    forEachNodePostOrder(node, &stack, [ids](const Tree& subtreeNode) { ids->append(subtreeNode.id); });
+}
+
+// find all nodes in @p source that have no counterpart in @p target yet
+// this iterates instead of recursing, the trees can be deeper than the call stack allows
+template<typename Tree>
+void collectNewNodes(Tree* target, const Tree& source, QVector<quint32>* newIds, SymbolTreeIndex* index)
+{
+    // the target isn't modified here, so the pointers to its nodes stay valid
+    QVector<QPair<Tree*, const Tree*>> pending = {qMakePair(target, &source)};
+    while (!pending.isEmpty()) {
+        const auto next = pending.takeLast();
+        auto* rows = index->rowsFor(next.first);
+        for (const auto& child : next.second->children) {
+            if (auto* existing = next.first->findEntry(child.symbol, rows)) {
+                pending.append(qMakePair(existing, &child));
+            } else {
+                collectSubtreeIds(child, newIds);
+            }
+        }
+    }
+}
+
+void addCosts(quint32 targetId, const Costs& sourceCosts, quint32 sourceId, Costs* targetCosts)
+{
+    targetCosts->add(targetId, sourceCosts.itemCostView(sourceId));
+}
+
+void addTypes(const Costs& sourceCosts, Costs* targetCosts)
+{
+    for (int type = targetCosts->numTypes(), c = sourceCosts.numTypes(); type < c; ++type) {
+        targetCosts->addType(type, sourceCosts.typeName(type), sourceCosts.unit(type));
+    }
+}
+
+// @p addCosts gets called with the target and source id of every node to merge their costs
+template<typename Tree, typename AddCosts>
+Tree copySubtree(const Tree& source, const QVector<quint32>& idMap, AddCosts addCosts)
+{
+    Tree copy;
+    // like readTree, the children of a node get allocated at once before copying them, so the pointers stay valid
+    QVector<QPair<Tree*, const Tree*>> pending = {qMakePair(&copy, &source)};
+    while (!pending.isEmpty()) {
+        const auto next = pending.takeLast();
+        auto* node = next.first;
+        const auto* sourceNode = next.second;
+        node->symbol = sourceNode->symbol;
+        node->id = idMap[sourceNode->id];
+        addCosts(node->id, sourceNode->id);
+        node->children.resize(sourceNode->children.size());
+        for (int i = sourceNode->children.size() - 1; i >= 0; --i) {
+            pending.append(qMakePair(&node->children[i], &sourceNode->children[i]));
+        }
+    }
+    return copy;
+}
+
+template<typename Tree, typename AddCosts>
+void mergeNodes(Tree* target, const Tree& source, const QVector<quint32>& idMap, AddCosts addCosts,
+                SymbolTreeIndex* index)
+{
+    // iterate depth-first instead of recursing, the trees can be deeper than the call stack allows. like the
+    // recursion, only the children of the topmost target get appended to, so the targets below stay valid
+    struct Frame
+    {
+        Tree* target;
+        const Tree* source;
+        QHash<Symbol, int>* rows;
+        int nextChild;
+    };
+    QVector<Frame> stack = {{target, &source, index->rowsFor(target), 0}};
+    while (!stack.isEmpty()) {
+        auto& top = stack.last();
+        if (top.nextChild == top.source->children.size()) {
+            stack.removeLast();
+            continue;
+        }
+        const auto& child = top.source->children[top.nextChild++];
+        if (auto* existing = top.target->findEntry(child.symbol, top.rows)) {
+            addCosts(existing->id, child.id);
+            stack.append({existing, &child, index->rowsFor(existing), 0});
+        } else {
+            top.target->children.append(copySubtree(child, idMap, addCosts));
+            if (top.rows) {
+                top.rows->insert(child.symbol, top.target->children.size() - 1);
+            } else {
+                top.rows = index->rowsFor(top.target);
+            }
+        }
+    }
+}
+
+// counting sort of the pair indices by @p ids
+void indexPairs(const QVector<quint32>& ids, QVector<int>* pairs, QVector<int>* offsets)
+{
+    const quint32 numIds = ids.isEmpty() ? 0 : *std::max_element(ids.begin(), ids.end()) + 1;
+    offsets->fill(0, numIds + 1);
+    for (auto id : ids) {
+        ++(*offsets)[id + 1];
+    }
+    std::partial_sum(offsets->begin(), offsets->end(), offsets->begin());
+    pairs->resize(ids.size());
+    auto next = *offsets;
+    for (int pair = 0; pair < ids.size(); ++pair) {
+        (*pairs)[next[ids[pair]]++] = pair;
     }
-    return totalCost;
 }
 
 static int findSameDepth(const QStringRef& str, int offset, QChar ch, bool returnNext = false)
@@ -274,6 +624,24 @@ QString prettifySymbol(const QStringRef& str)
 }
 }
 
+Symbol::Symbol(const QString& symbol, const QString& binary, const QString& path)
+{
+    if (!symbol.isEmpty() || !binary.isEmpty() || !path.isEmpty()) {
+        // use the interned strings, such that the ones of the caller can get released
+        const auto entry = symbolTable().intern(symbol, binary, path);
+        this->symbol = entry.symbol;
+        prettySymbol = entry.prettySymbol;
+        this->binary = entry.binary;
+        this->path = entry.path;
+        id = entry.id;
+    }
+}
+
+int Data::releaseUnusedSymbols()
+{
+    return symbolTable().releaseUnused();
+}
+
 QString Data::prettifySymbol(const QString& name)
 {
     const auto result = ::prettifySymbol(QStringRef(&name));
@@ -282,21 +650,429 @@ QString Data::prettifySymbol(const QString& name)
 
 TopDownResults TopDownResults::fromBottomUp(const BottomUpResults& bottomUpData)
 {
-    TopDownResults results;
-    results.selfCosts.initializeCostsFrom(bottomUpData.costs);
-    results.inclusiveCosts.initializeCostsFrom(bottomUpData.costs);
-    quint32 maxId = 0;
-    buildTopDownResult(bottomUpData.root, bottomUpData.costs, &results.root, &results.inclusiveCosts,
-                       &results.selfCosts, &maxId);
+    Instrumentation::ScopedTimer instrumentation("TopDownResults::fromBottomUp");
+    const auto& rows = bottomUpData.root.children;
+
+    // split the top-level rows into consecutive ranges of similar size, one per thread
+    QVector<int> rangeBegins = {0};
+    const int numThreads = std::min(QThread::idealThreadCount(), rows.size() / MinRowsPerFragment);
+    if (numThreads > 1) {
+        QVector<int> nodeCounts(rows.size());
+        int numNodes = 0;
+        NodeStack<BottomUp> stack;
+        for (int i = 0, c = rows.size(); i < c; ++i) {
+            nodeCounts[i] = countNodes(rows[i], &stack);
+            numNodes += nodeCounts[i];
+        }
+        for (int i = 0, c = rows.size(), nodes = 0; i < c; ++i) {
+            nodes += nodeCounts[i];
+            if (nodes >= static_cast<qint64>(numNodes) * rangeBegins.size() / numThreads && i + 1 < c) {
+                rangeBegins.append(i + 1);
+            }
+        }
+    }
+    rangeBegins.append(rows.size());
+
+    // build a fragment of the top-down tree for every range in parallel
+    QVector<TopDownResults> fragments(rangeBegins.size() - 1);
+    auto* fragmentData = fragments.data();
+    auto buildFragments = [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            auto& fragment = fragmentData[i];
+            fragment.selfCosts.initializeCostsFrom(bottomUpData.costs);
+            fragment.inclusiveCosts.initializeCostsFrom(bottomUpData.costs);
+            QVector<qint64> diff;
+            NodeStack<BottomUp> stack;
+            for (int row = rangeBegins[i]; row < rangeBegins[i + 1]; ++row) {
+                buildTopDownResult(rows[row], bottomUpData.costs, &fragment.root, &fragment.inclusiveCosts,
+                                   &fragment.selfCosts, &fragment.maxTopDownId, &fragment.childIndex, &diff,
+                                   &stack);
+            }
+        }
+    };
+    Util::parallelFor(fragments.size(), buildFragments, 1);
+
+    // merging the fragments in order yields the same ids as building them all in one go
+    TopDownResults results = std::move(fragments.first());
+    for (int i = 1, c = fragments.size(); i < c; ++i) {
+        results.merge(fragments[i]);
+        fragments[i] = {};
+    }
+    results.dropChildIndex();
     TopDown::initializeParents(&results.root);
     return results;
 }
 
 void Data::callerCalleesFromBottomUpData(const BottomUpResults& bottomUpData, CallerCalleeResults* results)
 {
+    Instrumentation::ScopedTimer instrumentation("callerCalleesFromBottomUpData");
     results->inclusiveCosts.initializeCostsFrom(bottomUpData.costs);
     results->selfCosts.initializeCostsFrom(bottomUpData.costs);
-    buildCallerCalleeResult(bottomUpData.root, bottomUpData.costs, results);
+    results->callerCalleeCosts.initializeCostsFrom(bottomUpData.costs);
+    CallerCalleeGuards guards;
+    QVector<qint64> diff;
+    NodeStack<BottomUp> stack;
+    buildCallerCalleeResult(bottomUpData.root, bottomUpData.costs, results, &guards, &diff, &stack);
+    results->finalize();
+}
+
+void BottomUpResults::merge(const BottomUpResults& other)
+{
+    addTypes(other.costs, &costs);
+    for (int type = 0, c = other.costs.numTypes(); type < c; ++type) {
+        costs.addTotalCost(type, other.costs.totalCost(type));
+    }
+
+    // new nodes get their ids in the order they were created in other, which is also the order
+    // they would have gotten when the events would have been added to this tree directly
+    QVector<quint32> newIds;
+    collectNewNodes(&root, other.root, &newIds, &childIndex);
+    std::sort(newIds.begin(), newIds.end());
+    QVector<quint32> idMap(other.maxBottomUpId, 0);
+    for (auto id : newIds) {
+        idMap[id] = maxBottomUpId++;
+    }
+
+    mergeNodes(&root, other.root, idMap,
+               [this, &other](quint32 targetId, quint32 sourceId) {
+                   addCosts(targetId, other.costs, sourceId, &costs);
+               },
+               &childIndex);
+}
+
+void BottomUpResults::prune(double threshold)
+{
+    if (threshold <= 0) {
+        return;
+    }
+    dropChildIndex();
+    pruneTree(&root, &maxBottomUpId,
+              [this, threshold](const BottomUp& node) { return isSignificantCost(costs, node.id, threshold); },
+              [this](quint32 otherId, quint32 id) { costs.add(otherId, costs.itemCost(id)); });
+}
+
+void TopDownResults::addEvent(int type, quint64 cost, const QVector<Symbol>& stack)
+{
+    if (stack.isEmpty()) {
+        return;
+    }
+
+    // the names of the types get filled in by initializeCostsFrom later on
+    if (type >= inclusiveCosts.numTypes()) {
+        inclusiveCosts.addType(type, {}, Costs::Unit::Unknown);
+        selfCosts.addType(type, {}, Costs::Unit::Unknown);
+    }
+
+    auto parent = &root;
+    for (auto it = stack.rbegin(), end = stack.rend(); it != end; ++it) {
+        parent = parent->entryForSymbol(*it, &maxTopDownId, &childIndex);
+        inclusiveCosts.add(type, parent->id, cost);
+    }
+    selfCosts.add(type, parent->id, cost);
+}
+
+void TopDownResults::addEvent(const TypedCosts& eventCosts, const QVector<Symbol>& stack)
+{
+    if (stack.isEmpty()) {
+        return;
+    }
+
+    for (const auto& eventCost : eventCosts) {
+        if (eventCost.type >= inclusiveCosts.numTypes()) {
+            inclusiveCosts.addType(eventCost.type, {}, Costs::Unit::Unknown);
+            selfCosts.addType(eventCost.type, {}, Costs::Unit::Unknown);
+        }
+    }
+
+    auto parent = &root;
+    for (auto it = stack.rbegin(), end = stack.rend(); it != end; ++it) {
+        parent = parent->entryForSymbol(*it, &maxTopDownId, &childIndex);
+        for (const auto& eventCost : eventCosts) {
+            inclusiveCosts.add(eventCost.type, parent->id, eventCost.cost);
+        }
+    }
+    for (const auto& eventCost : eventCosts) {
+        selfCosts.add(eventCost.type, parent->id, eventCost.cost);
+    }
+}
+
+namespace {
+// interns every symbol without its path once, such that the same function of two builds maps to the same symbol
+class DiffSymbols
+{
+public:
+    Symbol operator()(const Symbol& symbol)
+    {
+        if (symbol.path.isEmpty()) {
+            return symbol;
+        }
+        auto it = m_symbols.find(symbol.id);
+        if (it == m_symbols.end()) {
+            it = m_symbols.insert(symbol.id, Symbol(symbol.symbol, symbol.binary));
+        }
+        return it.value();
+    }
+
+private:
+    QHash<quint32, Symbol> m_symbols;
+};
+
+// @return the mapping of the cost types of @p source to the ones of @p target, adding the missing types
+QVector<int> mapCostTypes(const Costs& source, Costs* target)
+{
+    QVector<int> typeMap(source.numTypes(), -1);
+    for (int type = 0, c = source.numTypes(); type < c; ++type) {
+        for (int targetType = 0, numTargetTypes = target->numTypes(); targetType < numTargetTypes; ++targetType) {
+            if (target->typeName(targetType) == source.typeName(type)) {
+                typeMap[type] = targetType;
+                break;
+            }
+        }
+        if (typeMap[type] == -1) {
+            typeMap[type] = target->numTypes();
+            target->addType(typeMap[type], source.typeName(type), source.unit(type));
+        }
+    }
+    return typeMap;
+}
+
+void diffNodes(BottomUp* target, const BottomUp& source, const Costs& sourceCosts, const QVector<int>& typeMap,
+               qint64 sign, Costs* targetCosts, quint32* maxId, SymbolTreeIndex* index, DiffSymbols* symbols)
+{
+    // iterate depth-first instead of recursing, the trees can be deeper than the call stack allows. like the
+    // recursion, only the children of the topmost target get appended to, so the targets below stay valid
+    struct Frame
+    {
+        BottomUp* target;
+        const BottomUp* source;
+        int nextChild;
+    };
+    QVector<Frame> stack = {{target, &source, 0}};
+    while (!stack.isEmpty()) {
+        auto& top = stack.last();
+        if (top.nextChild == top.source->children.size()) {
+            stack.removeLast();
+            continue;
+        }
+        const auto& child = top.source->children[top.nextChild++];
+        auto* entry = top.target->entryForSymbol((*symbols)(child.symbol), maxId, index);
+        for (int type = 0, c = typeMap.size(); type < c; ++type) {
+            targetCosts->add(typeMap[type], entry->id, sign * sourceCosts.cost(type, child.id));
+        }
+        stack.append({entry, &child, 0});
+    }
+}
+}
+
+qint32 BottomUpResults::outermostLocation(qint32 locationId) const
+{
+    while (locationId >= 0 && locationId < locations.size()) {
+        const auto parentLocationId = locations[locationId].parentLocationId;
+        if (parentLocationId == -1) {
+            return locationId;
+        }
+        locationId = parentLocationId;
+    }
+    return -1;
+}
+
+QVector<qint32> BottomUpResults::collapseInlinedFrames(const QVector<qint32>& frames) const
+{
+    QVector<qint32> ret;
+    ret.reserve(frames.size());
+    for (auto locationId : frames) {
+        const auto outermost = outermostLocation(locationId);
+        if (outermost != -1) {
+            ret.push_back(outermost);
+        }
+    }
+    return ret;
+}
+
+QVector<qint32> BottomUpResults::collapseRecursion(const QVector<qint32>& frames) const
+{
+    QVector<qint32> ret;
+    ret.reserve(frames.size());
+    Symbol lastSymbol;
+    for (auto locationId : frames) {
+        // a location with inlined frames is only dropped when all of them belong to the recursing function
+        bool isRecursion = lastSymbol.isValid();
+        Symbol outermostSymbol;
+        handleFrame(locationId, [&](const Symbol& symbol, const Location& /*location*/) {
+            isRecursion = isRecursion && symbol == lastSymbol;
+            outermostSymbol = symbol;
+            return true;
+        });
+        if (!isRecursion) {
+            ret.push_back(locationId);
+            lastSymbol = outermostSymbol;
+        }
+    }
+    return ret;
+}
+
+BottomUpResults BottomUpResults::diff(const BottomUpResults& baseline, const BottomUpResults& candidate)
+{
+    BottomUpResults results;
+    DiffSymbols symbols;
+
+    const auto candidateTypes = mapCostTypes(candidate.costs, &results.costs);
+    diffNodes(&results.root, candidate.root, candidate.costs, candidateTypes, 1, &results.costs,
+              &results.maxBottomUpId, &results.childIndex, &symbols);
+    const auto baselineTypes = mapCostTypes(baseline.costs, &results.costs);
+    diffNodes(&results.root, baseline.root, baseline.costs, baselineTypes, -1, &results.costs,
+              &results.maxBottomUpId, &results.childIndex, &symbols);
+
+    // the totals of the baseline, or of the candidate for the types that only got recorded there
+    QVector<qint64> totalCosts(results.costs.numTypes(), 0);
+    for (int type = 0, c = candidateTypes.size(); type < c; ++type) {
+        totalCosts[candidateTypes[type]] = candidate.costs.totalCost(type);
+    }
+    for (int type = 0, c = baselineTypes.size(); type < c; ++type) {
+        totalCosts[baselineTypes[type]] = baseline.costs.totalCost(type);
+    }
+    results.costs.setTotalCosts(totalCosts);
+
+    results.dropChildIndex();
+    BottomUp::initializeParents(&results.root);
+    return results;
+}
+
+void TopDownResults::merge(const TopDownResults& other)
+{
+    addTypes(other.selfCosts, &selfCosts);
+    addTypes(other.inclusiveCosts, &inclusiveCosts);
+
+    QVector<quint32> newIds;
+    collectNewNodes(&root, other.root, &newIds, &childIndex);
+    std::sort(newIds.begin(), newIds.end());
+    QVector<quint32> idMap(other.maxTopDownId, 0);
+    for (auto id : newIds) {
+        idMap[id] = maxTopDownId++;
+    }
+
+    mergeNodes(&root, other.root, idMap,
+               [this, &other](quint32 targetId, quint32 sourceId) {
+                   addCosts(targetId, other.selfCosts, sourceId, &selfCosts);
+                   addCosts(targetId, other.inclusiveCosts, sourceId, &inclusiveCosts);
+               },
+               &childIndex);
+}
+
+void TopDownResults::prune(double threshold)
+{
+    if (threshold <= 0) {
+        return;
+    }
+    dropChildIndex();
+    // the [other] node has no children, so all of its inclusive cost is its self cost
+    pruneTree(&root, &maxTopDownId,
+              [this, threshold](const TopDown& node) { return isSignificantCost(inclusiveCosts, node.id, threshold); },
+              [this](quint32 otherId, quint32 id) {
+                  const auto cost = inclusiveCosts.itemCost(id);
+                  inclusiveCosts.add(otherId, cost);
+                  selfCosts.add(otherId, cost);
+              });
+}
+
+int IdPairs::add(quint32 first, quint32 second)
+{
+    if (m_indices.isEmpty() && !m_first.isEmpty()) {
+        // dropped by finalize()
+        m_indices.reserve(m_first.size());
+        for (int pair = 0; pair < m_first.size(); ++pair) {
+            m_indices.insert(key(m_first[pair], m_second[pair]), pair);
+        }
+    }
+    auto it = m_indices.find(key(first, second));
+    if (it == m_indices.end()) {
+        it = m_indices.insert(key(first, second), m_first.size());
+        m_first.append(first);
+        m_second.append(second);
+    }
+    return *it;
+}
+
+void IdPairs::finalize()
+{
+    indexPairs(m_first, &m_byFirst, &m_firstOffsets);
+    indexPairs(m_second, &m_bySecond, &m_secondOffsets);
+    m_indices = {};
+}
+
+int CallerCalleeResults::source(quint32 id, const QString& location, int numTypes)
+{
+    for (int type = sourceSelfCosts.numTypes(); type < numTypes; ++type) {
+        sourceSelfCosts.addType(type, {}, Costs::Unit::Unknown);
+        sourceInclusiveCosts.addType(type, {}, Costs::Unit::Unknown);
+    }
+    return sourcePairs.add(id, locationId(location));
+}
+
+CallerMap CallerCalleeResults::callers(quint32 id) const
+{
+    CallerMap callers;
+    for (auto pair : callerCalleePairs.withSecond(id)) {
+        callers.insert(symbols[callerCalleePairs.first(pair)], callerCalleeCosts.itemCost(pair));
+    }
+    return callers;
+}
+
+CalleeMap CallerCalleeResults::callees(quint32 id) const
+{
+    CalleeMap callees;
+    for (auto pair : callerCalleePairs.withFirst(id)) {
+        callees.insert(symbols[callerCalleePairs.second(pair)], callerCalleeCosts.itemCost(pair));
+    }
+    return callees;
+}
+
+LocationCostMap CallerCalleeResults::sourceMap(quint32 id) const
+{
+    LocationCostMap sourceMap;
+    for (auto pair : sourcePairs.withFirst(id)) {
+        auto& cost = sourceMap[locations[sourcePairs.second(pair)]];
+        cost.selfCost = sourceSelfCosts.itemCost(pair);
+        cost.inclusiveCost = sourceInclusiveCosts.itemCost(pair);
+    }
+    return sourceMap;
+}
+
+void CallerCalleeResults::finalize()
+{
+    callerCalleePairs.finalize();
+    sourcePairs.finalize();
+}
+
+void CallerCalleeResults::merge(const CallerCalleeResults& other)
+{
+    addTypes(other.selfCosts, &selfCosts);
+    addTypes(other.inclusiveCosts, &inclusiveCosts);
+    addTypes(other.callerCalleeCosts, &callerCalleeCosts);
+    addTypes(other.sourceSelfCosts, &sourceSelfCosts);
+    addTypes(other.sourceInclusiveCosts, &sourceInclusiveCosts);
+
+    // the entries of other are created in id order, which also yields the order of their symbols
+    QVector<quint32> idMap(other.symbols.size());
+    for (quint32 id = 0; id < static_cast<quint32>(other.symbols.size()); ++id) {
+        const auto& target = entry(other.symbols[id]);
+        idMap[id] = target.id;
+        addCosts(target.id, other.selfCosts, id, &selfCosts);
+        addCosts(target.id, other.inclusiveCosts, id, &inclusiveCosts);
+    }
+
+    for (int pair = 0; pair < other.callerCalleePairs.size(); ++pair) {
+        const auto callerId = idMap[other.callerCalleePairs.first(pair)];
+        const auto targetPair = callerCalleePairs.add(callerId, idMap[other.callerCalleePairs.second(pair)]);
+        addCosts(targetPair, other.callerCalleeCosts, pair, &callerCalleeCosts);
+    }
+
+    for (int pair = 0; pair < other.sourcePairs.size(); ++pair) {
+        const auto& location = other.locations[other.sourcePairs.second(pair)];
+        const auto targetPair = source(idMap[other.sourcePairs.first(pair)], location, 0);
+        addCosts(targetPair, other.sourceSelfCosts, pair, &sourceSelfCosts);
+        addCosts(targetPair, other.sourceInclusiveCosts, pair, &sourceInclusiveCosts);
+    }
 }
 
 QDebug Data::operator<<(QDebug stream, const Symbol& symbol)
@@ -334,14 +1110,800 @@ QDebug Data::operator<<(QDebug stream, const CostSummary& cost)
     return stream.resetFormat().space();
 }
 
-Data::ThreadEvents* Data::EventResults::findThread(qint32 pid, qint32 tid)
+QDataStream& Data::operator<<(QDataStream& stream, const Symbol& symbol)
 {
-    for (int i = threads.size() - 1; i >= 0; --i) {
-        auto& thread = threads[i];
-        if (thread.pid == pid && thread.tid == tid) {
-            return &thread;
-        }
-    }
+    // the prettified name and the id get recomputed when interning the symbol again
+    return stream << symbol.symbol << symbol.binary << symbol.path;
+}
+
+QDataStream& Data::operator>>(QDataStream& stream, Symbol& symbol)
+{
+    QString name;
+    QString binary;
+    QString path;
+    stream >> name >> binary >> path;
+    symbol = Symbol(name, binary, path);
+    return stream;
+}
+
+QDataStream& Data::operator<<(QDataStream& stream, const Location& location)
+{
+    return stream << location.address << location.location;
+}
+
+QDataStream& Data::operator>>(QDataStream& stream, Location& location)
+{
+    return stream >> location.address >> location.location;
+}
+
+QDataStream& Data::operator<<(QDataStream& stream, const FrameLocation& location)
+{
+    return stream << location.parentLocationId << location.location;
+}
+
+QDataStream& Data::operator>>(QDataStream& stream, FrameLocation& location)
+{
+    return stream >> location.parentLocationId >> location.location;
+}
+
+QDataStream& Data::operator<<(QDataStream& stream, const Events& events)
+{
+    return stream << events.m_times << events.m_costs << events.m_types << events.m_stackIds << events.m_cpuIds;
+}
+
+QDataStream& Data::operator>>(QDataStream& stream, Events& events)
+{
+    stream >> events.m_times >> events.m_costs >> events.m_types >> events.m_stackIds >> events.m_cpuIds;
+    const auto size = events.m_times.size();
+    if (events.m_costs.size() != size || events.m_types.size() != size || events.m_stackIds.size() != size
+        || events.m_cpuIds.size() != size) {
+        // never hand out inconsistent columns
+        events.clear();
+        stream.setStatus(QDataStream::ReadCorruptData);
+    }
+    return stream;
+}
+
+QDataStream& Data::operator<<(QDataStream& stream, const ThreadEvents& thread)
+{
+    return stream << thread.pid << thread.tid << thread.time.start << thread.time.end << thread.events << thread.name
+                  << thread.fileId << thread.lastSwitchTime << thread.offCpuTime << static_cast<qint32>(thread.state);
+}
+
+QDataStream& Data::operator>>(QDataStream& stream, ThreadEvents& thread)
+{
+    qint32 state = ThreadEvents::Unknown;
+    stream >> thread.pid >> thread.tid >> thread.time.start >> thread.time.end >> thread.events >> thread.name
+        >> thread.fileId >> thread.lastSwitchTime >> thread.offCpuTime >> state;
+    thread.state = static_cast<ThreadEvents::State>(state);
+    return stream;
+}
+
+QDataStream& Data::operator<<(QDataStream& stream, const CostSummary& cost)
+{
+    return stream << cost.label << cost.sampleCount << cost.totalPeriod << static_cast<qint32>(cost.unit);
+}
+
+QDataStream& Data::operator>>(QDataStream& stream, CostSummary& cost)
+{
+    qint32 unit = 0;
+    stream >> cost.label >> cost.sampleCount >> cost.totalPeriod >> unit;
+    cost.unit = static_cast<Costs::Unit>(unit);
+    return stream;
+}
+
+QDataStream& Data::operator<<(QDataStream& stream, const Summary& summary)
+{
+    return stream << summary.applicationRunningTime << summary.threadCount << summary.processCount << summary.command
+                  << summary.lostChunks << summary.hostName << summary.linuxKernelVersion << summary.perfVersion
+                  << summary.cpuDescription << summary.cpuId << summary.cpuArchitecture << summary.cpusOnline
+                  << summary.cpusAvailable << summary.cpuSiblingCores << summary.cpuSiblingThreads
+                  << summary.totalMemoryInKiB << summary.onCpuTime << summary.offCpuTime << summary.sampleCount
+                  << summary.costs << summary.errors;
+}
+
+QDataStream& Data::operator>>(QDataStream& stream, Summary& summary)
+{
+    return stream >> summary.applicationRunningTime >> summary.threadCount >> summary.processCount >> summary.command
+        >> summary.lostChunks >> summary.hostName >> summary.linuxKernelVersion >> summary.perfVersion
+        >> summary.cpuDescription >> summary.cpuId >> summary.cpuArchitecture >> summary.cpusOnline
+        >> summary.cpusAvailable >> summary.cpuSiblingCores >> summary.cpuSiblingThreads >> summary.totalMemoryInKiB
+        >> summary.onCpuTime >> summary.offCpuTime >> summary.sampleCount >> summary.costs >> summary.errors;
+}
+
+QDataStream& Data::operator<<(QDataStream& stream, const TracepointEvents& tracepoint)
+{
+    stream << tracepoint.system << tracepoint.name << tracepoint.fileId << tracepoint.times << tracepoint.threadIds
+           << tracepoint.strings << static_cast<quint32>(tracepoint.fields.size());
+    for (const auto& field : tracepoint.fields) {
+        stream << field.name << static_cast<qint8>(field.type) << field.values;
+    }
+    return stream;
+}
+
+QDataStream& Data::operator>>(QDataStream& stream, TracepointEvents& tracepoint)
+{
+    quint32 numFields = 0;
+    stream >> tracepoint.system >> tracepoint.name >> tracepoint.fileId >> tracepoint.times >> tracepoint.threadIds
+        >> tracepoint.strings >> numFields;
+    tracepoint.fields.resize(numFields);
+    for (auto& field : tracepoint.fields) {
+        qint8 type = 0;
+        stream >> field.name >> type >> field.values;
+        field.type = static_cast<TracepointField::Type>(type);
+    }
+    return stream;
+}
+
+QDataStream& Data::operator<<(QDataStream& stream, const ContextSwitchTrack& track)
+{
+    return stream << track.fileId << track.times << track.threadIds;
+}
+
+QDataStream& Data::operator>>(QDataStream& stream, ContextSwitchTrack& track)
+{
+    return stream >> track.fileId >> track.times >> track.threadIds;
+}
+
+QDataStream& Data::operator<<(QDataStream& stream, const EventResults& events)
+{
+    return stream << events.threads << events.numCpus << events.cpuNumaNodes << events.stacks << events.totalCosts
+                  << events.offCpuTimeCostId << events.files << events.tracepoints << events.contextSwitches;
+}
+
+QDataStream& Data::operator>>(QDataStream& stream, EventResults& events)
+{
+    return stream >> events.threads >> events.numCpus >> events.cpuNumaNodes >> events.stacks >> events.totalCosts
+        >> events.offCpuTimeCostId >> events.files >> events.tracepoints >> events.contextSwitches;
+}
+
+QDataStream& Data::operator<<(QDataStream& stream, const Costs& costs)
+{
+    QVector<qint32> units;
+    units.reserve(costs.m_units.size());
+    for (auto unit : costs.m_units) {
+        units.push_back(static_cast<qint32>(unit));
+    }
+    return stream << costs.m_typeNames << units << costs.m_totalCosts << costs.m_numRows << costs.m_costs;
+}
+
+QDataStream& Data::operator>>(QDataStream& stream, Costs& costs)
+{
+    QVector<qint32> units;
+    stream >> costs.m_typeNames >> units >> costs.m_totalCosts >> costs.m_numRows >> costs.m_costs;
+    const auto numTypes = costs.m_typeNames.size();
+    if (units.size() != numTypes || costs.m_totalCosts.size() != numTypes
+        || static_cast<quint64>(costs.m_costs.size()) != static_cast<quint64>(costs.m_numRows) * numTypes) {
+        costs = {};
+        stream.setStatus(QDataStream::ReadCorruptData);
+        return stream;
+    }
+    costs.m_units.resize(numTypes);
+    for (int type = 0; type < numTypes; ++type) {
+        costs.m_units[type] = static_cast<Costs::Unit>(units[type]);
+    }
+    return stream;
+}
+
+// the nodes get written in pre-order, each followed by its number of children. like Tree::setParents, this
+// iterates instead of recursing since the trees can be deeper than the call stack allows
+template<typename Impl>
+static void writeTree(QDataStream& stream, const Impl& root)
+{
+    QVector<const Impl*> pending = {&root};
+    while (!pending.isEmpty()) {
+        const auto* node = pending.takeLast();
+        stream << node->symbol << node->id << node->children.size();
+        for (int i = node->children.size() - 1; i >= 0; --i) {
+            pending.append(&node->children[i]);
+        }
+    }
+}
+
+template<typename Impl>
+static void readTree(QDataStream& stream, Impl* root, quint32* maxId)
+{
+    *maxId = 0;
+    // the children of a node get allocated at once before reading them, so the pointers stay valid
+    QVector<Impl*> pending = {root};
+    while (!pending.isEmpty() && stream.status() == QDataStream::Ok) {
+        auto* node = pending.takeLast();
+        int numChildren = 0;
+        stream >> node->symbol >> node->id >> numChildren;
+        // every child takes more than a byte, which rejects corrupt sizes before allocating them
+        if (numChildren < 0 || (stream.device() && numChildren > stream.device()->bytesAvailable())) {
+            stream.setStatus(QDataStream::ReadCorruptData);
+            break;
+        }
+        if (node != root) {
+            *maxId = std::max(*maxId, node->id + 1);
+        }
+        node->children.resize(numChildren);
+        for (int i = numChildren - 1; i >= 0; --i) {
+            pending.append(&node->children[i]);
+        }
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        *root = {};
+        *maxId = 0;
+        return;
+    }
+    Impl::initializeParents(root);
+}
+
+QDataStream& Data::operator<<(QDataStream& stream, const BottomUpResults& results)
+{
+    writeTree(stream, results.root);
+    return stream << results.costs;
+}
+
+QDataStream& Data::operator>>(QDataStream& stream, BottomUpResults& results)
+{
+    readTree(stream, &results.root, &results.maxBottomUpId);
+    return stream >> results.costs;
+}
+
+QDataStream& Data::operator<<(QDataStream& stream, const TopDownResults& results)
+{
+    writeTree(stream, results.root);
+    return stream << results.selfCosts << results.inclusiveCosts;
+}
+
+QDataStream& Data::operator>>(QDataStream& stream, TopDownResults& results)
+{
+    readTree(stream, &results.root, &results.maxTopDownId);
+    return stream >> results.selfCosts >> results.inclusiveCosts;
+}
+
+QDataStream& Data::operator<<(QDataStream& stream, const IdPairs& pairs)
+{
+    return stream << pairs.m_first << pairs.m_second;
+}
+
+QDataStream& Data::operator>>(QDataStream& stream, IdPairs& pairs)
+{
+    pairs = {};
+    stream >> pairs.m_first >> pairs.m_second;
+    if (pairs.m_first.size() != pairs.m_second.size()) {
+        pairs = {};
+        stream.setStatus(QDataStream::ReadCorruptData);
+        return stream;
+    }
+    pairs.finalize();
+    return stream;
+}
+
+QDataStream& Data::operator<<(QDataStream& stream, const CallerCalleeResults& results)
+{
+    // the entries and location ids are lookups into the symbols and locations, which get rebuilt when reading
+    return stream << results.symbols << results.selfCosts << results.inclusiveCosts << results.callerCalleePairs
+                  << results.callerCalleeCosts << results.sourcePairs << results.sourceSelfCosts
+                  << results.sourceInclusiveCosts << results.locations;
+}
+
+QDataStream& Data::operator>>(QDataStream& stream, CallerCalleeResults& results)
+{
+    results = {};
+    stream >> results.symbols >> results.selfCosts >> results.inclusiveCosts >> results.callerCalleePairs
+        >> results.callerCalleeCosts >> results.sourcePairs >> results.sourceSelfCosts >> results.sourceInclusiveCosts
+        >> results.locations;
+    if (stream.status() != QDataStream::Ok) {
+        results = {};
+        return stream;
+    }
+
+    results.entries.reserve(results.symbols.size());
+    for (int id = 0, c = results.symbols.size(); id < c; ++id) {
+        CallerCalleeEntry entry;
+        entry.id = static_cast<quint32>(id);
+        results.entries.insert(results.symbols[id], entry);
+    }
+    results.locationIds.reserve(results.locations.size());
+    for (int id = 0, c = results.locations.size(); id < c; ++id) {
+        results.locationIds.insert(results.locations[id], static_cast<quint32>(id));
+    }
+    return stream;
+}
+
+QDataStream& Data::operator<<(QDataStream& stream, const ApproximationStats& stats)
+{
+    return stream << stats.sampleRate << stats.sampledEvents << stats.totalEvents << stats.variances;
+}
+
+QDataStream& Data::operator>>(QDataStream& stream, ApproximationStats& stats)
+{
+    return stream >> stats.sampleRate >> stats.sampledEvents >> stats.totalEvents >> stats.variances;
+}
+
+QDataStream& Data::operator<<(QDataStream& stream, const FilterAction& filter)
+{
+    return stream << filter.time.start << filter.time.end << filter.processId << filter.threadId << filter.cpuId
+                  << filter.fileId << filter.excludeProcessIds << filter.excludeThreadIds << filter.excludeCpuIds
+                  << filter.excludeFileIds << filter.includeSymbols << filter.excludeSymbols
+                  << filter.collapseInlinedFrames << filter.collapseRecursion << filter.sampleRate
+                  << filter.pruneThreshold;
+}
+
+QDataStream& Data::operator>>(QDataStream& stream, FilterAction& filter)
+{
+    return stream >> filter.time.start >> filter.time.end >> filter.processId >> filter.threadId >> filter.cpuId
+        >> filter.fileId >> filter.excludeProcessIds >> filter.excludeThreadIds >> filter.excludeCpuIds
+        >> filter.excludeFileIds >> filter.includeSymbols >> filter.excludeSymbols >> filter.collapseInlinedFrames
+        >> filter.collapseRecursion >> filter.sampleRate >> filter.pruneThreshold;
+}
+
+QDataStream& Data::operator<<(QDataStream& stream, const ZoomAction& zoom)
+{
+    return stream << zoom.time.start << zoom.time.end;
+}
+
+QDataStream& Data::operator>>(QDataStream& stream, ZoomAction& zoom)
+{
+    return stream >> zoom.time.start >> zoom.time.end;
+}
+
+template<typename T>
+static bool containsAll(const QVector<T>& haystack, const QVector<T>& needles)
+{
+    return std::all_of(needles.begin(), needles.end(), [&haystack](const T& needle) { return haystack.contains(needle); });
+}
+
+bool Data::FilterAction::isRefinementOf(const FilterAction& other) const
+{
+    if (other.time.isValid()) {
+        const auto otherTime = other.time.normalized();
+        const auto thisTime = time.normalized();
+        if (!time.isValid() || thisTime.start < otherTime.start || thisTime.end > otherTime.end) {
+            return false;
+        }
+    }
+
+    return (other.processId == INVALID_PID || other.processId == processId)
+        && (other.threadId == INVALID_TID || other.threadId == threadId)
+        && (other.cpuId == INVALID_CPU_ID || other.cpuId == cpuId) && containsAll(excludeProcessIds, other.excludeProcessIds)
+        && (other.fileId == INVALID_FILE_ID || other.fileId == fileId)
+        && containsAll(excludeThreadIds, other.excludeThreadIds) && containsAll(excludeCpuIds, other.excludeCpuIds)
+        && containsAll(excludeFileIds, other.excludeFileIds)
+        && includeSymbols.contains(other.includeSymbols) && excludeSymbols.contains(other.excludeSymbols);
+}
+
+Data::FilterAction Data::FilterAction::normalized() const
+{
+    auto ret = *this;
+    ret.time = time.normalized();
+    std::sort(ret.excludeProcessIds.begin(), ret.excludeProcessIds.end());
+    ret.excludeProcessIds.erase(std::unique(ret.excludeProcessIds.begin(), ret.excludeProcessIds.end()),
+                                ret.excludeProcessIds.end());
+    std::sort(ret.excludeThreadIds.begin(), ret.excludeThreadIds.end());
+    ret.excludeThreadIds.erase(std::unique(ret.excludeThreadIds.begin(), ret.excludeThreadIds.end()),
+                               ret.excludeThreadIds.end());
+    std::sort(ret.excludeCpuIds.begin(), ret.excludeCpuIds.end());
+    ret.excludeCpuIds.erase(std::unique(ret.excludeCpuIds.begin(), ret.excludeCpuIds.end()), ret.excludeCpuIds.end());
+    std::sort(ret.excludeFileIds.begin(), ret.excludeFileIds.end());
+    ret.excludeFileIds.erase(std::unique(ret.excludeFileIds.begin(), ret.excludeFileIds.end()),
+                             ret.excludeFileIds.end());
+    return ret;
+}
+
+uint Data::qHash(const FilterAction& filter, uint seed)
+{
+    // the symbol sets are unordered, so combine their hashes in an order independent way
+    auto hashSymbols = [](const QSet<Symbol>& symbols) {
+        uint ret = 0;
+        for (const auto& symbol : symbols) {
+            ret += qHash(symbol);
+        }
+        return ret;
+    };
+
+    Util::HashCombine hash;
+    seed = hash(seed, filter.time.start);
+    seed = hash(seed, filter.time.end);
+    seed = hash(seed, filter.processId);
+    seed = hash(seed, filter.threadId);
+    seed = hash(seed, filter.cpuId);
+    seed = hash(seed, filter.fileId);
+    seed = hash(seed, filter.excludeProcessIds);
+    seed = hash(seed, filter.excludeThreadIds);
+    seed = hash(seed, filter.excludeCpuIds);
+    seed = hash(seed, filter.excludeFileIds);
+    seed = hash(seed, hashSymbols(filter.includeSymbols));
+    seed = hash(seed, hashSymbols(filter.excludeSymbols));
+    seed = hash(seed, filter.collapseInlinedFrames);
+    seed = hash(seed, filter.collapseRecursion);
+    seed = hash(seed, filter.sampleRate);
+    seed = hash(seed, filter.pruneThreshold);
+    return seed;
+}
+
+namespace {
+// strips the PMU and the modifiers of perf event names, e.g. "cpu/cycles/u" and "cycles:ppp" both become "cycles"
+QString normalizedEventName(const QString& name)
+{
+    auto ret = name.trimmed().toLower();
+    const auto pmu = ret.indexOf(QLatin1Char('/'));
+    if (pmu != -1) {
+        const auto end = ret.indexOf(QLatin1Char('/'), pmu + 1);
+        ret = ret.mid(pmu + 1, end == -1 ? -1 : end - pmu - 1);
+    }
+    const auto modifiers = ret.indexOf(QLatin1Char(':'));
+    if (modifiers != -1) {
+        ret.truncate(modifiers);
+    }
+    // the aliases perf accepts for the same hardware events
+    if (ret == QLatin1String("cpu-cycles")) {
+        return QStringLiteral("cycles");
+    } else if (ret == QLatin1String("branches")) {
+        return QStringLiteral("branch-instructions");
+    }
+    return ret;
+}
+
+int findEventType(const QVector<QString>& typeNames, const QString& event)
+{
+    const auto needle = normalizedEventName(event);
+    for (int type = 0, c = typeNames.size(); type < c; ++type) {
+        if (normalizedEventName(typeNames[type]) == needle) {
+            return type;
+        }
+    }
+    return -1;
+}
+
+QVector<QString> costTypeNames(const Costs& costs)
+{
+    QVector<QString> ret(costs.numTypes());
+    for (int type = 0, c = costs.numTypes(); type < c; ++type) {
+        ret[type] = costs.typeName(type);
+    }
+    return ret;
+}
+}
+
+QString Data::DerivedMetric::formatValue(double value) const
+{
+    if (std::isnan(value)) {
+        return {};
+    }
+    switch (format) {
+    case Format::Percentage:
+        return QString::number(value * 100., 'f', 2) + QLatin1Char('%');
+    case Format::Ratio:
+        break;
+    }
+    return QString::number(value, 'f', 2);
+}
+
+Data::DerivedMetric Data::parseDerivedMetric(const QString& name, const QString& formula,
+                                             const QVector<QString>& typeNames, DerivedMetric::Format format,
+                                             bool higherIsBetter)
+{
+    DerivedMetric metric;
+    metric.name = name;
+    metric.formula = formula;
+    metric.format = format;
+    metric.higherIsBetter = higherIsBetter;
+
+    // the operator needs to be surrounded by spaces, the PMU syntax of perf uses slashes too
+    const auto operands = formula.split(QLatin1String(" / "));
+    if (operands.size() == 2) {
+        metric.numerator = findEventType(typeNames, operands[0]);
+        metric.denominator = findEventType(typeNames, operands[1]);
+    }
+    if (!metric.isValid()) {
+        metric.numerator = -1;
+        metric.denominator = -1;
+    }
+    return metric;
+}
+
+QVector<Data::DerivedMetric> Data::derivedMetrics(const QVector<QString>& typeNames)
+{
+    struct BuiltinMetric
+    {
+        const char* name;
+        const char* formula;
+        DerivedMetric::Format format;
+        bool higherIsBetter;
+    };
+    static const BuiltinMetric builtins[] = {
+        {QT_TRANSLATE_NOOP("DerivedMetric", "IPC"), "instructions / cycles", DerivedMetric::Format::Ratio, true},
+        {QT_TRANSLATE_NOOP("DerivedMetric", "Cache Miss Rate"), "cache-misses / cache-references",
+         DerivedMetric::Format::Percentage, false},
+        {QT_TRANSLATE_NOOP("DerivedMetric", "Branch Miss Rate"), "branch-misses / branch-instructions",
+         DerivedMetric::Format::Percentage, false},
+        {QT_TRANSLATE_NOOP("DerivedMetric", "L1d Miss Rate"), "L1-dcache-load-misses / L1-dcache-loads",
+         DerivedMetric::Format::Percentage, false},
+    };
+
+    QVector<DerivedMetric> ret;
+    for (const auto& builtin : builtins) {
+        auto metric = parseDerivedMetric(QCoreApplication::translate("DerivedMetric", builtin.name),
+                                         QString::fromLatin1(builtin.formula), typeNames, builtin.format,
+                                         builtin.higherIsBetter);
+        if (metric.isValid()) {
+            ret.append(metric);
+        }
+    }
+    return ret;
+}
+
+QVector<Data::DerivedMetric> Data::derivedMetrics(const Costs& costs)
+{
+    return derivedMetrics(costTypeNames(costs));
+}
+
+Data::DerivedMetricValues::DerivedMetricValues(const Costs& costs)
+    : m_metrics(derivedMetrics(costs))
+{
+    m_values.reserve(m_metrics.size());
+    m_totalValues.reserve(m_metrics.size());
+    for (const auto& metric : m_metrics) {
+        m_values.append(costs.ratios(metric.numerator, metric.denominator));
+        m_totalValues.append(metric.value(costs.totalCost(metric.numerator), costs.totalCost(metric.denominator)));
+    }
+}
+
+double Data::ApproximationStats::errorBound(int type) const
+{
+    // the estimated costs are approximately normally distributed, so they lie within 1.96 standard deviations
+    return 1.96 * std::sqrt(variances.value(type));
+}
+
+void Data::ApproximationStats::merge(const ApproximationStats& other)
+{
+    // the threads and cost types get sampled independently, so their variances add up
+    sampleRate = std::max(sampleRate, other.sampleRate);
+    sampledEvents += other.sampledEvents;
+    totalEvents += other.totalEvents;
+    if (variances.size() < other.variances.size()) {
+        variances.resize(other.variances.size());
+    }
+    for (int type = 0, c = other.variances.size(); type < c; ++type) {
+        variances[type] += other.variances[type];
+    }
+}
+
+double Data::ParseProgress::eventsPerSecond() const
+{
+    return elapsed ? 1E9 * events / elapsed : 0.;
+}
+
+double Data::ParseProgress::samplesPerSecond() const
+{
+    return elapsed ? 1E9 * samples / elapsed : 0.;
+}
+
+qint64 Data::ParseProgress::remainingTime() const
+{
+    // the first percent or so is dominated by loading the debug information, extrapolating from that is too far off
+    if (stage != Stage::Parsing || fraction < 0.01f || elapsed < 1000000000) {
+        return -1;
+    }
+    return static_cast<qint64>(elapsed * (1. - std::min(fraction, 1.f)) / fraction);
+}
+
+Data::EventSample Data::sampleEvents(const Events& events, int numTypes, int sampleRate, quint32 seed,
+                                     ApproximationStats* stats)
+{
+    const int numEvents = events.size();
+    QVector<int> numTypeEvents(numTypes);
+    QVector<double> typeCosts(numTypes);
+    for (int i = 0; i < numEvents; ++i) {
+        const auto type = events.type(i);
+        if (type >= 0 && type < numTypes) {
+            ++numTypeEvents[type];
+            typeCosts[type] += events.cost(i);
+        }
+    }
+
+    // draw a uniform sample of fixed size for every type in a single pass over the events, see algorithm R
+    sampleRate = std::max(1, sampleRate);
+    QVector<QVector<int>> reservoirs(numTypes);
+    QVector<int> reservoirSizes(numTypes);
+    QVector<int> numSeen(numTypes);
+    for (int type = 0; type < numTypes; ++type) {
+        reservoirSizes[type] = (numTypeEvents[type] + sampleRate - 1) / sampleRate;
+        reservoirs[type].reserve(reservoirSizes[type]);
+    }
+    std::mt19937 random(seed);
+    for (int i = 0; i < numEvents; ++i) {
+        const auto type = events.type(i);
+        if (type < 0 || type >= numTypes) {
+            continue;
+        }
+        auto& reservoir = reservoirs[type];
+        const auto size = reservoirSizes[type];
+        const auto seen = numSeen[type]++;
+        if (seen < size) {
+            reservoir.push_back(i);
+        } else {
+            const auto slot = std::uniform_int_distribution<int>(0, seen)(random);
+            if (slot < size) {
+                reservoir[slot] = i;
+            }
+        }
+    }
+
+    // scale the sampled costs such that the total cost of every type remains exact
+    QVector<double> scales(numTypes, 1.);
+    if (stats->variances.size() < numTypes) {
+        stats->variances.resize(numTypes);
+    }
+    stats->sampleRate = std::max(stats->sampleRate, sampleRate);
+    EventSample sample;
+    for (int type = 0; type < numTypes; ++type) {
+        const auto& reservoir = reservoirs[type];
+        double sampledCost = 0;
+        double sampledSquares = 0;
+        for (const auto i : reservoir) {
+            const double cost = events.cost(i);
+            sampledCost += cost;
+            sampledSquares += cost * cost;
+        }
+        if (sampledCost > 0) {
+            scales[type] = typeCosts[type] / sampledCost;
+        }
+
+        // the estimated cost of any subset of the events has the largest variance when it contains half of the
+        // cost, where it is bound by (1 - k/n) * n^2 * E[cost^2] / 4k for k out of n events
+        const double n = numTypeEvents[type];
+        const double k = reservoir.size();
+        if (k > 0 && k < n) {
+            stats->variances[type] += (1. - k / n) * n * n * (sampledSquares / k) / (4. * k);
+        }
+        stats->sampledEvents += reservoir.size();
+        stats->totalEvents += numTypeEvents[type];
+        sample.indices += reservoir;
+    }
+
+    std::sort(sample.indices.begin(), sample.indices.end());
+    sample.costs.reserve(sample.indices.size());
+    for (const auto i : sample.indices) {
+        sample.costs.push_back(static_cast<quint64>(std::llround(events.cost(i) * scales[events.type(i)])));
+    }
+    return sample;
+}
+
+int Data::TracepointEvents::fieldIndex(const QString& fieldName) const
+{
+    for (int i = 0, c = fields.size(); i < c; ++i) {
+        if (fields[i].name == fieldName) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+QString Data::TracepointEvents::formatValue(int field, int row) const
+{
+    const auto& column = fields[field];
+    const auto value = column.values[row];
+    return column.type == TracepointField::Type::String ? strings.value(static_cast<int>(value))
+                                                        : QString::number(value);
+}
+
+QMap<qint64, Data::TracepointGroup> Data::TracepointEvents::groupBy(int keyField, int valueField,
+                                                                    const TimeRange& time) const
+{
+    QMap<qint64, TracepointGroup> groups;
+    const auto& keys = fields[keyField].values;
+    const auto* values = valueField == -1 ? nullptr : &fields[valueField].values;
+    for (int row = 0, c = size(); row < c; ++row) {
+        if (!time.contains(times[row])) {
+            continue;
+        }
+        auto& group = groups[keys[row]];
+        ++group.count;
+        if (values) {
+            group.sum += values->at(row);
+        }
+    }
+    return groups;
+}
+
+Data::ThreadIntervalIndex::ThreadIntervalIndex(const QVector<ThreadEvents>& threads)
+{
+    m_nodes.reserve(threads.size());
+    for (int i = 0, c = threads.size(); i < c; ++i) {
+        m_nodes.push_back({threads[i].time, 0, i});
+    }
+    std::sort(m_nodes.begin(), m_nodes.end(),
+              [](const Node& lhs, const Node& rhs) { return lhs.time.start < rhs.time.start; });
+    buildMaxEnd(0, m_nodes.size());
+}
+
+quint64 Data::ThreadIntervalIndex::buildMaxEnd(int begin, int end)
+{
+    if (begin >= end) {
+        return 0;
+    }
+    const auto mid = begin + (end - begin) / 2;
+    auto& node = m_nodes[mid];
+    node.maxEnd = std::max({node.time.end, buildMaxEnd(begin, mid), buildMaxEnd(mid + 1, end)});
+    return node.maxEnd;
+}
+
+void Data::ThreadIntervalIndex::collect(int begin, int end, const TimeRange& time, QVector<int>* threads) const
+{
+    if (begin >= end) {
+        return;
+    }
+    const auto mid = begin + (end - begin) / 2;
+    const auto& node = m_nodes[mid];
+    if (node.maxEnd < time.start) {
+        // every thread within this subtree ended before the time range
+        return;
+    }
+    collect(begin, mid, time, threads);
+    if (node.time.start > time.end) {
+        // this thread and all threads to its right start after the time range
+        return;
+    }
+    if (node.time.end >= time.start) {
+        threads->push_back(node.thread);
+    }
+    collect(mid + 1, end, time, threads);
+}
+
+QVector<int> Data::ThreadIntervalIndex::overlapping(const TimeRange& time) const
+{
+    QVector<int> threads;
+    collect(0, m_nodes.size(), time, &threads);
+    std::sort(threads.begin(), threads.end());
+    return threads;
+}
+
+Data::SymbolStackIndex::SymbolStackIndex(const QVector<QVector<qint32>>& stacks, const BottomUpResults& bottomUp)
+    : m_numStacks(stacks.size())
+{
+    int stackId = 0;
+    auto addSymbol = [this, &stackId](const Symbol& symbol, const Location& /*location*/) -> bool {
+        if (!symbol.isValid()) {
+            return true;
+        }
+        auto& symbolStacks = m_stacks[symbol.id];
+        // recursive stacks contain the same symbol multiple times, but we only want to list each stack once
+        if (symbolStacks.isEmpty() || symbolStacks.last() != stackId) {
+            symbolStacks.push_back(stackId);
+        }
+        return true;
+    };
+    for (; stackId < m_numStacks; ++stackId) {
+        bottomUp.foreachFrame(stacks[stackId], addSymbol);
+    }
+    for (auto& symbolStacks : m_stacks) {
+        symbolStacks.squeeze();
+    }
+}
+
+QVector<qint32> Data::SymbolStackIndex::stacks(const Symbol& symbol) const
+{
+    return m_stacks.value(symbol.id);
+}
+
+QBitArray Data::SymbolStackIndex::stackMask(const Symbol& symbol) const
+{
+    const auto it = m_stacks.constFind(symbol.id);
+    if (it == m_stacks.constEnd()) {
+        return {};
+    }
+    QBitArray mask(m_numStacks);
+    for (auto stackId : *it) {
+        mask.setBit(stackId);
+    }
+    return mask;
+}
+
+Data::ThreadEvents* Data::EventResults::findThread(qint32 pid, qint32 tid)
+{
+    for (int i = threads.size() - 1; i >= 0; --i) {
+        auto& thread = threads[i];
+        if (thread.pid == pid && thread.tid == tid) {
+            return &thread;
+        }
+    }
 
     return nullptr;
 }
@@ -350,3 +1912,212 @@ const Data::ThreadEvents* Data::EventResults::findThread(qint32 pid, qint32 tid)
 {
     return const_cast<Data::EventResults*>(this)->findThread(pid, tid);
 }
+
+void Data::ContextSwitchTrack::add(quint64 time, qint32 tid, bool switchOut)
+{
+    if (!times.isEmpty() && time < times.last()) {
+        return;
+    }
+
+    const bool isRunning = !threadIds.isEmpty() && threadIds.last() == tid;
+    if (switchOut) {
+        // the next thread may have been switched in at the same time already
+        if (!isRunning) {
+            return;
+        }
+        tid = INVALID_TID;
+    } else if (isRunning) {
+        return;
+    }
+
+    if (!times.isEmpty() && times.last() == time) {
+        // the switch out and the switch in of the next thread happened at once
+        threadIds.last() = tid;
+        if (threadIds.size() > 1 && threadIds[threadIds.size() - 2] == tid) {
+            times.removeLast();
+            threadIds.removeLast();
+        }
+        return;
+    }
+
+    times.push_back(time);
+    threadIds.push_back(tid);
+}
+
+int Data::ContextSwitchTrack::sliceAt(quint64 time) const
+{
+    return static_cast<int>(std::upper_bound(times.begin(), times.end(), time) - times.begin()) - 1;
+}
+
+void Data::ContextSwitchTrack::dropBefore(quint64 time)
+{
+    dropFirst(sliceAt(time));
+}
+
+void Data::ContextSwitchTrack::dropFirst(int count)
+{
+    if (count > 0) {
+        times = times.mid(count);
+        threadIds = threadIds.mid(count);
+    }
+}
+
+QVector<Data::CpuEvents> Data::EventResults::cpuEvents() const
+{
+    // first only reference the events, sorting those is much cheaper than sorting the events themselves
+    struct EventRef
+    {
+        quint64 time;
+        int thread;
+        int event;
+    };
+    QVector<QVector<EventRef>> refs(numCpus);
+    for (int threadIndex = 0, numThreads = threads.size(); threadIndex < numThreads; ++threadIndex) {
+        const auto& events = threads[threadIndex].events;
+        for (int i = 0, c = events.size(); i < c; ++i) {
+            const auto cpuId = events.cpuId(i);
+            if (events.type(i) == offCpuTimeCostId || cpuId >= numCpus) {
+                continue;
+            }
+            refs[cpuId].push_back({events.time(i), threadIndex, i});
+        }
+    }
+
+    QVector<CpuEvents> ret;
+    for (quint32 cpuId = 0; cpuId < numCpus; ++cpuId) {
+        auto& cpuRefs = refs[cpuId];
+        // without any threads only the CPU layout is known, e.g. from the file header, which lists all of them
+        if (cpuRefs.isEmpty() && !threads.isEmpty()) {
+            continue;
+        }
+        // the events of each thread are sorted already, keep their order for events at the same time
+        std::stable_sort(cpuRefs.begin(), cpuRefs.end(),
+                         [](const EventRef& lhs, const EventRef& rhs) { return lhs.time < rhs.time; });
+        CpuEvents cpu;
+        cpu.cpuId = cpuId;
+        cpu.events.reserve(cpuRefs.size());
+        for (const auto& ref : cpuRefs) {
+            cpu.events.push_back(threads[ref.thread].events.at(ref.event));
+        }
+        cpuRefs = {};
+        ret.push_back(cpu);
+    }
+    return ret;
+}
+
+Data::CpuUtilization Data::EventResults::cpuUtilization(qint32 type, const TimeRange& time, int numBuckets) const
+{
+    CpuUtilization ret;
+    if (!time.isValid() || numBuckets <= 0) {
+        return ret;
+    }
+    ret.time = time;
+    ret.numBuckets = numBuckets;
+    ret.bucketDuration = std::max(quint64(1), (time.delta() + numBuckets - 1) / numBuckets);
+
+    QVector<quint64> cpuCosts(numCpus * numBuckets, 0);
+    QVector<bool> hasEvents(numCpus, false);
+    for (const auto& thread : threads) {
+        const auto& events = thread.events;
+        const auto& times = events.times();
+        // the events are sorted by time, so only look at the ones within the time range
+        auto i = static_cast<int>(std::lower_bound(times.begin(), times.end(), time.start) - times.begin());
+        for (const int c = events.size(); i < c && events.time(i) <= time.end; ++i) {
+            const auto cpuId = events.cpuId(i);
+            if (events.type(i) != type || cpuId >= numCpus) {
+                continue;
+            }
+            const auto bucket =
+                std::min(numBuckets - 1, static_cast<int>((events.time(i) - time.start) / ret.bucketDuration));
+            cpuCosts[cpuId * numBuckets + bucket] += events.cost(i);
+            hasEvents[cpuId] = true;
+        }
+    }
+
+    for (quint32 cpuId = 0; cpuId < numCpus; ++cpuId) {
+        if (hasEvents[cpuId]) {
+            ret.cpuIds.push_back(cpuId);
+        }
+    }
+    auto numaNode = [this](quint32 cpuId) { return cpuNumaNodes.value(cpuId, -1); };
+    std::stable_sort(ret.cpuIds.begin(), ret.cpuIds.end(),
+                     [numaNode](quint32 lhs, quint32 rhs) { return numaNode(lhs) < numaNode(rhs); });
+
+    ret.costs.reserve(ret.cpuIds.size() * numBuckets);
+    for (const auto cpuId : ret.cpuIds) {
+        ret.numaNodes.push_back(numaNode(cpuId));
+        for (int bucket = 0; bucket < numBuckets; ++bucket) {
+            const auto cost = cpuCosts[cpuId * numBuckets + bucket];
+            ret.costs.push_back(cost);
+            ret.maxCost = std::max(ret.maxCost, cost);
+        }
+    }
+    return ret;
+}
+
+namespace {
+template<typename Tree>
+quint64 countDescendants(const Tree& tree)
+{
+    quint64 ret = tree.children.size();
+    for (const auto& child : tree.children) {
+        ret += countDescendants(child);
+    }
+    return ret;
+}
+
+quint64 stringSize(const QString& string)
+{
+    return string.size() * sizeof(QChar);
+}
+}
+
+Data::MemoryUsage Data::memoryUsage(const BottomUpResults& bottomUp, const TopDownResults& topDown,
+                                    const CallerCalleeResults& callerCallee, const EventResults& events)
+{
+    MemoryUsage usage;
+    const quint64 numTypes = bottomUp.costs.numTypes();
+
+    for (const auto& symbol : bottomUp.symbols) {
+        usage.symbols += sizeof(Symbol);
+        usage.strings += stringSize(symbol.symbol) + stringSize(symbol.prettySymbol) + stringSize(symbol.binary)
+            + stringSize(symbol.path);
+    }
+    for (const auto& location : bottomUp.locations) {
+        usage.locations += sizeof(FrameLocation);
+        usage.strings += stringSize(location.location.location);
+    }
+
+    for (const auto& stack : events.stacks) {
+        usage.stacks += sizeof(stack) + stack.size() * sizeof(qint32);
+    }
+    for (const auto& thread : events.threads) {
+        usage.events += sizeof(ThreadEvents) + stringSize(thread.name) + thread.events.size() * EVENT_SIZE;
+    }
+    for (const auto& track : events.contextSwitches) {
+        usage.events += sizeof(ContextSwitchTrack) + track.size() * (sizeof(quint64) + sizeof(qint32));
+    }
+    for (const auto& tracepoint : events.tracepoints) {
+        usage.events += sizeof(TracepointEvents)
+            + tracepoint.size() * (sizeof(quint64) + sizeof(qint32) + tracepoint.fields.size() * sizeof(qint64));
+        for (const auto& string : tracepoint.strings) {
+            usage.strings += stringSize(string);
+        }
+    }
+
+    usage.bottomUp = countDescendants(bottomUp.root) * (sizeof(BottomUp) + numTypes * sizeof(qint64));
+    // the top down tree has inclusive and self costs
+    usage.topDown = countDescendants(topDown.root) * (sizeof(TopDown) + 2 * numTypes * sizeof(qint64));
+
+    // the pairs take two ids and two range index entries each
+    const quint64 pairSize = 2 * sizeof(quint32) + 2 * sizeof(int);
+    usage.callerCallee = callerCallee.entries.size()
+            * (2 * sizeof(Symbol) + sizeof(CallerCalleeEntry) + 2 * numTypes * sizeof(qint64))
+        + callerCallee.callerCalleePairs.size() * (pairSize + numTypes * sizeof(qint64))
+        + callerCallee.sourcePairs.size() * (pairSize + 2 * numTypes * sizeof(qint64))
+        + callerCallee.locations.size() * 2 * sizeof(QString);
+    for (const auto& location : callerCallee.locations) {
+        usage.strings += stringSize(location);
+    }
+    return usage;
+}
@@ -27,7 +27,9 @@
 
 #pragma once
 
+#include <QBitArray>
 #include <QHash>
+#include <QMap>
 #include <QMetaType>
 #include <QString>
 #include <QTypeInfo>
@@ -36,23 +38,24 @@
 
 #include "../util.h"
 
+class QDataStream;
+
+#include <algorithm>
 #include <functional>
+#include <iterator>
 #include <limits>
 #include <tuple>
 #include <valarray>
+#include <vector>
 
 namespace Data {
 QString prettifySymbol(const QString& symbol);
 
 struct Symbol
 {
-    Symbol(const QString& symbol = {}, const QString& binary = {}, const QString& path = {})
-        : symbol(symbol)
-        , prettySymbol(Data::prettifySymbol(symbol))
-        , binary(binary)
-        , path(path)
-    {
-    }
+    // the symbol gets interned in a global table, which assigns the id and computes the prettified name
+    // only once per unique symbol. all symbols share the strings of that table, so equal texts are only stored once
+    Symbol(const QString& symbol = {}, const QString& binary = {}, const QString& path = {});
 
     // function name
     QString symbol;
@@ -62,6 +65,9 @@ struct Symbol
     QString binary;
     // path to dso / executable
     QString path;
+    // interned id, shared by all symbols with the same name, binary and path
+    // zero is reserved for the empty symbol
+    quint32 id = 0;
 
     bool operator<(const Symbol& rhs) const
     {
@@ -70,7 +76,7 @@ struct Symbol
 
     bool isValid() const
     {
-        return !symbol.isEmpty() || !binary.isEmpty() || !path.isEmpty();
+        return id != 0;
     }
 };
 
@@ -78,7 +84,7 @@ QDebug operator<<(QDebug stream, const Symbol& symbol);
 
 inline bool operator==(const Symbol& lhs, const Symbol& rhs)
 {
-    return std::tie(lhs.symbol, lhs.binary, lhs.path) == std::tie(rhs.symbol, rhs.binary, rhs.path);
+    return lhs.id == rhs.id;
 }
 
 inline bool operator!=(const Symbol& lhs, const Symbol& rhs)
@@ -88,13 +94,13 @@ inline bool operator!=(const Symbol& lhs, const Symbol& rhs)
 
 inline uint qHash(const Symbol& symbol, uint seed = 0)
 {
-    Util::HashCombine hash;
-    seed = hash(seed, symbol.symbol);
-    seed = hash(seed, symbol.binary);
-    seed = hash(seed, symbol.path);
-    return seed;
+    return ::qHash(symbol.id, seed);
 }
 
+// release the interned strings of the symbols that aren't used anymore, @return the number of released symbols.
+// the table would otherwise keep the symbols of every file that got opened during the session
+int releaseUnusedSymbols();
+
 struct Location
 {
     Location(quint64 address = 0, const QString& location = {})
@@ -147,8 +153,98 @@ struct FrameLocation
 
 using ItemCost = std::valarray<qint64>;
 
+// the cost of a single type, grouped events yield several of these for the same stack
+struct TypedCost
+{
+    qint32 type;
+    quint64 cost;
+};
+
+using TypedCosts = QVector<TypedCost>;
+
 QDebug operator<<(QDebug stream, const ItemCost& cost);
 
+// adds @p size costs of @p rhs onto @p lhs, written as a plain loop over contiguous memory
+// so that the compiler can vectorize it
+inline void addCostRow(qint64* lhs, const qint64* rhs, int size)
+{
+    for (int i = 0; i < size; ++i) {
+        lhs[i] += rhs[i];
+    }
+}
+
+inline void subtractCostRow(qint64* lhs, const qint64* rhs, int size)
+{
+    for (int i = 0; i < size; ++i) {
+        lhs[i] -= rhs[i];
+    }
+}
+
+// non-owning view on the costs of a single node, only valid until the referenced Costs get modified
+// nodes without any costs yet have a view without data, which reads as zero for all types
+class ItemCostView
+{
+public:
+    ItemCostView(const qint64* data = nullptr, int size = 0)
+        : m_data(data)
+        , m_size(size)
+    {
+    }
+
+    int size() const
+    {
+        return m_size;
+    }
+
+    const qint64* data() const
+    {
+        return m_data;
+    }
+
+    qint64 operator[](int type) const
+    {
+        return m_data ? m_data[type] : 0;
+    }
+
+    qint64 sum() const
+    {
+        qint64 ret = 0;
+        for (int i = 0; m_data && i < m_size; ++i) {
+            ret += m_data[i];
+        }
+        return ret;
+    }
+
+    // add/subtract this cost to/from the @p size costs at @p lhs
+    void addTo(qint64* lhs, int size) const
+    {
+        if (m_data) {
+            addCostRow(lhs, m_data, std::min(size, m_size));
+        }
+    }
+
+    void subtractFrom(qint64* lhs, int size) const
+    {
+        if (m_data) {
+            subtractCostRow(lhs, m_data, std::min(size, m_size));
+        }
+    }
+
+    ItemCost toItemCost() const
+    {
+        ItemCost cost(static_cast<size_t>(m_size));
+        if (m_data) {
+            std::copy(m_data, m_data + m_size, std::begin(cost));
+        }
+        return cost;
+    }
+
+private:
+    const qint64* m_data;
+    int m_size;
+};
+
+// the costs of all nodes of a tree, stored as one dense row-major matrix of node id x cost type
 class Costs
 {
 public:
@@ -165,8 +261,8 @@ public:
 
     void add(int type, quint32 id, qint64 delta)
     {
-        ensureSpaceAvailable(type, id);
-        m_costs[type][id] += delta;
+        ensureSpaceAvailable(id);
+        m_costs[id * numTypes() + type] += delta;
     }
 
     void incrementTotal(int type)
@@ -191,11 +287,8 @@ public:
 
     void addType(int type, const QString& name, Unit unit)
     {
-        if (m_costs.size() <= type) {
-            m_costs.resize(type + 1);
-            m_typeNames.resize(type + 1);
-            m_totalCosts.resize(type + 1);
-            m_units.resize(type + 1);
+        if (numTypes() <= type) {
+            setNumTypes(type + 1);
         }
         m_typeNames[type] = name;
         m_units[type] = unit;
@@ -208,8 +301,8 @@ public:
 
     qint64 cost(int type, quint32 id) const
     {
-        if (static_cast<quint32>(m_costs[type].size()) > id) {
-            return m_costs[type][id];
+        if (id < m_numRows) {
+            return m_costs[id * numTypes() + type];
         } else {
             return 0;
         }
@@ -230,44 +323,60 @@ public:
         m_totalCosts = totalCosts;
     }
 
-    ItemCost itemCost(quint32 id) const
+    ItemCostView itemCostView(quint32 id) const
     {
-        ItemCost cost;
-        cost.resize(m_costs.size());
-        for (int i = 0, c = numTypes(); i < c; ++i) {
-            if (static_cast<quint32>(m_costs[i].size()) > id) {
-                cost[i] = m_costs[i][id];
-            } else {
-                cost[i] = 0;
-            }
+        if (id < m_numRows) {
+            return {m_costs.constData() + id * numTypes(), numTypes()};
+        } else {
+            return {nullptr, numTypes()};
         }
-        return cost;
+    }
+
+    ItemCost itemCost(quint32 id) const
+    {
+        return itemCostView(id).toItemCost();
+    }
+
+    // adds the first numTypes() costs at @p cost to the costs of @p id
+    void add(quint32 id, const qint64* cost)
+    {
+        ensureSpaceAvailable(id);
+        addCostRow(m_costs.data() + id * numTypes(), cost, numTypes());
     }
 
     void add(quint32 id, const ItemCost& cost)
     {
-        Q_ASSERT(cost.size() == static_cast<quint32>(m_costs.size()));
-        for (int i = 0, c = numTypes(); i < c; ++i) {
-            ensureSpaceAvailable(i, id);
-            m_costs[i][id] += cost[i];
+        Q_ASSERT(cost.size() == static_cast<quint32>(numTypes()));
+        add(id, std::begin(cost));
+    }
+
+    void add(quint32 id, const ItemCostView& cost)
+    {
+        if (cost.data()) {
+            ensureSpaceAvailable(id);
+            cost.addTo(m_costs.data() + id * numTypes(), numTypes());
         }
     }
 
     void initializeCostsFrom(const Costs& rhs)
     {
+        setNumTypes(rhs.numTypes());
         m_typeNames = rhs.m_typeNames;
         m_units = rhs.m_units;
-        m_costs.resize(rhs.m_costs.size());
         m_totalCosts = rhs.m_totalCosts;
     }
 
-    QString formatCost(int type, quint64 cost) const
+    QString formatCost(int type, qint64 cost) const
     {
         return formatCost(m_units[type], cost);
     }
 
-    static QString formatCost(Unit unit, quint64 cost)
+    static QString formatCost(Unit unit, qint64 cost)
     {
+        if (cost < 0) {
+            // only the results of a diff have negative costs
+            return QStringLiteral("-") + formatCost(unit, -cost);
+        }
         switch (unit) {
         case Unit::Time:
             return Util::formatTimeString(cost);
@@ -282,20 +391,145 @@ public:
         return m_units[type];
     }
 
+    // the ratio of the costs of two types for all nodes at once, NaN for the nodes without any @p denominator cost
+    QVector<double> ratios(int numerator, int denominator) const
+    {
+        QVector<double> ret(static_cast<int>(m_numRows));
+        const int stride = numTypes();
+        const qint64* row = m_costs.constData();
+        for (quint32 id = 0; id < m_numRows; ++id, row += stride) {
+            const auto denominatorCost = row[denominator];
+            ret[id] = denominatorCost ? static_cast<double>(row[numerator]) / denominatorCost
+                                      : std::numeric_limits<double>::quiet_NaN();
+        }
+        return ret;
+    }
+
+    friend QDataStream& operator<<(QDataStream& stream, const Costs& costs);
+    friend QDataStream& operator>>(QDataStream& stream, Costs& costs);
+
 private:
-    void ensureSpaceAvailable(int type, quint32 id)
+    void ensureSpaceAvailable(quint32 id)
+    {
+        if (id < m_numRows) {
+            return;
+        }
+        const int size = static_cast<int>(id + 1) * numTypes();
+        if (size > m_costs.capacity()) {
+            // grow geometrically, ids get handed out incrementally
+            m_costs.reserve(std::max(size, m_costs.capacity() * 2));
+        }
+        m_costs.resize(size);
+        m_numRows = id + 1;
+    }
+
+    // changes the row stride, keeping the existing costs of the remaining types
+    void setNumTypes(int numTypes)
     {
-        while (static_cast<quint32>(m_costs[type].size()) <= id) {
-            // don't use resize, we don't want to influence the internal auto-sizing
-            m_costs[type].push_back(0);
+        const int oldNumTypes = this->numTypes();
+        if (numTypes == oldNumTypes) {
+            return;
         }
+        if (m_numRows) {
+            QVector<qint64> costs(static_cast<int>(m_numRows) * numTypes, 0);
+            const int copied = std::min(numTypes, oldNumTypes);
+            for (quint32 id = 0; id < m_numRows; ++id) {
+                std::copy_n(m_costs.constData() + id * oldNumTypes, copied, costs.data() + id * numTypes);
+            }
+            m_costs = costs;
+        }
+        m_typeNames.resize(numTypes);
+        m_totalCosts.resize(numTypes);
+        m_units.resize(numTypes);
     }
+
     QVector<QString> m_typeNames;
-    QVector<QVector<qint64>> m_costs;
+    // row-major, the cost of type t for node id lives at id * numTypes() + t
+    QVector<qint64> m_costs;
+    quint32 m_numRows = 0;
     QVector<qint64> m_totalCosts;
     QVector<Unit> m_units;
 };
 
+// a metric computed from the aggregated costs of two event types, like the instructions per cycle
+struct DerivedMetric
+{
+    enum class Format
+    {
+        Ratio,
+        Percentage
+    };
+
+    QString name;
+    // "<numerator> / <denominator>" with the event names as recorded by perf, see parseDerivedMetric
+    QString formula;
+    int numerator = -1;
+    int denominator = -1;
+    Format format = Format::Ratio;
+    // whether larger values denote better performance, which decides how the metric gets colored
+    bool higherIsBetter = true;
+
+    bool isValid() const
+    {
+        return numerator >= 0 && denominator >= 0;
+    }
+
+    // NaN when there is no cost of the denominator type
+    double value(qint64 numeratorCost, qint64 denominatorCost) const
+    {
+        return denominatorCost ? static_cast<double>(numeratorCost) / denominatorCost
+                               : std::numeric_limits<double>::quiet_NaN();
+    }
+
+    // an empty string for NaN values
+    QString formatValue(double value) const;
+};
+
+// the metric is invalid when either of the events of @p formula isn't one of @p typeNames
+// the event names are compared without their modifiers and PMU, i.e. "cycles" matches "cpu/cycles/u" too
+DerivedMetric parseDerivedMetric(const QString& name, const QString& formula, const QVector<QString>& typeNames,
+                                 DerivedMetric::Format format = DerivedMetric::Format::Ratio,
+                                 bool higherIsBetter = true);
+
+// the built-in metrics like the IPC or the cache miss rate whose events are all in @p typeNames
+QVector<DerivedMetric> derivedMetrics(const QVector<QString>& typeNames);
+QVector<DerivedMetric> derivedMetrics(const Costs& costs);
+
+// the values of the built-in derived metrics for all nodes of a cost matrix
+class DerivedMetricValues
+{
+public:
+    DerivedMetricValues() = default;
+    explicit DerivedMetricValues(const Costs& costs);
+
+    int numMetrics() const
+    {
+        return m_metrics.size();
+    }
+
+    const DerivedMetric& metric(int index) const
+    {
+        return m_metrics[index];
+    }
+
+    double value(int index, quint32 id) const
+    {
+        const auto& values = m_values[index];
+        return id < static_cast<quint32>(values.size()) ? values[id] : std::numeric_limits<double>::quiet_NaN();
+    }
+
+    // the value over the total costs
+    double totalValue(int index) const
+    {
+        return m_totalValues[index];
+    }
+
+private:
+    QVector<DerivedMetric> m_metrics;
+    QVector<QVector<double>> m_values;
+    QVector<double> m_totalValues;
+};
+
 template<typename T>
 struct Tree
 {
@@ -314,37 +548,243 @@ struct Tree
 private:
     static void setParents(QVector<T>* children, const T* parent)
     {
-        for (auto& frame : *children) {
-            frame.parent = parent;
-            setParents(&frame.children, &frame);
+        // iterate instead of recursing, the trees can be deeper than the call stack allows
+        QVector<QPair<QVector<T>*, const T*>> pending = {qMakePair(children, parent)};
+        while (!pending.isEmpty()) {
+            const auto next = pending.takeLast();
+            for (auto& frame : *next.first) {
+                frame.parent = next.second;
+                if (!frame.children.isEmpty()) {
+                    pending.append(qMakePair(&frame.children, &frame));
+                }
+            }
         }
     }
 };
 
-template<typename Impl>
-struct SymbolTree : Tree<Impl>
+// index-addressed, flattened view of a tree as traversed by the tree models
+// the children of a node get appended to the node array when they are accessed for the first time, so only the
+// parts of the tree a view actually expands are materialized. the children of a node occupy a contiguous range
+// and the parent and row lookups are O(1) without relying on the parent pointers of the tree. the items are
+// referenced, not copied, so the tree must outlive the arena and must not be detached while it is in use
+template<typename T>
+class TreeArena
 {
-    Symbol symbol;
+public:
+    struct Node
+    {
+        const T* item;
+        int parent;
+        // the row of the node within its parent
+        int row;
+        // -1 until the children got materialized
+        int firstChild;
+        int numChildren;
+    };
+
+    // index of the root node, it gets created even for empty trees
+    static const int Root = 0;
+
+    TreeArena()
+        : TreeArena(nullptr)
+    {
+    }
 
-    Impl* entryForSymbol(const Symbol& symbol, quint32* maxId)
+    explicit TreeArena(const T* root)
     {
-        Impl* ret = nullptr;
+        m_nodes.append({root, -1, 0, -1, root ? root->children.size() : 0});
+    }
 
-        auto& children = this->children;
-        for (auto row = children.data(), end = row + children.size(); row != end; ++row) {
-            if (row->symbol == symbol) {
-                ret = row;
+    // the number of materialized nodes
+    int size() const
+    {
+        return m_nodes.size();
+    }
+
+    // the returned reference gets invalidated by the next call to child()
+    const Node& node(int index) const
+    {
+        return m_nodes[index];
+    }
+
+    // returns the index of the child in @p row of the node at @p parent, or -1 when out of range
+    int child(int parent, int row)
+    {
+        if (row < 0 || row >= m_nodes[parent].numChildren) {
+            return -1;
+        }
+        if (m_nodes[parent].firstChild == -1) {
+            materializeChildren(parent);
+        }
+        return m_nodes[parent].firstChild + row;
+    }
+
+private:
+    void materializeChildren(int parent)
+    {
+        const T* item = m_nodes[parent].item;
+        const int firstChild = m_nodes.size();
+        m_nodes.reserve(firstChild + item->children.size());
+        int row = 0;
+        for (const auto& child : item->children) {
+            m_nodes.append({&child, parent, row++, -1, child.children.size()});
+        }
+        m_nodes[parent].firstChild = firstChild;
+    }
+
+    QVector<Node> m_nodes;
+};
+
+// finds the nodes of a tree whose symbol contains a search string, ignoring the case, or that have such a descendant
+// the search key of every unique symbol gets built and matched only once, the result is a set of node ids
+template<typename T>
+class TreeSearch
+{
+public:
+    TreeSearch(const QString& needle, bool prettifySymbols, std::function<bool()> isCanceled)
+        : m_needle(needle.toLower())
+        , m_prettifySymbols(prettifySymbols)
+        , m_isCanceled(std::move(isCanceled))
+    {
+    }
+
+    // returns a bit for every matching node id, or a null bit array when the search got canceled
+    QBitArray run(const T& root)
+    {
+        m_matches.clear();
+        m_canceled = false;
+        visit(root);
+        return m_canceled ? QBitArray() : m_matches;
+    }
+
+private:
+    enum SymbolMatch : qint8
+    {
+        Unknown,
+        Match,
+        NoMatch
+    };
+
+    bool symbolMatches(const Symbol& symbol)
+    {
+        if (symbol.id >= m_symbolMatches.size()) {
+            m_symbolMatches.resize(symbol.id + 1, Unknown);
+        }
+        auto& match = m_symbolMatches[symbol.id];
+        if (match == Unknown) {
+            const auto& name = m_prettifySymbols ? symbol.prettySymbol : symbol.symbol;
+            const auto key = QString(name + symbol.binary).toLower();
+            match = key.contains(m_needle) ? Match : NoMatch;
+        }
+        return match == Match;
+    }
+
+    // iterates instead of recursing, the trees can be deeper than the call stack allows
+    void visit(const T& root)
+    {
+        struct Frame
+        {
+            const T* node;
+            int nextChild;
+            // true once any of the children or their descendants matched
+            bool anyMatch;
+        };
+        std::vector<Frame> stack = {{&root, 0, false}};
+        while (!stack.empty()) {
+            auto& top = stack.back();
+            if (top.nextChild < top.node->children.size()) {
+                if (++m_numVisited % 4096 == 0 && m_isCanceled()) {
+                    m_canceled = true;
+                    return;
+                }
+                const auto* child = &top.node->children[top.nextChild++];
+                // the children get visited first to mark all matching descendants
+                stack.push_back({child, 0, false});
+                continue;
+            }
+
+            const auto done = top;
+            stack.pop_back();
+            if (stack.empty()) {
+                // the root itself never matches
                 break;
             }
+            if (done.anyMatch || symbolMatches(done.node->symbol)) {
+                const auto id = static_cast<int>(done.node->id);
+                if (id >= m_matches.size()) {
+                    m_matches.resize(std::max<int>(id + 1, m_matches.size() * 2));
+                }
+                m_matches.setBit(id);
+                stack.back().anyMatch = true;
+            }
+        }
+    }
+
+    const QString m_needle;
+    const bool m_prettifySymbols;
+    const std::function<bool()> m_isCanceled;
+    std::vector<SymbolMatch> m_symbolMatches;
+    QBitArray m_matches;
+    uint m_numVisited = 0;
+    bool m_canceled = false;
+};
+
+// build-time index for SymbolTree::entryForSymbol, maps the symbols of a node's children to their rows
+// the index is keyed by the node id and only used for wide nodes, it can be dropped once the tree is complete
+class SymbolTreeIndex
+{
+public:
+    // a linear scan is cheaper than hashing for nodes with only a few children
+    static const int MinimumRows = 16;
+
+    template<typename Impl>
+    QHash<Symbol, int>* rowsFor(const Impl* node)
+    {
+        if (node->children.size() < MinimumRows) {
+            return nullptr;
+        }
+        auto& rows = m_rows[node->id];
+        if (rows.size() != node->children.size()) {
+            // children only ever get appended, so a size mismatch means we have to (re)build the index
+            rows.clear();
+            rows.reserve(node->children.size());
+            for (int i = 0, c = node->children.size(); i < c; ++i) {
+                rows.insert(node->children[i].symbol, i);
+            }
         }
+        return &rows;
+    }
+
+    void clear()
+    {
+        m_rows.clear();
+    }
+
+private:
+    QHash<quint32, QHash<Symbol, int>> m_rows;
+};
+
+template<typename Impl>
+struct SymbolTree : Tree<Impl>
+{
+    Symbol symbol;
+
+    Impl* entryForSymbol(const Symbol& symbol, quint32* maxId, SymbolTreeIndex* index = nullptr)
+    {
+        auto* rows = index ? index->rowsFor(static_cast<Impl*>(this)) : nullptr;
+        Impl* ret = findEntry(symbol, rows);
 
         if (!ret) {
             Impl frame;
             frame.symbol = symbol;
             frame.id = *maxId;
             *maxId += 1;
+            auto& children = this->children;
             children.append(frame);
             ret = &children.last();
+            if (rows) {
+                rows->insert(symbol, children.size() - 1);
+            }
         }
 
         return ret;
@@ -364,11 +804,27 @@ struct SymbolTree : Tree<Impl>
 
         return ret;
     }
+
+    Impl* findEntry(const Symbol& symbol, const QHash<Symbol, int>* rows)
+    {
+        auto& children = this->children;
+        if (rows) {
+            auto it = rows->constFind(symbol);
+            return it == rows->constEnd() ? nullptr : &children[it.value()];
+        }
+        for (auto row = children.data(), end = row + children.size(); row != end; ++row) {
+            if (row->symbol == symbol) {
+                return row;
+            }
+        }
+        return nullptr;
+    }
 };
 
 struct BottomUp : SymbolTree<BottomUp>
 {
-    quint32 id;
+    // the root never gets an id assigned
+    quint32 id = std::numeric_limits<quint32>::max();
 };
 
 struct BottomUpResults
@@ -394,19 +850,77 @@ struct BottomUpResults
     const BottomUp* addEvent(int type, quint64 cost, const QVector<qint32>& frames, FrameCallback frameCallback)
     {
         costs.addTotalCost(type, cost);
+        return addFrames(frames, [this, type, cost](quint32 id) { costs.add(type, id, cost); }, frameCallback);
+    }
+
+    // adds all costs of a grouped event, walking the stack only once
+    template<typename FrameCallback>
+    const BottomUp* addEvent(const TypedCosts& eventCosts, const QVector<qint32>& frames, FrameCallback frameCallback)
+    {
+        for (const auto& eventCost : eventCosts) {
+            costs.addTotalCost(eventCost.type, eventCost.cost);
+        }
+        return addFrames(frames,
+                         [this, &eventCosts](quint32 id) {
+                             for (const auto& eventCost : eventCosts) {
+                                 costs.add(eventCost.type, id, eventCost.cost);
+                             }
+                         },
+                         frameCallback);
+    }
+
+    // merge the tree and costs of @p other into this result, as if all of its events got added
+    // via addEvent after the ones already in here. symbols and locations are not touched.
+    void merge(const BottomUpResults& other);
+
+    // @return the costs of @p candidate minus the ones of @p baseline, aligned by the symbols of both trees.
+    // symbols are matched by their name and binary, since the path of the binaries usually differs between
+    // two builds. the cost types are matched by their name, the total costs are the ones of the baseline,
+    // such that the relative costs read as the change compared to the baseline
+    static BottomUpResults diff(const BottomUpResults& baseline, const BottomUpResults& candidate);
+
+    // @return the location of the function the frame at @p locationId got inlined into, @p locationId itself
+    // when it isn't inlined, or -1 for invalid ids
+    qint32 outermostLocation(qint32 locationId) const;
+
+    // @return @p frames with every chain of inlined frames replaced by the frame of the function it got inlined into
+    QVector<qint32> collapseInlinedFrames(const QVector<qint32>& frames) const;
+
+    // @return @p frames without the frames of direct recursions, only the innermost call of the recursing
+    // function is kept, which thus gets the costs of all its calls
+    QVector<qint32> collapseRecursion(const QVector<qint32>& frames) const;
+
+    // fold all subtrees whose costs lie below @p threshold of the total costs for every type into a single
+    // "[other]" node per parent, which bounds the size of the tree the views have to handle
+    void prune(double threshold);
+
+    // release the memory of the build-time lookup index, call this once no more events get added
+    void dropChildIndex()
+    {
+        childIndex.clear();
+    }
+
+    friend QDataStream& operator<<(QDataStream& stream, const BottomUpResults& results);
+    friend QDataStream& operator>>(QDataStream& stream, BottomUpResults& results);
+
+private:
+    quint32 maxBottomUpId = 0;
+    SymbolTreeIndex childIndex;
+
+    template<typename AddCosts, typename FrameCallback>
+    const BottomUp* addFrames(const QVector<qint32>& frames, AddCosts addCosts, FrameCallback frameCallback)
+    {
         auto parent = &root;
-        foreachFrame(frames, [this, type, cost, &parent, frameCallback](const Data::Symbol &symbol, const Data::Location &location) {
-            parent = parent->entryForSymbol(symbol, &maxBottomUpId);
-            costs.add(type, parent->id, cost);
+        foreachFrame(frames, [this, &parent, &addCosts, &frameCallback](const Data::Symbol& symbol,
+                                                                         const Data::Location& location) {
+            parent = parent->entryForSymbol(symbol, &maxBottomUpId, &childIndex);
+            addCosts(parent->id);
             frameCallback(symbol, location);
             return true;
         });
         return parent;
     }
 
-private:
-    quint32 maxBottomUpId = 0;
-
     template<typename FrameCallback>
     bool handleFrame(qint32 locationId, FrameCallback frameCallback) const
     {
@@ -439,7 +953,8 @@ private:
 
 struct TopDown : SymbolTree<TopDown>
 {
-    quint32 id;
+    // the root never gets an id assigned
+    quint32 id = std::numeric_limits<quint32>::max();
 };
 
 struct TopDownResults
@@ -448,6 +963,36 @@ struct TopDownResults
     Costs selfCosts;
     Costs inclusiveCosts;
     static TopDownResults fromBottomUp(const Data::BottomUpResults& bottomUpData);
+
+    // add the cost of a single event directly, as an alternative to building everything via fromBottomUp
+    // @p stack contains the symbols of the event starting with the leaf, as passed to the callback of
+    // BottomUpResults::addEvent. the type names and total costs need to be set via initializeCostsFrom later on
+    void addEvent(int type, quint64 cost, const QVector<Symbol>& stack);
+    // adds all costs of a grouped event, walking the stack only once
+    void addEvent(const TypedCosts& eventCosts, const QVector<Symbol>& stack);
+
+    // merge the tree and costs of @p other into this result, as if all of its events got added via addEvent
+    // after the ones already in here. the total costs are not touched.
+    void merge(const TopDownResults& other);
+
+    // like BottomUpResults::prune, based on the inclusive costs
+    void prune(double threshold);
+
+    // release the memory of the build-time lookup index, call this once no more events get added
+    void dropChildIndex()
+    {
+        childIndex.clear();
+    }
+
+    friend QDataStream& operator<<(QDataStream& stream, const TopDownResults& results);
+    friend QDataStream& operator>>(QDataStream& stream, TopDownResults& results);
+
+private:
+    // fewer top-level rows aren't worth building and merging a separate fragment
+    static const int MinRowsPerFragment = 64;
+
+    quint32 maxTopDownId = 0;
+    SymbolTreeIndex childIndex;
 };
 
 using SymbolCostMap = QHash<Symbol, ItemCost>;
@@ -468,64 +1013,209 @@ struct LocationCost
 
 using LocationCostMap = QHash<QString, LocationCost>;
 
-struct CallerCalleeEntry
+// tracks which symbols were already seen in the current stack, to count the inclusive cost of recursive
+// symbols only once. the interned symbol ids are dense, so this stamps the current epoch into an array
+// indexed by id instead of filling a hash set for every sample. reset() starts the next stack in O(1)
+class RecursionGuard
 {
-    quint32 id = 0;
-
-    LocationCost& source(const QString& location, int numTypes)
+public:
+    void reset()
     {
-        auto it = sourceMap.find(location);
-        if (it == sourceMap.end()) {
-            it = sourceMap.insert(location, {numTypes});
-        } else if (it->inclusiveCost.size() < static_cast<size_t>(numTypes)) {
-            it->inclusiveCost.resize(numTypes);
-            it->selfCost.resize(numTypes);
+        ++m_epoch;
+        m_empty = true;
+        if (m_epoch == 0) {
+            // wrapped around, old stamps could collide with the new epochs
+            std::fill(m_epochs.begin(), m_epochs.end(), 0);
+            m_epoch = 1;
         }
-        return *it;
     }
 
-    ItemCost& callee(const Symbol& symbol, int numTypes)
+    bool isEmpty() const
     {
-        auto it = callees.find(symbol);
-        if (it == callees.end()) {
-            it = callees.insert(symbol, ItemCost(numTypes));
-        }
-        return *it;
+        return m_empty;
     }
 
-    ItemCost& caller(const Symbol& symbol, int numTypes)
+    bool contains(const Symbol& symbol) const
     {
-        auto it = callers.find(symbol);
-        if (it == callers.end()) {
-            it = callers.insert(symbol, ItemCost(numTypes));
-        }
-        return *it;
+        return symbol.id < m_epochs.size() && m_epochs[symbol.id] == m_epoch;
     }
 
-    // callers, i.e. other symbols and locations that called this symbol
-    CallerMap callers;
-    // callees, i.e. symbols being called from this symbol
-    CalleeMap callees;
-    // source map for this symbol, i.e. locations mapped to associated costs
-    LocationCostMap sourceMap;
+    // returns true when @p symbol was not yet seen since the last reset()
+    bool insert(const Symbol& symbol)
+    {
+        if (symbol.id >= m_epochs.size()) {
+            m_epochs.resize(std::max<size_t>(symbol.id + 1, m_epochs.size() * 2), 0);
+        }
+        m_empty = false;
+        auto& epoch = m_epochs[symbol.id];
+        if (epoch == m_epoch) {
+            return false;
+        }
+        epoch = m_epoch;
+        return true;
+    }
+
+private:
+    std::vector<quint32> m_epochs;
+    quint32 m_epoch = 1;
+    bool m_empty = true;
+};
+
+// pairs of ids, e.g. the caller/callee edges between two symbols. every pair gets a dense index in the order it was
+// added, which can be used to store the costs of the pair in a Costs matrix. finalize() indexes the pairs by their
+// first and second id, afterwards all pairs of an id can be looked up as one contiguous range of pair indices
+class IdPairs
+{
+public:
+    struct Range
+    {
+        const int* first;
+        const int* last;
+
+        const int* begin() const
+        {
+            return first;
+        }
+
+        const int* end() const
+        {
+            return last;
+        }
+
+        int size() const
+        {
+            return static_cast<int>(last - first);
+        }
+    };
+
+    // returns the index of the pair, new pairs get appended
+    int add(quint32 first, quint32 second);
+
+    int size() const
+    {
+        return m_first.size();
+    }
+
+    quint32 first(int pair) const
+    {
+        return m_first[pair];
+    }
+
+    quint32 second(int pair) const
+    {
+        return m_second[pair];
+    }
+
+    // builds the range indices, also drops the lookup used by add() which is only rebuilt when pairs get added again
+    void finalize();
+
+    // the indices of the pairs with the given first resp. second id, only valid after finalize()
+    Range withFirst(quint32 id) const
+    {
+        return range(m_byFirst, m_firstOffsets, id);
+    }
+
+    Range withSecond(quint32 id) const
+    {
+        return range(m_bySecond, m_secondOffsets, id);
+    }
+
+    friend QDataStream& operator<<(QDataStream& stream, const IdPairs& pairs);
+    friend QDataStream& operator>>(QDataStream& stream, IdPairs& pairs);
+
+private:
+    static quint64 key(quint32 first, quint32 second)
+    {
+        return (static_cast<quint64>(first) << 32) | second;
+    }
+
+    static Range range(const QVector<int>& pairs, const QVector<int>& offsets, quint32 id)
+    {
+        if (id + 1 >= static_cast<quint32>(offsets.size())) {
+            return {nullptr, nullptr};
+        }
+        return {pairs.constData() + offsets[id], pairs.constData() + offsets[id + 1]};
+    }
+
+    QVector<quint32> m_first;
+    QVector<quint32> m_second;
+    QHash<quint64, int> m_indices;
+    // the pair indices sorted by their first resp. second id, the pairs of id i start at offsets[i]
+    QVector<int> m_byFirst;
+    QVector<int> m_firstOffsets;
+    QVector<int> m_bySecond;
+    QVector<int> m_secondOffsets;
+};
+
+struct CallerCalleeEntry
+{
+    quint32 id = 0;
 };
 
 using CallerCalleeEntryMap = QHash<Symbol, CallerCalleeEntry>;
+// the callers, callees and source locations of the entries are stored as id pairs with their costs in dense
+// columns instead of one hash per entry. the maps of a single entry get assembled on demand, see callers(),
+// callees() and sourceMap()
 struct CallerCalleeResults
 {
     CallerCalleeEntryMap entries;
     Costs selfCosts;
     Costs inclusiveCosts;
 
+    // the symbols of the entries, indexed by the entry id
+    QVector<Symbol> symbols;
+    // caller id -> callee id, the costs are indexed by the pair
+    IdPairs callerCalleePairs;
+    Costs callerCalleeCosts;
+    // entry id -> location id, the costs are indexed by the pair
+    IdPairs sourcePairs;
+    Costs sourceSelfCosts;
+    Costs sourceInclusiveCosts;
+    // the interned source locations, indexed by the location id
+    QVector<QString> locations;
+    QHash<QString, quint32> locationIds;
+
     CallerCalleeEntry& entry(const Symbol& symbol)
     {
         auto it = entries.find(symbol);
         if (it == entries.end()) {
             it = entries.insert(symbol, {});
             it->id = entries.size() - 1;
+            symbols.append(symbol);
+        }
+        return *it;
+    }
+
+    quint32 locationId(const QString& location)
+    {
+        auto it = locationIds.find(location);
+        if (it == locationIds.end()) {
+            it = locationIds.insert(location, locations.size());
+            locations.append(location);
         }
         return *it;
     }
+
+    // adds the first callerCalleeCosts.numTypes() costs at @p cost to the edge between the entries
+    void addCallerCallee(quint32 callerId, quint32 calleeId, const qint64* cost)
+    {
+        callerCalleeCosts.add(callerCalleePairs.add(callerId, calleeId), cost);
+    }
+
+    // returns the pair index of @p location for the entry @p id, for the source costs with at least @p numTypes types
+    int source(quint32 id, const QString& location, int numTypes);
+
+    // only valid after finalize()
+    CallerMap callers(quint32 id) const;
+    CalleeMap callees(quint32 id) const;
+    LocationCostMap sourceMap(quint32 id) const;
+
+    // indexes the pairs for the lookups above, call this when all events got added
+    void finalize();
+
+    // merge the entries and costs of @p other into this result, new entries are added
+    // in the order they were created in @p other
+    void merge(const CallerCalleeResults& other);
 };
 
 void callerCalleesFromBottomUpData(const BottomUpResults& data, CallerCalleeResults* results);
@@ -533,6 +1223,7 @@ void callerCalleesFromBottomUpData(const BottomUpResults& data, CallerCalleeResu
 const constexpr auto INVALID_CPU_ID = std::numeric_limits<quint32>::max();
 const constexpr int INVALID_TID = -1;
 const constexpr int INVALID_PID = -1;
+const constexpr int INVALID_FILE_ID = -1;
 
 struct Event
 {
@@ -549,7 +1240,412 @@ struct Event
     }
 };
 
-using Events = QVector<Event>;
+// column-wise storage for events, which avoids the padding of the Event struct and allows
+// algorithms to only touch the columns they actually need, e.g. the time for a binary search
+class Events
+{
+public:
+    // random access iterator yielding Event values assembled from the columns
+    class const_iterator
+    {
+    public:
+        struct ArrowProxy
+        {
+            Event event;
+            const Event* operator->() const
+            {
+                return &event;
+            }
+        };
+
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = Event;
+        using difference_type = int;
+        using pointer = ArrowProxy;
+        using reference = Event;
+
+        const_iterator() = default;
+        const_iterator(const Events* events, int index)
+            : m_events(events)
+            , m_index(index)
+        {
+        }
+
+        Event operator*() const
+        {
+            return m_events->at(m_index);
+        }
+
+        ArrowProxy operator->() const
+        {
+            return {m_events->at(m_index)};
+        }
+
+        Event operator[](difference_type offset) const
+        {
+            return m_events->at(m_index + offset);
+        }
+
+        int index() const
+        {
+            return m_index;
+        }
+
+        const_iterator& operator++()
+        {
+            ++m_index;
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            auto ret = *this;
+            ++m_index;
+            return ret;
+        }
+
+        const_iterator& operator--()
+        {
+            --m_index;
+            return *this;
+        }
+
+        const_iterator operator--(int)
+        {
+            auto ret = *this;
+            --m_index;
+            return ret;
+        }
+
+        const_iterator& operator+=(difference_type offset)
+        {
+            m_index += offset;
+            return *this;
+        }
+
+        const_iterator& operator-=(difference_type offset)
+        {
+            m_index -= offset;
+            return *this;
+        }
+
+        const_iterator operator+(difference_type offset) const
+        {
+            return {m_events, m_index + offset};
+        }
+
+        const_iterator operator-(difference_type offset) const
+        {
+            return {m_events, m_index - offset};
+        }
+
+        difference_type operator-(const const_iterator& rhs) const
+        {
+            return m_index - rhs.m_index;
+        }
+
+        bool operator==(const const_iterator& rhs) const
+        {
+            return m_index == rhs.m_index;
+        }
+
+        bool operator!=(const const_iterator& rhs) const
+        {
+            return m_index != rhs.m_index;
+        }
+
+        bool operator<(const const_iterator& rhs) const
+        {
+            return m_index < rhs.m_index;
+        }
+
+        bool operator<=(const const_iterator& rhs) const
+        {
+            return m_index <= rhs.m_index;
+        }
+
+        bool operator>(const const_iterator& rhs) const
+        {
+            return m_index > rhs.m_index;
+        }
+
+        bool operator>=(const const_iterator& rhs) const
+        {
+            return m_index >= rhs.m_index;
+        }
+
+    private:
+        const Events* m_events = nullptr;
+        int m_index = 0;
+    };
+    using iterator = const_iterator;
+
+    int size() const
+    {
+        return m_times.size();
+    }
+
+    bool isEmpty() const
+    {
+        return m_times.isEmpty();
+    }
+
+    void reserve(int size)
+    {
+        m_times.reserve(size);
+        m_costs.reserve(size);
+        m_types.reserve(size);
+        m_stackIds.reserve(size);
+        m_cpuIds.reserve(size);
+    }
+
+    // release the memory over-allocated while appending
+    void squeeze()
+    {
+        m_times.squeeze();
+        m_costs.squeeze();
+        m_types.squeeze();
+        m_stackIds.squeeze();
+        m_cpuIds.squeeze();
+    }
+
+    void clear()
+    {
+        m_times.clear();
+        m_costs.clear();
+        m_types.clear();
+        m_stackIds.clear();
+        m_cpuIds.clear();
+    }
+
+    void push_back(const Event& event)
+    {
+        m_times.push_back(event.time);
+        m_costs.push_back(event.cost);
+        m_types.push_back(event.type);
+        m_stackIds.push_back(event.stackId);
+        m_cpuIds.push_back(event.cpuId);
+    }
+
+    Events& operator<<(const Event& event)
+    {
+        push_back(event);
+        return *this;
+    }
+
+    void append(const Events& events)
+    {
+        m_times += events.m_times;
+        m_costs += events.m_costs;
+        m_types += events.m_types;
+        m_stackIds += events.m_stackIds;
+        m_cpuIds += events.m_cpuIds;
+    }
+
+    // calls @p transform with a pointer to every event and stores the modified events back
+    // only the values that actually changed get written, so columns that are shared with other events
+    // and left untouched by @p transform never get detached
+    template<typename Transform>
+    void transform(Transform transform)
+    {
+        for (int i = 0, c = size(); i < c; ++i) {
+            auto event = at(i);
+            transform(&event);
+            store(&m_times, i, event.time);
+            store(&m_costs, i, event.cost);
+            store(&m_types, i, event.type);
+            store(&m_stackIds, i, event.stackId);
+            store(&m_cpuIds, i, event.cpuId);
+        }
+    }
+
+    // @return the events in [pos, pos + length), see also QVector::mid
+    Events mid(int pos, int length = -1) const
+    {
+        Events ret;
+        ret.m_times = m_times.mid(pos, length);
+        ret.m_costs = m_costs.mid(pos, length);
+        ret.m_types = m_types.mid(pos, length);
+        ret.m_stackIds = m_stackIds.mid(pos, length);
+        ret.m_cpuIds = m_cpuIds.mid(pos, length);
+        return ret;
+    }
+
+    Event at(int i) const
+    {
+        Event event;
+        event.time = m_times[i];
+        event.cost = m_costs[i];
+        event.type = m_types[i];
+        event.stackId = m_stackIds[i];
+        event.cpuId = m_cpuIds[i];
+        return event;
+    }
+
+    quint64 time(int i) const
+    {
+        return m_times[i];
+    }
+
+    quint64 cost(int i) const
+    {
+        return m_costs[i];
+    }
+
+    qint32 type(int i) const
+    {
+        return m_types[i];
+    }
+
+    qint32 stackId(int i) const
+    {
+        return m_stackIds[i];
+    }
+
+    quint32 cpuId(int i) const
+    {
+        return m_cpuIds[i];
+    }
+
+    // the columns themselves, e.g. to write them out in one go
+    const QVector<quint64>& times() const
+    {
+        return m_times;
+    }
+
+    const QVector<quint64>& costs() const
+    {
+        return m_costs;
+    }
+
+    const QVector<qint32>& types() const
+    {
+        return m_types;
+    }
+
+    const QVector<qint32>& stackIds() const
+    {
+        return m_stackIds;
+    }
+
+    const QVector<quint32>& cpuIds() const
+    {
+        return m_cpuIds;
+    }
+
+    // @return index of the last event with the given @p type or -1 if no such event exists
+    int lastIndexOfType(qint32 type) const
+    {
+        return m_types.lastIndexOf(type);
+    }
+
+    // @return the first event in [begin, end) that does not lie before @p time
+    const_iterator lowerBound(const_iterator begin, const_iterator end, quint64 time) const
+    {
+        const auto timesBegin = m_times.constBegin();
+        const auto it = std::lower_bound(timesBegin + begin.index(), timesBegin + end.index(), time);
+        return {this, static_cast<int>(it - timesBegin)};
+    }
+
+    // remove all events for which @p predicate returns true, retaining the order of the others
+    // the columns are usually shared with the unfiltered events, so they only get replaced when an event actually
+    // gets removed, and then by exactly sized copies of the retained events instead of detaching all of them
+    template<typename Predicate>
+    void removeIf(Predicate predicate)
+    {
+        removeIfAt([this, &predicate](int i) { return predicate(at(i)); });
+    }
+
+    // like removeIf, but @p predicate gets the index of the event, which allows it to only read the columns it needs
+    // the predicate gets called for all events before any of them gets removed
+    template<typename Predicate>
+    void removeIfAt(Predicate predicate)
+    {
+        const int numEvents = size();
+        int numPrefix = 0;
+        while (numPrefix < numEvents && !predicate(numPrefix)) {
+            ++numPrefix;
+        }
+        if (numPrefix == numEvents) {
+            return;
+        }
+
+        std::vector<int> retained;
+        for (int i = numPrefix + 1; i < numEvents; ++i) {
+            if (!predicate(i)) {
+                retained.push_back(i);
+            }
+        }
+
+        m_times = gather(m_times, numPrefix, retained);
+        m_costs = gather(m_costs, numPrefix, retained);
+        m_types = gather(m_types, numPrefix, retained);
+        m_stackIds = gather(m_stackIds, numPrefix, retained);
+        m_cpuIds = gather(m_cpuIds, numPrefix, retained);
+    }
+
+    const_iterator begin() const
+    {
+        return {this, 0};
+    }
+
+    const_iterator end() const
+    {
+        return {this, size()};
+    }
+
+    const_iterator constBegin() const
+    {
+        return begin();
+    }
+
+    const_iterator constEnd() const
+    {
+        return end();
+    }
+
+    bool operator==(const Events& rhs) const
+    {
+        return std::tie(m_times, m_costs, m_types, m_stackIds, m_cpuIds)
+            == std::tie(rhs.m_times, rhs.m_costs, rhs.m_types, rhs.m_stackIds, rhs.m_cpuIds);
+    }
+
+    bool operator!=(const Events& rhs) const
+    {
+        return !operator==(rhs);
+    }
+
+    friend QDataStream& operator<<(QDataStream& stream, const Events& events);
+    friend QDataStream& operator>>(QDataStream& stream, Events& events);
+
+private:
+    // @return the first @p numPrefix values of @p column followed by the values at the @p retained indices
+    template<typename T>
+    static QVector<T> gather(const QVector<T>& column, int numPrefix, const std::vector<int>& retained)
+    {
+        QVector<T> ret(numPrefix + static_cast<int>(retained.size()));
+        auto out = std::copy_n(column.constBegin(), numPrefix, ret.begin());
+        for (auto i : retained) {
+            *out++ = column[i];
+        }
+        return ret;
+    }
+
+    // writes @p value into @p column at @p i, unless it is stored there already which avoids detaching @p column
+    template<typename T>
+    static void store(QVector<T>* column, int i, T value)
+    {
+        if (column->at(i) != value) {
+            (*column)[i] = value;
+        }
+    }
+
+    QVector<quint64> m_times;
+    QVector<quint64> m_costs;
+    QVector<qint32> m_types;
+    QVector<qint32> m_stackIds;
+    QVector<quint32> m_cpuIds;
+};
 
 struct TimeRange
 {
@@ -611,6 +1707,8 @@ struct ThreadEvents
     TimeRange time = MAX_TIME_RANGE;
     Events events;
     QString name;
+    // index into EventResults::files, always zero unless several files got parsed at once
+    qint32 fileId = 0;
     quint64 lastSwitchTime = MAX_TIME;
     quint64 offCpuTime = 0;
     enum State
@@ -623,16 +1721,78 @@ struct ThreadEvents
 
     bool operator==(const ThreadEvents& rhs) const
     {
-        return std::tie(pid, tid, time, events, name, lastSwitchTime, offCpuTime, state)
-            == std::tie(rhs.pid, rhs.tid, rhs.time, rhs.events, rhs.name, rhs.lastSwitchTime, rhs.offCpuTime,
-                        rhs.state);
+        return std::tie(pid, tid, time, events, name, fileId, lastSwitchTime, offCpuTime, state)
+            == std::tie(rhs.pid, rhs.tid, rhs.time, rhs.events, rhs.name, rhs.fileId, rhs.lastSwitchTime,
+                        rhs.offCpuTime, rhs.state);
     }
 };
 
+// an interval tree over the lifetimes of a list of threads, such that the threads alive within a time range can be
+// found without looking at every single one of them
+class ThreadIntervalIndex
+{
+public:
+    ThreadIntervalIndex() = default;
+    explicit ThreadIntervalIndex(const QVector<ThreadEvents>& threads);
+
+    // @return the indices of the threads whose lifetime overlaps @p time, in ascending order
+    QVector<int> overlapping(const TimeRange& time) const;
+
+    int size() const
+    {
+        return m_nodes.size();
+    }
+
+private:
+    struct Node
+    {
+        TimeRange time;
+        // the latest end of any thread within the subtree of this node
+        quint64 maxEnd = 0;
+        int thread = -1;
+    };
+
+    quint64 buildMaxEnd(int begin, int end);
+    void collect(int begin, int end, const TimeRange& time, QVector<int>* threads) const;
+
+    // sorted by start time, the middle node of every range is the root of the subtree spanning that range
+    QVector<Node> m_nodes;
+};
+
+// an inverted index from the symbols to the stacks that contain them, such that the events of a symbol can be found
+// by looking at their stack id only, instead of walking through the frames of every stack again
+class SymbolStackIndex
+{
+public:
+    SymbolStackIndex() = default;
+    SymbolStackIndex(const QVector<QVector<qint32>>& stacks, const BottomUpResults& bottomUp);
+
+    // @return the ids of the stacks that contain @p symbol in any frame, in ascending order
+    QVector<qint32> stacks(const Symbol& symbol) const;
+    // @return one bit per stack id, set when the stack contains @p symbol, or an empty array when none does
+    QBitArray stackMask(const Symbol& symbol) const;
+
+    int numStacks() const
+    {
+        return m_numStacks;
+    }
+
+    bool isEmpty() const
+    {
+        return m_stacks.isEmpty();
+    }
+
+private:
+    // keyed by the interned symbol id
+    QHash<quint32, QVector<qint32>> m_stacks;
+    int m_numStacks = 0;
+};
+
+// the events of a single CPU, which are not stored but derived from the thread events, see EventResults::cpuEvents
 struct CpuEvents
 {
     quint32 cpuId = INVALID_CPU_ID;
-    QVector<Event> events;
+    Events events;
 
     bool operator==(const CpuEvents& rhs) const
     {
@@ -640,6 +1800,51 @@ struct CpuEvents
     }
 };
 
+// the threads that ran on a single CPU over time, as recorded by the context switches. every switch starts a slice
+// that lasts until the next one, stored in two columns to stay compact for millions of switches
+struct ContextSwitchTrack
+{
+    // index into EventResults::files, always zero unless several files got parsed at once
+    qint32 fileId = 0;
+    // the start of each slice, sorted
+    QVector<quint64> times;
+    // the tid of the thread running in each slice, or INVALID_TID when the CPU got switched away from a thread
+    // and we don't know what ran next, e.g. because it belongs to a process that wasn't recorded
+    QVector<qint32> threadIds;
+
+    int size() const
+    {
+        return times.size();
+    }
+
+    bool isEmpty() const
+    {
+        return times.isEmpty();
+    }
+
+    // @p tid got switched in or, when @p switchOut is set, switched out at @p time. switches older than the last
+    // one are ignored, and a switch out only ends the slice when no other thread got switched in in the meantime
+    void add(quint64 time, qint32 tid, bool switchOut);
+
+    // @return the index of the slice that contains @p time, or -1 when it lies before the first one
+    int sliceAt(quint64 time) const;
+
+    // @return the end of @p slice, i.e. the start of the next one or MAX_TIME for the last one
+    quint64 sliceEnd(int slice) const
+    {
+        return slice + 1 < times.size() ? times[slice + 1] : MAX_TIME;
+    }
+
+    // drops the slices that ended before @p time, the one containing it is kept
+    void dropBefore(quint64 time);
+    void dropFirst(int count);
+
+    bool operator==(const ContextSwitchTrack& rhs) const
+    {
+        return std::tie(fileId, times, threadIds) == std::tie(rhs.fileId, rhs.times, rhs.threadIds);
+    }
+};
+
 struct CostSummary
 {
     CostSummary() = default;
@@ -664,6 +1869,40 @@ struct CostSummary
 
 QDebug operator<<(QDebug stream, const CostSummary& symbol);
 
+// an estimate of the bytes held by each part of the results
+struct MemoryUsage
+{
+    // the names, binaries, paths and source locations
+    quint64 strings = 0;
+    quint64 symbols = 0;
+    quint64 locations = 0;
+    quint64 stacks = 0;
+    quint64 events = 0;
+    quint64 bottomUp = 0;
+    quint64 topDown = 0;
+    quint64 callerCallee = 0;
+
+    quint64 total() const
+    {
+        return strings + symbols + locations + stacks + events + bottomUp + topDown + callerCallee;
+    }
+};
+
+// the wall time in nanoseconds spent on each stage of the initial parse
+struct StageTimes
+{
+    // reading the samples from hotspot-perfparser, which includes waiting for it to unwind them
+    quint64 parsing = 0;
+    quint64 aggregation = 0;
+    quint64 topDown = 0;
+    quint64 callerCallee = 0;
+
+    quint64 total() const
+    {
+        return parsing + aggregation + topDown + callerCallee;
+    }
+};
+
 struct Summary
 {
     quint64 applicationRunningTime = 0;
@@ -691,48 +1930,293 @@ struct Summary
     QVector<CostSummary> costs;
 
     QStringList errors;
+
+    // the memory used by the results once they got published, not serialized as it changes with every parse
+    MemoryUsage memoryUsage;
+    // not serialized either, zero for the stages that got skipped e.g. when the results got cached
+    StageTimes stageTimes;
+};
+
+// the cost of every CPU within time buckets of equal duration, see EventResults::cpuUtilization
+struct CpuUtilization
+{
+    TimeRange time;
+    quint64 bucketDuration = 0;
+    int numBuckets = 0;
+    // one row per CPU with events, grouped by their NUMA node
+    QVector<quint32> cpuIds;
+    // the NUMA node of each row, or -1 when it is unknown
+    QVector<qint32> numaNodes;
+    // the cost of each row and bucket, i.e. costs[row * numBuckets + bucket]
+    QVector<quint64> costs;
+    quint64 maxCost = 0;
+
+    quint64 cost(int row, int bucket) const
+    {
+        return costs[row * numBuckets + bucket];
+    }
+};
+
+// the values of one field of a tracepoint, with one entry per sample of the tracepoint
+struct TracepointField
+{
+    enum class Type : qint8
+    {
+        Integer,
+        String
+    };
+
+    QString name;
+    Type type = Type::Integer;
+    // the integer values, or the indices into TracepointEvents::strings for string fields
+    QVector<qint64> values;
+
+    bool operator==(const TracepointField& rhs) const
+    {
+        return std::tie(name, type, values) == std::tie(rhs.name, rhs.type, rhs.values);
+    }
+};
+
+struct TracepointGroup
+{
+    quint64 count = 0;
+    qint64 sum = 0;
+};
+
+// the samples of a single tracepoint like block:block_rq_issue, with their payload stored column by column
+struct TracepointEvents
+{
+    QString system;
+    QString name;
+    // index into EventResults::files, always zero unless several files got parsed at once
+    qint32 fileId = 0;
+    QVector<quint64> times;
+    QVector<qint32> threadIds;
+    QVector<TracepointField> fields;
+    // the distinct values of all string fields
+    QVector<QString> strings;
+
+    int size() const
+    {
+        return times.size();
+    }
+
+    // @return the index of the field called @p fieldName, or -1 if there is none
+    int fieldIndex(const QString& fieldName) const;
+
+    // @return the value of @p field in @p row as text
+    QString formatValue(int field, int row) const;
+
+    // groups the samples within @p time by the value of @p keyField and sums up @p valueField, unless it is -1.
+    // the keys of string fields are indices into strings
+    QMap<qint64, TracepointGroup> groupBy(int keyField, int valueField = -1,
+                                          const TimeRange& time = MAX_TIME_RANGE) const;
+
+    bool operator==(const TracepointEvents& rhs) const
+    {
+        return std::tie(system, name, fileId, times, threadIds, fields, strings)
+            == std::tie(rhs.system, rhs.name, rhs.fileId, rhs.times, rhs.threadIds, rhs.fields, rhs.strings);
+    }
 };
 
 struct EventResults
 {
     QVector<ThreadEvents> threads;
-    QVector<CpuEvents> cpus;
+    // the number of CPUs, i.e. one more than the highest CPU id of any event
+    quint32 numCpus = 0;
+    // the NUMA node of each CPU as read from the perf data header, empty when it is unknown
+    QVector<qint32> cpuNumaNodes;
     QVector<QVector<qint32>> stacks;
     QVector<CostSummary> totalCosts;
     qint32 offCpuTimeCostId = -1;
+    // the input files the events got merged from, empty when only a single file got parsed
+    QStringList files;
+    // the tracepoint samples with their payload, one entry per tracepoint that got recorded
+    QVector<TracepointEvents> tracepoints;
+    // indexed by the CPU id, empty unless context switches got recorded
+    QVector<ContextSwitchTrack> contextSwitches;
 
     ThreadEvents* findThread(qint32 pid, qint32 tid);
     const ThreadEvents* findThread(qint32 pid, qint32 tid) const;
 
+    // @return the events of every CPU that has any, sorted by CPU id and each sorted by time
+    // the events are collected from the threads, which is cheaper than keeping a second copy of every event around.
+    // off-CPU time events are skipped, as context switches shouldn't show up on the CPU timelines
+    QVector<CpuEvents> cpuEvents() const;
+
+    // @return the summed up cost of @p type on every CPU within @p numBuckets buckets spanning @p time
+    CpuUtilization cpuUtilization(qint32 type, const TimeRange& time, int numBuckets) const;
+
     bool operator==(const EventResults& rhs) const
     {
-        return std::tie(threads, cpus, stacks, totalCosts, offCpuTimeCostId)
-            == std::tie(rhs.threads, rhs.cpus, rhs.stacks, rhs.totalCosts, rhs.offCpuTimeCostId);
+        return std::tie(threads, numCpus, cpuNumaNodes, stacks, totalCosts, offCpuTimeCostId, files, tracepoints,
+                        contextSwitches)
+            == std::tie(rhs.threads, rhs.numCpus, rhs.cpuNumaNodes, rhs.stacks, rhs.totalCosts, rhs.offCpuTimeCostId,
+                        rhs.files, rhs.tracepoints, rhs.contextSwitches);
     }
 };
 
+// the size of a single event in the column-wise Events storage
+const constexpr quint64 EVENT_SIZE = 2 * sizeof(quint64) + 3 * sizeof(qint32);
+
+MemoryUsage memoryUsage(const BottomUpResults& bottomUp, const TopDownResults& topDown,
+                        const CallerCalleeResults& callerCallee, const EventResults& events);
+
+// binary serialization of the parse results, used by the on-disk results cache
+QDataStream& operator<<(QDataStream& stream, const Symbol& symbol);
+QDataStream& operator>>(QDataStream& stream, Symbol& symbol);
+QDataStream& operator<<(QDataStream& stream, const Location& location);
+QDataStream& operator>>(QDataStream& stream, Location& location);
+QDataStream& operator<<(QDataStream& stream, const FrameLocation& location);
+QDataStream& operator>>(QDataStream& stream, FrameLocation& location);
+QDataStream& operator<<(QDataStream& stream, const Events& events);
+QDataStream& operator>>(QDataStream& stream, Events& events);
+QDataStream& operator<<(QDataStream& stream, const ThreadEvents& thread);
+QDataStream& operator>>(QDataStream& stream, ThreadEvents& thread);
+QDataStream& operator<<(QDataStream& stream, const CostSummary& cost);
+QDataStream& operator>>(QDataStream& stream, CostSummary& cost);
+QDataStream& operator<<(QDataStream& stream, const Summary& summary);
+QDataStream& operator>>(QDataStream& stream, Summary& summary);
+QDataStream& operator<<(QDataStream& stream, const TracepointEvents& tracepoint);
+QDataStream& operator>>(QDataStream& stream, TracepointEvents& tracepoint);
+QDataStream& operator<<(QDataStream& stream, const ContextSwitchTrack& track);
+QDataStream& operator>>(QDataStream& stream, ContextSwitchTrack& track);
+QDataStream& operator<<(QDataStream& stream, const EventResults& events);
+QDataStream& operator>>(QDataStream& stream, EventResults& events);
+
 struct FilterAction
 {
     TimeRange time;
     qint32 processId = INVALID_PID;
     qint32 threadId = INVALID_PID;
     quint32 cpuId = INVALID_CPU_ID;
+    qint32 fileId = INVALID_FILE_ID;
     QVector<qint32> excludeProcessIds;
     QVector<qint32> excludeThreadIds;
     QVector<quint32> excludeCpuIds;
+    QVector<qint32> excludeFileIds;
     QSet<Data::Symbol> includeSymbols;
     QSet<Data::Symbol> excludeSymbols;
+    // not a restriction of the events, but aggregates the inlined frames into the functions they got inlined into
+    bool collapseInlinedFrames = false;
+    // like the above, aggregates the frames of a function that directly calls itself into a single one
+    bool collapseRecursion = false;
+    // when larger than one, only about one out of sampleRate events of every thread and cost type gets aggregated,
+    // with its cost scaled up accordingly. the events themselves and the total costs stay exact
+    int sampleRate = 1;
+    // when larger than zero, the subtrees of the bottom-up and top-down trees whose costs lie below this fraction of
+    // the total costs get folded into "[other]" nodes, see BottomUpResults::prune
+    double pruneThreshold = 0;
 
     bool isValid() const
     {
         return time.isValid() || processId != INVALID_PID
             || threadId != INVALID_PID || cpuId != INVALID_CPU_ID
-            || !excludeProcessIds.isEmpty() || !excludeThreadIds.isEmpty()
-            || !excludeCpuIds.isEmpty() || !includeSymbols.isEmpty()
+            || fileId != INVALID_FILE_ID || !excludeProcessIds.isEmpty()
+            || !excludeThreadIds.isEmpty() || !excludeCpuIds.isEmpty()
+            || !excludeFileIds.isEmpty() || !includeSymbols.isEmpty()
             || !excludeSymbols.isEmpty();
     }
+
+    // @return true when every event that passes this filter also passes @p other,
+    // i.e. when this filter only narrows down the results of @p other further
+    bool isRefinementOf(const FilterAction& other) const;
+
+    // @return a copy with sorted id lists and a normalized time range, to compare filters by their effect
+    FilterAction normalized() const;
+
+    bool operator==(const FilterAction& rhs) const
+    {
+        return std::tie(time, processId, threadId, cpuId, fileId, excludeProcessIds, excludeThreadIds, excludeCpuIds,
+                        excludeFileIds, includeSymbols, excludeSymbols, collapseInlinedFrames, collapseRecursion,
+                        sampleRate, pruneThreshold)
+            == std::tie(rhs.time, rhs.processId, rhs.threadId, rhs.cpuId, rhs.fileId, rhs.excludeProcessIds,
+                        rhs.excludeThreadIds, rhs.excludeCpuIds, rhs.excludeFileIds, rhs.includeSymbols,
+                        rhs.excludeSymbols, rhs.collapseInlinedFrames, rhs.collapseRecursion, rhs.sampleRate,
+                        rhs.pruneThreshold);
+    }
+
+    bool operator!=(const FilterAction& rhs) const
+    {
+        return !operator==(rhs);
+    }
+};
+
+uint qHash(const FilterAction& filter, uint seed = 0);
+
+struct FilterCacheStats
+{
+    quint64 hits = 0;
+    quint64 misses = 0;
+    int entries = 0;
+    quint64 usedBytes = 0;
+    quint64 budgetBytes = 0;
+};
+
+// how far the results aggregated from a sample of the events may be off, see FilterAction::sampleRate
+struct ApproximationStats
+{
+    // one when all events got aggregated and the results are exact
+    int sampleRate = 1;
+    quint64 sampledEvents = 0;
+    quint64 totalEvents = 0;
+    // per cost type, an upper bound for the variance of the estimated cost of any symbol, stack or location
+    QVector<double> variances;
+
+    bool isApproximate() const
+    {
+        return sampledEvents < totalEvents;
+    }
+
+    // @return the maximum error of the estimated costs of @p type, which holds with a confidence of 95%
+    double errorBound(int type) const;
+
+    void merge(const ApproximationStats& other);
 };
 
+// the progress of the initial parse, see PerfParser::parseProgress
+struct ParseProgress
+{
+    enum class Stage
+    {
+        // reading and unwinding the samples, followed by the stages that build the remaining results
+        Parsing,
+        Aggregation,
+        TopDown,
+        CallerCallee
+    };
+    Stage stage = Stage::Parsing;
+    // the fraction of the input that hotspot-perfparser went through, between 0 and 1
+    float fraction = 0;
+    // the size of the input file, zero when it isn't known e.g. while recording
+    quint64 inputBytes = 0;
+    // the number of bytes, events and samples read from hotspot-perfparser so far
+    quint64 streamBytes = 0;
+    quint64 events = 0;
+    quint64 samples = 0;
+    // in nanoseconds since the parse started
+    quint64 elapsed = 0;
+
+    double eventsPerSecond() const;
+    // the rate at which hotspot-perfparser unwinds the samples
+    double samplesPerSecond() const;
+    // @return the estimated nanoseconds until all of the input got parsed, or -1 when it can't be estimated yet
+    qint64 remainingTime() const;
+};
+
+// a sample of the events of a single thread, drawn independently for every cost type
+struct EventSample
+{
+    // the indices of the sampled events, in increasing order
+    QVector<int> indices;
+    // the costs of the sampled events, scaled up such that they sum up to the exact total cost of every type
+    QVector<quint64> costs;
+};
+
+// reservoir-samples about one out of @p sampleRate events of every cost type and adds the expected sampling error
+// to @p stats. the sample only depends on the events and @p seed, such that filtering again yields the same results
+EventSample sampleEvents(const Events& events, int numTypes, int sampleRate, quint32 seed, ApproximationStats* stats);
+
 struct ZoomAction
 {
     TimeRange time;
@@ -741,7 +2225,31 @@ struct ZoomAction
     {
         return time.isValid();
     }
+
+    bool operator==(const ZoomAction& rhs) const
+    {
+        return time == rhs.time;
+    }
 };
+
+// binary serialization of the filtered results and the filters that yield them, used by the saved sessions.
+// the symbols and locations of the bottom-up results are not written, they are shared with the unfiltered results
+QDataStream& operator<<(QDataStream& stream, const Costs& costs);
+QDataStream& operator>>(QDataStream& stream, Costs& costs);
+QDataStream& operator<<(QDataStream& stream, const BottomUpResults& results);
+QDataStream& operator>>(QDataStream& stream, BottomUpResults& results);
+QDataStream& operator<<(QDataStream& stream, const TopDownResults& results);
+QDataStream& operator>>(QDataStream& stream, TopDownResults& results);
+QDataStream& operator<<(QDataStream& stream, const IdPairs& pairs);
+QDataStream& operator>>(QDataStream& stream, IdPairs& pairs);
+QDataStream& operator<<(QDataStream& stream, const CallerCalleeResults& results);
+QDataStream& operator>>(QDataStream& stream, CallerCalleeResults& results);
+QDataStream& operator<<(QDataStream& stream, const ApproximationStats& stats);
+QDataStream& operator>>(QDataStream& stream, ApproximationStats& stats);
+QDataStream& operator<<(QDataStream& stream, const FilterAction& filter);
+QDataStream& operator>>(QDataStream& stream, FilterAction& filter);
+QDataStream& operator<<(QDataStream& stream, const ZoomAction& zoom);
+QDataStream& operator>>(QDataStream& stream, ZoomAction& zoom);
 }
 
 Q_DECLARE_METATYPE(Data::Symbol)
@@ -752,6 +2260,7 @@ Q_DECLARE_TYPEINFO(Data::Location, Q_MOVABLE_TYPE);
 
 Q_DECLARE_METATYPE(Data::FrameLocation)
 Q_DECLARE_TYPEINFO(Data::FrameLocation, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(Data::TypedCost, Q_PRIMITIVE_TYPE);
 
 Q_DECLARE_METATYPE(Data::BottomUp)
 Q_DECLARE_TYPEINFO(Data::BottomUp, Q_MOVABLE_TYPE);
@@ -779,12 +2288,24 @@ Q_DECLARE_TYPEINFO(Data::CallerCalleeResults, Q_MOVABLE_TYPE);
 Q_DECLARE_METATYPE(Data::Event)
 Q_DECLARE_TYPEINFO(Data::Event, Q_MOVABLE_TYPE);
 
+Q_DECLARE_METATYPE(Data::Events)
+Q_DECLARE_TYPEINFO(Data::Events, Q_MOVABLE_TYPE);
+
 Q_DECLARE_METATYPE(Data::ThreadEvents)
 Q_DECLARE_TYPEINFO(Data::ThreadEvents, Q_MOVABLE_TYPE);
 
+Q_DECLARE_METATYPE(Data::ThreadIntervalIndex)
+Q_DECLARE_TYPEINFO(Data::ThreadIntervalIndex, Q_MOVABLE_TYPE);
+
+Q_DECLARE_METATYPE(Data::SymbolStackIndex)
+Q_DECLARE_TYPEINFO(Data::SymbolStackIndex, Q_MOVABLE_TYPE);
+
 Q_DECLARE_METATYPE(Data::CpuEvents)
 Q_DECLARE_TYPEINFO(Data::CpuEvents, Q_MOVABLE_TYPE);
 
+Q_DECLARE_METATYPE(Data::ContextSwitchTrack)
+Q_DECLARE_TYPEINFO(Data::ContextSwitchTrack, Q_MOVABLE_TYPE);
+
 Q_DECLARE_METATYPE(Data::Summary)
 Q_DECLARE_TYPEINFO(Data::Summary, Q_MOVABLE_TYPE);
 
@@ -798,4 +2319,13 @@ Q_DECLARE_METATYPE(Data::TimeRange)
 Q_DECLARE_TYPEINFO(Data::TimeRange, Q_MOVABLE_TYPE);
 
 Q_DECLARE_TYPEINFO(Data::FilterAction, Q_MOVABLE_TYPE);
+
+Q_DECLARE_METATYPE(Data::FilterCacheStats)
+Q_DECLARE_TYPEINFO(Data::FilterCacheStats, Q_MOVABLE_TYPE);
+
+Q_DECLARE_METATYPE(Data::ApproximationStats)
+Q_DECLARE_TYPEINFO(Data::ApproximationStats, Q_MOVABLE_TYPE);
+
+Q_DECLARE_METATYPE(Data::ParseProgress)
+Q_DECLARE_TYPEINFO(Data::ParseProgress, Q_MOVABLE_TYPE);
 Q_DECLARE_TYPEINFO(Data::ZoomAction, Q_MOVABLE_TYPE);
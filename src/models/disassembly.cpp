@@ -0,0 +1,263 @@
+/*
+  disassembly.cpp
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "disassembly.h"
+
+#include <QCoreApplication>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QStandardPaths>
+
+#include <algorithm>
+
+namespace Data {
+int AddressCosts::indexOf(quint64 address) const
+{
+    const auto it = std::lower_bound(addresses.begin(), addresses.end(), address);
+    if (it == addresses.end() || *it != address) {
+        return -1;
+    }
+    return static_cast<int>(std::distance(addresses.begin(), it));
+}
+
+AddressCosts AddressCosts::fromEvents(const Symbol& symbol, const EventResults& events, const BottomUpResults& bottomUp)
+{
+    AddressCosts ret;
+    ret.selfCosts.initializeCostsFrom(bottomUp.costs);
+    ret.selfCosts.clearTotalCost();
+    ret.inclusiveCosts.initializeCostsFrom(ret.selfCosts);
+    if (!symbol.isValid()) {
+        return ret;
+    }
+
+    // look up the address of every location once, the stacks share them a lot
+    const int numLocations = bottomUp.locations.size();
+    QVector<quint64> locationAddresses(numLocations);
+    QVector<qint32> locationIndices(numLocations, -1);
+    for (int locationId = 0; locationId < numLocations; ++locationId) {
+        const auto outermost = bottomUp.outermostLocation(locationId);
+        if (outermost != -1 && bottomUp.symbols.value(outermost) == symbol) {
+            locationAddresses[locationId] = bottomUp.locations[outermost].location.address;
+            locationIndices[locationId] = 0;
+            ret.addresses.push_back(locationAddresses[locationId]);
+        }
+    }
+    std::sort(ret.addresses.begin(), ret.addresses.end());
+    ret.addresses.erase(std::unique(ret.addresses.begin(), ret.addresses.end()), ret.addresses.end());
+    if (ret.addresses.isEmpty()) {
+        return ret;
+    }
+    for (int locationId = 0; locationId < numLocations; ++locationId) {
+        if (locationIndices[locationId] != -1) {
+            locationIndices[locationId] = ret.indexOf(locationAddresses[locationId]);
+        }
+    }
+
+    const int numTypes = ret.selfCosts.numTypes();
+    QVector<qint32> seen;
+    for (const auto& thread : events.threads) {
+        const auto& threadEvents = thread.events;
+        for (int i = 0, c = threadEvents.size(); i < c; ++i) {
+            const auto stackId = threadEvents.stackId(i);
+            const auto type = threadEvents.type(i);
+            if (stackId < 0 || stackId >= events.stacks.size() || type < 0 || type >= numTypes) {
+                continue;
+            }
+
+            const auto cost = static_cast<qint64>(threadEvents.cost(i));
+            const auto& stack = events.stacks[stackId];
+            seen.clear();
+            for (int frame = 0, numFrames = stack.size(); frame < numFrames; ++frame) {
+                const auto index = locationIndices.value(stack[frame], -1);
+                if (index == -1) {
+                    continue;
+                }
+                if (frame == 0) {
+                    ret.selfCosts.add(type, index, cost);
+                }
+                if (!seen.contains(index)) {
+                    seen.push_back(index);
+                    ret.inclusiveCosts.add(type, index, cost);
+                }
+            }
+            if (!seen.isEmpty()) {
+                ret.selfCosts.addTotalCost(type, cost);
+                ret.inclusiveCosts.addTotalCost(type, cost);
+            }
+        }
+    }
+    return ret;
+}
+
+DisassemblyResults DisassemblyResults::disassemble(const Symbol& symbol, const QString& binaryPath,
+                                                   const AddressCosts& costs)
+{
+    auto failed = [&symbol, &costs](const QString& error) {
+        auto ret = fromLines(symbol, {}, costs);
+        ret.error = error;
+        return ret;
+    };
+
+    const auto objdump = QStandardPaths::findExecutable(QStringLiteral("objdump"));
+    if (objdump.isEmpty()) {
+        return failed(
+            QCoreApplication::translate("DisassemblyResults", "Please install objdump to disassemble the binaries."));
+    }
+    if (symbol.symbol.isEmpty() || binaryPath.isEmpty()) {
+        return failed(QCoreApplication::translate("DisassemblyResults",
+                                                  "The symbol or its binary is unknown, only the sampled addresses "
+                                                  "are shown."));
+    }
+
+    // objdump compares the demangled names when demangling is enabled
+    QProcess process;
+    process.start(objdump, {QStringLiteral("-d"), QStringLiteral("-l"), QStringLiteral("-C"),
+                            QStringLiteral("--no-show-raw-insn"), QLatin1String("--disassemble=") + symbol.symbol,
+                            binaryPath});
+    if (!process.waitForFinished(-1) || process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+        const auto error = QString::fromLocal8Bit(process.readAllStandardError()).trimmed();
+        return failed(QCoreApplication::translate("DisassemblyResults", "Failed to disassemble %1: %2")
+                          .arg(binaryPath, error.isEmpty() ? process.errorString() : error));
+    }
+
+    const auto lines = parseObjdumpOutput(process.readAllStandardOutput());
+    if (lines.isEmpty()) {
+        return failed(QCoreApplication::translate("DisassemblyResults", "%1 could not be found in %2.")
+                          .arg(symbol.symbol, binaryPath));
+    }
+    return fromLines(symbol, lines, costs);
+}
+
+QVector<DisassemblyLine> DisassemblyResults::parseObjdumpOutput(const QByteArray& output)
+{
+    // e.g. "    1139:\tpush   %rbp"
+    static const QRegularExpression instructionPattern(QStringLiteral("^\\s*([0-9a-f]+):\\t(.*)$"));
+    // e.g. "/tmp/main.c:2" or "/tmp/main.c:2 (discriminator 1)", printed before the instructions of that line
+    static const QRegularExpression locationPattern(QStringLiteral("^(\\S.*:\\d+)(?: \\(discriminator \\d+\\))?$"));
+
+    QVector<DisassemblyLine> lines;
+    QString location;
+    for (const auto& rawLine : output.split('\n')) {
+        const auto line = QString::fromUtf8(rawLine);
+        const auto instruction = instructionPattern.match(line);
+        if (instruction.hasMatch()) {
+            bool ok = false;
+            DisassemblyLine disassemblyLine;
+            disassemblyLine.address = instruction.capturedRef(1).toULongLong(&ok, 16);
+            if (!ok) {
+                continue;
+            }
+            disassemblyLine.instruction = instruction.captured(2).replace(QLatin1Char('\t'), QLatin1Char(' '));
+            disassemblyLine.location = location;
+            lines.push_back(disassemblyLine);
+            continue;
+        }
+        const auto match = locationPattern.match(line);
+        if (match.hasMatch()) {
+            location = match.captured(1);
+        }
+    }
+    return lines;
+}
+
+quint64 DisassemblyResults::guessLoadOffset(const QVector<DisassemblyLine>& lines, const QVector<quint64>& addresses)
+{
+    if (lines.isEmpty() || addresses.isEmpty()) {
+        return 0;
+    }
+
+    QVector<quint64> instructions;
+    instructions.reserve(lines.size());
+    for (const auto& line : lines) {
+        instructions.push_back(line.address);
+    }
+    std::sort(instructions.begin(), instructions.end());
+
+    auto numMatches = [&instructions, &addresses](quint64 offset) {
+        int ret = 0;
+        for (auto address : addresses) {
+            if (address >= offset && std::binary_search(instructions.begin(), instructions.end(), address - offset)) {
+                ++ret;
+            }
+        }
+        return ret;
+    };
+
+    // the load address is page aligned, so the lowest sampled address is congruent to its instruction
+    const quint64 pageSize = 0x1000;
+    const auto lowest = addresses.first();
+    quint64 bestOffset = 0;
+    int bestMatches = numMatches(0);
+    for (auto instruction : instructions) {
+        if (instruction >= lowest || (lowest - instruction) % pageSize != 0) {
+            continue;
+        }
+        const auto offset = lowest - instruction;
+        const auto matches = numMatches(offset);
+        if (matches > bestMatches) {
+            bestOffset = offset;
+            bestMatches = matches;
+        }
+    }
+    return bestOffset;
+}
+
+DisassemblyResults DisassemblyResults::fromLines(const Symbol& symbol, const QVector<DisassemblyLine>& lines,
+                                                 const AddressCosts& costs)
+{
+    DisassemblyResults ret;
+    ret.symbol = symbol;
+    ret.lines = lines;
+    ret.numInstructions = lines.size();
+    ret.loadOffset = guessLoadOffset(lines, costs.addresses);
+    ret.selfCosts.initializeCostsFrom(costs.selfCosts);
+    ret.inclusiveCosts.initializeCostsFrom(costs.inclusiveCosts);
+
+    QHash<quint64, int> rows;
+    rows.reserve(lines.size());
+    for (int row = 0, c = lines.size(); row < c; ++row) {
+        rows.insert(lines[row].address, row);
+    }
+
+    const int numTypes = costs.selfCosts.numTypes();
+    for (int index = 0, c = costs.addresses.size(); index < c; ++index) {
+        const auto address = costs.addresses[index] - ret.loadOffset;
+        auto it = rows.constFind(address);
+        if (it == rows.constEnd()) {
+            DisassemblyLine line;
+            line.address = address;
+            it = rows.insert(address, ret.lines.size());
+            ret.lines.push_back(line);
+        }
+        for (int type = 0; type < numTypes; ++type) {
+            ret.selfCosts.add(type, it.value(), costs.selfCosts.cost(type, index));
+            ret.inclusiveCosts.add(type, it.value(), costs.inclusiveCosts.cost(type, index));
+        }
+    }
+    return ret;
+}
+}
@@ -0,0 +1,97 @@
+/*
+  disassembly.h
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "data.h"
+
+namespace Data {
+// the costs of a single symbol per instruction address. the addresses are the ones the samples got recorded at,
+// i.e. they include the load address of the binary
+struct AddressCosts
+{
+    // sorted and unique, the costs of addresses[i] are stored for id i
+    QVector<quint64> addresses;
+    // the costs of the samples taken at an address
+    Costs selfCosts;
+    // the costs of the samples with an address of the symbol anywhere in their stack, i.e. for call instructions
+    // the costs of the callees. an address is counted once per sample, no matter how often it shows up in the stack.
+    // the total costs of both are the ones of all samples that went through the symbol
+    Costs inclusiveCosts;
+
+    // @return the index of @p address, or -1 if it got no costs
+    int indexOf(quint64 address) const;
+
+    // inlined frames are attributed to the symbol they got inlined into, the @p bottomUp results resolve the
+    // frames of the stacks
+    static AddressCosts fromEvents(const Symbol& symbol, const EventResults& events, const BottomUpResults& bottomUp);
+};
+
+struct DisassemblyLine
+{
+    // the address within the binary, as printed by objdump
+    quint64 address = 0;
+    QString instruction;
+    // file + line, empty when the binary lacks debug information
+    QString location;
+};
+
+struct DisassemblyResults
+{
+    Symbol symbol;
+    QVector<DisassemblyLine> lines;
+    // the lines beyond are sampled addresses that don't match any instruction
+    int numInstructions = 0;
+    // the costs of lines[i] are stored for id i
+    Costs selfCosts;
+    Costs inclusiveCosts;
+    // the difference between the sampled addresses and the ones in the binary
+    quint64 loadOffset = 0;
+    // set when the binary couldn't get disassembled, the lines then only list the sampled addresses
+    QString error;
+
+    // runs objdump on @p binaryPath, which blocks until it finished and thus should be called from a background job
+    static DisassemblyResults disassemble(const Symbol& symbol, const QString& binaryPath, const AddressCosts& costs);
+
+    // @return the instructions of the output of `objdump -d -l --no-show-raw-insn`
+    static QVector<DisassemblyLine> parseObjdumpOutput(const QByteArray& output);
+
+    // shared libraries and position independent executables get mapped at a page aligned offset, which is guessed
+    // by looking for the one mapping most of the sampled @p addresses onto instructions of @p lines
+    static quint64 guessLoadOffset(const QVector<DisassemblyLine>& lines, const QVector<quint64>& addresses);
+
+    // @return the @p lines with the costs of their sampled addresses
+    static DisassemblyResults fromLines(const Symbol& symbol, const QVector<DisassemblyLine>& lines,
+                                        const AddressCosts& costs);
+};
+}
+
+Q_DECLARE_TYPEINFO(Data::AddressCosts, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(Data::DisassemblyLine, Q_MOVABLE_TYPE);
+
+Q_DECLARE_METATYPE(Data::DisassemblyResults)
+Q_DECLARE_TYPEINFO(Data::DisassemblyResults, Q_MOVABLE_TYPE);
@@ -0,0 +1,149 @@
+/*
+  disassemblymodel.cpp
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "disassemblymodel.h"
+
+#include "../util.h"
+
+DisassemblyModel::DisassemblyModel(QObject* parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+DisassemblyModel::~DisassemblyModel() = default;
+
+int DisassemblyModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_results.lines.size();
+}
+
+int DisassemblyModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : NUM_BASE_COLUMNS + m_results.selfCosts.numTypes() * 2;
+}
+
+QVariant DisassemblyModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (section < 0 || section >= columnCount() || orientation != Qt::Horizontal) {
+        return {};
+    }
+
+    if (role == Qt::InitialSortOrderRole) {
+        return section < NUM_BASE_COLUMNS ? Qt::AscendingOrder : Qt::DescendingOrder;
+    } else if (role == Qt::DisplayRole) {
+        switch (section) {
+        case AddressColumn:
+            return tr("Address");
+        case InstructionColumn:
+            return tr("Instruction");
+        case LocationColumn:
+            return tr("Location");
+        }
+        section -= NUM_BASE_COLUMNS;
+        if (section < m_results.selfCosts.numTypes()) {
+            return tr("%1 (self)").arg(m_results.selfCosts.typeName(section));
+        }
+        section -= m_results.selfCosts.numTypes();
+        return tr("%1 (incl.)").arg(m_results.inclusiveCosts.typeName(section));
+    } else if (role == Qt::ToolTipRole) {
+        switch (section) {
+        case AddressColumn:
+            return tr("The address of the instruction within the binary.");
+        case InstructionColumn:
+            return tr("The disassembled instruction. Empty for sampled addresses that objdump didn't report.");
+        case LocationColumn:
+            return tr("The source file and line the instruction got generated from. Empty when debug information is "
+                      "missing.");
+        }
+        section -= NUM_BASE_COLUMNS;
+        if (section < m_results.selfCosts.numTypes()) {
+            return tr("The aggregated sample costs recorded at this instruction.");
+        }
+        return tr("The aggregated sample costs with this instruction anywhere in their stack. For call instructions "
+                  "this includes the costs of the callee, which get recorded at the address following the call.");
+    }
+    return {};
+}
+
+QVariant DisassemblyModel::data(const QModelIndex& index, int role) const
+{
+    if (!hasIndex(index.row(), index.column(), index.parent())) {
+        return {};
+    }
+
+    const auto& line = m_results.lines.at(index.row());
+    if (role == LocationRole) {
+        return line.location;
+    } else if (role == Qt::ToolTipRole && index.column() < NUM_BASE_COLUMNS) {
+        return line.location.isEmpty() ? line.instruction : tr("%1\n%2").arg(line.instruction, line.location);
+    }
+
+    if (index.column() < NUM_BASE_COLUMNS) {
+        if (role != Qt::DisplayRole && role != SortRole) {
+            return {};
+        }
+        switch (index.column()) {
+        case AddressColumn:
+            if (role == SortRole) {
+                return line.address;
+            }
+            return QString(QLatin1String("0x") + QString::number(line.address, 16));
+        case InstructionColumn:
+            return line.instruction;
+        case LocationColumn:
+            return line.location;
+        }
+        return {};
+    }
+
+    auto type = index.column() - NUM_BASE_COLUMNS;
+    const auto* costs = &m_results.selfCosts;
+    if (type >= costs->numTypes()) {
+        type -= costs->numTypes();
+        costs = &m_results.inclusiveCosts;
+    }
+    const auto cost = costs->cost(type, index.row());
+    if (role == SortRole) {
+        return cost;
+    } else if (role == TotalCostRole) {
+        return costs->totalCost(type);
+    } else if (role == Qt::DisplayRole) {
+        return Util::formatCostRelative(cost, costs->totalCost(type), true);
+    } else if (role == Qt::ToolTipRole) {
+        return tr("%1: %2 (%3)")
+            .arg(costs->typeName(type), costs->formatCost(type, cost),
+                 Util::formatCostRelative(cost, costs->totalCost(type)));
+    }
+    return {};
+}
+
+void DisassemblyModel::setResults(const Data::DisassemblyResults& results)
+{
+    beginResetModel();
+    m_results = results;
+    endResetModel();
+}
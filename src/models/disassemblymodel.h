@@ -0,0 +1,71 @@
+/*
+  disassemblymodel.h
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <QAbstractTableModel>
+
+#include "disassembly.h"
+
+// the instructions of a single symbol with their self and inclusive costs
+class DisassemblyModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    explicit DisassemblyModel(QObject* parent = nullptr);
+    ~DisassemblyModel() override;
+
+    enum Columns
+    {
+        AddressColumn = 0,
+        InstructionColumn,
+        LocationColumn,
+    };
+    enum
+    {
+        NUM_BASE_COLUMNS = LocationColumn + 1,
+        // keep the order of the instructions by default
+        InitialSortColumn = AddressColumn
+    };
+    enum Roles
+    {
+        SortRole = Qt::UserRole,
+        TotalCostRole,
+        LocationRole,
+    };
+
+    int rowCount(const QModelIndex& parent = {}) const override;
+    int columnCount(const QModelIndex& parent = {}) const override;
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    void setResults(const Data::DisassemblyResults& results);
+
+private:
+    Data::DisassemblyResults m_results;
+};
@@ -28,13 +28,18 @@
 #include "eventmodel.h"
 
 #include "../util.h"
+#include "instrumentation.h"
 
 #include <QDebug>
+#include <QFileInfo>
 #include <QSet>
 
-static bool operator<(const EventModel::Process &process, qint32 pid)
+#include <algorithm>
+#include <limits>
+
+static bool operator<(const EventModel::Process &process, const QPair<qint32, qint32>& fileAndPid)
 {
-    return process.pid < pid;
+    return qMakePair(process.fileId, process.pid) < fileAndPid;
 }
 
 namespace {
@@ -45,7 +50,9 @@ enum class Tag : quint8
     Overview = 2,
     Cpus = 3,
     Processes = 4,
-    Threads = 5
+    Threads = 5,
+    // only used when several files got merged, then these group the processes of every file
+    Sessions = 6
 };
 
 const auto DATATAG_SHIFT = sizeof(Tag) * 8;
@@ -59,7 +66,7 @@ quintptr combineDataTag(Tag tag, quintptr data)
 Tag dataTag(quintptr internalId)
 {
     auto ret = (internalId << DATATAG_UNSHIFT) >> DATATAG_UNSHIFT;
-    if (ret > static_cast<quintptr>(Tag::Threads))
+    if (ret > static_cast<quintptr>(Tag::Sessions))
         return Tag::Invalid;
     return static_cast<Tag>(ret);
 }
@@ -76,6 +83,217 @@ quintptr tagData(quintptr internalId)
 {
     return internalId >> DATATAG_SHIFT;
 }
+
+// at most this many pages get created per row, with at least MinEventsPerPage events on average
+const int MaxPages = 1024;
+const int MinEventsPerPage = 16;
+
+// rows with fewer events are cheap enough to paint directly from the events
+const int MinEventsForHistograms = 4096;
+// the number of buckets for the finest resolution, must be a power of two
+const int HistogramBuckets = 2048;
+
+void buildHistograms(const Data::Events& events, const Data::TimeRange& time,
+                     QVector<QVector<EventModel::Histogram>>* histograms)
+{
+    // all events must fall into a bucket, including those at time.end
+    const auto bucketDuration = time.delta() / HistogramBuckets + 1;
+    for (int i = 0, c = events.size(); i < c; ++i) {
+        const auto type = events.type(i);
+        const auto eventTime = events.time(i);
+        if (type < 0 || eventTime < time.start) {
+            continue;
+        }
+        const auto bucket = (eventTime - time.start) / bucketDuration;
+        if (bucket >= HistogramBuckets) {
+            continue;
+        }
+
+        if (type >= histograms->size()) {
+            histograms->resize(type + 1);
+        }
+        auto& levels = (*histograms)[type];
+        if (levels.isEmpty()) {
+            levels.resize(1);
+        }
+        auto& histogram = levels.first();
+        if (histogram.counts.isEmpty()) {
+            histogram.bucketDuration = bucketDuration;
+            histogram.counts.resize(HistogramBuckets);
+            histogram.costs.resize(HistogramBuckets);
+        }
+        ++histogram.counts[bucket];
+        histogram.costs[bucket] += events.cost(i);
+    }
+
+    for (auto& levels : *histograms) {
+        if (levels.isEmpty()) {
+            // no events of this type in this row, but other types may still need the ones in between
+            EventModel::Histogram histogram;
+            histogram.bucketDuration = bucketDuration;
+            histogram.counts.resize(HistogramBuckets);
+            histogram.costs.resize(HistogramBuckets);
+            levels.append(histogram);
+        }
+
+        while (levels.last().counts.size() > 1) {
+            const auto& finer = levels.last();
+            const int numBuckets = finer.counts.size() / 2;
+            EventModel::Histogram coarser;
+            coarser.bucketDuration = finer.bucketDuration * 2;
+            coarser.counts.resize(numBuckets);
+            coarser.costs.resize(numBuckets);
+            for (int i = 0; i < numBuckets; ++i) {
+                coarser.counts[i] = finer.counts[2 * i] + finer.counts[2 * i + 1];
+                coarser.costs[i] = finer.costs[2 * i] + finer.costs[2 * i + 1];
+            }
+            levels.append(coarser);
+        }
+    }
+}
+
+// used for cost types that occur in other rows only
+const EventModel::Histogram& emptyHistogram()
+{
+    static const auto histogram = []() {
+        EventModel::Histogram histogram;
+        histogram.bucketDuration = std::numeric_limits<quint64>::max();
+        return histogram;
+    }();
+    return histogram;
+}
+}
+
+EventModel::EventPages::EventPages(const Data::Events& events, const Data::TimeRange& time, qint32 offCpuTimeCostId)
+    : events(events)
+    , time(time)
+    , offCpuTimeCostId(offCpuTimeCostId)
+{
+    const int numPages = qBound(1, events.size() / MinEventsPerPage, MaxPages);
+    pageDuration = std::max(quint64(1), (time.delta() + numPages - 1) / numPages);
+    pageBegins.resize(numPages + 1);
+
+    const auto& times = events.times();
+    int i = 0;
+    for (int page = 0; page <= numPages; ++page) {
+        const auto pageStart = time.start + page * pageDuration;
+        while (i < times.size() && times[i] < pageStart) {
+            ++i;
+        }
+        pageBegins[page] = i;
+    }
+
+    if (offCpuTimeCostId != -1) {
+        for (int event = 0, c = events.size(); event < c; ++event) {
+            if (events.type(event) == offCpuTimeCostId) {
+                maxOffCpuTime = std::max(maxOffCpuTime, events.cost(event));
+            }
+        }
+    }
+
+    if (events.size() >= MinEventsForHistograms) {
+        buildHistograms(events, time, &histograms);
+    }
+
+    for (int event = 0, c = events.size(); event < c; ++event) {
+        const auto type = events.type(event);
+        if (type < 0) {
+            continue;
+        }
+        if (type >= prefixSums.size()) {
+            prefixSums.resize(type + 1);
+        }
+        auto& sums = prefixSums[type];
+        if (sums.costs.isEmpty()) {
+            sums.costs.append(0);
+        }
+        sums.times.append(events.time(event));
+        sums.costs.append(sums.costs.last() + events.cost(event));
+    }
+    for (auto& sums : prefixSums) {
+        sums.times.squeeze();
+        sums.costs.squeeze();
+    }
+}
+
+int EventModel::EventPages::lowerBound(quint64 t) const
+{
+    if (pageBegins.isEmpty()) {
+        return events.lowerBound(events.begin(), events.end(), t).index();
+    }
+
+    // only search within the page that contains the time
+    int begin = 0;
+    int end = pageBegins.first();
+    if (t > time.start) {
+        const auto lastPage = pageBegins.size() - 1;
+        const auto page = static_cast<int>(std::min((t - time.start) / pageDuration, quint64(lastPage)));
+        begin = pageBegins[page];
+        end = page < lastPage ? pageBegins[page + 1] : events.size();
+    }
+    return events.lowerBound(events.begin() + begin, events.begin() + end, t).index();
+}
+
+const EventModel::Histogram* EventModel::EventPages::histogram(qint32 type, quint64 maxBucketDuration) const
+{
+    if (histograms.isEmpty()) {
+        return nullptr;
+    } else if (type < 0 || type >= histograms.size()) {
+        return &emptyHistogram();
+    }
+
+    const Histogram* ret = nullptr;
+    for (const auto& level : histograms[type]) {
+        if (level.bucketDuration > maxBucketDuration) {
+            break;
+        }
+        ret = &level;
+    }
+    return ret;
+}
+
+EventModel::CostSum EventModel::EventPages::sum(qint32 type, const Data::TimeRange& range) const
+{
+    CostSum ret;
+    if (type < 0 || type >= prefixSums.size() || range.end <= range.start) {
+        return ret;
+    }
+
+    const auto& sums = prefixSums[type];
+    const auto begin = std::lower_bound(sums.times.begin(), sums.times.end(), range.start);
+    const auto end = std::lower_bound(begin, sums.times.end(), range.end);
+    const auto first = static_cast<int>(std::distance(sums.times.begin(), begin));
+    const auto last = static_cast<int>(std::distance(sums.times.begin(), end));
+    ret.numEvents = last - first;
+    if (ret.numEvents) {
+        ret.cost = sums.costs[last] - sums.costs[first];
+    }
+    return ret;
+}
+
+QVector<int> EventModel::topThreads(const QVector<EventPages>& threadPages, qint32 type,
+                                    const Data::TimeRange& range, int n)
+{
+    QVector<QPair<quint64, int>> costs;
+    for (int i = 0, c = threadPages.size(); i < c; ++i) {
+        const auto cost = threadPages[i].sum(type, range).cost;
+        if (cost > 0) {
+            costs.append(qMakePair(cost, i));
+        }
+    }
+
+    n = std::min(n, costs.size());
+    std::partial_sort(costs.begin(), costs.begin() + n, costs.end(),
+                      [](const QPair<quint64, int>& lhs, const QPair<quint64, int>& rhs) {
+                          return lhs.first > rhs.first;
+                      });
+
+    QVector<int> ret;
+    ret.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        ret.append(costs[i].second);
+    }
+    return ret;
 }
 
 EventModel::EventModel(QObject* parent)
@@ -101,9 +319,14 @@ int EventModel::rowCount(const QModelIndex& parent) const
     case Tag::Threads:
         break;
     case Tag::Processes:
-        return m_processes.value(parent.row()).threads.size();
+        return m_processes.value(processIndex(parent)).threads.size();
+    case Tag::Sessions:
+        return m_sessionBegins.value(parent.row() + 1) - m_sessionBegins.value(parent.row());
     case Tag::Overview:
-        return (parent.row() == 0) ? m_data.cpus.size() : m_processes.size();
+        if (parent.row() == 0) {
+            return m_cpus.size();
+        }
+        return hasSessions() ? m_sessionBegins.size() - 1 : m_processes.size();
     case Tag::Root:
         return 2;
     };
@@ -148,11 +371,17 @@ QVariant EventModel::data(const QModelIndex& index, int role) const
     } else if (role == NumThreadsRole) {
         return m_data.threads.size();
     } else if (role == NumCpusRole) {
-        return static_cast<uint>(m_data.cpus.size());
+        return static_cast<uint>(m_cpus.size());
+    } else if (role == NumFilesRole) {
+        return static_cast<uint>(m_data.files.size());
     } else if (role == TotalCostsRole) {
         return QVariant::fromValue(m_data.totalCosts);
     } else if (role == EventResultsRole) {
         return QVariant::fromValue(m_data);
+    } else if (role == ThreadEventPagesRole) {
+        return QVariant::fromValue(m_threadPages);
+    } else if (role == ThreadIntervalIndexRole) {
+        return QVariant::fromValue(m_threadIndex);
     }
 
     auto tag = dataTag(index);
@@ -173,8 +402,21 @@ QVariant EventModel::data(const QModelIndex& index, int role) const
             return index.row();
         }
         return {};
+    } else if (tag == Tag::Sessions) {
+        const auto fileId = m_processes.value(m_sessionBegins.value(index.row())).fileId;
+        const auto path = m_data.files.value(fileId);
+        if (role == Qt::DisplayRole || role == FileNameRole) {
+            return QFileInfo(path).fileName();
+        } else if (role == Qt::ToolTipRole) {
+            return tr("Session %1, num processes = %2").arg(path, QString::number(rowCount(index)));
+        } else if (role == FileIdRole) {
+            return fileId;
+        } else if (role == SortRole) {
+            return index.row();
+        }
+        return {};
     } else if (tag == Tag::Processes) {
-        const auto &process = m_processes.value(index.row());
+        const auto &process = m_processes.value(processIndex(index));
         if (role == Qt::DisplayRole)
             return tr("%1 (#%2)").arg(process.name, QString::number(process.pid));
         else if (role == SortRole)
@@ -188,9 +430,8 @@ QVariant EventModel::data(const QModelIndex& index, int role) const
             quint64 maxRuntime = 0;
             quint64 offCpuTime = 0;
             quint64 numEvents = 0;
-            for (const auto tid : process.threads) {
-                const auto thread = m_data.findThread(process.pid, tid);
-                Q_ASSERT(thread);
+            for (const auto threadIndex : process.threads) {
+                const auto thread = &m_data.threads.at(threadIndex);
                 runtime += thread->time.delta();
                 maxRuntime = std::max(thread->time.delta(), maxRuntime);
                 offCpuTime += thread->offCpuTime;
@@ -222,15 +463,17 @@ QVariant EventModel::data(const QModelIndex& index, int role) const
 
     const Data::ThreadEvents* thread = nullptr;
     const Data::CpuEvents* cpu = nullptr;
+    const EventPages* pages = nullptr;
 
     if (tag == Tag::Cpus) {
-        cpu = &m_data.cpus[index.row()];
+        cpu = &m_cpus[index.row()];
+        pages = &m_cpuPages[index.row()];
     } else {
         Q_ASSERT(tag == Tag::Threads);
         const auto process = m_processes.value(tagData(index.internalId()));
-        const auto tid = process.threads.value(index.row());
-        thread = m_data.findThread(process.pid, tid);
-        Q_ASSERT(thread);
+        const auto threadIndex = process.threads.value(index.row());
+        thread = &m_data.threads.at(threadIndex);
+        pages = &m_threadPages[threadIndex];
     }
 
     if (role == ThreadStartRole) {
@@ -245,8 +488,17 @@ QVariant EventModel::data(const QModelIndex& index, int role) const
         return thread ? thread->pid : Data::INVALID_PID;
     } else if (role == CpuIdRole) {
         return cpu ? cpu->cpuId : Data::INVALID_CPU_ID;
+    } else if (role == FileIdRole) {
+        return thread ? thread->fileId : Data::INVALID_FILE_ID;
+    } else if (role == FileNameRole) {
+        return thread ? QFileInfo(m_data.files.value(thread->fileId)).fileName() : QString();
     } else if (role == EventsRole) {
         return QVariant::fromValue(thread ? thread->events : cpu->events);
+    } else if (role == EventPagesRole) {
+        return QVariant::fromValue(*pages);
+    } else if (role == ContextSwitchesRole) {
+        return QVariant::fromValue(cpu ? m_data.contextSwitches.value(static_cast<int>(cpu->cpuId))
+                                       : Data::ContextSwitchTrack());
     } else if (role == SortRole) {
         if (index.column() == ThreadColumn)
             return thread ? thread->tid : cpu->cpuId;
@@ -298,6 +550,7 @@ QVariant EventModel::data(const QModelIndex& index, int role) const
 
 void EventModel::setData(const Data::EventResults& data)
 {
+    Instrumentation::ScopedTimer instrumentation("EventModel::setData");
     beginResetModel();
     m_data = data;
     m_totalEvents = 0;
@@ -309,17 +562,19 @@ void EventModel::setData(const Data::EventResults& data)
         m_time = {};
     } else {
         m_time = data.threads.first().time;
-        for (const auto& thread : data.threads) {
+        for (int threadIndex = 0; threadIndex < data.threads.size(); ++threadIndex) {
+            const auto& thread = data.threads.at(threadIndex);
             m_time.start = std::min(thread.time.start, m_time.start);
             m_time.end = std::max(thread.time.end, m_time.end);
             m_totalOffCpuTime += thread.offCpuTime;
             m_totalOnCpuTime += thread.time.delta() - thread.offCpuTime;
             m_totalEvents += thread.events.size();
-            auto it = std::lower_bound(m_processes.begin(), m_processes.end(), thread.pid);
-            if (it == m_processes.end() || it->pid != thread.pid) {
-                m_processes.insert(it, {thread.pid, {thread.tid}, thread.name});
+            const auto key = qMakePair(thread.fileId, thread.pid);
+            auto it = std::lower_bound(m_processes.begin(), m_processes.end(), key);
+            if (it == m_processes.end() || it->fileId != thread.fileId || it->pid != thread.pid) {
+                m_processes.insert(it, {thread.pid, {threadIndex}, thread.name, thread.fileId});
             } else {
-                it->threads.append(thread.tid);
+                it->threads.append(threadIndex);
                 // prefer process name, if we encountered a thread first
                 if (thread.pid == thread.tid)
                     it->name = thread.name;
@@ -333,15 +588,55 @@ void EventModel::setData(const Data::EventResults& data)
                 m_maxCost = std::max(event.cost, m_maxCost);
             }
         }
+    }
+
+    m_sessionBegins.clear();
+    if (m_data.files.size() > 1) {
+        for (int i = 0, c = m_processes.size(); i < c; ++i) {
+            if (!i || m_processes[i].fileId != m_processes[i - 1].fileId) {
+                m_sessionBegins.append(i);
+            }
+        }
+        m_sessionBegins.append(m_processes.size());
+    }
+
+    // CPU cores that did not receive any events don't get a timeline
+    m_cpus = m_data.cpuEvents();
 
-        // don't show timeline for CPU cores that did not receive any events
-        auto it = std::remove_if(m_data.cpus.begin(), m_data.cpus.end(),
-                                 [](const Data::CpuEvents& cpuEvents) { return cpuEvents.events.isEmpty(); });
-        m_data.cpus.erase(it, m_data.cpus.end());
+    m_threadPages.clear();
+    m_threadPages.reserve(m_data.threads.size());
+    for (const auto& thread : m_data.threads) {
+        m_threadPages.append({thread.events, m_time, m_data.offCpuTimeCostId});
     }
+    m_cpuPages.clear();
+    m_cpuPages.reserve(m_cpus.size());
+    for (const auto& cpu : m_cpus) {
+        m_cpuPages.append({cpu.events, m_time, m_data.offCpuTimeCostId});
+    }
+    m_threadIndex = Data::ThreadIntervalIndex(m_data.threads);
     endResetModel();
 }
 
+int EventModel::threadIndex(const QModelIndex& index) const
+{
+    if (!index.isValid() || index.model() != this || dataTag(index) != Tag::Threads) {
+        return -1;
+    }
+    return m_processes.value(tagData(index.internalId())).threads.value(index.row(), -1);
+}
+
+int EventModel::processIndex(const QModelIndex& index) const
+{
+    // the tag data is zero for the processes directly below the overview, otherwise one more than their session
+    const auto session = static_cast<int>(tagData(index.internalId()));
+    return session ? m_sessionBegins.value(session - 1) + index.row() : index.row();
+}
+
+QVector<int> EventModel::threadsInRange(const Data::TimeRange& time) const
+{
+    return m_threadIndex.overlapping(time);
+}
+
 QModelIndex EventModel::index(int row, int column, const QModelIndex& parent) const
 {
     if (row < 0 || row >= rowCount(parent) || column < 0 || column >= NUM_COLUMNS) {
@@ -355,13 +650,17 @@ QModelIndex EventModel::index(int row, int column, const QModelIndex& parent) co
         break;
     case Tag::Root: // root has the 1st level children: Overview
         return createIndex(row, column, static_cast<quintptr>(Tag::Overview));
-    case Tag::Overview: // 2nd level children: Cpus and the Processes
+    case Tag::Overview: // 2nd level children: Cpus and the Processes, or their Sessions
         if (parent.row() == 0)
             return createIndex(row, column, static_cast<quintptr>(Tag::Cpus));
+        else if (hasSessions())
+            return createIndex(row, column, static_cast<quintptr>(Tag::Sessions));
         else
             return createIndex(row, column, static_cast<quintptr>(Tag::Processes));
+    case Tag::Sessions: // the Processes of a single file
+        return createIndex(row, column, combineDataTag(Tag::Processes, parent.row() + 1));
     case Tag::Processes: // 3rd level children: Threads
-        return createIndex(row, column, combineDataTag(Tag::Threads, parent.row()));
+        return createIndex(row, column, combineDataTag(Tag::Threads, processIndex(parent)));
     }
 
     return {};
@@ -376,11 +675,22 @@ QModelIndex EventModel::parent(const QModelIndex& child) const
         break;
     case Tag::Cpus:
         return createIndex(0, 0, static_cast<quintptr>(Tag::Overview));
-    case Tag::Processes:
+    case Tag::Sessions:
         return createIndex(1, 0, static_cast<quintptr>(Tag::Overview));
+    case Tag::Processes: {
+        const auto session = tagData(child.internalId());
+        if (session)
+            return createIndex(session - 1, 0, static_cast<quintptr>(Tag::Sessions));
+        return createIndex(1, 0, static_cast<quintptr>(Tag::Overview));
+    }
     case Tag::Threads: {
-        const auto parentRow = tagData(child.internalId());
-        return createIndex(parentRow, 0, static_cast<quintptr>(Tag::Processes));
+        const auto process = static_cast<int>(tagData(child.internalId()));
+        if (!hasSessions())
+            return createIndex(process, 0, static_cast<quintptr>(Tag::Processes));
+        // the session whose processes contain this one
+        const auto next = std::upper_bound(m_sessionBegins.begin(), m_sessionBegins.end(), process);
+        const auto session = static_cast<int>(std::distance(m_sessionBegins.begin(), next)) - 1;
+        return createIndex(process - m_sessionBegins[session], 0, combineDataTag(Tag::Processes, session + 1));
     }
     }
 
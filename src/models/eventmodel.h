@@ -55,13 +55,21 @@ public:
         ThreadIdRole,
         ProcessIdRole,
         CpuIdRole,
+        FileIdRole,
+        FileNameRole,
         NumProcessesRole,
         NumThreadsRole,
         NumCpusRole,
+        NumFilesRole,
         MaxCostRole,
         SortRole,
         TotalCostsRole,
         EventResultsRole,
+        EventPagesRole,
+        ThreadEventPagesRole,
+        ThreadIntervalIndexRole,
+        // the Data::ContextSwitchTrack of a CPU row, empty for all other rows
+        ContextSwitchesRole,
     };
 
     int rowCount(const QModelIndex& parent = {}) const override;
@@ -76,20 +84,108 @@ public:
     using QAbstractItemModel::setData;
     void setData(const Data::EventResults& data);
 
+    // @return the index into the threads of the event results for a thread row, or -1 for any other row
+    int threadIndex(const QModelIndex& index) const;
+
+    // @return the indices of the threads that are alive within @p time, in ascending order
+    QVector<int> threadsInRange(const Data::TimeRange& time) const;
+
     struct Process
     {
-        Process(qint32 pid = Data::INVALID_PID, const QVector<qint32> threads = {}, const QString &name = {})
+        Process(qint32 pid = Data::INVALID_PID, const QVector<int> threads = {}, const QString &name = {},
+                qint32 fileId = 0)
             : pid(pid)
             , threads(threads)
             , name(name)
+            , fileId(fileId)
         {}
         qint32 pid;
-        QVector<qint32> threads;
+        // indices into the threads of the event results, a tid may show up several times when it got reused
+        QVector<int> threads;
         QString name;
+        // the pids of different files are unrelated, even when they are equal
+        qint32 fileId;
+    };
+
+    // the number of events of one cost type and their summed cost in buckets of equal duration
+    struct Histogram
+    {
+        quint64 bucketDuration = 0;
+        QVector<quint32> counts;
+        QVector<quint64> costs;
+    };
+
+    struct CostSum
+    {
+        quint64 numEvents = 0;
+        quint64 cost = 0;
+    };
+
+    // the times of all events of one cost type, together with the cumulative cost up to each of them
+    struct CostPrefixSums
+    {
+        QVector<quint64> times;
+        // costs[i] is the summed cost of the first i events, i.e. it has one more entry than times
+        QVector<quint64> costs;
+    };
+
+    // the events of a single timeline row, indexed by pages of equal duration. this allows the
+    // timeline to only look at the events within the visible time range, even for huge data sets.
+    // rows with many events additionally get a pyramid of histograms per cost type, such that
+    // zoomed out views can be drawn per pixel instead of per event
+    struct EventPages
+    {
+        EventPages() = default;
+        EventPages(const Data::Events& events, const Data::TimeRange& time, qint32 offCpuTimeCostId);
+
+        // @return the index of the first event that does not lie before @p time
+        int lowerBound(quint64 time) const;
+
+        // @return the coarsest histogram for @p type whose buckets are not longer than @p maxBucketDuration,
+        //         or nullptr when there is none and the events have to be looked at instead
+        const Histogram* histogram(qint32 type, quint64 maxBucketDuration) const;
+
+        // @return the number and cost of the events of @p type within [range.start, range.end),
+        //         which only requires two binary searches
+        CostSum sum(qint32 type, const Data::TimeRange& range) const;
+
+        Data::Events events;
+        Data::TimeRange time;
+        quint64 pageDuration = 0;
+        // the index of the first event within each page, i.e. at or after time.start + page * pageDuration
+        QVector<int> pageBegins;
+        qint32 offCpuTimeCostId = -1;
+        // off-CPU events start before the time they cover, this allows to find those overlapping a time range
+        quint64 maxOffCpuTime = 0;
+        // indexed by cost type, from the finest to the coarsest resolution where every level halves the previous one
+        QVector<QVector<Histogram>> histograms;
+        // indexed by cost type
+        QVector<CostPrefixSums> prefixSums;
     };
+
+    // @return the indices of the @p n threads with the highest cost of @p type within @p range,
+    //         sorted by descending cost. threads without any such cost are omitted
+    static QVector<int> topThreads(const QVector<EventPages>& threadPages, qint32 type, const Data::TimeRange& range,
+                                   int n);
+
 private:
+    bool hasSessions() const
+    {
+        return !m_sessionBegins.isEmpty();
+    }
+    // @return the index into m_processes for a process row
+    int processIndex(const QModelIndex& index) const;
+
     Data::EventResults m_data;
+    QVector<Data::CpuEvents> m_cpus;
+    QVector<EventPages> m_threadPages;
+    QVector<EventPages> m_cpuPages;
+    Data::ThreadIntervalIndex m_threadIndex;
+    // sorted by file and pid, such that the processes of every file are adjacent
     QVector<Process> m_processes;
+    // the index of the first process of every file and one past the last one, empty unless several files got merged.
+    // then every file forms a session row that groups its processes
+    QVector<int> m_sessionBegins;
     Data::TimeRange m_time;
     quint64 m_totalOnCpuTime = 0;
     quint64 m_totalOffCpuTime = 0;
@@ -98,3 +194,7 @@ private:
 };
 
 Q_DECLARE_TYPEINFO(EventModel::Process, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(EventModel::Histogram, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(EventModel::CostPrefixSums, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(EventModel::EventPages, Q_MOVABLE_TYPE);
+Q_DECLARE_METATYPE(EventModel::EventPages)
@@ -28,8 +28,12 @@
 #include "filterandzoomstack.h"
 
 #include <QAction>
+#include <QDataStream>
 #include <QMenu>
 #include <QIcon>
+#include <QSignalBlocker>
+
+#include <algorithm>
 
 FilterAndZoomStack::FilterAndZoomStack(QObject* parent)
     : QObject(parent)
@@ -68,7 +72,49 @@ FilterAndZoomStack::FilterAndZoomStack(QObject* parent)
         filterOutBySymbol(data.value<Data::Symbol>());
     });
 
+    m_actions.highlightSymbol = new QAction(QIcon::fromTheme(QStringLiteral("highlighter-text")), tr("Highlight In Time Line"), this);
+    connect(m_actions.highlightSymbol, &QAction::triggered, this, [this](){
+        const auto data = m_actions.highlightSymbol->data();
+        Q_ASSERT(data.canConvert<Data::Symbol>());
+        highlightSymbol(data.value<Data::Symbol>());
+    });
+    m_actions.highlightSymbol->setToolTip(tr("Mark the samples of this symbol in the time line, without filtering the results."));
+
+    m_actions.resetHighlight = new QAction(QIcon::fromTheme(QStringLiteral("edit-clear")), tr("Reset Highlight"), this);
+    connect(m_actions.resetHighlight, &QAction::triggered, this, &FilterAndZoomStack::resetHighlight);
+    m_actions.resetHighlight->setToolTip(tr("Stop highlighting the samples of a symbol in the time line."));
+
+    m_actions.showInlinedFunctions = new QAction(tr("Show Inlined Functions"), this);
+    m_actions.showInlinedFunctions->setCheckable(true);
+    m_actions.showInlinedFunctions->setChecked(true);
+    connect(m_actions.showInlinedFunctions, &QAction::toggled, this,
+            [this](bool checked) { setCollapseInlinedFrames(!checked); });
+    m_actions.showInlinedFunctions->setToolTip(tr("When disabled, the costs of inlined functions get attributed to the function they got inlined into."));
+
+    m_actions.collapseRecursion = new QAction(tr("Collapse Recursion"), this);
+    m_actions.collapseRecursion->setCheckable(true);
+    connect(m_actions.collapseRecursion, &QAction::toggled, this, &FilterAndZoomStack::setCollapseRecursion);
+    m_actions.collapseRecursion->setToolTip(tr("Aggregate the frames of functions calling themselves, in all views."));
+
+    m_actions.approximateResults = new QAction(tr("Approximate Results"), this);
+    m_actions.approximateResults->setCheckable(true);
+    connect(m_actions.approximateResults, &QAction::toggled, this,
+            [this](bool checked) { setSampleRate(checked ? DefaultSampleRate : 1); });
+    m_actions.approximateResults->setToolTip(
+        tr("Only aggregate a sample of the events when filtering, which is much faster for large data files. "
+           "The summary page shows how far the costs may be off."));
+
+    m_actions.pruneTrees = new QAction(tr("Prune Insignificant Frames"), this);
+    m_actions.pruneTrees->setCheckable(true);
+    connect(m_actions.pruneTrees, &QAction::toggled, this,
+            [this](bool checked) { setPruneThreshold(checked ? DefaultPruneThreshold : 0); });
+    m_actions.pruneTrees->setToolTip(
+        tr("Fold the frames whose costs lie below %1% of the total costs into a single [other] frame per caller, "
+           "in all tree views. This keeps the views responsive for large data files.")
+            .arg(DefaultPruneThreshold * 100));
+
     connect(this, &FilterAndZoomStack::filterChanged, this, &FilterAndZoomStack::updateActions);
+    connect(this, &FilterAndZoomStack::highlightChanged, this, &FilterAndZoomStack::updateActions);
     connect(this, &FilterAndZoomStack::zoomChanged, this, &FilterAndZoomStack::updateActions);
     updateActions();
 }
@@ -77,7 +123,12 @@ FilterAndZoomStack::~FilterAndZoomStack() = default;
 
 Data::FilterAction FilterAndZoomStack::filter() const
 {
-    return m_filterStack.isEmpty() ? Data::FilterAction{} : m_filterStack.last();
+    auto ret = m_filterStack.isEmpty() ? Data::FilterAction{} : m_filterStack.last();
+    ret.collapseInlinedFrames = m_collapseInlinedFrames;
+    ret.collapseRecursion = m_collapseRecursion;
+    ret.sampleRate = m_sampleRate;
+    ret.pruneThreshold = m_pruneThreshold;
+    return ret;
 }
 
 Data::ZoomAction FilterAndZoomStack::zoom() const
@@ -85,15 +136,81 @@ Data::ZoomAction FilterAndZoomStack::zoom() const
     return m_zoomStack.isEmpty() ? Data::ZoomAction{} : m_zoomStack.last();
 }
 
+Data::Symbol FilterAndZoomStack::highlightedSymbol() const
+{
+    return m_highlightedSymbol;
+}
+
 FilterAndZoomStack::Actions FilterAndZoomStack::actions() const
 {
     return m_actions;
 }
 
+FilterAndZoomStack::State FilterAndZoomStack::state() const
+{
+    State state;
+    state.filters = m_filterStack;
+    state.zooms = m_zoomStack;
+    state.highlightedSymbol = m_highlightedSymbol;
+    state.collapseInlinedFrames = m_collapseInlinedFrames;
+    state.collapseRecursion = m_collapseRecursion;
+    state.sampleRate = m_sampleRate;
+    state.pruneThreshold = m_pruneThreshold;
+    return state;
+}
+
+QVector<Data::FilterAction> FilterAndZoomStack::State::appliedFilters() const
+{
+    QVector<Data::FilterAction> ret;
+    ret.reserve(filters.size() + 1);
+    ret.push_back(Data::FilterAction());
+    ret += filters;
+    for (auto& filter : ret) {
+        filter.collapseInlinedFrames = collapseInlinedFrames;
+        filter.collapseRecursion = collapseRecursion;
+        filter.sampleRate = sampleRate;
+        filter.pruneThreshold = pruneThreshold;
+    }
+    return ret;
+}
+
+void FilterAndZoomStack::restoreState(const State& state)
+{
+    m_filterStack = state.filters;
+    m_zoomStack = state.zooms;
+    m_highlightedSymbol = state.highlightedSymbol;
+    m_collapseInlinedFrames = state.collapseInlinedFrames;
+    m_collapseRecursion = state.collapseRecursion;
+    m_sampleRate = std::max(1, state.sampleRate);
+    m_pruneThreshold = std::max(0., state.pruneThreshold);
+    updateModeActions();
+
+    // the unfiltered results are shown already, don't aggregate them once more
+    const auto filter = this->filter();
+    if (filter != Data::FilterAction()) {
+        emit filterChanged(filter);
+    }
+    if (zoom().isValid()) {
+        emit zoomChanged(zoom());
+    }
+    if (m_highlightedSymbol.isValid()) {
+        emit highlightChanged(m_highlightedSymbol);
+    }
+    updateActions();
+}
+
 void FilterAndZoomStack::clear()
 {
     m_filterStack.clear();
     m_zoomStack.clear();
+    m_highlightedSymbol = {};
+    // new results get aggregated with all frames
+    m_collapseInlinedFrames = false;
+    m_collapseRecursion = false;
+    m_sampleRate = 1;
+    m_pruneThreshold = 0;
+    updateModeActions();
+    updateActions();
 }
 
 void FilterAndZoomStack::filterInByTime(const Data::TimeRange &time)
@@ -147,6 +264,20 @@ void FilterAndZoomStack::filterOutByCpu(quint32 cpuId)
     applyFilter(filter);
 }
 
+void FilterAndZoomStack::filterInByFile(qint32 fileId)
+{
+    Data::FilterAction filter;
+    filter.fileId = fileId;
+    applyFilter(filter);
+}
+
+void FilterAndZoomStack::filterOutByFile(qint32 fileId)
+{
+    Data::FilterAction filter;
+    filter.excludeFileIds.push_back(fileId);
+    applyFilter(filter);
+}
+
 void FilterAndZoomStack::filterInBySymbol(const Data::Symbol &symbol)
 {
     Data::FilterAction filter;
@@ -176,14 +307,21 @@ void FilterAndZoomStack::applyFilter(Data::FilterAction filter)
             filter.threadId = lastFilter.threadId;
         if (filter.cpuId == Data::INVALID_CPU_ID)
             filter.cpuId = lastFilter.cpuId;
+        if (filter.fileId == Data::INVALID_FILE_ID)
+            filter.fileId = lastFilter.fileId;
         filter.excludeProcessIds += lastFilter.excludeProcessIds;
         filter.excludeThreadIds += lastFilter.excludeThreadIds;
         filter.excludeCpuIds += lastFilter.excludeCpuIds;
+        filter.excludeFileIds += lastFilter.excludeFileIds;
         filter.excludeSymbols += lastFilter.excludeSymbols;
         filter.includeSymbols += lastFilter.includeSymbols;
         filter.includeSymbols.subtract(filter.excludeSymbols);
     }
 
+    filter.collapseInlinedFrames = m_collapseInlinedFrames;
+    filter.collapseRecursion = m_collapseRecursion;
+    filter.sampleRate = m_sampleRate;
+    filter.pruneThreshold = m_pruneThreshold;
     m_filterStack.push_back(filter);
 
     emit filterChanged(filter);
@@ -192,7 +330,7 @@ void FilterAndZoomStack::applyFilter(Data::FilterAction filter)
 void FilterAndZoomStack::resetFilter()
 {
     m_filterStack.clear();
-    emit filterChanged({});
+    emit filterChanged(filter());
 }
 
 void FilterAndZoomStack::filterOut()
@@ -225,6 +363,80 @@ void FilterAndZoomStack::resetFilterAndZoom()
     resetZoom();
 }
 
+void FilterAndZoomStack::highlightSymbol(const Data::Symbol& symbol)
+{
+    if (symbol == m_highlightedSymbol) {
+        return;
+    }
+    m_highlightedSymbol = symbol;
+    emit highlightChanged(symbol);
+}
+
+void FilterAndZoomStack::resetHighlight()
+{
+    highlightSymbol({});
+}
+
+void FilterAndZoomStack::setCollapseInlinedFrames(bool collapse)
+{
+    if (collapse == m_collapseInlinedFrames) {
+        return;
+    }
+    m_collapseInlinedFrames = collapse;
+    m_actions.showInlinedFunctions->setChecked(!collapse);
+    emit filterChanged(filter());
+}
+
+void FilterAndZoomStack::setCollapseRecursion(bool collapse)
+{
+    if (collapse == m_collapseRecursion) {
+        return;
+    }
+    m_collapseRecursion = collapse;
+    m_actions.collapseRecursion->setChecked(collapse);
+    emit filterChanged(filter());
+}
+
+void FilterAndZoomStack::setSampleRate(int sampleRate)
+{
+    sampleRate = std::max(1, sampleRate);
+    if (sampleRate == m_sampleRate) {
+        return;
+    }
+    m_sampleRate = sampleRate;
+    {
+        QSignalBlocker blocker(m_actions.approximateResults);
+        m_actions.approximateResults->setChecked(sampleRate > 1);
+    }
+    emit filterChanged(filter());
+}
+
+void FilterAndZoomStack::setPruneThreshold(double threshold)
+{
+    threshold = std::max(0., threshold);
+    if (threshold == m_pruneThreshold) {
+        return;
+    }
+    m_pruneThreshold = threshold;
+    {
+        QSignalBlocker blocker(m_actions.pruneTrees);
+        m_actions.pruneTrees->setChecked(threshold > 0);
+    }
+    emit filterChanged(filter());
+}
+
+void FilterAndZoomStack::updateModeActions()
+{
+    QSignalBlocker inlinedBlocker(m_actions.showInlinedFunctions);
+    m_actions.showInlinedFunctions->setChecked(!m_collapseInlinedFrames);
+    QSignalBlocker recursionBlocker(m_actions.collapseRecursion);
+    m_actions.collapseRecursion->setChecked(m_collapseRecursion);
+    QSignalBlocker approximateBlocker(m_actions.approximateResults);
+    m_actions.approximateResults->setChecked(m_sampleRate > 1);
+    QSignalBlocker pruneBlocker(m_actions.pruneTrees);
+    m_actions.pruneTrees->setChecked(m_pruneThreshold > 0);
+}
+
 void FilterAndZoomStack::updateActions()
 {
     const bool isFiltered = filter().isValid();
@@ -236,4 +448,18 @@ void FilterAndZoomStack::updateActions()
     m_actions.resetZoom->setEnabled(isZoomed);
 
     m_actions.resetFilterAndZoom->setEnabled(isZoomed || isFiltered);
+
+    m_actions.resetHighlight->setEnabled(m_highlightedSymbol.isValid());
+}
+
+QDataStream& operator<<(QDataStream& stream, const FilterAndZoomStack::State& state)
+{
+    return stream << state.filters << state.zooms << state.highlightedSymbol << state.collapseInlinedFrames
+                  << state.collapseRecursion << state.sampleRate << state.pruneThreshold;
+}
+
+QDataStream& operator>>(QDataStream& stream, FilterAndZoomStack::State& state)
+{
+    return stream >> state.filters >> state.zooms >> state.highlightedSymbol >> state.collapseInlinedFrames
+        >> state.collapseRecursion >> state.sampleRate >> state.pruneThreshold;
 }
@@ -32,6 +32,7 @@
 #include "data.h"
 
 class QAction;
+class QDataStream;
 
 class FilterAndZoomStack : public QObject
 {
@@ -42,6 +43,8 @@ public:
 
     Data::FilterAction filter() const;
     Data::ZoomAction zoom() const;
+    // the symbol whose samples get highlighted in the time line, unlike a filter this doesn't change the results
+    Data::Symbol highlightedSymbol() const;
 
     struct Actions
     {
@@ -52,10 +55,43 @@ public:
         QAction* resetFilterAndZoom = nullptr;
         QAction* filterInBySymbol = nullptr;
         QAction* filterOutBySymbol = nullptr;
+        QAction* highlightSymbol = nullptr;
+        QAction* resetHighlight = nullptr;
+        QAction* showInlinedFunctions = nullptr;
+        QAction* collapseRecursion = nullptr;
+        QAction* approximateResults = nullptr;
+        QAction* pruneTrees = nullptr;
     };
 
+    // the sample rate used while the results get approximated
+    static const int DefaultSampleRate = 10;
+    // the fraction of the total costs below which the subtrees get folded while pruning is enabled
+    static const constexpr double DefaultPruneThreshold = 0.001;
+
     Actions actions() const;
 
+    // the filters and zoom levels on the stacks and the modes applied to them, which allows keeping them
+    // when the file gets parsed again and saving them as a session
+    struct State
+    {
+        QVector<Data::FilterAction> filters;
+        QVector<Data::ZoomAction> zooms;
+        Data::Symbol highlightedSymbol;
+        bool collapseInlinedFrames = false;
+        bool collapseRecursion = false;
+        int sampleRate = 1;
+        double pruneThreshold = 0;
+
+        // the filters that get applied on every level of the stack with the current modes, like filterOut does,
+        // starting with the one of the unfiltered results
+        QVector<Data::FilterAction> appliedFilters() const;
+    };
+
+    State state() const;
+    // replaces the stacks with the ones of @p state, meant to be called on the unfiltered results after clear().
+    // then only the changes to that get emitted, which applies the last filter and zoom level of @p state
+    void restoreState(const State& state);
+
     void clear();
 
 public slots:
@@ -66,6 +102,8 @@ public slots:
     void filterOutByThread(qint32 threadId);
     void filterInByCpu(quint32 cpuId);
     void filterOutByCpu(quint32 cpuId);
+    void filterInByFile(qint32 fileId);
+    void filterOutByFile(qint32 fileId);
     void filterInBySymbol(const Data::Symbol &symbol);
     void filterOutBySymbol(const Data::Symbol &symbol);
     void applyFilter(Data::FilterAction filter);
@@ -75,15 +113,35 @@ public slots:
     void resetZoom();
     void zoomOut();
     void resetFilterAndZoom();
+    void highlightSymbol(const Data::Symbol& symbol);
+    void resetHighlight();
+    // applies to the current filter and all that follow, until it gets toggled again
+    void setCollapseInlinedFrames(bool collapse);
+    void setCollapseRecursion(bool collapse);
+    // aggregate only about one out of @p sampleRate events, one computes exact results again
+    void setSampleRate(int sampleRate);
+    // fold the subtrees below @p threshold of the total costs into "[other]" nodes, zero shows the complete trees
+    void setPruneThreshold(double threshold);
 
 signals:
     void filterChanged(const Data::FilterAction& filter);
     void zoomChanged(const Data::ZoomAction& zoom);
+    void highlightChanged(const Data::Symbol& symbol);
 
 private:
     void updateActions();
+    // check the actions of the modes without emitting their toggled signals
+    void updateModeActions();
 
     Actions m_actions;
     QVector<Data::FilterAction> m_filterStack;
     QVector<Data::ZoomAction> m_zoomStack;
+    Data::Symbol m_highlightedSymbol;
+    bool m_collapseInlinedFrames = false;
+    bool m_collapseRecursion = false;
+    int m_sampleRate = 1;
+    double m_pruneThreshold = 0;
 };
+
+QDataStream& operator<<(QDataStream& stream, const FilterAndZoomStack::State& state);
+QDataStream& operator>>(QDataStream& stream, FilterAndZoomStack::State& state);
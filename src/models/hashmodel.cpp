@@ -26,3 +26,171 @@
 */
 
 #include "hashmodel.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace {
+// models with fewer rows get the orders of their other columns computed on demand
+const int MinBackgroundSortRows = 1000;
+
+QVector<int> sortedRows(const std::function<bool(int, int)>& lessThan, int numRows)
+{
+    QVector<int> rows(numRows);
+    std::iota(rows.begin(), rows.end(), 0);
+    std::stable_sort(rows.begin(), rows.end(), lessThan);
+    return rows;
+}
+}
+
+AbstractHashModel::AbstractHashModel(QObject* parent)
+    : QAbstractTableModel(parent)
+{
+    qRegisterMetaType<QVector<QVector<int>>>();
+}
+
+AbstractHashModel::~AbstractHashModel() = default;
+
+void AbstractHashModel::sort(int column, Qt::SortOrder order)
+{
+    m_sortColumn = column;
+    if (column < 0 || column >= m_orders.size()) {
+        // unsorted, or the column only shows up with the next results
+        setOrder({}, order);
+        return;
+    }
+    if (m_orders[column].isEmpty()) {
+        m_orders[column] = rowOrder(column);
+    }
+    setOrder(m_orders[column], order);
+}
+
+int AbstractHashModel::modelRow(int storageRow) const
+{
+    if (m_order.isEmpty()) {
+        return storageRow;
+    }
+    const int row = m_order.indexOf(storageRow);
+    if (row == -1 || m_sortOrder == Qt::AscendingOrder) {
+        return row;
+    }
+    return m_order.size() - row - 1;
+}
+
+void AbstractHashModel::resetSortOrders(int numRows)
+{
+    // cancel any sorting that is still running
+    m_sortJobs.cancel();
+    const int numColumns = columnCount();
+    m_numRows = numRows;
+    m_orders = QVector<QVector<int>>(numColumns);
+    m_order.clear();
+    if (m_sortColumn >= 0 && m_sortColumn < numColumns) {
+        m_orders[m_sortColumn] = rowOrder(m_sortColumn);
+        m_order = m_orders[m_sortColumn];
+    }
+
+    if (numRows < MinBackgroundSortRows) {
+        return;
+    }
+
+    QVector<LessThan> lessThans(numColumns);
+    for (int column = 0; column < numColumns; ++column) {
+        if (column != m_sortColumn) {
+            lessThans[column] = rowLessThan(column);
+        }
+    }
+
+    const auto sortColumns = [lessThans, numRows, this](const JobScheduler::Token& token) {
+        QVector<QVector<int>> orders(lessThans.size());
+        for (int column = 0; column < lessThans.size(); ++column) {
+            if (token.isCanceled()) {
+                // new rows arrived in the meantime
+                return;
+            }
+            if (lessThans[column]) {
+                orders[column] = sortedRows(lessThans[column], numRows);
+            }
+        }
+        QMetaObject::invokeMethod(this, "setSortOrders", Qt::QueuedConnection, Q_ARG(uint, token.generation()),
+                                  Q_ARG(QVector<QVector<int>>, orders));
+    };
+    // the other columns only get shown once the user sorts by them
+    m_sortJobs.schedule(JobScheduler::Priority::Background, sortColumns);
+}
+
+void AbstractHashModel::invalidateSortOrder(int column)
+{
+    if (column < 0 || column >= m_orders.size()) {
+        return;
+    }
+    // pending background orders may be based on the old data, the other columns get sorted on demand instead
+    m_sortJobs.cancel();
+    m_orders[column].clear();
+    if (column == m_sortColumn) {
+        sort(column, m_sortOrder);
+    }
+}
+
+void AbstractHashModel::setSortOrders(uint generation, const QVector<QVector<int>>& orders)
+{
+    if (!m_sortJobs.isCurrent(generation)) {
+        return;
+    }
+    for (int column = 0; column < orders.size(); ++column) {
+        if (m_orders[column].isEmpty()) {
+            m_orders[column] = orders[column];
+        }
+    }
+}
+
+QVector<int> AbstractHashModel::rowOrder(int column) const
+{
+    return sortedRows(rowLessThan(column), m_numRows);
+}
+
+void AbstractHashModel::setOrder(const QVector<int>& order, Qt::SortOrder sortOrder)
+{
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+
+    const auto oldIndices = persistentIndexList();
+    QVector<int> storageRows;
+    storageRows.reserve(oldIndices.size());
+    for (const auto& index : oldIndices) {
+        storageRows.append(storageRow(index.row()));
+    }
+
+    m_order = order;
+    m_sortOrder = sortOrder;
+
+    if (!oldIndices.isEmpty()) {
+        // invert the order once instead of searching it for every persistent index
+        QVector<int> rows(m_numRows);
+        for (int row = 0; row < m_numRows; ++row) {
+            rows[storageRow(row)] = row;
+        }
+        QModelIndexList newIndices;
+        newIndices.reserve(oldIndices.size());
+        for (int i = 0; i < oldIndices.size(); ++i) {
+            newIndices.append(index(rows.value(storageRows[i]), oldIndices[i].column()));
+        }
+        changePersistentIndexList(oldIndices, newIndices);
+    }
+
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
+
+HashModelProxy::HashModelProxy(QObject* parent)
+    : QSortFilterProxyModel(parent)
+{
+}
+
+HashModelProxy::~HashModelProxy() = default;
+
+void HashModelProxy::sort(int column, Qt::SortOrder order)
+{
+    // don't sort in the proxy, the source model only has to swap its precomputed row order
+    if (auto model = sourceModel()) {
+        model->sort(column, order);
+    }
+}
@@ -29,14 +29,85 @@
 
 #include <QAbstractTableModel>
 #include <QHash>
+#include <QSortFilterProxyModel>
 #include <QVector>
 
+#include <functional>
+
+#include "costdelegate.h"
+#include "jobscheduler.h"
+
+// non-template base class of the hash models, which sorts them through precomputed row orders
+// the order of every column gets computed once in a background thread when new rows arrive, changing the sort
+// column or order afterwards only swaps the active order
+class AbstractHashModel : public QAbstractTableModel, public CostCellProvider
+{
+    Q_OBJECT
+public:
+    explicit AbstractHashModel(QObject* parent = nullptr);
+    ~AbstractHashModel() override;
+
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) final override;
+
+protected:
+    // compares two storage rows, i.e. the unsorted row indices
+    using LessThan = std::function<bool(int lhs, int rhs)>;
+
+    // returns the comparison for @p column
+    // the function gets called from a background thread, so it must only use data it captured by value
+    virtual LessThan rowLessThan(int column) const = 0;
+
+    // maps a row of the model to its storage row
+    int storageRow(int row) const
+    {
+        if (m_order.isEmpty()) {
+            return row;
+        }
+        return m_order.value(m_sortOrder == Qt::AscendingOrder ? row : m_order.size() - row - 1, row);
+    }
+    // maps a storage row to its row in the model
+    int modelRow(int storageRow) const;
+
+    // drops the orders of the previous rows, call this before ending a model reset
+    // the current sort column gets sorted right away, all others in the background
+    void resetSortOrders(int numRows);
+
+    // recomputes the order of @p column, e.g. when the displayed symbols changed
+    void invalidateSortOrder(int column);
+
+private slots:
+    void setSortOrders(uint generation, const QVector<QVector<int>>& orders);
+
+private:
+    QVector<int> rowOrder(int column) const;
+    void setOrder(const QVector<int>& order, Qt::SortOrder sortOrder);
+
+    // the ascending order of every column, empty ones haven't been computed yet
+    QVector<QVector<int>> m_orders;
+    QVector<int> m_order;
+    int m_numRows = 0;
+    int m_sortColumn = -1;
+    Qt::SortOrder m_sortOrder = Qt::AscendingOrder;
+    JobScheduler m_sortJobs;
+};
+
+// filter proxy for the hash models, sorting is forwarded to the source model, see AbstractHashModel
+class HashModelProxy : public QSortFilterProxyModel
+{
+    Q_OBJECT
+public:
+    explicit HashModelProxy(QObject* parent = nullptr);
+    ~HashModelProxy() override;
+
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+};
+
 template<typename Rows, typename ModelImpl>
-class HashModel : public QAbstractTableModel
+class HashModel : public AbstractHashModel
 {
 public:
     explicit HashModel(QObject* parent = nullptr)
-        : QAbstractTableModel(parent)
+        : AbstractHashModel(parent)
     {
     }
     virtual ~HashModel() = default;
@@ -67,12 +138,27 @@ public:
             return {};
         }
 
-        const auto& key = m_keys.value(index.row());
-        const auto& value = m_values.value(index.row());
+        const auto row = storageRow(index.row());
+        const auto& key = m_keys.value(row);
+        const auto& value = m_values.value(row);
 
         return cell(index.column(), role, key, value);
     }
 
+    bool cellCost(const QModelIndex& index, qint64* cost, qint64* totalCost) const final override
+    {
+        if (!hasIndex(index.row(), index.column(), index.parent())) {
+            return false;
+        }
+
+        // unlike value(), at() doesn't copy the costs of the entry
+        const auto row = storageRow(index.row());
+        if (row < 0 || row >= m_values.size()) {
+            return false;
+        }
+        return entryCost(index.column(), m_values.at(row), cost, totalCost);
+    }
+
     QModelIndex indexForKey(const typename Rows::key_type& key, int column = 0) const
     {
         auto it = std::find(m_keys.begin(), m_keys.end(), key);
@@ -80,7 +166,7 @@ public:
             return {};
         }
         const int row = std::distance(m_keys.begin(), it);
-        return index(row, column);
+        return index(modelRow(row), column);
     }
 
 protected:
@@ -95,12 +181,16 @@ protected:
             m_keys.push_back(it.key());
             m_values.push_back(it.value());
         }
+        resetSortOrders(m_keys.size());
         endResetModel();
     }
 
     virtual QVariant headerCell(int column, int role) const = 0;
     virtual QVariant cell(int column, int role, const typename Rows::key_type& key,
                           const typename Rows::mapped_type& entry) const = 0;
+    // the typed shortcut for the SortRole and TotalCostRole of the cost columns, see CostCellProvider
+    virtual bool entryCost(int column, const typename Rows::mapped_type& entry, qint64* cost,
+                           qint64* totalCost) const = 0;
     virtual int numColumns() const = 0;
 
     QVector<typename Rows::key_type> m_keys;
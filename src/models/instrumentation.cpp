@@ -0,0 +1,147 @@
+/*
+  instrumentation.cpp
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "instrumentation.h"
+
+#include <QHash>
+#include <QLoggingCategory>
+#include <QMutex>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cstring>
+
+#include "../util.h"
+
+Q_LOGGING_CATEGORY(LOG_INSTRUMENTATION, "hotspot.instrumentation", QtInfoMsg)
+
+namespace {
+struct Registry
+{
+    QMutex mutex;
+    // the keys point to the string literals passed by the callers
+    QHash<QByteArray, Instrumentation::Stage> stages;
+};
+
+Registry& registry()
+{
+    static Registry registry;
+    return registry;
+}
+
+Instrumentation::Stage& stage(Registry& registry, const char* name, bool isCounter)
+{
+    auto& stage = registry.stages[QByteArray::fromRawData(name, static_cast<int>(strlen(name)))];
+    if (stage.name.isEmpty()) {
+        stage.name = QString::fromLatin1(name);
+        stage.isCounter = isCounter;
+    }
+    return stage;
+}
+}
+
+bool Instrumentation::isEnabled()
+{
+    static const bool enabled = qEnvironmentVariableIntValue("HOTSPOT_INSTRUMENTATION");
+    return enabled;
+}
+
+void Instrumentation::addTime(const char* name, quint64 nanoseconds)
+{
+    if (!isEnabled()) {
+        return;
+    }
+    auto& reg = registry();
+    QMutexLocker lock(&reg.mutex);
+    auto& entry = stage(reg, name, false);
+    ++entry.count;
+    entry.totalTime += nanoseconds;
+    entry.maxTime = std::max(entry.maxTime, nanoseconds);
+}
+
+void Instrumentation::addCount(const char* name, quint64 value)
+{
+    if (!isEnabled()) {
+        return;
+    }
+    auto& reg = registry();
+    QMutexLocker lock(&reg.mutex);
+    stage(reg, name, true).count += value;
+}
+
+QVector<Instrumentation::Stage> Instrumentation::stages()
+{
+    QVector<Stage> ret;
+    {
+        auto& reg = registry();
+        QMutexLocker lock(&reg.mutex);
+        ret.reserve(reg.stages.size());
+        for (const auto& entry : reg.stages) {
+            ret.push_back(entry);
+        }
+    }
+    std::sort(ret.begin(), ret.end(), [](const Stage& lhs, const Stage& rhs) { return lhs.name < rhs.name; });
+    return ret;
+}
+
+void Instrumentation::reset()
+{
+    auto& reg = registry();
+    QMutexLocker lock(&reg.mutex);
+    reg.stages.clear();
+}
+
+QString Instrumentation::format()
+{
+    QString ret;
+    QTextStream stream(&ret);
+    for (const auto& entry : stages()) {
+        stream << entry.name << ": ";
+        if (entry.isCounter) {
+            stream << entry.count;
+        } else {
+            stream << entry.count << "x, total " << Util::formatTimeString(entry.totalTime) << ", avg "
+                   << Util::formatTimeString(entry.totalTime / entry.count) << ", max "
+                   << Util::formatTimeString(entry.maxTime);
+        }
+        stream << '\n';
+    }
+    stream.flush();
+    return ret;
+}
+
+void Instrumentation::dump()
+{
+    if (!isEnabled()) {
+        return;
+    }
+    const auto lines = format().split(QLatin1Char('\n'), QString::SkipEmptyParts);
+    for (const auto& line : lines) {
+        qCInfo(LOG_INSTRUMENTATION).noquote() << line;
+    }
+}
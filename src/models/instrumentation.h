@@ -0,0 +1,88 @@
+/*
+  instrumentation.h
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QVector>
+
+// lightweight timers and counters for the stages of hotspot's own pipeline. they only get collected when
+// HOTSPOT_INSTRUMENTATION is set, otherwise the scoped timers don't even start their clock
+namespace Instrumentation {
+struct Stage
+{
+    QString name;
+    // number of times the stage ran, or the accumulated value of a counter
+    quint64 count = 0;
+    quint64 totalTime = 0;
+    quint64 maxTime = 0;
+    bool isCounter = false;
+};
+
+bool isEnabled();
+
+// add a run of @p stage that took @p nanoseconds, @p stage must be a string literal
+void addTime(const char* stage, quint64 nanoseconds);
+// add @p value to the @p counter, @p counter must be a string literal
+void addCount(const char* counter, quint64 value = 1);
+
+// @return all stages and counters sorted by their name
+QVector<Stage> stages();
+void reset();
+
+// @return a human readable table of the stages and counters
+QString format();
+// write the stages and counters to the log
+void dump();
+
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(const char* stage)
+        : m_stage(stage)
+    {
+        if (isEnabled()) {
+            m_timer.start();
+        }
+    }
+
+    ~ScopedTimer()
+    {
+        if (m_timer.isValid()) {
+            addTime(m_stage, m_timer.nsecsElapsed());
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(ScopedTimer)
+
+    const char* m_stage;
+    QElapsedTimer m_timer;
+};
+}
@@ -0,0 +1,95 @@
+/*
+  jobscheduler.cpp
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "jobscheduler.h"
+
+#include <ThreadWeaver/Job>
+#include <ThreadWeaver/ThreadWeaver>
+
+namespace {
+class ScheduledJob : public ThreadWeaver::Job
+{
+public:
+    ScheduledJob(JobScheduler::Priority priority, JobScheduler::Token token, JobScheduler::Job job)
+        : m_priority(static_cast<int>(priority))
+        , m_token(std::move(token))
+        , m_job(std::move(job))
+    {
+    }
+
+    // the queue starts the jobs with the highest priority first
+    int priority() const override
+    {
+        return m_priority;
+    }
+
+protected:
+    void run(ThreadWeaver::JobPointer /*self*/, ThreadWeaver::Thread* /*thread*/) override
+    {
+        if (!m_token.isCanceled()) {
+            m_job(m_token);
+        }
+        // release the captured data right away, the queue may hold on to finished jobs for a while
+        m_job = nullptr;
+    }
+
+private:
+    const int m_priority;
+    const JobScheduler::Token m_token;
+    JobScheduler::Job m_job;
+};
+}
+
+JobScheduler::Token::Token(QSharedPointer<QAtomicInt> current, uint generation)
+    : m_current(std::move(current))
+    , m_generation(generation)
+{
+}
+
+JobScheduler::JobScheduler()
+    : m_current(new QAtomicInt(0))
+{
+}
+
+JobScheduler::~JobScheduler()
+{
+    cancel();
+}
+
+JobScheduler::Token JobScheduler::schedule(Priority priority, Job job)
+{
+    Token token(m_current, cancel());
+    using namespace ThreadWeaver;
+    stream() << JobPointer(new ScheduledJob(priority, token, std::move(job)));
+    return token;
+}
+
+uint JobScheduler::cancel()
+{
+    return m_current->fetchAndAddOrdered(1) + 1;
+}
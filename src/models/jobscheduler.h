@@ -0,0 +1,96 @@
+/*
+  jobscheduler.h
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <QAtomicInt>
+#include <QSharedPointer>
+
+#include <functional>
+
+// runs the background jobs for one kind of request, e.g. building the data of a view, where every new request
+// supersedes the previous one. the jobs of superseded requests don't start at all when no thread picked them up yet,
+// running ones can stop early by checking their token. results must only be applied when their generation is still
+// the current one, see isCurrent
+class JobScheduler
+{
+public:
+    enum class Priority
+    {
+        // precomputations that nothing is waiting for yet
+        Background,
+        // work whose results are about to get shown, this runs before all background jobs that didn't start yet
+        Visible
+    };
+
+    // identifies a single request
+    class Token
+    {
+    public:
+        uint generation() const
+        {
+            return m_generation;
+        }
+
+        // true once a newer request got scheduled or the scheduler got canceled or destroyed
+        bool isCanceled() const
+        {
+            return static_cast<uint>(m_current->load()) != m_generation;
+        }
+
+    private:
+        friend class JobScheduler;
+        Token(QSharedPointer<QAtomicInt> current, uint generation);
+
+        QSharedPointer<QAtomicInt> m_current;
+        uint m_generation;
+    };
+
+    using Job = std::function<void(const Token& token)>;
+
+    JobScheduler();
+    ~JobScheduler();
+
+    // supersedes the current request and runs @p job for the new one in a background thread
+    Token schedule(Priority priority, Job job);
+    // supersedes the current request without scheduling a new one
+    // @return the generation that is current afterwards, e.g. to apply empty results directly
+    uint cancel();
+
+    // true when @p generation is the one of the last request, i.e. its results are still up to date
+    bool isCurrent(uint generation) const
+    {
+        return static_cast<uint>(m_current->load()) == generation;
+    }
+
+private:
+    Q_DISABLE_COPY(JobScheduler)
+
+    // shared with the tokens, such that the jobs can outlive the scheduler
+    QSharedPointer<QAtomicInt> m_current;
+};
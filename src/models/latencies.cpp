@@ -0,0 +1,455 @@
+/*
+  latencies.cpp
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "latencies.h"
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QtAlgorithms>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+// the number of slowest intervals that are kept per entry, to show the stacks behind the tail
+const int NumSlowest = 16;
+// stacks get named after their innermost frames
+const int NumStackNameFrames = 3;
+
+void addToEntry(Data::LatencyEntry* entry, const Data::LatencyInterval& interval)
+{
+    entry->histogram.add(interval.duration);
+
+    // a min-heap of the slowest intervals, the fastest of them is at the front
+    auto& slowest = entry->slowest;
+    const auto byDuration = [](const Data::LatencyInterval& lhs, const Data::LatencyInterval& rhs) {
+        return lhs.duration > rhs.duration;
+    };
+    if (slowest.size() < NumSlowest) {
+        slowest.push_back(interval);
+        std::push_heap(slowest.begin(), slowest.end(), byDuration);
+    } else if (interval.duration > slowest.front().duration) {
+        std::pop_heap(slowest.begin(), slowest.end(), byDuration);
+        slowest.last() = interval;
+        std::push_heap(slowest.begin(), slowest.end(), byDuration);
+    }
+}
+
+class LatencyCollector
+{
+public:
+    LatencyCollector(const Data::EventResults& events, const Data::BottomUpResults& bottomUp, const QString& name)
+        : m_events(events)
+        , m_bottomUp(bottomUp)
+    {
+        m_source.name = name;
+    }
+
+    void add(const Data::LatencyInterval& interval)
+    {
+        ++m_numIntervals;
+        m_source.histogram.add(interval.duration);
+        addToEntry(entry(Data::LatencySource::ByThread, static_cast<quint32>(interval.threadIndex)), interval);
+
+        if (interval.stackId < 0 || interval.stackId >= m_events.stacks.size()) {
+            return;
+        }
+        addToEntry(entry(Data::LatencySource::ByStack, static_cast<quint32>(interval.stackId)), interval);
+
+        auto addSymbol = [this, &interval](const Data::Symbol& symbol, const Data::Location& /*location*/) -> bool {
+            if (!symbol.isValid()) {
+                return true;
+            }
+            const auto index = entryIndex(Data::LatencySource::BySymbol, symbol.id);
+            // recursive stacks must not count the same interval several times
+            if (m_lastInterval[index] != m_numIntervals) {
+                m_lastInterval[index] = m_numIntervals;
+                auto& entry = m_source.entries[Data::LatencySource::BySymbol][index];
+                if (!entry.symbol.isValid()) {
+                    entry.symbol = symbol;
+                }
+                addToEntry(&entry, interval);
+            }
+            return true;
+        };
+        m_bottomUp.foreachFrame(m_events.stacks.at(interval.stackId), addSymbol);
+    }
+
+    Data::LatencySource finalize()
+    {
+        for (auto& entries : m_source.entries) {
+            for (auto& entry : entries) {
+                std::sort(entry.slowest.begin(), entry.slowest.end(),
+                          [](const Data::LatencyInterval& lhs, const Data::LatencyInterval& rhs) {
+                              return lhs.duration > rhs.duration;
+                          });
+            }
+        }
+        nameEntries();
+        return m_source;
+    }
+
+private:
+    int entryIndex(Data::LatencySource::Grouping grouping, quint32 key)
+    {
+        auto& indices = m_indices[grouping];
+        auto it = indices.find(key);
+        if (it == indices.end()) {
+            it = indices.insert(key, m_source.entries[grouping].size());
+            m_source.entries[grouping].push_back({});
+            if (grouping == Data::LatencySource::BySymbol) {
+                m_lastInterval.push_back(0);
+            }
+        }
+        return it.value();
+    }
+
+    Data::LatencyEntry* entry(Data::LatencySource::Grouping grouping, quint32 key)
+    {
+        return &m_source.entries[grouping][entryIndex(grouping, key)];
+    }
+
+    QString stackName(qint32 stackId) const
+    {
+        QStringList frames;
+        bool truncated = false;
+        auto addFrame = [&frames, &truncated](const Data::Symbol& symbol, const Data::Location& /*location*/) -> bool {
+            if (frames.size() == NumStackNameFrames) {
+                truncated = true;
+                return false;
+            }
+            frames.append(Util::formatSymbol(symbol));
+            return true;
+        };
+        m_bottomUp.foreachFrame(m_events.stacks.at(stackId), addFrame);
+        if (truncated) {
+            frames.append(QStringLiteral("…"));
+        }
+        return frames.join(QStringLiteral(" ← "));
+    }
+
+    void nameEntries()
+    {
+        // the names are only needed once per entry, not once per interval
+        for (auto it = m_indices[Data::LatencySource::ByThread].cbegin(),
+                  end = m_indices[Data::LatencySource::ByThread].cend();
+             it != end; ++it) {
+            const auto& thread = m_events.threads.at(static_cast<int>(it.key()));
+            m_source.entries[Data::LatencySource::ByThread][it.value()].name =
+                QStringLiteral("%1 (#%2)").arg(thread.name, QString::number(thread.tid));
+        }
+        for (auto it = m_indices[Data::LatencySource::ByStack].cbegin(),
+                  end = m_indices[Data::LatencySource::ByStack].cend();
+             it != end; ++it) {
+            m_source.entries[Data::LatencySource::ByStack][it.value()].name =
+                stackName(static_cast<qint32>(it.key()));
+        }
+        for (auto& entry : m_source.entries[Data::LatencySource::BySymbol]) {
+            entry.name = Util::formatSymbol(entry.symbol);
+        }
+    }
+
+    const Data::EventResults& m_events;
+    const Data::BottomUpResults& m_bottomUp;
+    Data::LatencySource m_source;
+    QHash<quint32, int> m_indices[Data::LatencySource::NUM_GROUPINGS];
+    // the last interval that got added to each symbol entry, starting at one
+    QVector<int> m_lastInterval;
+    int m_numIntervals = 0;
+};
+
+// @return the index of the thread @p tid that is alive at @p time, or -1
+int findThread(const Data::EventResults& events, const QMultiHash<qint32, int>& threadsByTid, qint32 tid,
+               qint32 fileId, quint64 time)
+{
+    for (auto it = threadsByTid.find(tid), end = threadsByTid.end(); it != end && it.key() == tid; ++it) {
+        const auto& thread = events.threads.at(it.value());
+        if (thread.fileId == fileId && thread.time.contains(time)) {
+            return it.value();
+        }
+    }
+    return -1;
+}
+
+// @return the stack of the sample that @p thread recorded at exactly @p time, or -1
+qint32 stackAt(const Data::ThreadEvents& thread, quint64 time)
+{
+    const auto& events = thread.events;
+    const auto it = events.lowerBound(events.begin(), events.end(), time);
+    return it != events.end() && it->time == time ? it->stackId : -1;
+}
+
+void addTracepointPair(const Data::EventResults& events, const Data::BottomUpResults& bottomUp,
+                       const QMultiHash<qint32, int>& threadsByTid, const Data::TracepointEvents& enter,
+                       const Data::TracepointEvents& exit, QVector<Data::LatencySource>* sources)
+{
+    LatencyCollector collector(events, bottomUp,
+                               QStringLiteral("%1:%2 - %3").arg(enter.system, enter.name, exit.name));
+
+    // the time of the last unmatched enter of each thread
+    QHash<qint32, quint64> pending;
+    int i = 0;
+    int j = 0;
+    while (i < enter.size() || j < exit.size()) {
+        if (j == exit.size() || (i < enter.size() && enter.times[i] <= exit.times[j])) {
+            pending[enter.threadIds[i]] = enter.times[i];
+            ++i;
+            continue;
+        }
+
+        const auto tid = exit.threadIds[j];
+        const auto it = pending.find(tid);
+        if (it != pending.end()) {
+            Data::LatencyInterval interval;
+            interval.time = it.value();
+            interval.duration = exit.times[j] - it.value();
+            interval.threadIndex = findThread(events, threadsByTid, tid, enter.fileId, interval.time);
+            if (interval.threadIndex != -1) {
+                interval.stackId = stackAt(events.threads.at(interval.threadIndex), interval.time);
+                collector.add(interval);
+            }
+            pending.erase(it);
+        }
+        ++j;
+    }
+
+    auto source = collector.finalize();
+    if (source.histogram.count()) {
+        sources->push_back(source);
+    }
+}
+
+bool isWakeup(const Data::TracepointEvents& tracepoint)
+{
+    return tracepoint.system == QLatin1String("sched")
+        && (tracepoint.name == QLatin1String("sched_wakeup") || tracepoint.name == QLatin1String("sched_wakeup_new"));
+}
+
+// the time between a thread getting woken up and it getting switched in on any CPU, i.e. the time it waited in
+// the run queue. this pairs the sched:sched_wakeup tracepoints, whose pid field holds the woken thread, with the
+// context switch tracks
+void addRunQueueLatencies(const Data::EventResults& events, const Data::BottomUpResults& bottomUp,
+                          const QMultiHash<qint32, int>& threadsByTid, QVector<Data::LatencySource>* sources)
+{
+    struct Transition
+    {
+        quint64 time;
+        qint32 tid;
+        qint32 fileId;
+        // wakeups sort before the switches at the same time
+        bool isSwitch;
+
+        bool operator<(const Transition& rhs) const
+        {
+            return std::tie(time, isSwitch) < std::tie(rhs.time, rhs.isSwitch);
+        }
+    };
+
+    std::vector<Transition> transitions;
+    for (const auto& tracepoint : events.tracepoints) {
+        const auto pidField = tracepoint.fieldIndex(QStringLiteral("pid"));
+        if (!isWakeup(tracepoint) || pidField == -1) {
+            continue;
+        }
+        const auto& wokenTids = tracepoint.fields[pidField].values;
+        for (int i = 0, c = tracepoint.size(); i < c; ++i) {
+            transitions.push_back({tracepoint.times[i], static_cast<qint32>(wokenTids.value(i, Data::INVALID_TID)),
+                                   tracepoint.fileId, false});
+        }
+    }
+    if (transitions.empty()) {
+        return;
+    }
+    for (const auto& track : events.contextSwitches) {
+        for (int i = 0, c = track.size(); i < c; ++i) {
+            if (track.threadIds[i] != Data::INVALID_TID) {
+                transitions.push_back({track.times[i], track.threadIds[i], track.fileId, true});
+            }
+        }
+    }
+    std::sort(transitions.begin(), transitions.end());
+
+    LatencyCollector collector(events, bottomUp, QCoreApplication::translate("Data", "run-queue latency"));
+    // the time of the first wakeup of every thread that didn't get switched in since then, keyed by file and tid
+    QHash<quint64, quint64> woken;
+    for (const auto& transition : transitions) {
+        const auto key = (static_cast<quint64>(static_cast<quint32>(transition.fileId)) << 32)
+            | static_cast<quint32>(transition.tid);
+        if (!transition.isSwitch) {
+            if (!woken.contains(key)) {
+                woken.insert(key, transition.time);
+            }
+            continue;
+        }
+
+        const auto it = woken.find(key);
+        if (it == woken.end()) {
+            continue;
+        }
+        Data::LatencyInterval interval;
+        interval.time = it.value();
+        interval.duration = transition.time - it.value();
+        interval.threadIndex = findThread(events, threadsByTid, transition.tid, transition.fileId, interval.time);
+        if (interval.threadIndex != -1) {
+            collector.add(interval);
+        }
+        woken.erase(it);
+    }
+
+    auto source = collector.finalize();
+    if (source.histogram.count()) {
+        sources->push_back(source);
+    }
+}
+}
+
+int Data::LatencyHistogram::bucket(quint64 value)
+{
+    if (value < SubBuckets) {
+        return static_cast<int>(value);
+    }
+    // the position of the highest bit selects the range, the bits below it the sub bucket within there
+    const int exponent = 63 - static_cast<int>(qCountLeadingZeroBits(value));
+    const int shift = exponent - SubBucketBits;
+    const auto subBucket = static_cast<int>((value >> shift) & (SubBuckets - 1));
+    return SubBuckets + shift * SubBuckets + subBucket;
+}
+
+quint64 Data::LatencyHistogram::bucketEnd(int bucket)
+{
+    if (bucket < SubBuckets) {
+        return static_cast<quint64>(bucket);
+    }
+    const int shift = (bucket - SubBuckets) / SubBuckets;
+    const auto subBucket = static_cast<quint64>((bucket - SubBuckets) % SubBuckets);
+    const auto start = (SubBuckets + subBucket) << shift;
+    return start + ((quint64(1) << shift) - 1);
+}
+
+void Data::LatencyHistogram::add(quint64 value)
+{
+    const auto index = bucket(value);
+    if (index >= m_counts.size()) {
+        m_counts.resize(index + 1);
+    }
+    ++m_counts[index];
+    ++m_count;
+    m_total += value;
+    m_min = std::min(m_min, value);
+    m_max = std::max(m_max, value);
+}
+
+void Data::LatencyHistogram::merge(const LatencyHistogram& other)
+{
+    if (other.m_counts.size() > m_counts.size()) {
+        m_counts.resize(other.m_counts.size());
+    }
+    for (int i = 0, c = other.m_counts.size(); i < c; ++i) {
+        m_counts[i] += other.m_counts[i];
+    }
+    m_count += other.m_count;
+    m_total += other.m_total;
+    m_min = std::min(m_min, other.m_min);
+    m_max = std::max(m_max, other.m_max);
+}
+
+quint64 Data::LatencyHistogram::percentile(double percentile) const
+{
+    if (!m_count) {
+        return 0;
+    }
+    const auto rank = std::max(quint64(1), static_cast<quint64>(std::ceil(percentile / 100. * m_count)));
+    quint64 seen = 0;
+    for (int i = 0, c = m_counts.size(); i < c; ++i) {
+        seen += m_counts[i];
+        if (seen >= rank) {
+            return std::min(bucketEnd(i), m_max);
+        }
+    }
+    return m_max;
+}
+
+Data::LatencyResults Data::LatencyResults::fromEvents(const EventResults& events, const BottomUpResults& bottomUp)
+{
+    LatencyResults results;
+
+    if (events.offCpuTimeCostId != -1) {
+        LatencyCollector collector(events, bottomUp, events.totalCosts.value(events.offCpuTimeCostId).label);
+        for (int threadIndex = 0, numThreads = events.threads.size(); threadIndex < numThreads; ++threadIndex) {
+            const auto& threadEvents = events.threads[threadIndex].events;
+            for (int i = 0, c = threadEvents.size(); i < c; ++i) {
+                if (threadEvents.type(i) != events.offCpuTimeCostId) {
+                    continue;
+                }
+                Data::LatencyInterval interval;
+                interval.time = threadEvents.time(i);
+                interval.duration = threadEvents.cost(i);
+                interval.threadIndex = threadIndex;
+                interval.stackId = threadEvents.stackId(i);
+                collector.add(interval);
+            }
+        }
+        auto source = collector.finalize();
+        if (source.histogram.count()) {
+            results.sources.push_back(source);
+        }
+    }
+
+    if (events.tracepoints.isEmpty()) {
+        return results;
+    }
+
+    QMultiHash<qint32, int> threadsByTid;
+    for (int i = 0, c = events.threads.size(); i < c; ++i) {
+        threadsByTid.insert(events.threads[i].tid, i);
+    }
+
+    const auto enterTag = QStringLiteral("_enter");
+    const auto exitTag = QStringLiteral("_exit");
+    for (const auto& enter : events.tracepoints) {
+        const auto tagIndex = enter.name.indexOf(enterTag);
+        if (tagIndex == -1) {
+            continue;
+        }
+        auto exitName = enter.name;
+        exitName.replace(tagIndex, enterTag.size(), exitTag);
+        const auto exit = std::find_if(events.tracepoints.begin(), events.tracepoints.end(),
+                                       [&enter, &exitName](const Data::TracepointEvents& tracepoint) {
+                                           return tracepoint.system == enter.system && tracepoint.name == exitName
+                                               && tracepoint.fileId == enter.fileId;
+                                       });
+        if (exit != events.tracepoints.end()) {
+            addTracepointPair(events, bottomUp, threadsByTid, enter, *exit, &results.sources);
+        }
+    }
+
+    if (!events.contextSwitches.isEmpty()) {
+        addRunQueueLatencies(events, bottomUp, threadsByTid, &results.sources);
+    }
+    return results;
+}
@@ -0,0 +1,147 @@
+/*
+  latencies.h
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "data.h"
+
+namespace Data {
+// a histogram with logarithmically sized buckets like HdrHistogram. every value gets recorded with a relative
+// error of less than 1 / SubBuckets, independent of its magnitude, while the memory stays bounded by the bit width
+class LatencyHistogram
+{
+public:
+    enum
+    {
+        SubBucketBits = 4,
+        SubBuckets = 1 << SubBucketBits
+    };
+
+    void add(quint64 value);
+    void merge(const LatencyHistogram& other);
+
+    quint64 count() const
+    {
+        return m_count;
+    }
+
+    quint64 total() const
+    {
+        return m_total;
+    }
+
+    quint64 min() const
+    {
+        return m_count ? m_min : 0;
+    }
+
+    quint64 max() const
+    {
+        return m_max;
+    }
+
+    // @return the smallest recorded value that is not exceeded by @p percentile percent of all values,
+    //         rounded up to the end of its bucket but never larger than the maximum
+    quint64 percentile(double percentile) const;
+
+    static int bucket(quint64 value);
+    // @return the largest value that falls into @p bucket
+    static quint64 bucketEnd(int bucket);
+
+    bool operator==(const LatencyHistogram& rhs) const
+    {
+        return std::tie(m_counts, m_count, m_total, m_min, m_max)
+            == std::tie(rhs.m_counts, rhs.m_count, rhs.m_total, rhs.m_min, rhs.m_max);
+    }
+
+private:
+    QVector<quint64> m_counts;
+    quint64 m_count = 0;
+    quint64 m_total = 0;
+    quint64 m_min = std::numeric_limits<quint64>::max();
+    quint64 m_max = 0;
+};
+
+// a single wait, like the time a thread spent off-CPU or between two paired tracepoints
+struct LatencyInterval
+{
+    quint64 time = 0;
+    quint64 duration = 0;
+    // index into EventResults::threads
+    qint32 threadIndex = -1;
+    // index into EventResults::stacks, -1 when the stack is unknown
+    qint32 stackId = -1;
+};
+
+struct LatencyEntry
+{
+    QString name;
+    // only set for the entries grouped by symbol
+    Symbol symbol;
+    LatencyHistogram histogram;
+    // the slowest intervals of this entry, sorted by descending duration
+    QVector<LatencyInterval> slowest;
+};
+
+// all intervals of one kind, grouped in several ways
+struct LatencySource
+{
+    enum Grouping
+    {
+        ByThread,
+        BySymbol,
+        ByStack,
+        NUM_GROUPINGS
+    };
+
+    QString name;
+    LatencyHistogram histogram;
+    // a symbol is counted once per interval, no matter how often it shows up in the stack
+    QVector<LatencyEntry> entries[NUM_GROUPINGS];
+};
+
+struct LatencyResults
+{
+    // off-CPU time first, if it got recorded, then one source per pair of enter/exit tracepoints and finally the
+    // run-queue latency, when sched:sched_wakeup got recorded together with the context switches
+    QVector<LatencySource> sources;
+
+    // the off-CPU time events already hold the intervals between the context switches, the tracepoints get paired
+    // per thread, like syscalls:sys_enter_read and syscalls:sys_exit_read. the wakeups get paired with the next
+    // switch in of the woken thread. the @p bottomUp results resolve the frames of the stacks
+    static LatencyResults fromEvents(const EventResults& events, const BottomUpResults& bottomUp);
+};
+}
+
+Q_DECLARE_TYPEINFO(Data::LatencyHistogram, Q_MOVABLE_TYPE);
+Q_DECLARE_METATYPE(Data::LatencyInterval)
+Q_DECLARE_TYPEINFO(Data::LatencyInterval, Q_PRIMITIVE_TYPE);
+Q_DECLARE_TYPEINFO(Data::LatencyEntry, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(Data::LatencySource, Q_MOVABLE_TYPE);
+
+Q_DECLARE_METATYPE(Data::LatencyResults)
+Q_DECLARE_TYPEINFO(Data::LatencyResults, Q_MOVABLE_TYPE);
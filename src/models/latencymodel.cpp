@@ -0,0 +1,151 @@
+/*
+  latencymodel.cpp
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "latencymodel.h"
+
+#include "../util.h"
+
+#include <algorithm>
+
+LatencyModel::LatencyModel(QObject* parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+LatencyModel::~LatencyModel() = default;
+
+int LatencyModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_rows.size();
+}
+
+int LatencyModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : NUM_COLUMNS;
+}
+
+QVariant LatencyModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (section < 0 || section >= NUM_COLUMNS || orientation != Qt::Horizontal) {
+        return {};
+    }
+
+    if (role == Qt::InitialSortOrderRole) {
+        return section == NameColumn ? Qt::AscendingOrder : Qt::DescendingOrder;
+    } else if (role == Qt::DisplayRole) {
+        switch (static_cast<Columns>(section)) {
+        case NameColumn:
+            return tr("Name");
+        case CountColumn:
+            return tr("Count");
+        case MedianColumn:
+            return tr("p50");
+        case P99Column:
+            return tr("p99");
+        case P999Column:
+            return tr("p99.9");
+        case MaxColumn:
+            return tr("Max");
+        case NUM_COLUMNS:
+            break;
+        }
+    } else if (role == Qt::ToolTipRole) {
+        switch (static_cast<Columns>(section)) {
+        case NameColumn:
+            return tr("The thread, symbol or stack the waits got grouped by.");
+        case CountColumn:
+            return tr("The number of waits.");
+        case MedianColumn:
+            return tr("Half of the waits took at most this long.");
+        case P99Column:
+            return tr("99% of the waits took at most this long.");
+        case P999Column:
+            return tr("99.9% of the waits took at most this long.");
+        case MaxColumn:
+            return tr("The longest wait.");
+        case NUM_COLUMNS:
+            break;
+        }
+    }
+    return {};
+}
+
+QVariant LatencyModel::data(const QModelIndex& index, int role) const
+{
+    if (!hasIndex(index.row(), index.column(), index.parent())) {
+        return {};
+    }
+
+    const auto& row = m_rows.at(index.row());
+    if (role == SymbolRole) {
+        return QVariant::fromValue(row.entry.symbol);
+    } else if (role == SlowestRole) {
+        return QVariant::fromValue(row.entry.slowest);
+    } else if (role == Qt::ToolTipRole) {
+        const auto& histogram = row.entry.histogram;
+        return tr("%1\nwaits: %2, total: %3, average: %4\np50: %5, p99: %6, p99.9: %7, max: %8")
+            .arg(row.entry.name, QString::number(histogram.count()), Util::formatTimeString(histogram.total()),
+                 Util::formatTimeString(histogram.total() / std::max(histogram.count(), quint64(1))),
+                 Util::formatTimeString(row.median), Util::formatTimeString(row.p99),
+                 Util::formatTimeString(row.p999), Util::formatTimeString(histogram.max()));
+    } else if (role != Qt::DisplayRole && role != SortRole) {
+        return {};
+    }
+
+    const bool display = role == Qt::DisplayRole;
+    switch (static_cast<Columns>(index.column())) {
+    case NameColumn:
+        return row.entry.name;
+    case CountColumn:
+        return row.entry.histogram.count();
+    case MedianColumn:
+        return display ? QVariant(Util::formatTimeString(row.median)) : QVariant(row.median);
+    case P99Column:
+        return display ? QVariant(Util::formatTimeString(row.p99)) : QVariant(row.p99);
+    case P999Column:
+        return display ? QVariant(Util::formatTimeString(row.p999)) : QVariant(row.p999);
+    case MaxColumn: {
+        const auto max = row.entry.histogram.max();
+        return display ? QVariant(Util::formatTimeString(max)) : QVariant(max);
+    }
+    case NUM_COLUMNS:
+        break;
+    }
+    return {};
+}
+
+void LatencyModel::setEntries(const QVector<Data::LatencyEntry>& entries)
+{
+    beginResetModel();
+    m_rows.clear();
+    m_rows.reserve(entries.size());
+    for (const auto& entry : entries) {
+        m_rows.push_back({entry, entry.histogram.percentile(50), entry.histogram.percentile(99),
+                          entry.histogram.percentile(99.9)});
+    }
+    endResetModel();
+}
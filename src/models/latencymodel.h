@@ -0,0 +1,81 @@
+/*
+  latencymodel.h
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <QAbstractTableModel>
+
+#include "latencies.h"
+
+// the latency percentiles of the entries of one grouping of a latency source
+class LatencyModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    explicit LatencyModel(QObject* parent = nullptr);
+    ~LatencyModel() override;
+
+    enum Columns
+    {
+        NameColumn = 0,
+        CountColumn,
+        MedianColumn,
+        P99Column,
+        P999Column,
+        MaxColumn,
+        NUM_COLUMNS
+    };
+    enum
+    {
+        InitialSortColumn = P99Column
+    };
+    enum Roles
+    {
+        SortRole = Qt::UserRole,
+        SymbolRole,
+        SlowestRole,
+    };
+
+    int rowCount(const QModelIndex& parent = {}) const override;
+    int columnCount(const QModelIndex& parent = {}) const override;
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    void setEntries(const QVector<Data::LatencyEntry>& entries);
+
+private:
+    struct Row
+    {
+        Data::LatencyEntry entry;
+        // only computed once, sorting looks at them a lot
+        quint64 median;
+        quint64 p99;
+        quint64 p999;
+    };
+    QVector<Row> m_rows;
+};
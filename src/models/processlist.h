@@ -32,8 +32,10 @@
 
 #pragma once
 
-#include <QList>
+#include <QHash>
+#include <QMutex>
 #include <QString>
+#include <QVector>
 
 struct ProcData
 {
@@ -63,3 +65,25 @@ QDebug operator<<(QDebug d, const ProcData& data);
 
 using ProcDataList = QVector<ProcData>;
 ProcDataList processList();
+
+// Keeps the data of every process seen in the last scan, keyed by pid and start time.
+// Repeated scans then only read the small stat file of each process and just look at
+// the command line and the owner of processes that are new or got replaced by an exec.
+class ProcessListScanner
+{
+public:
+    // thread safe, concurrent scans get serialized
+    ProcDataList scan();
+
+private:
+    struct CachedProcess
+    {
+        quint64 startTime = 0;
+        QByteArray comm;
+        ProcData data;
+    };
+
+    QMutex m_mutex;
+    QHash<int, CachedProcess> m_cache;
+    QHash<uint, QString> m_userNames;
+};
@@ -33,12 +33,17 @@
 #include "processlist.h"
 
 #include <QDebug>
-#include <QDir>
 #include <QProcess>
 
 #include <algorithm>
 #include <functional>
 
+#include <dirent.h>
+#include <fcntl.h>
+#include <pwd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 QDebug operator<<(QDebug d, const ProcData& data)
 {
     d << "ProcData{.ppid=" << data.ppid << ", .name=" << data.name << ", .state=" << data.state
@@ -47,11 +52,6 @@ QDebug operator<<(QDebug d, const ProcData& data)
     return d;
 }
 
-static bool isUnixProcessId(const QString& procname)
-{
-    return std::all_of(procname.begin(), procname.end(), [](QChar c) { return c.isDigit(); });
-}
-
 // Determine UNIX processes by running ps
 static ProcDataList unixProcessListPS()
 {
@@ -93,47 +93,141 @@ static ProcDataList unixProcessListPS()
     return rc;
 }
 
+namespace {
+bool isUnixProcessId(const char* procname)
+{
+    for (; *procname; ++procname) {
+        if (*procname < '0' || *procname > '9')
+            return false;
+    }
+    return true;
+}
+
+QByteArray readFileAt(int dirFd, const char* name)
+{
+    const int fd = openat(dirFd, name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return {};
+
+    QByteArray ret;
+    char buffer[4096];
+    ssize_t size = 0;
+    while ((size = read(fd, buffer, sizeof(buffer))) > 0)
+        ret.append(buffer, static_cast<int>(size));
+    close(fd);
+    return ret;
+}
+
+// Parse "pid (comm) state ppid ... starttime ...", the comm may contain blanks and parentheses
+bool parseStat(const QByteArray& stat, QByteArray* comm, QByteArray* state, quint64* startTime)
+{
+    const int commStart = stat.indexOf('(');
+    const int commEnd = stat.lastIndexOf(')');
+    if (commStart == -1 || commEnd < commStart)
+        return false;
+    *comm = stat.mid(commStart + 1, commEnd - commStart - 1);
+
+    // the state is the third field, the start time the 22nd
+    int pos = commEnd + 2;
+    const int stateEnd = stat.indexOf(' ', pos);
+    if (stateEnd == -1)
+        return false;
+    *state = stat.mid(pos, stateEnd - pos);
+    pos = stateEnd + 1;
+    for (int field = 4; field < 22; ++field) {
+        pos = stat.indexOf(' ', pos) + 1;
+        if (!pos)
+            return false;
+    }
+    *startTime = strtoull(stat.constData() + pos, nullptr, 10);
+    return true;
+}
+}
+
 // Determine UNIX processes by reading "/proc". Default to ps if
 // it does not exist
 ProcDataList processList()
 {
-    const QDir procDir(QStringLiteral("/proc/"));
-    if (!procDir.exists())
+    ProcessListScanner scanner;
+    return scanner.scan();
+}
+
+ProcDataList ProcessListScanner::scan()
+{
+    QMutexLocker locker(&m_mutex);
+
+    DIR* procDir = opendir("/proc");
+    if (!procDir)
         return unixProcessListPS();
+    const int procFd = dirfd(procDir);
 
+    auto userName = [this](uint uid) -> QString {
+        auto it = m_userNames.find(uid);
+        if (it == m_userNames.end()) {
+            passwd entry;
+            passwd* result = nullptr;
+            char buffer[1024];
+            QString name = QString::number(uid);
+            if (getpwuid_r(uid, &entry, buffer, sizeof(buffer), &result) == 0 && result)
+                name = QString::fromLocal8Bit(result->pw_name);
+            it = m_userNames.insert(uid, name);
+        }
+        return it.value();
+    };
+
+    // processes that are gone don't make it into the new cache
+    QHash<int, CachedProcess> cache;
+    cache.reserve(m_cache.size());
     ProcDataList rc;
-    foreach (const QString& procId, procDir.entryList()) {
-        if (!isUnixProcessId(procId))
+    rc.reserve(m_cache.size());
+
+    QByteArray comm;
+    QByteArray state;
+    while (const dirent* entry = readdir(procDir)) {
+        if (!isUnixProcessId(entry->d_name))
             continue;
 
-        QFile file(QLatin1String("/proc/") + procId + QLatin1String("/stat"));
-        if (!file.open(QIODevice::ReadOnly))
+        const int dirFd = openat(procFd, entry->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirFd < 0)
             continue; // process may have exited
 
-        const QStringList data = QString::fromLocal8Bit(file.readAll()).split(QLatin1Char(' '));
-        ProcData proc;
-        proc.ppid = procId;
-        proc.name = data.at(1);
-        if (proc.name.startsWith(QLatin1Char('(')) && proc.name.endsWith(QLatin1Char(')'))) {
-            proc.name.truncate(proc.name.size() - 1);
-            proc.name.remove(0, 1);
+        quint64 startTime = 0;
+        if (!parseStat(readFileAt(dirFd, "stat"), &comm, &state, &startTime)) {
+            close(dirFd);
+            continue;
         }
-        proc.state = data.at(2);
-        // PPID is element 3
 
-        proc.user = QFileInfo(file).owner();
-        file.close();
+        const int pid = atoi(entry->d_name);
+        auto it = m_cache.constFind(pid);
+        CachedProcess process;
+        if (it != m_cache.constEnd() && it->startTime == startTime && it->comm == comm) {
+            process = it.value();
+        } else {
+            // a new process, a reused pid or an exec, read the rest of its data
+            process.startTime = startTime;
+            process.comm = comm;
+            process.data.ppid = QString::fromLatin1(entry->d_name);
+            process.data.name = QString::fromLocal8Bit(comm);
 
-        QFile cmdFile(QLatin1String("/proc/") + procId + QLatin1String("/cmdline"));
-        if (cmdFile.open(QFile::ReadOnly)) {
-            QByteArray cmd = cmdFile.readAll();
+            struct stat info;
+            if (fstat(dirFd, &info) == 0)
+                process.data.user = userName(info.st_uid);
+
+            QByteArray cmd = readFileAt(dirFd, "cmdline");
             cmd.replace('\0', ' ');
             if (!cmd.isEmpty())
-                proc.name = QString::fromLocal8Bit(cmd).trimmed();
+                process.data.name = QString::fromLocal8Bit(cmd).trimmed();
         }
-        cmdFile.close();
+        close(dirFd);
+
+        if (process.data.state != QLatin1String(state))
+            process.data.state = QString::fromLatin1(state);
 
-        rc.push_back(proc);
+        rc.push_back(process.data);
+        cache.insert(pid, process);
     }
+    closedir(procDir);
+
+    m_cache.swap(cache);
     return rc;
 }
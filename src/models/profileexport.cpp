@@ -0,0 +1,335 @@
+/*
+  profileexport.cpp
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "profileexport.h"
+
+#include <QIODevice>
+#include <QTextStream>
+
+#include <limits>
+
+#include "../util.h"
+
+namespace {
+QString formatFrame(const Data::Symbol& symbol)
+{
+    if (symbol.symbol.isEmpty()) {
+        return QLatin1Char('[') + symbol.binary + QLatin1Char(']');
+    }
+    return Util::formatSymbol(symbol);
+}
+
+// a minimal protobuf encoder, the messages are small enough to get buffered while the top-level
+// fields of the profile are written to the device one after the other
+class ProtobufWriter
+{
+public:
+    enum WireType
+    {
+        Varint = 0,
+        LengthDelimited = 2
+    };
+
+    void writeVarint(quint64 value)
+    {
+        while (value >= 0x80) {
+            m_buffer.append(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        m_buffer.append(static_cast<char>(value));
+    }
+
+    void writeKey(int field, WireType type)
+    {
+        writeVarint((static_cast<quint64>(field) << 3) | type);
+    }
+
+    void writeInt(int field, qint64 value)
+    {
+        if (value) {
+            writeKey(field, Varint);
+            writeVarint(static_cast<quint64>(value));
+        }
+    }
+
+    void writeBytes(int field, const QByteArray& bytes)
+    {
+        writeKey(field, LengthDelimited);
+        writeVarint(bytes.size());
+        m_buffer.append(bytes);
+    }
+
+    void writeMessage(int field, const ProtobufWriter& message)
+    {
+        writeBytes(field, message.m_buffer);
+    }
+
+    void writePacked(int field, const QVector<qint64>& values)
+    {
+        ProtobufWriter packed;
+        for (auto value : values) {
+            packed.writeVarint(static_cast<quint64>(value));
+        }
+        writeMessage(field, packed);
+    }
+
+    bool flush(QIODevice* device)
+    {
+        const bool ret = device->write(m_buffer) == m_buffer.size();
+        m_buffer.clear();
+        return ret;
+    }
+
+private:
+    QByteArray m_buffer;
+};
+
+// field numbers of the messages in pprof's profile.proto
+enum ProfileField
+{
+    Profile_SampleType = 1,
+    Profile_Sample = 2,
+    Profile_Location = 4,
+    Profile_Function = 5,
+    Profile_StringTable = 6,
+    ValueType_Type = 1,
+    ValueType_Unit = 2,
+    Sample_LocationId = 1,
+    Sample_Value = 2,
+    Sample_Label = 3,
+    Label_Key = 1,
+    Label_Str = 2,
+    Label_Num = 3,
+    Location_Id = 1,
+    Location_Address = 3,
+    Location_Line = 4,
+    Line_FunctionId = 1,
+    Line_Line = 2,
+    Function_Id = 1,
+    Function_Name = 2,
+    Function_SystemName = 3,
+    Function_Filename = 4
+};
+
+class StringTable
+{
+public:
+    StringTable()
+    {
+        // pprof requires the first entry to be the empty string
+        index({});
+    }
+
+    qint64 index(const QString& string)
+    {
+        auto it = m_indices.find(string);
+        if (it == m_indices.end()) {
+            it = m_indices.insert(string, m_strings.size());
+            m_strings.push_back(string);
+        }
+        return it.value();
+    }
+
+    void write(ProtobufWriter* writer) const
+    {
+        for (const auto& string : m_strings) {
+            writer->writeBytes(Profile_StringTable, string.toUtf8());
+        }
+    }
+
+private:
+    QHash<QString, qint64> m_indices;
+    QStringList m_strings;
+};
+}
+
+void ProfileExport::forEachCollapsedStack(
+    const Data::BottomUpResults& results,
+    const std::function<void(const QString& stack, const QVector<qint64>& costs)>& callback)
+{
+    const auto numTypes = results.costs.numTypes();
+    QStringList callers;
+    QVector<qint64> costs(numTypes);
+    const auto enter = [&](const Data::BottomUp& node) {
+        callers.prepend(formatFrame(node.symbol));
+
+        // the cost that isn't accounted for by any caller belongs to the stack ending at this node
+        bool hasCost = false;
+        for (int type = 0; type < numTypes; ++type) {
+            costs[type] = results.costs.cost(type, node.id);
+            for (const auto& child : node.children) {
+                costs[type] -= results.costs.cost(type, child.id);
+            }
+            hasCost = hasCost || costs[type] != 0;
+        }
+        if (hasCost) {
+            callback(callers.join(QLatin1Char(';')), costs);
+        }
+    };
+
+    // walk the tree with an explicit stack of the nodes and the index of their next child, the stacks can be
+    // deeper than the call stack allows. callers always holds the frames of the nodes on that stack
+    QVector<QPair<const Data::BottomUp*, int>> stack;
+    for (const auto& leaf : results.root.children) {
+        enter(leaf);
+        stack.append(qMakePair(&leaf, 0));
+        while (!stack.isEmpty()) {
+            auto& top = stack.last();
+            if (top.second < top.first->children.size()) {
+                const auto& child = top.first->children[top.second++];
+                enter(child);
+                stack.append(qMakePair(&child, 0));
+            } else {
+                stack.removeLast();
+                callers.removeFirst();
+            }
+        }
+    }
+}
+
+bool ProfileExport::writeCollapsed(QIODevice* device, const Data::BottomUpResults& results, int type)
+{
+    // QTextStream flushes its buffer to the device once it grows too large
+    QTextStream stream(device);
+    forEachCollapsedStack(results, [&stream, type](const QString& stack, const QVector<qint64>& costs) {
+        if (costs[type]) {
+            stream << stack << ' ' << costs[type] << '\n';
+        }
+    });
+    stream.flush();
+    return stream.status() == QTextStream::Ok;
+}
+
+bool ProfileExport::writePprof(QIODevice* device, const Data::BottomUpResults& results,
+                               const Data::EventResults& events)
+{
+    ProtobufWriter writer;
+    StringTable strings;
+    bool ok = true;
+    const int numTypes = events.totalCosts.size();
+
+    for (int type = 0; type < numTypes; ++type) {
+        const auto& cost = events.totalCosts[type];
+        const bool isTime = type == events.offCpuTimeCostId || cost.unit == Data::Costs::Unit::Time;
+        ProtobufWriter valueType;
+        valueType.writeInt(ValueType_Type, strings.index(cost.label));
+        valueType.writeInt(ValueType_Unit, strings.index(isTime ? QStringLiteral("nanoseconds")
+                                                                : QStringLiteral("count")));
+        writer.writeMessage(Profile_SampleType, valueType);
+    }
+    ok = writer.flush(device) && ok;
+
+    // aggregate the events per thread, which keeps the memory bounded by the number of stacks of a single thread
+    QVector<bool> usedLocations(results.locations.size());
+    const auto threadNameKey = strings.index(QStringLiteral("thread_name"));
+    const auto pidKey = strings.index(QStringLiteral("pid"));
+    const auto tidKey = strings.index(QStringLiteral("tid"));
+    QHash<qint32, QVector<qint64>> stackCosts;
+    for (const auto& thread : events.threads) {
+        stackCosts.clear();
+        for (const auto& event : thread.events) {
+            if (event.stackId < 0 || event.stackId >= events.stacks.size() || event.type < 0
+                || event.type >= numTypes) {
+                continue;
+            }
+            auto& costs = stackCosts[event.stackId];
+            if (costs.isEmpty()) {
+                costs.resize(numTypes);
+            }
+            costs[event.type] += event.cost;
+        }
+
+        ProtobufWriter threadName;
+        threadName.writeInt(Label_Key, threadNameKey);
+        threadName.writeInt(Label_Str, strings.index(thread.name));
+        ProtobufWriter pid;
+        pid.writeInt(Label_Key, pidKey);
+        pid.writeInt(Label_Num, thread.pid);
+        ProtobufWriter tid;
+        tid.writeInt(Label_Key, tidKey);
+        tid.writeInt(Label_Num, thread.tid);
+
+        QVector<qint64> locationIds;
+        for (auto it = stackCosts.cbegin(), end = stackCosts.cend(); it != end; ++it) {
+            // pprof ids must not be zero, and the stacks are already ordered from the sampled function to its callers
+            locationIds.clear();
+            for (auto locationId : events.stacks[it.key()]) {
+                if (locationId >= 0 && locationId < usedLocations.size()) {
+                    usedLocations[locationId] = true;
+                    locationIds.push_back(locationId + 1);
+                }
+            }
+            ProtobufWriter sample;
+            sample.writePacked(Sample_LocationId, locationIds);
+            sample.writePacked(Sample_Value, it.value());
+            sample.writeMessage(Sample_Label, threadName);
+            sample.writeMessage(Sample_Label, pid);
+            sample.writeMessage(Sample_Label, tid);
+            writer.writeMessage(Profile_Sample, sample);
+        }
+        ok = writer.flush(device) && ok;
+    }
+
+    // every location gets one line per inlined frame, the last one being the function they got inlined into
+    QSet<quint32> writtenFunctions;
+    for (int locationId = 0, c = usedLocations.size(); locationId < c; ++locationId) {
+        if (!usedLocations[locationId]) {
+            continue;
+        }
+        ProtobufWriter location;
+        location.writeInt(Location_Id, locationId + 1);
+        location.writeInt(Location_Address, static_cast<qint64>(results.locations[locationId].location.address));
+        results.foreachFrame({locationId}, [&](const Data::Symbol& symbol, const Data::Location& frameLocation) {
+            const auto separator = frameLocation.location.lastIndexOf(QLatin1Char(':'));
+            const auto file = separator == -1 ? frameLocation.location : frameLocation.location.left(separator);
+            const auto line = separator == -1 ? 0 : frameLocation.location.midRef(separator + 1).toLongLong();
+
+            // the interned symbol ids are unique and never zero for valid symbols
+            const quint64 functionId = symbol.isValid() ? symbol.id : std::numeric_limits<quint32>::max() + 1ull;
+            if (!writtenFunctions.contains(symbol.id)) {
+                writtenFunctions.insert(symbol.id);
+                ProtobufWriter function;
+                function.writeInt(Function_Id, functionId);
+                function.writeInt(Function_Name, strings.index(formatFrame(symbol)));
+                function.writeInt(Function_SystemName, strings.index(symbol.symbol));
+                function.writeInt(Function_Filename, strings.index(file));
+                writer.writeMessage(Profile_Function, function);
+            }
+
+            ProtobufWriter lineMessage;
+            lineMessage.writeInt(Line_FunctionId, functionId);
+            lineMessage.writeInt(Line_Line, line);
+            location.writeMessage(Location_Line, lineMessage);
+            return true;
+        });
+        writer.writeMessage(Profile_Location, location);
+        ok = writer.flush(device) && ok;
+    }
+
+    strings.write(&writer);
+    return writer.flush(device) && ok;
+}
@@ -0,0 +1,50 @@
+/*
+  profileexport.h
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <functional>
+
+#include "data.h"
+
+class QIODevice;
+
+// exporters that write the results straight to a device while walking them, such that the memory usage does not
+// depend on the size of the output
+namespace ProfileExport {
+// calls @p callback for every unique stack of the bottom-up tree that has a cost of its own. the frames are ordered
+// from the outermost caller to the sampled function and separated by semicolons, @p costs holds one entry per type
+void forEachCollapsedStack(const Data::BottomUpResults& results,
+                           const std::function<void(const QString& stack, const QVector<qint64>& costs)>& callback);
+
+// writes the costs of @p type in the collapsed format of the FlameGraph scripts, i.e. "caller;callee cost" lines
+bool writeCollapsed(QIODevice* device, const Data::BottomUpResults& results, int type);
+
+// writes an uncompressed pprof protobuf profile, with one sample per thread and stack
+// the @p results provide the symbols and locations referenced by the stacks of @p events
+bool writePprof(QIODevice* device, const Data::BottomUpResults& results, const Data::EventResults& events);
+}
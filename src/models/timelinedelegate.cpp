@@ -28,6 +28,7 @@
 #include "timelinedelegate.h"
 
 #include <QAbstractItemView>
+#include <QCoreApplication>
 #include <QDebug>
 #include <QEvent>
 #include <QHelpEvent>
@@ -38,19 +39,21 @@
 #include "../util.h"
 #include "eventmodel.h"
 #include "filterandzoomstack.h"
+#include "instrumentation.h"
 
 #include <KColorScheme>
 
 #include <algorithm>
+#include <cmath>
 
 TimeLineData::TimeLineData()
     : TimeLineData({}, 0, {}, {}, {})
 {
 }
 
-TimeLineData::TimeLineData(const Data::Events& events, quint64 maxCost, const Data::TimeRange& time,
+TimeLineData::TimeLineData(const EventModel::EventPages& pages, quint64 maxCost, const Data::TimeRange& time,
                            const Data::TimeRange& threadTime, QRect rect)
-    : events(events)
+    : pages(pages)
     , maxCost(maxCost)
     , time(time)
     , threadTime(threadTime)
@@ -87,21 +90,34 @@ namespace {
 TimeLineData dataFromIndex(const QModelIndex& index, QRect rect, const Data::ZoomAction &zoom)
 {
     TimeLineData data(
-        index.data(EventModel::EventsRole).value<Data::Events>(), index.data(EventModel::MaxCostRole).value<quint64>(),
+        index.data(EventModel::EventPagesRole).value<EventModel::EventPages>(),
+        index.data(EventModel::MaxCostRole).value<quint64>(),
         {index.data(EventModel::MinTimeRole).value<quint64>(), index.data(EventModel::MaxTimeRole).value<quint64>()},
         {index.data(EventModel::ThreadStartRole).value<quint64>(),
          index.data(EventModel::ThreadEndRole).value<quint64>()},
         rect);
+    data.contextSwitches = index.data(EventModel::ContextSwitchesRole).value<Data::ContextSwitchTrack>();
     if (zoom.isValid()) {
         data.zoom(zoom.time);
     }
     return data;
 }
 
-Data::Events::const_iterator findEvent(Data::Events::const_iterator begin, Data::Events::const_iterator end,
-                                       quint64 time)
+// every thread gets its own color in the context switch tracks, such that the changes of the occupant stand out
+QColor threadColor(qint32 tid)
 {
-    return std::lower_bound(begin, end, time, [](const Data::Event& event, quint64 time) { return event.time < time; });
+    return QColor::fromHsv(static_cast<int>((static_cast<quint32>(tid) * 47u) % 360u), 160, 230);
+}
+
+// @return the name of the thread @p tid of the file @p fileId that was alive at @p time
+QString threadName(const Data::EventResults& events, qint32 tid, qint32 fileId, quint64 time)
+{
+    for (const auto& thread : events.threads) {
+        if (thread.tid == tid && thread.fileId == fileId && thread.time.contains(time)) {
+            return QCoreApplication::translate("TimeLineDelegate", "%1 (#%2)").arg(thread.name, QString::number(tid));
+        }
+    }
+    return QCoreApplication::translate("TimeLineDelegate", "#%1").arg(tid);
 }
 }
 
@@ -112,16 +128,86 @@ TimeLineDelegate::TimeLineDelegate(FilterAndZoomStack* filterAndZoomStack, QAbst
 {
     m_view->viewport()->installEventFilter(this);
 
-    connect(filterAndZoomStack, &FilterAndZoomStack::filterChanged, this, &TimeLineDelegate::updateView);
+    // cache the rendered rows for at most 64MB
+    m_rowCache.setMaxCost(64 * 1024);
+
+    connect(filterAndZoomStack, &FilterAndZoomStack::filterChanged, this, [this]() {
+        m_rowCache.clear();
+        updateView();
+    });
     connect(filterAndZoomStack, &FilterAndZoomStack::zoomChanged, this, &TimeLineDelegate::updateZoomState);
+    connect(filterAndZoomStack, &FilterAndZoomStack::highlightChanged, this, &TimeLineDelegate::updateHighlight);
+    if (auto* model = m_view->model()) {
+        connect(model, &QAbstractItemModel::modelReset, this, [this]() { m_rowCache.clear(); });
+        connect(model, &QAbstractItemModel::dataChanged, this, [this]() { m_rowCache.clear(); });
+    }
 }
 
 TimeLineDelegate::~TimeLineDelegate() = default;
 
 void TimeLineDelegate::paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const
 {
+    Instrumentation::ScopedTimer instrumentation("TimeLineDelegate::paint");
     const auto data = dataFromIndex(index, option.rect, m_filterAndZoomStack->zoom());
-    const auto offCpuCostId = index.data(EventModel::EventResultsRole).value<Data::EventResults>().offCpuTimeCostId;
+    const bool is_alternate = option.features & QStyleOptionViewItem::Alternate;
+    const auto& palette = option.palette;
+    const auto devicePixelRatio = painter->device()->devicePixelRatioF();
+
+    // the rows only change when the data, the zoom or the look changes, which allows us to reuse them while
+    // the user interacts with the view. the zoom and filter changes clear the cache
+    const auto key = QString::number(index.data(EventModel::FileIdRole).value<qint32>()) + QLatin1Char(':')
+        + QString::number(index.data(EventModel::ProcessIdRole).value<qint32>()) + QLatin1Char(':')
+        + QString::number(index.data(EventModel::ThreadIdRole).value<qint32>()) + QLatin1Char(':')
+        + QString::number(index.data(EventModel::CpuIdRole).value<quint32>()) + QLatin1Char(':')
+        + QString::number(option.rect.width()) + QLatin1Char('x') + QString::number(option.rect.height())
+        + QLatin1Char(':') + QString::number(devicePixelRatio) + QLatin1Char(':')
+        + QString::number(palette.cacheKey()) + QLatin1Char(':') + QString::number(palette.currentColorGroup())
+        + QLatin1Char(':') + QString::number(is_alternate);
+
+    QPixmap row;
+    if (const auto* cached = m_rowCache.object(key)) {
+        row = *cached;
+        Instrumentation::addCount("TimeLineDelegate::cachedRows");
+    } else {
+        row = QPixmap(option.rect.size() * devicePixelRatio);
+        row.setDevicePixelRatio(devicePixelRatio);
+        auto rowOption = option;
+        rowOption.rect.moveTopLeft({0, 0});
+        QPainter rowPainter(&row);
+        paintRow(&rowPainter, rowOption, data);
+        rowPainter.end();
+        const auto costInKb = static_cast<int>(qint64(row.width()) * row.height() * row.depth() / 8 / 1024);
+        m_rowCache.insert(key, new QPixmap(row), std::max(1, costInKb));
+    }
+    painter->drawPixmap(option.rect.topLeft(), row);
+
+    if (m_timeSlice.isValid()) {
+        painter->save();
+
+        // transform into target coordinate system
+        painter->translate(option.rect.topLeft());
+        // account for padding
+        painter->translate(data.padding, data.padding);
+
+        // clamp to available width to prevent us from painting over the other columns
+        const auto startX = std::max(data.mapTimeToX(m_timeSlice.normalized().start), 0);
+        const auto endX = std::min(data.mapTimeToX(m_timeSlice.normalized().end), data.w);
+        // undo vertical padding manually to fill complete height
+        QRect timeSlice(startX, -data.padding, endX - startX, option.rect.height());
+
+        auto brush = palette.highlight();
+        auto color = brush.color();
+        color.setAlpha(128);
+        brush.setColor(color);
+        painter->fillRect(timeSlice, brush);
+
+        painter->restore();
+    }
+}
+
+void TimeLineDelegate::paintRow(QPainter* painter, const QStyleOptionViewItem& option, const TimeLineData& data) const
+{
+    const auto offCpuCostId = data.pages.offCpuTimeCostId;
     const bool is_alternate = option.features & QStyleOptionViewItem::Alternate;
     const auto& palette = option.palette;
 
@@ -161,14 +247,44 @@ void TimeLineDelegate::paint(QPainter* painter, const QStyleOptionViewItem& opti
         painter->setBrush({});
         auto offCpuColor = scheme.background(KColorScheme::NegativeBackground).color();
 
+        // only look at the events within the visible time range
+        const auto& pages = data.pages;
+        const auto& events = pages.events;
+        const auto visibleStart = data.time.start;
+        const auto visibleEnd = data.mapXToTime(data.w) + 1;
+        const int end = pages.lowerBound(visibleEnd);
+
+        // the threads that occupied a CPU as a band at the bottom of its row
+        const auto& switches = data.contextSwitches;
+        if (!switches.isEmpty()) {
+            const int bandHeight = std::max(2, data.h / 4);
+            int slice = std::max(0, switches.sliceAt(visibleStart));
+            while (slice < switches.size() && switches.times[slice] < visibleEnd) {
+                const auto tid = switches.threadIds[slice];
+                const auto x = std::max(0, data.mapTimeToX(switches.times[slice]));
+                const auto x2 = std::min(data.w, data.mapTimeToX(std::min(switches.sliceEnd(slice), visibleEnd)));
+                if (tid != Data::INVALID_TID) {
+                    painter->fillRect(x, data.h - bandHeight, std::max(1, x2 - x), bandHeight, threadColor(tid));
+                }
+                if (x2 > x) {
+                    ++slice;
+                } else {
+                    // skip the remaining slices that end up on the same pixel, there can be millions of them
+                    slice = std::max(slice + 1, switches.sliceAt(data.mapXToTime(x + 1)));
+                }
+            }
+        }
+
         if (offCpuCostId != -1) {
-            for (const auto& event : data.events) {
-                if (event.type != offCpuCostId) {
+            const auto offCpuStart = visibleStart > pages.maxOffCpuTime ? visibleStart - pages.maxOffCpuTime : 0;
+            for (int i = pages.lowerBound(offCpuStart); i < end; ++i) {
+                if (events.type(i) != offCpuCostId) {
                     continue;
                 }
 
-                const auto x = data.mapTimeToX(event.time);
-                const auto x2 = data.mapTimeToX(event.time + event.cost);
+                const auto time = events.time(i);
+                const auto x = data.mapTimeToX(time);
+                const auto x2 = data.mapTimeToX(time + events.cost(i));
                 painter->fillRect(x, 0, x2 - x, data.h, offCpuColor);
             }
         }
@@ -181,38 +297,77 @@ void TimeLineDelegate::paint(QPainter* painter, const QStyleOptionViewItem& opti
         // we simply always fill the complete height which is also what we'd get
         // from a graph in count mode (perf record -F vs. perf record -c)
         // see also: https://www.spinics.net/lists/linux-perf-users/msg03486.html
-        for (const auto& event : data.events) {
-            if (event.type != m_eventType) {
-                continue;
-            }
+        const auto pixelDuration = data.w > 0 ? data.time.delta() / static_cast<quint64>(data.w) : 0;
+        if (const auto* histogram = pages.histogram(m_eventType, pixelDuration)) {
+            // when zoomed out, draw from the closest resolution of the histograms instead of looking at the events
+            const auto numBuckets = static_cast<quint64>(histogram->counts.size());
+            auto toBucket = [&pages, histogram, numBuckets](quint64 time) -> int {
+                if (time <= pages.time.start) {
+                    return 0;
+                }
+                return static_cast<int>(std::min((time - pages.time.start) / histogram->bucketDuration, numBuckets));
+            };
+            for (int bucket = toBucket(visibleStart), last = toBucket(visibleEnd); bucket < last; ++bucket) {
+                if (!histogram->counts[bucket]) {
+                    continue;
+                }
 
-            const auto x = data.mapTimeToX(event.time);
-            if (x < data.padding || x >= data.w) {
-                continue;
-            }
+                const auto x = data.mapTimeToX(pages.time.start + bucket * histogram->bucketDuration);
+                if (x < data.padding || x >= data.w) {
+                    continue;
+                }
 
-            // only draw a line when it changes anything visually
-            if (x != last_x) {
-                painter->drawLine(x, 0, x, data.h);
+                if (x != last_x) {
+                    painter->drawLine(x, 0, x, data.h);
+                }
+                last_x = x;
             }
+        } else {
+            for (int i = pages.lowerBound(visibleStart); i < end;) {
+                if (events.type(i) != m_eventType) {
+                    ++i;
+                    continue;
+                }
+
+                const auto x = data.mapTimeToX(events.time(i));
+                if (x < data.padding || x >= data.w) {
+                    ++i;
+                    continue;
+                }
 
-            last_x = x;
+                // only draw a line when it changes anything visually
+                if (x != last_x) {
+                    painter->drawLine(x, 0, x, data.h);
+                }
+
+                last_x = x;
+
+                // skip the remaining events that end up on the same pixel, there can be millions of them
+                i = std::max(i + 1, pages.lowerBound(data.mapXToTime(x + 1)));
+            }
         }
-    }
 
-    if (m_timeSlice.isValid()) {
-        // the painter is translated to option.rect.topLeft
-        // clamp to available width to prevent us from painting over the other columns
-        const auto startX = std::max(data.mapTimeToX(m_timeSlice.normalized().start), 0);
-        const auto endX = std::min(data.mapTimeToX(m_timeSlice.normalized().end), data.w);
-        // undo vertical padding manually to fill complete height
-        QRect timeSlice(startX, -data.padding, endX - startX, option.rect.height());
+        if (!m_highlightedStacks.isEmpty()) {
+            // mark the samples of the highlighted symbol on top, the index tells us which stacks contain it
+            // such that we only have to look at the stack id of every visible event
+            painter->setPen(QPen(scheme.foreground(KColorScheme::ActiveText), 1));
+            last_x = -1;
+            for (int i = pages.lowerBound(visibleStart); i < end; ++i) {
+                if (events.type(i) != m_eventType || !isHighlighted(events.stackId(i))) {
+                    continue;
+                }
 
-        auto brush = palette.highlight();
-        auto color = brush.color();
-        color.setAlpha(128);
-        brush.setColor(color);
-        painter->fillRect(timeSlice, brush);
+                const auto x = data.mapTimeToX(events.time(i));
+                if (x < data.padding || x >= data.w) {
+                    continue;
+                }
+
+                if (x != last_x) {
+                    painter->drawLine(x, 0, x, data.h);
+                }
+                last_x = x;
+            }
+        }
     }
 
     painter->restore();
@@ -226,7 +381,8 @@ bool TimeLineDelegate::helpEvent(QHelpEvent* event, QAbstractItemView* view, con
         const auto localX = event->pos().x();
         const auto mappedX = localX - option.rect.x() - data.padding;
         const auto time = data.mapXToTime(mappedX);
-        const auto start = findEvent(data.events.constBegin(), data.events.constEnd(), time);
+        const auto& events = data.pages.events;
+        const auto start = events.constBegin() + data.pages.lowerBound(time);
         // find the maximum sample cost in the range spanned by one pixel
         struct FoundSamples
         {
@@ -242,11 +398,11 @@ bool TimeLineDelegate::helpEvent(QHelpEvent* event, QAbstractItemView* view, con
             if (contains) {
                 // for a contains check, we must only include events for the correct type
                 // otherwise we might skip the sched switch e.g.
-                while (it->type != costType && it != data.events.constBegin()) {
+                while (it->type != costType && it != events.constBegin()) {
                     --it;
                 }
             }
-            while (it != data.events.constEnd()) {
+            while (it != events.constEnd()) {
                 if (it->type != costType) {
                     ++it;
                     continue;
@@ -269,7 +425,7 @@ bool TimeLineDelegate::helpEvent(QHelpEvent* event, QAbstractItemView* view, con
             return ret;
         };
         auto found = findSamples(m_eventType, false);
-        const auto offCpuCostId = index.data(EventModel::EventResultsRole).value<Data::EventResults>().offCpuTimeCostId;
+        const auto offCpuCostId = data.pages.offCpuTimeCostId;
         if (offCpuCostId != -1 && !found.numSamples) {
             // check whether we are hovering an off-CPU area
             found = findSamples(offCpuCostId, true);
@@ -277,22 +433,29 @@ bool TimeLineDelegate::helpEvent(QHelpEvent* event, QAbstractItemView* view, con
 
         const auto formattedTime = Util::formatTimeString(time - data.time.start);
         const auto totalCosts = index.data(EventModel::TotalCostsRole).value<QVector<Data::CostSummary>>();
+        QString text;
         if (found.numSamples > 0 && found.type == offCpuCostId) {
-            QToolTip::showText(event->globalPos(),
-                               tr("time: %1\nsched switches: %2\ntotal off-CPU time: %3\nlongest sched switch: %4")
-                                   .arg(formattedTime, QString::number(found.numSamples),
-                                        Util::formatTimeString(found.totalCost),
-                                        Util::formatTimeString(found.maxCost)));
+            text = tr("time: %1\nsched switches: %2\ntotal off-CPU time: %3\nlongest sched switch: %4")
+                       .arg(formattedTime, QString::number(found.numSamples), Util::formatTimeString(found.totalCost),
+                            Util::formatTimeString(found.maxCost));
         } else if (found.numSamples > 0) {
-            QToolTip::showText(event->globalPos(),
-                               tr("time: %1\n%5 samples: %2\ntotal sample cost: %3\nmax sample cost: %4")
-                                   .arg(formattedTime, QString::number(found.numSamples),
-                                        Util::formatCost(found.totalCost), Util::formatCost(found.maxCost),
-                                        totalCosts.value(found.type).label));
+            text = tr("time: %1\n%5 samples: %2\ntotal sample cost: %3\nmax sample cost: %4")
+                       .arg(formattedTime, QString::number(found.numSamples), Util::formatCost(found.totalCost),
+                            Util::formatCost(found.maxCost), totalCosts.value(found.type).label);
         } else {
-            QToolTip::showText(event->globalPos(),
-                               tr("time: %1 (no %2 samples)").arg(formattedTime, totalCosts.value(m_eventType).label));
+            text = tr("time: %1 (no %2 samples)").arg(formattedTime, totalCosts.value(m_eventType).label);
+        }
+
+        const auto& switches = data.contextSwitches;
+        const auto slice = switches.sliceAt(time);
+        if (slice != -1 && switches.threadIds[slice] != Data::INVALID_TID) {
+            const auto events = index.data(EventModel::EventResultsRole).value<Data::EventResults>();
+            const auto sliceStart = switches.times[slice];
+            text += tr("\nrunning: %1 since %2")
+                        .arg(threadName(events, switches.threadIds[slice], switches.fileId, sliceStart),
+                             Util::formatTimeString(sliceStart > data.time.start ? sliceStart - data.time.start : 0));
         }
+        QToolTip::showText(event->globalPos(), text);
         return true;
     }
     return QStyledItemDelegate::helpEvent(event, view, option, index);
@@ -363,6 +526,9 @@ bool TimeLineDelegate::eventFilter(QObject* watched, QEvent* event)
         const auto isMainThread = threadStartTime == minTime && threadEndTime == maxTime;
         const auto cpuId = index.data(EventModel::CpuIdRole).value<quint32>();
         const auto numCpus = index.data(EventModel::NumCpusRole).value<uint>();
+        const auto fileId = index.data(EventModel::FileIdRole).value<qint32>();
+        const auto fileName = index.data(EventModel::FileNameRole).toString();
+        const auto numFiles = index.data(EventModel::NumFilesRole).value<uint>();
         if (isTimeSpanSelected && (minTime != timeSlice.start || maxTime != timeSlice.end)) {
             contextMenu->addAction(QIcon::fromTheme(QStringLiteral("zoom-in")), tr("Zoom In On Selection"), this,
                                    [this, timeSlice]() { m_filterAndZoomStack->zoomIn(timeSlice); });
@@ -418,6 +584,16 @@ bool TimeLineDelegate::eventFilter(QObject* watched, QEvent* event)
             }
         }
 
+        if (isRightButtonEvent && index.isValid() && fileId != Data::INVALID_FILE_ID && numFiles > 1
+            && (!isFiltered || filter.fileId == Data::INVALID_FILE_ID)) {
+            contextMenu->addAction(QIcon::fromTheme(QStringLiteral("kt-add-filters")),
+                                   tr("Filter In On File %1").arg(fileName), this,
+                                   [this, fileId]() { m_filterAndZoomStack->filterInByFile(fileId); });
+            contextMenu->addAction(QIcon::fromTheme(QStringLiteral("kt-add-filters")),
+                                   tr("Exclude File %1").arg(fileName), this,
+                                   [this, fileId]() { m_filterAndZoomStack->filterOutByFile(fileId); });
+        }
+
         if (isRightButtonEvent && index.isValid() && cpuId != Data::INVALID_CPU_ID && numCpus > 1
             && (!isFiltered || filter.cpuId != cpuId)) {
             contextMenu->addAction(QIcon::fromTheme(QStringLiteral("kt-add-filters")),
@@ -436,40 +612,89 @@ bool TimeLineDelegate::eventFilter(QObject* watched, QEvent* event)
             contextMenu->addSeparator();
             contextMenu->addAction(m_filterAndZoomStack->actions().resetFilterAndZoom);
         }
+
+        if (isRightButtonEvent && m_filterAndZoomStack->highlightedSymbol().isValid()) {
+            contextMenu->addSeparator();
+            contextMenu->addAction(m_filterAndZoomStack->actions().resetHighlight);
+        }
         contextMenu->popup(mouseEvent->globalPos());
         return true;
     } else if (isTimeSpanSelected && isLeftButtonEvent) {
         const auto& data = alwaysValidIndex.data(EventModel::EventResultsRole).value<Data::EventResults>();
+        const auto threadPages =
+            alwaysValidIndex.data(EventModel::ThreadEventPagesRole).value<QVector<EventModel::EventPages>>();
+        const auto threadIndex =
+            alwaysValidIndex.data(EventModel::ThreadIntervalIndexRole).value<Data::ThreadIntervalIndex>();
+        Q_ASSERT(threadPages.size() == data.threads.size());
         const auto timeDelta = timeSlice.delta();
         quint64 cost = 0;
         quint64 numEvents = 0;
+        quint64 highlightedCost = 0;
         QSet<qint32> threads;
         QSet<qint32> processes;
-        for (const auto& thread : data.threads) {
-            const auto start = findEvent(thread.events.begin(), thread.events.end(), timeSlice.start);
-            const auto end = findEvent(start, thread.events.end(), timeSlice.end);
-            if (start != end) {
+        // only the threads alive within the selection can have any events in there
+        const auto overlappingThreads = threadIndex.overlapping(timeSlice);
+        for (const auto i : overlappingThreads) {
+            const auto& thread = data.threads.at(i);
+            const auto& pages = threadPages.at(i);
+            if (pages.lowerBound(timeSlice.start) != pages.lowerBound(timeSlice.end)) {
                 threads.insert(thread.tid);
                 processes.insert(thread.pid);
             }
-            for (auto it = start; it != end; ++it) {
-                if (it->type != m_eventType) {
-                    continue;
+            const auto sum = pages.sum(m_eventType, timeSlice);
+            cost += sum.cost;
+            numEvents += sum.numEvents;
+            if (!m_highlightedStacks.isEmpty()) {
+                const auto& events = pages.events;
+                for (int j = pages.lowerBound(timeSlice.start), end = pages.lowerBound(timeSlice.end); j < end; ++j) {
+                    if (events.type(j) == m_eventType && isHighlighted(events.stackId(j))) {
+                        highlightedCost += events.cost(j);
+                    }
                 }
-                cost += it->cost;
-                ++numEvents;
             }
         }
 
-        QToolTip::showText(mouseEvent->globalPos(),
-                           tr("ΔT: %1\n"
-                              "Events: %2 (%3) from %4 thread(s), %5 process(es)\n"
-                              "sum of %6: %7 (%8)")
-                               .arg(Util::formatTimeString(timeDelta), Util::formatCost(numEvents),
-                                    Util::formatFrequency(numEvents, timeDelta), QString::number(threads.size()),
-                                    QString::number(processes.size()), data.totalCosts.value(m_eventType).label,
-                                    Util::formatCost(cost), Util::formatFrequency(cost, timeDelta)),
-                           m_view);
+        auto tooltip = tr("ΔT: %1\n"
+                          "Events: %2 (%3) from %4 thread(s), %5 process(es)\n"
+                          "sum of %6: %7 (%8)")
+                           .arg(Util::formatTimeString(timeDelta), Util::formatCost(numEvents),
+                                Util::formatFrequency(numEvents, timeDelta), QString::number(threads.size()),
+                                QString::number(processes.size()), data.totalCosts.value(m_eventType).label,
+                                Util::formatCost(cost), Util::formatFrequency(cost, timeDelta));
+        if (!m_highlightedStacks.isEmpty()) {
+            tooltip += tr("\nof which in %1: %2 (%3%)")
+                           .arg(Util::formatSymbol(m_filterAndZoomStack->highlightedSymbol()),
+                                Util::formatCost(highlightedCost),
+                                Util::formatCostRelative(highlightedCost, cost));
+        }
+        // the derived metrics over the events of all types within the selection
+        QVector<QString> typeNames;
+        for (const auto& totalCost : data.totalCosts) {
+            typeNames.append(totalCost.label);
+        }
+        for (const auto& metric : Data::derivedMetrics(typeNames)) {
+            quint64 numeratorCost = 0;
+            quint64 denominatorCost = 0;
+            for (const auto i : overlappingThreads) {
+                numeratorCost += threadPages.at(i).sum(metric.numerator, timeSlice).cost;
+                denominatorCost += threadPages.at(i).sum(metric.denominator, timeSlice).cost;
+            }
+            const auto value = metric.value(numeratorCost, denominatorCost);
+            if (!std::isnan(value)) {
+                tooltip += tr("\n%1: %2").arg(metric.name, metric.formatValue(value));
+            }
+        }
+        if (threads.size() > 1) {
+            const auto topThreads = EventModel::topThreads(threadPages, m_eventType, timeSlice, 3);
+            for (const auto i : topThreads) {
+                const auto& thread = data.threads.at(i);
+                const auto threadCost = threadPages.at(i).sum(m_eventType, timeSlice).cost;
+                tooltip += tr("\n%1 (#%2): %3 (%4%)")
+                               .arg(thread.name, QString::number(thread.tid), Util::formatCost(threadCost),
+                                    Util::formatCostRelative(threadCost, cost));
+            }
+        }
+        QToolTip::showText(mouseEvent->globalPos(), tooltip, m_view);
     }
 
     return false;
@@ -478,9 +703,28 @@ bool TimeLineDelegate::eventFilter(QObject* watched, QEvent* event)
 void TimeLineDelegate::setEventType(int type)
 {
     m_eventType = type;
+    m_rowCache.clear();
+    updateView();
+}
+
+void TimeLineDelegate::setSymbolStackIndex(const Data::SymbolStackIndex& index)
+{
+    m_symbolStackIndex = index;
+    updateHighlight();
+}
+
+void TimeLineDelegate::updateHighlight()
+{
+    m_highlightedStacks = m_symbolStackIndex.stackMask(m_filterAndZoomStack->highlightedSymbol());
+    m_rowCache.clear();
     updateView();
 }
 
+bool TimeLineDelegate::isHighlighted(qint32 stackId) const
+{
+    return stackId >= 0 && stackId < m_highlightedStacks.size() && m_highlightedStacks.testBit(stackId);
+}
+
 void TimeLineDelegate::updateView()
 {
     m_view->viewport()->update();
@@ -489,5 +733,6 @@ void TimeLineDelegate::updateView()
 void TimeLineDelegate::updateZoomState()
 {
     m_timeSlice = {};
+    m_rowCache.clear();
     updateView();
 }
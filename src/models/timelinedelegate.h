@@ -27,11 +27,15 @@
 
 #pragma once
 
+#include <QBitArray>
+#include <QCache>
+#include <QPixmap>
 #include <QScopedPointer>
 #include <QStyledItemDelegate>
 #include <QVector>
 
 #include "data.h"
+#include "eventmodel.h"
 
 class QAbstractItemView;
 class QAction;
@@ -42,7 +46,7 @@ struct TimeLineData
 {
     TimeLineData();
 
-    TimeLineData(const Data::Events& events, quint64 maxCost, const Data::TimeRange& time,
+    TimeLineData(const EventModel::EventPages& pages, quint64 maxCost, const Data::TimeRange& time,
                  const Data::TimeRange& threadTime, QRect rect);
 
     int mapTimeToX(quint64 time) const;
@@ -54,7 +58,9 @@ struct TimeLineData
     void zoom(const Data::TimeRange &time);
 
     static const constexpr int padding = 2;
-    Data::Events events;
+    EventModel::EventPages pages;
+    // only set for the CPU rows
+    Data::ContextSwitchTrack contextSwitches;
     quint64 maxCost;
     Data::TimeRange time;
     Data::TimeRange threadTime;
@@ -78,16 +84,26 @@ public:
                    const QModelIndex& index) override;
 
     void setEventType(int type);
+    // the index is used to find the samples of the highlighted symbol, see FilterAndZoomStack::highlightedSymbol
+    void setSymbolStackIndex(const Data::SymbolStackIndex& index);
 
 protected:
     bool eventFilter(QObject* watched, QEvent* event) override;
 
 private:
+    void paintRow(QPainter* painter, const QStyleOptionViewItem& option, const TimeLineData& data) const;
     void updateView();
     void updateZoomState();
+    void updateHighlight();
+    bool isHighlighted(qint32 stackId) const;
 
     FilterAndZoomStack* m_filterAndZoomStack = nullptr;
     QAbstractItemView* m_view = nullptr;
     Data::TimeRange m_timeSlice;
     int m_eventType = 0;
+    Data::SymbolStackIndex m_symbolStackIndex;
+    // the stacks containing the highlighted symbol, empty when nothing gets highlighted
+    QBitArray m_highlightedStacks;
+    // keyed by the row and its look, excluding the time slice which is painted on top
+    mutable QCache<QString, QPixmap> m_rowCache;
 };
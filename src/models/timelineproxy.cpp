@@ -0,0 +1,103 @@
+/*
+  timelineproxy.cpp
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "timelineproxy.h"
+
+#include "eventmodel.h"
+
+#include <algorithm>
+
+TimeLineProxy::TimeLineProxy(QObject* parent)
+    : KRecursiveFilterProxyModel(parent)
+{
+}
+
+TimeLineProxy::~TimeLineProxy() = default;
+
+void TimeLineProxy::setSourceModel(QAbstractItemModel* sourceModel)
+{
+    if (auto* oldModel = this->sourceModel()) {
+        disconnect(oldModel, nullptr, this, nullptr);
+    }
+    m_activeThreadsValid = false;
+    KRecursiveFilterProxyModel::setSourceModel(sourceModel);
+    if (sourceModel) {
+        // the threads change with every reset, which happens before the proxy filters the new rows
+        connect(sourceModel, &QAbstractItemModel::modelAboutToBeReset, this,
+                [this]() { m_activeThreadsValid = false; });
+    }
+}
+
+void TimeLineProxy::setOnlyActiveThreads(bool onlyActiveThreads)
+{
+    if (m_onlyActiveThreads == onlyActiveThreads) {
+        return;
+    }
+    m_onlyActiveThreads = onlyActiveThreads;
+    invalidateFilter();
+}
+
+void TimeLineProxy::setVisibleTime(const Data::TimeRange& time)
+{
+    if (m_visibleTime == time) {
+        return;
+    }
+    m_visibleTime = time;
+    m_activeThreadsValid = false;
+    if (m_onlyActiveThreads) {
+        invalidateFilter();
+    }
+}
+
+bool TimeLineProxy::isActiveThread(int threadIndex) const
+{
+    if (!m_visibleTime.isValid()) {
+        return true;
+    }
+    if (!m_activeThreadsValid) {
+        const auto* source = dynamic_cast<const EventModel*>(sourceModel());
+        m_activeThreads = source ? source->threadsInRange(m_visibleTime) : QVector<int>();
+        m_activeThreadsValid = true;
+    }
+    return std::binary_search(m_activeThreads.begin(), m_activeThreads.end(), threadIndex);
+}
+
+bool TimeLineProxy::acceptRow(int sourceRow, const QModelIndex& sourceParent) const
+{
+    const auto* source = dynamic_cast<const EventModel*>(sourceModel());
+    if (m_onlyActiveThreads && source) {
+        const auto index = source->index(sourceRow, 0, sourceParent);
+        const auto threadIndex = source->threadIndex(index);
+        if (threadIndex != -1 && !isActiveThread(threadIndex)) {
+            return false;
+        } else if (threadIndex == -1 && source->hasChildren(index)) {
+            // processes only show up when any of their threads is active
+            return false;
+        }
+    }
+    return KRecursiveFilterProxyModel::acceptRow(sourceRow, sourceParent);
+}
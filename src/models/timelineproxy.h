@@ -0,0 +1,62 @@
+/*
+  timelineproxy.h
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <KRecursiveFilterProxyModel>
+
+#include "data.h"
+
+class EventModel;
+
+// the filterable and sortable timeline, which can additionally hide the threads that are not alive within the
+// visible time range
+class TimeLineProxy : public KRecursiveFilterProxyModel
+{
+    Q_OBJECT
+public:
+    explicit TimeLineProxy(QObject* parent = nullptr);
+    ~TimeLineProxy() override;
+
+    void setSourceModel(QAbstractItemModel* sourceModel) override;
+
+    void setOnlyActiveThreads(bool onlyActiveThreads);
+    // an invalid range shows the threads of the whole time line
+    void setVisibleTime(const Data::TimeRange& time);
+
+protected:
+    bool acceptRow(int sourceRow, const QModelIndex& sourceParent) const override;
+
+private:
+    bool isActiveThread(int threadIndex) const;
+
+    bool m_onlyActiveThreads = false;
+    Data::TimeRange m_visibleTime;
+    // sorted indices of the threads alive within the visible time, only queried once the filter runs
+    mutable QVector<int> m_activeThreads;
+    mutable bool m_activeThreadsValid = false;
+};
@@ -58,6 +58,9 @@ QVariant BottomUpModel::headerColumnData(int column, int role) const
         case Binary:
             return tr("Binary");
         }
+        if (column >= NUM_BASE_COLUMNS + m_results.costs.numTypes()) {
+            return metricHeaderData(column - NUM_BASE_COLUMNS - m_results.costs.numTypes(), role);
+        }
         return tr("%1 (incl.)").arg(m_results.costs.typeName(column - NUM_BASE_COLUMNS));
     } else if (role == Qt::ToolTipRole) {
         switch (column) {
@@ -67,6 +70,9 @@ QVariant BottomUpModel::headerColumnData(int column, int role) const
             return tr(
                 "The name of the executable the symbol resides in. May be empty when debug information is missing.");
         }
+        if (column >= NUM_BASE_COLUMNS + m_results.costs.numTypes()) {
+            return metricHeaderData(column - NUM_BASE_COLUMNS - m_results.costs.numTypes(), role);
+        }
 
         return tr("The symbol's inclusive cost of type \"%1\", i.e. the aggregated sample costs attributed to this "
                   "symbol, both directly and indirectly.")
@@ -85,12 +91,16 @@ QVariant BottomUpModel::rowData(const Data::BottomUp* row, int column, int role)
         case Binary:
             return row->symbol.binary;
         }
+        if (column >= NUM_BASE_COLUMNS + m_results.costs.numTypes()) {
+            return metricData(column - NUM_BASE_COLUMNS - m_results.costs.numTypes(), row->id, role);
+        }
         if (role == SortRole) {
             return m_results.costs.cost(column - NUM_BASE_COLUMNS, row->id);
         }
         return Util::formatCostRelative(m_results.costs.cost(column - NUM_BASE_COLUMNS, row->id),
                                         m_results.costs.totalCost(column - NUM_BASE_COLUMNS), true);
-    } else if (role == TotalCostRole && column >= NUM_BASE_COLUMNS) {
+    } else if (role == TotalCostRole && column >= NUM_BASE_COLUMNS
+               && column < NUM_BASE_COLUMNS + m_results.costs.numTypes()) {
         return m_results.costs.totalCost(column - NUM_BASE_COLUMNS);
     } else if (role == Qt::ToolTipRole) {
         return Util::formatTooltip(row->id, row->symbol, m_results.costs);
@@ -99,9 +109,20 @@ QVariant BottomUpModel::rowData(const Data::BottomUp* row, int column, int role)
     }
 }
 
+bool BottomUpModel::rowCost(const Data::BottomUp* row, int column, qint64* cost, qint64* totalCost) const
+{
+    column -= NUM_BASE_COLUMNS;
+    if (column < 0 || column >= m_results.costs.numTypes()) {
+        return false;
+    }
+    *cost = m_results.costs.cost(column, row->id);
+    *totalCost = m_results.costs.totalCost(column);
+    return true;
+}
+
 int BottomUpModel::numColumns() const
 {
-    return NUM_BASE_COLUMNS + m_results.costs.numTypes();
+    return NUM_BASE_COLUMNS + m_results.costs.numTypes() + m_metrics.numMetrics();
 }
 
 TopDownModel::TopDownModel(QObject* parent)
@@ -132,6 +153,9 @@ QVariant TopDownModel::headerColumnData(int column, int role) const
         }
 
         column -= m_results.inclusiveCosts.numTypes();
+        if (column >= m_results.selfCosts.numTypes()) {
+            return metricHeaderData(column - m_results.selfCosts.numTypes(), role);
+        }
         return tr("%1 (self)").arg(m_results.selfCosts.typeName(column));
     } else if (role == Qt::ToolTipRole) {
         switch (column) {
@@ -152,6 +176,9 @@ QVariant TopDownModel::headerColumnData(int column, int role) const
         }
 
         column -= m_results.inclusiveCosts.numTypes();
+        if (column >= m_results.selfCosts.numTypes()) {
+            return metricHeaderData(column - m_results.selfCosts.numTypes(), role);
+        }
         return tr("The symbol's self cost of type \"%1\", i.e. the aggregated sample costs directly attributed to this "
                   "symbol. "
                   "This excludes the costs of all functions called by this symbol.")
@@ -181,6 +208,9 @@ QVariant TopDownModel::rowData(const Data::TopDown* row, int column, int role) c
         }
 
         column -= m_results.inclusiveCosts.numTypes();
+        if (column >= m_results.selfCosts.numTypes()) {
+            return metricData(column - m_results.selfCosts.numTypes(), row->id, role);
+        }
         if (role == SortRole) {
             return m_results.selfCosts.cost(column, row->id);
         }
@@ -193,6 +223,9 @@ QVariant TopDownModel::rowData(const Data::TopDown* row, int column, int role) c
         }
 
         column -= m_results.inclusiveCosts.numTypes();
+        if (column >= m_results.selfCosts.numTypes()) {
+            return {};
+        }
         return m_results.selfCosts.totalCost(column);
     } else if (role == Qt::ToolTipRole) {
         return Util::formatTooltip(row->id, row->symbol, m_results.selfCosts, m_results.inclusiveCosts);
@@ -201,7 +234,27 @@ QVariant TopDownModel::rowData(const Data::TopDown* row, int column, int role) c
     }
 }
 
+bool TopDownModel::rowCost(const Data::TopDown* row, int column, qint64* cost, qint64* totalCost) const
+{
+    column -= NUM_BASE_COLUMNS;
+    if (column < 0) {
+        return false;
+    }
+    const auto* costs = &m_results.inclusiveCosts;
+    if (column >= costs->numTypes()) {
+        column -= costs->numTypes();
+        costs = &m_results.selfCosts;
+        if (column >= costs->numTypes()) {
+            return false;
+        }
+    }
+    *cost = costs->cost(column, row->id);
+    *totalCost = costs->totalCost(column);
+    return true;
+}
+
 int TopDownModel::numColumns() const
 {
-    return NUM_BASE_COLUMNS + m_results.selfCosts.numTypes() + m_results.inclusiveCosts.numTypes();
+    return NUM_BASE_COLUMNS + m_results.selfCosts.numTypes() + m_results.inclusiveCosts.numTypes()
+        + m_metrics.numMetrics();
 }
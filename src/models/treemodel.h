@@ -29,9 +29,15 @@
 
 #include <QAbstractItemModel>
 
+#include <cmath>
+#include <functional>
+
+#include "../settings.h"
+#include "costdelegate.h"
 #include "data.h"
+#include "instrumentation.h"
 
-class AbstractTreeModel : public QAbstractItemModel
+class AbstractTreeModel : public QAbstractItemModel, public CostCellProvider
 {
     Q_OBJECT
 public:
@@ -45,6 +51,14 @@ public:
         FilterRole,
         SymbolRole
     };
+
+    // searches the nodes matching @p needle or having a matching descendant, see Data::TreeSearch
+    // the function works on a shallow copy of the current data and can thus run in a background thread
+    using SearchFunction = std::function<QBitArray(const std::function<bool()>& isCanceled)>;
+    virtual SearchFunction searchFunction(const QString& needle) const = 0;
+
+    // the id of the node at @p index, as used in the bits returned by the search function
+    virtual quint32 nodeId(const QModelIndex& index) const = 0;
 };
 
 template<typename TreeNode_t, class ModelImpl>
@@ -62,11 +76,9 @@ public:
     {
         if (parent.column() >= 1) {
             return 0;
-        } else if (auto item = itemFromIndex(parent)) {
-            return item->children.size();
-        } else {
-            return 0;
         }
+        const auto node = nodeFromIndex(parent);
+        return node == -1 ? 0 : m_arena.node(node).numChildren;
     }
 
     int columnCount(const QModelIndex& parent = {}) const final override
@@ -84,23 +96,29 @@ public:
             return {};
         }
 
-        const auto* parentItem = itemFromIndex(parent);
-        if (!parentItem) {
+        // this doesn't materialize the children yet, that is delayed until they get accessed
+        const auto parentNode = nodeFromIndex(parent);
+        if (parentNode == -1 || row >= m_arena.node(parentNode).numChildren) {
             return {};
         }
 
-        auto tag = const_cast<void*>(reinterpret_cast<const void*>(parentItem));
-        return createIndex(row, column, tag);
+        // the internal id is the arena index of the parent node
+        return createIndex(row, column, static_cast<quintptr>(parentNode));
     }
 
     QModelIndex parent(const QModelIndex& child) const final override
     {
-        const auto* childItem = itemFromIndex(child);
-        if (!childItem) {
+        if (!child.isValid()) {
             return {};
         }
 
-        return indexFromItem(childItem->parent, 0);
+        const auto parentNode = static_cast<int>(child.internalId());
+        if (parentNode == Arena::Root) {
+            return {};
+        }
+
+        const auto& node = m_arena.node(parentNode);
+        return createIndex(node.row, 0, static_cast<quintptr>(node.parent));
     }
 
     QVariant headerData(int section, Qt::Orientation orientation, int role) const final override
@@ -114,10 +132,11 @@ public:
 
     QVariant data(const QModelIndex& index, int role) const final override
     {
-        const auto* item = itemFromIndex(index);
-        if (!item || item == rootItem()) {
+        const auto node = nodeFromIndex(index);
+        if (node == -1 || node == Arena::Root) {
             return {};
         }
+        const auto* item = m_arena.node(node).item;
 
         if (role == FilterRole) {
             // TODO: optimize
@@ -131,42 +150,55 @@ public:
         return {};
     }
 
-private:
-    const TreeNode* itemFromIndex(const QModelIndex& index) const
+    bool cellCost(const QModelIndex& index, qint64* cost, qint64* totalCost) const final override
     {
-        if (!index.isValid() || index.column() >= numColumns()) {
-            return rootItem();
-        } else {
-            auto parent = reinterpret_cast<const TreeNode*>(index.internalPointer());
-            if (index.row() >= parent->children.size()) {
-                return nullptr;
-            }
-            return parent->children.constData() + index.row();
+        const auto node = nodeFromIndex(index);
+        if (node == -1 || node == Arena::Root) {
+            return false;
         }
+        return rowCost(m_arena.node(node).item, index.column(), cost, totalCost);
     }
 
-    QModelIndex indexFromItem(const TreeNode* item, int column) const
+    quint32 nodeId(const QModelIndex& index) const final override
     {
-        if (!item || column < 0 || column >= numColumns()) {
-            return {};
+        const auto node = nodeFromIndex(index);
+        if (node == -1 || node == Arena::Root) {
+            return std::numeric_limits<quint32>::max();
         }
+        return m_arena.node(node).item->id;
+    }
 
-        const auto* parentItem = item->parent;
-        if (!parentItem) {
-            parentItem = rootItem();
-        }
-        Q_ASSERT(parentItem->children.constData() <= item);
-        Q_ASSERT(parentItem->children.constData() + parentItem->children.size() > item);
-        const int row = std::distance(parentItem->children.constData(), item);
+protected:
+    // @p root must stay alive and unmodified until the next call, its nodes get flattened lazily
+    void setRootItem(const TreeNode* root)
+    {
+        m_arena = Arena(root);
+    }
 
-        return createIndex(row, column, const_cast<TreeNode*>(parentItem));
+private:
+    using Arena = Data::TreeArena<TreeNode>;
+
+    // returns the arena index of the node referenced by @p index, or -1 when the index is out of range
+    int nodeFromIndex(const QModelIndex& index) const
+    {
+        if (!index.isValid() || index.column() >= numColumns()) {
+            return Arena::Root;
+        }
+        const auto parentNode = static_cast<int>(index.internalId());
+        if (parentNode < 0 || parentNode >= m_arena.size()) {
+            return -1;
+        }
+        return m_arena.child(parentNode, index.row());
     }
 
-    virtual const TreeNode* rootItem() const = 0;
     virtual int numColumns() const = 0;
     virtual QVariant headerColumnData(int column, int role) const = 0;
     virtual QVariant rowData(const TreeNode* item, int column, int role) const = 0;
+    // the typed shortcut for the SortRole and TotalCostRole of the cost columns, see CostCellProvider
+    virtual bool rowCost(const TreeNode* item, int column, qint64* cost, qint64* totalCost) const = 0;
 
+    // materialized on demand from the const accessors
+    mutable Arena m_arena;
     quint64 m_sampleCount = 0;
 };
 
@@ -184,8 +216,11 @@ public:
     using Base::setData;
     void setData(const Results& data)
     {
+        Instrumentation::ScopedTimer instrumentation("CostTreeModel::setData");
         QAbstractItemModel::beginResetModel();
         m_results = data;
+        m_metrics = Data::DerivedMetricValues(ModelImpl::metricCosts(m_results));
+        Base::setRootItem(&m_results.root);
         QAbstractItemModel::endResetModel();
     }
 
@@ -194,13 +229,45 @@ public:
         return m_results;
     }
 
+    AbstractTreeModel::SearchFunction searchFunction(const QString& needle) const final override
+    {
+        // the shallow copy keeps the tree alive while the search runs
+        const auto results = m_results;
+        const bool prettifySymbols = Settings::instance()->prettifySymbols();
+        return [results, needle, prettifySymbols](const std::function<bool()>& isCanceled) {
+            Data::TreeSearch<typename Base::TreeNode> search(needle, prettifySymbols, isCanceled);
+            return search.run(results.root);
+        };
+    }
+
 protected:
-    const typename Base::TreeNode* rootItem() const final override
+    QVariant metricHeaderData(int metric, int role) const
     {
-        return &m_results.root;
+        const auto& derivedMetric = m_metrics.metric(metric);
+        if (role == Qt::DisplayRole) {
+            return derivedMetric.name;
+        } else if (role == Qt::ToolTipRole) {
+            return ModelImpl::tr("The metric \"%1\" derived from the inclusive costs of this symbol, computed as %2.")
+                .arg(derivedMetric.name, derivedMetric.formula);
+        }
+        return {};
+    }
+
+    QVariant metricData(int metric, quint32 id, int role) const
+    {
+        const auto value = m_metrics.value(metric, id);
+        if (role == AbstractTreeModel::SortRole) {
+            // sort the nodes without a value last
+            return std::isnan(value) ? -1. : value;
+        } else if (role == Qt::DisplayRole) {
+            return m_metrics.metric(metric).formatValue(value);
+        }
+        return {};
     }
 
     Results m_results;
+    // the metrics derived from the inclusive costs, their columns follow the cost columns
+    Data::DerivedMetricValues m_metrics;
 };
 
 class BottomUpModel : public CostTreeModel<Data::BottomUpResults, BottomUpModel>
@@ -222,7 +289,13 @@ public:
 
     QVariant headerColumnData(int column, int role) const final override;
     QVariant rowData(const Data::BottomUp* row, int column, int role) const final override;
+    bool rowCost(const Data::BottomUp* row, int column, qint64* cost, qint64* totalCost) const final override;
     int numColumns() const final override;
+
+    static const Data::Costs& metricCosts(const Data::BottomUpResults& results)
+    {
+        return results.costs;
+    }
 };
 
 class TopDownModel : public CostTreeModel<Data::TopDownResults, TopDownModel>
@@ -245,5 +318,11 @@ public:
 
     QVariant headerColumnData(int column, int role) const final override;
     QVariant rowData(const Data::TopDown* row, int column, int role) const final override;
+    bool rowCost(const Data::TopDown* row, int column, qint64* cost, qint64* totalCost) const final override;
     int numColumns() const final override;
+
+    static const Data::Costs& metricCosts(const Data::TopDownResults& results)
+    {
+        return results.inclusiveCosts;
+    }
 };
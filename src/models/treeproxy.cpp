@@ -0,0 +1,104 @@
+/*
+  treeproxy.cpp
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2017-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "treeproxy.h"
+
+#include <QTimer>
+
+#include "treemodel.h"
+
+TreeProxy::TreeProxy(AbstractTreeModel* model, QObject* parent)
+    : QSortFilterProxyModel(parent)
+    , m_model(model)
+    , m_searchTimer(new QTimer(this))
+{
+    setSourceModel(model);
+
+    m_searchTimer->setSingleShot(true);
+    m_searchTimer->setInterval(150);
+    connect(m_searchTimer, &QTimer::timeout, this, &TreeProxy::startSearch);
+
+    // the node ids of the new data are only known once the search ran again
+    connect(model, &QAbstractItemModel::modelReset, this, [this]() {
+        if (!m_searchText.isEmpty()) {
+            startSearch();
+        }
+    });
+}
+
+TreeProxy::~TreeProxy() = default;
+
+void TreeProxy::setSearchText(const QString& text)
+{
+    m_searchText = text;
+    m_searchTimer->start();
+}
+
+bool TreeProxy::filterAcceptsRow(int source_row, const QModelIndex& source_parent) const
+{
+    if (!m_filterActive) {
+        return true;
+    }
+    const auto id = m_model->nodeId(m_model->index(source_row, 0, source_parent));
+    return id < static_cast<quint32>(m_matches.size()) && m_matches.testBit(id);
+}
+
+void TreeProxy::startSearch()
+{
+    m_searchTimer->stop();
+    // cancel any search that is still running
+    m_searchJobs.cancel();
+
+    if (m_searchText.isEmpty()) {
+        if (m_filterActive) {
+            m_filterActive = false;
+            m_matches = {};
+            invalidateFilter();
+        }
+        return;
+    }
+
+    const auto search = m_model->searchFunction(m_searchText);
+    m_searchJobs.schedule(JobScheduler::Priority::Visible, [search, this](const JobScheduler::Token& token) {
+        const auto matches = search([&token]() { return token.isCanceled(); });
+        if (token.isCanceled()) {
+            return;
+        }
+        QMetaObject::invokeMethod(this, "setMatches", Qt::QueuedConnection, Q_ARG(uint, token.generation()),
+                                  Q_ARG(QBitArray, matches));
+    });
+}
+
+void TreeProxy::setMatches(uint generation, const QBitArray& matches)
+{
+    if (!m_searchJobs.isCurrent(generation)) {
+        // the search text or the data changed in the meantime
+        return;
+    }
+    m_filterActive = true;
+    m_matches = matches;
+    invalidateFilter();
+}
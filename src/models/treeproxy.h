@@ -0,0 +1,66 @@
+/*
+  treeproxy.h
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2017-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <QBitArray>
+#include <QSortFilterProxyModel>
+
+#include "jobscheduler.h"
+
+class QTimer;
+class AbstractTreeModel;
+
+// sort and filter proxy for the tree models
+// the search runs in a background thread and yields the ids of the matching nodes, filtering then only has to
+// look up the node id of every row
+class TreeProxy : public QSortFilterProxyModel
+{
+    Q_OBJECT
+
+public:
+    explicit TreeProxy(AbstractTreeModel* model, QObject* parent = nullptr);
+    ~TreeProxy() override;
+
+    // restarts the search after a short delay, an empty text disables the filter
+    void setSearchText(const QString& text);
+
+protected:
+    bool filterAcceptsRow(int source_row, const QModelIndex& source_parent) const override;
+
+private slots:
+    void setMatches(uint generation, const QBitArray& matches);
+
+private:
+    void startSearch();
+
+    AbstractTreeModel* m_model;
+    QTimer* m_searchTimer;
+    QString m_searchText;
+    JobScheduler m_searchJobs;
+    QBitArray m_matches;
+    bool m_filterActive = false;
+};
@@ -0,0 +1,299 @@
+/*
+  perfheader.cpp
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "perfheader.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+
+#include <models/cputopology.h>
+
+namespace {
+// the ids of the feature sections as defined in perf's util/header.h
+enum Feature
+{
+    HEADER_HOSTNAME = 3,
+    HEADER_OSRELEASE = 4,
+    HEADER_VERSION = 5,
+    HEADER_ARCH = 6,
+    HEADER_NRCPUS = 7,
+    HEADER_CPUDESC = 8,
+    HEADER_CPUID = 9,
+    HEADER_TOTAL_MEM = 10,
+    HEADER_CMDLINE = 11,
+    HEADER_EVENT_DESC = 12,
+    HEADER_CPU_TOPOLOGY = 13,
+    HEADER_NUMA_TOPOLOGY = 14,
+    HEADER_SAMPLE_TIME = 21,
+    HEADER_FEAT_BITS = 256
+};
+
+// bounds checked reads from the mapped file, which perf writes in the byte order of the recording host
+class Reader
+{
+public:
+    Reader(const uchar* data, quint64 size, bool bigEndian)
+        : m_data(data)
+        , m_size(size)
+        , m_bigEndian(bigEndian)
+    {
+    }
+
+    bool isValid() const
+    {
+        return m_isValid;
+    }
+
+    void seek(quint64 offset)
+    {
+        if (offset > m_size) {
+            m_isValid = false;
+        }
+        m_pos = offset;
+    }
+
+    void skip(quint64 size)
+    {
+        seek(m_pos + size);
+    }
+
+    template<typename T>
+    T read()
+    {
+        if (!m_isValid || m_size - m_pos < sizeof(T)) {
+            m_isValid = false;
+            return 0;
+        }
+        const auto* data = m_data + m_pos;
+        m_pos += sizeof(T);
+        return m_bigEndian ? qFromBigEndian<T>(data) : qFromLittleEndian<T>(data);
+    }
+
+    // the strings are prefixed with their length, which includes the padding with null bytes
+    QByteArray readString()
+    {
+        const auto length = read<quint32>();
+        if (!m_isValid || m_size - m_pos < length) {
+            m_isValid = false;
+            return {};
+        }
+        const auto* data = reinterpret_cast<const char*>(m_data + m_pos);
+        m_pos += length;
+        return QByteArray(data, static_cast<int>(qstrnlen(data, length)));
+    }
+
+    QList<QByteArray> readStrings()
+    {
+        QList<QByteArray> ret;
+        for (auto count = read<quint32>(); count > 0 && m_isValid; --count) {
+            ret.append(readString());
+        }
+        return ret;
+    }
+
+private:
+    const uchar* m_data;
+    quint64 m_size;
+    quint64 m_pos = 0;
+    bool m_bigEndian;
+    bool m_isValid = true;
+};
+
+void readFeature(Reader* reader, int feature, PerfHeader::Info* info)
+{
+    auto& summary = info->summary;
+    switch (feature) {
+    case HEADER_HOSTNAME:
+        summary.hostName = QString::fromUtf8(reader->readString());
+        break;
+    case HEADER_OSRELEASE:
+        summary.linuxKernelVersion = QString::fromUtf8(reader->readString());
+        break;
+    case HEADER_VERSION:
+        summary.perfVersion = QString::fromUtf8(reader->readString());
+        break;
+    case HEADER_ARCH:
+        summary.cpuArchitecture = QString::fromUtf8(reader->readString());
+        break;
+    case HEADER_NRCPUS:
+        summary.cpusAvailable = reader->read<quint32>();
+        summary.cpusOnline = reader->read<quint32>();
+        break;
+    case HEADER_CPUDESC:
+        summary.cpuDescription = QString::fromUtf8(reader->readString());
+        break;
+    case HEADER_CPUID:
+        summary.cpuId = QString::fromUtf8(reader->readString());
+        break;
+    case HEADER_TOTAL_MEM:
+        summary.totalMemoryInKiB = reader->read<quint64>();
+        break;
+    case HEADER_CMDLINE:
+        summary.command = PerfHeader::formatCommand(reader->readStrings());
+        break;
+    case HEADER_EVENT_DESC: {
+        const auto numEvents = reader->read<quint32>();
+        const auto attributeSize = reader->read<quint32>();
+        for (quint32 i = 0; i < numEvents && reader->isValid(); ++i) {
+            reader->skip(attributeSize);
+            const auto numIds = reader->read<quint32>();
+            info->eventNames.append(QString::fromUtf8(reader->readString()));
+            reader->skip(numIds * sizeof(quint64));
+        }
+        break;
+    }
+    case HEADER_CPU_TOPOLOGY:
+        summary.cpuSiblingCores = PerfHeader::formatCpuList(reader->readStrings());
+        summary.cpuSiblingThreads = PerfHeader::formatCpuList(reader->readStrings());
+        break;
+    case HEADER_NUMA_TOPOLOGY:
+        for (auto numNodes = reader->read<quint32>(); numNodes > 0 && reader->isValid(); --numNodes) {
+            const auto nodeId = reader->read<quint32>();
+            // the total and free memory of the node
+            reader->skip(2 * sizeof(quint64));
+            // the CPU count comes from an earlier feature section, when it exists
+            PerfHeader::addCpuNumaNode(&info->cpuNumaNodes, static_cast<qint32>(nodeId), reader->readString(),
+                                       summary.cpusAvailable);
+        }
+        break;
+    case HEADER_SAMPLE_TIME: {
+        const auto first = reader->read<quint64>();
+        const auto last = reader->read<quint64>();
+        info->sampleTime = {first, last};
+        summary.applicationRunningTime = info->sampleTime.normalized().delta();
+        break;
+    }
+    }
+}
+
+QString tr(const char* text)
+{
+    return QCoreApplication::translate("PerfHeader", text);
+}
+}
+
+bool PerfHeader::read(const QString& path, Info* info, QString* error)
+{
+    auto fail = [error](const QString& message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return fail(file.errorString());
+    }
+    const auto size = static_cast<quint64>(file.size());
+    // magic, header size, attribute size and the attribute, data and event type sections, followed by the features
+    const quint64 headerSize = 3 * sizeof(quint64) + 3 * 2 * sizeof(quint64) + HEADER_FEAT_BITS / 8;
+    if (size < headerSize) {
+        return fail(tr("The file is too small to hold a perf.data header."));
+    }
+    const auto* data = file.map(0, static_cast<qint64>(size));
+    if (!data) {
+        return fail(file.errorString());
+    }
+
+    bool bigEndian = false;
+    if (!memcmp(data, "2ELIFREP", 8)) {
+        bigEndian = true;
+    } else if (memcmp(data, "PERFILE2", 8)) {
+        return fail(tr("The file is not in the perf.data format."));
+    }
+
+    Reader reader(data, size, bigEndian);
+    reader.seek(8);
+    if (reader.read<quint64>() != headerSize) {
+        // the much smaller header of perf record -o -, which streams the features along with the events
+        return fail(tr("The file has no header, it got written to a pipe."));
+    }
+    // the header size, followed by the attribute size and section
+    reader.skip(3 * sizeof(quint64));
+    const auto dataOffset = reader.read<quint64>();
+    info->dataSize = reader.read<quint64>();
+    // the event types section is unused by perf
+    reader.skip(2 * sizeof(quint64));
+    quint64 features[HEADER_FEAT_BITS / 64];
+    for (auto& bits : features) {
+        bits = reader.read<quint64>();
+    }
+
+    // the table of the feature sections follows the data, one entry per feature in the order of the bits
+    reader.seek(dataOffset + info->dataSize);
+    QVector<QPair<int, QPair<quint64, quint64>>> sections;
+    for (int feature = 0; feature < HEADER_FEAT_BITS && reader.isValid(); ++feature) {
+        if (features[feature / 64] & (1ull << (feature % 64))) {
+            const auto offset = reader.read<quint64>();
+            const auto sectionSize = reader.read<quint64>();
+            sections.append(qMakePair(feature, qMakePair(offset, sectionSize)));
+        }
+    }
+    if (!reader.isValid()) {
+        return fail(tr("The file is truncated, its feature sections are missing."));
+    }
+
+    for (const auto& section : sections) {
+        // a broken section only loses the information it holds, the others are still fine
+        Reader sectionReader(data, std::min(size, section.second.first + section.second.second), bigEndian);
+        sectionReader.seek(section.second.first);
+        readFeature(&sectionReader, section.first, info);
+    }
+    return true;
+}
+
+QString PerfHeader::formatCommand(QList<QByteArray> cmdline)
+{
+    // the first entry is "perf" which could contain a path, we only want to show the name without the path
+    if (!cmdline.isEmpty()) {
+        cmdline.removeFirst();
+    }
+    return QLatin1String("perf ") + QString::fromUtf8(cmdline.join(' '));
+}
+
+QString PerfHeader::formatCpuList(const QList<QByteArray>& siblings)
+{
+    return QString::fromUtf8('[' + siblings.join("], [") + ']');
+}
+
+void PerfHeader::addCpuNumaNode(QVector<qint32>* cpuNumaNodes, qint32 nodeId, const QByteArray& cpuList,
+                                quint32 numCpus)
+{
+    const auto maxCpus = numCpus > 0 ? std::min(numCpus, static_cast<quint32>(CpuTopology::MaxCpus))
+                                     : static_cast<quint32>(CpuTopology::MaxCpus);
+    for (const auto cpu : CpuTopology::parseCpuList(cpuList, static_cast<int>(maxCpus))) {
+        while (cpuNumaNodes->size() <= cpu) {
+            cpuNumaNodes->push_back(-1);
+        }
+        (*cpuNumaNodes)[cpu] = nodeId;
+    }
+}
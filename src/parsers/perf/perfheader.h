@@ -0,0 +1,68 @@
+/*
+  perfheader.h
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <QList>
+#include <QMetaType>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <models/data.h>
+
+// reads the header and the feature sections of a perf.data file straight from a memory map of the file. that only
+// takes milliseconds, such that the system information can be shown while hotspot-perfparser goes through the data
+namespace PerfHeader {
+struct Info
+{
+    // only the command and the fields describing the system are set, like perfparser does for its features
+    Data::Summary summary;
+    // the NUMA node of each CPU, see Data::EventResults::cpuNumaNodes
+    QVector<qint32> cpuNumaNodes;
+    // the time of the first and the last sample, only valid when perf recorded them
+    Data::TimeRange sampleTime;
+    // the size of the data section in bytes, i.e. what hotspot-perfparser has to go through
+    quint64 dataSize = 0;
+    QStringList eventNames;
+};
+
+// @return false and set @p error when @p path can't be mapped or has no header, like the output of perf record -o -
+bool read(const QString& path, Info* info, QString* error = nullptr);
+
+// the command line as shown in the summary, without the path of perf itself
+QString formatCommand(QList<QByteArray> cmdline);
+
+// the sibling lists of the CPU topology as shown in the summary
+QString formatCpuList(const QList<QByteArray>& siblings);
+
+// assigns all CPUs in @p cpuList, a list of ranges like "0-3,8-11", to @p nodeId. CPUs at or above @p numCpus are
+// ignored, pass 0 when the number of CPUs isn't known
+void addCpuNumaNode(QVector<qint32>* cpuNumaNodes, qint32 nodeId, const QByteArray& cpuList, quint32 numCpus);
+}
+
+Q_DECLARE_METATYPE(PerfHeader::Info)
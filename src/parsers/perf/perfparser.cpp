@@ -27,20 +27,40 @@
 
 #include "perfparser.h"
 
+#include <QBitArray>
 #include <QBuffer>
+#include <QCache>
+#include <QCryptographicHash>
 #include <QDataStream>
+#include <QDateTime>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QEventLoop>
+#include <QFile>
 #include <QFileInfo>
 #include <QLoggingCategory>
+#include <QMutex>
 #include <QProcess>
+#include <QSaveFile>
+#include <QStandardPaths>
 #include <QtEndian>
 
 #include <ThreadWeaver/ThreadWeaver>
 
+#include <models/cputopology.h>
+#include <models/instrumentation.h>
 #include <util.h>
 
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <vector>
 
 Q_LOGGING_CATEGORY(LOG_PERFPARSER, "hotspot.perfparser", QtWarningMsg)
 
@@ -326,6 +346,27 @@ QDebug operator<<(QDebug stream, const StringDefinition& stringDefinition)
     return stream;
 }
 
+struct TracePointFormat
+{
+    StringId system;
+    StringId name;
+    quint32 flags = 0;
+};
+
+QDataStream& operator>>(QDataStream& stream, TracePointFormat& format)
+{
+    return stream >> format.system >> format.name >> format.flags;
+}
+
+QDebug operator<<(QDebug stream, const TracePointFormat& format)
+{
+    stream.noquote().nospace() << "TracePointFormat{"
+                               << "system=" << format.system << ", "
+                               << "name=" << format.name << ", "
+                               << "flags=" << format.flags << "}";
+    return stream;
+}
+
 struct LostDefinition : Record
 {
 };
@@ -375,6 +416,16 @@ QDataStream& operator>>(QDataStream& stream, NumaNode& numaNode)
     return stream >> numaNode.nodeId >> numaNode.memTotal >> numaNode.memFree >> numaNode.topology;
 }
 
+// @return the NUMA node of each CPU, the topology of every node is a list of CPU ranges like "0-3,8-11"
+QVector<qint32> cpuNumaNodes(const QList<NumaNode>& numaNodes, quint32 numCpus)
+{
+    QVector<qint32> ret;
+    for (const auto& node : numaNodes) {
+        PerfHeader::addCpuNumaNode(&ret, static_cast<qint32>(node.nodeId), node.topology, numCpus);
+    }
+    return ret;
+}
+
 QDebug operator<<(QDebug stream, const NumaNode& numaNode)
 {
     stream.noquote().nospace() << "NumaNode{"
@@ -513,24 +564,469 @@ QDebug operator<<(QDebug stream, const Error& error)
 }
 
 void addCallerCalleeEvent(const Data::Symbol& symbol, const Data::Location& location, int type, quint64 cost,
-                          QSet<Data::Symbol>* recursionGuard, Data::CallerCalleeResults* callerCalleeResult,
+                          Data::RecursionGuard* recursionGuard, Data::CallerCalleeResults* callerCalleeResult,
                           int numCosts)
 {
-    auto recursionIt = recursionGuard->find(symbol);
-    if (recursionIt == recursionGuard->end()) {
-        auto& entry = callerCalleeResult->entry(symbol);
-        auto& locationCost = entry.source(location.location, numCosts);
+    const bool isLeaf = recursionGuard->isEmpty();
+    if (recursionGuard->insert(symbol)) {
+        const auto id = callerCalleeResult->entry(symbol).id;
+        const auto source = callerCalleeResult->source(id, location.location, numCosts);
 
-        locationCost.inclusiveCost[type] += cost;
-        if (recursionGuard->isEmpty()) {
+        callerCalleeResult->sourceInclusiveCosts.add(type, source, cost);
+        if (isLeaf) {
             // increment self cost for leaf
-            locationCost.selfCost[type] += cost;
+            callerCalleeResult->sourceSelfCosts.add(type, source, cost);
+        }
+    }
+}
+
+// like the above, but adds all costs of a grouped event at once
+void addCallerCalleeEvent(const Data::Symbol& symbol, const Data::Location& location, const Data::TypedCosts& costs,
+                          Data::RecursionGuard* recursionGuard, Data::CallerCalleeResults* callerCalleeResult,
+                          int numCosts)
+{
+    const bool isLeaf = recursionGuard->isEmpty();
+    if (recursionGuard->insert(symbol)) {
+        const auto id = callerCalleeResult->entry(symbol).id;
+        const auto source = callerCalleeResult->source(id, location.location, numCosts);
+
+        for (const auto& cost : costs) {
+            callerCalleeResult->sourceInclusiveCosts.add(cost.type, source, cost.cost);
+            if (isLeaf) {
+                callerCalleeResult->sourceSelfCosts.add(cost.type, source, cost.cost);
+            }
         }
-        recursionGuard->insert(symbol);
     }
 }
 }
 
+// writes the text output of `perf script` to a file or stdout on a thread of its own, such that the parse never
+// waits for the device. the chunks get written in the order they got handed over and are never split up
+class PerfScriptWriter
+{
+public:
+    // @p path may be "-" to write to stdout
+    explicit PerfScriptWriter(const QString& path)
+    {
+        const bool opened = path == QLatin1String("-")
+            ? m_file.open(stdout, QIODevice::WriteOnly)
+            : m_file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+        if (!opened) {
+            m_error = m_file.errorString();
+            return;
+        }
+        m_thread = std::thread([this]() { run(); });
+    }
+
+    ~PerfScriptWriter()
+    {
+        finish();
+    }
+
+    bool isOpen() const
+    {
+        return m_file.isOpen();
+    }
+
+    // blocks while the writer lags too far behind, which bounds the memory of the queued chunks
+    void write(QByteArray chunk)
+    {
+        if (!isOpen()) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this]() { return m_queue.size() < MaxQueuedChunks || m_finished; });
+        if (m_finished) {
+            return;
+        }
+        m_queue.push_back(std::move(chunk));
+        m_condition.notify_all();
+    }
+
+    // write all queued chunks and close the device
+    // @return an empty string on success, the error of the first write that failed otherwise
+    QString finish()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_finished = true;
+            m_condition.notify_all();
+        }
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+        if (m_file.isOpen()) {
+            if (!m_file.flush() && m_error.isEmpty()) {
+                m_error = m_file.errorString();
+            }
+            m_file.close();
+        }
+        return m_error;
+    }
+
+private:
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_condition.wait(lock, [this]() { return !m_queue.empty() || m_finished; });
+            if (m_queue.empty()) {
+                return;
+            }
+            auto chunk = std::move(m_queue.front());
+            m_queue.pop_front();
+            m_condition.notify_all();
+
+            lock.unlock();
+            const bool written = m_error.isEmpty() && m_file.write(chunk) == chunk.size();
+            lock.lock();
+            if (!written && m_error.isEmpty()) {
+                m_error = m_file.errorString();
+            }
+        }
+    }
+
+    static const std::size_t MaxQueuedChunks = 8;
+
+    QFile m_file;
+    // only written by the writer thread until it got joined
+    QString m_error;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<QByteArray> m_queue;
+    bool m_finished = false;
+};
+
+// formats the samples of a single parse for the PerfScriptWriter. the text of every location, including its
+// inlined frames, only gets built once and the samples are buffered until a chunk is large enough to hand over
+class PerfScriptBuffer
+{
+public:
+    explicit PerfScriptBuffer(PerfScriptWriter* writer)
+        : m_writer(writer)
+    {
+        m_buffer.reserve(ChunkSize);
+    }
+
+    ~PerfScriptBuffer()
+    {
+        flush();
+    }
+
+    void addSample(qint32 pid, const QString& command, quint64 time, int costId, const QString& costName,
+                   quint64 cost, const QVector<qint32>& frames, const Data::BottomUpResults& bottomUp)
+    {
+        m_buffer += cachedUtf8(&m_commands, pid, command);
+        m_buffer += '\t';
+        m_buffer += QByteArray::number(pid);
+        m_buffer += '\t';
+        m_buffer += QByteArray::number(time / 1000000000);
+        m_buffer += '.';
+        m_buffer += QByteArray::number(time % 1000000000).rightJustified(9, '0');
+        m_buffer += ":\t";
+        m_buffer += QByteArray::number(cost);
+        m_buffer += ' ';
+        m_buffer += cachedUtf8(&m_costNames, costId, costName);
+        m_buffer += '\n';
+        for (auto locationId : frames) {
+            m_buffer += locationText(locationId, bottomUp);
+        }
+        m_buffer += '\n';
+
+        if (m_buffer.size() >= ChunkSize) {
+            flush();
+        }
+    }
+
+    void flush()
+    {
+        if (!m_buffer.isEmpty()) {
+            m_writer->write(m_buffer);
+            m_buffer = QByteArray();
+            m_buffer.reserve(ChunkSize);
+        }
+    }
+
+private:
+    struct Utf8
+    {
+        QString text;
+        QByteArray utf8;
+    };
+
+    // the commands can change when a process calls exec, so compare them again for every sample
+    static const QByteArray& cachedUtf8(QHash<int, Utf8>* cache, int key, const QString& text)
+    {
+        auto& entry = (*cache)[key];
+        if (entry.utf8.isEmpty() || entry.text != text) {
+            entry.text = text;
+            entry.utf8 = text.toUtf8();
+        }
+        return entry.utf8;
+    }
+
+    const QByteArray& locationText(qint32 locationId, const Data::BottomUpResults& bottomUp)
+    {
+        static const QByteArray empty;
+        if (locationId < 0 || locationId >= bottomUp.locations.size()) {
+            return empty;
+        }
+        if (locationId >= m_locationTexts.size()) {
+            m_locationTexts.resize(bottomUp.locations.size());
+        }
+        auto& text = m_locationTexts[locationId];
+        if (text.isEmpty()) {
+            bottomUp.foreachFrame({locationId}, [&text](const Data::Symbol& symbol, const Data::Location& location) {
+                text += '\t';
+                text += QByteArray::number(location.address, 16).rightJustified(16, '0');
+                text += ' ';
+                text += symbol.symbol.isEmpty() ? QByteArrayLiteral("[unknown]") : symbol.symbol.toUtf8();
+                text += " (";
+                text += symbol.binary.toUtf8();
+                text += ")\n";
+                return true;
+            });
+        }
+        return text;
+    }
+
+    static const int ChunkSize = 1024 * 1024;
+
+    PerfScriptWriter* m_writer;
+    QByteArray m_buffer;
+    // indexed by the location id
+    QVector<QByteArray> m_locationTexts;
+    QHash<int, Utf8> m_commands;
+    QHash<int, Utf8> m_costNames;
+};
+
+// builds the bottom-up and caller/callee data on a set of worker threads
+// the decoding thread hands over chunks of costs, each chunk gets aggregated into a partial result and
+// these are then merged back in submission order, which yields the same output as the serial code path
+class SampleAggregator
+{
+public:
+    // @p buildTopDown also builds the top-down tree while aggregating, see TopDownResults::addEvent
+    explicit SampleAggregator(int numThreads, bool buildTopDown)
+        : m_buildTopDown(buildTopDown)
+    {
+        // with pinned workers every NUMA node gets its own queue and merges the chunks of its workers on its own,
+        // such that the partial results only cross the nodes once when the results of the nodes get merged in finish
+        const int numGroups =
+            CpuTopology::isPinningEnabled() ? std::min(numThreads, CpuTopology::numaNodes().size()) : 1;
+        for (int i = 0; i < numGroups; ++i) {
+            m_groups.emplace_back(new Group);
+            m_groups.back()->nextMergeIndex = i;
+        }
+        for (int i = 0; i < numThreads; ++i) {
+            m_groups[CpuTopology::workerNode(i, numThreads) % numGroups]->maxQueued += QueuedChunksPerWorker;
+        }
+        for (int i = 0; i < numThreads; ++i) {
+            m_workers.emplace_back([this, i, numThreads, numGroups]() {
+                CpuTopology::pinWorker(i, numThreads);
+                run(m_groups[CpuTopology::workerNode(i, numThreads) % numGroups].get());
+            });
+        }
+    }
+
+    ~SampleAggregator()
+    {
+        for (auto& group : m_groups) {
+            std::lock_guard<std::mutex> lock(group->queueMutex);
+            group->stopped = true;
+            group->queue.clear();
+        }
+        joinWorkers();
+    }
+
+    void addCost(const QVector<qint32>& frames, qint32 type, quint64 cost, const Data::BottomUpResults& bottomUp)
+    {
+        addCosts(frames, {{type, cost}}, bottomUp);
+    }
+
+    // adds all costs of a grouped event, they get aggregated with a single walk of the stack
+    void addCosts(const QVector<qint32>& frames, const Data::TypedCosts& costs, const Data::BottomUpResults& bottomUp)
+    {
+        m_pending.push_back({frames, costs});
+        if (m_pending.size() >= ChunkSize) {
+            submit(bottomUp);
+        }
+    }
+
+    // waits for all pending work and then merges everything into @p bottomUp, @p callerCallee and @p topDown
+    void finish(Data::BottomUpResults* bottomUp, Data::CallerCalleeResults* callerCallee,
+                Data::TopDownResults* topDown)
+    {
+        if (!m_pending.empty()) {
+            submit(*bottomUp);
+        }
+        for (auto& group : m_groups) {
+            std::lock_guard<std::mutex> lock(group->queueMutex);
+            group->finished = true;
+        }
+        joinWorkers();
+
+        for (const auto& group : m_groups) {
+            Q_ASSERT(group->partials.empty());
+            bottomUp->merge(group->bottomUp);
+            callerCallee->merge(group->callerCallee);
+            if (m_buildTopDown) {
+                topDown->merge(group->topDown);
+            }
+        }
+    }
+
+private:
+    struct PendingCost
+    {
+        QVector<qint32> frames;
+        Data::TypedCosts costs;
+    };
+
+    struct Chunk
+    {
+        int index = 0;
+        std::vector<PendingCost> costs;
+        // snapshot of the data available when the chunk got submitted, implicitly shared
+        QVector<Data::Symbol> symbols;
+        QVector<Data::FrameLocation> locations;
+        Data::Costs costTypes;
+    };
+
+    struct Partial
+    {
+        Data::BottomUpResults bottomUp;
+        Data::CallerCalleeResults callerCallee;
+        Data::TopDownResults topDown;
+    };
+
+    static const std::size_t ChunkSize = 1 << 16;
+    // the decoding thread waits once this many chunks per worker are queued, which bounds the memory of the costs
+    // that didn't get aggregated yet when decoding is faster than the aggregation
+    static const std::size_t QueuedChunksPerWorker = 2;
+
+    // the chunks get distributed round-robin over the groups, group i merges the chunks i, i + numGroups, ...
+    struct Group
+    {
+        std::mutex queueMutex;
+        std::condition_variable queueCondition;
+        // signaled whenever a worker took a chunk off the queue
+        std::condition_variable spaceCondition;
+        std::deque<Chunk> queue;
+        std::size_t maxQueued = 0;
+        bool stopped = false;
+        bool finished = false;
+
+        std::mutex mergeMutex;
+        std::map<int, Partial> partials;
+        int nextMergeIndex = 0;
+        Data::BottomUpResults bottomUp;
+        Data::CallerCalleeResults callerCallee;
+        Data::TopDownResults topDown;
+    };
+
+    void submit(const Data::BottomUpResults& bottomUp)
+    {
+        Chunk chunk;
+        chunk.index = m_nextChunkIndex++;
+        chunk.costs.swap(m_pending);
+        chunk.symbols = bottomUp.symbols;
+        chunk.locations = bottomUp.locations;
+        chunk.costTypes.initializeCostsFrom(bottomUp.costs);
+        m_pending.reserve(ChunkSize);
+        auto& group = *m_groups[chunk.index % m_groups.size()];
+        {
+            std::unique_lock<std::mutex> lock(group.queueMutex);
+            group.spaceCondition.wait(lock, [&group]() { return group.queue.size() < group.maxQueued; });
+            group.queue.push_back(std::move(chunk));
+        }
+        group.queueCondition.notify_one();
+    }
+
+    void joinWorkers()
+    {
+        for (auto& group : m_groups) {
+            group->queueCondition.notify_all();
+        }
+        for (auto& worker : m_workers) {
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+    }
+
+    void run(Group* group)
+    {
+        const auto numGroups = static_cast<int>(m_groups.size());
+        while (true) {
+            Chunk chunk;
+            {
+                std::unique_lock<std::mutex> lock(group->queueMutex);
+                group->queueCondition.wait(
+                    lock, [group]() { return group->stopped || group->finished || !group->queue.empty(); });
+                if (group->stopped || group->queue.empty()) {
+                    return;
+                }
+                chunk = std::move(group->queue.front());
+                group->queue.pop_front();
+            }
+            group->spaceCondition.notify_one();
+
+            auto partial = aggregate(chunk, m_buildTopDown);
+
+            std::lock_guard<std::mutex> lock(group->mergeMutex);
+            group->partials.emplace(chunk.index, std::move(partial));
+            for (auto it = group->partials.begin();
+                 it != group->partials.end() && it->first == group->nextMergeIndex;
+                 it = group->partials.erase(it), group->nextMergeIndex += numGroups) {
+                group->bottomUp.merge(it->second.bottomUp);
+                group->callerCallee.merge(it->second.callerCallee);
+                if (m_buildTopDown) {
+                    group->topDown.merge(it->second.topDown);
+                }
+            }
+        }
+    }
+
+    static Partial aggregate(const Chunk& chunk, bool buildTopDown)
+    {
+        Partial partial;
+        partial.bottomUp.symbols = chunk.symbols;
+        partial.bottomUp.locations = chunk.locations;
+        partial.bottomUp.costs.initializeCostsFrom(chunk.costTypes);
+        partial.bottomUp.costs.clearTotalCost();
+        const auto numCosts = partial.bottomUp.costs.numTypes();
+
+        QVector<Data::Symbol> stack;
+        Data::RecursionGuard recursionGuard;
+        for (const auto& cost : chunk.costs) {
+            recursionGuard.reset();
+            auto frameCallback = [&partial, &recursionGuard, &cost, &stack, numCosts,
+                                  buildTopDown](const Data::Symbol& symbol, const Data::Location& location) {
+                addCallerCalleeEvent(symbol, location, cost.costs, &recursionGuard, &partial.callerCallee, numCosts);
+                if (buildTopDown) {
+                    stack.append(symbol);
+                }
+            };
+            partial.bottomUp.addEvent(cost.costs, cost.frames, frameCallback);
+            if (buildTopDown) {
+                partial.topDown.addEvent(cost.costs, stack);
+                stack.resize(0);
+            }
+        }
+        return partial;
+    }
+
+    // only accessed from the decoding thread
+    std::vector<PendingCost> m_pending;
+    int m_nextChunkIndex = 0;
+
+    const bool m_buildTopDown;
+    std::vector<std::unique_ptr<Group>> m_groups;
+    std::vector<std::thread> m_workers;
+};
+
 Q_DECLARE_TYPEINFO(AttributesDefinition, Q_MOVABLE_TYPE);
 Q_DECLARE_TYPEINFO(SampleCost, Q_MOVABLE_TYPE);
 
@@ -538,7 +1034,7 @@ class PerfParserPrivate : public QObject
 {
     Q_OBJECT
 public:
-    explicit PerfParserPrivate(QObject* parent = nullptr)
+    explicit PerfParserPrivate(const PerfParser::ParseOptions& options, QObject* parent = nullptr)
         : QObject(parent)
         , stopRequested(false)
     {
@@ -548,8 +1044,40 @@ public:
         process.setProcessEnvironment(Util::appImageEnvironment());
         process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
 
-        if (qEnvironmentVariableIntValue("HOTSPOT_GENERATE_SCRIPT_OUTPUT")) {
-            perfScriptOutput.reset(new QTextStream(stdout));
+        ingestTopDown = options.ingestTopDown;
+
+        const auto aggregationThreads = options.aggregationThreads;
+        if (aggregationThreads > 1) {
+            qCDebug(LOG_PERFPARSER) << "aggregating samples on" << aggregationThreads << "threads";
+            if (CpuTopology::isPinningEnabled()) {
+                qCDebug(LOG_PERFPARSER) << "pinning them to" << CpuTopology::numaNodes().size() << "NUMA nodes";
+            }
+            aggregator.reset(new SampleAggregator(aggregationThreads, ingestTopDown));
+        }
+
+        // publish partial results every few seconds by default, such that long parses can be looked at early on
+        partialResultsInterval = std::max(0, options.partialResultsIntervalMs);
+        nextPartialResults = partialResultsInterval;
+
+        // optionally bound the memory used by the events of long captures, see applyRetention
+        retentionAge = quint64(std::max(0, options.eventRetentionSeconds)) * 1000000000;
+        maxEventsPerThread = std::max(0, options.maxEventsPerThread);
+
+        // optionally drop the oldest events when the results outgrow the budget, see applyMemoryBudget
+        memoryBudget = quint64(std::max(0, options.memoryBudgetMB)) * 1024 * 1024;
+    }
+
+    void setInputSize(quint64 size)
+    {
+        inputSize = size;
+    }
+
+    void setLive(bool live)
+    {
+        isLive = live;
+        // a live recording may run for a long time, only show the last minute by default
+        if (isLive && retentionAge == 0) {
+            retentionAge = quint64(60) * 1000000000;
         }
     }
 
@@ -558,115 +1086,337 @@ public:
         if (stopRequested) {
             return false;
         }
-        const auto bytesAvailable = process.bytesAvailable();
-        switch (state) {
-        case HEADER: {
-            const auto magic = QByteArrayLiteral("QPERFSTREAM");
-            // + 1 to include the trailing \0
-            if (bytesAvailable >= magic.size() + 1) {
-                process.read(buffer.buffer().data(), magic.size() + 1);
-                if (buffer.buffer().data() != magic) {
+
+        // a timer per event would cost more than decoding most of them, so parseEvent is covered by this one
+        Instrumentation::ScopedTimer instrumentation("PerfParser::tryParse");
+        const auto eventsParsedBefore = numEventsParsed;
+
+        // grab everything the pipe has to offer in one go and then decode all complete
+        // frames in place, instead of issuing a separate read and buffer resize per event
+        if (process.bytesAvailable() > 0) {
+            if (!parseTimer.isValid()) {
+                parseTimer.start();
+            }
+            if (readBuffer.isEmpty()) {
+                readBuffer = process.readAll();
+            } else {
+                readBuffer += process.readAll();
+            }
+        }
+
+        const char* data = readBuffer.constData();
+        const int size = readBuffer.size();
+        int offset = 0;
+        auto readUInt32 = [data](int pos) {
+            quint32 value = 0;
+            memcpy(&value, data + pos, sizeof(value));
+            return qFromLittleEndian(value);
+        };
+
+        bool needMoreData = false;
+        while (!needMoreData && !stopRequested) {
+            const int bytesAvailable = size - offset;
+            switch (state) {
+            case HEADER: {
+                const auto magic = QByteArrayLiteral("QPERFSTREAM");
+                // + 1 to include the trailing \0
+                if (bytesAvailable < magic.size() + 1) {
+                    needMoreData = true;
+                    break;
+                }
+                if (qstrncmp(data + offset, magic.constData(), magic.size() + 1) != 0) {
                     state = PARSE_ERROR;
                     qCWarning(LOG_PERFPARSER) << "Failed to read header magic";
                     return false;
-                } else {
-                    state = DATA_STREAM_VERSION;
-                    return true;
                 }
+                offset += magic.size() + 1;
+                state = DATA_STREAM_VERSION;
+                break;
             }
-            break;
-        }
-        case DATA_STREAM_VERSION: {
-            qint32 dataStreamVersion = 0;
-            if (bytesAvailable >= static_cast<qint64>(sizeof(dataStreamVersion))) {
-                process.read(buffer.buffer().data(), sizeof(dataStreamVersion));
-                dataStreamVersion = qFromLittleEndian(*reinterpret_cast<qint32*>(buffer.buffer().data()));
+            case DATA_STREAM_VERSION: {
+                qint32 dataStreamVersion = 0;
+                if (bytesAvailable < static_cast<int>(sizeof(dataStreamVersion))) {
+                    needMoreData = true;
+                    break;
+                }
+                dataStreamVersion = static_cast<qint32>(readUInt32(offset));
+                offset += sizeof(dataStreamVersion);
                 stream.setVersion(dataStreamVersion);
                 qCDebug(LOG_PERFPARSER) << "data stream version is:" << dataStreamVersion;
                 state = EVENT_HEADER;
-                return true;
+                break;
             }
-            break;
-        }
-        case EVENT_HEADER:
-            if (bytesAvailable >= static_cast<qint64>(sizeof(eventSize))) {
-                process.read(buffer.buffer().data(), sizeof(eventSize));
-                eventSize = qFromLittleEndian(*reinterpret_cast<quint32*>(buffer.buffer().data()));
+            case EVENT_HEADER:
+                if (bytesAvailable < static_cast<int>(sizeof(eventSize))) {
+                    needMoreData = true;
+                    break;
+                }
+                eventSize = readUInt32(offset);
+                offset += sizeof(eventSize);
                 qCDebug(LOG_PERFPARSER) << "next event size is:" << eventSize;
                 state = EVENT;
-                return true;
-            }
-            break;
-        case EVENT:
-            if (bytesAvailable >= static_cast<qint64>(eventSize)) {
-                buffer.buffer().resize(eventSize);
-                process.read(buffer.buffer().data(), eventSize);
+                break;
+            case EVENT:
+                if (bytesAvailable < static_cast<qint64>(eventSize)) {
+                    needMoreData = true;
+                    break;
+                }
+                // let the stream read straight out of the chunk, no copy required
+                buffer.buffer().setRawData(data + offset, eventSize);
+                offset += eventSize;
                 if (!parseEvent()) {
                     state = PARSE_ERROR;
                     return false;
                 }
+                ++numEventsParsed;
                 // await next event
                 state = EVENT_HEADER;
                 eventSize = 0;
-                return true;
+                break;
+            case PARSE_ERROR:
+                return false;
             }
-            break;
-        case PARSE_ERROR:
-            // do nothing
-            break;
         }
+
+        // only the trailing, incomplete frame remains in the buffer
+        numBytesParsed += offset;
+        Instrumentation::addCount("PerfParser::parsedBytes", offset);
+        Instrumentation::addCount("PerfParser::parsedEvents", numEventsParsed - eventsParsedBefore);
+        readBuffer.remove(0, offset);
+
+        applyRetention(false);
+        applyMemoryBudget(false);
+        publishPartialResults();
+        reportProgress(Data::ParseProgress::Stage::Parsing, false);
         return false;
     }
 
-    bool parseEvent()
+    // unless @p force is set, the progress only gets reported a few times per second
+    void reportProgress(Data::ParseProgress::Stage stage, bool force)
     {
-        Q_ASSERT(buffer.isOpen());
-        Q_ASSERT(buffer.isReadable());
-
-        buffer.seek(0);
-        Q_ASSERT(buffer.pos() == 0);
-
-        stream.resetStatus();
-
-        qint8 eventType = 0;
-        stream >> eventType;
-        qCDebug(LOG_PERFPARSER) << "next event is:" << eventType;
+        if (!parseTimer.isValid() || (!force && parseTimer.elapsed() < nextProgressReport)) {
+            return;
+        }
+        nextProgressReport = parseTimer.elapsed() + 250;
+
+        Data::ParseProgress progress;
+        progress.stage = stage;
+        progress.fraction = inputProgress;
+        progress.inputBytes = inputSize;
+        progress.streamBytes = numBytesParsed;
+        progress.events = numEventsParsed;
+        progress.samples = summaryResult.sampleCount;
+        progress.elapsed = parseTimer.nsecsElapsed();
+        emit parseProgress(progress);
+    }
 
-        if (eventType < 0 || eventType >= static_cast<qint8>(EventType::InvalidType)) {
-            qCWarning(LOG_PERFPARSER) << "invalid event type" << eventType;
-            state = PARSE_ERROR;
-            return false;
+    // drops the events that are older than the retention age or exceed the per-thread limit. their costs got
+    // aggregated already, so the bottom up, top down and caller/callee data still cover the whole run.
+    // unless @p exact is set, we only trim once the limits are exceeded by a quarter, which amortizes the cost
+    // of copying the remaining events
+    void applyRetention(bool exact)
+    {
+        auto dropEvents = [this](Data::Events* events, int begin) { dropEventsBefore(events, begin); };
+
+        const auto slack = exact ? 0 : retentionAge / 4;
+        if (retentionAge > 0 && applicationTime.end > retentionAge
+            && applicationTime.end >= expiredEventsTime + retentionAge + slack) {
+            expiredEventsTime = applicationTime.end - retentionAge;
+            auto trim = [this, &dropEvents](Data::Events* events) {
+                dropEvents(events, events->lowerBound(events->begin(), events->end(), expiredEventsTime).index());
+            };
+            for (auto& thread : eventResult.threads) {
+                trim(&thread.events);
+            }
+            for (auto& track : eventResult.contextSwitches) {
+                dropSlices(&track, track.sliceAt(expiredEventsTime));
+            }
         }
 
-        switch (static_cast<EventType>(eventType)) {
-        case EventType::TracePointSample:
-        case EventType::Sample: {
-            Sample sample;
-            stream >> sample;
-            qCDebug(LOG_PERFPARSER) << "parsed:" << sample;
-            for (auto& sampleCost : sample.costs) {
-                if (!sampleCost.cost) {
-                    const auto& attribute = attributes.value(sampleCost.attributeId);
-                    if (!attribute.usesFrequency) {
-                        sampleCost.cost = attribute.frequencyOrPeriod;
-                    }
+        if (maxEventsPerThread > 0) {
+            const auto maxEvents = exact ? maxEventsPerThread : maxEventsPerThread + maxEventsPerThread / 4;
+            auto trim = [this, maxEvents, &dropEvents](Data::Events* events) {
+                if (events->size() > maxEvents) {
+                    dropEvents(events, events->size() - maxEventsPerThread);
                 }
+            };
+            for (auto& thread : eventResult.threads) {
+                trim(&thread.events);
             }
+        }
+    }
 
-            addRecord(sample);
-            addSample(sample);
+    void dropEventsBefore(Data::Events* events, int begin)
+    {
+        if (begin > 0) {
+            *events = events->mid(begin);
+            droppedEvents = true;
+        }
+    }
 
-            if (static_cast<EventType>(eventType) == EventType::TracePointSample)
-                return true; // TODO: read full data
-            break;
+    void dropSlices(Data::ContextSwitchTrack* track, int count)
+    {
+        if (count > 0) {
+            track->dropFirst(count);
+            droppedEvents = true;
         }
-        case EventType::ThreadStart: {
-            ThreadStart threadStart;
-            stream >> threadStart;
-            qCDebug(LOG_PERFPARSER) << "parsed:" << threadStart;
-            addRecord(threadStart);
-            // override start time explicitly
-            addThread(threadStart)->time.start = threadStart.time;
+    }
+
+    // drops the oldest events of every thread once the results need more memory than the budget allows. like
+    // applyRetention this keeps the aggregated costs intact, which is all that is left when even those exceed it.
+    // unless @p exact is set, this only checks the memory every few events and trims to three quarters of the
+    // budget left for the events, such that we don't have to trim again right away
+    void applyMemoryBudget(bool exact)
+    {
+        if (!memoryBudget || (!exact && numEventsParsed < nextMemoryCheck)) {
+            return;
+        }
+        nextMemoryCheck = numEventsParsed + 1000000;
+
+        const auto usage = Data::memoryUsage(bottomUpResult, topDownResult, callerCalleeResult, eventResult);
+        if (usage.total() <= memoryBudget || !usage.events) {
+            return;
+        }
+
+        const auto aggregates = usage.total() - usage.events;
+        const auto eventBudget = aggregates < memoryBudget ? memoryBudget - aggregates : 0;
+        const auto keep = (exact ? 1. : 0.75) * eventBudget / usage.events;
+        for (auto& thread : eventResult.threads) {
+            const auto numEvents = thread.events.size();
+            dropEventsBefore(&thread.events, numEvents - static_cast<int>(numEvents * keep));
+        }
+        for (auto& track : eventResult.contextSwitches) {
+            dropSlices(&track, track.size() - static_cast<int>(track.size() * keep));
+        }
+        exceededMemoryBudget = true;
+    }
+
+    // the events recorded so far, prepared like finalize does it but without modifying the parser state
+    Data::EventResults partialEventResults() const
+    {
+        const auto start = std::max(applicationTime.start, expiredEventsTime);
+        auto events = eventResult;
+        auto it = std::remove_if(events.threads.begin(), events.threads.end(),
+                                 [start](const Data::ThreadEvents& thread) { return thread.time.end < start; });
+        events.threads.erase(it, events.threads.end());
+        for (auto& thread : events.threads) {
+            thread.time.start = std::max(thread.time.start, start);
+            thread.time.end = std::min(thread.time.end, applicationTime.end);
+            thread.offCpuTime = std::min(thread.offCpuTime, thread.time.delta());
+            if (thread.name.isEmpty()) {
+                thread.name = PerfParser::tr("#%1").arg(thread.tid);
+            }
+        }
+        events.totalCosts = summaryResult.costs;
+        return events;
+    }
+
+    void publishPartialResults()
+    {
+        // the parallel aggregator only merges its results at the very end
+        if (partialResultsInterval <= 0 || aggregator || stopRequested || !parseTimer.isValid()
+            || parseTimer.elapsed() < nextPartialResults || bottomUpResult.root.children.isEmpty()) {
+            return;
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+
+        // the copy shares everything with the live aggregates, including the tree. new samples only detach the
+        // nodes along their path, so the published snapshot stays immutable without copying it up front. the
+        // parents are left unset, linking them up would detach the whole tree and the pages don't need them
+        auto bottomUp = bottomUpResult;
+        bottomUp.dropChildIndex();
+        emit partialBottomUpDataAvailable(bottomUp);
+        // building the top-down tree from scratch costs as much as the final one, so only the one that gets
+        // aggregated while ingesting is published
+        if (ingestTopDown) {
+            emit partialTopDownDataAvailable(partialTopDownResult(bottomUp));
+        }
+        if (isLive) {
+            emit partialEventsAvailable(partialEventResults());
+        }
+
+        // publish large trees less often, such that we spend at most a fifth of the time on this
+        const auto elapsed = timer.elapsed();
+        nextPartialResults = parseTimer.elapsed() + std::max(partialResultsInterval, 4 * elapsed);
+        qCDebug(LOG_PERFPARSER) << "published partial results in" << elapsed << "ms";
+    }
+
+    Data::TopDownResults partialTopDownResult(const Data::BottomUpResults& bottomUp) const
+    {
+        auto topDown = topDownResult;
+        topDown.selfCosts.initializeCostsFrom(bottomUp.costs);
+        topDown.inclusiveCosts.initializeCostsFrom(bottomUp.costs);
+        topDown.dropChildIndex();
+        return topDown;
+    }
+
+    void logThroughput() const
+    {
+        if (!parseTimer.isValid()) {
+            return;
+        }
+        const auto elapsed = std::max(qint64(1), parseTimer.elapsed());
+        qCDebug(LOG_PERFPARSER).nospace() << "parsed " << numEventsParsed << " events (" << numBytesParsed
+                                          << " bytes) in " << elapsed << "ms: "
+                                          << (numEventsParsed * 1000. / elapsed) << " events/s, "
+                                          << (numBytesParsed / 1000. / elapsed) << " MB/s";
+    }
+
+    bool parseEvent()
+    {
+        Q_ASSERT(buffer.isOpen());
+        Q_ASSERT(buffer.isReadable());
+
+        buffer.seek(0);
+        Q_ASSERT(buffer.pos() == 0);
+
+        stream.resetStatus();
+
+        qint8 eventType = 0;
+        stream >> eventType;
+        qCDebug(LOG_PERFPARSER) << "next event is:" << eventType;
+
+        if (eventType < 0 || eventType >= static_cast<qint8>(EventType::InvalidType)) {
+            qCWarning(LOG_PERFPARSER) << "invalid event type" << eventType;
+            state = PARSE_ERROR;
+            return false;
+        }
+
+        switch (static_cast<EventType>(eventType)) {
+        case EventType::TracePointSample:
+        case EventType::Sample: {
+            Sample sample;
+            stream >> sample;
+            qCDebug(LOG_PERFPARSER) << "parsed:" << sample;
+            for (auto& sampleCost : sample.costs) {
+                if (!sampleCost.cost) {
+                    const auto& attribute = attributes.value(sampleCost.attributeId);
+                    if (!attribute.usesFrequency) {
+                        sampleCost.cost = attribute.frequencyOrPeriod;
+                    }
+                }
+            }
+
+            addRecord(sample);
+            addSample(sample);
+
+            if (static_cast<EventType>(eventType) == EventType::TracePointSample) {
+                // the field values keyed by the string id of the field name
+                QHash<qint32, QVariant> tracePointData;
+                stream >> tracePointData;
+                addTracePointData(sample, tracePointData);
+            }
+            break;
+        }
+        case EventType::ThreadStart: {
+            ThreadStart threadStart;
+            stream >> threadStart;
+            qCDebug(LOG_PERFPARSER) << "parsed:" << threadStart;
+            addRecord(threadStart);
+            // override start time explicitly
+            addThread(threadStart)->time.start = threadStart.time;
             break;
         }
         case EventType::ThreadEnd: {
@@ -747,12 +1497,18 @@ public:
             float percent = 0;
             stream >> percent;
             qCDebug(LOG_PERFPARSER) << "parsed:" << percent;
+            inputProgress = percent;
             emit progress(percent);
             break;
         }
-        case EventType::TracePointFormat:
-            // TODO: implement me
-            return true;
+        case EventType::TracePointFormat: {
+            qint32 id = 0;
+            TracePointFormat format;
+            stream >> id >> format;
+            qCDebug(LOG_PERFPARSER) << "parsed:" << id << format;
+            addTracePointFormat(id, format);
+            break;
+        }
         case EventType::InvalidType:
             break;
         }
@@ -768,16 +1524,60 @@ public:
 
     void finalize()
     {
+        Instrumentation::ScopedTimer instrumentation("PerfParser::finalize");
+        logThroughput();
+
+        auto& stageTimes = summaryResult.stageTimes;
+        stageTimes.parsing = parseTimer.isValid() ? parseTimer.nsecsElapsed() : 0;
+        inputProgress = 1;
+        QElapsedTimer stageTimer;
+        stageTimer.start();
+        auto nextStage = [this, &stageTimer](Data::ParseProgress::Stage stage) -> quint64 {
+            const auto elapsed = stageTimer.nsecsElapsed();
+            stageTimer.restart();
+            reportProgress(stage, true);
+            return elapsed;
+        };
+        reportProgress(Data::ParseProgress::Stage::Aggregation, true);
+
+        if (scriptOutput) {
+            scriptOutput->flush();
+        }
+
+        if (aggregator) {
+            aggregator->finish(&bottomUpResult, &callerCalleeResult, &topDownResult);
+            aggregator.reset();
+        }
+
+        bottomUpResult.dropChildIndex();
         Data::BottomUp::initializeParents(&bottomUpResult.root);
 
+        applyRetention(true);
+
         summaryResult.applicationRunningTime = applicationTime.delta();
         summaryResult.threadCount = uniqueThreads.size();
         summaryResult.processCount = uniqueProcess.size();
 
+        stageTimes.aggregation = nextStage(Data::ParseProgress::Stage::TopDown);
         buildTopDownResult();
+        stageTimes.topDown = nextStage(Data::ParseProgress::Stage::CallerCallee);
         buildCallerCalleeResult();
+        stageTimes.callerCallee = stageTimer.nsecsElapsed();
+        qCDebug(LOG_PERFPARSER).nospace() << "stage times: parsing " << stageTimes.parsing / 1000000
+                                          << "ms, aggregation " << stageTimes.aggregation / 1000000
+                                          << "ms, top down " << stageTimes.topDown / 1000000
+                                          << "ms, caller/callee " << stageTimes.callerCallee / 1000000 << "ms";
+
+        applyMemoryBudget(true);
+        if (exceededMemoryBudget) {
+            summaryResult.errors.push_back(
+                PerfParser::tr("Dropped the oldest events to stay within the memory budget of %1 MiB, the "
+                               "aggregated costs still cover the whole recording.")
+                    .arg(memoryBudget / 1024 / 1024));
+        }
 
         for (auto& thread : eventResult.threads) {
+            thread.events.squeeze();
             thread.time.start = std::max(thread.time.start, applicationTime.start);
             thread.time.end = std::min(thread.time.end, applicationTime.end);
             if (thread.name.isEmpty()) {
@@ -796,14 +1596,9 @@ public:
             }
         }
 
-        {
-            uint cpuId = 0;
-            for (auto& cpu : eventResult.cpus) {
-                cpu.cpuId = cpuId++;
-            }
-        }
-
         eventResult.totalCosts = summaryResult.costs;
+        summaryResult.memoryUsage =
+            Data::memoryUsage(bottomUpResult, topDownResult, callerCalleeResult, eventResult);
     }
 
     qint32 addCostType(const QString& label, Data::Costs::Unit unit)
@@ -850,13 +1645,34 @@ public:
         thread.name = commands.value(thread.pid).value(thread.tid);
         if (thread.name.isEmpty() && thread.pid != thread.tid)
             thread.name = commands.value(thread.pid).value(thread.pid);
+        // a later thread with the same tid replaces the earlier one for the lookups
+        threadIndices.insert(threadKey(thread.pid, thread.tid), eventResult.threads.size());
         eventResult.threads.push_back(thread);
+        schedSwitchStackIds.push_back(-1);
+        schedSwitchStates.push_back(-1);
         return &eventResult.threads.last();
     }
 
+    static quint64 threadKey(qint32 pid, qint32 tid)
+    {
+        return (static_cast<quint64>(static_cast<quint32>(pid)) << 32) | static_cast<quint32>(tid);
+    }
+
+    // @return the thread with @p pid and @p tid that is alive at @p time, or nullptr when there is none
+    // a tid can get reused once its thread ended, events after the end thus belong to a new thread
+    Data::ThreadEvents* findThread(qint32 pid, qint32 tid, quint64 time)
+    {
+        const auto it = threadIndices.constFind(threadKey(pid, tid));
+        if (it == threadIndices.constEnd()) {
+            return nullptr;
+        }
+        auto* thread = &eventResult.threads[it.value()];
+        return thread->time.end < time ? nullptr : thread;
+    }
+
     void addThreadEnd(const ThreadEnd& threadEnd)
     {
-        auto* thread = eventResult.findThread(threadEnd.pid, threadEnd.tid);
+        auto* thread = findThread(threadEnd.pid, threadEnd.tid, threadEnd.time);
         if (thread) {
             thread->time.end = threadEnd.time;
         }
@@ -866,7 +1682,7 @@ public:
     {
         const auto& comm = strings.value(command.comm.id);
         // check if this changes the name of a current thread
-        auto* thread = eventResult.findThread(command.pid, command.tid);
+        auto* thread = findThread(command.pid, command.tid, command.time);
         if (thread) {
             thread->name = comm;
         }
@@ -906,43 +1722,169 @@ public:
         }
     }
 
+    // the frames are only stored once in eventResult.stacks, the lookup maps their hash to the candidate ids
     qint32 internStack(const QVector<qint32>& frames)
     {
-        auto& id = stacks[frames];
-        if (!id) {
-            Q_ASSERT(stacks.size() == eventResult.stacks.size() + 1);
-            id = stacks.size();
-            eventResult.stacks.push_back(frames);
+        const auto hash = qHash(frames);
+        for (auto it = stackIds.constFind(hash), end = stackIds.constEnd(); it != end && it.key() == hash; ++it) {
+            if (eventResult.stacks.at(it.value()) == frames) {
+                return it.value();
+            }
         }
-        return id - 1;
+        const qint32 id = eventResult.stacks.size();
+        stackIds.insert(hash, id);
+        eventResult.stacks.push_back(frames);
+        return id;
     }
 
     void addSample(const Sample& sample)
     {
-        auto* thread = eventResult.findThread(sample.pid, sample.tid);
+        auto* thread = findThread(sample.pid, sample.tid, sample.time);
         if (!thread) {
+            const bool isReused = threadIndices.contains(threadKey(sample.pid, sample.tid));
             thread = addThread(sample);
+            if (isReused) {
+                // the tid belonged to another thread before, so this one can't have been running from the start
+                thread->time.start = sample.time;
+            }
         }
-        if (static_cast<uint>(eventResult.cpus.size()) <= sample.cpu) {
-            eventResult.cpus.resize(sample.cpu + 1);
-        }
-        auto& cpu = eventResult.cpus[sample.cpu];
+        // the events of each CPU get collected from the threads when needed, see EventResults::cpuEvents
+        eventResult.numCpus = std::max(eventResult.numCpus, sample.cpu + 1);
 
+        // the costs of grouped events all share the same stack
+        const auto stackId = internStack(sample.frames);
         for (const auto& sampleCost : sample.costs) {
             Data::Event event;
             event.time = sample.time;
             event.cost = sampleCost.cost;
             event.type = attributeIdsToCostIds.value(sampleCost.attributeId, -1);
-            event.stackId = internStack(sample.frames);
+            event.stackId = stackId;
             event.cpuId = sample.cpu;
             thread->events.push_back(event);
-            cpu.events.push_back(event);
+            if (event.type == m_schedSwitchCostId && m_schedSwitchCostId != -1) {
+                schedSwitchStackIds[static_cast<int>(thread - eventResult.threads.constData())] = stackId;
+            }
         }
 
         addSampleToBottomUp(sample);
         addSampleToSummary(sample);
     }
 
+    void addTracePointFormat(qint32 id, const TracePointFormat& format)
+    {
+        tracePointFormats.insert(id, eventResult.tracepoints.size());
+        Data::TracepointEvents tracepoint;
+        tracepoint.system = strings.value(format.system.id);
+        tracepoint.name = strings.value(format.name.id);
+        if (tracepoint.system == QLatin1String("sched")) {
+            if (tracepoint.name == QLatin1String("sched_switch")) {
+                schedSwitchTracepoint = eventResult.tracepoints.size();
+            } else if (tracepoint.name == QLatin1String("sched_wakeup")) {
+                schedWakeupTracepoint = eventResult.tracepoints.size();
+            }
+        }
+        eventResult.tracepoints.push_back(tracepoint);
+        tracePointColumns.push_back({});
+    }
+
+    // appends the payload of @p sample to the columns of its tracepoint, fields that show up later on get
+    // padded with zeros for the earlier samples
+    void addTracePointData(const Sample& sample, const QHash<qint32, QVariant>& data)
+    {
+        if (sample.costs.isEmpty()) {
+            return;
+        }
+        // the config of a tracepoint attribute is the id of its format
+        const auto& attribute = attributes.value(sample.costs.first().attributeId);
+        const auto index = tracePointFormats.value(static_cast<qint32>(attribute.config), -1);
+        if (index == -1) {
+            return;
+        }
+
+        auto& tracepoint = eventResult.tracepoints[index];
+        auto& columns = tracePointColumns[index];
+        const auto row = tracepoint.size();
+        tracepoint.times.push_back(sample.time);
+        tracepoint.threadIds.push_back(static_cast<qint32>(sample.tid));
+
+        auto keys = data.keys();
+        if (columns.fields.isEmpty()) {
+            // keep the fields in a stable order, the hash order differs from run to run
+            std::sort(keys.begin(), keys.end(),
+                      [this](qint32 lhs, qint32 rhs) { return strings.value(lhs) < strings.value(rhs); });
+        }
+        for (const auto key : keys) {
+            const auto& value = data[key];
+            auto it = columns.fields.find(key);
+            if (it == columns.fields.end()) {
+                Data::TracepointField field;
+                field.name = strings.value(key);
+                field.type = isIntegerValue(value) ? Data::TracepointField::Type::Integer
+                                                   : Data::TracepointField::Type::String;
+                it = columns.fields.insert(key, tracepoint.fields.size());
+                tracepoint.fields.push_back(field);
+            }
+            auto& field = tracepoint.fields[it.value()];
+            field.values.resize(row);
+            if (field.type == Data::TracepointField::Type::Integer) {
+                field.values.push_back(value.toLongLong());
+            } else {
+                const auto string = stringValue(value);
+                auto stringIt = columns.strings.find(string);
+                if (stringIt == columns.strings.end()) {
+                    stringIt = columns.strings.insert(string, tracepoint.strings.size());
+                    tracepoint.strings.push_back(string);
+                }
+                field.values.push_back(stringIt.value());
+            }
+        }
+        for (auto& field : tracepoint.fields) {
+            field.values.resize(row + 1);
+        }
+
+        if (schedWakeupTracepoint != -1 && (index == schedSwitchTracepoint || index == schedWakeupTracepoint)) {
+            addSchedulerData(sample, index, row);
+        }
+    }
+
+    static bool isIntegerValue(const QVariant& value)
+    {
+        switch (static_cast<QMetaType::Type>(value.userType())) {
+        case QMetaType::Bool:
+        case QMetaType::Char:
+        case QMetaType::SChar:
+        case QMetaType::UChar:
+        case QMetaType::Short:
+        case QMetaType::UShort:
+        case QMetaType::Int:
+        case QMetaType::UInt:
+        case QMetaType::Long:
+        case QMetaType::ULong:
+        case QMetaType::LongLong:
+        case QMetaType::ULongLong:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    static QString stringValue(const QVariant& value)
+    {
+        if (value.userType() == QMetaType::QByteArray) {
+            // char arrays are padded with zeros
+            const auto bytes = value.toByteArray();
+            const auto end = bytes.indexOf('\0');
+            return QString::fromUtf8(end == -1 ? bytes : bytes.left(end));
+        } else if (value.userType() == QMetaType::QVariantList) {
+            QStringList elements;
+            for (const auto& element : value.toList()) {
+                elements.push_back(element.toString());
+            }
+            return elements.join(QLatin1Char(','));
+        }
+        return value.toString();
+    }
+
     void addString(const StringDefinition& string)
     {
         Q_ASSERT(string.id == strings.size());
@@ -951,52 +1893,80 @@ public:
 
     void addSampleToBottomUp(const Sample& sample)
     {
-        // TODO: optimize for groups, don't repeat the same lookup multiple times
-        for (const auto& sampleCost : sample.costs) {
-            addSampleToBottomUp(sample, sampleCost);
+        if (scriptOutput) {
+            // the script output lists the stack again for every cost
+            const auto command = commands.value(sample.pid).value(sample.pid);
+            for (const auto& sampleCost : sample.costs) {
+                scriptOutput->addSample(sample.pid, command, sample.time, sampleCost.attributeId,
+                                        strings.value(attributes.value(sampleCost.attributeId).name.id),
+                                        sampleCost.cost, sample.frames, bottomUpResult);
+            }
         }
-    }
 
-    void addSampleToBottomUp(const Sample& sample, const SampleCost& sampleCost)
-    {
-        if (perfScriptOutput) {
-            *perfScriptOutput << commands.value(sample.pid).value(sample.pid) << '\t' << sample.pid << '\t'
-                              << sample.time / 1000000000 << '.' << qSetFieldWidth(9) << qSetPadChar(QLatin1Char('0'))
-                              << sample.time % 1000000000 << qSetFieldWidth(0) << ":\t" << sampleCost.cost << ' '
-                              << strings.value(attributes.value(sampleCost.attributeId).name.id) << '\n';
+        // grouped events yield several costs for the same stack, add them all with a single walk of the stack
+        sampleCosts.resize(0);
+        for (const auto& sampleCost : sample.costs) {
+            const auto type = costType(sampleCost.attributeId);
+            if (type >= 0) {
+                sampleCosts.append({type, sampleCost.cost});
+            }
+        }
+        if (sampleCosts.isEmpty()) {
+            return;
         }
 
-        QSet<Data::Symbol> recursionGuard;
-        const auto type = attributeIdsToCostIds.value(sampleCost.attributeId, -1);
-
-        if (type < 0) {
-            qCWarning(LOG_PERFPARSER) << "Unexpected attribute id:" << sampleCost.attributeId << "Only know about"
-                                      << attributeIdsToCostIds.size() << "attributes so far";
+        if (aggregator) {
+            aggregator->addCosts(sample.frames, sampleCosts, bottomUpResult);
             return;
         }
 
-        auto frameCallback = [this, &recursionGuard, &sampleCost, type](const Data::Symbol& symbol,
-                                                                        const Data::Location& location) {
-            addCallerCalleeEvent(symbol, location, type, sampleCost.cost, &recursionGuard, &callerCalleeResult,
+        recursionGuard.reset();
+        auto frameCallback = [this](const Data::Symbol& symbol, const Data::Location& location) {
+            addCallerCalleeEvent(symbol, location, sampleCosts, &recursionGuard, &callerCalleeResult,
                                  bottomUpResult.costs.numTypes());
-
-            if (perfScriptOutput) {
-                *perfScriptOutput << '\t' << hex << qSetFieldWidth(16) << location.address << qSetFieldWidth(0) << dec
-                                  << ' ' << (symbol.symbol.isEmpty() ? QStringLiteral("[unknown]") : symbol.symbol)
-                                  << " (" << symbol.binary << ")\n";
+            if (ingestTopDown) {
+                topDownStack.append(symbol);
             }
         };
 
-        bottomUpResult.addEvent(type, sampleCost.cost, sample.frames, frameCallback);
+        bottomUpResult.addEvent(sampleCosts, sample.frames, frameCallback);
+        if (ingestTopDown) {
+            topDownResult.addEvent(sampleCosts, topDownStack);
+            topDownStack.resize(0);
+        }
+    }
+
+    // @return the cost id for @p attributeId, or -1 for unknown attributes
+    qint32 costType(qint32 attributeId) const
+    {
+        const auto type = attributeIdsToCostIds.value(attributeId, -1);
+        if (type < 0) {
+            qCWarning(LOG_PERFPARSER) << "Unexpected attribute id:" << attributeId << "Only know about"
+                                      << attributeIdsToCostIds.size() << "attributes so far";
+        }
+        return type;
+    }
 
-        if (perfScriptOutput) {
-            *perfScriptOutput << "\n";
+    // adds the stack collected by the frame callback to the top-down tree, when that one gets built while parsing
+    void addStackToTopDown(int type, quint64 cost)
+    {
+        if (ingestTopDown) {
+            topDownResult.addEvent(type, cost, topDownStack);
+            // keep the allocated memory around for the next stack
+            topDownStack.resize(0);
         }
     }
 
     void buildTopDownResult()
     {
-        topDownResult = Data::TopDownResults::fromBottomUp(bottomUpResult);
+        if (ingestTopDown) {
+            topDownResult.selfCosts.initializeCostsFrom(bottomUpResult.costs);
+            topDownResult.inclusiveCosts.initializeCostsFrom(bottomUpResult.costs);
+            topDownResult.dropChildIndex();
+            Data::TopDown::initializeParents(&topDownResult.root);
+        } else {
+            topDownResult = Data::TopDownResults::fromBottomUp(bottomUpResult);
+        }
     }
 
     void buildCallerCalleeResult()
@@ -1036,7 +2006,18 @@ public:
 
     void addContextSwitch(const ContextSwitchDefinition& contextSwitch)
     {
-        auto* thread = eventResult.findThread(contextSwitch.pid, contextSwitch.tid);
+        // the sequence of the switches on every CPU tells which thread occupied it, see Data::ContextSwitchTrack
+        if (contextSwitch.cpu != Data::INVALID_CPU_ID) {
+            auto& tracks = eventResult.contextSwitches;
+            if (static_cast<quint32>(tracks.size()) <= contextSwitch.cpu) {
+                tracks.resize(contextSwitch.cpu + 1);
+            }
+            tracks[contextSwitch.cpu].add(contextSwitch.time, static_cast<qint32>(contextSwitch.tid),
+                                          contextSwitch.switchOut);
+            eventResult.numCpus = std::max(eventResult.numCpus, contextSwitch.cpu + 1);
+        }
+
+        auto* thread = findThread(contextSwitch.pid, contextSwitch.tid, contextSwitch.time);
         if (!thread) {
             return;
         }
@@ -1049,42 +2030,124 @@ public:
                 eventResult.offCpuTimeCostId = addCostType(PerfParser::tr("off-CPU Time"), Data::Costs::Unit::Time);
             }
 
-            auto& totalCost = summaryResult.costs[eventResult.offCpuTimeCostId];
-            totalCost.sampleCount++;
-            totalCost.totalPeriod += switchTime;
+            // the off-CPU time gets attributed to the stack of the thread's last sched_switch
+            const auto threadIndex = static_cast<int>(thread - eventResult.threads.constData());
+            const qint32 stackId = schedSwitchStackIds.at(threadIndex);
+            addOffCpuCost(thread, eventResult.offCpuTimeCostId, switchTime, stackId, contextSwitch.cpu);
 
-            qint32 stackId = -1;
-            if (!thread->events.isEmpty() && m_schedSwitchCostId != -1) {
-                auto it = std::find_if(thread->events.rbegin(), thread->events.rend(),
-                                       [this](const Data::Event& event) { return event.type == m_schedSwitchCostId; });
-                if (it != thread->events.rend()) {
-                    stackId = it->stackId;
+            // with the wakeups recorded too, the time also gets broken down by why and by whom the thread waited
+            if (schedWakeupTracepoint != -1) {
+                const auto state = schedSwitchStates.at(threadIndex);
+                if (state != -1) {
+                    addOffCpuCost(thread, waitReasonCostId(state), switchTime, stackId, contextSwitch.cpu);
+                }
+                const auto wakeup = wakeups.find(static_cast<qint32>(contextSwitch.tid));
+                if (wakeup != wakeups.end()) {
+                    if (wakeup->time >= thread->lastSwitchTime) {
+                        // the wakeup chain: the stack of the waker on top of the one the thread waited in
+                        auto frames = eventResult.stacks.at(wakeup->stackId);
+                        if (stackId != -1) {
+                            frames += eventResult.stacks.at(stackId);
+                        }
+                        if (wakeupTimeCostId == -1) {
+                            wakeupTimeCostId = addCostType(PerfParser::tr("Wakeup Time"), Data::Costs::Unit::Time);
+                        }
+                        addOffCpuCost(thread, wakeupTimeCostId, switchTime, internStack(frames), contextSwitch.cpu);
+                    }
+                    wakeups.erase(wakeup);
                 }
             }
-            if (stackId != -1) {
-                const auto& frames = eventResult.stacks[stackId];
-                QSet<Data::Symbol> recursionGuard;
-                auto frameCallback = [this, &recursionGuard, switchTime](const Data::Symbol& symbol,
-                                                                         const Data::Location& location) {
-                    addCallerCalleeEvent(symbol, location, eventResult.offCpuTimeCostId, switchTime, &recursionGuard,
-                                         &callerCalleeResult, bottomUpResult.costs.numTypes());
-                };
-                bottomUpResult.addEvent(eventResult.offCpuTimeCostId, switchTime, frames, frameCallback);
-            }
-
-            Data::Event event;
-            event.time = thread->lastSwitchTime;
-            event.cost = switchTime;
-            event.type = eventResult.offCpuTimeCostId;
-            event.stackId = stackId;
-            event.cpuId = contextSwitch.cpu;
-            thread->events.push_back(event);
         }
 
         thread->lastSwitchTime = contextSwitch.time;
         thread->state = contextSwitch.switchOut ? Data::ThreadEvents::OffCpu : Data::ThreadEvents::OnCpu;
     }
 
+    // attributes @p cost of @p type to @p stackId of @p thread, which was off-CPU since its last switch
+    void addOffCpuCost(Data::ThreadEvents* thread, qint32 type, quint64 cost, qint32 stackId, quint32 cpu)
+    {
+        auto& totalCost = summaryResult.costs[type];
+        totalCost.sampleCount++;
+        totalCost.totalPeriod += cost;
+
+        if (stackId != -1 && aggregator) {
+            aggregator->addCost(eventResult.stacks[stackId], type, cost, bottomUpResult);
+        } else if (stackId != -1) {
+            const auto& frames = eventResult.stacks[stackId];
+            recursionGuard.reset();
+            auto frameCallback = [this, type, cost](const Data::Symbol& symbol, const Data::Location& location) {
+                addCallerCalleeEvent(symbol, location, type, cost, &recursionGuard, &callerCalleeResult,
+                                     bottomUpResult.costs.numTypes());
+                if (ingestTopDown) {
+                    topDownStack.append(symbol);
+                }
+            };
+            bottomUpResult.addEvent(type, cost, frames, frameCallback);
+            addStackToTopDown(type, cost);
+        }
+
+        Data::Event event;
+        event.time = thread->lastSwitchTime;
+        event.cost = cost;
+        event.type = type;
+        event.stackId = stackId;
+        event.cpuId = cpu;
+        thread->events.push_back(event);
+    }
+
+    enum WaitReason
+    {
+        Preempted,
+        Sleeping,
+        Uninterruptible,
+        OtherWaitReason,
+        NumWaitReasons
+    };
+
+    // @return the cost id of the off-CPU time of threads that got switched out in the @p prevState of sched_switch
+    qint32 waitReasonCostId(qint64 prevState)
+    {
+        // the low bits hold the task state, the higher ones flag e.g. a preemption while running
+        const auto taskState = prevState & 0x7f;
+        auto reason = OtherWaitReason;
+        if (taskState == 0) {
+            reason = Preempted;
+        } else if (taskState & 0x1) {
+            reason = Sleeping;
+        } else if (taskState & 0x2) {
+            reason = Uninterruptible;
+        }
+        auto& costId = waitReasonCostIds[reason];
+        if (costId == -1) {
+            const QString labels[NumWaitReasons] = {
+                PerfParser::tr("off-CPU Time (preempted)"), PerfParser::tr("off-CPU Time (sleeping)"),
+                PerfParser::tr("off-CPU Time (uninterruptible)"), PerfParser::tr("off-CPU Time (other)")};
+            costId = addCostType(labels[reason], Data::Costs::Unit::Time);
+        }
+        return costId;
+    }
+
+    // remembers the wait reason of sched_switch and the waker of sched_wakeup, see addContextSwitch
+    void addSchedulerData(const Sample& sample, int tracepointIndex, int row)
+    {
+        const auto& tracepoint = eventResult.tracepoints.at(tracepointIndex);
+        const bool isSwitch = tracepointIndex == schedSwitchTracepoint;
+        const auto field = tracepoint.fieldIndex(isSwitch ? QStringLiteral("prev_state") : QStringLiteral("pid"));
+        if (field == -1 || tracepoint.fields.at(field).type != Data::TracepointField::Type::Integer) {
+            return;
+        }
+        const auto value = tracepoint.fields.at(field).values.at(row);
+        if (isSwitch) {
+            // the sample belongs to the thread that got switched out
+            if (const auto* thread = findThread(sample.pid, sample.tid, sample.time)) {
+                schedSwitchStates[static_cast<int>(thread - eventResult.threads.constData())] = value;
+            }
+        } else {
+            // the sample belongs to the waker, the payload names the thread it wakes
+            wakeups.insert(static_cast<qint32>(value), {sample.time, internStack(sample.frames)});
+        }
+    }
+
     void addLost(const LostDefinition& /*lost*/)
     {
         ++summaryResult.lostChunks;
@@ -1092,11 +2155,7 @@ public:
 
     void setFeatures(const FeaturesDefinition& features)
     {
-        // first entry in cmdline is "perf" which could contain a path
-        // we only want to show the name without the path
-        auto args = features.cmdline;
-        args.removeFirst();
-        summaryResult.command = QLatin1String("perf ") + QString::fromUtf8(args.join(' '));
+        summaryResult.command = PerfHeader::formatCommand(features.cmdline);
         summaryResult.hostName = QString::fromUtf8(features.hostName);
         summaryResult.linuxKernelVersion = QString::fromUtf8(features.osRelease);
         summaryResult.perfVersion = QString::fromUtf8(features.version);
@@ -1105,14 +2164,12 @@ public:
         summaryResult.cpuArchitecture = QString::fromUtf8(features.arch);
         summaryResult.cpusOnline = features.nrCpusOnline;
         summaryResult.cpusAvailable = features.nrCpusAvailable;
-        auto formatCpuList = [](const QByteArrayList& list) -> QString {
-            return QString::fromUtf8('[' + list.join("], [") + ']');
-        };
-        summaryResult.cpuSiblingCores = formatCpuList(features.siblingCores);
-        summaryResult.cpuSiblingThreads = formatCpuList(features.siblingThreads);
+        summaryResult.cpuSiblingCores = PerfHeader::formatCpuList(features.siblingCores);
+        summaryResult.cpuSiblingThreads = PerfHeader::formatCpuList(features.siblingThreads);
         summaryResult.totalMemoryInKiB = features.totalMem;
 
-        eventResult.cpus.resize(features.nrCpusAvailable);
+        eventResult.numCpus = std::max(eventResult.numCpus, features.nrCpusAvailable);
+        eventResult.cpuNumaNodes = cpuNumaNodes(features.numaTopology, features.nrCpusAvailable);
     }
 
     void addError(const Error& error)
@@ -1153,6 +2210,30 @@ public:
 
     State state = HEADER;
     quint32 eventSize = 0;
+    QByteArray readBuffer;
+    QElapsedTimer parseTimer;
+    // in ms since the parse timer got started, see publishPartialResults
+    qint64 partialResultsInterval = 0;
+    qint64 nextPartialResults = 0;
+    // in ms since the parse timer got started, see reportProgress
+    qint64 nextProgressReport = 0;
+    // the last progress reported by hotspot-perfparser
+    float inputProgress = 0;
+    // the size of the input file, zero when unknown
+    quint64 inputSize = 0;
+    // set when parsing from a named pipe, i.e. while recording
+    bool isLive = false;
+    // the retention policy for the events, zero means unlimited, see applyRetention
+    quint64 retentionAge = 0;
+    int maxEventsPerThread = 0;
+    quint64 expiredEventsTime = 0;
+    bool droppedEvents = false;
+    // the maximum memory of the results in bytes, zero means unlimited, see applyMemoryBudget
+    quint64 memoryBudget = 0;
+    quint64 nextMemoryCheck = 0;
+    bool exceededMemoryBudget = false;
+    quint64 numEventsParsed = 0;
+    quint64 numBytesParsed = 0;
     QBuffer buffer;
     QDataStream stream;
     QVector<AttributesDefinition> attributes;
@@ -1164,18 +2245,58 @@ public:
     QSet<quint32> uniqueProcess;
     Data::BottomUpResults bottomUpResult;
     Data::TopDownResults topDownResult;
+    bool ingestTopDown = false;
+    QVector<Data::Symbol> topDownStack;
     Data::CallerCalleeResults callerCalleeResult;
+    // reused for every sample, see addCallerCalleeEvent
+    Data::RecursionGuard recursionGuard;
+    // reused for every sample, see addSampleToBottomUp
+    Data::TypedCosts sampleCosts;
     Data::EventResults eventResult;
     QHash<qint32, QHash<qint32, QString>> commands;
-    QScopedPointer<QTextStream> perfScriptOutput;
+    // set when the samples get written as the text output of `perf script` too
+    std::unique_ptr<PerfScriptBuffer> scriptOutput;
+    QScopedPointer<SampleAggregator> aggregator;
     QSet<qint32> reportedMissingDebugInfoModules;
     QSet<QString> encounteredErrors;
-    QHash<QVector<qint32>, qint32> stacks;
+    // (pid, tid) -> index of the latest thread in eventResult.threads, see findThread
+    QHash<quint64, int> threadIndices;
+    // the stack id of the last sched_switch event of every thread in eventResult.threads, -1 if there was none
+    QVector<qint32> schedSwitchStackIds;
+    // the prev_state of the last sched_switch event of every thread in eventResult.threads, -1 if there was none
+    QVector<qint64> schedSwitchStates;
+    struct Wakeup
+    {
+        quint64 time;
+        // the stack of the waker
+        qint32 stackId;
+    };
+    // the tid of every thread woken by a sched_wakeup event -> its latest wakeup, until it gets switched in
+    QHash<qint32, Wakeup> wakeups;
+    // hash of the frames -> ids of the interned stacks with that hash, see internStack
+    QMultiHash<uint, qint32> stackIds;
     std::atomic<bool> stopRequested;
     QHash<qint32, qint32> attributeIdsToCostIds;
     QHash<int, qint32> attributeNameToCostIds;
+    // the id of every tracepoint format -> index into eventResult.tracepoints
+    QHash<qint32, int> tracePointFormats;
+    struct TracePointColumns
+    {
+        // the string id of every field name -> index into the fields of the tracepoint
+        QHash<qint32, int> fields;
+        // the interned values of the string fields
+        QHash<QString, qint32> strings;
+    };
+    // one entry per tracepoint in eventResult.tracepoints
+    QVector<TracePointColumns> tracePointColumns;
     qint32 m_nextCostId = 0;
     qint32 m_schedSwitchCostId = -1;
+    // indices into eventResult.tracepoints, the wait analysis only happens when the wakeups got recorded
+    int schedSwitchTracepoint = -1;
+    int schedWakeupTracepoint = -1;
+    // the cost ids of the off-CPU time per WaitReason and of the time attributed to the wakers, -1 until needed
+    qint32 waitReasonCostIds[NumWaitReasons] = {-1, -1, -1, -1};
+    qint32 wakeupTimeCostId = -1;
 
 public slots:
     void stop()
@@ -1186,160 +2307,1340 @@ public slots:
 
 signals:
     void progress(float percent);
+    void parseProgress(const Data::ParseProgress& progress);
+    void partialBottomUpDataAvailable(const Data::BottomUpResults& data);
+    void partialTopDownDataAvailable(const Data::TopDownResults& data);
+    void partialEventsAvailable(const Data::EventResults& data);
 };
 
-PerfParser::PerfParser(QObject* parent)
-    : QObject(parent)
-    , m_isParsing(false)
-    , m_stopRequested(false)
+namespace {
+struct FilterResults
 {
-    // set data via signal/slot connection to ensure we don't introduce a data race
-    connect(this, &PerfParser::bottomUpDataAvailable, this, [this](const Data::BottomUpResults& data) {
-        if (m_bottomUpResults.root.children.isEmpty()) {
-            m_bottomUpResults = data;
-        }
-    });
-    connect(this, &PerfParser::callerCalleeDataAvailable, this, [this](const Data::CallerCalleeResults& data) {
-        if (m_callerCalleeResults.entries.isEmpty()) {
-            m_callerCalleeResults = data;
-        }
-    });
-    connect(this, &PerfParser::eventsAvailable, this, [this](const Data::EventResults& data) {
-        if (m_events.threads.isEmpty()) {
-            m_events = data;
-        }
-    });
-    connect(this, &PerfParser::parsingStarted, this, [this]() {
-        m_isParsing = true;
-        m_stopRequested = false;
-    });
-    connect(this, &PerfParser::parsingFailed, this, [this]() { m_isParsing = false; });
-    connect(this, &PerfParser::parsingFinished, this, [this]() { m_isParsing = false; });
-}
-
-PerfParser::~PerfParser() = default;
+    Data::BottomUpResults bottomUp;
+    Data::TopDownResults topDown;
+    Data::CallerCalleeResults callerCallee;
+    Data::EventResults events;
+    QVector<bool> filterStacks;
+    Data::ApproximationStats approximation;
+};
 
-void PerfParser::startParseFile(const QString& path, const QString& sysroot, const QString& kallsyms,
-                                const QString& debugPaths, const QString& extraLibPaths, const QString& appPath,
-                                const QString& arch)
+// a rough estimate of the memory required by the results, used as the cost in the filter cache
+quint64 estimateMemory(const FilterResults& results)
 {
-    Q_ASSERT(!m_isParsing);
+    // the symbols and locations are shared with the unfiltered results
+    const auto usage = Data::memoryUsage(results.bottomUp, results.topDown, results.callerCallee, results.events);
+    return sizeof(FilterResults) + usage.bottomUp + usage.topDown + usage.callerCallee + usage.events
+        + results.filterStacks.size() * sizeof(bool);
+}
+}
 
-    QFileInfo info(path);
-    if (!info.exists()) {
-        emit parsingFailed(tr("File '%1' does not exist.").arg(path));
-        return;
-    }
-    if (!info.isFile()) {
-        emit parsingFailed(tr("'%1' is not a file.").arg(path));
-        return;
+// bounded LRU cache of filter results, which makes going back to a previous filter instant
+class FilterCache
+{
+public:
+    FilterCache()
+    {
+        const auto budgetMB = qEnvironmentVariableIntValue("HOTSPOT_FILTER_CACHE_MB");
+        m_stats.budgetBytes = (budgetMB > 0 ? budgetMB : 512) * quint64(1024 * 1024);
+        // QCache uses int costs, so account in KiB to support large budgets
+        m_cache.setMaxCost(toCacheCost(m_stats.budgetBytes / 1024));
     }
-    if (!info.isReadable()) {
-        emit parsingFailed(tr("File '%1' is not readable.").arg(path));
-        return;
+
+    bool find(const Data::FilterAction& filter, FilterResults* results)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (auto* cached = m_cache.object(filter.normalized())) {
+            ++m_stats.hits;
+            *results = *cached;
+            return true;
+        }
+        ++m_stats.misses;
+        return false;
+    }
+
+    // like find, but for lookups that don't come from filtering, which must not skew the hit rate
+    bool peek(const Data::FilterAction& filter, FilterResults* results)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (auto* cached = m_cache.object(filter.normalized())) {
+            *results = *cached;
+            return true;
+        }
+        return false;
+    }
+
+    void insert(const Data::FilterAction& filter, const FilterResults& results)
+    {
+        const auto cost = std::max<quint64>(1, estimateMemory(results) / 1024);
+        QMutexLocker locker(&m_mutex);
+        const auto key = filter.normalized();
+        if (m_cache.insert(key, new FilterResults(results), toCacheCost(cost))) {
+            m_costs[key] = cost;
+        }
+        // drop the bookkeeping for entries that got evicted
+        for (auto it = m_costs.begin(); it != m_costs.end();) {
+            if (m_cache.contains(it.key())) {
+                ++it;
+            } else {
+                it = m_costs.erase(it);
+            }
+        }
+    }
+
+    void clear()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_cache.clear();
+        m_costs.clear();
+        m_stats.hits = 0;
+        m_stats.misses = 0;
+    }
+
+    Data::FilterCacheStats stats() const
+    {
+        QMutexLocker locker(&m_mutex);
+        auto stats = m_stats;
+        stats.entries = m_cache.size();
+        stats.usedBytes = 0;
+        for (auto cost : m_costs) {
+            stats.usedBytes += cost * 1024;
+        }
+        return stats;
+    }
+
+private:
+    static int toCacheCost(quint64 cost)
+    {
+        return static_cast<int>(std::min<quint64>(cost, std::numeric_limits<int>::max()));
+    }
+
+    mutable QMutex m_mutex;
+    QCache<Data::FilterAction, FilterResults> m_cache;
+    QHash<Data::FilterAction, quint64> m_costs;
+    Data::FilterCacheStats m_stats;
+};
+
+// how many events a filter job aggregates before checking whether it got superseded again
+const int CancelCheckInterval = 4096;
+
+// hands the results of the filter jobs over to the GUI thread, which only applies the ones of the current request
+class FilterOutcomes
+{
+public:
+    struct Outcome
+    {
+        // set when the filter got stopped, none of the results are valid then
+        QString error;
+        Data::FilterAction filter;
+        // already pruned
+        FilterResults results;
+        // the collapsed stacks for the collapse mode of the filter, when the job computed them
+        QVector<QVector<qint32>> collapsedStacks;
+    };
+
+    void put(uint generation, const Outcome& outcome)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_outcomes.insert(generation, outcome);
+    }
+
+    Outcome take(uint generation)
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_outcomes.take(generation);
+    }
+
+private:
+    QMutex m_mutex;
+    QHash<uint, Outcome> m_outcomes;
+};
+
+namespace {
+// aggregate the events of all threads into @p bottomUp and @p callerCallee, like the parser does
+// while reading the samples, but handling the threads in parallel. @p callerCallee may be null
+void aggregateEvents(const Data::EventResults& events, Data::BottomUpResults* bottomUp,
+                     Data::CallerCalleeResults* callerCallee)
+{
+    struct PartialResult
+    {
+        Data::BottomUpResults bottomUp;
+        Data::CallerCalleeResults callerCallee;
+    };
+    std::vector<PartialResult> partials(events.threads.size());
+    const int numCosts = bottomUp->costs.numTypes();
+
+    Util::parallelFor(events.threads.size(),
+                      [&](int begin, int end) {
+                          for (int i = begin; i < end; ++i) {
+                              auto* partial = &partials[i];
+                              partial->bottomUp.symbols = bottomUp->symbols;
+                              partial->bottomUp.locations = bottomUp->locations;
+                              partial->bottomUp.costs.initializeCostsFrom(bottomUp->costs);
+
+                              Data::RecursionGuard recursionGuard;
+                              for (const auto& event : events.threads.at(i).events) {
+                                  // skip the events that never contributed to the aggregated data
+                                  if (event.type < 0 || event.stackId < 0) {
+                                      continue;
+                                  }
+
+                                  recursionGuard.reset();
+                                  auto frameCallback = [partial, &recursionGuard, &event, numCosts, callerCallee](
+                                                           const Data::Symbol& symbol, const Data::Location& location) {
+                                      if (callerCallee) {
+                                          addCallerCalleeEvent(symbol, location, event.type, event.cost,
+                                                               &recursionGuard, &partial->callerCallee, numCosts);
+                                      }
+                                  };
+                                  partial->bottomUp.addEvent(event.type, event.cost, events.stacks.at(event.stackId),
+                                                             frameCallback);
+                              }
+                          }
+                      },
+                      1);
+
+    // merge in thread order to get deterministic ids
+    for (auto& partial : partials) {
+        bottomUp->merge(partial.bottomUp);
+        if (callerCallee) {
+            callerCallee->merge(partial.callerCallee);
+        }
+        partial = {};
+    }
+}
+
+// build the aggregated data from the events, @p callerCallee may be null when it isn't needed
+void aggregateResults(const Data::Summary& summary, const QVector<Data::Symbol>& symbols,
+                      const QVector<Data::FrameLocation>& locations, const Data::EventResults& events,
+                      Data::BottomUpResults* bottomUp, Data::CallerCalleeResults* callerCallee)
+{
+    bottomUp->symbols = symbols;
+    bottomUp->locations = locations;
+    for (int i = 0, c = summary.costs.size(); i < c; ++i) {
+        const auto& cost = summary.costs.at(i);
+        bottomUp->costs.addType(i, cost.label, cost.unit);
+    }
+
+    aggregateEvents(events, bottomUp, callerCallee);
+    bottomUp->dropChildIndex();
+    Data::BottomUp::initializeParents(&bottomUp->root);
+    if (callerCallee) {
+        Data::callerCalleesFromBottomUpData(*bottomUp, callerCallee);
+    }
+}
+
+// @return a translated error message when @p path cannot be parsed, or an empty string otherwise
+QString inputFileError(const QString& path, bool allowFifo)
+{
+    QFileInfo info(path);
+    if (!info.exists()) {
+        return PerfParser::tr("File '%1' does not exist.").arg(path);
+    }
+    if (!info.isFile() && !(allowFifo && Util::isFifo(path))) {
+        return PerfParser::tr("'%1' is not a file.").arg(path);
+    }
+    if (!info.isReadable()) {
+        return PerfParser::tr("File '%1' is not readable.").arg(path);
+    }
+    return {};
+}
+
+// @return the command that writes the decompressed contents of @p path to stdout, or an empty list when the file
+// isn't compressed. the compression is detected from the magic bytes, such that the file name doesn't matter
+QStringList decompressionCommand(const QString& path)
+{
+    if (Util::isFifo(path)) {
+        return {};
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    const auto magic = file.read(6);
+    if (magic.startsWith("\x28\xb5\x2f\xfd")) {
+        return {QStringLiteral("zstd"), QStringLiteral("-dcq"), path};
+    } else if (magic == QByteArray("\xfd" "7zXZ\0", 6)) {
+        return {QStringLiteral("xz"), QStringLiteral("-dcq"), path};
+    }
+    return {};
+}
+
+// @return a translated error message when the output of @p decompression cannot be streamed into the parser
+QString decompressionError(const QStringList& decompression)
+{
+    const auto& program = decompression.first();
+    if (QStandardPaths::findExecutable(program).isEmpty()) {
+        return PerfParser::tr("Please install %1 to open compressed files.").arg(program);
+    }
+
+    // perf.data files in the file format need to be seekable, only the pipe format can be read from a stream
+    QProcess process;
+    process.start(program, decompression.mid(1));
+    QByteArray header;
+    const int headerSize = 16;
+    while (header.size() < headerSize && (process.bytesAvailable() || process.waitForReadyRead())) {
+        header += process.read(headerSize - header.size());
+    }
+    process.kill();
+    process.waitForFinished();
+
+    if (header.size() < headerSize || !header.startsWith("PERFILE2")) {
+        return PerfParser::tr("The decompressed data is not a perf.data file.");
+    }
+    if (qFromLittleEndian<quint64>(reinterpret_cast<const uchar*>(header.constData()) + 8) != headerSize) {
+        return PerfParser::tr("Compressed files must contain perf data in the pipe format, e.g. created via "
+                              "`perf inject -i perf.data -o - | zstd > perf.data.zst`.");
+    }
+    return {};
+}
+
+// streams the decompressed input into the stdin of the parser, which has to be started afterwards
+// @return a translated error message when the decompression could not be started
+QString startDecompression(QProcess* decompressor, QProcess* parser, const QStringList& decompression)
+{
+    const auto error = decompressionError(decompression);
+    if (!error.isEmpty()) {
+        return error;
+    }
+    decompressor->setStandardOutputProcess(parser);
+    decompressor->start(decompression.first(), decompression.mid(1));
+    if (!decompressor->waitForStarted()) {
+        return PerfParser::tr("Failed to start %1: %2").arg(decompression.first(), decompressor->errorString());
+    }
+    return {};
+}
+
+QString findParserBinary()
+{
+    auto parserBinary = QString::fromLocal8Bit(qgetenv("HOTSPOT_PERFPARSER"));
+    if (parserBinary.isEmpty()) {
+        parserBinary = Util::findLibexecBinary(QStringLiteral("hotspot-perfparser"));
+    }
+    return parserBinary;
+}
+
+QStringList parserArguments(const QString& path, const QString& sysroot, const QString& kallsyms,
+                            const QString& debugPaths, const QString& extraLibPaths, const QString& appPath,
+                            const QString& arch)
+{
+    // compressed files get decompressed into the stdin of the parser
+    const auto input = decompressionCommand(path).isEmpty() ? path : QStringLiteral("-");
+    QStringList parserArgs = {QStringLiteral("--input"), input, QStringLiteral("--max-frames"), QStringLiteral("1024")};
+    if (!sysroot.isEmpty()) {
+        parserArgs += {QStringLiteral("--sysroot"), sysroot};
+    }
+    if (!kallsyms.isEmpty()) {
+        parserArgs += {QStringLiteral("--kallsyms"), kallsyms};
+    }
+    if (!debugPaths.isEmpty()) {
+        parserArgs += {QStringLiteral("--debug"), debugPaths};
+    }
+    if (!extraLibPaths.isEmpty()) {
+        parserArgs += {QStringLiteral("--extra"), extraLibPaths};
+    }
+    if (!appPath.isEmpty()) {
+        parserArgs += {QStringLiteral("--app"), appPath};
     }
+    if (!arch.isEmpty()) {
+        parserArgs += {QStringLiteral("--arch"), arch};
+    }
+    return parserArgs;
+}
+
+enum ParserExitCode
+{
+    NoError,
+    TcpSocketError,
+    CannotOpen,
+    BadMagic,
+    HeaderError,
+    DataError,
+    MissingData,
+    InvalidOption
+};
+
+QString parserExitError(int exitCode)
+{
+    switch (exitCode) {
+    case NoError:
+        return {};
+    case TcpSocketError:
+        return PerfParser::tr("The hotspot-perfparser binary exited with code %1 (TCP socket error).").arg(exitCode);
+    case CannotOpen:
+        return PerfParser::tr("The hotspot-perfparser binary exited with code %1 (file could not be opened).")
+            .arg(exitCode);
+    case BadMagic:
+    case HeaderError:
+    case DataError:
+    case MissingData:
+        return PerfParser::tr("The hotspot-perfparser binary exited with code %1 (invalid perf data file).")
+            .arg(exitCode);
+    case InvalidOption:
+        return PerfParser::tr("The hotspot-perfparser binary exited with code %1 (invalid option).").arg(exitCode);
+    default:
+        return PerfParser::tr("The hotspot-perfparser binary exited with code %1.").arg(exitCode);
+    }
+}
+}
+
+// binary cache of the parse results, stored next to the perf.data file. Opening the same file again
+// with the same settings then skips the expensive unwinding and symbol resolution in the perfparser
+class ResultsCache
+{
+public:
+    struct Contents
+    {
+        Data::Summary summary;
+        QVector<Data::Symbol> symbols;
+        QVector<Data::FrameLocation> locations;
+        Data::EventResults events;
+    };
+
+    ResultsCache() = default;
+
+    ResultsCache(const QString& path, const QString& parserBinary, const QStringList& parserArgs)
+        : m_filePath(path + QLatin1String(".hotspot-cache"))
+        , m_key(key(path, parserBinary, parserArgs))
+    {
+    }
+
+    // @return the identity of @p path and of the settings it gets parsed with, or an empty key when it can't be read
+    static QByteArray key(const QString& path, const QString& parserBinary, const QStringList& parserArgs)
+    {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return {};
+        }
+
+        // hashing the whole file would take as long as reading it, so combine the size and modification time
+        // with a hash of its head and tail, which contain the perf header and feature sections
+        const qint64 sampleSize = 1024 * 1024;
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        auto addFileInfo = [&hash](const QFileInfo& info) {
+            hash.addData(QByteArray::number(info.size()));
+            hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+        };
+        addFileInfo(QFileInfo(path));
+        hash.addData(file.read(sampleSize));
+        if (file.size() > sampleSize && file.seek(std::max(sampleSize, file.size() - sampleSize))) {
+            hash.addData(file.readAll());
+        }
+        // a different perfparser may unwind differently
+        addFileInfo(QFileInfo(parserBinary));
+        // the arguments include the sysroot, debug paths and all other settings that influence the unwinding
+        for (const auto& arg : parserArgs) {
+            hash.addData(arg.toUtf8());
+            hash.addData("\0", 1);
+        }
+        return hash.result();
+    }
+
+    bool isValid() const
+    {
+        return !m_key.isEmpty();
+    }
+
+    QString filePath() const
+    {
+        return m_filePath;
+    }
+
+    bool load(Contents* contents) const
+    {
+        if (!isValid()) {
+            return false;
+        }
+
+        QFile file(m_filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+
+        // map the file instead of reading it, the pages then only get touched once while deserializing
+        const auto size = file.size();
+        if (size > std::numeric_limits<int>::max()) {
+            return false;
+        }
+        const auto* data = file.map(0, size);
+        if (!data) {
+            qCDebug(LOG_PERFPARSER) << "failed to map results cache" << m_filePath << file.errorString();
+            return false;
+        }
+        auto bytes = QByteArray::fromRawData(reinterpret_cast<const char*>(data), static_cast<int>(size));
+        QBuffer buffer(&bytes);
+        buffer.open(QIODevice::ReadOnly);
+        QDataStream stream(&buffer);
+        stream.setVersion(StreamVersion);
+
+        quint32 magic = 0;
+        quint32 version = 0;
+        QByteArray key;
+        stream >> magic >> version;
+        if (magic != Magic || version != Version) {
+            qCDebug(LOG_PERFPARSER) << "ignoring results cache with unsupported format" << m_filePath;
+            return false;
+        }
+        stream >> key;
+        if (key != m_key) {
+            qCDebug(LOG_PERFPARSER) << "ignoring stale results cache" << m_filePath;
+            return false;
+        }
+
+        stream >> contents->summary >> contents->symbols >> contents->locations >> contents->events;
+        if (stream.status() != QDataStream::Ok || !buffer.atEnd()) {
+            qCWarning(LOG_PERFPARSER) << "ignoring corrupt results cache" << m_filePath;
+            *contents = {};
+            return false;
+        }
+        return true;
+    }
+
+    bool save(const Contents& contents) const
+    {
+        if (!isValid()) {
+            return false;
+        }
+
+        // write to a temporary file first, such that we never leave a truncated cache behind
+        QSaveFile file(m_filePath);
+        if (!file.open(QIODevice::WriteOnly)) {
+            qCDebug(LOG_PERFPARSER) << "failed to write results cache" << m_filePath << file.errorString();
+            return false;
+        }
+
+        QDataStream stream(&file);
+        stream.setVersion(StreamVersion);
+        stream << Magic << Version << m_key << contents.summary << contents.symbols << contents.locations
+               << contents.events;
+        if (stream.status() != QDataStream::Ok || !file.commit()) {
+            qCDebug(LOG_PERFPARSER) << "failed to write results cache" << m_filePath << file.errorString();
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static const quint32 Magic = 0x48535243; // "HSRC"
+    // bump this whenever the serialized data changes
+    static const quint32 Version = 5;
+    static const QDataStream::Version StreamVersion = QDataStream::Qt_5_7;
+
+    QString m_filePath;
+    QByteArray m_key;
+};
+
+// the filter results of a saved session, stored next to the results cache of the parsed file, such that restoring
+// the session shows its filters right away. they are only valid for the results they got filtered from, which
+// get identified by the same file identity and parser arguments as the results cache, see inputsKey
+class FilterSnapshots
+{
+public:
+    using Snapshot = QPair<Data::FilterAction, FilterResults>;
+
+    FilterSnapshots(const QString& path, const QByteArray& key)
+        : m_filePath(path + QLatin1String(".hotspot-snapshots"))
+        , m_key(key)
+    {
+    }
+
+    // @return the key of the results merged from all @p paths, or an empty key when any of them can't be read
+    static QByteArray inputsKey(const QStringList& paths, const QString& parserBinary,
+                                const QVector<QStringList>& parserArgs, int timeAlignment,
+                                const QVector<qint64>& timeOffsets)
+    {
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        for (int i = 0; i < paths.size(); ++i) {
+            const auto fileKey = ResultsCache::key(paths.at(i), parserBinary, parserArgs.value(i));
+            if (fileKey.isEmpty()) {
+                return {};
+            }
+            hash.addData(fileKey);
+        }
+        // the alignment only changes the merged results when there are multiple files
+        if (paths.size() > 1) {
+            hash.addData(QByteArray::number(timeAlignment));
+            for (auto offset : timeOffsets) {
+                hash.addData(QByteArray::number(offset));
+                hash.addData("\0", 1);
+            }
+        }
+        return hash.result();
+    }
+
+    bool isValid() const
+    {
+        return !m_key.isEmpty();
+    }
+
+    // @return the number of snapshots that got inserted into @p cache
+    int load(const Data::BottomUpResults& bottomUp, const Data::EventResults& events, FilterCache* cache) const
+    {
+        if (!isValid()) {
+            return 0;
+        }
+
+        QFile file(m_filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return 0;
+        }
+
+        QDataStream stream(&file);
+        stream.setVersion(StreamVersion);
+        quint32 magic = 0;
+        quint32 version = 0;
+        QByteArray key;
+        stream >> magic >> version;
+        if (magic != Magic || version != Version) {
+            qCDebug(LOG_PERFPARSER) << "ignoring filter snapshots with unsupported format" << m_filePath;
+            return 0;
+        }
+        stream >> key;
+        if (key != m_key) {
+            qCDebug(LOG_PERFPARSER) << "ignoring stale filter snapshots" << m_filePath;
+            return 0;
+        }
+
+        qint32 numSnapshots = 0;
+        stream >> numSnapshots;
+        int loaded = 0;
+        for (int i = 0; i < numSnapshots && stream.status() == QDataStream::Ok; ++i) {
+            Data::FilterAction filter;
+            FilterResults results;
+            stream >> filter >> results.bottomUp >> results.topDown >> results.callerCallee >> results.events
+                >> results.filterStacks >> results.approximation;
+            if (stream.status() != QDataStream::Ok) {
+                break;
+            }
+            // shared with the unfiltered results, see save
+            results.bottomUp.symbols = bottomUp.symbols;
+            results.bottomUp.locations = bottomUp.locations;
+            results.events.stacks = events.stacks;
+            cache->insert(filter, results);
+            ++loaded;
+        }
+        if (stream.status() != QDataStream::Ok) {
+            qCWarning(LOG_PERFPARSER) << "ignoring corrupt filter snapshots" << m_filePath << "after" << loaded;
+        }
+        return loaded;
+    }
+
+    bool save(const QVector<Snapshot>& snapshots) const
+    {
+        if (!isValid()) {
+            return false;
+        }
+
+        QSaveFile file(m_filePath);
+        if (!file.open(QIODevice::WriteOnly)) {
+            qCWarning(LOG_PERFPARSER) << "failed to write filter snapshots" << m_filePath << file.errorString();
+            return false;
+        }
+
+        QDataStream stream(&file);
+        stream.setVersion(StreamVersion);
+        stream << Magic << Version << m_key << static_cast<qint32>(snapshots.size());
+        for (const auto& snapshot : snapshots) {
+            const auto& results = snapshot.second;
+            // the symbols, locations and stacks never change when filtering, they are part of the results cache
+            auto events = results.events;
+            events.stacks = {};
+            stream << snapshot.first << results.bottomUp << results.topDown << results.callerCallee << events
+                   << results.filterStacks << results.approximation;
+        }
+        if (stream.status() != QDataStream::Ok || !file.commit()) {
+            qCWarning(LOG_PERFPARSER) << "failed to write filter snapshots" << m_filePath << file.errorString();
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static const quint32 Magic = 0x48535353; // "HSSS"
+    // bump this whenever the serialized data changes
+    static const quint32 Version = 2;
+    static const QDataStream::Version StreamVersion = QDataStream::Qt_5_7;
+
+    QString m_filePath;
+    QByteArray m_key;
+};
+
+namespace {
+// @return the time of the first thread or tracepoint of @p events, or MAX_TIME when there are none
+quint64 startTime(const Data::EventResults& events)
+{
+    auto ret = Data::MAX_TIME;
+    for (const auto& thread : events.threads) {
+        if (thread.time.start) {
+            ret = std::min(ret, thread.time.start);
+        }
+    }
+    for (const auto& tracepoint : events.tracepoints) {
+        if (!tracepoint.times.isEmpty()) {
+            ret = std::min(ret, tracepoint.times.first());
+        }
+    }
+    return ret;
+}
+
+// @return @p time shifted by @p offset, the special values for unknown times are kept as they are
+quint64 shiftTime(quint64 time, qint64 offset)
+{
+    if (!time || time == Data::MAX_TIME) {
+        return time;
+    } else if (offset < 0 && time <= static_cast<quint64>(-offset)) {
+        return 1;
+    }
+    return time + offset;
+}
+
+// merge the results of several files into one, as if all their events got recorded into a single file.
+// every file gets its own range of location, stack and CPU ids, its threads are tagged with the file id.
+// the cost types are matched by their label, such that e.g. the cycles of all files add up.
+// the events are moved out of @p contents and get remapped in place, their times get aligned as described by
+// PerfParser::setTimeAlignment
+ResultsCache::Contents mergeContents(const QStringList& paths, QVector<ResultsCache::Contents>* contents,
+                                     PerfParser::TimeAlignment alignment, const QVector<qint64>& timeOffsets)
+{
+    ResultsCache::Contents merged;
+    auto& summary = merged.summary;
+    auto& events = merged.events;
+    events.files = paths;
+
+    auto findCost = [](QVector<Data::CostSummary>* costs, const QString& label) {
+        return std::find_if(costs->begin(), costs->end(),
+                            [&label](const Data::CostSummary& cost) { return cost.label == label; });
+    };
+    auto addCost = [&findCost](QVector<Data::CostSummary>* costs, const Data::CostSummary& cost) -> int {
+        auto it = findCost(costs, cost.label);
+        if (it == costs->end()) {
+            costs->push_back(cost);
+            return costs->size() - 1;
+        }
+        it->sampleCount += cost.sampleCount;
+        it->totalPeriod += cost.totalPeriod;
+        return static_cast<int>(std::distance(costs->begin(), it));
+    };
+
+    QStringList commands;
+    QStringList hostNames;
+    QStringList kernelVersions;
+    QStringList perfVersions;
+    QStringList cpuDescriptions;
+    QStringList cpuArchitectures;
+    auto addUnique = [](QStringList* list, const QString& value) {
+        if (!value.isEmpty() && !list->contains(value)) {
+            list->append(value);
+        }
+    };
+
+    auto firstStart = Data::MAX_TIME;
+    for (const auto& file : *contents) {
+        firstStart = std::min(firstStart, startTime(file.events));
+    }
+
+    for (int fileId = 0, numFiles = contents->size(); fileId < numFiles; ++fileId) {
+        auto& file = (*contents)[fileId];
+
+        qint64 timeOffset = timeOffsets.value(fileId);
+        const auto fileStart = startTime(file.events);
+        if (alignment == PerfParser::TimeAlignment::Start && fileStart != Data::MAX_TIME) {
+            timeOffset -= static_cast<qint64>(fileStart - firstStart);
+        }
+
+        // the symbols are indexed by the location id, so both get the same offset
+        const qint32 locationOffset = merged.locations.size();
+        merged.locations.reserve(locationOffset + file.locations.size());
+        for (auto location : file.locations) {
+            if (location.parentLocationId != -1) {
+                location.parentLocationId += locationOffset;
+            }
+            merged.locations.push_back(location);
+        }
+        merged.symbols.resize(locationOffset);
+        merged.symbols += file.symbols;
+
+        const qint32 stackOffset = events.stacks.size();
+        events.stacks.reserve(stackOffset + file.events.stacks.size());
+        for (auto stack : file.events.stacks) {
+            for (auto& frame : stack) {
+                frame += locationOffset;
+            }
+            events.stacks.push_back(stack);
+        }
+
+        QVector<qint32> typeMap;
+        typeMap.reserve(file.events.totalCosts.size());
+        for (const auto& cost : file.events.totalCosts) {
+            typeMap.push_back(addCost(&events.totalCosts, cost));
+        }
+        if (events.offCpuTimeCostId == -1 && file.events.offCpuTimeCostId != -1) {
+            events.offCpuTimeCostId = typeMap.value(file.events.offCpuTimeCostId, -1);
+        }
+
+        // the CPUs of different hosts are different CPUs, keep them apart
+        const quint32 cpuOffset = events.numCpus;
+        auto remapEvent = [&](Data::Event* event) {
+            event->time = shiftTime(event->time, timeOffset);
+            if (event->type >= 0) {
+                event->type = typeMap.value(event->type, -1);
+            }
+            if (event->stackId >= 0) {
+                event->stackId += stackOffset;
+            }
+            if (event->cpuId != Data::INVALID_CPU_ID) {
+                event->cpuId += cpuOffset;
+            }
+        };
+
+        events.numCpus += file.events.numCpus;
+        if (!file.events.cpuNumaNodes.isEmpty()) {
+            // the NUMA nodes of different hosts are different too
+            qint32 nodeOffset = 0;
+            for (auto node : events.cpuNumaNodes) {
+                nodeOffset = std::max(nodeOffset, node + 1);
+            }
+            while (static_cast<quint32>(events.cpuNumaNodes.size()) < cpuOffset) {
+                events.cpuNumaNodes.push_back(-1);
+            }
+            for (auto node : file.events.cpuNumaNodes) {
+                events.cpuNumaNodes.push_back(node == -1 ? -1 : node + nodeOffset);
+            }
+        }
+        for (auto& thread : file.events.threads) {
+            thread.fileId = fileId;
+            thread.events.transform(remapEvent);
+            thread.time = {shiftTime(thread.time.start, timeOffset), shiftTime(thread.time.end, timeOffset)};
+            thread.lastSwitchTime = shiftTime(thread.lastSwitchTime, timeOffset);
+            events.threads.push_back(std::move(thread));
+        }
+        file.events.threads.clear();
+        for (auto& tracepoint : file.events.tracepoints) {
+            tracepoint.fileId = fileId;
+            if (timeOffset) {
+                for (auto& time : tracepoint.times) {
+                    time = shiftTime(time, timeOffset);
+                }
+            }
+            events.tracepoints.push_back(std::move(tracepoint));
+        }
+        file.events.tracepoints.clear();
+        // the tracks are indexed by the CPU id, which gets shifted like the one of the events
+        if (!file.events.contextSwitches.isEmpty()) {
+            events.contextSwitches.resize(static_cast<int>(cpuOffset));
+            for (auto& track : file.events.contextSwitches) {
+                track.fileId = fileId;
+                if (timeOffset) {
+                    for (auto& time : track.times) {
+                        time = shiftTime(time, timeOffset);
+                    }
+                }
+                events.contextSwitches.push_back(std::move(track));
+            }
+            file.events.contextSwitches.clear();
+        }
+
+        const auto& fileSummary = file.summary;
+        summary.applicationRunningTime = std::max(summary.applicationRunningTime, fileSummary.applicationRunningTime);
+        summary.threadCount += fileSummary.threadCount;
+        summary.processCount += fileSummary.processCount;
+        summary.lostChunks += fileSummary.lostChunks;
+        summary.cpusOnline += fileSummary.cpusOnline;
+        summary.cpusAvailable += fileSummary.cpusAvailable;
+        summary.totalMemoryInKiB += fileSummary.totalMemoryInKiB;
+        summary.onCpuTime += fileSummary.onCpuTime;
+        summary.offCpuTime += fileSummary.offCpuTime;
+        summary.sampleCount += fileSummary.sampleCount;
+        // the files get parsed in parallel, their merged events get aggregated once more afterwards
+        summary.stageTimes.parsing = std::max(summary.stageTimes.parsing, fileSummary.stageTimes.total());
+        for (const auto& cost : fileSummary.costs) {
+            addCost(&summary.costs, cost);
+        }
+        addUnique(&commands, fileSummary.command);
+        addUnique(&hostNames, fileSummary.hostName);
+        addUnique(&kernelVersions, fileSummary.linuxKernelVersion);
+        addUnique(&perfVersions, fileSummary.perfVersion);
+        addUnique(&cpuDescriptions, fileSummary.cpuDescription);
+        addUnique(&cpuArchitectures, fileSummary.cpuArchitecture);
+        if (fileId == 0) {
+            // the topology can't be combined in any meaningful way, stick to the first file
+            summary.cpuId = fileSummary.cpuId;
+            summary.cpuSiblingCores = fileSummary.cpuSiblingCores;
+            summary.cpuSiblingThreads = fileSummary.cpuSiblingThreads;
+        }
+        const auto fileName = QFileInfo(paths.value(fileId)).fileName();
+        for (const auto& error : fileSummary.errors) {
+            summary.errors.append(QStringLiteral("%1: %2").arg(fileName, error));
+        }
+    }
+
+    const auto separator = QStringLiteral(", ");
+    summary.command = commands.join(separator);
+    summary.hostName = hostNames.join(separator);
+    summary.linuxKernelVersion = kernelVersions.join(separator);
+    summary.perfVersion = perfVersions.join(separator);
+    summary.cpuDescription = cpuDescriptions.join(separator);
+    summary.cpuArchitecture = cpuArchitectures.join(separator);
+    return merged;
+}
+
+// parse all @p paths at once, each file gets its own perfparser process and they run with one per core.
+// @return the error of the first file that couldn't be parsed, or an empty string on success
+QString parseFiles(PerfParser* parser, const std::atomic<bool>& stopRequested, const QStringList& paths,
+                   const QString& parserBinary, const QVector<QStringList>& parserArgs,
+                   PerfParser::ResultsCacheMode cacheMode, const PerfParser::ParseOptions& options,
+                   QVector<ResultsCache::Contents>* contents, PerfScriptWriter* scriptWriter = nullptr)
+{
+    const int numFiles = paths.size();
+    contents->resize(numFiles);
+    QVector<QString> errors(numFiles);
+    auto* fileContents = contents->data();
+    auto* fileErrors = errors.data();
+
+    QMutex progressMutex;
+    QVector<float> fileProgress(numFiles, 0);
+    auto reportProgress = [&](int fileId, float percent) {
+        QMutexLocker locker(&progressMutex);
+        fileProgress[fileId] = percent;
+        emit parser->progress(std::accumulate(fileProgress.begin(), fileProgress.end(), 0.f) / numFiles);
+    };
+
+    // the script output is only generated while parsing
+    const bool canUseCache = cacheMode == PerfParser::ResultsCacheMode::Use && !scriptWriter;
+
+    // like in PerfParser::startParseFile, but collecting the results of the file instead of emitting them
+    auto parseFile = [&](int fileId) {
+        ResultsCache resultsCache;
+        if (cacheMode != PerfParser::ResultsCacheMode::Ignore) {
+            resultsCache = ResultsCache(paths.at(fileId), parserBinary, parserArgs.at(fileId));
+        }
+        if (canUseCache && resultsCache.load(&fileContents[fileId])) {
+            qCDebug(LOG_PERFPARSER) << "using cached results from" << resultsCache.filePath();
+            reportProgress(fileId, 1);
+            return;
+        }
+
+        PerfParserPrivate d(options);
+        // the results of a single file are never shown on their own, so don't bother with partial results
+        d.partialResultsInterval = 0;
+        if (scriptWriter) {
+            // the chunks of the files get interleaved, but each of them only contains complete samples
+            d.scriptOutput.reset(new PerfScriptBuffer(scriptWriter));
+        }
+        QObject::connect(&d, &PerfParserPrivate::progress, &d,
+                         [&reportProgress, fileId](float percent) { reportProgress(fileId, percent); });
+        QObject::connect(parser, &PerfParser::stopRequested, &d, &PerfParserPrivate::stop);
+
+        QObject::connect(&d.process, &QProcess::readyRead, &d.process, [&d] { d.tryParse(); });
+
+        QObject::connect(
+            &d.process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), &d.process,
+            [&, fileId](int exitCode, QProcess::ExitStatus exitStatus) {
+                if (stopRequested) {
+                    return;
+                }
+                qCDebug(LOG_PERFPARSER) << paths.at(fileId) << exitCode << exitStatus;
+
+                fileErrors[fileId] = parserExitError(exitCode);
+                if (!fileErrors[fileId].isEmpty()) {
+                    return;
+                }
+
+                // consume any data that arrived after the last readyRead notification
+                d.tryParse();
+                d.finalize();
+                auto& result = fileContents[fileId];
+                result = {d.summaryResult, d.bottomUpResult.symbols, d.bottomUpResult.locations, d.eventResult};
+                if (!d.droppedEvents) {
+                    resultsCache.save(result);
+                }
+            });
+
+        QObject::connect(&d.process, &QProcess::errorOccurred, &d.process,
+                         [&, fileId](QProcess::ProcessError error) {
+                             if (stopRequested) {
+                                 return;
+                             }
+
+                             qCWarning(LOG_PERFPARSER) << paths.at(fileId) << error << d.process.errorString();
+
+                             fileErrors[fileId] = d.process.errorString();
+                         });
+
+        QProcess decompressor;
+        const auto decompression = decompressionCommand(paths.at(fileId));
+        if (!decompression.isEmpty()) {
+            fileErrors[fileId] = startDecompression(&decompressor, &d.process, decompression);
+            if (!fileErrors[fileId].isEmpty()) {
+                return;
+            }
+        }
+
+        d.process.start(parserBinary, parserArgs.at(fileId));
+        if (!d.process.waitForStarted()) {
+            fileErrors[fileId] = PerfParser::tr("Failed to start the hotspot-perfparser process");
+            return;
+        }
+
+        // includes the time spent in tryParse, the remainder is spent waiting for hotspot-perfparser
+        Instrumentation::ScopedTimer instrumentation("hotspot-perfparser");
+        QEventLoop loop;
+        QObject::connect(&d.process,
+                         static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), &loop,
+                         &QEventLoop::quit);
+        loop.exec();
+    };
+
+    // every file gets its own perfparser process, run as many of them at once as we have cores
+    Util::parallelFor(numFiles,
+                      [&](int begin, int end) {
+                          for (int i = begin; i < end && !stopRequested; ++i) {
+                              parseFile(i);
+                          }
+                      },
+                      1);
+
+    for (int i = 0; i < numFiles; ++i) {
+        if (!errors.at(i).isEmpty()) {
+            return PerfParser::tr("Failed to parse '%1': %2").arg(paths.at(i), errors.at(i));
+        }
+    }
+    return {};
+}
+
+// the per-event checks of a filter, the time range is handled separately by a binary search on the sorted events
+struct EventFilter
+{
+    quint32 cpuId = Data::INVALID_CPU_ID;
+    // one bit per excluded CPU id
+    QBitArray excludedCpus;
+    // indexed by the stack id, empty when the symbol filters don't apply
+    QVector<bool> includedStacks;
+};
+
+// specialized for every combination of the checks, such that the inactive ones get compiled out of the loop
+// over the events, which then only reads the columns it needs
+template<bool filterByCpu, bool excludeByCpu, bool filterByStack>
+void removeFilteredEvents(Data::Events* events, const EventFilter& filter)
+{
+    const auto cpuId = filter.cpuId;
+    const auto& excludedCpus = filter.excludedCpus;
+    const auto numExcludedCpus = static_cast<quint32>(excludedCpus.size());
+    const auto* stackIncluded = filter.includedStacks.constData();
+    events->removeIfAt([=, &excludedCpus](int i) -> bool {
+        if (filterByCpu || excludeByCpu) {
+            const auto eventCpuId = events->cpuId(i);
+            if (filterByCpu && eventCpuId != cpuId) {
+                return true;
+            } else if (excludeByCpu && eventCpuId < numExcludedCpus && excludedCpus.testBit(eventCpuId)) {
+                return true;
+            }
+        }
+        return filterByStack && !stackIncluded[events->stackId(i)];
+    });
+}
+
+using EventFilterKernel = void (*)(Data::Events* events, const EventFilter& filter);
+
+// @return the kernel for the given combination of checks, or nullptr when none of them is active
+EventFilterKernel eventFilterKernel(bool filterByCpu, bool excludeByCpu, bool filterByStack)
+{
+    static const EventFilterKernel kernels[] = {
+        nullptr,
+        removeFilteredEvents<false, false, true>,
+        removeFilteredEvents<false, true, false>,
+        removeFilteredEvents<false, true, true>,
+        removeFilteredEvents<true, false, false>,
+        removeFilteredEvents<true, false, true>,
+        removeFilteredEvents<true, true, false>,
+        removeFilteredEvents<true, true, true>,
+    };
+    return kernels[(filterByCpu ? 4 : 0) | (excludeByCpu ? 2 : 0) | (filterByStack ? 1 : 0)];
+}
+}
+
+PerfParser::PerfParser(QObject* parent)
+    : QObject(parent)
+    , m_filterCache(new FilterCache)
+    , m_filterOutcomes(new FilterOutcomes)
+    , m_parseOptions(ParseOptions::fromEnvironment())
+    , m_isParsing(false)
+    , m_stopRequested(false)
+{
+    if (qEnvironmentVariableIntValue("HOTSPOT_GENERATE_SCRIPT_OUTPUT")) {
+        m_scriptOutput = QStringLiteral("-");
+    }
+
+    // set data via signal/slot connection to ensure we don't introduce a data race
+    connect(this, &PerfParser::bottomUpDataAvailable, this, [this](const Data::BottomUpResults& data) {
+        if (m_bottomUpResults.root.children.isEmpty()) {
+            m_bottomUpResults = data;
+        }
+    });
+    connect(this, &PerfParser::callerCalleeDataAvailable, this, [this](const Data::CallerCalleeResults& data) {
+        if (m_callerCalleeResults.entries.isEmpty()) {
+            m_callerCalleeResults = data;
+        }
+    });
+    connect(this, &PerfParser::eventsAvailable, this, [this](const Data::EventResults& data) {
+        if (m_events.threads.isEmpty()) {
+            m_events = data;
+            m_threadIndex = Data::ThreadIntervalIndex(m_events.threads);
+        }
+    });
+    connect(this, &PerfParser::parsingStarted, this, [this]() {
+        m_isParsing = true;
+        m_stopRequested = false;
+    });
+    connect(this, &PerfParser::parsingFailed, this, [this]() { m_isParsing = false; });
+    connect(this, &PerfParser::parsingFinished, this, [this]() {
+        m_isParsing = false;
+        Instrumentation::dump();
+    });
+}
 
-    auto parserBinary = QString::fromLocal8Bit(qgetenv("HOTSPOT_PERFPARSER"));
-    if (parserBinary.isEmpty()) {
-        parserBinary = Util::findLibexecBinary(QStringLiteral("hotspot-perfparser"));
-    }
-    if (parserBinary.isEmpty()) {
-        emit parsingFailed(tr("Failed to find hotspot-perfparser binary."));
-        return;
+PerfParser::~PerfParser() = default;
+
+PerfParser::ParseOptions PerfParser::ParseOptions::fromEnvironment()
+{
+    ParseOptions options;
+    options.eventRetentionSeconds = std::max(0, qEnvironmentVariableIntValue("HOTSPOT_EVENT_RETENTION_S"));
+    options.maxEventsPerThread = std::max(0, qEnvironmentVariableIntValue("HOTSPOT_EVENT_RETENTION_PER_THREAD"));
+    options.memoryBudgetMB = std::max(0, qEnvironmentVariableIntValue("HOTSPOT_MEMORY_BUDGET_MB"));
+    bool ok = false;
+    const auto interval = qEnvironmentVariableIntValue("HOTSPOT_PARTIAL_RESULTS_INTERVAL_MS", &ok);
+    if (ok) {
+        options.partialResultsIntervalMs = std::max(0, interval);
     }
+    options.ingestTopDown = qEnvironmentVariableIntValue("HOTSPOT_INGEST_TOP_DOWN") > 0;
+    options.aggregationThreads = std::max(0, qEnvironmentVariableIntValue("HOTSPOT_AGGREGATION_THREADS"));
+    return options;
+}
 
-    QStringList parserArgs = {QStringLiteral("--input"), path, QStringLiteral("--max-frames"), QStringLiteral("1024")};
-    if (!sysroot.isEmpty()) {
-        parserArgs += {QStringLiteral("--sysroot"), sysroot};
+void PerfParser::setParseOptions(const ParseOptions& options)
+{
+    m_parseOptions = options;
+}
+
+PerfParser::ParseOptions PerfParser::parseOptions() const
+{
+    return m_parseOptions;
+}
+
+void PerfParser::setScriptOutput(const QString& path)
+{
+    m_scriptOutput = path;
+}
+
+void PerfParser::setTimeAlignment(TimeAlignment alignment, const QVector<qint64>& offsets)
+{
+    m_timeAlignment = alignment;
+    m_timeOffsets = offsets;
+}
+
+void PerfParser::clearResults()
+{
+    // reset the data to ensure filtering will pick up the new data
+    m_bottomUpResults = {};
+    m_callerCalleeResults = {};
+    m_events = {};
+    m_threadIndex = {};
+    m_lastFilter = {};
+    m_lastFilteredEvents = {};
+    m_lastFilteredStacks = {};
+    for (auto& stacks : m_collapsedStacks) {
+        stacks = {};
     }
-    if (!kallsyms.isEmpty()) {
-        parserArgs += {QStringLiteral("--kallsyms"), kallsyms};
+    m_filterCache->clear();
+    m_snapshotsInputs = {};
+    // the pages still show the previous results, their symbols only get released once those got replaced too
+    const auto releasedSymbols = Data::releaseUnusedSymbols();
+    qCDebug(LOG_PERFPARSER) << "released" << releasedSymbols << "unused symbols";
+}
+
+void PerfParser::emitAggregatedResults(const Data::Summary& summary, const QVector<Data::Symbol>& symbols,
+                                       const QVector<Data::FrameLocation>& locations, const Data::EventResults& events)
+{
+    // the events are complete already, only the remaining stages are left to do
+    Data::ParseProgress progress;
+    progress.fraction = 1;
+    for (const auto& thread : events.threads) {
+        progress.events += thread.events.size();
     }
-    if (!debugPaths.isEmpty()) {
-        parserArgs += {QStringLiteral("--debug"), debugPaths};
+    progress.samples = summary.sampleCount;
+    QElapsedTimer timer;
+    timer.start();
+    auto nextStage = [this, &progress, &timer](Data::ParseProgress::Stage stage) -> quint64 {
+        const auto elapsed = timer.nsecsElapsed();
+        timer.restart();
+        progress.stage = stage;
+        progress.elapsed += elapsed;
+        emit parseProgress(progress);
+        return elapsed;
+    };
+    nextStage(Data::ParseProgress::Stage::Aggregation);
+    auto stageTimes = summary.stageTimes;
+
+    Data::BottomUpResults bottomUp;
+    Data::CallerCalleeResults callerCallee;
+    aggregateResults(summary, symbols, locations, events, &bottomUp, nullptr);
+    stageTimes.aggregation = nextStage(Data::ParseProgress::Stage::CallerCallee);
+    Data::callerCalleesFromBottomUpData(bottomUp, &callerCallee);
+    stageTimes.callerCallee = nextStage(Data::ParseProgress::Stage::TopDown);
+
+    if (m_stopRequested) {
+        emit parsingFailed(tr("Parsing stopped."));
+        return;
     }
-    if (!extraLibPaths.isEmpty()) {
-        parserArgs += {QStringLiteral("--extra"), extraLibPaths};
+
+    const auto topDown = Data::TopDownResults::fromBottomUp(bottomUp);
+    stageTimes.topDown = timer.nsecsElapsed();
+    auto summaryWithMemoryUsage = summary;
+    summaryWithMemoryUsage.memoryUsage = Data::memoryUsage(bottomUp, topDown, callerCallee, events);
+    summaryWithMemoryUsage.stageTimes = stageTimes;
+
+    emit bottomUpDataAvailable(bottomUp);
+    emit topDownDataAvailable(topDown);
+    emit summaryDataAvailable(summaryWithMemoryUsage);
+    emit callerCalleeDataAvailable(callerCallee);
+    emit eventsAvailable(events);
+    emit parsingFinished();
+}
+
+void PerfParser::startParseFile(const QString& path, const QString& sysroot, const QString& kallsyms,
+                                const QString& debugPaths, const QString& extraLibPaths, const QString& appPath,
+                                const QString& arch, ResultsCacheMode cacheMode)
+{
+    Q_ASSERT(!m_isParsing);
+
+    const auto error = inputFileError(path, true);
+    if (!error.isEmpty()) {
+        emit parsingFailed(error);
+        return;
     }
-    if (!appPath.isEmpty()) {
-        parserArgs += {QStringLiteral("--app"), appPath};
+    // a named pipe gets fed by perf record directly, the results are updated live while recording
+    const bool isLive = Util::isFifo(path);
+    if (isLive) {
+        cacheMode = ResultsCacheMode::Ignore;
     }
-    if (!arch.isEmpty()) {
-        parserArgs += {QStringLiteral("--arch"), arch};
+
+    const auto parserBinary = findParserBinary();
+    if (parserBinary.isEmpty()) {
+        emit parsingFailed(tr("Failed to find hotspot-perfparser binary."));
+        return;
     }
 
-    // reset the data to ensure filtering will pick up the new data
-    m_bottomUpResults = {};
-    m_callerCalleeResults = {};
-    m_events = {};
+    const auto parserArgs = parserArguments(path, sysroot, kallsyms, debugPaths, extraLibPaths, appPath, arch);
+
+    clearResults();
+    if (!isLive) {
+        m_snapshotsInputs.paths = QStringList{path};
+        m_snapshotsInputs.parserBinary = parserBinary;
+        m_snapshotsInputs.parserArgs = {parserArgs};
+    }
 
     emit parsingStarted();
+    // the header is read straight from the file, long before the parser process gets to the features
+    PerfHeader::Info header;
+    if (!isLive && PerfHeader::read(path, &header)) {
+        emit headerDataAvailable(header);
+    }
     using namespace ThreadWeaver;
-    stream() << make_job([parserBinary, parserArgs, this]() {
-        PerfParserPrivate d;
-        connect(&d, &PerfParserPrivate::progress, this, &PerfParser::progress);
-        connect(this, &PerfParser::stopRequested, &d, &PerfParserPrivate::stop);
+    const auto scriptOutput = m_scriptOutput;
+    const auto options = m_parseOptions;
+    stream() << make_job([path, parserBinary, parserArgs, cacheMode, isLive, scriptOutput, options, this]() {
+        ResultsCache resultsCache;
+        if (cacheMode != ResultsCacheMode::Ignore) {
+            resultsCache = ResultsCache(path, parserBinary, parserArgs);
+        }
+
+        // the script output is only generated while parsing
+        const bool canUseCache = cacheMode == ResultsCacheMode::Use && scriptOutput.isEmpty();
+        ResultsCache::Contents cached;
+        if (canUseCache && resultsCache.load(&cached)) {
+            qCDebug(LOG_PERFPARSER) << "using cached results from" << resultsCache.filePath();
+
+            emitAggregatedResults(cached.summary, cached.symbols, cached.locations, cached.events);
+            return;
+        }
+
+        // must outlive the parser, which hands over its last samples when it gets destroyed
+        std::unique_ptr<PerfScriptWriter> scriptWriter;
+        if (!scriptOutput.isEmpty()) {
+            scriptWriter.reset(new PerfScriptWriter(scriptOutput));
+            if (!scriptWriter->isOpen()) {
+                emit parsingFailed(tr("Failed to write the script output to %1: %2")
+                                       .arg(scriptOutput, scriptWriter->finish()));
+                return;
+            }
+        }
 
-        connect(&d.process, &QProcess::readyRead, &d.process, [&d] {
-            while (d.tryParse()) {
-                // just call tryParse until it fails
+        PerfParserPrivate d(options);
+        if (scriptWriter) {
+            d.scriptOutput.reset(new PerfScriptBuffer(scriptWriter.get()));
+        }
+        connect(&d, &PerfParserPrivate::progress, this, &PerfParser::progress);
+        connect(&d, &PerfParserPrivate::parseProgress, this, &PerfParser::parseProgress);
+        // these get delivered on our thread, so stale partial results don't show up anymore after a stop
+        connect(&d, &PerfParserPrivate::partialBottomUpDataAvailable, this,
+                [this](const Data::BottomUpResults& data) {
+                    if (!m_stopRequested) {
+                        emit partialBottomUpDataAvailable(data);
+                    }
+                });
+        connect(&d, &PerfParserPrivate::partialTopDownDataAvailable, this, [this](const Data::TopDownResults& data) {
+            if (!m_stopRequested) {
+                emit partialTopDownDataAvailable(data);
+            }
+        });
+        connect(&d, &PerfParserPrivate::partialEventsAvailable, this, [this](const Data::EventResults& data) {
+            if (!m_stopRequested) {
+                emit partialEventsAvailable(data);
             }
         });
+        d.setLive(isLive);
+        if (!isLive) {
+            d.setInputSize(QFileInfo(path).size());
+        }
+        connect(this, &PerfParser::stopRequested, &d, &PerfParserPrivate::stop);
+
+        connect(&d.process, &QProcess::readyRead, &d.process, [&d] { d.tryParse(); });
 
         connect(&d.process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), &d.process,
-                [&d, this](int exitCode, QProcess::ExitStatus exitStatus) {
+                [&d, &resultsCache, &scriptWriter, this](int exitCode, QProcess::ExitStatus exitStatus) {
                     if (m_stopRequested) {
                         emit parsingFailed(tr("Parsing stopped."));
                         return;
                     }
                     qCDebug(LOG_PERFPARSER) << exitCode << exitStatus;
 
-                    enum ErrorCodes
-                    {
-                        NoError,
-                        TcpSocketError,
-                        CannotOpen,
-                        BadMagic,
-                        HeaderError,
-                        DataError,
-                        MissingData,
-                        InvalidOption
-                    };
-                    switch (exitCode) {
-                    case NoError:
-                        d.finalize();
-                        emit bottomUpDataAvailable(d.bottomUpResult);
-                        emit topDownDataAvailable(d.topDownResult);
-                        emit summaryDataAvailable(d.summaryResult);
-                        emit callerCalleeDataAvailable(d.callerCalleeResult);
-                        emit eventsAvailable(d.eventResult);
-                        emit parsingFinished();
-                        break;
-                    case TcpSocketError:
-                        emit parsingFailed(
-                            tr("The hotspot-perfparser binary exited with code %1 (TCP socket error).").arg(exitCode));
-                        break;
-                    case CannotOpen:
-                        emit parsingFailed(
-                            tr("The hotspot-perfparser binary exited with code %1 (file could not be opened).")
-                                .arg(exitCode));
-                        break;
-                    case BadMagic:
-                    case HeaderError:
-                    case DataError:
-                    case MissingData:
-                        emit parsingFailed(
-                            tr("The hotspot-perfparser binary exited with code %1 (invalid perf data file).")
-                                .arg(exitCode));
-                        break;
-                    case InvalidOption:
-                        emit parsingFailed(
-                            tr("The hotspot-perfparser binary exited with code %1 (invalid option).").arg(exitCode));
-                        break;
-                    default:
-                        emit parsingFailed(tr("The hotspot-perfparser binary exited with code %1.").arg(exitCode));
-                        break;
+                    const auto error = parserExitError(exitCode);
+                    if (!error.isEmpty()) {
+                        emit parsingFailed(error);
+                        return;
+                    }
+
+                    // consume any data that arrived after the last readyRead notification
+                    d.tryParse();
+                    d.finalize();
+                    if (scriptWriter) {
+                        // the script output must be complete once we report the parse as finished
+                        const auto error = scriptWriter->finish();
+                        if (!error.isEmpty()) {
+                            emit parsingFailed(tr("Failed to write the script output: %1").arg(error));
+                            return;
+                        }
+                    }
+                    emit bottomUpDataAvailable(d.bottomUpResult);
+                    emit topDownDataAvailable(d.topDownResult);
+                    emit summaryDataAvailable(d.summaryResult);
+                    emit callerCalleeDataAvailable(d.callerCalleeResult);
+                    emit eventsAvailable(d.eventResult);
+                    // the aggregates could not be rebuilt from an incomplete set of events
+                    if (!d.droppedEvents) {
+                        resultsCache.save({d.summaryResult, d.bottomUpResult.symbols, d.bottomUpResult.locations,
+                                           d.eventResult});
                     }
+                    emit parsingFinished();
                 });
 
         connect(&d.process, &QProcess::errorOccurred, &d.process, [&d, this](QProcess::ProcessError error) {
@@ -1353,6 +3654,23 @@ void PerfParser::startParseFile(const QString& path, const QString& sysroot, con
             emit parsingFailed(d.process.errorString());
         });
 
+        // hotspot-perfparser inherits the affinity of this thread, which keeps both ends of the pipe on one NUMA
+        // node. the job runs on a thread of the pool, so its affinity gets restored once the parse is done
+        CpuTopology::ScopedAffinity affinity;
+        if (CpuTopology::isPinningEnabled()) {
+            CpuTopology::setThreadAffinity(CpuTopology::numaNodes().at(CpuTopology::currentNode()));
+        }
+
+        QProcess decompressor;
+        const auto decompression = decompressionCommand(path);
+        if (!decompression.isEmpty()) {
+            const auto error = startDecompression(&decompressor, &d.process, decompression);
+            if (!error.isEmpty()) {
+                emit parsingFailed(error);
+                return;
+            }
+        }
+
         d.process.start(parserBinary, parserArgs);
         if (!d.process.waitForStarted()) {
             emit parsingFailed(tr("Failed to start the hotspot-perfparser process"));
@@ -1366,16 +3684,229 @@ void PerfParser::startParseFile(const QString& path, const QString& sysroot, con
     });
 }
 
-void PerfParser::filterResults(const Data::FilterAction& filter)
+void PerfParser::startParseFiles(const QStringList& paths, const QString& sysroot, const QString& kallsyms,
+                                 const QString& debugPaths, const QString& extraLibPaths, const QString& appPath,
+                                 const QString& arch, ResultsCacheMode cacheMode)
+{
+    Q_ASSERT(!m_isParsing);
+
+    if (paths.size() == 1) {
+        startParseFile(paths.first(), sysroot, kallsyms, debugPaths, extraLibPaths, appPath, arch, cacheMode);
+        return;
+    }
+
+    QString parserBinary;
+    QVector<QStringList> parserArgs;
+    if (!prepareParseFiles(paths, sysroot, kallsyms, debugPaths, extraLibPaths, appPath, arch, &parserBinary,
+                           &parserArgs)) {
+        return;
+    }
+    // the merged results belong to all files, but a single set of snapshots next to the first one is enough
+    m_snapshotsInputs.paths = paths;
+    m_snapshotsInputs.parserBinary = parserBinary;
+    m_snapshotsInputs.parserArgs = parserArgs;
+    m_snapshotsInputs.timeAlignment = m_timeAlignment;
+    m_snapshotsInputs.timeOffsets = m_timeOffsets;
+
+    emit parsingStarted();
+    using namespace ThreadWeaver;
+    const auto scriptOutput = m_scriptOutput;
+    const auto timeAlignment = m_timeAlignment;
+    const auto timeOffsets = m_timeOffsets;
+    const auto options = m_parseOptions;
+    stream() << make_job([paths, parserBinary, parserArgs, cacheMode, scriptOutput, timeAlignment, timeOffsets,
+                          options, this]() {
+        std::unique_ptr<PerfScriptWriter> scriptWriter;
+        if (!scriptOutput.isEmpty()) {
+            scriptWriter.reset(new PerfScriptWriter(scriptOutput));
+            if (!scriptWriter->isOpen()) {
+                emit parsingFailed(tr("Failed to write the script output to %1: %2")
+                                       .arg(scriptOutput, scriptWriter->finish()));
+                return;
+            }
+        }
+
+        QVector<ResultsCache::Contents> contents;
+        auto error = parseFiles(this, m_stopRequested, paths, parserBinary, parserArgs, cacheMode, options, &contents,
+                                scriptWriter.get());
+        if (scriptWriter && error.isEmpty()) {
+            const auto scriptError = scriptWriter->finish();
+            if (!scriptError.isEmpty()) {
+                error = tr("Failed to write the script output: %1").arg(scriptError);
+            }
+        }
+        if (m_stopRequested) {
+            emit parsingFailed(tr("Parsing stopped."));
+            return;
+        } else if (!error.isEmpty()) {
+            emit parsingFailed(error);
+            return;
+        }
+
+        const auto merged = mergeContents(paths, &contents, timeAlignment, timeOffsets);
+        contents = {};
+        emitAggregatedResults(merged.summary, merged.symbols, merged.locations, merged.events);
+    });
+}
+
+void PerfParser::startDiffFiles(const QString& baselinePath, const QString& candidatePath, const QString& sysroot,
+                                const QString& kallsyms, const QString& debugPaths, const QString& extraLibPaths,
+                                const QString& appPath, const QString& arch, ResultsCacheMode cacheMode)
 {
     Q_ASSERT(!m_isParsing);
 
+    const QStringList paths = {baselinePath, candidatePath};
+    QString parserBinary;
+    QVector<QStringList> parserArgs;
+    if (!prepareParseFiles(paths, sysroot, kallsyms, debugPaths, extraLibPaths, appPath, arch, &parserBinary,
+                           &parserArgs)) {
+        return;
+    }
+
     emit parsingStarted();
     using namespace ThreadWeaver;
-    stream() << make_job([this, filter]() {
+    const auto options = m_parseOptions;
+    stream() << make_job([paths, parserBinary, parserArgs, cacheMode, options, this]() {
+        QVector<ResultsCache::Contents> contents;
+        const auto error =
+            parseFiles(this, m_stopRequested, paths, parserBinary, parserArgs, cacheMode, options, &contents);
+        if (m_stopRequested) {
+            emit parsingFailed(tr("Parsing stopped."));
+            return;
+        } else if (!error.isEmpty()) {
+            emit parsingFailed(error);
+            return;
+        }
+
+        // only the aggregated trees are needed for the diff, so drop the events of each side as soon as possible
+        Data::BottomUpResults bottomUps[2];
+        for (int i = 0; i < 2; ++i) {
+            auto& file = contents[i];
+            aggregateResults(file.summary, file.symbols, file.locations, file.events, &bottomUps[i], nullptr);
+            file.events = {};
+            file.symbols = {};
+            file.locations = {};
+        }
+
+        const auto diff = Data::BottomUpResults::diff(bottomUps[0], bottomUps[1]);
+        bottomUps[0] = {};
+        bottomUps[1] = {};
+        Data::CallerCalleeResults callerCallee;
+        Data::callerCalleesFromBottomUpData(diff, &callerCallee);
+
+        if (m_stopRequested) {
+            emit parsingFailed(tr("Parsing stopped."));
+            return;
+        }
+
+        emit bottomUpDataAvailable(diff);
+        emit topDownDataAvailable(Data::TopDownResults::fromBottomUp(diff));
+        emit summaryDataAvailable(contents[1].summary);
+        emit callerCalleeDataAvailable(callerCallee);
+        // the events of both sides can't be diffed, without any events the timeline and filters stay empty
+        emit eventsAvailable({});
+        emit parsingFinished();
+    });
+}
+
+bool PerfParser::prepareParseFiles(const QStringList& paths, const QString& sysroot, const QString& kallsyms,
+                                   const QString& debugPaths, const QString& extraLibPaths, const QString& appPath,
+                                   const QString& arch, QString* parserBinary, QVector<QStringList>* parserArgs)
+{
+    if (paths.isEmpty()) {
+        emit parsingFailed(tr("No files to parse."));
+        return false;
+    }
+
+    parserArgs->reserve(paths.size());
+    for (const auto& path : paths) {
+        // combining files needs the complete data of every file, which rules out live recordings
+        const auto error = inputFileError(path, false);
+        if (!error.isEmpty()) {
+            emit parsingFailed(error);
+            return false;
+        }
+        parserArgs->push_back(parserArguments(path, sysroot, kallsyms, debugPaths, extraLibPaths, appPath, arch));
+    }
+
+    *parserBinary = findParserBinary();
+    if (parserBinary->isEmpty()) {
+        emit parsingFailed(tr("Failed to find hotspot-perfparser binary."));
+        return false;
+    }
+
+    clearResults();
+    return true;
+}
+
+void PerfParser::filterResults(const Data::FilterAction& filter)
+{
+    // a new filter supersedes the one that is still running, which then never reports back
+    Q_ASSERT(!m_isParsing || m_isFiltering);
+
+    if (!m_isFiltering) {
+        m_isFiltering = true;
+        emit parsingStarted();
+    }
+    m_stopRequested = false;
+
+    // the job only sees copies of the state that gets updated once filtering finished, see applyFilterResults.
+    // all other members only change while parsing, never while filtering
+    const auto lastFilter = m_lastFilter;
+    const auto lastFilteredEvents = m_lastFilteredEvents;
+    const auto lastFilteredStacks = m_lastFilteredStacks;
+    const int collapseMode = (filter.collapseInlinedFrames ? 1 : 0) | (filter.collapseRecursion ? 2 : 0);
+    const auto knownCollapsedStacks = m_collapsedStacks[collapseMode];
+    auto* outcomes = m_filterOutcomes.get();
+    m_filterJobs.schedule(JobScheduler::Priority::Visible, [=](const JobScheduler::Token& token) {
+        Instrumentation::ScopedTimer instrumentation("PerfParser::filterResults");
+        const auto isCanceled = [this, &token]() -> bool { return m_stopRequested || token.isCanceled(); };
+        // superseded jobs just stop, the current one reports all other outcomes to the GUI thread
+        auto report = [this, outcomes, &token](const FilterOutcomes::Outcome& outcome) {
+            if (token.isCanceled()) {
+                return;
+            }
+            outcomes->put(token.generation(), outcome);
+            QMetaObject::invokeMethod(this, "applyFilterResults", Qt::QueuedConnection,
+                                      Q_ARG(uint, token.generation()));
+        };
+        auto reportStopped = [&filter, &report]() {
+            FilterOutcomes::Outcome outcome;
+            outcome.error = tr("Parsing stopped.");
+            outcome.filter = filter;
+            report(outcome);
+        };
+        // the cache holds the complete trees, such that pruning them differently doesn't need to aggregate again
+        auto cacheKey = filter;
+        cacheKey.pruneThreshold = 0;
+        auto reportResults = [&filter, &report](FilterResults results, const QVector<QVector<qint32>>& collapsed) {
+            FilterOutcomes::Outcome outcome;
+            outcome.filter = filter;
+            results.bottomUp.prune(filter.pruneThreshold);
+            results.topDown.prune(filter.pruneThreshold);
+            outcome.results = results;
+            outcome.collapsedStacks = collapsed;
+            report(outcome);
+        };
+
+        FilterResults cached;
+        if (m_filterCache->find(cacheKey, &cached)) {
+            reportResults(cached, {});
+            return;
+        }
+
         Data::BottomUpResults bottomUp;
-        Data::EventResults events = m_events;
         Data::CallerCalleeResults callerCallee;
+        Data::ApproximationStats approximation;
+        // when the filter only narrows down the last one, start from the last results which
+        // contain fewer events and stacks to look at
+        const bool isRefinement =
+            filter.isValid() && lastFilter.isValid() && filter.isRefinementOf(lastFilter);
+        Data::EventResults events = isRefinement ? lastFilteredEvents : m_events;
+        const auto previousStacks = isRefinement ? lastFilteredStacks : QVector<bool>();
+        qCDebug(LOG_PERFPARSER) << "filtering, refining last filter:" << isRefinement;
+        // the stacks that pass the symbol filters, empty when no such filter is set
+        QVector<bool> filterStacks;
         const bool filterByTime = filter.time.isValid();
         const bool filterByCpu = filter.cpuId != std::numeric_limits<quint32>::max();
         const bool excludeByCpu = !filter.excludeCpuIds.isEmpty();
@@ -1383,7 +3914,10 @@ void PerfParser::filterResults(const Data::FilterAction& filter)
         const bool excludeBySymbol = !filter.excludeSymbols.isEmpty();
         const bool filterByStack = includeBySymbol || excludeBySymbol;
 
-        if (!filter.isValid()) {
+        // the modes that change how the stacks get aggregated, indexing m_collapsedStacks
+        auto collapsedStacks = knownCollapsedStacks;
+        bool computedCollapsedStacks = false;
+        if (!filter.isValid() && !collapseMode) {
             bottomUp = m_bottomUpResults;
             callerCallee = m_callerCalleeResults;
         } else {
@@ -1393,100 +3927,231 @@ void PerfParser::filterResults(const Data::FilterAction& filter)
             bottomUp.costs.clearTotalCost();
             const int numCosts = m_bottomUpResults.costs.numTypes();
 
-            // rebuild per-CPU data, i.e. wipe all the events and then re-add them
-            for (auto& cpu : events.cpus) {
-                cpu.events.clear();
-            }
-
             // we filter all available stacks and then remember the stack ids that should be
             // included, which is hopefully less work than filtering the stack for every event
-            QVector<bool> filterStacks;
             if (filterByStack) {
                 filterStacks.resize(m_events.stacks.size());
-                // TODO: parallelize
-                for (qint32 stackId = 0, c = m_events.stacks.size(); stackId < c; ++stackId) {
-                    // if empty, then all include filters are matched
-                    auto included = filter.includeSymbols;
-                    // if false, then none of the exclude filters matched
-                    bool excluded = false;
-                    m_bottomUpResults.foreachFrame(m_events.stacks.at(stackId), [&included, &excluded, &filter](const Data::Symbol& symbol, const Data::Location& /*location*/){
-                        excluded = filter.excludeSymbols.contains(symbol);
-                        if (excluded) {
-                            return false;
+                // map the include symbols to bits, which is much cheaper than copying the set for every stack
+                QHash<Data::Symbol, int> includeBits;
+                for (const auto& symbol : filter.includeSymbols) {
+                    includeBits.insert(symbol, includeBits.size());
+                }
+                const int numIncludes = includeBits.size();
+                auto* stackIncluded = filterStacks.data();
+                Util::parallelFor(m_events.stacks.size(), [&](int begin, int end) {
+                    QBitArray matchedIncludes(numIncludes);
+                    for (qint32 stackId = begin; stackId < end; ++stackId) {
+                        if (isCanceled()) {
+                            return;
                         }
-                        included.remove(symbol);
-                        // only stop when we included everything and no exclude filter is set
-                        return !included.isEmpty() || !filter.excludeSymbols.isEmpty();
-                    });
-                    filterStacks[stackId] = !excluded && included.isEmpty();
+                        if (!previousStacks.isEmpty() && !previousStacks.at(stackId)) {
+                            // already filtered out by the last filter
+                            stackIncluded[stackId] = false;
+                            continue;
+                        }
+                        matchedIncludes.fill(false);
+                        // if zero, then all include filters are matched
+                        int missingIncludes = numIncludes;
+                        // if false, then none of the exclude filters matched
+                        bool excluded = false;
+                        m_bottomUpResults.foreachFrame(
+                            m_events.stacks.at(stackId),
+                            [&](const Data::Symbol& symbol, const Data::Location& /*location*/) {
+                                excluded = filter.excludeSymbols.contains(symbol);
+                                if (excluded) {
+                                    return false;
+                                }
+                                const auto bit = includeBits.value(symbol, -1);
+                                if (bit != -1 && !matchedIncludes.testBit(bit)) {
+                                    matchedIncludes.setBit(bit);
+                                    --missingIncludes;
+                                }
+                                // only stop when we included everything and no exclude filter is set
+                                return missingIncludes > 0 || !filter.excludeSymbols.isEmpty();
+                            });
+                        stackIncluded[stackId] = !excluded && missingIncludes == 0;
+                    }
+                }, 4096);
+
+                if (isCanceled()) {
+                    reportStopped();
+                    return;
                 }
             }
 
-            // remove events that lie outside the selected time span
-            // TODO: parallelize
-            for (auto& thread : events.threads) {
-                if (m_stopRequested) {
-                    emit parsingFailed(tr("Parsing stopped."));
+            // the collapsed stacks are computed once per mode and share the ids of the original ones, such that
+            // toggling a mode only needs to aggregate the events again
+            if (collapseMode && collapsedStacks.size() != m_events.stacks.size()) {
+                const auto& stacks = m_events.stacks;
+                collapsedStacks.resize(stacks.size());
+                computedCollapsedStacks = true;
+                auto* collapsed = collapsedStacks.data();
+                Util::parallelFor(stacks.size(), [&](int begin, int end) {
+                    for (int stackId = begin; stackId < end && !isCanceled(); ++stackId) {
+                        auto stack = stacks.at(stackId);
+                        if (filter.collapseInlinedFrames) {
+                            stack = m_bottomUpResults.collapseInlinedFrames(stack);
+                        }
+                        if (filter.collapseRecursion) {
+                            stack = m_bottomUpResults.collapseRecursion(stack);
+                        }
+                        collapsed[stackId] = stack;
+                    }
+                }, 4096);
+
+                if (isCanceled()) {
+                    reportStopped();
+                    return;
+                }
+            }
+            const auto& aggregatedStacks = collapseMode ? collapsedStacks : events.stacks;
+
+            // filter and aggregate the threads in parallel, each thread yields a partial result
+            struct PartialResult
+            {
+                Data::BottomUpResults bottomUp;
+                Data::CallerCalleeResults callerCallee;
+                Data::ApproximationStats approximation;
+            };
+            // only the threads alive within the time range can have events in there. the threads of refined
+            // results are not covered by the index, but there are usually few enough of them to index them again
+            QVector<int> candidates;
+            if (filterByTime) {
+                candidates = !isRefinement && m_threadIndex.size() == events.threads.size()
+                    ? m_threadIndex.overlapping(filter.time)
+                    : Data::ThreadIntervalIndex(events.threads).overlapping(filter.time);
+            } else {
+                candidates.resize(events.threads.size());
+                std::iota(candidates.begin(), candidates.end(), 0);
+            }
+            std::vector<PartialResult> partials(candidates.size());
+
+            EventFilter eventFilter;
+            eventFilter.cpuId = filter.cpuId;
+            for (const auto cpuId : filter.excludeCpuIds) {
+                if (cpuId >= static_cast<quint32>(eventFilter.excludedCpus.size())) {
+                    eventFilter.excludedCpus.resize(cpuId + 1);
+                }
+                eventFilter.excludedCpus.setBit(cpuId);
+            }
+            eventFilter.includedStacks = filterStacks;
+            const auto filterEvents = eventFilterKernel(filterByCpu, excludeByCpu, filterByStack);
+
+            auto filterThread = [&](Data::ThreadEvents* thread, PartialResult* partial) {
+                if ((filter.processId != Data::INVALID_PID && thread->pid != filter.processId)
+                    || (filter.threadId != Data::INVALID_TID && thread->tid != filter.threadId)
+                    || (filter.fileId != Data::INVALID_FILE_ID && thread->fileId != filter.fileId)
+                    || filter.excludeProcessIds.contains(thread->pid) || filter.excludeThreadIds.contains(thread->tid)
+                    || filter.excludeFileIds.contains(thread->fileId)) {
+                    thread->events.clear();
                     return;
                 }
 
-                if ((filter.processId != Data::INVALID_PID && thread.pid != filter.processId)
-                    || (filter.threadId != Data::INVALID_TID && thread.tid != filter.threadId)
-                    || (filterByTime && (thread.time.start > filter.time.end || thread.time.end < filter.time.start))
-                    || filter.excludeProcessIds.contains(thread.pid) || filter.excludeThreadIds.contains(thread.tid)) {
-                    thread.events.clear();
-                    continue;
+                if (filterByTime) {
+                    // the events are sorted by time, so we can cut off everything outside the time range directly
+                    const auto& threadEvents = thread->events;
+                    const auto begin = threadEvents.lowerBound(threadEvents.begin(), threadEvents.end(),
+                                                              filter.time.start);
+                    const auto end = filter.time.end == Data::MAX_TIME
+                        ? threadEvents.end()
+                        : threadEvents.lowerBound(begin, threadEvents.end(), filter.time.end + 1);
+                    if (begin != threadEvents.begin() || end != threadEvents.end()) {
+                        thread->events = threadEvents.mid(begin.index(), end - begin);
+                    }
                 }
 
-                if (filterByTime || filterByCpu || excludeByCpu || filterByStack) {
-                    auto it = std::remove_if(
-                        thread.events.begin(), thread.events.end(),
-                        [filter, filterByTime, filterByCpu, excludeByCpu, filterByStack, filterStacks](const Data::Event& event) {
-                            if (filterByTime && !filter.time.contains(event.time)) {
-                                return true;
-                            } else if (filterByCpu && event.cpuId != filter.cpuId) {
-                                return true;
-                            } else if (excludeByCpu && filter.excludeCpuIds.contains(event.cpuId)) {
-                                return true;
-                            } else if (filterByStack && !filterStacks[event.stackId]) {
-                                return true;
-                            }
-                            return false;
-                        });
-                    thread.events.erase(it, thread.events.end());
+                if (filterEvents) {
+                    filterEvents(&thread->events, eventFilter);
                 }
-                if (m_stopRequested) {
-                    emit parsingFailed(tr("Parsing stopped."));
+
+                if (thread->events.isEmpty()) {
                     return;
                 }
 
-                // add event data to cpus, bottom up and caller callee sets
-                for (const auto& event : thread.events) {
-                    // only add non-time events to the cpu line, context switches shouldn't show up there
-                    if (event.type != events.offCpuTimeCostId) {
-                        events.cpus[event.cpuId].events.push_back(event);
-                    }
+                partial->bottomUp.symbols = bottomUp.symbols;
+                partial->bottomUp.locations = bottomUp.locations;
+                partial->bottomUp.costs.initializeCostsFrom(bottomUp.costs);
 
-                    QSet<Data::Symbol> recursionGuard;
-                    auto frameCallback = [&callerCallee, &recursionGuard, &event,
+                // add event data to bottom up and caller callee sets, the CPU timelines get derived from the
+                // filtered thread events later on
+                Data::RecursionGuard recursionGuard;
+                auto addEvent = [&](qint32 type, quint64 cost, qint32 stackId) {
+                    recursionGuard.reset();
+                    auto frameCallback = [partial, &recursionGuard, type, cost,
                                           numCosts](const Data::Symbol& symbol, const Data::Location& location) {
-                        addCallerCalleeEvent(symbol, location, event.type, event.cost, &recursionGuard, &callerCallee,
+                        addCallerCalleeEvent(symbol, location, type, cost, &recursionGuard, &partial->callerCallee,
                                              numCosts);
                     };
 
-                    bottomUp.addEvent(event.type, event.cost, events.stacks.at(event.stackId), frameCallback);
+                    partial->bottomUp.addEvent(type, cost, aggregatedStacks.at(stackId), frameCallback);
+                };
+
+                const auto& threadEvents = thread->events;
+                if (filter.sampleRate > 1) {
+                    // only the aggregation gets approximated, the events stay complete for the time line
+                    const auto sample = Data::sampleEvents(threadEvents, numCosts, filter.sampleRate,
+                                                           static_cast<quint32>(thread->tid), &partial->approximation);
+                    for (int i = 0, c = sample.indices.size(); i < c; ++i) {
+                        if (i % CancelCheckInterval == 0 && isCanceled()) {
+                            return;
+                        }
+                        const auto index = sample.indices[i];
+                        addEvent(threadEvents.type(index), sample.costs[i], threadEvents.stackId(index));
+                    }
+                } else {
+                    int i = 0;
+                    for (const auto& event : threadEvents) {
+                        if (i++ % CancelCheckInterval == 0 && isCanceled()) {
+                            return;
+                        }
+                        addEvent(event.type, event.cost, event.stackId);
+                    }
+                }
+            };
+
+            // detach once up front, the workers then only touch their own threads
+            auto* threads = events.threads.data();
+            Util::parallelFor(candidates.size(),
+                              [&](int begin, int end) {
+                                  for (int i = begin; i < end && !isCanceled(); ++i) {
+                                      filterThread(&threads[candidates[i]], &partials[i]);
+                                  }
+                              },
+                              1);
+
+            if (isCanceled()) {
+                reportStopped();
+                return;
+            }
+
+            // merge in thread order, which yields the same ids as aggregating everything serially
+            for (auto& partial : partials) {
+                if (isCanceled()) {
+                    reportStopped();
+                    return;
                 }
+                bottomUp.merge(partial.bottomUp);
+                callerCallee.merge(partial.callerCallee);
+                approximation.merge(partial.approximation);
+                partial = {};
             }
 
-            // remove threads that have no events within the selected time span
-            auto it = std::remove_if(events.threads.begin(), events.threads.end(),
-                                     [](const Data::ThreadEvents& thread) { return thread.events.isEmpty(); });
-            events.threads.erase(it, events.threads.end());
+            // remove threads that have no events within the selected time span, including those that
+            // weren't alive in there and thus never got looked at
+            QVector<Data::ThreadEvents> filteredThreads;
+            filteredThreads.reserve(candidates.size());
+            for (const auto i : candidates) {
+                if (!threads[i].events.isEmpty()) {
+                    filteredThreads.push_back(std::move(threads[i]));
+                }
+            }
+            events.threads = std::move(filteredThreads);
 
+            bottomUp.dropChildIndex();
             Data::BottomUp::initializeParents(&bottomUp.root);
 
-            if (m_stopRequested) {
-                emit parsingFailed(tr("Parsing stopped."));
+            if (isCanceled()) {
+                reportStopped();
                 return;
             }
 
@@ -1494,23 +4159,109 @@ void PerfParser::filterResults(const Data::FilterAction& filter)
             Data::callerCalleesFromBottomUpData(bottomUp, &callerCallee);
         }
 
-        if (m_stopRequested) {
-            emit parsingFailed(tr("Parsing stopped."));
+        if (isCanceled()) {
+            reportStopped();
             return;
         }
 
         const auto topDown = Data::TopDownResults::fromBottomUp(bottomUp);
 
-        if (m_stopRequested) {
-            emit parsingFailed(tr("Parsing stopped."));
+        if (isCanceled()) {
+            reportStopped();
             return;
         }
 
-        emit bottomUpDataAvailable(bottomUp);
-        emit topDownDataAvailable(topDown);
-        emit callerCalleeDataAvailable(callerCallee);
-        emit eventsAvailable(events);
-        emit parsingFinished();
+        const FilterResults results = {bottomUp, topDown, callerCallee, events, filterStacks, approximation};
+        m_filterCache->insert(cacheKey, results);
+        reportResults(results, computedCollapsedStacks ? collapsedStacks : QVector<QVector<qint32>>());
+    });
+}
+
+void PerfParser::applyFilterResults(uint generation)
+{
+    const auto outcome = m_filterOutcomes->take(generation);
+    if (!m_filterJobs.isCurrent(generation)) {
+        return;
+    }
+
+    // cleared first, the handlers of the signals below may start filtering again right away
+    m_isFiltering = false;
+    if (!outcome.error.isEmpty()) {
+        emit parsingFailed(outcome.error);
+        return;
+    }
+
+    const auto& filter = outcome.filter;
+    const auto& results = outcome.results;
+    const int collapseMode = (filter.collapseInlinedFrames ? 1 : 0) | (filter.collapseRecursion ? 2 : 0);
+    if (outcome.collapsedStacks.size() == m_events.stacks.size()) {
+        m_collapsedStacks[collapseMode] = outcome.collapsedStacks;
+    }
+    // the refinements start from the filtered events and stacks, which only exist for valid filters
+    m_lastFilter = filter;
+    m_lastFilteredEvents = filter.isValid() ? results.events : Data::EventResults();
+    m_lastFilteredStacks = filter.isValid() ? results.filterStacks : QVector<bool>();
+
+    emit bottomUpDataAvailable(results.bottomUp);
+    emit topDownDataAvailable(results.topDown);
+    emit callerCalleeDataAvailable(results.callerCallee);
+    emit eventsAvailable(results.events);
+    emit approximationStatsAvailable(results.approximation);
+    emit filterCacheStatsAvailable(m_filterCache->stats());
+    emit parsingFinished();
+}
+
+void PerfParser::saveFilterSnapshots(const QVector<Data::FilterAction>& filters)
+{
+    // only reads the cached results, so this is fine while filtering
+    if (m_snapshotsInputs.paths.isEmpty()) {
+        return;
+    }
+
+    // the results are shared, so collecting them here is cheap and only the writing is left for the job
+    QVector<FilterSnapshots::Snapshot> snapshots;
+    for (auto filter : filters) {
+        // the unfiltered results are part of the results cache already
+        if (!filter.isValid() && !filter.collapseInlinedFrames && !filter.collapseRecursion) {
+            continue;
+        }
+        // the cache holds the complete trees, see filterResults
+        filter.pruneThreshold = 0;
+        FilterResults results;
+        if (m_filterCache->peek(filter, &results)) {
+            snapshots.push_back(qMakePair(filter, results));
+        }
+    }
+    if (snapshots.isEmpty()) {
+        return;
+    }
+
+    using namespace ThreadWeaver;
+    const auto inputs = m_snapshotsInputs;
+    stream() << make_job([inputs, snapshots]() {
+        const auto key = FilterSnapshots::inputsKey(inputs.paths, inputs.parserBinary, inputs.parserArgs,
+                                                    static_cast<int>(inputs.timeAlignment), inputs.timeOffsets);
+        FilterSnapshots(inputs.paths.first(), key).save(snapshots);
+    });
+}
+
+void PerfParser::loadFilterSnapshots()
+{
+    Q_ASSERT(!m_isParsing);
+
+    using namespace ThreadWeaver;
+    const auto inputs = m_snapshotsInputs;
+    const auto bottomUp = m_bottomUpResults;
+    const auto events = m_events;
+    stream() << make_job([this, inputs, bottomUp, events]() {
+        int numSnapshots = 0;
+        if (!inputs.paths.isEmpty()) {
+            const auto key = FilterSnapshots::inputsKey(inputs.paths, inputs.parserBinary, inputs.parserArgs,
+                                                        static_cast<int>(inputs.timeAlignment), inputs.timeOffsets);
+            numSnapshots = FilterSnapshots(inputs.paths.first(), key).load(bottomUp, events, m_filterCache.get());
+            qCDebug(LOG_PERFPARSER) << "loaded" << numSnapshots << "filter snapshots for" << inputs.paths.first();
+        }
+        emit filterSnapshotsLoaded(numSnapshots);
     });
 }
 
@@ -32,6 +32,12 @@
 #include <QObject>
 
 #include <models/data.h>
+#include <models/jobscheduler.h>
+
+#include "perfheader.h"
+
+class FilterCache;
+class FilterOutcomes;
 
 // TODO: create a parser interface
 class PerfParser : public QObject
@@ -41,30 +47,167 @@ public:
     explicit PerfParser(QObject* parent = nullptr);
     ~PerfParser();
 
+    enum class ResultsCacheMode
+    {
+        // neither read nor write the on-disk results cache
+        Ignore,
+        // load the results from the on-disk cache when it matches, otherwise parse the file and update the cache
+        Use,
+        // always parse the file and update the on-disk cache
+        Refresh
+    };
+
+    // how the time lines of several files parsed at once get aligned with each other
+    enum class TimeAlignment
+    {
+        // keep the recorded times, which is right when all files got recorded with the same clock, e.g. with
+        // perf record -k CLOCK_MONOTONIC on a single host
+        Clock,
+        // shift every file such that they all start at the same time as the earliest one
+        Start
+    };
+
+    // the limits of the following parses, which the GUI takes from the Settings. the defaults are read from the
+    // environment variables named below, for the batch mode and the tests
+    struct ParseOptions
+    {
+        // only keep the events of this many seconds before the latest one for the timeline, zero keeps all of them.
+        // the aggregated costs always cover the whole recording. HOTSPOT_EVENT_RETENTION_S
+        int eventRetentionSeconds = 0;
+        // only keep this many of the latest events of every thread, zero keeps all of them.
+        // HOTSPOT_EVENT_RETENTION_PER_THREAD
+        int maxEventsPerThread = 0;
+        // drop the oldest events once the results take more than this many MiB, zero disables the budget.
+        // HOTSPOT_MEMORY_BUDGET_MB
+        int memoryBudgetMB = 0;
+        // publish partial results this often while parsing, zero disables them. HOTSPOT_PARTIAL_RESULTS_INTERVAL_MS
+        int partialResultsIntervalMs = 2000;
+        // build the top-down tree while parsing, which avoids another pass over the bottom-up tree at the end and
+        // yields partial top-down results, at the cost of a slower and more memory hungry parse.
+        // HOTSPOT_INGEST_TOP_DOWN
+        bool ingestTopDown = false;
+        // aggregate the samples on this many worker threads while parsing, with less than two they get aggregated
+        // on the thread decoding them. HOTSPOT_AGGREGATION_THREADS
+        int aggregationThreads = 0;
+
+        static ParseOptions fromEnvironment();
+    };
+
+    void setParseOptions(const ParseOptions& options);
+    ParseOptions parseOptions() const;
+
     void startParseFile(const QString& path, const QString& sysroot, const QString& kallsyms, const QString& debugPaths,
-                        const QString& extraLibPaths, const QString& appPath, const QString& arch);
+                        const QString& extraLibPaths, const QString& appPath, const QString& arch,
+                        ResultsCacheMode cacheMode = ResultsCacheMode::Ignore);
+
+    // parse all @p paths in parallel and merge their results, the threads get tagged with the index of their file
+    // which can be used to filter by file, see Data::ThreadEvents::fileId
+    void startParseFiles(const QStringList& paths, const QString& sysroot, const QString& kallsyms,
+                         const QString& debugPaths, const QString& extraLibPaths, const QString& appPath,
+                         const QString& arch, ResultsCacheMode cacheMode = ResultsCacheMode::Ignore);
+
+    // parse @p baselinePath and @p candidatePath in parallel and emit the difference of their aggregated costs,
+    // see Data::BottomUpResults::diff. no events get emitted, as those of two captures can't be diffed
+    void startDiffFiles(const QString& baselinePath, const QString& candidatePath, const QString& sysroot,
+                        const QString& kallsyms, const QString& debugPaths, const QString& extraLibPaths,
+                        const QString& appPath, const QString& arch,
+                        ResultsCacheMode cacheMode = ResultsCacheMode::Ignore);
+
+    // write the samples of the following parses in the text format of `perf script` to @p path, or to stdout
+    // when it is "-". the output covers all samples, before any filter gets applied. an empty path disables it,
+    // which is the default unless HOTSPOT_GENERATE_SCRIPT_OUTPUT is set
+    void setScriptOutput(const QString& path);
+
+    // align the files of the following startParseFiles calls with @p alignment, then shift each of them by the
+    // offset in nanoseconds at its index in @p offsets. the offsets can be negative, missing ones are zero
+    void setTimeAlignment(TimeAlignment alignment, const QVector<qint64>& offsets = {});
 
     void filterResults(const Data::FilterAction& filter);
 
+    // write the cached results of @p filters next to the results cache of the parsed file, the results of the
+    // filters that aren't cached anymore get skipped. this replaces the snapshots saved before for that file
+    void saveFilterSnapshots(const QVector<Data::FilterAction>& filters);
+    // put the results saved by saveFilterSnapshots for the same data into the filter cache, such that applying those
+    // filters again is instant. emits filterSnapshotsLoaded once done
+    void loadFilterSnapshots();
+
     void stop();
 
 signals:
     void parsingStarted();
+    // emitted right after parsingStarted when the header of the file could be read directly, see PerfHeader::read
+    void headerDataAvailable(const PerfHeader::Info& header);
     void summaryDataAvailable(const Data::Summary& data);
     void bottomUpDataAvailable(const Data::BottomUpResults& data);
     void topDownDataAvailable(const Data::TopDownResults& data);
+    // snapshots of the aggregated data while the initial parse is still running. the parents of their trees are
+    // not set, and the top-down snapshots only get emitted with ParseOptions::ingestTopDown
+    void partialBottomUpDataAvailable(const Data::BottomUpResults& data);
+    void partialTopDownDataAvailable(const Data::TopDownResults& data);
+    // only emitted while parsing a live recording, contains the events of the last few seconds
+    void partialEventsAvailable(const Data::EventResults& data);
     void callerCalleeDataAvailable(const Data::CallerCalleeResults& data);
     void eventsAvailable(const Data::EventResults& events);
     void parsingFinished();
     void parsingFailed(const QString& errorMessage);
     void progress(float progress);
+    // more details about the progress of the initial parse, also emitted for each stage after parsing the input
+    void parseProgress(const Data::ParseProgress& progress);
     void stopRequested();
+    void filterCacheStatsAvailable(const Data::FilterCacheStats& stats);
+    // emitted for every filter, the stats tell whether the results got aggregated from a sample of the events
+    void approximationStatsAvailable(const Data::ApproximationStats& stats);
+    void filterSnapshotsLoaded(int numSnapshots);
+
+private slots:
+    // emits the results of the filter job of @p generation, unless a newer filter superseded it
+    void applyFilterResults(uint generation);
 
 private:
+    void clearResults();
+    // validate the input files and collect the arguments for their parser processes,
+    // @return false after emitting parsingFailed when any of them can't be parsed
+    bool prepareParseFiles(const QStringList& paths, const QString& sysroot, const QString& kallsyms,
+                           const QString& debugPaths, const QString& extraLibPaths, const QString& appPath,
+                           const QString& arch, QString* parserBinary, QVector<QStringList>* parserArgs);
+    // build the aggregated results from the events and emit them all, like after a regular parse
+    void emitAggregatedResults(const Data::Summary& summary, const QVector<Data::Symbol>& symbols,
+                               const QVector<Data::FrameLocation>& locations, const Data::EventResults& events);
+
     // only set once after the initial startParseFile finished
     Data::BottomUpResults m_bottomUpResults;
     Data::CallerCalleeResults m_callerCalleeResults;
     Data::EventResults m_events;
+    // the lifetimes of the threads in m_events, such that time filters only look at the threads alive in between
+    Data::ThreadIntervalIndex m_threadIndex;
+    // the last filter that got applied and its results, used to speed up refining filters
+    Data::FilterAction m_lastFilter;
+    Data::EventResults m_lastFilteredEvents;
+    QVector<bool> m_lastFilteredStacks;
+    // the stacks of m_events without inlined frames and/or recursions, computed on demand and indexed by a bit mask
+    // of Data::FilterAction::collapseInlinedFrames and collapseRecursion
+    QVector<QVector<qint32>> m_collapsedStacks[4];
+    std::unique_ptr<FilterCache> m_filterCache;
+    std::unique_ptr<FilterOutcomes> m_filterOutcomes;
+    // set from the parsingStarted of the first filter until the last one that superseded it finished
+    bool m_isFiltering = false;
+    // the inputs the current results got parsed from, which identify the filter snapshots saved for them. the
+    // snapshots get stored next to the first file, there are none when paths is empty
+    struct SnapshotsInputs
+    {
+        QStringList paths;
+        QString parserBinary;
+        QVector<QStringList> parserArgs;
+        TimeAlignment timeAlignment = TimeAlignment::Clock;
+        QVector<qint64> timeOffsets;
+    };
+    SnapshotsInputs m_snapshotsInputs;
+    // filtering runs before any pending background work of the pages, whose results the user is waiting for
+    JobScheduler m_filterJobs;
+    QString m_scriptOutput;
+    ParseOptions m_parseOptions;
+    TimeAlignment m_timeAlignment = TimeAlignment::Clock;
+    QVector<qint64> m_timeOffsets;
     std::atomic<bool> m_isParsing;
     std::atomic<bool> m_stopRequested;
 };
@@ -29,13 +29,21 @@
 
 #include <QDebug>
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
 #include <QProcess>
+#include <QRegularExpression>
 #include <QStandardPaths>
 #include <QTemporaryFile>
 #include <QTimer>
 
+#include <algorithm>
+#include <cerrno>
 #include <csignal>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <KUser>
 #include <KWindowSystem>
@@ -58,6 +66,7 @@ PerfRecord::~PerfRecord()
         m_perfRecordProcess->waitForFinished(100);
         delete m_perfRecordProcess;
     }
+    closeLiveReader();
 }
 
 static QStringList sudoOptions(const QString& sudoBinary)
@@ -170,8 +179,11 @@ void PerfRecord::startRecording(const QStringList& perfOptions, const QString& o
         m_perfRecordProcess->kill();
         m_perfRecordProcess->deleteLater();
     }
+    closeLiveReader();
     m_perfRecordProcess = new QProcess(this);
-    m_perfRecordProcess->setProcessChannelMode(QProcess::MergedChannels);
+    // when recording into a named pipe, perf streams its data to stdout which is redirected into the pipe
+    const bool isLive = Util::isFifo(outputPath);
+    m_perfRecordProcess->setProcessChannelMode(isLive ? QProcess::SeparateChannels : QProcess::MergedChannels);
 
     QFileInfo outputFileInfo(outputPath);
     QString folderPath = outputFileInfo.dir().path();
@@ -190,39 +202,62 @@ void PerfRecord::startRecording(const QStringList& perfOptions, const QString& o
     }
 
     connect(m_perfRecordProcess.data(), static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
-            this, [this](int exitCode, QProcess::ExitStatus exitStatus) {
+            this, [this, isLive](int exitCode, QProcess::ExitStatus exitStatus) {
                 Q_UNUSED(exitStatus)
 
-                QFileInfo outputFileInfo(m_outputPath);
-                if ((exitCode == EXIT_SUCCESS || (exitCode == SIGTERM && m_userTerminated) || outputFileInfo.size() > 0)
-                    && outputFileInfo.exists()) {
+                const auto files = recordedFiles();
+                const auto hasData = !files.isEmpty() && QFileInfo(files.last()).size() > 0;
+                if ((exitCode == EXIT_SUCCESS || (exitCode == SIGTERM && m_userTerminated) || (!isLive && hasData))
+                    && !files.isEmpty()) {
                     emit recordingFinished(m_outputPath);
                 } else {
                     emit recordingFailed(tr("Failed to record perf data, error code %1.").arg(exitCode));
                 }
                 m_userTerminated = false;
+                closeLiveReader();
             });
 
     connect(m_perfRecordProcess.data(), &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
-        Q_UNUSED(error)
+        if (error == QProcess::FailedToStart) {
+            closeLiveReader();
+        }
         if (!m_userTerminated) {
             emit recordingFailed(m_perfRecordProcess->errorString());
         }
     });
 
-    connect(m_perfRecordProcess.data(), &QProcess::readyRead, this, [this]() {
-        QString output = QString::fromUtf8(m_perfRecordProcess->readAll());
-        emit recordingOutput(output);
-    });
+    connect(m_perfRecordProcess.data(), &QProcess::readyRead, this,
+            [this]() { handleOutput(QString::fromUtf8(m_perfRecordProcess->readAll())); });
+    connect(m_perfRecordProcess.data(), &QProcess::readyReadStandardError, this,
+            [this]() { handleOutput(QString::fromUtf8(m_perfRecordProcess->readAllStandardError())); });
 
     m_outputPath = outputPath;
+    // the modification times only have a resolution of seconds
+    m_recordingStart = QDateTime::currentDateTime().addSecs(-1);
+    m_lostEvents = 0;
     auto perfBinary = QStringLiteral("perf");
 
     if (!workingDirectory.isEmpty()) {
         m_perfRecordProcess->setWorkingDirectory(workingDirectory);
     }
 
-    QStringList perfCommand = {QStringLiteral("record"), QStringLiteral("-o"), m_outputPath};
+    QStringList perfCommand = {QStringLiteral("record"), QStringLiteral("-o")};
+    if (isLive) {
+        // perf only writes its streaming format to stdout, a named output file always gets the seekable format
+        perfCommand += QStringLiteral("-");
+        // opening a pipe for writing blocks until it has a reader, which would stall the GUI thread in start()
+        // until the perfparser attaches, or forever when it fails to start. hold a reader of our own, it never
+        // consumes any data and only gets closed once perf is done
+        m_liveReadFd = ::open(QFile::encodeName(m_outputPath).constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (m_liveReadFd == -1) {
+            const auto error = QString::fromLocal8Bit(strerror(errno));
+            emit recordingFailed(tr("Failed to open the pipe '%1': %2").arg(m_outputPath, error));
+            return;
+        }
+        m_perfRecordProcess->setStandardOutputFile(m_outputPath);
+    } else {
+        perfCommand += m_outputPath;
+    }
     perfCommand += perfOptions;
     perfCommand += recordOptions;
 
@@ -231,6 +266,25 @@ void PerfRecord::startRecording(const QStringList& perfOptions, const QString& o
     m_perfRecordProcess->start(perfBinary, perfCommand);
 }
 
+void PerfRecord::closeLiveReader()
+{
+    if (m_liveReadFd != -1) {
+        ::close(m_liveReadFd);
+        m_liveReadFd = -1;
+    }
+}
+
+void PerfRecord::handleOutput(const QString& output)
+{
+    emit recordingOutput(output);
+
+    const auto lostEvents = parseLostEvents(output);
+    if (lostEvents > 0) {
+        m_lostEvents += lostEvents;
+        emit lostEventsDetected(m_lostEvents);
+    }
+}
+
 void PerfRecord::record(const QStringList& perfOptions, const QString& outputPath, bool elevatePrivileges,
                         const QStringList& pids)
 {
@@ -288,6 +342,26 @@ const QString PerfRecord::perfCommand()
     }
 }
 
+QStringList PerfRecord::recordedFiles() const
+{
+    const QFileInfo output(m_outputPath);
+    if (output.exists() && (Util::isFifo(m_outputPath) || output.lastModified() >= m_recordingStart)) {
+        return {m_outputPath};
+    }
+
+    // with --switch-output perf appends a timestamp to the name of every file it writes, including the last one
+    const QRegularExpression chunkPattern(QLatin1Char('^') + QRegularExpression::escape(output.fileName())
+                                          + QLatin1String("\\.\\d+$"));
+    QStringList files;
+    const auto entries = output.dir().entryInfoList({output.fileName() + QLatin1String(".*")}, QDir::Files, QDir::Name);
+    for (const auto& entry : entries) {
+        if (chunkPattern.match(entry.fileName()).hasMatch() && entry.lastModified() >= m_recordingStart) {
+            files.append(entry.absoluteFilePath());
+        }
+    }
+    return files;
+}
+
 void PerfRecord::stopRecording()
 {
     m_userTerminated = true;
@@ -305,6 +379,96 @@ void PerfRecord::sendInput(const QByteArray& input)
     m_perfRecordProcess->write(input);
 }
 
+qint64 PerfRecord::writtenBytes() const
+{
+    if (m_outputPath.isEmpty() || Util::isFifo(m_outputPath)) {
+        return -1;
+    }
+    qint64 size = 0;
+    for (const auto& file : recordedFiles()) {
+        size += QFileInfo(file).size();
+    }
+    return size;
+}
+
+qint64 PerfRecord::lostEvents() const
+{
+    return m_lostEvents;
+}
+
+const int PerfRecord::MaxBackOffLevel;
+
+PerfRecord::RecordingSettings PerfRecord::presetSettings(OverheadPreset preset, int backOffLevel)
+{
+    RecordingSettings settings;
+    switch (preset) {
+    case OverheadPreset::Custom:
+        return settings;
+    case OverheadPreset::Production:
+        // the odd frequency prevents sampling in lockstep with periodic activity
+        settings.frequency = 99;
+        settings.dwarfStackSize = 4096;
+        settings.mmapPages = 256;
+        settings.aioDepth = 1;
+        break;
+    case OverheadPreset::Low:
+        settings.frequency = 499;
+        settings.dwarfStackSize = 8192;
+        settings.mmapPages = 1024;
+        settings.aioDepth = 2;
+        break;
+    case OverheadPreset::Balanced:
+        settings.frequency = 999;
+        settings.dwarfStackSize = 16384;
+        settings.mmapPages = 2048;
+        settings.aioDepth = 4;
+        break;
+    }
+
+    // less data per second and larger buffers both make it less likely that perf can't keep up
+    backOffLevel = std::max(0, std::min(backOffLevel, MaxBackOffLevel));
+    settings.frequency = std::max(10, settings.frequency >> backOffLevel);
+    settings.dwarfStackSize = std::max(1024, settings.dwarfStackSize >> backOffLevel);
+    settings.mmapPages = std::min(8192, settings.mmapPages << backOffLevel);
+    return settings;
+}
+
+QStringList PerfRecord::presetOptions(OverheadPreset preset, const QString& callGraph, int backOffLevel)
+{
+    if (preset == OverheadPreset::Custom) {
+        return {};
+    }
+
+    const auto settings = presetSettings(preset, backOffLevel);
+    QStringList options;
+    if (callGraph == QLatin1String("dwarf")) {
+        options << QStringLiteral("--call-graph")
+                << (callGraph + QLatin1Char(',') + QString::number(settings.dwarfStackSize));
+    } else if (!callGraph.isEmpty()) {
+        options << QStringLiteral("--call-graph") << callGraph;
+    }
+    options << QStringLiteral("--freq") << QString::number(settings.frequency);
+    options << QStringLiteral("--mmap-pages") << QString::number(settings.mmapPages);
+    if (canUseAio()) {
+        // the depth is an optional argument, which perf only accepts with an equal sign
+        options << (QLatin1String("--aio=") + QString::number(settings.aioDepth));
+    }
+    return options;
+}
+
+qint64 PerfRecord::parseLostEvents(const QString& output)
+{
+    // matches e.g. "Processed 1234 events and lost 5 chunks!" and "LOST 12 events!"
+    static const QRegularExpression lostPattern(QStringLiteral("\\blost (\\d+) (?:chunks|events|samples)\\b"),
+                                                QRegularExpression::CaseInsensitiveOption);
+    qint64 lostEvents = 0;
+    auto it = lostPattern.globalMatch(output);
+    while (it.hasNext()) {
+        lostEvents += it.next().capturedRef(1).toLongLong();
+    }
+    return lostEvents;
+}
+
 QString PerfRecord::sudoUtil()
 {
     const auto commands = {
@@ -356,6 +520,11 @@ QStringList PerfRecord::offCpuProfilingOptions()
     return {QStringLiteral("--switch-events"), QStringLiteral("--event"), QStringLiteral("sched:sched_switch")};
 }
 
+QStringList PerfRecord::wakeupProfilingOptions()
+{
+    return {QStringLiteral("--event"), QStringLiteral("sched:sched_wakeup")};
+}
+
 bool PerfRecord::canSampleCpu()
 {
     return perfRecordHelp().contains("--sample-cpu");
@@ -371,6 +540,11 @@ bool PerfRecord::canUseAio()
     return perfRecordHelp().contains("--aio");
 }
 
+bool PerfRecord::canCompress()
+{
+    return perfRecordHelp().contains("--compression-level");
+}
+
 bool PerfRecord::isPerfInstalled()
 {
     return !QStandardPaths::findExecutable(QStringLiteral("perf")).isEmpty();
@@ -27,8 +27,10 @@
 
 #pragma once
 
+#include <QDateTime>
 #include <QObject>
 #include <QPointer>
+#include <QStringList>
 
 class QProcess;
 
@@ -36,6 +38,37 @@ class PerfRecord : public QObject
 {
     Q_OBJECT
 public:
+    // presets that trade the level of detail against the overhead of recording
+    enum class OverheadPreset
+    {
+        Custom, // use the options configured manually
+        Production, // lowest overhead, suitable for busy production machines
+        Low,
+        Balanced
+    };
+
+    struct RecordingSettings
+    {
+        // the sampling frequency in Hz
+        int frequency = 0;
+        // the number of bytes of the user stack that get copied for DWARF unwinding
+        int dwarfStackSize = 0;
+        // the size of the ring buffer per CPU in pages, always a power of two
+        int mmapPages = 0;
+        // the number of asynchronous write requests in flight
+        int aioDepth = 0;
+    };
+
+    // every back off level halves the data rate and doubles the buffer size of a preset
+    static const int MaxBackOffLevel = 3;
+
+    static RecordingSettings presetSettings(OverheadPreset preset, int backOffLevel = 0);
+    // @return the perf options for @p preset, which include the call graph option for @p callGraph
+    static QStringList presetOptions(OverheadPreset preset, const QString& callGraph, int backOffLevel = 0);
+
+    // @return the number of lost events or chunks reported by perf in @p output, or 0 when nothing got lost
+    static qint64 parseLostEvents(const QString& output);
+
     explicit PerfRecord(QObject* parent = nullptr);
     ~PerfRecord();
 
@@ -46,9 +79,16 @@ public:
     void recordSystem(const QStringList& perfOptions, const QString& outputPath);
 
     const QString perfCommand();
+    // @return the files written by the last recording, one per chunk when perf got asked to split its output
+    QStringList recordedFiles() const;
     void stopRecording();
     void sendInput(const QByteArray& input);
 
+    // @return the size of the recorded data so far, or -1 when it is streamed through a named pipe
+    qint64 writtenBytes() const;
+    // @return the number of events perf reported as lost for the current recording
+    qint64 lostEvents() const;
+
     static QString sudoUtil();
     static QString currentUsername();
 
@@ -57,8 +97,11 @@ public:
     static bool canSampleCpu();
     static bool canSwitchEvents();
     static bool canUseAio();
+    static bool canCompress();
 
     static QStringList offCpuProfilingOptions();
+    // the wakeups allow breaking the off-CPU time down by the wait reason and the waking stack
+    static QStringList wakeupProfilingOptions();
 
     static bool isPerfInstalled();
 
@@ -67,15 +110,23 @@ signals:
     void recordingFinished(const QString& fileLocation);
     void recordingFailed(const QString& errorMessage);
     void recordingOutput(const QString& errorMessage);
+    // emitted whenever perf reports lost events, @p lostEvents is the total for the current recording
+    void lostEventsDetected(qint64 lostEvents);
 
 private:
     QPointer<QProcess> m_perfRecordProcess;
     QPointer<QProcess> m_elevatePrivilegesProcess;
     QString m_outputPath;
+    QDateTime m_recordingStart;
     bool m_userTerminated;
+    qint64 m_lostEvents = 0;
+    // the read end of the live recording pipe we hold while perf writes to it, -1 when there is none
+    int m_liveReadFd = -1;
 
     void startRecording(bool elevatePrivileges, const QStringList& perfOptions, const QString& outputPath,
                         const QStringList& recordOptions, const QString& workingDirectory = QString());
     void startRecording(const QStringList& perfOptions, const QString& outputPath, const QStringList& recordOptions,
                         const QString& workingDirectory = QString());
+    void closeLiveReader();
+    void handleOutput(const QString& output);
 };
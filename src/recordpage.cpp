@@ -38,6 +38,7 @@
 #include <QShortcut>
 #include <QStandardItemModel>
 #include <QStandardPaths>
+#include <QTemporaryDir>
 #include <QTimer>
 #include <QtConcurrent/QtConcurrentRun>
 
@@ -45,6 +46,7 @@
 #include <KComboBox>
 #include <KConfigGroup>
 #include <KFilterProxySearchLine>
+#include <KFormat>
 #include <KRecursiveFilterProxyModel>
 #include <KSharedConfig>
 #include <KShell>
@@ -84,6 +86,11 @@ RecordType selectedRecordType(const QScopedPointer<Ui::RecordPage>& ui)
     return ui->recordTypeComboBox->currentData().value<RecordType>();
 }
 
+PerfRecord::OverheadPreset selectedOverheadPreset(const QScopedPointer<Ui::RecordPage>& ui)
+{
+    return static_cast<PerfRecord::OverheadPreset>(ui->overheadPresetComboBox->currentData().toInt());
+}
+
 void updateStartRecordingButtonState(const QScopedPointer<Ui::RecordPage>& ui)
 {
     if (!PerfRecord::isPerfInstalled()) {
@@ -172,6 +179,8 @@ RecordPage::RecordPage(QWidget* parent)
     , m_perfRecord(new PerfRecord(this))
     , m_updateRuntimeTimer(new QTimer(this))
     , m_watcher(new QFutureWatcher<ProcDataList>(this))
+    , m_processScanner(std::make_shared<ProcessListScanner>())
+    , m_updateProcessesTimer(new QTimer(this))
 {
     ui->setupUi(this);
 
@@ -264,10 +273,35 @@ RecordPage::RecordPage(QWidget* parent)
         ui->callGraphComboBox->setCurrentIndex(dwarfIdx);
     }
 
+    {
+        using Preset = PerfRecord::OverheadPreset;
+        ui->overheadPresetComboBox->addItem(tr("Custom"), static_cast<int>(Preset::Custom));
+        ui->overheadPresetComboBox->setItemData(
+            0, tr("<qt>Use the perf defaults or the buffer size and AIO options configured below.</qt>"),
+            Qt::ToolTipRole);
+
+        auto addPreset = [this](const QString& name, Preset preset) {
+            const auto settings = PerfRecord::presetSettings(preset);
+            ui->overheadPresetComboBox->addItem(name, static_cast<int>(preset));
+            ui->overheadPresetComboBox->setItemData(
+                ui->overheadPresetComboBox->count() - 1,
+                tr("<qt>Sample at %1 Hz, copy %2 bytes of the stack for DWARF unwinding and buffer %3 pages per CPU."
+                   " When perf loses events, the next recording uses a lower frequency and a larger buffer.</qt>")
+                    .arg(QString::number(settings.frequency), QString::number(settings.dwarfStackSize),
+                         QString::number(settings.mmapPages)),
+                Qt::ToolTipRole);
+        };
+        addPreset(tr("Production"), Preset::Production);
+        addPreset(tr("Low Overhead"), Preset::Low);
+        addPreset(tr("Balanced"), Preset::Balanced);
+    }
+
     connect(m_perfRecord, &PerfRecord::recordingStarted, this,
             [this](const QString& perfBinary, const QStringList& arguments) {
                 m_recordTimer.start();
                 m_updateRuntimeTimer->start();
+                updateRecordingStats();
+                ui->recordingStatsLabel->setVisible(true);
                 appendOutput(QLatin1String("$ ") + perfBinary + QLatin1Char(' ') + arguments.join(QLatin1Char(' '))
                              + QLatin1Char('\n'));
                 ui->perfInputEdit->setEnabled(true);
@@ -275,10 +309,16 @@ RecordPage::RecordPage(QWidget* parent)
 
     connect(m_perfRecord, &PerfRecord::recordingFinished, this, [this](const QString& fileLocation) {
         appendOutput(tr("\nrecording finished after %1").arg(Util::formatTimeString(m_recordTimer.nsecsElapsed())));
-        m_resultsFile = fileLocation;
         setError({});
         recordingStopped();
-        ui->viewPerfRecordResultsButton->setEnabled(true);
+        // the data of a live recording only got streamed through the named pipe, there is nothing to open
+        const bool wasLive = !m_liveDir.isNull();
+        m_liveDir.reset();
+        m_resultsFiles = wasLive ? QStringList() : m_perfRecord->recordedFiles();
+        if (m_resultsFiles.isEmpty() && !wasLive) {
+            m_resultsFiles = QStringList(fileLocation);
+        }
+        ui->viewPerfRecordResultsButton->setEnabled(!wasLive);
     });
 
     connect(m_perfRecord, &PerfRecord::recordingFailed, this, [this](const QString& errorMessage) {
@@ -291,9 +331,14 @@ RecordPage::RecordPage(QWidget* parent)
         setError(errorMessage);
         recordingStopped();
         ui->viewPerfRecordResultsButton->setEnabled(false);
+        if (m_liveDir) {
+            m_liveDir.reset();
+            emit liveRecordingFailed();
+        }
     });
 
     connect(m_perfRecord, &PerfRecord::recordingOutput, this, &RecordPage::appendOutput);
+    connect(m_perfRecord, &PerfRecord::lostEventsDetected, this, &RecordPage::updateRecordingStats);
 
     connect(ui->perfInputEdit, &QLineEdit::returnPressed, this, [this]() {
         m_perfRecord->sendInput(ui->perfInputEdit->text().toUtf8());
@@ -320,6 +365,9 @@ RecordPage::RecordPage(QWidget* parent)
     ui->processesFilterBox->setProxy(m_processProxyModel);
 
     connect(m_watcher, &QFutureWatcher<ProcDataList>::finished, this, &RecordPage::updateProcessesFinished);
+    m_updateProcessesTimer->setSingleShot(true);
+    m_updateProcessesTimer->setInterval(1000);
+    connect(m_updateProcessesTimer, &QTimer::timeout, this, &RecordPage::updateProcesses);
 
     if (m_perfRecord->currentUsername() == QLatin1String("root")) {
         ui->elevatePrivilegesCheckBox->setChecked(true);
@@ -342,6 +390,29 @@ RecordPage::RecordPage(QWidget* parent)
     ui->mmapPagesSpinBox->setValue(config().readEntry(QStringLiteral("mmapPages"), 0));
     ui->mmapPagesUnitComboBox->setCurrentIndex(config().readEntry(QStringLiteral("mmapPagesUnit"), 2));
     ui->useAioCheckBox->setChecked(config().readEntry(QStringLiteral("useAio"), PerfRecord::canUseAio()));
+    ui->compressCheckBox->setChecked(config().readEntry(QStringLiteral("compress"), false));
+    ui->splitOutputSpinBox->setValue(config().readEntry(QStringLiteral("splitOutput"), 0));
+    ui->liveViewCheckBox->setChecked(config().readEntry(QStringLiteral("liveView"), false));
+
+    const auto overheadPreset = config().readEntry(QStringLiteral("overheadPreset"), 0);
+    const auto overheadPresetIdx = ui->overheadPresetComboBox->findData(overheadPreset);
+    if (overheadPresetIdx != -1) {
+        ui->overheadPresetComboBox->setCurrentIndex(overheadPresetIdx);
+    }
+    auto updateOverheadPresetState = [this]() {
+        // the presets pick the buffer size and AIO depth themselves
+        const bool isCustom = selectedOverheadPreset(ui) == PerfRecord::OverheadPreset::Custom;
+        ui->mmapPagesContainer->setEnabled(isCustom);
+        ui->useAioCheckBox->setEnabled(isCustom);
+    };
+    updateOverheadPresetState();
+    connect(ui->overheadPresetComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this,
+            [this, updateOverheadPresetState]() {
+                // start over with the chosen preset instead of the one that got backed off
+                config().writeEntry(QStringLiteral("overheadBackOff"), 0);
+                updateOverheadPresetState();
+            });
+    ui->recordingStatsLabel->setVisible(false);
 
     const auto callGraph = config().readEntry("callGraph", ui->callGraphComboBox->currentData());
     const auto callGraphIdx = ui->callGraphComboBox->findData(callGraph);
@@ -358,6 +429,7 @@ RecordPage::RecordPage(QWidget* parent)
         // round to the nearest second
         const auto roundedElapsed = std::round(double(m_recordTimer.nsecsElapsed()) / 1E9) * 1E9;
         ui->startRecordingButton->setText(tr("Stop Recording (%1)").arg(Util::formatTimeString(roundedElapsed, true)));
+        updateRecordingStats();
     });
 
     auto* stopRecordingShortcut = new QShortcut(Qt::Key_Escape, this);
@@ -387,13 +459,17 @@ RecordPage::RecordPage(QWidget* parent)
         ui->useAioCheckBox->hide();
         ui->useAioLabel->hide();
     }
+    if (!PerfRecord::canCompress()) {
+        ui->compressCheckBox->hide();
+        ui->compressLabel->hide();
+    }
 }
 
 RecordPage::~RecordPage() = default;
 
 void RecordPage::showRecordPage()
 {
-    m_resultsFile.clear();
+    m_resultsFiles.clear();
     setError({});
     updateRecordType();
     ui->viewPerfRecordResultsButton->setEnabled(false);
@@ -417,7 +493,13 @@ void RecordPage::onStartRecordingButtonClicked(bool checked)
 
         const auto callGraphOption = ui->callGraphComboBox->currentData().toString();
         config().writeEntry("callGraph", callGraphOption);
-        if (!callGraphOption.isEmpty()) {
+        const auto overheadPreset = selectedOverheadPreset(ui);
+        config().writeEntry(QStringLiteral("overheadPreset"), static_cast<int>(overheadPreset));
+        const bool isCustomPreset = overheadPreset == PerfRecord::OverheadPreset::Custom;
+        if (!isCustomPreset) {
+            const auto backOffLevel = config().readEntry(QStringLiteral("overheadBackOff"), 0);
+            perfOptions += PerfRecord::presetOptions(overheadPreset, callGraphOption, backOffLevel);
+        } else if (!callGraphOption.isEmpty()) {
             perfOptions << QStringLiteral("--call-graph") << callGraphOption;
         }
 
@@ -439,11 +521,12 @@ void RecordPage::onStartRecordingButtonClicked(bool checked)
                 perfOptions += QStringLiteral("cycles");
             }
             perfOptions += PerfRecord::offCpuProfilingOptions();
+            perfOptions += PerfRecord::wakeupProfilingOptions();
         }
         config().writeEntry(QStringLiteral("offCpuProfiling"), offCpuProfilingEnabled);
 
         const bool useAioEnabled = ui->useAioCheckBox->isChecked();
-        if (useAioEnabled && PerfRecord::canUseAio()) {
+        if (useAioEnabled && PerfRecord::canUseAio() && isCustomPreset) {
             perfOptions += QStringLiteral("--aio");
         }
         config().writeEntry(QStringLiteral("useAio"), useAioEnabled);
@@ -462,7 +545,7 @@ void RecordPage::onStartRecordingButtonClicked(bool checked)
 
         const int mmapPages = ui->mmapPagesSpinBox->value();
         const int mmapPagesUnit = ui->mmapPagesUnitComboBox->currentIndex();
-        if (mmapPages > 0) {
+        if (mmapPages > 0 && isCustomPreset) {
             auto mmapPagesArg = QString::number(mmapPages);
             switch (mmapPagesUnit) {
             case 0:
@@ -490,7 +573,37 @@ void RecordPage::onStartRecordingButtonClicked(bool checked)
         config().writeEntry(QStringLiteral("mmapPages"), mmapPages);
         config().writeEntry(QStringLiteral("mmapPagesUnit"), mmapPagesUnit);
 
-        const auto outputFile = ui->outputFile->url().toLocalFile();
+        auto outputFile = ui->outputFile->url().toLocalFile();
+
+        const bool liveView = ui->liveViewCheckBox->isChecked();
+        config().writeEntry(QStringLiteral("liveView"), liveView);
+
+        const bool compressEnabled = ui->compressCheckBox->isChecked();
+        if (compressEnabled && PerfRecord::canCompress() && !liveView) {
+            // perf only compresses the data it writes into files, using its default level
+            perfOptions += QStringLiteral("-z");
+        }
+        config().writeEntry(QStringLiteral("compress"), compressEnabled);
+
+        const int splitOutput = ui->splitOutputSpinBox->value();
+        if (splitOutput > 0 && !liveView) {
+            // perf synthesizes the tracking events for every file, such that each can be unwound on its own
+            perfOptions += QLatin1String("--switch-output=") + QString::number(splitOutput) + QLatin1Char('M');
+        }
+        config().writeEntry(QStringLiteral("splitOutput"), splitOutput);
+        if (liveView) {
+            // let perf write into a named pipe, which gets read by the perfparser directly
+            m_liveDir.reset(new QTemporaryDir);
+            outputFile = m_liveDir->filePath(QStringLiteral("perf.fifo"));
+            if (!m_liveDir->isValid() || !Util::createFifo(outputFile)) {
+                m_liveDir.reset();
+                setError(tr("Failed to create a named pipe for the live view."));
+                recordingStopped();
+                return;
+            }
+            // the pipe has to be opened for reading before perf can start writing into it
+            emit openLiveRecording(outputFile);
+        }
 
         switch (recordType) {
         case LaunchApplication: {
@@ -532,6 +645,8 @@ void RecordPage::onStartRecordingButtonClicked(bool checked)
 
 void RecordPage::recordingStopped()
 {
+    updateRecordingStats();
+    backOffOverheadPreset();
     m_updateRuntimeTimer->stop();
     m_recordTimer.invalidate();
     ui->startRecordingButton->setChecked(false);
@@ -545,6 +660,44 @@ void RecordPage::recordingStopped()
     ui->perfInputEdit->setEnabled(false);
 }
 
+void RecordPage::updateRecordingStats()
+{
+    QStringList stats;
+    const auto writtenBytes = m_perfRecord->writtenBytes();
+    if (writtenBytes >= 0) {
+        KFormat format;
+        const auto elapsed = m_recordTimer.isValid() ? m_recordTimer.nsecsElapsed() : 0;
+        const auto throughput = elapsed > 0 ? static_cast<qint64>(writtenBytes * 1E9 / elapsed) : 0;
+        stats << tr("%1 written (%2/s)")
+                     .arg(format.formatByteSize(writtenBytes, 1, KFormat::MetricBinaryDialect),
+                          format.formatByteSize(throughput, 1, KFormat::MetricBinaryDialect));
+    }
+    const auto lostEvents = m_perfRecord->lostEvents();
+    stats << (lostEvents ? tr("<b>%1 lost</b>").arg(lostEvents) : tr("nothing lost"));
+    ui->recordingStatsLabel->setText(stats.join(QStringLiteral(", ")));
+}
+
+void RecordPage::backOffOverheadPreset()
+{
+    const auto overheadPreset = selectedOverheadPreset(ui);
+    // the timer is only valid when perf got started
+    if (!m_recordTimer.isValid() || !m_perfRecord->lostEvents()
+        || overheadPreset == PerfRecord::OverheadPreset::Custom) {
+        return;
+    }
+
+    // perf can't change the sampling settings of a running recording, so only the next one can avoid the loss
+    const auto backOffLevel = config().readEntry(QStringLiteral("overheadBackOff"), 0);
+    if (backOffLevel >= PerfRecord::MaxBackOffLevel) {
+        appendOutput(tr("\nperf lost events even with the lowest overhead settings of this preset.\n"));
+        return;
+    }
+    config().writeEntry(QStringLiteral("overheadBackOff"), backOffLevel + 1);
+    const auto settings = PerfRecord::presetSettings(overheadPreset, backOffLevel + 1);
+    appendOutput(tr("\nperf lost events, the next recording with this preset samples at %1 Hz and buffers %2 pages.\n")
+                     .arg(QString::number(settings.frequency), QString::number(settings.mmapPages)));
+}
+
 void RecordPage::stopRecording()
 {
     m_perfRecord->stopRecording();
@@ -591,7 +744,11 @@ void RecordPage::onWorkingDirectoryNameChanged(const QString& folderPath)
 
 void RecordPage::onViewPerfRecordResultsButtonClicked()
 {
-    emit openFile(m_resultsFile);
+    if (m_resultsFiles.size() == 1) {
+        emit openFile(m_resultsFiles.first());
+    } else {
+        emit openFiles(m_resultsFiles);
+    }
 }
 
 void RecordPage::onOutputFileNameChanged(const QString& /*filePath*/)
@@ -631,7 +788,12 @@ void RecordPage::onOutputFileUrlChanged(const QUrl& fileUrl)
 
 void RecordPage::updateProcesses()
 {
-    m_watcher->setFuture(QtConcurrent::run(processList));
+    if (m_watcher->isRunning()) {
+        // the next update gets scheduled once the running one finished
+        return;
+    }
+    auto scanner = m_processScanner;
+    m_watcher->setFuture(QtConcurrent::run([scanner]() { return scanner->scan(); }));
 }
 
 void RecordPage::updateProcessesFinished()
@@ -645,10 +807,27 @@ void RecordPage::updateProcessesFinished()
     if (selectedRecordType(ui) == AttachToProcess) {
         // only update the state when we show the attach app page
         updateStartRecordingButtonState(ui);
-        QTimer::singleShot(1000, this, &RecordPage::updateProcesses);
+        if (isVisible()) {
+            m_updateProcessesTimer->start();
+        }
     }
 }
 
+void RecordPage::showEvent(QShowEvent* event)
+{
+    QWidget::showEvent(event);
+    if (selectedRecordType(ui) == AttachToProcess && !ui->startRecordingButton->isChecked()) {
+        updateProcesses();
+    }
+}
+
+void RecordPage::hideEvent(QHideEvent* event)
+{
+    QWidget::hideEvent(event);
+    // don't scan /proc in the background while nobody looks at the processes
+    m_updateProcessesTimer->stop();
+}
+
 void RecordPage::appendOutput(const QString& text)
 {
     QTextCursor cursor(ui->perfResultsTextEdit->document());
@@ -31,8 +31,11 @@
 #include <QFutureWatcher>
 #include <QWidget>
 
+#include <memory>
+
 #include "processlist.h"
 
+class QTemporaryDir;
 class QTimer;
 
 namespace Ui {
@@ -62,9 +65,19 @@ public:
     void showRecordPage();
     void stopRecording();
 
+protected:
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
+
 signals:
     void homeButtonClicked();
     void openFile(QString filePath);
+    // emitted to view the results of a recording that got split into several files
+    void openFiles(QStringList filePaths);
+    // emitted when a live recording starts, @p fifoPath is the named pipe perf writes its data into
+    void openLiveRecording(QString fifoPath);
+    // emitted when a live recording failed, the parser reading from the named pipe should be stopped then
+    void liveRecordingFailed();
 
 private slots:
     void onApplicationNameChanged(const QString& filePath);
@@ -78,9 +91,12 @@ private slots:
 
     void updateProcesses();
     void updateProcessesFinished();
+    void updateRecordingStats();
 
 private:
     void recordingStopped();
+    // makes the next recording with the selected preset use less overhead when perf lost events
+    void backOffOverheadPreset();
     void updateRecordType();
     void appendOutput(const QString& text);
     void setError(const QString& message);
@@ -88,7 +104,9 @@ private:
     QScopedPointer<Ui::RecordPage> ui;
 
     PerfRecord* m_perfRecord;
-    QString m_resultsFile;
+    QStringList m_resultsFiles;
+    // holds the named pipe for live recordings
+    QScopedPointer<QTemporaryDir> m_liveDir;
     QElapsedTimer m_recordTimer;
     QTimer* m_updateRuntimeTimer;
 
@@ -96,4 +114,8 @@ private:
     ProcessFilterModel* m_processProxyModel;
 
     QFutureWatcher<ProcDataList>* m_watcher;
+    // shared with the scan in the background, which may outlive the page
+    std::shared_ptr<ProcessListScanner> m_processScanner;
+    // polls the processes while the attach page is shown
+    QTimer* m_updateProcessesTimer;
 };
@@ -39,47 +39,17 @@
 #include "parsers/perf/perfparser.h"
 #include "resultsutil.h"
 
+#include "models/arrowexport.h"
 #include "models/costdelegate.h"
 #include "models/hashmodel.h"
+#include "models/profileexport.h"
 #include "models/topproxy.h"
 #include "models/treemodel.h"
 
-namespace {
-void stackCollapsedExport(QTextStream& file, int type, const Data::Costs &costs, const Data::BottomUp &node)
-{
-    if (!node.children.isEmpty()) {
-        for (const auto& child : node.children)
-            stackCollapsedExport(file, type, costs, child);
-        return;
-    }
-
-    auto entry = &node;
-    while (entry) {
-        if (entry->symbol.symbol.isEmpty())
-            file << '[' << entry->symbol.binary << ']';
-        else
-            file << Util::formatSymbol(entry->symbol);
-        entry = entry->parent;
-        if (entry)
-            file << ';';
-    }
-
-    // leaf node, actually generate a line and write it to the file
-    file << ' ';
-    file << costs.cost(type, node.id);
-    file << '\n';
-}
-
-void stackCollapsedExport(QFile& file, int type, const Data::BottomUpResults &results)
-{
-    QTextStream stream(&file);
-    stackCollapsedExport(stream, type, results.costs, results.root);
-}
-}
-
 ResultsBottomUpPage::ResultsBottomUpPage(FilterAndZoomStack* filterStack, PerfParser* parser, QMenu* exportMenu, QWidget* parent)
     : QWidget(parent)
     , ui(new Ui::ResultsBottomUpPage)
+    , m_deferredUpdate(new ResultsUtil::DeferredUpdate(this))
 {
     ui->setupUi(this);
 
@@ -87,22 +57,31 @@ ResultsBottomUpPage::ResultsBottomUpPage(FilterAndZoomStack* filterStack, PerfPa
     ResultsUtil::setupTreeView(ui->bottomUpTreeView, ui->bottomUpSearch, bottomUpCostModel);
     ResultsUtil::setupCostDelegate(bottomUpCostModel, ui->bottomUpTreeView);
     ResultsUtil::setupContextMenu(ui->bottomUpTreeView, bottomUpCostModel, filterStack,
-                                  [this](const Data::Symbol& symbol) { emit jumpToCallerCallee(symbol); });
+                                  [this](const Data::Symbol& symbol) { emit jumpToCallerCallee(symbol); },
+                                  [this](const Data::Symbol& symbol) { emit jumpToDisassembly(symbol); });
 
     auto topHotspotsProxy = new TopProxy(this);
     topHotspotsProxy->setSourceModel(bottomUpCostModel);
 
+    auto setData = [this, bottomUpCostModel](const Data::BottomUpResults& data) {
+        m_deferredUpdate->run([this, bottomUpCostModel, data]() {
+            bottomUpCostModel->setData(data);
+            ResultsUtil::hideEmptyColumns(data.costs, ui->bottomUpTreeView, BottomUpModel::NUM_BASE_COLUMNS);
+        });
+    };
+    connect(parser, &PerfParser::partialBottomUpDataAvailable, this, setData);
+
     connect(parser, &PerfParser::bottomUpDataAvailable, this,
-            [this, bottomUpCostModel, exportMenu](const Data::BottomUpResults& data) {
-                bottomUpCostModel->setData(data);
-                ResultsUtil::hideEmptyColumns(data.costs, ui->bottomUpTreeView, BottomUpModel::NUM_BASE_COLUMNS);
+            [this, setData, exportMenu](const Data::BottomUpResults& data) {
+                setData(data);
 
+                // the exports use the data directly, as the model may not have been populated yet
                 {
                     auto stackCollapsed = exportMenu->addMenu(QIcon::fromTheme(QStringLiteral("text-plain")), tr("Stack Collapsed"));
                     stackCollapsed->setToolTip(tr("Export data in textual form compatible with <tt>flamegraph.pl</tt>."));
                     for (int i = 0; i < data.costs.numTypes(); ++i) {
                         const auto costName = data.costs.typeName(i);
-                        stackCollapsed->addAction(costName, [this, i, bottomUpCostModel, costName]() {
+                        stackCollapsed->addAction(costName, [this, i, data, costName]() {
                             const auto fileName = QFileDialog::getSaveFileName(this, tr("Export %1 Data").arg(costName));
                             if (fileName.isEmpty())
                                 return;
@@ -112,16 +91,54 @@ ResultsBottomUpPage::ResultsBottomUpPage(FilterAndZoomStack* filterStack, PerfPa
                                                      tr("Failed to export stack collapsed data:\n%1").arg(file.errorString()));
                                 return;
                             }
-                            stackCollapsedExport(file, i, bottomUpCostModel->results());
+                            if (!ProfileExport::writeCollapsed(&file, data, i)) {
+                                const auto error = tr("Failed to export stack collapsed data:\n%1");
+                                QMessageBox::warning(this, tr("Failed to export data"), error.arg(file.errorString()));
+                            }
                         });
                     }
                 }
+
+                auto pprof =
+                    exportMenu->addAction(QIcon::fromTheme(QStringLiteral("application-octet-stream")), tr("pprof"));
+                pprof->setToolTip(tr("Export the samples of all threads as a pprof protobuf profile."));
+                connect(pprof, &QAction::triggered, this, [this, data]() {
+                    const auto fileName = QFileDialog::getSaveFileName(this, tr("Export pprof Profile"), {},
+                                                                       tr("pprof Profile (*.pb)"));
+                    if (fileName.isEmpty())
+                        return;
+                    QFile file(fileName);
+                    if (!file.open(QIODevice::WriteOnly)
+                        || !ProfileExport::writePprof(&file, data, m_events)) {
+                        QMessageBox::warning(this, tr("Failed to export data"),
+                                             tr("Failed to export pprof profile:\n%1").arg(file.errorString()));
+                    }
+                });
+
+                auto arrow = exportMenu->addAction(QIcon::fromTheme(QStringLiteral("folder")), tr("Arrow Tables"));
+                arrow->setToolTip(tr("Export the events with their stacks, locations and symbols as Arrow IPC "
+                                     "streams, e.g. to analyze them with pandas."));
+                connect(arrow, &QAction::triggered, this, [this, data]() {
+                    const auto directory = QFileDialog::getExistingDirectory(this, tr("Export Arrow Tables"));
+                    if (directory.isEmpty())
+                        return;
+                    const auto error = ArrowExport::writeDirectory(directory, data, m_events);
+                    if (!error.isEmpty()) {
+                        QMessageBox::warning(this, tr("Failed to export data"),
+                                             tr("Failed to export the Arrow tables:\n%1").arg(error));
+                    }
+                });
             });
+
+    connect(parser, &PerfParser::eventsAvailable, this,
+            [this](const Data::EventResults& events) { m_events = events; });
 }
 
 ResultsBottomUpPage::~ResultsBottomUpPage() = default;
 
 void ResultsBottomUpPage::clear()
 {
+    m_deferredUpdate->cancel();
     ui->bottomUpSearch->setText({});
+    m_events = {};
 }
@@ -29,21 +29,23 @@
 
 #include <QWidget>
 
+#include "models/data.h"
+
 class QMenu;
 
 namespace Ui {
 class ResultsBottomUpPage;
 }
 
-namespace Data {
-struct Symbol;
-}
-
 class QTreeView;
 
 class PerfParser;
 class FilterAndZoomStack;
 
+namespace ResultsUtil {
+class DeferredUpdate;
+}
+
 class ResultsBottomUpPage : public QWidget
 {
     Q_OBJECT
@@ -56,7 +58,12 @@ public:
 
 signals:
     void jumpToCallerCallee(const Data::Symbol& symbol);
+    void jumpToDisassembly(const Data::Symbol& symbol);
 
 private:
     QScopedPointer<Ui::ResultsBottomUpPage> ui;
+    // the model only gets populated once the page is shown
+    ResultsUtil::DeferredUpdate* m_deferredUpdate;
+    // the stacks of the events carry the locations needed for the pprof export
+    Data::EventResults m_events;
 };
@@ -32,7 +32,6 @@
 #include <QDir>
 #include <QFileInfo>
 #include <QMenu>
-#include <QSortFilterProxyModel>
 
 #include "parsers/perf/perfparser.h"
 #include "resultsutil.h"
@@ -48,9 +47,8 @@ template<typename Model>
 Model* setupModelAndProxyForView(QTreeView* view)
 {
     auto model = new Model(view);
-    auto proxy = new QSortFilterProxyModel(model);
+    auto proxy = new HashModelProxy(model);
     proxy->setSourceModel(model);
-    proxy->setSortRole(Model::SortRole);
     view->sortByColumn(Model::InitialSortColumn, Qt::DescendingOrder);
     view->setModel(proxy);
     ResultsUtil::stretchFirstColumn(view);
@@ -73,32 +71,35 @@ void connectCallerOrCalleeModel(QTreeView* view, CallerCalleeModel* callerCallee
 ResultsCallerCalleePage::ResultsCallerCalleePage(FilterAndZoomStack* filterStack, PerfParser* parser, QWidget* parent)
     : QWidget(parent)
     , ui(new Ui::ResultsCallerCalleePage)
+    , m_deferredUpdate(new ResultsUtil::DeferredUpdate(this))
 {
     ui->setupUi(this);
 
     m_callerCalleeCostModel = new CallerCalleeModel(this);
-    m_callerCalleeProxy = new QSortFilterProxyModel(this);
+    m_callerCalleeProxy = new HashModelProxy(this);
     m_callerCalleeProxy->setSourceModel(m_callerCalleeCostModel);
-    m_callerCalleeProxy->setSortRole(CallerCalleeModel::SortRole);
     ui->callerCalleeFilter->setProxy(m_callerCalleeProxy);
     ui->callerCalleeTableView->setSortingEnabled(true);
     ui->callerCalleeTableView->setModel(m_callerCalleeProxy);
-    ResultsUtil::setupContextMenu(ui->callerCalleeTableView, CallerCalleeModel::SymbolRole, filterStack, {});
+    ResultsUtil::setupContextMenu(ui->callerCalleeTableView, CallerCalleeModel::SymbolRole, filterStack, {},
+                                  [this](const Data::Symbol& symbol) { emit jumpToDisassembly(symbol); });
     ResultsUtil::stretchFirstColumn(ui->callerCalleeTableView);
     ResultsUtil::setupCostDelegate(m_callerCalleeCostModel, ui->callerCalleeTableView);
 
     connect(parser, &PerfParser::callerCalleeDataAvailable, this, [this](const Data::CallerCalleeResults& data) {
-        m_callerCalleeCostModel->setResults(data);
-        ResultsUtil::hideEmptyColumns(data.inclusiveCosts, ui->callerCalleeTableView,
-                                      CallerCalleeModel::NUM_BASE_COLUMNS);
-        ResultsUtil::hideEmptyColumns(data.selfCosts, ui->callerCalleeTableView,
-                                      CallerCalleeModel::NUM_BASE_COLUMNS + data.inclusiveCosts.numTypes());
-        auto view = ui->callerCalleeTableView;
-        view->sortByColumn(CallerCalleeModel::InitialSortColumn, view->header()->sortIndicatorOrder());
-        view->setCurrentIndex(view->model()->index(0, 0, {}));
-        ResultsUtil::hideEmptyColumns(data.inclusiveCosts, ui->callersView, CallerModel::NUM_BASE_COLUMNS);
-        ResultsUtil::hideEmptyColumns(data.inclusiveCosts, ui->calleesView, CalleeModel::NUM_BASE_COLUMNS);
-        ResultsUtil::hideEmptyColumns(data.inclusiveCosts, ui->sourceMapView, SourceMapModel::NUM_BASE_COLUMNS);
+        m_deferredUpdate->run([this, data]() {
+            m_callerCalleeCostModel->setResults(data);
+            ResultsUtil::hideEmptyColumns(data.inclusiveCosts, ui->callerCalleeTableView,
+                                          CallerCalleeModel::NUM_BASE_COLUMNS);
+            ResultsUtil::hideEmptyColumns(data.selfCosts, ui->callerCalleeTableView,
+                                          CallerCalleeModel::NUM_BASE_COLUMNS + data.inclusiveCosts.numTypes());
+            auto view = ui->callerCalleeTableView;
+            view->sortByColumn(CallerCalleeModel::InitialSortColumn, view->header()->sortIndicatorOrder());
+            view->setCurrentIndex(view->model()->index(0, 0, {}));
+            ResultsUtil::hideEmptyColumns(data.inclusiveCosts, ui->callersView, CallerModel::NUM_BASE_COLUMNS);
+            ResultsUtil::hideEmptyColumns(data.inclusiveCosts, ui->calleesView, CalleeModel::NUM_BASE_COLUMNS);
+            ResultsUtil::hideEmptyColumns(data.inclusiveCosts, ui->sourceMapView, SourceMapModel::NUM_BASE_COLUMNS);
+        });
     });
 
     auto calleesModel = setupModelAndProxyForView<CalleeModel>(ui->calleesView);
@@ -211,11 +212,14 @@ void ResultsCallerCalleePage::setAppPath(const QString& path)
 
 void ResultsCallerCalleePage::clear()
 {
+    m_deferredUpdate->cancel();
     ui->callerCalleeFilter->setText({});
 }
 
 void ResultsCallerCalleePage::jumpToCallerCallee(const Data::Symbol& symbol)
 {
+    // the symbol has to be looked up in the latest data
+    m_deferredUpdate->flush();
     auto callerCalleeIndex = m_callerCalleeProxy->mapFromSource(m_callerCalleeCostModel->indexForSymbol(symbol));
     ui->callerCalleeTableView->setCurrentIndex(callerCalleeIndex);
 }
@@ -44,6 +44,10 @@ class PerfParser;
 class CallerCalleeModel;
 class FilterAndZoomStack;
 
+namespace ResultsUtil {
+class DeferredUpdate;
+}
+
 class ResultsCallerCalleePage : public QWidget
 {
     Q_OBJECT
@@ -63,6 +67,7 @@ private slots:
 
 signals:
     void navigateToCode(const QString& url, int lineNumber, int columnNumber);
+    void jumpToDisassembly(const Data::Symbol& symbol);
 
 private:
     struct SourceMapLocation
@@ -81,6 +86,8 @@ private:
 
     CallerCalleeModel* m_callerCalleeCostModel;
     QSortFilterProxyModel* m_callerCalleeProxy;
+    // the models only get populated once the page is shown
+    ResultsUtil::DeferredUpdate* m_deferredUpdate;
 
     QString m_sysroot;
     QString m_appPath;
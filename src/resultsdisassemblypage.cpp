@@ -0,0 +1,156 @@
+/*
+  resultsdisassemblypage.cpp
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "resultsdisassemblypage.h"
+#include "ui_resultsdisassemblypage.h"
+
+#include <QFileInfo>
+#include <QSortFilterProxyModel>
+
+#include "parsers/perf/perfparser.h"
+#include "resultsutil.h"
+#include "util.h"
+
+#include "models/disassemblymodel.h"
+
+ResultsDisassemblyPage::ResultsDisassemblyPage(PerfParser* parser, QWidget* parent)
+    : QWidget(parent)
+    , ui(new Ui::ResultsDisassemblyPage)
+    , m_model(new DisassemblyModel(this))
+{
+    ui->setupUi(this);
+
+    auto* proxy = new QSortFilterProxyModel(this);
+    proxy->setSourceModel(m_model);
+    proxy->setSortRole(DisassemblyModel::SortRole);
+    proxy->setFilterKeyColumn(-1);
+    ui->disassemblyFilter->setProxy(proxy);
+    ui->disassemblyView->setModel(proxy);
+    ui->disassemblyView->sortByColumn(DisassemblyModel::InitialSortColumn, Qt::AscendingOrder);
+    ResultsUtil::setupCostDelegate(m_model, ui->disassemblyView);
+
+    connect(parser, &PerfParser::bottomUpDataAvailable, this,
+            [this](const Data::BottomUpResults& data) { m_bottomUp = data; });
+    connect(parser, &PerfParser::eventsAvailable, this, [this](const Data::EventResults& data) {
+        m_events = data;
+        // the costs change when filtering, the instructions stay the same
+        updateDisassembly();
+    });
+
+    updateDisassembly();
+}
+
+ResultsDisassemblyPage::~ResultsDisassemblyPage() = default;
+
+void ResultsDisassemblyPage::clear()
+{
+    m_bottomUp = {};
+    m_events = {};
+    m_symbol = {};
+    m_results = {};
+    ui->disassemblyFilter->setText({});
+    updateDisassembly();
+}
+
+void ResultsDisassemblyPage::setSysroot(const QString& path)
+{
+    m_sysroot = path;
+}
+
+void ResultsDisassemblyPage::showDisassembly(const Data::Symbol& symbol)
+{
+    if (symbol == m_symbol) {
+        return;
+    }
+    m_symbol = symbol;
+    updateDisassembly();
+}
+
+void ResultsDisassemblyPage::updateDisassembly()
+{
+    m_jobs.cancel();
+    if (!m_symbol.isValid()) {
+        ui->symbolLabel->setText(tr("Use \"Show Disassembly\" in the context menu of a symbol to look at the costs "
+                                    "of its instructions."));
+        ui->statusLabel->hide();
+        m_model->setResults({});
+        return;
+    }
+
+    ui->symbolLabel->setText(tr("Disassembly of %1 in %2").arg(Util::formatSymbol(m_symbol), m_symbol.binary));
+    ui->statusLabel->setText(tr("Disassembling, please wait..."));
+    ui->statusLabel->show();
+
+    // objdump only needs to run once per symbol, filtering merely changes the costs of the instructions
+    QVector<Data::DisassemblyLine> lines;
+    if (m_results.symbol == m_symbol && m_results.error.isEmpty()) {
+        lines = m_results.lines.mid(0, m_results.numInstructions);
+    }
+
+    auto binaryPath = m_symbol.path;
+    if (!m_sysroot.isEmpty() && QFileInfo::exists(m_sysroot + binaryPath)) {
+        binaryPath = m_sysroot + binaryPath;
+    }
+
+    const auto symbol = m_symbol;
+    const auto events = m_events;
+    const auto bottomUp = m_bottomUp;
+    const auto disassemble = [symbol, binaryPath, lines, events, bottomUp, this](const JobScheduler::Token& token) {
+        const auto costs = Data::AddressCosts::fromEvents(symbol, events, bottomUp);
+        if (token.isCanceled()) {
+            return;
+        }
+        const auto results = lines.isEmpty() ? Data::DisassemblyResults::disassemble(symbol, binaryPath, costs)
+                                             : Data::DisassemblyResults::fromLines(symbol, lines, costs);
+        if (token.isCanceled()) {
+            return;
+        }
+        QMetaObject::invokeMethod(this, "setResults", Qt::QueuedConnection,
+                                  Q_ARG(Data::DisassemblyResults, results), Q_ARG(uint, token.generation()));
+    };
+    // the disassembly got requested explicitly, so the user is waiting for it
+    m_jobs.schedule(JobScheduler::Priority::Visible, disassemble);
+}
+
+void ResultsDisassemblyPage::setResults(const Data::DisassemblyResults& results, uint generation)
+{
+    if (!m_jobs.isCurrent(generation)) {
+        return;
+    }
+    m_results = results;
+    m_model->setResults(results);
+
+    ui->statusLabel->setText(results.error);
+    ui->statusLabel->setVisible(!results.error.isEmpty());
+
+    for (int i = 0, c = m_model->columnCount(); i < c; ++i) {
+        ui->disassemblyView->showColumn(i);
+    }
+    ResultsUtil::hideEmptyColumns(results.selfCosts, ui->disassemblyView, DisassemblyModel::NUM_BASE_COLUMNS);
+    ResultsUtil::hideEmptyColumns(results.inclusiveCosts, ui->disassemblyView,
+                                  DisassemblyModel::NUM_BASE_COLUMNS + results.selfCosts.numTypes());
+}
@@ -0,0 +1,68 @@
+/*
+  resultsdisassemblypage.h
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <QWidget>
+
+#include "models/disassembly.h"
+#include "models/jobscheduler.h"
+
+namespace Ui {
+class ResultsDisassemblyPage;
+}
+
+class PerfParser;
+class DisassemblyModel;
+
+class ResultsDisassemblyPage : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit ResultsDisassemblyPage(PerfParser* parser, QWidget* parent = nullptr);
+    ~ResultsDisassemblyPage();
+
+    void clear();
+    void setSysroot(const QString& path);
+    void showDisassembly(const Data::Symbol& symbol);
+
+private slots:
+    void setResults(const Data::DisassemblyResults& results, uint generation);
+
+private:
+    void updateDisassembly();
+
+    QScopedPointer<Ui::ResultsDisassemblyPage> ui;
+    DisassemblyModel* m_model;
+    Data::BottomUpResults m_bottomUp;
+    Data::EventResults m_events;
+    QString m_sysroot;
+    Data::Symbol m_symbol;
+    Data::DisassemblyResults m_results;
+    // every new symbol or set of events supersedes the last one, such that outdated results get dropped
+    JobScheduler m_jobs;
+};
@@ -63,13 +63,18 @@ ResultsFlameGraphPage::ResultsFlameGraphPage(FilterAndZoomStack* filterStack, Pe
                 ui->flameGraph->setBottomUpData(data);
                 m_exportAction = exportMenu->addAction(QIcon::fromTheme(QStringLiteral("image-x-generic")), tr("Flamegraph"));
                 connect(m_exportAction, &QAction::triggered, this, [this]() {
-                    const auto filter = tr("Images (%1);;SVG (*.svg)").arg(imageFormatFilter());
+                    const auto interactiveSvgFilter = tr("Interactive SVG (*.svg)");
+                    const auto filter =
+                        tr("Images (%1);;SVG (*.svg);;%2").arg(imageFormatFilter(), interactiveSvgFilter);
                     QString selectedFilter;
                     const auto fileName = QFileDialog::getSaveFileName(this, tr("Export Flamegraph"), {}, filter, &selectedFilter);
                     if (fileName.isEmpty())
                         return;
                     if (selectedFilter.contains(QStringLiteral("svg"))) {
-                        ui->flameGraph->saveSvg(fileName);
+                        if (!ui->flameGraph->saveSvg(fileName, selectedFilter == interactiveSvgFilter)) {
+                            QMessageBox::warning(this, tr("Export Failed"),
+                                                 tr("Failed to export flamegraph to %1.").arg(fileName));
+                        }
                     } else {
                         QImageWriter writer(fileName);
                         if (!writer.write(ui->flameGraph->toImage())) {
@@ -83,6 +88,11 @@ ResultsFlameGraphPage::ResultsFlameGraphPage(FilterAndZoomStack* filterStack, Pe
     connect(parser, &PerfParser::topDownDataAvailable, this,
             [this](const Data::TopDownResults& data) { ui->flameGraph->setTopDownData(data); });
 
+    connect(parser, &PerfParser::partialBottomUpDataAvailable, this,
+            [this](const Data::BottomUpResults& data) { ui->flameGraph->setBottomUpData(data); });
+    connect(parser, &PerfParser::partialTopDownDataAvailable, this,
+            [this](const Data::TopDownResults& data) { ui->flameGraph->setTopDownData(data); });
+
     connect(ui->flameGraph, &FlameGraph::jumpToCallerCallee, this, &ResultsFlameGraphPage::jumpToCallerCallee);
 }
 
@@ -0,0 +1,181 @@
+/*
+  resultslatencypage.cpp
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "resultslatencypage.h"
+#include "ui_resultslatencypage.h"
+
+#include <QSignalBlocker>
+#include <QSortFilterProxyModel>
+
+#include <algorithm>
+#include <limits>
+
+#include "parsers/perf/perfparser.h"
+#include "resultsutil.h"
+#include "util.h"
+
+#include "models/latencymodel.h"
+
+ResultsLatencyPage::ResultsLatencyPage(FilterAndZoomStack* filterStack, PerfParser* parser, QWidget* parent)
+    : QWidget(parent)
+    , ui(new Ui::ResultsLatencyPage)
+    , m_model(new LatencyModel(this))
+    , m_deferredUpdate(new ResultsUtil::DeferredUpdate(this))
+{
+    ui->setupUi(this);
+
+    auto* proxy = new QSortFilterProxyModel(this);
+    proxy->setSourceModel(m_model);
+    proxy->setSortRole(LatencyModel::SortRole);
+    proxy->setFilterKeyColumn(LatencyModel::NameColumn);
+    ui->latencyFilter->setProxy(proxy);
+    ui->latencyView->setModel(proxy);
+    ui->latencyView->sortByColumn(LatencyModel::InitialSortColumn, Qt::DescendingOrder);
+    ResultsUtil::stretchFirstColumn(ui->latencyView);
+    ResultsUtil::setupContextMenu(ui->latencyView, LatencyModel::SymbolRole, filterStack,
+                                  [this](const Data::Symbol& symbol) { emit jumpToCallerCallee(symbol); });
+
+    connect(ui->latencyView, &QTreeView::activated, this, [this](const QModelIndex& index) {
+        const auto symbol = index.data(LatencyModel::SymbolRole).value<Data::Symbol>();
+        if (symbol.isValid()) {
+            emit jumpToCallerCallee(symbol);
+        }
+    });
+    connect(ui->latencyView->selectionModel(), &QItemSelectionModel::currentRowChanged, this,
+            [this](const QModelIndex& current, const QModelIndex&) { showSlowest(current); });
+    connect(ui->sourceComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this,
+            &ResultsLatencyPage::updateEntries);
+    connect(ui->groupingComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this,
+            &ResultsLatencyPage::updateEntries);
+
+    connect(parser, &PerfParser::bottomUpDataAvailable, this,
+            [this](const Data::BottomUpResults& data) { m_bottomUp = data; });
+    connect(parser, &PerfParser::eventsAvailable, this, [this](const Data::EventResults& data) {
+        m_events = data;
+        m_startTime = std::numeric_limits<quint64>::max();
+        for (const auto& thread : data.threads) {
+            m_startTime = std::min(m_startTime, thread.time.start);
+        }
+        // drop the results for the previous events right away, even when the new ones don't get computed yet
+        m_jobs.cancel();
+        const auto bottomUp = m_bottomUp;
+        const auto computeLatencies = [data, bottomUp, this](const JobScheduler::Token& token) {
+            const auto results = Data::LatencyResults::fromEvents(data, bottomUp);
+            if (token.isCanceled()) {
+                return;
+            }
+            QMetaObject::invokeMethod(this, "setLatencies", Qt::QueuedConnection,
+                                      Q_ARG(Data::LatencyResults, results), Q_ARG(uint, token.generation()));
+        };
+        // the latencies only get computed once the page is shown, the user is waiting for them then
+        m_deferredUpdate->run(
+            [this, computeLatencies]() { m_jobs.schedule(JobScheduler::Priority::Visible, computeLatencies); });
+    });
+}
+
+ResultsLatencyPage::~ResultsLatencyPage() = default;
+
+void ResultsLatencyPage::clear()
+{
+    m_deferredUpdate->cancel();
+    m_bottomUp = {};
+    m_events = {};
+    setLatencies({}, m_jobs.cancel());
+    ui->latencyFilter->setText({});
+}
+
+void ResultsLatencyPage::setLatencies(const Data::LatencyResults& results, uint generation)
+{
+    if (!m_jobs.isCurrent(generation)) {
+        return;
+    }
+    m_results = results;
+
+    // keep showing the same kind of waits after filtering
+    const auto currentSource = ui->sourceComboBox->currentText();
+    {
+        QSignalBlocker blocker(ui->sourceComboBox);
+        ui->sourceComboBox->clear();
+        for (const auto& source : m_results.sources) {
+            ui->sourceComboBox->addItem(source.name);
+        }
+        ui->sourceComboBox->setCurrentIndex(std::max(0, ui->sourceComboBox->findText(currentSource)));
+    }
+    updateEntries();
+}
+
+void ResultsLatencyPage::updateEntries()
+{
+    ui->tailView->clear();
+    const auto sourceIndex = ui->sourceComboBox->currentIndex();
+    if (sourceIndex < 0 || sourceIndex >= m_results.sources.size()) {
+        ui->summaryLabel->setText(tr("No off-CPU time or paired tracepoints got recorded."));
+        m_model->setEntries({});
+        return;
+    }
+
+    const auto& source = m_results.sources.at(sourceIndex);
+    const auto& histogram = source.histogram;
+    ui->summaryLabel->setText(tr("%1 waits, total: %2, p50: %3, p99: %4, p99.9: %5, max: %6")
+                                  .arg(QString::number(histogram.count()), Util::formatTimeString(histogram.total()),
+                                       Util::formatTimeString(histogram.percentile(50)),
+                                       Util::formatTimeString(histogram.percentile(99)),
+                                       Util::formatTimeString(histogram.percentile(99.9)),
+                                       Util::formatTimeString(histogram.max())));
+
+    const auto grouping = qBound(0, ui->groupingComboBox->currentIndex(), Data::LatencySource::NUM_GROUPINGS - 1);
+    m_model->setEntries(source.entries[grouping]);
+}
+
+void ResultsLatencyPage::showSlowest(const QModelIndex& index)
+{
+    ui->tailView->clear();
+    const auto slowest = index.data(LatencyModel::SlowestRole).value<QVector<Data::LatencyInterval>>();
+    for (const auto& interval : slowest) {
+        auto* item = new QTreeWidgetItem(ui->tailView);
+        item->setText(0, Util::formatTimeString(interval.duration));
+        item->setText(1, Util::formatTimeString(interval.time - std::min(interval.time, m_startTime)));
+        if (interval.threadIndex >= 0 && interval.threadIndex < m_events.threads.size()) {
+            const auto& thread = m_events.threads.at(interval.threadIndex);
+            item->setText(2, tr("%1 (#%2)").arg(thread.name, QString::number(thread.tid)));
+        }
+
+        if (interval.stackId < 0 || interval.stackId >= m_events.stacks.size()) {
+            continue;
+        }
+        m_bottomUp.foreachFrame(m_events.stacks.at(interval.stackId),
+                                [item](const Data::Symbol& symbol, const Data::Location& location) {
+                                    auto* frame = new QTreeWidgetItem(item);
+                                    frame->setFirstColumnSpanned(true);
+                                    frame->setText(0, Util::formatSymbol(symbol));
+                                    frame->setToolTip(0, location.location.isEmpty() ? symbol.binary
+                                                                                     : location.location);
+                                    return true;
+                                });
+    }
+}
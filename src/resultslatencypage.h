@@ -0,0 +1,80 @@
+/*
+  resultslatencypage.h
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2016-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Milian Wolff <milian.wolff@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <QWidget>
+
+#include "models/jobscheduler.h"
+#include "models/latencies.h"
+
+namespace Ui {
+class ResultsLatencyPage;
+}
+
+class QModelIndex;
+
+class PerfParser;
+class FilterAndZoomStack;
+class LatencyModel;
+
+namespace ResultsUtil {
+class DeferredUpdate;
+}
+
+class ResultsLatencyPage : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit ResultsLatencyPage(FilterAndZoomStack* filterStack, PerfParser* parser, QWidget* parent = nullptr);
+    ~ResultsLatencyPage();
+
+    void clear();
+
+signals:
+    void jumpToCallerCallee(const Data::Symbol& symbol);
+
+private slots:
+    void setLatencies(const Data::LatencyResults& results, uint generation);
+
+private:
+    void updateEntries();
+    void showSlowest(const QModelIndex& index);
+
+    QScopedPointer<Ui::ResultsLatencyPage> ui;
+    LatencyModel* m_model;
+    // the latencies only get computed once the page is shown
+    ResultsUtil::DeferredUpdate* m_deferredUpdate;
+    // the stacks of the slowest waits get resolved on demand
+    Data::BottomUpResults m_bottomUp;
+    Data::EventResults m_events;
+    quint64 m_startTime = 0;
+    Data::LatencyResults m_results;
+    // every new set of events supersedes the last one, such that outdated results get dropped
+    JobScheduler m_jobs;
+};
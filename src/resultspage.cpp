@@ -32,18 +32,23 @@
 
 #include "resultsbottomuppage.h"
 #include "resultscallercalleepage.h"
+#include "resultsdisassemblypage.h"
 #include "resultsflamegraphpage.h"
+#include "resultslatencypage.h"
 #include "resultssummarypage.h"
 #include "resultstopdownpage.h"
 #include "resultsutil.h"
+#include "util.h"
 
 #include "models/eventmodel.h"
 #include "models/timelinedelegate.h"
+#include "models/timelineproxy.h"
 #include "models/filterandzoomstack.h"
 
+#include <KFormat>
 #include <KLocalizedString>
-#include <KRecursiveFilterProxyModel>
 
+#include <QAction>
 #include <QDebug>
 #include <QEvent>
 #include <QProgressBar>
@@ -62,6 +67,8 @@ ResultsPage::ResultsPage(PerfParser* parser, QWidget* parent)
     , m_resultsTopDownPage(new ResultsTopDownPage(m_filterAndZoomStack, parser, this))
     , m_resultsFlameGraphPage(new ResultsFlameGraphPage(m_filterAndZoomStack, parser, m_exportMenu, this))
     , m_resultsCallerCalleePage(new ResultsCallerCalleePage(m_filterAndZoomStack, parser, this))
+    , m_resultsLatencyPage(new ResultsLatencyPage(m_filterAndZoomStack, parser, this))
+    , m_resultsDisassemblyPage(new ResultsDisassemblyPage(parser, this))
     , m_timeLineDelegate(nullptr)
     , m_filterBusyIndicator(nullptr) // create after we setup the UI to keep it on top
     , m_timelineVisible(true)
@@ -86,6 +93,8 @@ ResultsPage::ResultsPage(PerfParser* parser, QWidget* parent)
     ui->resultsTabWidget->addTab(m_resultsTopDownPage, tr("Top Down"));
     ui->resultsTabWidget->addTab(m_resultsFlameGraphPage, tr("Flame Graph"));
     ui->resultsTabWidget->addTab(m_resultsCallerCalleePage, tr("Caller / Callee"));
+    ui->resultsTabWidget->addTab(m_resultsLatencyPage, tr("Latencies"));
+    ui->resultsTabWidget->addTab(m_resultsDisassemblyPage, tr("Disassembly"));
     ui->resultsTabWidget->setCurrentWidget(m_resultsSummaryPage);
 
     for (int i = 0, c = ui->resultsTabWidget->count(); i < c; ++i) {
@@ -93,7 +102,7 @@ ResultsPage::ResultsPage(PerfParser* parser, QWidget* parent)
     }
 
     auto* eventModel = new EventModel(this);
-    auto* timeLineProxy = new KRecursiveFilterProxyModel(this);
+    auto* timeLineProxy = new TimeLineProxy(this);
     timeLineProxy->setSourceModel(eventModel);
     timeLineProxy->setSortRole(EventModel::SortRole);
     timeLineProxy->setFilterKeyColumn(EventModel::ThreadColumn);
@@ -114,11 +123,51 @@ ResultsPage::ResultsPage(PerfParser* parser, QWidget* parent)
     connect(timeLineProxy, &QAbstractItemModel::rowsInserted, this, [this]() { ui->timeLineView->expandToDepth(1); });
     connect(timeLineProxy, &QAbstractItemModel::modelReset, this, [this]() { ui->timeLineView->expandToDepth(1); });
 
-    connect(parser, &PerfParser::bottomUpDataAvailable, this, [this](const Data::BottomUpResults& data) {
+    {
+        auto* onlyActiveThreads = new QAction(QIcon::fromTheme(QStringLiteral("view-filter")),
+                                              tr("Only Show Threads Active In View"), this);
+        onlyActiveThreads->setCheckable(true);
+        onlyActiveThreads->setToolTip(
+            tr("Hide the threads of the timeline that are not alive within the zoomed in time range."));
+        connect(onlyActiveThreads, &QAction::toggled, timeLineProxy, &TimeLineProxy::setOnlyActiveThreads);
+        connect(m_filterAndZoomStack, &FilterAndZoomStack::zoomChanged, timeLineProxy,
+                [timeLineProxy](const Data::ZoomAction& zoom) { timeLineProxy->setVisibleTime(zoom.time); });
+        m_filterMenu->addSeparator();
+        m_filterMenu->addAction(onlyActiveThreads);
+        m_filterMenu->addAction(m_filterAndZoomStack->actions().showInlinedFunctions);
+        m_filterMenu->addAction(m_filterAndZoomStack->actions().collapseRecursion);
+        m_filterMenu->addAction(m_filterAndZoomStack->actions().approximateResults);
+        m_filterMenu->addAction(m_filterAndZoomStack->actions().pruneTrees);
+    }
+
+    auto setBottomUpData = [this](const Data::BottomUpResults& data) {
         ResultsUtil::fillEventSourceComboBox(ui->timeLineEventSource, data.costs,
                                              ki18n("Show timeline for %1 events."));
+    };
+    connect(parser, &PerfParser::bottomUpDataAvailable, this, setBottomUpData);
+    connect(parser, &PerfParser::partialBottomUpDataAvailable, this, setBottomUpData);
+    connect(parser, &PerfParser::bottomUpDataAvailable, this,
+            [this](const Data::BottomUpResults& data) { m_bottomUp = data; });
+    connect(parser, &PerfParser::eventsAvailable, this, [this](const Data::EventResults& data) {
+        // filtered results share the stacks of the full results, so we only need to index them once
+        if (data.stacks.size() == m_indexedStacks) {
+            return;
+        }
+        m_indexedStacks = data.stacks.size();
+        const auto stacks = data.stacks;
+        const auto bottomUp = m_bottomUp;
+        const auto buildIndex = [stacks, bottomUp, this](const JobScheduler::Token& token) {
+            const auto index = Data::SymbolStackIndex(stacks, bottomUp);
+            if (token.isCanceled()) {
+                return;
+            }
+            QMetaObject::invokeMethod(this, "setSymbolStackIndex", Qt::QueuedConnection,
+                                      Q_ARG(Data::SymbolStackIndex, index), Q_ARG(uint, token.generation()));
+        };
+        // the index only speeds up highlighting symbols in the time line later on
+        m_symbolStackJobs.schedule(JobScheduler::Priority::Background, buildIndex);
     });
-    connect(parser, &PerfParser::eventsAvailable, this, [this, eventModel](const Data::EventResults& data) {
+    auto setEventData = [this, eventModel](const Data::EventResults& data) {
         eventModel->setData(data);
         if (data.offCpuTimeCostId != -1) {
             // remove the off-CPU time event source, we only want normal sched switches
@@ -129,6 +178,19 @@ ResultsPage::ResultsPage(PerfParser* parser, QWidget* parent)
                 }
             }
         }
+    };
+    connect(parser, &PerfParser::eventsAvailable, this, setEventData);
+    // show the CPUs in the time line right away, their events get added once parsing finished
+    connect(parser, &PerfParser::headerDataAvailable, this, [eventModel](const PerfHeader::Info& header) {
+        Data::EventResults data;
+        data.numCpus = header.summary.cpusAvailable;
+        data.cpuNumaNodes = header.cpuNumaNodes;
+        eventModel->setData(data);
+    });
+    connect(parser, &PerfParser::partialEventsAvailable, this, [this, setEventData](const Data::EventResults& data) {
+        setEventData(data);
+        // don't hide the live timeline, it stays disabled until the recording stops though
+        m_filterBusyIndicator->setVisible(false);
     });
     connect(m_filterAndZoomStack, &FilterAndZoomStack::filterChanged, parser, &PerfParser::filterResults);
 
@@ -161,6 +223,12 @@ ResultsPage::ResultsPage(PerfParser* parser, QWidget* parent)
     connect(m_resultsTopDownPage, &ResultsTopDownPage::jumpToCallerCallee, this, &ResultsPage::onJumpToCallerCallee);
     connect(m_resultsFlameGraphPage, &ResultsFlameGraphPage::jumpToCallerCallee, this,
             &ResultsPage::onJumpToCallerCallee);
+    connect(m_resultsLatencyPage, &ResultsLatencyPage::jumpToCallerCallee, this, &ResultsPage::onJumpToCallerCallee);
+
+    connect(m_resultsBottomUpPage, &ResultsBottomUpPage::jumpToDisassembly, this, &ResultsPage::onJumpToDisassembly);
+    connect(m_resultsTopDownPage, &ResultsTopDownPage::jumpToDisassembly, this, &ResultsPage::onJumpToDisassembly);
+    connect(m_resultsCallerCalleePage, &ResultsCallerCalleePage::jumpToDisassembly, this,
+            &ResultsPage::onJumpToDisassembly);
 
     {
         // create a busy indicator
@@ -176,6 +244,36 @@ ResultsPage::ResultsPage(PerfParser* parser, QWidget* parent)
         label->setAlignment(Qt::AlignHCenter | Qt::AlignTop);
         m_filterBusyIndicator->layout()->addWidget(label);
         ui->timeLineArea->installEventFilter(this);
+
+        // while we only show partial results of the initial parse, indicate its progress
+        connect(parser, &PerfParser::parsingStarted, this, [this, progressBar, label]() {
+            progressBar->setMaximum(0);
+            progressBar->setFormat(QStringLiteral("%p%"));
+            label->setText(m_filterBusyIndicator->toolTip());
+        });
+        connect(parser, &PerfParser::headerDataAvailable, this, [label](const PerfHeader::Info& header) {
+            KFormat format;
+            auto text = tr("Parsing %1 of recorded data...")
+                            .arg(format.formatByteSize(header.dataSize, 1, KFormat::MetricBinaryDialect));
+            if (header.sampleTime.isValid()) {
+                text = tr("Parsing %1 of data, recorded over %2...")
+                           .arg(format.formatByteSize(header.dataSize, 1, KFormat::MetricBinaryDialect),
+                                Util::formatTimeString(header.summary.applicationRunningTime));
+            }
+            label->setText(text);
+        });
+        connect(parser, &PerfParser::partialBottomUpDataAvailable, this,
+                [label]() { label->setText(tr("Parsing in progress, showing partial results...")); });
+        connect(parser, &PerfParser::progress, this, [progressBar](float percent) {
+            const int scale = 1000;
+            progressBar->setMaximum(scale);
+            progressBar->setValue(static_cast<int>(percent * scale));
+        });
+        connect(parser, &PerfParser::parseProgress, this, [progressBar](const Data::ParseProgress& progress) {
+            const auto text = Util::formatParseProgress(progress);
+            progressBar->setFormat(progress.stage == Data::ParseProgress::Stage::Parsing ? tr("%p% - %1").arg(text)
+                                                                                         : text);
+        });
     }
 }
 
@@ -189,6 +287,7 @@ void ResultsPage::onNavigateToCode(const QString& url, int lineNumber, int colum
 void ResultsPage::setSysroot(const QString& path)
 {
     m_resultsCallerCalleePage->setSysroot(path);
+    m_resultsDisassemblyPage->setSysroot(path);
 }
 
 void ResultsPage::setAppPath(const QString& path)
@@ -202,6 +301,12 @@ void ResultsPage::onJumpToCallerCallee(const Data::Symbol& symbol)
     ui->resultsTabWidget->setCurrentWidget(m_resultsCallerCalleePage);
 }
 
+void ResultsPage::onJumpToDisassembly(const Data::Symbol& symbol)
+{
+    m_resultsDisassemblyPage->showDisassembly(symbol);
+    ui->resultsTabWidget->setCurrentWidget(m_resultsDisassemblyPage);
+}
+
 void ResultsPage::selectSummaryTab()
 {
     ui->resultsTabWidget->setCurrentWidget(m_resultsSummaryPage);
@@ -213,9 +318,23 @@ void ResultsPage::clear()
     m_resultsTopDownPage->clear();
     m_resultsCallerCalleePage->clear();
     m_resultsFlameGraphPage->clear();
+    m_resultsLatencyPage->clear();
+    m_resultsDisassemblyPage->clear();
     m_exportMenu->clear();
 
     m_filterAndZoomStack->clear();
+
+    m_symbolStackJobs.cancel();
+    m_bottomUp = {};
+    m_indexedStacks = -1;
+    m_timeLineDelegate->setSymbolStackIndex({});
+}
+
+void ResultsPage::setSymbolStackIndex(const Data::SymbolStackIndex& index, uint generation)
+{
+    if (m_symbolStackJobs.isCurrent(generation)) {
+        m_timeLineDelegate->setSymbolStackIndex(index);
+    }
 }
 
 QMenu* ResultsPage::filterMenu() const
@@ -228,6 +347,11 @@ QMenu* ResultsPage::exportMenu() const
     return m_exportMenu;
 }
 
+FilterAndZoomStack* ResultsPage::filterAndZoomStack() const
+{
+    return m_filterAndZoomStack;
+}
+
 bool ResultsPage::eventFilter(QObject* watched, QEvent* event)
 {
     if (watched == ui->timeLineArea && event->type() == QEvent::Resize) {
@@ -29,6 +29,9 @@
 
 #include <QWidget>
 
+#include "models/data.h"
+#include "models/jobscheduler.h"
+
 class QMenu;
 class QAction;
 
@@ -36,16 +39,14 @@ namespace Ui {
 class ResultsPage;
 }
 
-namespace Data {
-struct Symbol;
-}
-
 class PerfParser;
 class ResultsSummaryPage;
 class ResultsBottomUpPage;
 class ResultsTopDownPage;
 class ResultsFlameGraphPage;
 class ResultsCallerCalleePage;
+class ResultsLatencyPage;
+class ResultsDisassemblyPage;
 class TimeLineDelegate;
 class FilterAndZoomStack;
 
@@ -60,6 +61,7 @@ public:
     void clear();
     QMenu* filterMenu() const;
     QMenu* exportMenu() const;
+    FilterAndZoomStack* filterAndZoomStack() const;
 
 public slots:
     void setSysroot(const QString& path);
@@ -67,11 +69,15 @@ public slots:
 
     void onNavigateToCode(const QString& url, int lineNumber, int columnNumber);
     void onJumpToCallerCallee(const Data::Symbol& symbol);
+    void onJumpToDisassembly(const Data::Symbol& symbol);
     void setTimelineVisible(bool visible);
 
 signals:
     void navigateToCode(const QString& url, int lineNumber, int columnNumber);
 
+private slots:
+    void setSymbolStackIndex(const Data::SymbolStackIndex& index, uint generation);
+
 private:
     bool eventFilter(QObject* watched, QEvent* event) override;
     void repositionFilterBusyIndicator();
@@ -86,7 +92,14 @@ private:
     ResultsTopDownPage* m_resultsTopDownPage;
     ResultsFlameGraphPage* m_resultsFlameGraphPage;
     ResultsCallerCalleePage* m_resultsCallerCalleePage;
+    ResultsLatencyPage* m_resultsLatencyPage;
+    ResultsDisassemblyPage* m_resultsDisassemblyPage;
     TimeLineDelegate* m_timeLineDelegate;
     QWidget* m_filterBusyIndicator;
     bool m_timelineVisible;
+    // the symbol stack index only depends on the stacks, which don't change when filtering
+    Data::BottomUpResults m_bottomUp;
+    int m_indexedStacks = -1;
+    // superseded whenever the index gets rebuilt, such that outdated results get dropped
+    JobScheduler m_symbolStackJobs;
 };
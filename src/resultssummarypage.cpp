@@ -36,13 +36,16 @@
 #include <KLocalizedString>
 #include <KRecursiveFilterProxyModel>
 
+#include "cpuheatmap.h"
 #include "parsers/perf/perfparser.h"
 #include "resultsutil.h"
 #include "util.h"
 
 #include "models/callercalleemodel.h"
 #include "models/costdelegate.h"
+#include "models/filterandzoomstack.h"
 #include "models/hashmodel.h"
+#include "models/instrumentation.h"
 #include "models/topproxy.h"
 #include "models/treemodel.h"
 
@@ -54,6 +57,10 @@ ResultsSummaryPage::ResultsSummaryPage(FilterAndZoomStack* filterStack, PerfPars
 
     ui->lostMessage->setVisible(false);
     ui->parserErrorsBox->setVisible(false);
+    ui->approximationLabel->setVisible(false);
+    ui->filterCacheLabel->setVisible(false);
+    ui->cpuUtilizationGroupBox->setVisible(false);
+    ui->internalsGroupBox->setVisible(Instrumentation::isEnabled());
 
     auto bottomUpCostModel = new BottomUpModel(this);
 
@@ -73,18 +80,24 @@ ResultsSummaryPage::ResultsSummaryPage(FilterAndZoomStack* filterStack, PerfPars
                                                 + BottomUpModel::NUM_BASE_COLUMNS);
             });
 
-    connect(parser, &PerfParser::bottomUpDataAvailable, this,
-            [this, bottomUpCostModel](const Data::BottomUpResults& data) {
-                bottomUpCostModel->setData(data);
-                ResultsUtil::hideEmptyColumns(data.costs, ui->topHotspotsTableView, BottomUpModel::NUM_BASE_COLUMNS);
-                ResultsUtil::fillEventSourceComboBox(ui->eventSourceComboBox, data.costs,
-                                                     ki18n("Show top hotspots for %1 events."));
-            });
+    auto setBottomUpData = [this, bottomUpCostModel](const Data::BottomUpResults& data) {
+        bottomUpCostModel->setData(data);
+        ResultsUtil::hideEmptyColumns(data.costs, ui->topHotspotsTableView, BottomUpModel::NUM_BASE_COLUMNS);
+        ResultsUtil::fillEventSourceComboBox(ui->eventSourceComboBox, data.costs,
+                                             ki18n("Show top hotspots for %1 events."));
+    };
+    connect(parser, &PerfParser::partialBottomUpDataAvailable, this, setBottomUpData);
+    connect(parser, &PerfParser::bottomUpDataAvailable, this, setBottomUpData);
+
+    connect(parser, &PerfParser::eventsAvailable, this, [this](const Data::EventResults& data) {
+        ui->cpuHeatMap->setEvents(data);
+        ui->cpuUtilizationGroupBox->setVisible(ui->cpuHeatMap->hasData());
+    });
 
     auto parserErrorsModel = new QStringListModel(this);
     ui->parserErrorsView->setModel(parserErrorsModel);
 
-    connect(parser, &PerfParser::summaryDataAvailable, this, [this, parserErrorsModel](const Data::Summary& data) {
+    auto setSummaryData = [this, parserErrorsModel](const Data::Summary& data) {
         auto formatSummaryText = [](const QString& description, const QString& value) -> QString {
             return QString(QLatin1String("<tr><td>") + description + QLatin1String(": </td><td>") + value
                            + QLatin1String("</td></tr>"));
@@ -133,7 +146,33 @@ ResultsSummaryPage::ResultsSummaryPage(FilterAndZoomStack* filterStack, PerfPars
                     stream << formatSummaryText(indent + tr("<b>WARNING</b>"), tr("Sampling frequency below 100Hz"));
                 }
             }
-            stream << formatSummaryText(tr("Lost Chunks"), QString::number(data.lostChunks)) << "</table></qt>";
+            stream << formatSummaryText(tr("Lost Chunks"), QString::number(data.lostChunks));
+            const auto& memory = data.memoryUsage;
+            if (memory.total()) {
+                KFormat format;
+                auto formatSize = [&format](quint64 size) {
+                    return format.formatByteSize(size, 1, KFormat::MetricBinaryDialect);
+                };
+                stream << formatSummaryText(tr("Memory Usage"), formatSize(memory.total()))
+                       << formatSummaryText(indent + tr("Strings"), formatSize(memory.strings))
+                       << formatSummaryText(indent + tr("Symbols"), formatSize(memory.symbols))
+                       << formatSummaryText(indent + tr("Locations"), formatSize(memory.locations))
+                       << formatSummaryText(indent + tr("Stacks"), formatSize(memory.stacks))
+                       << formatSummaryText(indent + tr("Events"), formatSize(memory.events))
+                       << formatSummaryText(indent + tr("Bottom Up"), formatSize(memory.bottomUp))
+                       << formatSummaryText(indent + tr("Top Down"), formatSize(memory.topDown))
+                       << formatSummaryText(indent + tr("Caller/Callee"), formatSize(memory.callerCallee));
+            }
+            const auto& stageTimes = data.stageTimes;
+            if (stageTimes.total()) {
+                auto formatTime = [](quint64 time) { return Util::formatTimeString(time, true); };
+                stream << formatSummaryText(tr("Analysis Time"), formatTime(stageTimes.total()))
+                       << formatSummaryText(indent + tr("Parsing"), formatTime(stageTimes.parsing))
+                       << formatSummaryText(indent + tr("Aggregation"), formatTime(stageTimes.aggregation))
+                       << formatSummaryText(indent + tr("Top Down"), formatTime(stageTimes.topDown))
+                       << formatSummaryText(indent + tr("Caller/Callee"), formatTime(stageTimes.callerCallee));
+            }
+            stream << "</table></qt>";
         }
         ui->summaryLabel->setText(summaryText);
 
@@ -173,7 +212,68 @@ ResultsSummaryPage::ResultsSummaryPage(FilterAndZoomStack* filterStack, PerfPars
             parserErrorsModel->setStringList(data.errors);
             ui->parserErrorsBox->setVisible(true);
         }
+    };
+    connect(parser, &PerfParser::summaryDataAvailable, this, setSummaryData);
+    // the system information is known right away, the rest of the summary fills in once parsing finished
+    connect(parser, &PerfParser::headerDataAvailable, this,
+            [setSummaryData](const PerfHeader::Info& header) { setSummaryData(header.summary); });
+
+    connect(parser, &PerfParser::approximationStatsAvailable, this,
+            [this, bottomUpCostModel](const Data::ApproximationStats& stats) {
+                ui->approximationLabel->setVisible(stats.isApproximate());
+                if (!stats.isApproximate()) {
+                    return;
+                }
+                QString text;
+                QTextStream stream(&text);
+                stream << "<qt>"
+                       << tr("Approximated from %1 of %2 events. With 95% confidence, the costs are off by at most:")
+                              .arg(QString::number(stats.sampledEvents), QString::number(stats.totalEvents))
+                       << "<ul>";
+                const auto costs = bottomUpCostModel->results().costs;
+                for (int type = 0, c = costs.numTypes(); type < c; ++type) {
+                    if (!costs.totalCost(type)) {
+                        continue;
+                    }
+                    const auto bound = static_cast<qint64>(stats.errorBound(type));
+                    stream << "<li>"
+                           << tr("%1: %2 (%3 of the total)")
+                                  .arg(costs.typeName(type).toHtmlEscaped(), costs.formatCost(type, bound),
+                                       Util::formatCostRelative(bound, costs.totalCost(type), true))
+                           << "</li>";
+                }
+                stream << "</ul><a href=\"exact\">" << tr("Compute exact results") << "</a></qt>";
+                stream.flush();
+                ui->approximationLabel->setText(text);
+            });
+    connect(ui->approximationLabel, &QLabel::linkActivated, filterStack,
+            [filterStack]() { filterStack->setSampleRate(1); });
+
+    connect(parser, &PerfParser::filterCacheStatsAvailable, this, [this](const Data::FilterCacheStats& stats) {
+        KFormat format;
+        ui->filterCacheLabel->setText(
+            tr("Filter cache: %1 hits, %2 misses, %3 entries using %4 of %5")
+                .arg(QString::number(stats.hits), QString::number(stats.misses), QString::number(stats.entries),
+                     format.formatByteSize(stats.usedBytes, 1, KFormat::MetricBinaryDialect),
+                     format.formatByteSize(stats.budgetBytes, 1, KFormat::MetricBinaryDialect)));
+        ui->filterCacheLabel->setVisible(true);
     });
+
+    connect(parser, &PerfParser::parsingFinished, this, &ResultsSummaryPage::updateInternals);
 }
 
 ResultsSummaryPage::~ResultsSummaryPage() = default;
+
+void ResultsSummaryPage::showEvent(QShowEvent* event)
+{
+    // the views keep adding to the timers while they get used, so refresh them when we come back
+    updateInternals();
+    QWidget::showEvent(event);
+}
+
+void ResultsSummaryPage::updateInternals()
+{
+    if (Instrumentation::isEnabled()) {
+        ui->internalsLabel->setText(Instrumentation::format());
+    }
+}
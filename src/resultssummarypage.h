@@ -50,6 +50,11 @@ public:
 signals:
     void jumpToCallerCallee(const Data::Symbol& symbol);
 
+protected:
+    void showEvent(QShowEvent* event) override;
+
 private:
+    void updateInternals();
+
     QScopedPointer<Ui::ResultsSummaryPage> ui;
 };
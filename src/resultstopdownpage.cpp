@@ -37,6 +37,7 @@
 ResultsTopDownPage::ResultsTopDownPage(FilterAndZoomStack* filterStack, PerfParser* parser, QWidget* parent)
     : QWidget(parent)
     , ui(new Ui::ResultsTopDownPage)
+    , m_deferredUpdate(new ResultsUtil::DeferredUpdate(this))
 {
     ui->setupUi(this);
 
@@ -44,20 +45,25 @@ ResultsTopDownPage::ResultsTopDownPage(FilterAndZoomStack* filterStack, PerfPars
     ResultsUtil::setupTreeView(ui->topDownTreeView, ui->topDownSearch, topDownCostModel);
     ResultsUtil::setupCostDelegate(topDownCostModel, ui->topDownTreeView);
     ResultsUtil::setupContextMenu(ui->topDownTreeView, topDownCostModel, filterStack,
-                                  [this](const Data::Symbol& symbol) { emit jumpToCallerCallee(symbol); });
-
-    connect(parser, &PerfParser::topDownDataAvailable, this,
-            [this, topDownCostModel](const Data::TopDownResults& data) {
-                topDownCostModel->setData(data);
-                ResultsUtil::hideEmptyColumns(data.inclusiveCosts, ui->topDownTreeView, TopDownModel::NUM_BASE_COLUMNS);
-                ResultsUtil::hideEmptyColumns(data.selfCosts, ui->topDownTreeView,
-                                              TopDownModel::NUM_BASE_COLUMNS + data.inclusiveCosts.numTypes());
-            });
+                                  [this](const Data::Symbol& symbol) { emit jumpToCallerCallee(symbol); },
+                                  [this](const Data::Symbol& symbol) { emit jumpToDisassembly(symbol); });
+
+    auto setData = [this, topDownCostModel](const Data::TopDownResults& data) {
+        m_deferredUpdate->run([this, topDownCostModel, data]() {
+            topDownCostModel->setData(data);
+            ResultsUtil::hideEmptyColumns(data.inclusiveCosts, ui->topDownTreeView, TopDownModel::NUM_BASE_COLUMNS);
+            ResultsUtil::hideEmptyColumns(data.selfCosts, ui->topDownTreeView,
+                                          TopDownModel::NUM_BASE_COLUMNS + data.inclusiveCosts.numTypes());
+        });
+    };
+    connect(parser, &PerfParser::partialTopDownDataAvailable, this, setData);
+    connect(parser, &PerfParser::topDownDataAvailable, this, setData);
 }
 
 ResultsTopDownPage::~ResultsTopDownPage() = default;
 
 void ResultsTopDownPage::clear()
 {
+    m_deferredUpdate->cancel();
     ui->topDownSearch->setText({});
 }
@@ -42,6 +42,10 @@ class QTreeView;
 class PerfParser;
 class FilterAndZoomStack;
 
+namespace ResultsUtil {
+class DeferredUpdate;
+}
+
 class ResultsTopDownPage : public QWidget
 {
     Q_OBJECT
@@ -53,7 +57,10 @@ public:
 
 signals:
     void jumpToCallerCallee(const Data::Symbol& symbol);
+    void jumpToDisassembly(const Data::Symbol& symbol);
 
 private:
     QScopedPointer<Ui::ResultsTopDownPage> ui;
+    // the model only gets populated once the page is shown
+    ResultsUtil::DeferredUpdate* m_deferredUpdate;
 };
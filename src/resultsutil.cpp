@@ -29,17 +29,21 @@
 
 #include <QComboBox>
 #include <QCoreApplication>
+#include <QEvent>
 #include <QHeaderView>
+#include <QLineEdit>
 #include <QMenu>
 #include <QTreeView>
+#include <QWidget>
 
 #include <KFilterProxySearchLine>
 #include <KLocalizedString>
-#include <KRecursiveFilterProxyModel>
 
 #include "models/costdelegate.h"
 #include "models/data.h"
 #include "models/filterandzoomstack.h"
+#include "models/treemodel.h"
+#include "models/treeproxy.h"
 
 namespace ResultsUtil {
 
@@ -49,15 +53,14 @@ void stretchFirstColumn(QTreeView* view)
     view->header()->setSectionResizeMode(0, QHeaderView::Stretch);
 }
 
-void setupTreeView(QTreeView* view, KFilterProxySearchLine* filter, QAbstractItemModel* model, int initialSortColumn,
-                   int sortRole, int filterRole)
+void setupTreeView(QTreeView* view, KFilterProxySearchLine* filter, AbstractTreeModel* model, int initialSortColumn,
+                   int sortRole)
 {
-    auto proxy = new KRecursiveFilterProxyModel(view);
+    auto proxy = new TreeProxy(model, view);
     proxy->setSortRole(sortRole);
-    proxy->setFilterRole(filterRole);
-    proxy->setSourceModel(model);
 
-    filter->setProxy(proxy);
+    // don't hand the proxy to the search line, the search runs in the background instead, see TreeProxy
+    QObject::connect(filter->lineEdit(), &QLineEdit::textChanged, proxy, &TreeProxy::setSearchText);
 
     view->sortByColumn(initialSortColumn, Qt::DescendingOrder);
     view->setModel(proxy);
@@ -71,9 +74,18 @@ void addFilterActions(QMenu* menu, const Data::Symbol& symbol, FilterAndZoomStac
         filterActions.filterInBySymbol->setData(QVariant::fromValue(symbol));
         filterActions.filterOutBySymbol->setData(filterActions.filterInBySymbol->data());
 
+        filterActions.highlightSymbol->setData(filterActions.filterInBySymbol->data());
+
         menu->addAction(filterActions.filterInBySymbol);
         menu->addAction(filterActions.filterOutBySymbol);
         menu->addSeparator();
+        menu->addAction(filterActions.highlightSymbol);
+    }
+    if (filterStack->highlightedSymbol().isValid()) {
+        menu->addAction(filterStack->actions().resetHighlight);
+    }
+    if (symbol.isValid() || filterStack->highlightedSymbol().isValid()) {
+        menu->addSeparator();
     }
 
     menu->addAction(filterStack->actions().filterOut);
@@ -81,11 +93,13 @@ void addFilterActions(QMenu* menu, const Data::Symbol& symbol, FilterAndZoomStac
 }
 
 void setupContextMenu(QTreeView* view, int symbolRole, FilterAndZoomStack* filterStack,
-                      std::function<void(const Data::Symbol&)> callback)
+                      std::function<void(const Data::Symbol&)> callback,
+                      std::function<void(const Data::Symbol&)> disassemblyCallback)
 {
     view->setContextMenuPolicy(Qt::CustomContextMenu);
     QObject::connect(
-        view, &QTreeView::customContextMenuRequested, view, [view, symbolRole, filterStack, callback](const QPoint& point) {
+        view, &QTreeView::customContextMenuRequested, view,
+        [view, symbolRole, filterStack, callback, disassemblyCallback](const QPoint& point) {
             const auto index = view->indexAt(point);
             const auto symbol = index.data(symbolRole).value<Data::Symbol>();
 
@@ -95,6 +109,13 @@ void setupContextMenu(QTreeView* view, int symbolRole, FilterAndZoomStack* filte
                 QObject::connect(viewCallerCallee, &QAction::triggered, &contextMenu, [symbol, callback](){
                     callback(symbol);
                 });
+            }
+            if (disassemblyCallback && symbol.isValid()) {
+                auto* showDisassembly = contextMenu.addAction(QCoreApplication::translate("Util", "Show Disassembly"));
+                QObject::connect(showDisassembly, &QAction::triggered, &contextMenu,
+                                 [symbol, disassemblyCallback]() { disassemblyCallback(symbol); });
+            }
+            if ((callback || disassemblyCallback) && symbol.isValid()) {
                 contextMenu.addSeparator();
             }
             addFilterActions(&contextMenu, symbol, filterStack);
@@ -127,14 +148,34 @@ void hideEmptyColumns(const Data::Costs& costs, QTreeView* view, int numBaseColu
 
 void fillEventSourceComboBox(QComboBox* combo, const Data::Costs& costs, const KLocalizedString& tooltipTemplate)
 {
+    QVector<int> types;
+    for (int i = 0, c = costs.numTypes(); i < c; ++i) {
+        if (costs.totalCost(i)) {
+            types.append(i);
+        }
+    }
+
+    // the partial results of a running parse get published repeatedly, mostly with the same cost types
+    const auto isUnchanged = [combo, &costs, &types]() -> bool {
+        if (combo->count() != types.size()) {
+            return false;
+        }
+        for (int i = 0, c = types.size(); i < c; ++i) {
+            if (combo->itemData(i).toInt() != types[i] || combo->itemText(i) != costs.typeName(types[i])) {
+                return false;
+            }
+        }
+        return true;
+    };
+    if (isUnchanged()) {
+        return;
+    }
+
     // restore selection if possible
     const auto oldData = combo->currentData();
 
     combo->clear();
-    for (int i = 0, c = costs.numTypes(); i < c; ++i) {
-        if (!costs.totalCost(i)) {
-            continue;
-        }
+    for (auto i : types) {
         const auto& typeName = costs.typeName(i);
         combo->addItem(typeName, QVariant::fromValue(i));
         combo->setItemData(i, tooltipTemplate.subs(typeName).toString(), Qt::ToolTipRole);
@@ -145,4 +186,42 @@ void fillEventSourceComboBox(QComboBox* combo, const Data::Costs& costs, const K
         combo->setCurrentIndex(index);
     }
 }
+
+DeferredUpdate::DeferredUpdate(QWidget* page)
+    : QObject(page)
+    , m_page(page)
+{
+    page->installEventFilter(this);
+}
+
+void DeferredUpdate::run(std::function<void()> update)
+{
+    m_pending = std::move(update);
+    if (m_page->isVisible()) {
+        flush();
+    }
+}
+
+void DeferredUpdate::flush()
+{
+    if (m_pending) {
+        // the update may schedule the next one
+        auto update = std::move(m_pending);
+        m_pending = nullptr;
+        update();
+    }
+}
+
+void DeferredUpdate::cancel()
+{
+    m_pending = nullptr;
+}
+
+bool DeferredUpdate::eventFilter(QObject* watched, QEvent* event)
+{
+    if (watched == m_page && event->type() == QEvent::Show) {
+        flush();
+    }
+    return QObject::eventFilter(watched, event);
+}
 }
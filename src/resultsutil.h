@@ -27,13 +27,17 @@
 
 #pragma once
 
+#include <QObject>
+
 #include <functional>
 
 class QMenu;
+class QWidget;
 class QTreeView;
 class QComboBox;
 class KFilterProxySearchLine;
 class QAbstractItemModel;
+class AbstractTreeModel;
 class KLocalizedString;
 
 namespace Data {
@@ -46,13 +50,13 @@ class FilterAndZoomStack;
 namespace ResultsUtil {
 void stretchFirstColumn(QTreeView* view);
 
-void setupTreeView(QTreeView* view, KFilterProxySearchLine* filter, QAbstractItemModel* model, int initialSortColumn,
-                   int sortRole, int filterRole);
+void setupTreeView(QTreeView* view, KFilterProxySearchLine* filter, AbstractTreeModel* model, int initialSortColumn,
+                   int sortRole);
 
 template<typename Model>
 void setupTreeView(QTreeView* view, KFilterProxySearchLine* filter, Model* model)
 {
-    setupTreeView(view, filter, model, Model::InitialSortColumn, Model::SortRole, Model::FilterRole);
+    setupTreeView(view, filter, model, Model::InitialSortColumn, Model::SortRole);
 }
 
 void setupCostDelegate(QAbstractItemModel* model, QTreeView* view, int sortRole, int totalCostRole, int numBaseColumns);
@@ -65,15 +69,42 @@ void setupCostDelegate(Model* model, QTreeView* view)
 
 void addFilterActions(QMenu* menu, const Data::Symbol &symbol, FilterAndZoomStack* filterStack);
 
-void setupContextMenu(QTreeView* view, int symbolRole, FilterAndZoomStack* filterStack, std::function<void(const Data::Symbol&)> callback);
+// the optional @p disassemblyCallback adds an action to show the disassembly of the symbol
+void setupContextMenu(QTreeView* view, int symbolRole, FilterAndZoomStack* filterStack,
+                      std::function<void(const Data::Symbol&)> callback,
+                      std::function<void(const Data::Symbol&)> disassemblyCallback = {});
 
 template<typename Model>
-void setupContextMenu(QTreeView* view, Model* /*model*/, FilterAndZoomStack* filterStack, std::function<void(const Data::Symbol&)> callback)
+void setupContextMenu(QTreeView* view, Model* /*model*/, FilterAndZoomStack* filterStack,
+                      std::function<void(const Data::Symbol&)> callback,
+                      std::function<void(const Data::Symbol&)> disassemblyCallback = {})
 {
-    setupContextMenu(view, Model::SymbolRole, filterStack, callback);
+    setupContextMenu(view, Model::SymbolRole, filterStack, callback, disassemblyCallback);
 }
 
 void hideEmptyColumns(const Data::Costs& costs, QTreeView* view, int numBaseColumns);
 
 void fillEventSourceComboBox(QComboBox* combo, const Data::Costs& costs, const KLocalizedString& tooltipTemplate);
+
+// defers updating the models of a page until it gets shown, such that pages the user never looks at don't ingest
+// their data. every update replaces the data of the page, so only the last one needs to be kept
+class DeferredUpdate : public QObject
+{
+public:
+    explicit DeferredUpdate(QWidget* page);
+
+    // runs @p update right away when the page is visible, otherwise the next time it gets shown
+    void run(std::function<void()> update);
+    // runs the pending update now, e.g. before the data of the hidden page gets accessed
+    void flush();
+    // drops the pending update, if any
+    void cancel();
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
+private:
+    QWidget* m_page;
+    std::function<void()> m_pending;
+};
 }
@@ -34,3 +34,75 @@ void Settings::setPrettifySymbols(bool prettifySymbols)
         emit prettifySymbolsChanged(m_prettifySymbols);
     }
 }
+
+void Settings::setUseResultsCache(bool useResultsCache)
+{
+    if (m_useResultsCache != useResultsCache) {
+        m_useResultsCache = useResultsCache;
+        emit useResultsCacheChanged(m_useResultsCache);
+    }
+}
+
+void Settings::setStoreFilterSnapshots(bool storeFilterSnapshots)
+{
+    if (m_storeFilterSnapshots != storeFilterSnapshots) {
+        m_storeFilterSnapshots = storeFilterSnapshots;
+        emit storeFilterSnapshotsChanged(m_storeFilterSnapshots);
+    }
+}
+
+void Settings::setEventRetentionSeconds(int eventRetentionSeconds)
+{
+    if (m_eventRetentionSeconds != eventRetentionSeconds) {
+        m_eventRetentionSeconds = eventRetentionSeconds;
+        emit eventRetentionSecondsChanged(m_eventRetentionSeconds);
+    }
+}
+
+void Settings::setMaxEventsPerThread(int maxEventsPerThread)
+{
+    if (m_maxEventsPerThread != maxEventsPerThread) {
+        m_maxEventsPerThread = maxEventsPerThread;
+        emit maxEventsPerThreadChanged(m_maxEventsPerThread);
+    }
+}
+
+void Settings::setMemoryBudgetMB(int memoryBudgetMB)
+{
+    if (m_memoryBudgetMB != memoryBudgetMB) {
+        m_memoryBudgetMB = memoryBudgetMB;
+        emit memoryBudgetMBChanged(m_memoryBudgetMB);
+    }
+}
+
+void Settings::setPartialResultsIntervalMs(int partialResultsIntervalMs)
+{
+    if (m_partialResultsIntervalMs != partialResultsIntervalMs) {
+        m_partialResultsIntervalMs = partialResultsIntervalMs;
+        emit partialResultsIntervalMsChanged(m_partialResultsIntervalMs);
+    }
+}
+
+void Settings::setIngestTopDown(bool ingestTopDown)
+{
+    if (m_ingestTopDown != ingestTopDown) {
+        m_ingestTopDown = ingestTopDown;
+        emit ingestTopDownChanged(m_ingestTopDown);
+    }
+}
+
+void Settings::setAggregationThreads(int aggregationThreads)
+{
+    if (m_aggregationThreads != aggregationThreads) {
+        m_aggregationThreads = aggregationThreads;
+        emit aggregationThreadsChanged(m_aggregationThreads);
+    }
+}
+
+void Settings::setPinWorkers(bool pinWorkers)
+{
+    if (m_pinWorkers != pinWorkers) {
+        m_pinWorkers = pinWorkers;
+        emit pinWorkersChanged(m_pinWorkers);
+    }
+}
@@ -36,15 +36,89 @@ public:
         return m_prettifySymbols;
     }
 
+    bool useResultsCache() const
+    {
+        return m_useResultsCache;
+    }
+
+    bool storeFilterSnapshots() const
+    {
+        return m_storeFilterSnapshots;
+    }
+
+    // see PerfParser::ParseOptions
+    int eventRetentionSeconds() const
+    {
+        return m_eventRetentionSeconds;
+    }
+
+    int maxEventsPerThread() const
+    {
+        return m_maxEventsPerThread;
+    }
+
+    int memoryBudgetMB() const
+    {
+        return m_memoryBudgetMB;
+    }
+
+    int partialResultsIntervalMs() const
+    {
+        return m_partialResultsIntervalMs;
+    }
+
+    bool ingestTopDown() const
+    {
+        return m_ingestTopDown;
+    }
+
+    int aggregationThreads() const
+    {
+        return m_aggregationThreads;
+    }
+
+    // see CpuTopology::setPinningEnabled
+    bool pinWorkers() const
+    {
+        return m_pinWorkers;
+    }
+
 signals:
     void prettifySymbolsChanged(bool);
+    void useResultsCacheChanged(bool);
+    void storeFilterSnapshotsChanged(bool);
+    void eventRetentionSecondsChanged(int);
+    void maxEventsPerThreadChanged(int);
+    void memoryBudgetMBChanged(int);
+    void partialResultsIntervalMsChanged(int);
+    void ingestTopDownChanged(bool);
+    void aggregationThreadsChanged(int);
+    void pinWorkersChanged(bool);
 
 public slots:
     void setPrettifySymbols(bool prettifySymbols);
+    void setUseResultsCache(bool useResultsCache);
+    void setStoreFilterSnapshots(bool storeFilterSnapshots);
+    void setEventRetentionSeconds(int eventRetentionSeconds);
+    void setMaxEventsPerThread(int maxEventsPerThread);
+    void setMemoryBudgetMB(int memoryBudgetMB);
+    void setPartialResultsIntervalMs(int partialResultsIntervalMs);
+    void setIngestTopDown(bool ingestTopDown);
+    void setAggregationThreads(int aggregationThreads);
+    void setPinWorkers(bool pinWorkers);
 
 private:
     Settings() = default;
     ~Settings() = default;
 
     bool m_prettifySymbols = true;
+    bool m_useResultsCache = true;
+    bool m_storeFilterSnapshots = true;
+    int m_eventRetentionSeconds = 0;
+    int m_maxEventsPerThread = 0;
+    int m_memoryBudgetMB = 0;
+    int m_partialResultsIntervalMs = 2000;
+    bool m_ingestTopDown = false;
+    int m_aggregationThreads = 0;
+    bool m_pinWorkers = false;
 };
@@ -32,6 +32,9 @@
 #include <QMainWindow>
 #include <QPainter>
 
+#include "models/data.h"
+#include "util.h"
+
 StartPage::StartPage(QWidget* parent)
     : QWidget(parent)
     , ui(new Ui::StartPage)
@@ -62,6 +65,7 @@ void StartPage::showParseFileProgress()
 
     // Reset maximum to show throbber, we may not get progress notifications
     ui->openFileProgressBar->setMaximum(0);
+    ui->openFileProgressBar->setFormat(QStringLiteral("%p%"));
 }
 
 void StartPage::setPathSettingsMenu(QMenu* menu)
@@ -86,6 +90,14 @@ void StartPage::onParseFileProgress(float percent)
     ui->openFileProgressBar->setValue(static_cast<int>(percent * scale));
 }
 
+void StartPage::onParseProgress(const Data::ParseProgress& progress)
+{
+    // the percentage alone doesn't tell a slow parse from a stalled one
+    const auto text = Util::formatParseProgress(progress);
+    ui->openFileProgressBar->setFormat(
+        progress.stage == Data::ParseProgress::Stage::Parsing ? tr("%p% - %1").arg(text) : text);
+}
+
 void StartPage::paintEvent(QPaintEvent* /*event*/)
 {
     QPainter painter(this);
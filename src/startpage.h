@@ -35,6 +35,10 @@ class StartPage;
 
 class QMenu;
 
+namespace Data {
+struct ParseProgress;
+}
+
 class StartPage : public QWidget
 {
     Q_OBJECT
@@ -54,6 +58,7 @@ protected:
 public slots:
     void onOpenFileError(const QString& errorMessage);
     void onParseFileProgress(float percent);
+    void onParseProgress(const Data::ParseProgress& progress);
 
 signals:
     void openFileButtonClicked();
@@ -32,11 +32,15 @@
 #include <QCoreApplication>
 #include <QDebug>
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
 #include <QProcessEnvironment>
 
 #include <initializer_list>
 
+#include <sys/stat.h>
+#include <sys/types.h>
+
 #include "data.h"
 #include "settings.h"
 
@@ -70,7 +74,7 @@ QString Util::formatCost(quint64 cost)
     return QString::number(static_cast<double>(cost), 'G', 4);
 }
 
-QString Util::formatCostRelative(quint64 selfCost, quint64 totalCost, bool addPercentSign)
+QString Util::formatCostRelative(qint64 selfCost, quint64 totalCost, bool addPercentSign)
 {
     if (!totalCost) {
         return QString();
@@ -142,6 +146,35 @@ QString Util::formatFrequency(quint64 occurrences, quint64 nanoseconds)
     return QString::number(hz, 'G', 4) + QLatin1String(*unit);
 }
 
+QString Util::formatParseProgress(const Data::ParseProgress& progress)
+{
+    using Stage = Data::ParseProgress::Stage;
+    switch (progress.stage) {
+    case Stage::Parsing:
+        break;
+    case Stage::Aggregation:
+        return QCoreApplication::translate("Util", "aggregating the results...");
+    case Stage::TopDown:
+        return QCoreApplication::translate("Util", "building the top down tree...");
+    case Stage::CallerCallee:
+        return QCoreApplication::translate("Util", "building the caller/callee data...");
+    }
+
+    auto text = QCoreApplication::translate("Util", "%1 events/s, %2 samples/s unwound")
+                    .arg(QString::number(qRound64(progress.eventsPerSecond())),
+                         QString::number(qRound64(progress.samplesPerSecond())));
+    if (progress.inputBytes && progress.elapsed) {
+        const auto bytesPerSecond = 1E9 * progress.fraction * progress.inputBytes / progress.elapsed;
+        text += QCoreApplication::translate("Util", ", %1 MiB/s of input")
+                    .arg(QString::number(bytesPerSecond / 1024 / 1024, 'f', 1));
+    }
+    const auto remaining = progress.remainingTime();
+    if (remaining >= 0) {
+        text += QCoreApplication::translate("Util", ", about %1 left").arg(formatTimeString(remaining, true));
+    }
+    return text;
+}
+
 static QString formatTooltipImpl(int id, const Data::Symbol& symbol, const Data::Costs* selfCosts,
                                  const Data::Costs* inclusiveCosts)
 {
@@ -241,3 +274,14 @@ QProcessEnvironment Util::appImageEnvironment()
     static const auto env = QProcessEnvironment::systemEnvironment();
     return env;
 }
+
+bool Util::createFifo(const QString& path)
+{
+    return mkfifo(QFile::encodeName(path).constData(), S_IRUSR | S_IWUSR) == 0;
+}
+
+bool Util::isFifo(const QString& path)
+{
+    struct stat info;
+    return stat(QFile::encodeName(path).constData(), &info) == 0 && S_ISFIFO(info.st_mode);
+}
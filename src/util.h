@@ -29,14 +29,23 @@
 
 #include <valarray>
 #include <QHashFunctions>
+#include <QThread>
 #include <QtGlobal>
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "models/cputopology.h"
+
 class QString;
 class QProcessEnvironment;
 
 namespace Data {
 struct Symbol;
 struct LocationCost;
+struct ParseProgress;
 class Costs;
 using ItemCost = std::valarray<qint64>;
 }
@@ -63,9 +72,10 @@ struct HashCombine
 QString formatString(const QString& input, bool replaceEmptyString = true);
 QString formatSymbol(const Data::Symbol& symbol, bool replaceEmptyString = true);
 QString formatCost(quint64 cost);
-QString formatCostRelative(quint64 selfCost, quint64 totalCost, bool addPercentSign = false);
+QString formatCostRelative(qint64 selfCost, quint64 totalCost, bool addPercentSign = false);
 QString formatTimeString(quint64 nanoseconds, bool shortForm = false);
 QString formatFrequency(quint64 occurrences, quint64 nanoseconds);
+QString formatParseProgress(const Data::ParseProgress& progress);
 QString formatTooltip(int id, const Data::Symbol& symbol, const Data::Costs& costs);
 QString formatTooltip(int id, const Data::Symbol& symbol, const Data::Costs& selfCosts,
                       const Data::Costs& inclusiveCosts);
@@ -75,4 +85,66 @@ QString formatTooltip(const QString& location, const Data::LocationCost& cost, c
 // the process environment including the custom AppImage-specific LD_LIBRARY_PATH
 // this is initialized on the first call and cached internally afterwards
 QProcessEnvironment appImageEnvironment();
+
+// create a named pipe at @p path, @return true on success
+bool createFifo(const QString& path);
+// @return true when @p path points to a named pipe
+bool isFifo(const QString& path);
+
+// @return true while the calling thread is running a parallelFor job, nested calls then stay on that thread
+inline bool& isInParallelFor()
+{
+    static thread_local bool inParallelFor = false;
+    return inParallelFor;
+}
+
+/**
+ * Split the range [0, @p size) into consecutive chunks and call @p job(begin, end) for each of them
+ * in parallel. This blocks until all chunks got processed. Ranges with less than @p minChunkSize
+ * entries, as well as nested calls from within a job, are handled on the calling thread directly.
+ *
+ * The range gets split into a few more chunks than there are workers and each worker pulls the next
+ * chunk from a shared counter, such that uneven chunks (e.g. one file per chunk) don't leave cores idle.
+ */
+template<typename Job>
+void parallelFor(int size, Job job, int minChunkSize = 1024)
+{
+    minChunkSize = std::max(1, minChunkSize);
+    const int maxThreads = isInParallelFor() ? 1 : QThread::idealThreadCount();
+    const int numThreads = std::max(1, std::min(maxThreads, size / minChunkSize));
+    if (numThreads == 1) {
+        job(0, size);
+        return;
+    }
+
+    const int chunksPerThread = 4;
+    const int targetChunks = numThreads * chunksPerThread;
+    const int chunkSize = std::max(minChunkSize, (size + targetChunks - 1) / targetChunks);
+    const int numChunks = (size + chunkSize - 1) / chunkSize;
+    std::atomic<int> nextChunk(0);
+    auto work = [&job, &nextChunk, size, chunkSize, numChunks]() {
+        auto& inParallelFor = isInParallelFor();
+        const bool wasInParallelFor = inParallelFor;
+        inParallelFor = true;
+        for (int chunk = nextChunk.fetch_add(1); chunk < numChunks; chunk = nextChunk.fetch_add(1)) {
+            const int begin = chunk * chunkSize;
+            job(begin, std::min(size, begin + chunkSize));
+        }
+        inParallelFor = wasInParallelFor;
+    };
+
+    // the spawned threads get pinned when CpuTopology::isPinningEnabled, but the calling thread is left alone
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads - 1);
+    for (int worker = 1; worker < numThreads; ++worker) {
+        threads.emplace_back([&work, worker, numThreads]() {
+            CpuTopology::pinWorker(worker, numThreads);
+            work();
+        });
+    }
+    work();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
 }
@@ -0,0 +1,338 @@
+/*
+  bench_gui.cpp
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2017-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Nate Rogers <nate.rogers@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QApplication>
+#include <QDoubleSpinBox>
+#include <QPainter>
+#include <QScrollArea>
+#include <QTest>
+#include <QTreeView>
+
+#include <flamegraph.h>
+#include <models/eventmodel.h>
+#include <models/filterandzoomstack.h>
+#include <models/timelinedelegate.h>
+#include <models/treemodel.h>
+#include <models/treeproxy.h>
+
+namespace {
+struct Dataset
+{
+    Data::BottomUpResults bottomUp;
+    Data::TopDownResults topDown;
+    Data::EventResults events;
+};
+
+// a synthetic profile with the given shape, the stacks are picked by a fixed seed to make the runs reproducible
+Dataset generateDataset(int samples, int stackDepth, int fanOut, int threads)
+{
+    Dataset dataset;
+    auto& bottomUp = dataset.bottomUp;
+    bottomUp.costs.addType(0, QStringLiteral("samples"), Data::Costs::Unit::Unknown);
+    // every level of the stack has its own set of functions, which bounds the number of unique stacks
+    for (int level = 0; level < stackDepth; ++level) {
+        for (int callee = 0; callee < fanOut; ++callee) {
+            bottomUp.symbols.push_back({QStringLiteral("func_%1_%2").arg(level).arg(callee),
+                                        QStringLiteral("libbenchmark.so")});
+            bottomUp.locations.push_back({-1, {}});
+        }
+    }
+
+    auto& events = dataset.events;
+    events.numCpus = 4;
+    events.totalCosts = {{QStringLiteral("samples"), quint64(samples), quint64(samples), Data::Costs::Unit::Unknown}};
+    for (int thread = 0; thread < threads; ++thread) {
+        Data::ThreadEvents threadEvents;
+        threadEvents.pid = 1000;
+        threadEvents.tid = 1000 + thread;
+        threadEvents.name = QStringLiteral("thread %1").arg(thread);
+        events.threads.push_back(threadEvents);
+    }
+
+    const quint64 startTime = 1000000;
+    // 10kHz
+    const quint64 interval = 100000;
+    quint32 seed = 42;
+    auto random = [&seed]() {
+        seed = seed * 1103515245 + 12345;
+        return seed >> 16;
+    };
+    QVector<qint32> frames;
+    for (int i = 0; i < samples; ++i) {
+        // the frames are ordered from the sampled function to its outermost caller
+        const auto depth = 1 + static_cast<int>(random() % stackDepth);
+        frames.resize(depth);
+        for (int level = 0; level < depth; ++level) {
+            frames[depth - level - 1] = level * fanOut + static_cast<int>(random() % fanOut);
+        }
+        bottomUp.addEvent(0, 1, frames, [](const Data::Symbol&, const Data::Location&) {});
+
+        Data::Event event;
+        event.time = startTime + (i + 1) * interval;
+        event.cost = 1;
+        event.type = 0;
+        event.stackId = events.stacks.size();
+        event.cpuId = static_cast<quint32>(i % events.numCpus);
+        events.stacks.push_back(frames);
+        events.threads[i % threads].events << event;
+    }
+    const auto endTime = startTime + (samples + 1) * interval;
+    for (auto& thread : events.threads) {
+        thread.time = {startTime, endTime};
+    }
+
+    Data::BottomUp::initializeParents(&bottomUp.root);
+    dataset.topDown = Data::TopDownResults::fromBottomUp(bottomUp);
+    return dataset;
+}
+
+// @return the indices of all rows in the events column that have no children, i.e. the threads and CPUs
+QVector<QModelIndex> timeLineRows(const QAbstractItemModel& model, const QModelIndex& parent = {})
+{
+    QVector<QModelIndex> rows;
+    for (int row = 0, c = model.rowCount(parent); row < c; ++row) {
+        const auto index = model.index(row, EventModel::ThreadColumn, parent);
+        if (model.rowCount(index)) {
+            rows += timeLineRows(model, index);
+        } else {
+            rows.push_back(index.sibling(row, EventModel::EventsColumn));
+        }
+    }
+    return rows;
+}
+
+void waitForFrames(QWidget* view)
+{
+    // the flame graph shows a busy cursor until the frames got built in the background
+    while (view->cursor().shape() == Qt::BusyCursor) {
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 10);
+    }
+}
+}
+
+Q_DECLARE_METATYPE(Dataset)
+
+// offscreen benchmarks of the widgets that render the results, with one data row per shape of the profile.
+// pass -csv or -o results.xml,xml to get the results in a machine-readable form
+class BenchGui : public QObject
+{
+    Q_OBJECT
+private slots:
+    void benchFlameGraphBuild_data()
+    {
+        addDatasets();
+    }
+
+    void benchFlameGraphBuild()
+    {
+        QFETCH(Dataset, dataset);
+
+        FlameGraph graph;
+        graph.resize(1600, 1200);
+        graph.show();
+        auto* view = graph.findChild<QScrollArea*>()->widget();
+        graph.setBottomUpData(dataset.bottomUp);
+        QBENCHMARK {
+            // setting the data again discards the frames that were built before
+            graph.setTopDownData(dataset.topDown);
+            waitForFrames(view);
+        }
+    }
+
+    void benchFlameGraphRedraw_data()
+    {
+        QTest::addColumn<Dataset>("dataset");
+        QTest::addColumn<double>("threshold");
+
+        for (double threshold : {0., 0.1, 1., 10.}) {
+            const auto thresholdTag = QByteArray::number(threshold);
+            for (const auto& row : datasets()) {
+                QTest::newRow((row.first + '@' + thresholdTag).constData()) << row.second << threshold;
+            }
+        }
+    }
+
+    void benchFlameGraphRedraw()
+    {
+        QFETCH(Dataset, dataset);
+        QFETCH(double, threshold);
+
+        FlameGraph graph;
+        graph.resize(1600, 1200);
+        graph.show();
+        auto* view = graph.findChild<QScrollArea*>()->widget();
+        graph.setBottomUpData(dataset.bottomUp);
+        graph.setTopDownData(dataset.topDown);
+        waitForFrames(view);
+        graph.findChild<QDoubleSpinBox*>()->setValue(threshold);
+
+        QBENCHMARK {
+            view->grab();
+        }
+    }
+
+    void benchTimeLinePaint_data()
+    {
+        QTest::addColumn<Dataset>("dataset");
+        QTest::addColumn<int>("zoomLevel");
+        QTest::addColumn<bool>("cached");
+
+        for (int zoomLevel : {1, 10, 100}) {
+            const auto zoomTag = QByteArray::number(zoomLevel) + 'x';
+            for (const auto& row : datasets()) {
+                QTest::newRow((row.first + '@' + zoomTag).constData()) << row.second << zoomLevel << false;
+                QTest::newRow((row.first + '@' + zoomTag + "-cached").constData())
+                    << row.second << zoomLevel << true;
+            }
+        }
+    }
+
+    void benchTimeLinePaint()
+    {
+        QFETCH(Dataset, dataset);
+        QFETCH(int, zoomLevel);
+        QFETCH(bool, cached);
+
+        EventModel model;
+        model.setData(dataset.events);
+        QTreeView view;
+        view.setModel(&model);
+        FilterAndZoomStack filterAndZoomStack;
+        TimeLineDelegate delegate(&filterAndZoomStack, &view);
+
+        // zoom into the middle of the recording
+        const auto& time = dataset.events.threads.first().time;
+        const auto center = time.start + time.delta() / 2;
+        const auto halfRange = time.delta() / zoomLevel / 2;
+        if (zoomLevel > 1) {
+            filterAndZoomStack.zoomIn({center - halfRange, center + halfRange});
+        }
+
+        const auto rows = timeLineRows(model);
+        QVERIFY(!rows.isEmpty());
+        QStyleOptionViewItem option;
+        option.initFrom(&view);
+        option.rect = {0, 0, 1600, 24};
+        QImage image(option.rect.size(), QImage::Format_ARGB32_Premultiplied);
+        QPainter painter(&image);
+
+        QBENCHMARK {
+            for (const auto& row : rows) {
+                if (!cached) {
+                    // the delegate caches the rendered rows until the data changes
+                    emit model.dataChanged(row, row);
+                }
+                delegate.paint(&painter, option, row);
+            }
+        }
+    }
+
+    void benchTreeViewSort_data()
+    {
+        addDatasets();
+    }
+
+    void benchTreeViewSort()
+    {
+        QFETCH(Dataset, dataset);
+
+        TopDownModel model;
+        model.setData(dataset.topDown);
+        TreeProxy proxy(&model);
+        proxy.setSortRole(TopDownModel::SortRole);
+        QTreeView view;
+        view.setModel(&proxy);
+        view.show();
+
+        auto order = Qt::AscendingOrder;
+        QBENCHMARK {
+            // alternate the order, to not hit any shortcut for sorting by the same column again
+            order = order == Qt::AscendingOrder ? Qt::DescendingOrder : Qt::AscendingOrder;
+            proxy.sort(TopDownModel::InitialSortColumn, order);
+        }
+    }
+
+    void benchTreeViewFilter_data()
+    {
+        addDatasets();
+    }
+
+    void benchTreeViewFilter()
+    {
+        QFETCH(Dataset, dataset);
+
+        TopDownModel model;
+        model.setData(dataset.topDown);
+        TreeProxy proxy(&model);
+        QTreeView view;
+        view.setModel(&proxy);
+        view.show();
+
+        // the same steps as TreeProxy::setSearchText without its delay, the search and the filtering of the rows
+        const auto search = model.searchFunction(QStringLiteral("func_2_1"));
+        QBENCHMARK {
+            const auto matches = search([]() { return false; });
+            QMetaObject::invokeMethod(&proxy, "setMatches", Qt::DirectConnection, Q_ARG(uint, 0),
+                                      Q_ARG(QBitArray, matches));
+        }
+    }
+
+private:
+    static QVector<QPair<QByteArray, Dataset>> datasets()
+    {
+        static const QVector<QPair<QByteArray, Dataset>> datasets = {
+            {"default", generateDataset(100000, 16, 4, 4)},
+            {"deep", generateDataset(100000, 128, 2, 4)},
+            {"wide", generateDataset(100000, 8, 64, 4)},
+            {"threads", generateDataset(100000, 16, 4, 256)},
+        };
+        return datasets;
+    }
+
+    void addDatasets()
+    {
+        QTest::addColumn<Dataset>("dataset");
+        for (const auto& row : datasets()) {
+            QTest::newRow(row.first.constData()) << row.second;
+        }
+    }
+};
+
+int main(int argc, char** argv)
+{
+    // render into offscreen buffers, such that the results don't depend on the window system
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+
+    BenchGui bench;
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "bench_gui.moc"
@@ -0,0 +1,461 @@
+/*
+  bench_perfparser.cpp
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2017-2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Nate Rogers <nate.rogers@kdab.com>
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QEventLoop>
+#include <QFile>
+#include <QHash>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QtEndian>
+
+#include "data.h"
+#include "perfparser.h"
+
+#include <models/callercalleemodel.h>
+#include <models/eventmodel.h>
+#include <models/treemodel.h>
+
+namespace {
+// when set, this binary acts as hotspot-perfparser and writes the stream passed via --input to stdout
+const char replayVariable[] = "HOTSPOT_BENCHMARK_REPLAY";
+
+struct StreamOptions
+{
+    int samples = 0;
+    int stackDepth = 0;
+    // the number of callees every function can choose from
+    int fanOut = 0;
+    int threads = 0;
+    int costTypes = 0;
+};
+
+// the event types and field layouts match what hotspot-perfparser writes, see PerfParserPrivate::parseEvent
+enum EventType : qint8
+{
+    ThreadStart = 0,
+    ThreadEnd = 1,
+    Command = 2,
+    LocationDefinition = 3,
+    SymbolDefinition = 4,
+    StringDefinition = 5,
+    AttributesDefinition = 11,
+    Sample = 13
+};
+
+class StreamWriter
+{
+public:
+    StreamWriter()
+    {
+        m_stream.append("QPERFSTREAM", 12);
+        const auto version = qToLittleEndian(static_cast<qint32>(QDataStream::Qt_DefaultCompiledVersion));
+        m_stream.append(reinterpret_cast<const char*>(&version), sizeof(version));
+    }
+
+    template<typename Writer>
+    void write(EventType type, Writer writer)
+    {
+        QByteArray payload;
+        QDataStream stream(&payload, QIODevice::WriteOnly);
+        stream << static_cast<qint8>(type);
+        writer(stream);
+        const auto size = qToLittleEndian(static_cast<quint32>(payload.size()));
+        m_stream.append(reinterpret_cast<const char*>(&size), sizeof(size));
+        m_stream.append(payload);
+    }
+
+    qint32 addString(const QByteArray& string)
+    {
+        const auto id = m_numStrings++;
+        write(StringDefinition, [&](QDataStream& stream) { stream << id << string; });
+        return id;
+    }
+
+    QByteArray data() const
+    {
+        return m_stream;
+    }
+
+private:
+    QByteArray m_stream;
+    qint32 m_numStrings = 0;
+};
+
+// a synthetic recording of a single process, the stacks are picked by a fixed seed to make the runs reproducible
+QByteArray generateStream(const StreamOptions& options)
+{
+    StreamWriter writer;
+    const quint32 pid = 1000;
+    const quint64 startTime = 1000000;
+    // 10kHz
+    const quint64 interval = 100000;
+
+    const auto comm = writer.addString("benchmark");
+    const auto binary = writer.addString("libbenchmark.so");
+    const auto path = writer.addString("/usr/lib/libbenchmark.so");
+    for (qint32 type = 0; type < options.costTypes; ++type) {
+        const auto name = writer.addString("cost" + QByteArray::number(type));
+        writer.write(AttributesDefinition, [&](QDataStream& stream) {
+            stream << type << quint32(0) << quint64(type) << name << false << quint64(1);
+        });
+    }
+
+    // every level of the stack has its own set of functions, which bounds the number of unique stacks
+    qint32 numLocations = 0;
+    for (int level = 0; level < options.stackDepth; ++level) {
+        for (int callee = 0; callee < options.fanOut; ++callee) {
+            const auto id = numLocations++;
+            const auto name = writer.addString("func_" + QByteArray::number(level) + '_' + QByteArray::number(callee));
+            writer.write(LocationDefinition, [&](QDataStream& stream) {
+                stream << id << quint64(0x400000 + id * 16) << qint32(-1) << pid << qint32(-1) << qint32(-1)
+                       << qint32(-1);
+            });
+            writer.write(SymbolDefinition,
+                         [&](QDataStream& stream) { stream << id << name << binary << path << false; });
+        }
+    }
+
+    auto writeRecord = [pid](QDataStream& stream, int thread, quint64 time) {
+        stream << pid << static_cast<quint32>(pid + thread) << time << static_cast<quint32>(thread % 4);
+    };
+    for (int thread = 0; thread < options.threads; ++thread) {
+        writer.write(ThreadStart, [&](QDataStream& stream) { writeRecord(stream, thread, startTime); });
+        writer.write(Command, [&](QDataStream& stream) {
+            writeRecord(stream, thread, startTime);
+            stream << comm;
+        });
+    }
+
+    quint32 seed = 42;
+    auto random = [&seed]() {
+        seed = seed * 1103515245 + 12345;
+        return seed >> 16;
+    };
+    QVector<qint32> frames(options.stackDepth);
+    for (int i = 0; i < options.samples; ++i) {
+        const auto thread = i % options.threads;
+        const auto time = startTime + (i + 1) * interval;
+        // the frames are ordered from the sampled function to its outermost caller
+        const auto depth = 1 + static_cast<int>(random() % options.stackDepth);
+        frames.resize(depth);
+        for (int level = 0; level < depth; ++level) {
+            frames[depth - level - 1] = level * options.fanOut + static_cast<int>(random() % options.fanOut);
+        }
+        writer.write(Sample, [&](QDataStream& stream) {
+            writeRecord(stream, thread, time);
+            stream << frames << quint8(0) << static_cast<quint32>(options.costTypes);
+            for (qint32 type = 0; type < options.costTypes; ++type) {
+                stream << type << quint64(1 + random() % 1000);
+            }
+        });
+    }
+
+    const auto endTime = startTime + (options.samples + 1) * interval;
+    for (int thread = 0; thread < options.threads; ++thread) {
+        writer.write(ThreadEnd, [&](QDataStream& stream) { writeRecord(stream, thread, endTime); });
+    }
+    return writer.data();
+}
+
+int replayStream(int argc, char** argv)
+{
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (qstrcmp(argv[i], "--input") == 0) {
+            QFile input(QFile::decodeName(argv[i + 1]));
+            QFile output;
+            if (!input.open(QIODevice::ReadOnly) || !output.open(stdout, QIODevice::WriteOnly)) {
+                return 1;
+            }
+            output.write(input.readAll());
+            return 0;
+        }
+    }
+    return 1;
+}
+
+struct ParseResults
+{
+    Data::BottomUpResults bottomUp;
+    Data::EventResults events;
+};
+}
+
+Q_DECLARE_METATYPE(StreamOptions)
+Q_DECLARE_METATYPE(Data::FilterAction)
+
+// benchmarks of the parser and the aggregation hot paths on synthetic recordings, with one data row per shape of
+// the recording. pass -csv or -o results.xml,xml to get the results in a machine-readable form
+class BenchPerfParser : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase()
+    {
+        qRegisterMetaType<Data::Summary>();
+        qRegisterMetaType<Data::BottomUpResults>();
+        qRegisterMetaType<Data::TopDownResults>();
+        qRegisterMetaType<Data::CallerCalleeResults>();
+        qRegisterMetaType<Data::EventResults>();
+        qRegisterMetaType<Data::FilterCacheStats>();
+        QVERIFY(m_tempDir.isValid());
+    }
+
+    void benchIngestion_data()
+    {
+        addStreams();
+    }
+
+    void benchIngestion()
+    {
+        const auto path = streamPath();
+        QBENCHMARK {
+            PerfParser parser;
+            QVERIFY(parse(&parser, path));
+        }
+    }
+
+    void benchFilter_data()
+    {
+        QTest::addColumn<Data::FilterAction>("filter");
+
+        // the filters get applied to the default stream, every kind of filter on its own
+        const auto results = parseResults(QStringLiteral("default"), defaultOptions());
+        QVERIFY(!results.events.threads.isEmpty() && !results.bottomUp.root.children.isEmpty());
+        const auto& thread = results.events.threads.first();
+        const auto& symbol = results.bottomUp.root.children.first().symbol;
+
+        Data::FilterAction filter;
+        filter.time = {thread.time.start, thread.time.start + thread.time.delta() / 2};
+        QTest::newRow("time") << filter;
+        filter = {};
+        filter.processId = thread.pid;
+        QTest::newRow("process") << filter;
+        filter = {};
+        filter.threadId = thread.tid;
+        QTest::newRow("thread") << filter;
+        filter = {};
+        filter.cpuId = 0;
+        QTest::newRow("cpu") << filter;
+        filter = {};
+        filter.excludeThreadIds = {thread.tid};
+        QTest::newRow("excludeThread") << filter;
+        filter = {};
+        filter.excludeCpuIds = {0};
+        QTest::newRow("excludeCpu") << filter;
+        filter = {};
+        filter.includeSymbols = {symbol};
+        QTest::newRow("includeSymbol") << filter;
+        filter = {};
+        filter.excludeSymbols = {symbol};
+        QTest::newRow("excludeSymbol") << filter;
+        // several of the checks that look at every single event at once
+        filter = {};
+        filter.time = {thread.time.start, thread.time.start + thread.time.delta() / 2};
+        filter.excludeCpuIds = {1, 3};
+        filter.excludeSymbols = {symbol};
+        QTest::newRow("combined") << filter;
+    }
+
+    void benchFilter()
+    {
+        QFETCH(Data::FilterAction, filter);
+
+        // a fresh parser per row, as the filter cache would answer any repeated filter right away
+        PerfParser parser;
+        QVERIFY(parse(&parser, streamPath(QStringLiteral("default"), defaultOptions())));
+        QBENCHMARK_ONCE {
+            QEventLoop loop;
+            connect(&parser, &PerfParser::parsingFinished, &loop, &QEventLoop::quit);
+            parser.filterResults(filter);
+            loop.exec();
+        }
+    }
+
+    void benchTopDown_data()
+    {
+        addStreams();
+    }
+
+    void benchTopDown()
+    {
+        const auto results = parseResults();
+        QBENCHMARK {
+            const auto topDown = Data::TopDownResults::fromBottomUp(results.bottomUp);
+            Q_UNUSED(topDown);
+        }
+    }
+
+    void benchCallerCallee_data()
+    {
+        addStreams();
+    }
+
+    void benchCallerCallee()
+    {
+        const auto results = parseResults();
+        QBENCHMARK {
+            Data::CallerCalleeResults callerCallee;
+            Data::callerCalleesFromBottomUpData(results.bottomUp, &callerCallee);
+        }
+    }
+
+    void benchModels_data()
+    {
+        addStreams();
+    }
+
+    void benchModels()
+    {
+        const auto results = parseResults();
+        const auto topDown = Data::TopDownResults::fromBottomUp(results.bottomUp);
+        Data::CallerCalleeResults callerCallee;
+        Data::callerCalleesFromBottomUpData(results.bottomUp, &callerCallee);
+
+        QBENCHMARK {
+            BottomUpModel bottomUpModel;
+            bottomUpModel.setData(results.bottomUp);
+            TopDownModel topDownModel;
+            topDownModel.setData(topDown);
+            CallerCalleeModel callerCalleeModel;
+            callerCalleeModel.setResults(callerCallee);
+            EventModel eventModel;
+            eventModel.setData(results.events);
+        }
+    }
+
+private:
+    static StreamOptions streamOptions(int samples, int stackDepth, int fanOut, int threads, int costTypes)
+    {
+        StreamOptions options;
+        options.samples = samples;
+        options.stackDepth = stackDepth;
+        options.fanOut = fanOut;
+        options.threads = threads;
+        options.costTypes = costTypes;
+        return options;
+    }
+
+    static StreamOptions defaultOptions()
+    {
+        return streamOptions(100000, 16, 4, 4, 1);
+    }
+
+    void addStreams()
+    {
+        QTest::addColumn<StreamOptions>("options");
+
+        QTest::newRow("default") << defaultOptions();
+        QTest::newRow("deep") << streamOptions(100000, 128, 2, 4, 1);
+        QTest::newRow("wide") << streamOptions(100000, 8, 64, 4, 1);
+        QTest::newRow("threads") << streamOptions(100000, 16, 4, 256, 1);
+        QTest::newRow("costTypes") << streamOptions(100000, 16, 4, 4, 8);
+        QTest::newRow("large") << streamOptions(1000000, 32, 8, 16, 2);
+    }
+
+    // @return the path of the stream for the current data row, the streams get generated once per row
+    QString streamPath()
+    {
+        QFETCH(StreamOptions, options);
+        return streamPath(QString::fromLatin1(QTest::currentDataTag()), options);
+    }
+
+    QString streamPath(const QString& name, const StreamOptions& options)
+    {
+        const auto path = m_tempDir.filePath(name + QLatin1String(".qperfstream"));
+        if (!QFile::exists(path)) {
+            QFile file(path);
+            if (!file.open(QIODevice::WriteOnly)) {
+                return {};
+            }
+            file.write(generateStream(options));
+        }
+        return path;
+    }
+
+    ParseResults parseResults()
+    {
+        QFETCH(StreamOptions, options);
+        return parseResults(QString::fromLatin1(QTest::currentDataTag()), options);
+    }
+
+    // the results of a single parse per stream, cached for the benchmarks that start from the aggregated data
+    ParseResults parseResults(const QString& name, const StreamOptions& options)
+    {
+        auto it = m_results.find(name);
+        if (it == m_results.end()) {
+            PerfParser parser;
+            ParseResults results;
+            connect(&parser, &PerfParser::bottomUpDataAvailable, this,
+                    [&results](const Data::BottomUpResults& data) { results.bottomUp = data; });
+            connect(&parser, &PerfParser::eventsAvailable, this,
+                    [&results](const Data::EventResults& data) { results.events = data; });
+            parse(&parser, streamPath(name, options));
+            it = m_results.insert(name, results);
+        }
+        return it.value();
+    }
+
+    static bool parse(PerfParser* parser, const QString& path)
+    {
+        bool ok = false;
+        QEventLoop loop;
+        connect(parser, &PerfParser::parsingFinished, &loop, [&]() {
+            ok = true;
+            loop.quit();
+        });
+        connect(parser, &PerfParser::parsingFailed, &loop, [&](const QString& error) {
+            qWarning() << "failed to parse" << path << error;
+            loop.quit();
+        });
+        parser->startParseFile(path, {}, {}, {}, {}, {}, {}, PerfParser::ResultsCacheMode::Ignore);
+        loop.exec();
+        return ok;
+    }
+
+    QTemporaryDir m_tempDir;
+    QHash<QString, ParseResults> m_results;
+};
+
+int main(int argc, char** argv)
+{
+    if (qEnvironmentVariableIsSet(replayVariable)) {
+        return replayStream(argc, argv);
+    }
+
+    QCoreApplication app(argc, argv);
+    // the parser runs this binary again instead of hotspot-perfparser, which then just replays the generated streams
+    qputenv("HOTSPOT_PERFPARSER", QFile::encodeName(QCoreApplication::applicationFilePath()));
+    qputenv(replayVariable, "1");
+
+    BenchPerfParser bench;
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "bench_perfparser.moc"
@@ -28,6 +28,7 @@
 #include <QDebug>
 #include <QObject>
 #include <QProcess>
+#include <QRegularExpression>
 #include <QSignalSpy>
 #include <QStandardPaths>
 #include <QTemporaryFile>
@@ -35,6 +36,7 @@
 #include <QTextStream>
 
 #include "data.h"
+#include "perfheader.h"
 #include "perfparser.h"
 #include "perfrecord.h"
 #include "unistd.h"
@@ -337,6 +339,35 @@ private slots:
         QCOMPARE(recordingFinishedSpy.count(), 1);
     }
 
+    void testOverheadPresets()
+    {
+        using Preset = PerfRecord::OverheadPreset;
+        QVERIFY(PerfRecord::presetOptions(Preset::Custom, QStringLiteral("dwarf")).isEmpty());
+
+        const auto settings = PerfRecord::presetSettings(Preset::Production);
+        const auto options = PerfRecord::presetOptions(Preset::Production, QStringLiteral("dwarf"));
+        QCOMPARE(options.mid(0, 6),
+                 QStringList({"--call-graph", "dwarf," + QString::number(settings.dwarfStackSize), "--freq",
+                              QString::number(settings.frequency), "--mmap-pages",
+                              QString::number(settings.mmapPages)}));
+        QCOMPARE(PerfRecord::presetOptions(Preset::Production, QStringLiteral("fp")).mid(0, 2),
+                 QStringList({"--call-graph", "fp"}));
+
+        // backing off lowers the data rate and grows the buffer, but never beyond the last level
+        const auto backedOff = PerfRecord::presetSettings(Preset::Production, 1);
+        QVERIFY(backedOff.frequency < settings.frequency);
+        QVERIFY(backedOff.dwarfStackSize < settings.dwarfStackSize);
+        QVERIFY(backedOff.mmapPages > settings.mmapPages);
+        QCOMPARE(PerfRecord::presetSettings(Preset::Balanced, PerfRecord::MaxBackOffLevel + 1).frequency,
+                 PerfRecord::presetSettings(Preset::Balanced, PerfRecord::MaxBackOffLevel).frequency);
+
+        QCOMPARE(PerfRecord::parseLostEvents(QStringLiteral("[ perf record: Woken up 1 times to write data ]")),
+                 qint64(0));
+        QCOMPARE(PerfRecord::parseLostEvents(QStringLiteral("Processed 1234 events and lost 5 chunks!\n"
+                                                            "Check IO/CPU overload!\nLOST 7 events!\n")),
+                 qint64(12));
+    }
+
     void testSwitchEvents()
     {
         const QStringList perfOptions = {"--call-graph", "dwarf", "--switch-events"};
@@ -461,6 +492,405 @@ private slots:
         QVERIFY(m_bottomUpData.costs.totalCost(2) >= 5E8); // at least .5s sleep time
     }
 
+    void testOffCpuWaitReasons()
+    {
+        const auto sleep = QStandardPaths::findExecutable("sleep");
+        if (sleep.isEmpty()) {
+            QSKIP("no sleep command available");
+        }
+
+        if (!PerfRecord::canProfileOffCpu()) {
+            QSKIP("cannot access sched_switch trace points. execute the following to run this test:\n"
+                  "    sudo mount -o remount,mode=755 /sys/kernel/debug{,/tracing} with mode=755");
+        }
+
+        QStringList perfOptions = {"--call-graph", "dwarf", "-e", "cycles"};
+        perfOptions += PerfRecord::offCpuProfilingOptions();
+        perfOptions += PerfRecord::wakeupProfilingOptions();
+
+        QTemporaryFile tempFile;
+        tempFile.open();
+
+        perfRecord(perfOptions, sleep, {".5"}, tempFile.fileName());
+        testPerfData(Data::Symbol{}, Data::Symbol{}, tempFile.fileName(), false);
+
+        const auto& costs = m_bottomUpData.costs;
+        QCOMPARE(costs.typeName(1), QStringLiteral("sched:sched_switch"));
+        QCOMPARE(costs.typeName(2), QStringLiteral("sched:sched_wakeup"));
+        QCOMPARE(costs.typeName(3), QStringLiteral("off-CPU Time"));
+
+        // the wait reasons only break the off-CPU time down further
+        qint64 waitReasonsCost = 0;
+        int sleepingType = -1;
+        for (int type = 4; type < costs.numTypes(); ++type) {
+            if (costs.typeName(type).startsWith(QLatin1String("off-CPU Time ("))) {
+                waitReasonsCost += costs.totalCost(type);
+            }
+            if (costs.typeName(type) == QLatin1String("off-CPU Time (sleeping)")) {
+                sleepingType = type;
+            }
+        }
+        QVERIFY(sleepingType != -1);
+        QVERIFY(costs.totalCost(sleepingType) >= 5E8); // at least .5s sleep time
+        QVERIFY(waitReasonsCost <= costs.totalCost(3));
+    }
+
+    void testResultsCache()
+    {
+        const QStringList perfOptions = {"--call-graph", "dwarf"};
+        const QString exePath = qApp->applicationDirPath() + "/../tests/test-clients/cpp-inlining/cpp-inlining";
+        QTemporaryFile tempFile;
+        tempFile.open();
+        perfRecord(perfOptions, exePath, {}, tempFile.fileName());
+
+        const auto cacheFile = tempFile.fileName() + QLatin1String(".hotspot-cache");
+        QFile::remove(cacheFile);
+
+        struct Results
+        {
+            Data::Summary summary;
+            Data::BottomUpResults bottomUp;
+            Data::CallerCalleeResults callerCallee;
+            Data::EventResults events;
+        };
+        auto parse = [&tempFile](PerfParser::ResultsCacheMode cacheMode) {
+            PerfParser parser;
+            QSignalSpy parsingFinishedSpy(&parser, &PerfParser::parsingFinished);
+            QSignalSpy summaryDataSpy(&parser, &PerfParser::summaryDataAvailable);
+            QSignalSpy bottomUpDataSpy(&parser, &PerfParser::bottomUpDataAvailable);
+            QSignalSpy callerCalleeDataSpy(&parser, &PerfParser::callerCalleeDataAvailable);
+            QSignalSpy eventsDataSpy(&parser, &PerfParser::eventsAvailable);
+            parser.startParseFile(tempFile.fileName(), "", "", "", "", "", "", cacheMode);
+            VERIFY_OR_THROW(parsingFinishedSpy.wait(6000));
+
+            Results results;
+            results.summary = summaryDataSpy.first().first().value<Data::Summary>();
+            results.bottomUp = bottomUpDataSpy.first().first().value<Data::BottomUpResults>();
+            results.callerCallee = callerCalleeDataSpy.first().first().value<Data::CallerCalleeResults>();
+            results.events = eventsDataSpy.first().first().value<Data::EventResults>();
+            return results;
+        };
+
+        const auto parsed = parse(PerfParser::ResultsCacheMode::Ignore);
+        QVERIFY(!QFile::exists(cacheFile));
+
+        const auto refreshed = parse(PerfParser::ResultsCacheMode::Refresh);
+        QVERIFY(QFile::exists(cacheFile));
+        QVERIFY(refreshed.events == parsed.events);
+
+        const auto cached = parse(PerfParser::ResultsCacheMode::Use);
+        QVERIFY(cached.events == parsed.events);
+        QCOMPARE(cached.summary.sampleCount, parsed.summary.sampleCount);
+        QCOMPARE(cached.summary.costs, parsed.summary.costs);
+        QCOMPARE(cached.summary.command, parsed.summary.command);
+        QCOMPARE(cached.bottomUp.costs.totalCosts(), parsed.bottomUp.costs.totalCosts());
+        QCOMPARE(cached.bottomUp.root.children.size(), parsed.bottomUp.root.children.size());
+        QCOMPARE(cached.callerCallee.entries.size(), parsed.callerCallee.entries.size());
+
+        QFile::remove(cacheFile);
+    }
+
+    void testMultipleFiles()
+    {
+        const QStringList perfOptions = {"--call-graph", "dwarf"};
+        const QString exePath = qApp->applicationDirPath() + "/../tests/test-clients/cpp-inlining/cpp-inlining";
+        QTemporaryFile tempFiles[2];
+        QStringList paths;
+        for (auto& tempFile : tempFiles) {
+            tempFile.open();
+            perfRecord(perfOptions, exePath, {}, tempFile.fileName());
+            paths.append(tempFile.fileName());
+        }
+
+        auto parse = [](const QStringList& files, Data::Summary* summary, Data::EventResults* events) {
+            PerfParser parser;
+            QSignalSpy parsingFinishedSpy(&parser, &PerfParser::parsingFinished);
+            QSignalSpy summaryDataSpy(&parser, &PerfParser::summaryDataAvailable);
+            QSignalSpy eventsDataSpy(&parser, &PerfParser::eventsAvailable);
+            parser.startParseFiles(files, "", "", "", "", "", "");
+            VERIFY_OR_THROW(parsingFinishedSpy.wait(12000));
+            *summary = summaryDataSpy.first().first().value<Data::Summary>();
+            *events = eventsDataSpy.first().first().value<Data::EventResults>();
+        };
+
+        Data::Summary summaries[2];
+        Data::EventResults events[2];
+        for (int i = 0; i < 2; ++i) {
+            parse({paths.at(i)}, &summaries[i], &events[i]);
+            QVERIFY(events[i].files.isEmpty());
+        }
+
+        Data::Summary mergedSummary;
+        Data::EventResults merged;
+        parse(paths, &mergedSummary, &merged);
+        QCOMPARE(merged.files, paths);
+        QCOMPARE(mergedSummary.sampleCount, summaries[0].sampleCount + summaries[1].sampleCount);
+        QCOMPARE(merged.threads.size(), events[0].threads.size() + events[1].threads.size());
+        QCOMPARE(merged.numCpus, events[0].numCpus + events[1].numCpus);
+        QCOMPARE(merged.stacks.size(), events[0].stacks.size() + events[1].stacks.size());
+        for (int i = 0; i < merged.threads.size(); ++i) {
+            QCOMPARE(merged.threads.at(i).fileId, i < events[0].threads.size() ? 0 : 1);
+        }
+        // the CPUs of the second file come after the ones of the first file
+        for (const auto& cpu : merged.cpuEvents()) {
+            QVERIFY(cpu.cpuId < merged.numCpus);
+        }
+    }
+
+    void testPartialResults()
+    {
+        const QStringList perfOptions = {"--call-graph", "dwarf"};
+        const QString exePath = qApp->applicationDirPath() + "/../tests/test-clients/cpp-inlining/cpp-inlining";
+        QTemporaryFile tempFile;
+        tempFile.open();
+        perfRecord(perfOptions, exePath, {}, tempFile.fileName());
+
+        PerfParser parser;
+        auto options = parser.parseOptions();
+        options.partialResultsIntervalMs = 1;
+        parser.setParseOptions(options);
+        QSignalSpy parsingFinishedSpy(&parser, &PerfParser::parsingFinished);
+        QSignalSpy bottomUpDataSpy(&parser, &PerfParser::bottomUpDataAvailable);
+        QSignalSpy partialBottomUpDataSpy(&parser, &PerfParser::partialBottomUpDataAvailable);
+        QSignalSpy partialTopDownDataSpy(&parser, &PerfParser::partialTopDownDataAvailable);
+        parser.startParseFile(tempFile.fileName(), "", "", "", "", "", "");
+        QVERIFY(parsingFinishedSpy.wait(6000));
+
+        QVERIFY(partialBottomUpDataSpy.count() > 0);
+        // the top-down tree is only aggregated while ingesting with ParseOptions::ingestTopDown
+        QCOMPARE(partialTopDownDataSpy.count(), 0);
+
+        const auto bottomUp = bottomUpDataSpy.first().first().value<Data::BottomUpResults>();
+        qint64 lastCost = 0;
+        for (const auto& args : partialBottomUpDataSpy) {
+            auto partial = args.first().value<Data::BottomUpResults>();
+            // the snapshots share their tree with the parser, which leaves the parents unset
+            Data::BottomUp::initializeParents(&partial.root);
+            validateCosts(partial.costs, partial.root);
+            // the partial results only ever grow
+            QVERIFY(partial.costs.totalCost(0) >= lastCost);
+            QVERIFY(partial.costs.totalCost(0) <= bottomUp.costs.totalCost(0));
+            lastCost = partial.costs.totalCost(0);
+        }
+    }
+
+    void testAggregationThreads()
+    {
+        const QStringList perfOptions = {"--call-graph", "dwarf"};
+        const QString exePath = qApp->applicationDirPath() + "/../tests/test-clients/cpp-inlining/cpp-inlining";
+        QTemporaryFile tempFile;
+        tempFile.open();
+        perfRecord(perfOptions, exePath, {}, tempFile.fileName());
+
+        struct Results
+        {
+            Data::BottomUpResults bottomUp;
+            Data::TopDownResults topDown;
+            Data::CallerCalleeResults callerCallee;
+        };
+        auto parse = [&tempFile](int aggregationThreads) {
+            PerfParser parser;
+            auto options = parser.parseOptions();
+            options.aggregationThreads = aggregationThreads;
+            parser.setParseOptions(options);
+            QSignalSpy parsingFinishedSpy(&parser, &PerfParser::parsingFinished);
+            QSignalSpy bottomUpDataSpy(&parser, &PerfParser::bottomUpDataAvailable);
+            QSignalSpy topDownDataSpy(&parser, &PerfParser::topDownDataAvailable);
+            QSignalSpy callerCalleeDataSpy(&parser, &PerfParser::callerCalleeDataAvailable);
+            parser.startParseFile(tempFile.fileName(), "", "", "", "", "", "");
+            VERIFY_OR_THROW(parsingFinishedSpy.wait(6000));
+
+            Results results;
+            results.bottomUp = bottomUpDataSpy.first().first().value<Data::BottomUpResults>();
+            results.topDown = topDownDataSpy.first().first().value<Data::TopDownResults>();
+            results.callerCallee = callerCalleeDataSpy.first().first().value<Data::CallerCalleeResults>();
+            return results;
+        };
+
+        // the chunks of the workers get merged in order, which yields the same trees as aggregating them serially
+        const auto serial = parse(1);
+        const auto parallel = parse(4);
+        QVERIFY(!serial.bottomUp.root.children.isEmpty());
+        QCOMPARE(parallel.bottomUp.costs.totalCosts(), serial.bottomUp.costs.totalCosts());
+        QCOMPARE(printTree(parallel.bottomUp), printTree(serial.bottomUp));
+        QCOMPARE(printTree(parallel.topDown), printTree(serial.topDown));
+        QCOMPARE(printMap(parallel.callerCallee), printMap(serial.callerCallee));
+    }
+
+    void testSupersededFilter()
+    {
+        const QStringList perfOptions = {"--call-graph", "dwarf"};
+        const QString exePath = qApp->applicationDirPath() + "/../tests/test-clients/cpp-inlining/cpp-inlining";
+        QTemporaryFile tempFile;
+        tempFile.open();
+        perfRecord(perfOptions, exePath, {}, tempFile.fileName());
+
+        PerfParser parser;
+        QSignalSpy parsingStartedSpy(&parser, &PerfParser::parsingStarted);
+        QSignalSpy parsingFinishedSpy(&parser, &PerfParser::parsingFinished);
+        QSignalSpy parsingFailedSpy(&parser, &PerfParser::parsingFailed);
+        QSignalSpy bottomUpDataSpy(&parser, &PerfParser::bottomUpDataAvailable);
+        QSignalSpy eventsDataSpy(&parser, &PerfParser::eventsAvailable);
+        parser.startParseFile(tempFile.fileName(), "", "", "", "", "", "");
+        QVERIFY(parsingFinishedSpy.wait(6000));
+        const auto bottomUp = bottomUpDataSpy.first().first().value<Data::BottomUpResults>();
+        const auto events = eventsDataSpy.first().first().value<Data::EventResults>();
+        QVERIFY(!events.threads.isEmpty());
+
+        // the second filter supersedes the first one, only its results get reported
+        Data::FilterAction byTime;
+        byTime.time = {events.threads.first().time.start, events.threads.first().time.start + 1};
+        Data::FilterAction collapsed;
+        collapsed.collapseRecursion = true;
+        parsingStartedSpy.clear();
+        parsingFinishedSpy.clear();
+        bottomUpDataSpy.clear();
+        parser.filterResults(byTime);
+        parser.filterResults(collapsed);
+        QVERIFY(parsingFinishedSpy.wait(6000));
+        QTest::qWait(100);
+
+        QCOMPARE(parsingStartedSpy.count(), 1);
+        QCOMPARE(parsingFinishedSpy.count(), 1);
+        QCOMPARE(parsingFailedSpy.count(), 0);
+        QCOMPARE(bottomUpDataSpy.count(), 1);
+        const auto filtered = bottomUpDataSpy.first().first().value<Data::BottomUpResults>();
+        QCOMPARE(filtered.costs.totalCosts(), bottomUp.costs.totalCosts());
+    }
+
+    void testHeader()
+    {
+        const QStringList perfOptions = {"--call-graph", "dwarf"};
+        const QString exePath = qApp->applicationDirPath() + "/../tests/test-clients/cpp-inlining/cpp-inlining";
+        QTemporaryFile tempFile;
+        tempFile.open();
+        perfRecord(perfOptions, exePath, {}, tempFile.fileName());
+
+        PerfHeader::Info header;
+        QString error;
+        QVERIFY2(PerfHeader::read(tempFile.fileName(), &header, &error), qPrintable(error));
+        QVERIFY(header.dataSize > 0);
+        QVERIFY(!header.eventNames.isEmpty());
+
+        PerfParser parser;
+        QSignalSpy parsingFinishedSpy(&parser, &PerfParser::parsingFinished);
+        QSignalSpy headerDataSpy(&parser, &PerfParser::headerDataAvailable);
+        QSignalSpy summaryDataSpy(&parser, &PerfParser::summaryDataAvailable);
+        parser.startParseFile(tempFile.fileName(), "", "", "", "", "", "");
+        QVERIFY(parsingFinishedSpy.wait(6000));
+        QCOMPARE(headerDataSpy.count(), 1);
+        QCOMPARE(summaryDataSpy.count(), 1);
+
+        // the header gets read before perfparser is done, but both agree on the system summary
+        const auto early = headerDataSpy.first().first().value<PerfHeader::Info>().summary;
+        const auto summary = summaryDataSpy.first().first().value<Data::Summary>();
+        QCOMPARE(early.hostName, summary.hostName);
+        QCOMPARE(early.linuxKernelVersion, summary.linuxKernelVersion);
+        QCOMPARE(early.cpuArchitecture, summary.cpuArchitecture);
+        QCOMPARE(early.cpusOnline, summary.cpusOnline);
+        QCOMPARE(early.cpusAvailable, summary.cpusAvailable);
+        QCOMPARE(early.command, summary.command);
+
+        QTemporaryFile invalidFile;
+        invalidFile.open();
+        invalidFile.write("not a perf.data file");
+        invalidFile.flush();
+        QVERIFY(!PerfHeader::read(invalidFile.fileName(), &header, &error));
+        QVERIFY(!error.isEmpty());
+    }
+
+    void testScriptOutput()
+    {
+        const QStringList perfOptions = {"--call-graph", "dwarf"};
+        const QString exePath = qApp->applicationDirPath() + "/../tests/test-clients/cpp-inlining/cpp-inlining";
+        QTemporaryFile tempFile;
+        tempFile.open();
+        perfRecord(perfOptions, exePath, {}, tempFile.fileName());
+
+        QTemporaryFile scriptFile;
+        QVERIFY(scriptFile.open());
+
+        PerfParser parser;
+        parser.setScriptOutput(scriptFile.fileName());
+        QSignalSpy parsingFinishedSpy(&parser, &PerfParser::parsingFinished);
+        QSignalSpy summaryDataSpy(&parser, &PerfParser::summaryDataAvailable);
+        parser.startParseFile(tempFile.fileName(), "", "", "", "", "", "");
+        QVERIFY(parsingFinishedSpy.wait(6000));
+        const auto summary = summaryDataSpy.first().first().value<Data::Summary>();
+
+        // the output is complete once the parse finished, every sample starts with a header line
+        // followed by one line per frame and ends with an empty line
+        const auto output = scriptFile.readAll();
+        QVERIFY(output.endsWith("\n\n"));
+        const QRegularExpression header(QStringLiteral("^[^\\t]*\\t\\d+\\t\\d+\\.\\d{9}:\\t\\d+ \\S+$"));
+        const QRegularExpression frame(QStringLiteral("^\\t[0-9a-f]{16} .+ \\(.*\\)$"));
+        quint64 numSamples = 0;
+        bool inSample = false;
+        bool sawClient = false;
+        for (const auto& line : output.split('\n')) {
+            const auto text = QString::fromUtf8(line);
+            if (text.isEmpty()) {
+                inSample = false;
+            } else if (!inSample) {
+                QVERIFY2(header.match(text).hasMatch(), qPrintable(text));
+                inSample = true;
+                ++numSamples;
+            } else {
+                QVERIFY2(frame.match(text).hasMatch(), qPrintable(text));
+                sawClient = sawClient || text.endsWith(QLatin1String("(cpp-inlining)"));
+            }
+        }
+        QCOMPARE(numSamples, summary.sampleCount);
+        QVERIFY(sawClient);
+    }
+
+    void testEventRetention()
+    {
+        const QStringList perfOptions = {"--call-graph", "dwarf"};
+        const QString exePath = qApp->applicationDirPath() + "/../tests/test-clients/cpp-inlining/cpp-inlining";
+        QTemporaryFile tempFile;
+        tempFile.open();
+        perfRecord(perfOptions, exePath, {}, tempFile.fileName());
+
+        auto parse = [&tempFile](Data::BottomUpResults* bottomUp, Data::EventResults* events) {
+            PerfParser parser;
+            QSignalSpy parsingFinishedSpy(&parser, &PerfParser::parsingFinished);
+            QSignalSpy bottomUpDataSpy(&parser, &PerfParser::bottomUpDataAvailable);
+            QSignalSpy eventsDataSpy(&parser, &PerfParser::eventsAvailable);
+            parser.startParseFile(tempFile.fileName(), "", "", "", "", "", "");
+            QVERIFY(parsingFinishedSpy.wait(6000));
+            *bottomUp = bottomUpDataSpy.first().first().value<Data::BottomUpResults>();
+            *events = eventsDataSpy.first().first().value<Data::EventResults>();
+        };
+
+        Data::BottomUpResults fullBottomUp;
+        Data::EventResults fullEvents;
+        parse(&fullBottomUp, &fullEvents);
+
+        const int maxEvents = 10;
+        qputenv("HOTSPOT_EVENT_RETENTION_PER_THREAD", QByteArray::number(maxEvents));
+        Data::BottomUpResults bottomUp;
+        Data::EventResults events;
+        parse(&bottomUp, &events);
+        qunsetenv("HOTSPOT_EVENT_RETENTION_PER_THREAD");
+
+        // only the most recent events are kept
+        QCOMPARE(events.threads.size(), fullEvents.threads.size());
+        for (int i = 0; i < events.threads.size(); ++i) {
+            const auto& thread = events.threads.at(i);
+            const auto& fullThread = fullEvents.threads.at(i);
+            QCOMPARE(thread.events.size(), std::min(maxEvents, fullThread.events.size()));
+            if (!thread.events.isEmpty()) {
+                QCOMPARE(thread.events.at(thread.events.size() - 1),
+                         fullThread.events.at(fullThread.events.size() - 1));
+            }
+        }
+
+        // but the aggregated costs still cover all of them
+        validateCosts(bottomUp.costs, bottomUp.root);
+        QCOMPARE(bottomUp.costs.totalCost(0), fullBottomUp.costs.totalCost(0));
+    }
+
     void testSampleCpu()
     {
         QStringList perfOptions = {"--call-graph", "dwarf", "--sample-cpu", "-e", "cycles"};
@@ -479,7 +909,7 @@ private slots:
         testPerfData({}, {}, tempFile.fileName(), false);
 
         QCOMPARE(m_eventData.threads.size(), numThreads + 1);
-        QCOMPARE(m_eventData.cpus.size(), numThreads);
+        QCOMPARE(m_eventData.numCpus, static_cast<quint32>(numThreads));
 
         if (PerfRecord::canProfileOffCpu()) {
             QCOMPARE(m_bottomUpData.costs.numTypes(), 3);
@@ -583,6 +1013,7 @@ private:
         VERIFY_OR_THROW(m_summaryData.sampleCount > 0);
         VERIFY_OR_THROW(m_summaryData.applicationRunningTime > 0);
         VERIFY_OR_THROW(m_summaryData.cpusAvailable > 0);
+        VERIFY_OR_THROW(m_summaryData.stageTimes.parsing > 0);
         COMPARE_OR_THROW(m_summaryData.processCount, quint32(1)); // for now we always have a single process
         VERIFY_OR_THROW(m_summaryData.threadCount > 0); // and at least one thread
         COMPARE_OR_THROW(m_summaryData.cpuArchitecture, QSysInfo::currentCpuArchitecture());
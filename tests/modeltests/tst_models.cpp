@@ -25,18 +25,96 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <QBuffer>
+#include <QDataStream>
 #include <QDebug>
+#include <QFileInfo>
 #include <QObject>
 #include <QTest>
 #include <QTextStream>
+#include <QtEndian>
+
+#include <ThreadWeaver/ThreadWeaver>
+
+#include <cmath>
 
 #include "modeltest.h"
 
+#include <models/arrowexport.h>
+#include <models/cputopology.h>
+#include <models/disassembly.h>
 #include <models/eventmodel.h>
+#include <models/filterandzoomstack.h>
+#include <models/jobscheduler.h>
+#include <models/latencymodel.h>
+#include <models/profileexport.h>
+#include <models/timelineproxy.h>
 
 #include "../testutils.h"
 
 namespace {
+template<typename T>
+T readLittleEndian(const QByteArray& data, int pos)
+{
+    return qFromLittleEndian<T>(data.constData() + pos);
+}
+
+// @return the position of the field @p id of the flatbuffers table at @p table, or -1 when it isn't set
+int flatBufferField(const QByteArray& data, int table, int id)
+{
+    const int vtable = table - readLittleEndian<qint32>(data, table);
+    if (4 + 2 * id >= readLittleEndian<quint16>(data, vtable)) {
+        return -1;
+    }
+    const int offset = readLittleEndian<quint16>(data, vtable + 4 + 2 * id);
+    return offset ? table + offset : -1;
+}
+
+// @return the position of the object referenced by the offset at @p pos
+int flatBufferOffset(const QByteArray& data, int pos)
+{
+    return pos + readLittleEndian<quint32>(data, pos);
+}
+
+// the costs read by the CostDelegate must match the ones of the sort and total cost roles
+template<typename Model>
+void verifyCellCosts(const Model& model, const QModelIndex& parent = {})
+{
+    for (int row = 0, numRows = model.rowCount(parent); row < numRows; ++row) {
+        for (int column = 0, numColumns = model.columnCount(parent); column < numColumns; ++column) {
+            const auto index = model.index(row, column, parent);
+            const auto totalCost = index.data(Model::TotalCostRole);
+            qint64 cellCost = 0;
+            qint64 cellTotalCost = 0;
+            QCOMPARE(model.cellCost(index, &cellCost, &cellTotalCost), totalCost.isValid());
+            if (totalCost.isValid()) {
+                QCOMPARE(cellCost, index.data(Model::SortRole).toLongLong());
+                QCOMPARE(cellTotalCost, totalCost.toLongLong());
+            }
+        }
+        verifyCellCosts(model, model.index(row, 0, parent));
+    }
+}
+
+Data::TracepointEvents generateTracepoint()
+{
+    Data::TracepointEvents tracepoint;
+    tracepoint.system = QStringLiteral("block");
+    tracepoint.name = QStringLiteral("block_rq_issue");
+    tracepoint.times = {10, 20, 30};
+    tracepoint.threadIds = {2, 2, 3};
+    tracepoint.strings = {QStringLiteral("sda"), QStringLiteral("sdb")};
+    Data::TracepointField device;
+    device.name = QStringLiteral("dev");
+    device.type = Data::TracepointField::Type::String;
+    device.values = {0, 0, 1};
+    Data::TracepointField sectors;
+    sectors.name = QStringLiteral("nr_sector");
+    sectors.values = {8, 4, 16};
+    tracepoint.fields = {device, sectors};
+    return tracepoint;
+}
+
 Data::BottomUpResults buildBottomUpTree(const QByteArray& stacks)
 {
     Data::BottomUpResults ret;
@@ -67,6 +145,74 @@ Data::BottomUpResults buildBottomUpTree(const QByteArray& stacks)
     return ret;
 }
 
+void addStackEvents(const QByteArray& stacks, Data::BottomUpResults* results)
+{
+    if (!results->costs.numTypes()) {
+        results->costs.addType(0, "samples", Data::Costs::Unit::Unknown);
+    }
+    for (const auto& line : stacks.split('\n')) {
+        auto trimmed = line.trimmed();
+        if (trimmed.isEmpty()) {
+            continue;
+        }
+        QVector<qint32> frames;
+        const auto& symbols = trimmed.split(';');
+        for (auto it = symbols.rbegin(), end = symbols.rend(); it != end; ++it) {
+            const auto symbol = Data::Symbol{*it, {}};
+            auto locationId = results->symbols.indexOf(symbol);
+            if (locationId == -1) {
+                locationId = results->symbols.size();
+                results->symbols.push_back(symbol);
+                results->locations.push_back({-1, {}});
+            }
+            frames.push_back(locationId);
+        }
+        results->addEvent(0, 1, frames, [](const Data::Symbol&, const Data::Location&) {});
+    }
+}
+
+void addTopDownEvents(const QByteArray& stacks, Data::TopDownResults* results)
+{
+    for (const auto& line : stacks.split('\n')) {
+        auto trimmed = line.trimmed();
+        if (trimmed.isEmpty()) {
+            continue;
+        }
+        QVector<Data::Symbol> stack;
+        const auto& symbols = trimmed.split(';');
+        for (auto it = symbols.rbegin(), end = symbols.rend(); it != end; ++it) {
+            stack.push_back(Data::Symbol{*it, {}});
+        }
+        results->addEvent(0, 1, stack);
+    }
+}
+
+void printTreeIds(const Data::BottomUp& tree, const Data::BottomUpResults& results, QStringList* entries)
+{
+    for (const auto& entry : tree.children) {
+        entries->push_back(entry.symbol.symbol + '#' + QString::number(entry.id) + '=' + printCost(entry, results));
+        printTreeIds(entry, results, entries);
+    }
+}
+
+void printMatches(const Data::BottomUp& tree, const QBitArray& matches, const QString& indent, QStringList* entries)
+{
+    for (const auto& entry : tree.children) {
+        if (static_cast<int>(entry.id) < matches.size() && matches.testBit(entry.id)) {
+            entries->push_back(indent + entry.symbol.symbol);
+            printMatches(entry, matches, indent + ' ', entries);
+        }
+    }
+}
+
+QStringList searchTree(const Data::BottomUpResults& results, const QString& needle)
+{
+    Data::TreeSearch<Data::BottomUp> search(needle, false, []() { return false; });
+    QStringList entries;
+    printMatches(results.root, search.run(results.root), {}, &entries);
+    return entries;
+}
+
 Data::BottomUpResults generateTree1()
 {
     return buildBottomUpTree(R"(
@@ -100,6 +246,45 @@ private slots:
         }
     }
 
+    void testTreeArena()
+    {
+        const auto tree = generateTree1();
+        Data::TreeArena<Data::BottomUp> arena(&tree.root);
+
+        // nothing but the root gets materialized up front
+        QCOMPARE(arena.size(), 1);
+        const auto root = arena.node(arena.Root);
+        QCOMPARE(root.item, &tree.root);
+        QCOMPARE(root.numChildren, tree.root.children.size());
+        QCOMPARE(root.firstChild, -1);
+
+        int numNodes = 1;
+        for (int i = 0; i < arena.size(); ++i) {
+            // copy, materializing the children invalidates references
+            const auto node = arena.node(i);
+            QCOMPARE(node.numChildren, node.item->children.size());
+            for (int row = 0; row < node.numChildren; ++row) {
+                const auto child = arena.node(arena.child(i, row));
+                QCOMPARE(child.item, &node.item->children.at(row));
+                QCOMPARE(child.parent, i);
+                QCOMPARE(child.row, row);
+                ++numNodes;
+            }
+            QCOMPARE(arena.child(i, node.numChildren), -1);
+        }
+        QCOMPARE(numNodes, arena.size());
+    }
+
+    void testTreeSearch()
+    {
+        const auto tree = generateTree1();
+
+        QCOMPARE(searchTree(tree, QStringLiteral("d")), QStringList {QStringLiteral("D")});
+        QCOMPARE(searchTree(tree, QStringLiteral("x")), QStringList());
+        const QStringList expectedE = {"C", " E", "E", " C", "  E"};
+        QCOMPARE(searchTree(tree, QStringLiteral("E")), expectedE);
+    }
+
     void testBottomUpModel()
     {
         const auto tree = generateTree1();
@@ -115,6 +300,467 @@ private slots:
         ModelTest tester(&model);
 
         model.setData(tree);
+        verifyCellCosts(model);
+    }
+
+    void testIdPairs()
+    {
+        Data::IdPairs pairs;
+        QCOMPARE(pairs.add(2, 1), 0);
+        QCOMPARE(pairs.add(0, 1), 1);
+        QCOMPARE(pairs.add(2, 3), 2);
+        QCOMPARE(pairs.add(2, 1), 0);
+        pairs.finalize();
+        QCOMPARE(pairs.size(), 3);
+
+        auto toList = [](const Data::IdPairs::Range& range) {
+            QVector<int> ret;
+            for (auto pair : range) {
+                ret.append(pair);
+            }
+            return ret;
+        };
+        QCOMPARE(toList(pairs.withFirst(0)), QVector<int>({1}));
+        QCOMPARE(toList(pairs.withFirst(1)), QVector<int>());
+        QCOMPARE(toList(pairs.withFirst(2)), QVector<int>({0, 2}));
+        QCOMPARE(toList(pairs.withFirst(4)), QVector<int>());
+        QCOMPARE(toList(pairs.withSecond(1)), QVector<int>({0, 1}));
+        QCOMPARE(toList(pairs.withSecond(3)), QVector<int>({2}));
+
+        // the lookup gets rebuilt when adding after finalize
+        QCOMPARE(pairs.add(2, 3), 2);
+        QCOMPARE(pairs.add(1, 1), 3);
+    }
+
+    void testCosts()
+    {
+        Data::Costs costs;
+        costs.addType(0, QStringLiteral("a"), Data::Costs::Unit::Unknown);
+        costs.add(0, 3, 5);
+        costs.increment(0, 1);
+        QCOMPARE(costs.cost(0, 3), qint64(5));
+        QCOMPARE(costs.cost(0, 1), qint64(1));
+        QCOMPARE(costs.cost(0, 2), qint64(0));
+        QCOMPARE(costs.cost(0, 100), qint64(0));
+
+        // adding a type later on keeps the existing costs
+        costs.addType(2, QStringLiteral("c"), Data::Costs::Unit::Time);
+        QCOMPARE(costs.numTypes(), 3);
+        costs.add(2, 3, 7);
+        QCOMPARE(costs.cost(0, 3), qint64(5));
+        QCOMPARE(costs.cost(1, 3), qint64(0));
+        QCOMPARE(costs.cost(2, 3), qint64(7));
+        QCOMPARE(costs.cost(0, 1), qint64(1));
+
+        const auto view = costs.itemCostView(3);
+        QCOMPARE(view.size(), 3);
+        QCOMPARE(view.sum(), qint64(12));
+        QCOMPARE(costs.itemCostView(100).sum(), qint64(0));
+
+        Data::Costs other;
+        other.initializeCostsFrom(costs);
+        other.add(5, view);
+        other.add(5, costs.itemCost(1));
+        QCOMPARE(other.cost(0, 5), qint64(6));
+        QCOMPARE(other.cost(2, 5), qint64(7));
+        QCOMPARE(other.typeName(2), QStringLiteral("c"));
+    }
+
+    void testParseProgress()
+    {
+        Data::ParseProgress progress;
+        QCOMPARE(progress.eventsPerSecond(), 0.);
+        QCOMPARE(progress.remainingTime(), qint64(-1));
+
+        progress.events = 3000;
+        progress.samples = 1000;
+        progress.elapsed = 2000000000;
+        QCOMPARE(progress.eventsPerSecond(), 1500.);
+        QCOMPARE(progress.samplesPerSecond(), 500.);
+        // nothing to extrapolate from yet
+        QCOMPARE(progress.remainingTime(), qint64(-1));
+
+        progress.fraction = 0.25f;
+        QCOMPARE(progress.remainingTime(), qint64(6000000000));
+        progress.fraction = 1;
+        QCOMPARE(progress.remainingTime(), qint64(0));
+
+        // the duration of the later stages isn't known upfront
+        progress.stage = Data::ParseProgress::Stage::Aggregation;
+        QCOMPARE(progress.remainingTime(), qint64(-1));
+    }
+
+    void testDerivedMetrics()
+    {
+        Data::Costs costs;
+        costs.addType(0, QStringLiteral("cpu/cycles/u"), Data::Costs::Unit::Unknown);
+        costs.addType(1, QStringLiteral("instructions:u"), Data::Costs::Unit::Unknown);
+        costs.addType(2, QStringLiteral("cache-misses"), Data::Costs::Unit::Unknown);
+        costs.add(0, 0, 100);
+        costs.add(1, 0, 150);
+        costs.add(1, 1, 20);
+        costs.add(2, 1, 3);
+        costs.addTotalCost(0, 100);
+        costs.addTotalCost(1, 170);
+
+        const auto ratios = costs.ratios(1, 0);
+        QCOMPARE(ratios.size(), 2);
+        QCOMPARE(ratios[0], 1.5);
+        QVERIFY(std::isnan(ratios[1]));
+
+        // without any cache-references only the IPC can be derived
+        const auto metrics = Data::derivedMetrics(costs);
+        QCOMPARE(metrics.size(), 1);
+        QCOMPARE(metrics[0].numerator, 1);
+        QCOMPARE(metrics[0].denominator, 0);
+        QCOMPARE(metrics[0].formatValue(1.5), QStringLiteral("1.50"));
+        QCOMPARE(metrics[0].formatValue(std::numeric_limits<double>::quiet_NaN()), QString());
+
+        const Data::DerivedMetricValues values(costs);
+        QCOMPARE(values.numMetrics(), 1);
+        QCOMPARE(values.value(0, 0), 1.5);
+        QVERIFY(std::isnan(values.value(0, 1)));
+        QVERIFY(std::isnan(values.value(0, 100)));
+        QCOMPARE(values.totalValue(0), 1.7);
+
+        const QVector<QString> typeNames = {QStringLiteral("cpu/cache-misses/"), QStringLiteral("cache-references:u")};
+        const auto missRate =
+            Data::parseDerivedMetric(QStringLiteral("misses"), QStringLiteral("cache-misses / cache-references"),
+                                     typeNames, Data::DerivedMetric::Format::Percentage, false);
+        QVERIFY(missRate.isValid());
+        QCOMPARE(missRate.numerator, 0);
+        QCOMPARE(missRate.denominator, 1);
+        QCOMPARE(missRate.formatValue(missRate.value(1, 4)), QStringLiteral("25.00%"));
+        QVERIFY(!Data::parseDerivedMetric(QStringLiteral("invalid"), QStringLiteral("cycles / cache-references"),
+                                          typeNames)
+                     .isValid());
+        QVERIFY(!Data::parseDerivedMetric(QStringLiteral("invalid"), QStringLiteral("cache-misses"), typeNames)
+                     .isValid());
+    }
+
+    void testRecursionGuard()
+    {
+        const Data::Symbol a("A");
+        const Data::Symbol b("B");
+
+        Data::RecursionGuard guard;
+        QVERIFY(guard.isEmpty());
+        QVERIFY(!guard.contains(a));
+        QVERIFY(guard.insert(a));
+        QVERIFY(!guard.isEmpty());
+        QVERIFY(guard.contains(a));
+        QVERIFY(!guard.insert(a));
+        QVERIFY(!guard.contains(b));
+        QVERIFY(guard.insert(b));
+
+        guard.reset();
+        QVERIFY(guard.isEmpty());
+        QVERIFY(!guard.contains(a));
+        QVERIFY(!guard.contains(b));
+        QVERIFY(guard.insert(b));
+        QVERIFY(!guard.insert(b));
+    }
+
+    void testMergeBottomUp()
+    {
+        const QByteArray firstHalf = R"(
+            A;B;C
+            A;B;D
+            A;B;C;E
+            C
+        )";
+        const QByteArray secondHalf = R"(
+            A;B;D
+            A;B;C;E;C
+            X;Y
+            A;B;C;E;C;E
+            A;B;C;C
+            C
+        )";
+
+        Data::BottomUpResults full;
+        addStackEvents(firstHalf + secondHalf, &full);
+
+        Data::BottomUpResults merged;
+        addStackEvents(firstHalf, &merged);
+        Data::BottomUpResults second;
+        addStackEvents(secondHalf, &second);
+        merged.merge(second);
+
+        QCOMPARE(merged.costs.totalCost(0), full.costs.totalCost(0));
+        QStringList expectedIds;
+        printTreeIds(full.root, full, &expectedIds);
+        QStringList actualIds;
+        printTreeIds(merged.root, merged, &actualIds);
+        QCOMPARE(actualIds, expectedIds);
+
+        Data::BottomUp::initializeParents(&full.root);
+        Data::BottomUp::initializeParents(&second.root);
+        Data::BottomUp::initializeParents(&merged.root);
+        QCOMPARE(printTree(merged), printTree(full));
+
+        Data::BottomUpResults first;
+        addStackEvents(firstHalf, &first);
+        Data::BottomUp::initializeParents(&first.root);
+
+        Data::CallerCalleeResults expectedCallerCallee;
+        Data::callerCalleesFromBottomUpData(full, &expectedCallerCallee);
+        Data::CallerCalleeResults mergedCallerCallee;
+        Data::callerCalleesFromBottomUpData(first, &mergedCallerCallee);
+        Data::CallerCalleeResults secondCallerCallee;
+        Data::callerCalleesFromBottomUpData(second, &secondCallerCallee);
+        mergedCallerCallee.merge(secondCallerCallee);
+        QCOMPARE(printMap(mergedCallerCallee), printMap(expectedCallerCallee));
+    }
+
+    void testDiffBottomUp()
+    {
+        Data::BottomUpResults baseline;
+        addStackEvents(R"(
+            A;B;C
+            A;B;C
+            A;D
+        )",
+                       &baseline);
+        Data::BottomUpResults candidate;
+        addStackEvents(R"(
+            A;B;C
+            A;B;C;E
+            X
+        )",
+                       &candidate);
+
+        const auto diff = Data::BottomUpResults::diff(baseline, candidate);
+        const QStringList expectedTree = {"C=-1", " B=-1", "  A=-1", "E=1", " C=1", "  B=1", "   A=1", "X=1",
+                                          "D=-1", " A=-1"};
+        QCOMPARE(printTree(diff), expectedTree);
+        QCOMPARE(diff.costs.numTypes(), 1);
+        QCOMPARE(diff.costs.totalCost(0), baseline.costs.totalCost(0));
+        QCOMPARE(diff.costs.formatCost(0, -1), QStringLiteral("-1"));
+
+        // the same function of two builds only differs in the path of its binary
+        auto addSymbolEvent = [](const QString& path, int cost, Data::BottomUpResults* results) {
+            results->costs.addType(0, "samples", Data::Costs::Unit::Unknown);
+            results->symbols.push_back({"foo", "libfoo.so", path});
+            results->locations.push_back({-1, {}});
+            results->addEvent(0, cost, {0}, [](const Data::Symbol&, const Data::Location&) {});
+        };
+        Data::BottomUpResults first;
+        addSymbolEvent("/build-a/libfoo.so", 3, &first);
+        Data::BottomUpResults second;
+        addSymbolEvent("/build-b/libfoo.so", 5, &second);
+        const auto pathDiff = Data::BottomUpResults::diff(first, second);
+        QCOMPARE(printTree(pathDiff), QStringList{"foo=2"});
+    }
+
+    void testWideTree()
+    {
+        // enough distinct children to make use of the child index
+        const int numCallees = 3 * Data::SymbolTreeIndex::MinimumRows;
+        QByteArray stacks;
+        for (int round = 0; round < 2; ++round) {
+            for (int i = 0; i < numCallees; ++i) {
+                stacks += "main;dispatch;op" + QByteArray::number(i) + '\n';
+            }
+        }
+
+        Data::BottomUpResults tree;
+        addStackEvents(stacks, &tree);
+        Data::BottomUp::initializeParents(&tree.root);
+
+        QCOMPARE(tree.root.children.size(), numCallees);
+        for (const auto& leaf : tree.root.children) {
+            QCOMPARE(tree.costs.cost(0, leaf.id), qint64(2));
+        }
+
+        const auto topDown = Data::TopDownResults::fromBottomUp(tree);
+        QCOMPARE(topDown.root.children.size(), 1);
+        const auto& dispatch = topDown.root.children.first().children;
+        QCOMPARE(dispatch.size(), 1);
+        QCOMPARE(dispatch.first().children.size(), numCallees);
+        for (const auto& leaf : dispatch.first().children) {
+            QCOMPARE(topDown.selfCosts.cost(0, leaf.id), qint64(2));
+        }
+    }
+
+    void testPruneTree()
+    {
+        auto tree = generateTree1();
+        const auto topDown = Data::TopDownResults::fromBottomUp(tree);
+
+        auto unpruned = tree;
+        unpruned.prune(0);
+        QCOMPARE(printTree(unpruned), printTree(tree));
+
+        // only C has at least 30% of all nine samples, at every level
+        tree.prune(0.3);
+        const QStringList expectedBottomUp = {"C=5", " [other]=3", "[other]=4"};
+        QCOMPARE(printTree(tree), expectedBottomUp);
+        QCOMPARE(tree.costs.totalCost(0), qint64(9));
+        for (const auto& node : tree.root.children) {
+            QVERIFY(!node.parent);
+            for (const auto& child : node.children) {
+                QCOMPARE(child.parent, &node);
+            }
+        }
+
+        auto prunedTopDown = topDown;
+        prunedTopDown.prune(0.3);
+        auto topDownEntries = printTree(prunedTopDown);
+        topDownEntries.sort();
+        QStringList expectedTopDown = {"A=s:0,i:7", " B=s:0,i:7", "  C=s:1,i:5", "   E=s:1,i:3",
+                                       "    [other]=s:2,i:2", "   [other]=s:1,i:1", "  [other]=s:2,i:2",
+                                       "[other]=s:2,i:2"};
+        expectedTopDown.sort();
+        QCOMPARE(topDownEntries, expectedTopDown);
+    }
+
+    void testDeepTree()
+    {
+        // a deep recursion, the trees get traversed without recursing over their depth
+        const int depth = 20000;
+        QByteArray stack = "a";
+        for (int i = 1; i < depth; ++i) {
+            stack += i % 2 ? ";b" : ";a";
+        }
+
+        Data::BottomUpResults tree;
+        addStackEvents(stack, &tree);
+        Data::BottomUp::initializeParents(&tree.root);
+
+        const auto topDown = Data::TopDownResults::fromBottomUp(tree);
+        const auto* node = &topDown.root;
+        for (int i = 0; i < depth; ++i) {
+            QCOMPARE(node->children.size(), 1);
+            QCOMPARE(node->children.first().parent, i ? node : nullptr);
+            node = &node->children.first();
+        }
+        QVERIFY(node->children.isEmpty());
+        QCOMPARE(node->symbol.symbol, QStringLiteral("b"));
+        QCOMPARE(topDown.selfCosts.cost(0, node->id), qint64(1));
+        QCOMPARE(topDown.inclusiveCosts.cost(0, topDown.root.children.first().id), qint64(1));
+
+        Data::CallerCalleeResults results;
+        Data::callerCalleesFromBottomUpData(tree, &results);
+        const QStringList expectedMap = {"a=s:0,i:1", "a<b=1", "a>b=1", "b=s:1,i:1", "b<a=1", "b>a=1"};
+        QCOMPARE(printMap(results), expectedMap);
+
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        QVERIFY(ProfileExport::writeCollapsed(&buffer, tree, 0));
+        QCOMPARE(buffer.data(), stack + " 1\n");
+    }
+
+    void testCollapsedExport()
+    {
+        const auto tree = generateTree1();
+
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        QVERIFY(ProfileExport::writeCollapsed(&buffer, tree, 0));
+        auto lines = QString::fromUtf8(buffer.data()).split('\n', QString::SkipEmptyParts);
+        lines.sort();
+        const QStringList expected = {"A;B;C 1", "A;B;C;C 1", "A;B;C;E 1", "A;B;C;E;C 1",
+                                      "A;B;C;E;C;E 1", "A;B;D 2", "C 2"};
+        QCOMPARE(lines, expected);
+    }
+
+    void testPprofExport()
+    {
+        Data::BottomUpResults results;
+        addStackEvents("main;foo", &results);
+
+        Data::EventResults events;
+        events.totalCosts = {{"samples", 3, 3, Data::Costs::Unit::Unknown}};
+        // the stacks are ordered from the sampled function to its callers
+        events.stacks = {{results.symbols.indexOf(Data::Symbol{"foo", {}}),
+                          results.symbols.indexOf(Data::Symbol{"main", {}})}};
+        Data::ThreadEvents thread;
+        thread.pid = 1;
+        thread.tid = 1;
+        thread.name = "main";
+        for (int i = 0; i < 3; ++i) {
+            Data::Event event;
+            event.time = i;
+            event.cost = 1;
+            event.type = 0;
+            event.stackId = 0;
+            thread.events << event;
+        }
+        events.threads = {thread};
+
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        QVERIFY(ProfileExport::writePprof(&buffer, results, events));
+        const auto data = buffer.data();
+        // the first field is the sample type, a length delimited message
+        QCOMPARE(data.at(0), char(0x0a));
+        // one sample with the two locations of the stack and a single aggregated value
+        QVERIFY(data.contains(QByteArray("\x0a\x02\x01\x02\x12\x01\x03", 7)));
+        QVERIFY(data.contains("samples"));
+        QVERIFY(data.contains("foo"));
+        QVERIFY(data.contains("thread_name"));
+    }
+
+    void testArrowExport()
+    {
+        Data::EventResults events;
+        events.totalCosts = {{"samples", 3, 3, Data::Costs::Unit::Unknown}};
+        Data::ThreadEvents thread;
+        thread.pid = 1;
+        thread.tid = 2;
+        for (int i = 0; i < 3; ++i) {
+            Data::Event event;
+            event.time = 10 + i;
+            event.cost = 1;
+            event.type = 0;
+            event.stackId = 0;
+            event.cpuId = 4;
+            thread.events << event;
+        }
+        events.threads = {thread};
+
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        QVERIFY(ArrowExport::writeEvents(&buffer, events));
+        const auto data = buffer.data();
+        QVERIFY(data.contains("[\"samples\"]"));
+
+        // the schema message, with the columns in their documented order
+        QCOMPARE(readLittleEndian<qint32>(data, 0), -1);
+        const auto schemaSize = readLittleEndian<qint32>(data, 4);
+        QCOMPARE(schemaSize % 8, 0);
+        auto message = flatBufferOffset(data, 8);
+        QCOMPARE(readLittleEndian<quint8>(data, flatBufferField(data, message, 1)), quint8(1));
+        QCOMPARE(readLittleEndian<qint64>(data, flatBufferField(data, message, 3)), qint64(0));
+        const auto schema = flatBufferOffset(data, flatBufferField(data, message, 2));
+        const auto fields = flatBufferOffset(data, flatBufferField(data, schema, 1));
+        QCOMPARE(readLittleEndian<quint32>(data, fields), quint32(7));
+        const auto firstField = flatBufferOffset(data, fields + 4);
+        const auto name = flatBufferOffset(data, flatBufferField(data, firstField, 0));
+        QCOMPARE(data.mid(name + 4, readLittleEndian<quint32>(data, name)), QByteArray("time"));
+
+        // one record batch for the thread, its body starts with the time column
+        const auto batchStart = 8 + schemaSize;
+        QCOMPARE(readLittleEndian<qint32>(data, batchStart), -1);
+        const auto batchSize = readLittleEndian<qint32>(data, batchStart + 4);
+        QCOMPARE(batchSize % 8, 0);
+        message = flatBufferOffset(data, batchStart + 8);
+        QCOMPARE(readLittleEndian<quint8>(data, flatBufferField(data, message, 1)), quint8(3));
+        const auto bodyLength = readLittleEndian<qint64>(data, flatBufferField(data, message, 3));
+        // two 64-bit and five 32-bit columns, each one padded to 8 bytes
+        QCOMPARE(bodyLength, qint64(2 * 24 + 5 * 16));
+        const auto recordBatch = flatBufferOffset(data, flatBufferField(data, message, 2));
+        QCOMPARE(readLittleEndian<qint64>(data, flatBufferField(data, recordBatch, 0)), qint64(3));
+        const auto body = batchStart + 8 + batchSize;
+        const auto& times = events.threads.first().events.times();
+        QCOMPARE(data.mid(body, 24), QByteArray(reinterpret_cast<const char*>(times.constData()), 24));
+
+        // followed by the end of stream marker
+        const auto end = body + static_cast<int>(bodyLength);
+        QCOMPARE(data.size(), end + 8);
+        QCOMPARE(readLittleEndian<qint32>(data, end), -1);
+        QCOMPARE(readLittleEndian<qint32>(data, end + 4), 0);
     }
 
     void testTopDownModel()
@@ -136,6 +782,69 @@ private slots:
         ModelTest tester(&model);
 
         model.setData(tree);
+        verifyCellCosts(model);
+    }
+
+    void testTopDownIngestion()
+    {
+        const QByteArray firstHalf = R"(
+            A;B;C
+            A;B;D
+            A;B;D
+            A;B;C;E
+        )";
+        const QByteArray secondHalf = R"(
+            A;B;C;E;C
+            A;B;C;E;C;E
+            A;B;C;C
+            C
+            C
+        )";
+        const auto bottomUpTree = generateTree1();
+        const auto expectedTree = printTree(Data::TopDownResults::fromBottomUp(bottomUpTree));
+
+        Data::TopDownResults full;
+        addTopDownEvents(firstHalf + secondHalf, &full);
+        full.selfCosts.initializeCostsFrom(bottomUpTree.costs);
+        full.inclusiveCosts.initializeCostsFrom(bottomUpTree.costs);
+        QCOMPARE(printTree(full), expectedTree);
+
+        Data::TopDownResults merged;
+        addTopDownEvents(firstHalf, &merged);
+        Data::TopDownResults second;
+        addTopDownEvents(secondHalf, &second);
+        merged.merge(second);
+        merged.selfCosts.initializeCostsFrom(bottomUpTree.costs);
+        merged.inclusiveCosts.initializeCostsFrom(bottomUpTree.costs);
+        QCOMPARE(printTree(merged), expectedTree);
+    }
+
+    void testParallelTopDown()
+    {
+        // enough distinct leaves to build the top-down tree in multiple fragments
+        QByteArray stacks;
+        for (int i = 0; i < 4096; ++i) {
+            stacks += "main;work" + QByteArray::number(i % 7) + ";op" + QByteArray::number(i) + '\n';
+            if (i % 3 == 0) {
+                stacks += "main;work" + QByteArray::number(i % 5) + '\n';
+            }
+        }
+
+        Data::BottomUpResults bottomUp;
+        addStackEvents(stacks, &bottomUp);
+        Data::BottomUp::initializeParents(&bottomUp.root);
+
+        Data::TopDownResults expected;
+        addTopDownEvents(stacks, &expected);
+        expected.selfCosts.initializeCostsFrom(bottomUp.costs);
+        expected.inclusiveCosts.initializeCostsFrom(bottomUp.costs);
+
+        auto expectedTree = printTree(expected);
+        auto actualTree = printTree(Data::TopDownResults::fromBottomUp(bottomUp));
+        // the order of the children depends on the order of the leaves in the bottom-up tree
+        expectedTree.sort();
+        actualTree.sort();
+        QCOMPARE(actualTree, expectedTree);
     }
 
     void testTopProxy()
@@ -178,33 +887,431 @@ private slots:
         model.setResults(results);
         QTextStream(stdout) << "\nActual Model:\n" << printCallerCalleeModel(model).join("\n") << "\n";
         QCOMPARE(printCallerCalleeModel(model), expectedMap);
+        verifyCellCosts(model);
 
         for (const auto& entry : results.entries) {
             {
                 CallerModel model;
                 ModelTest tester(&model);
-                model.setResults(entry.callers, results.selfCosts);
+                model.setResults(results.callers(entry.id), results.selfCosts);
+                verifyCellCosts(model);
             }
             {
                 CalleeModel model;
                 ModelTest tester(&model);
-                model.setResults(entry.callees, results.selfCosts);
+                model.setResults(results.callees(entry.id), results.selfCosts);
+                verifyCellCosts(model);
             }
             {
                 SourceMapModel model;
                 ModelTest tester(&model);
-                model.setResults(entry.sourceMap, results.selfCosts);
+                model.setResults(results.sourceMap(entry.id), results.selfCosts);
+                verifyCellCosts(model);
             }
         }
     }
 
+    void testCallerCalleeModelSort()
+    {
+        const auto tree = generateTree1();
+
+        Data::CallerCalleeResults results;
+        Data::callerCalleesFromBottomUpData(tree, &results);
+
+        CallerCalleeModel model;
+        ModelTest tester(&model);
+        model.sort(CallerCalleeModel::InitialSortColumn, Qt::DescendingOrder);
+        model.setResults(results);
+        QCOMPARE(model.rowCount(), results.entries.size());
+
+        for (int column = 0; column < model.columnCount(); ++column) {
+            for (auto order : {Qt::AscendingOrder, Qt::DescendingOrder}) {
+                model.sort(column, order);
+                for (int row = 1; row < model.rowCount(); ++row) {
+                    const auto lhs = model.index(row - 1, column).data(CallerCalleeModel::SortRole);
+                    const auto rhs = model.index(row, column).data(CallerCalleeModel::SortRole);
+                    if (column >= CallerCalleeModel::NUM_BASE_COLUMNS) {
+                        QVERIFY(order == Qt::AscendingOrder ? lhs.toLongLong() <= rhs.toLongLong()
+                                                            : lhs.toLongLong() >= rhs.toLongLong());
+                    }
+                }
+                for (int row = 0; row < model.rowCount(); ++row) {
+                    const auto index = model.index(row, 0);
+                    const auto symbol = index.data(CallerCalleeModel::SymbolRole).value<Data::Symbol>();
+                    QCOMPARE(model.indexForSymbol(symbol), index);
+                }
+            }
+        }
+    }
+
+    void testEvents()
+    {
+        Data::Events events;
+        for (quint64 time = 10; time <= 50; time += 10) {
+            Data::Event event;
+            event.time = time;
+            event.cost = time * 2;
+            event.type = time % 20 ? 0 : 1;
+            event.stackId = time / 10;
+            event.cpuId = 1;
+            events << event;
+        }
+        QCOMPARE(events.size(), 5);
+        QCOMPARE(events.at(2).time, quint64(30));
+        QCOMPARE(events.at(2).cost, quint64(60));
+        QCOMPARE(events.lastIndexOfType(1), 3);
+
+        QCOMPARE(events.lowerBound(events.begin(), events.end(), 0).index(), 0);
+        QCOMPARE(events.lowerBound(events.begin(), events.end(), 25).index(), 2);
+        QCOMPARE(events.lowerBound(events.begin(), events.end(), 30)->time, quint64(30));
+        QVERIFY(events.lowerBound(events.begin(), events.end(), 60) == events.end());
+
+        auto filtered = events;
+        filtered.removeIf([](const Data::Event& event) { return event.type == 1; });
+        QCOMPARE(filtered.size(), 3);
+        QVector<quint64> times;
+        for (const auto& event : filtered) {
+            times.push_back(event.time);
+        }
+        QCOMPARE(times, (QVector<quint64>{10, 30, 50}));
+        QCOMPARE(events.size(), 5);
+        QVERIFY(filtered != events);
+
+        // the events stay shared when nothing gets removed
+        auto unfiltered = events;
+        unfiltered.removeIf([](const Data::Event& event) { return event.type == 2; });
+        QCOMPARE(unfiltered.times().constData(), events.times().constData());
+        QVERIFY(unfiltered == events);
+
+        // the index based variant only looks at the columns it needs
+        auto byStack = events;
+        byStack.removeIfAt([&byStack](int i) { return byStack.stackId(i) % 2 == 0; });
+        QCOMPARE(byStack.size(), 3);
+        QCOMPARE(byStack.at(0), events.at(0));
+        QCOMPARE(byStack.at(1), events.at(2));
+        QCOMPARE(byStack.at(2), events.at(4));
+    }
+
+    void testSampleEvents()
+    {
+        Data::Events events;
+        for (int i = 0; i < 1000; ++i) {
+            Data::Event event;
+            event.time = i;
+            event.cost = 1 + i % 7;
+            event.type = 0;
+            event.stackId = i % 3;
+            events.push_back(event);
+            if (i % 200 == 0) {
+                event.type = 1;
+                event.cost = 1000;
+                events.push_back(event);
+            }
+        }
+        quint64 totalCosts[2] = {0, 0};
+        for (const auto& event : events) {
+            totalCosts[event.type] += event.cost;
+        }
+
+        Data::ApproximationStats stats;
+        const auto sample = Data::sampleEvents(events, 2, 10, 42, &stats);
+        QCOMPARE(sample.indices.size(), 101);
+        QCOMPARE(sample.costs.size(), sample.indices.size());
+        QVERIFY(std::is_sorted(sample.indices.begin(), sample.indices.end()));
+        QCOMPARE(stats.sampleRate, 10);
+        QCOMPARE(stats.sampledEvents, quint64(101));
+        QCOMPARE(stats.totalEvents, quint64(1005));
+        QVERIFY(stats.isApproximate());
+        QVERIFY(stats.errorBound(0) > 0);
+        QVERIFY(stats.errorBound(0) < totalCosts[0]);
+        QVERIFY(stats.errorBound(1) > 0);
+
+        // the scaled costs add up to the exact totals, up to rounding
+        qint64 sampledCosts[2] = {0, 0};
+        for (int i = 0; i < sample.indices.size(); ++i) {
+            sampledCosts[events.type(sample.indices[i])] += sample.costs[i];
+        }
+        QVERIFY(qAbs(sampledCosts[0] - qint64(totalCosts[0])) <= 100);
+        QCOMPARE(sampledCosts[1], qint64(totalCosts[1]));
+
+        // the same seed yields the same sample
+        Data::ApproximationStats otherStats;
+        const auto again = Data::sampleEvents(events, 2, 10, 42, &otherStats);
+        QCOMPARE(again.indices, sample.indices);
+        QCOMPARE(again.costs, sample.costs);
+
+        // the stats of independent samples add up
+        stats.merge(otherStats);
+        QCOMPARE(stats.totalEvents, quint64(2010));
+        QCOMPARE(stats.variances.at(0), 2 * otherStats.variances.at(0));
+
+        // without sampling, all events get aggregated exactly
+        Data::ApproximationStats exactStats;
+        const auto all = Data::sampleEvents(events, 2, 1, 42, &exactStats);
+        QCOMPARE(all.indices.size(), events.size());
+        for (int i = 0; i < all.indices.size(); ++i) {
+            QCOMPARE(all.indices[i], i);
+            QCOMPARE(all.costs[i], events.cost(i));
+        }
+        QVERIFY(!exactStats.isApproximate());
+        QCOMPARE(exactStats.errorBound(0), 0.);
+    }
+
+    void testSymbolStrings()
+    {
+        // separately allocated strings, as they e.g. get read from the results cache
+        const Data::Symbol foo(QStringLiteral("foo"), QString::fromLatin1("libstrings.so"),
+                               QString::fromLatin1("/usr/lib/libstrings.so"));
+        const Data::Symbol bar(QStringLiteral("bar"), QString::fromLatin1("libstrings.so"),
+                               QString::fromLatin1("/usr/lib/libstrings.so"));
+        const Data::Symbol fooAgain(QString::fromLatin1("foo"), QString::fromLatin1("libstrings.so"),
+                                    QString::fromLatin1("/usr/lib/libstrings.so"));
+
+        QCOMPARE(foo, fooAgain);
+        QCOMPARE(foo.symbol.constData(), fooAgain.symbol.constData());
+        QCOMPARE(foo.binary.constData(), bar.binary.constData());
+        QCOMPARE(foo.path.constData(), bar.path.constData());
+        // the prettified name is only stored separately when it differs
+        QCOMPARE(foo.prettySymbol.constData(), foo.symbol.constData());
+
+        const Data::Symbol templated(QStringLiteral("std::vector<int, std::allocator<int> >"), foo.binary, foo.path);
+        QCOMPARE(templated.prettySymbol, QStringLiteral("std::vector<int>"));
+        QCOMPARE(templated.binary.constData(), foo.binary.constData());
+
+        // symbols that are still used keep their entry, the others get released and never share an id again
+        quint32 releasedId = 0;
+        {
+            const Data::Symbol released(QString::fromLatin1("released"), foo.binary, foo.path);
+            releasedId = released.id;
+        }
+        QVERIFY(Data::releaseUnusedSymbols() > 0);
+        const Data::Symbol fooAfterRelease(QString::fromLatin1("foo"), QString::fromLatin1("libstrings.so"),
+                                           QString::fromLatin1("/usr/lib/libstrings.so"));
+        QCOMPARE(fooAfterRelease, foo);
+        QCOMPARE(fooAfterRelease.binary.constData(), foo.binary.constData());
+        const Data::Symbol releasedAgain(QString::fromLatin1("released"), foo.binary, foo.path);
+        QVERIFY(releasedAgain.id != releasedId);
+    }
+
+    void testSerialization()
+    {
+        Data::EventResults events;
+        events.stacks = {{0, 1}, {2}};
+        events.totalCosts = {{"cycles", 2, 300, Data::Costs::Unit::Unknown}};
+        events.offCpuTimeCostId = 1;
+        Data::ThreadEvents thread;
+        thread.pid = 1;
+        thread.tid = 2;
+        thread.time = {10, 100};
+        thread.name = QStringLiteral("foo");
+        thread.offCpuTime = 5;
+        thread.state = Data::ThreadEvents::OffCpu;
+        for (quint64 time = 10; time <= 30; time += 10) {
+            Data::Event event;
+            event.time = time;
+            event.cost = time * 10;
+            event.stackId = time % 20 ? 0 : 1;
+            event.cpuId = 3;
+            thread.events << event;
+        }
+        events.threads = {thread};
+        events.numCpus = 4;
+        events.cpuNumaNodes = {0, 0, 1, 1};
+        events.tracepoints = {generateTracepoint()};
+        events.contextSwitches.resize(4);
+        events.contextSwitches[3].add(10, 2, false);
+        events.contextSwitches[3].add(30, 2, true);
+
+        const Data::Symbol symbol(QStringLiteral("std::basic_string<char, std::char_traits<char>, std::allocator<char> >"),
+                                  QStringLiteral("libfoo.so"), QStringLiteral("/usr/lib/libfoo.so"));
+
+        QByteArray data;
+        {
+            QDataStream stream(&data, QIODevice::WriteOnly);
+            stream << events << symbol;
+        }
+
+        Data::EventResults readEvents;
+        Data::Symbol readSymbol;
+        QDataStream stream(data);
+        stream >> readEvents >> readSymbol;
+        QCOMPARE(stream.status(), QDataStream::Ok);
+        QVERIFY(stream.atEnd());
+        QVERIFY(readEvents == events);
+        QCOMPARE(readSymbol, symbol);
+        QCOMPARE(readSymbol.prettySymbol, symbol.prettySymbol);
+
+        // truncated data must be detected
+        QDataStream truncated(data.left(data.size() / 2));
+        Data::EventResults truncatedEvents;
+        truncated >> truncatedEvents;
+        QVERIFY(truncated.status() != QDataStream::Ok);
+    }
+
+    void testFilterSnapshotSerialization()
+    {
+        const auto bottomUp = generateTree1();
+        const auto topDown = Data::TopDownResults::fromBottomUp(bottomUp);
+        Data::CallerCalleeResults callerCallee;
+        Data::callerCalleesFromBottomUpData(bottomUp, &callerCallee);
+        Data::ApproximationStats approximation;
+        approximation.sampleRate = 10;
+        approximation.sampledEvents = 3;
+        approximation.totalEvents = 30;
+        approximation.variances = {1.5};
+
+        FilterAndZoomStack::State state;
+        Data::FilterAction filter;
+        filter.time = {10, 20};
+        filter.threadId = 2;
+        filter.excludeCpuIds = {1};
+        filter.includeSymbols.insert(callerCallee.symbols.first());
+        state.filters = {filter};
+        Data::ZoomAction zoom;
+        zoom.time = {10, 20};
+        state.zooms = {zoom};
+        state.highlightedSymbol = callerCallee.symbols.last();
+        state.collapseRecursion = true;
+        state.sampleRate = 10;
+
+        QByteArray data;
+        {
+            QDataStream stream(&data, QIODevice::WriteOnly);
+            stream << bottomUp << topDown << callerCallee << approximation << state;
+        }
+
+        Data::BottomUpResults readBottomUp;
+        Data::TopDownResults readTopDown;
+        Data::CallerCalleeResults readCallerCallee;
+        Data::ApproximationStats readApproximation;
+        FilterAndZoomStack::State readState;
+        QDataStream stream(data);
+        stream >> readBottomUp >> readTopDown >> readCallerCallee >> readApproximation >> readState;
+        QCOMPARE(stream.status(), QDataStream::Ok);
+        QVERIFY(stream.atEnd());
+
+        // the symbols and locations are shared with the unfiltered results, they don't get written
+        QVERIFY(readBottomUp.symbols.isEmpty());
+        readBottomUp.symbols = bottomUp.symbols;
+        readBottomUp.locations = bottomUp.locations;
+        QCOMPARE(printTree(readBottomUp), printTree(bottomUp));
+        QCOMPARE(printTree(readTopDown), printTree(topDown));
+        QCOMPARE(printMap(readCallerCallee), printMap(callerCallee));
+        QCOMPARE(readCallerCallee.entries.size(), callerCallee.entries.size());
+        const auto& topLevel = readBottomUp.root.children.first();
+        QVERIFY(topLevel.children.first().parent == &topLevel);
+        QCOMPARE(readApproximation.sampledEvents, approximation.sampledEvents);
+        QCOMPARE(readApproximation.totalEvents, approximation.totalEvents);
+        QCOMPARE(readApproximation.variances, approximation.variances);
+
+        QVERIFY(readState.filters == state.filters);
+        QVERIFY(readState.zooms == state.zooms);
+        QCOMPARE(readState.highlightedSymbol, state.highlightedSymbol);
+        QVERIFY(readState.collapseRecursion);
+        QVERIFY(!readState.collapseInlinedFrames);
+        QCOMPARE(readState.sampleRate, 10);
+
+        // every level of the stack gets filtered with the current modes
+        const auto appliedFilters = readState.appliedFilters();
+        QCOMPARE(appliedFilters.size(), 2);
+        QVERIFY(!appliedFilters[0].isValid());
+        QVERIFY(appliedFilters[0].collapseRecursion);
+        QCOMPARE(appliedFilters[1].threadId, 2);
+        QCOMPARE(appliedFilters[1].sampleRate, 10);
+
+        // truncated data must be detected
+        QDataStream truncated(data.left(data.size() / 4));
+        Data::BottomUpResults truncatedBottomUp;
+        Data::TopDownResults truncatedTopDown;
+        truncated >> truncatedBottomUp >> truncatedTopDown;
+        QVERIFY(truncated.status() != QDataStream::Ok);
+    }
+
+    void testTracepointGroups()
+    {
+        const auto tracepoint = generateTracepoint();
+        const auto device = tracepoint.fieldIndex(QStringLiteral("dev"));
+        const auto sectors = tracepoint.fieldIndex(QStringLiteral("nr_sector"));
+        QCOMPARE(device, 0);
+        QCOMPARE(sectors, 1);
+        QCOMPARE(tracepoint.fieldIndex(QStringLiteral("foo")), -1);
+        QCOMPARE(tracepoint.formatValue(device, 2), QStringLiteral("sdb"));
+        QCOMPARE(tracepoint.formatValue(sectors, 2), QStringLiteral("16"));
+
+        auto groups = tracepoint.groupBy(device, sectors);
+        QCOMPARE(groups.size(), 2);
+        QCOMPARE(groups[0].count, quint64(2));
+        QCOMPARE(groups[0].sum, qint64(12));
+        QCOMPARE(groups[1].count, quint64(1));
+        QCOMPARE(groups[1].sum, qint64(16));
+
+        groups = tracepoint.groupBy(device, -1, {15, 40});
+        QCOMPARE(groups.size(), 2);
+        QCOMPARE(groups[0].count, quint64(1));
+        QCOMPARE(groups[0].sum, qint64(0));
+    }
+
+    void testFilterRefinement()
+    {
+        Data::FilterAction timeFilter;
+        timeFilter.time = {100, 200};
+        QVERIFY(timeFilter.isRefinementOf({}));
+        QVERIFY(timeFilter.isRefinementOf(timeFilter));
+
+        auto narrowerTime = timeFilter;
+        narrowerTime.time = {120, 180};
+        QVERIFY(narrowerTime.isRefinementOf(timeFilter));
+        QVERIFY(!timeFilter.isRefinementOf(narrowerTime));
+
+        auto excludeThread = timeFilter;
+        excludeThread.excludeThreadIds.push_back(42);
+        QVERIFY(excludeThread.isRefinementOf(timeFilter));
+        QVERIFY(!timeFilter.isRefinementOf(excludeThread));
+
+        auto includeSymbol = excludeThread;
+        includeSymbol.includeSymbols.insert({"foo", "libfoo"});
+        QVERIFY(includeSymbol.isRefinementOf(excludeThread));
+        QVERIFY(includeSymbol.isRefinementOf(timeFilter));
+
+        Data::FilterAction processFilter;
+        processFilter.processId = 1;
+        auto otherProcess = processFilter;
+        otherProcess.processId = 2;
+        QVERIFY(!otherProcess.isRefinementOf(processFilter));
+        QVERIFY(!timeFilter.isRefinementOf(processFilter));
+
+        Data::FilterAction fileFilter;
+        fileFilter.fileId = 1;
+        QVERIFY(fileFilter.isValid());
+        QVERIFY(fileFilter.isRefinementOf({}));
+        auto otherFile = fileFilter;
+        otherFile.fileId = 0;
+        QVERIFY(!otherFile.isRefinementOf(fileFilter));
+        auto excludeFile = fileFilter;
+        excludeFile.excludeFileIds.push_back(2);
+        QVERIFY(excludeFile.isRefinementOf(fileFilter));
+        QVERIFY(!fileFilter.isRefinementOf(excludeFile));
+
+        // collapsing the inlined frames only changes how the events get aggregated, not which ones pass
+        auto collapsed = timeFilter;
+        collapsed.collapseInlinedFrames = true;
+        QVERIFY(collapsed.isRefinementOf(timeFilter));
+        QVERIFY(timeFilter.isRefinementOf(collapsed));
+        QVERIFY(collapsed != timeFilter);
+        QVERIFY(collapsed.normalized() == collapsed);
+        Data::FilterAction collapseOnly;
+        collapseOnly.collapseInlinedFrames = true;
+        QVERIFY(!collapseOnly.isValid());
+    }
+
     void testEventModel()
     {
         Data::EventResults events;
-        events.cpus.resize(3);
-        events.cpus[0].cpuId = 0;
-        events.cpus[1].cpuId = 1; // empty
-        events.cpus[2].cpuId = 2;
+        events.numCpus = 3; // the second CPU stays empty
+        QVector<Data::CpuEvents> cpus(3);
+        for (quint32 cpuId = 0; cpuId < 3; ++cpuId) {
+            cpus[cpuId].cpuId = cpuId;
+        }
         const int nonEmptyCpus = 2;
         const int processes = 2;
 
@@ -241,7 +1348,7 @@ private slots:
         }
 
         Data::CostSummary costSummary("cycles", 0, 0, Data::Costs::Unit::Unknown);
-        auto generateEvent = [&costSummary, &events](quint64 time, quint32 cpuId) -> Data::Event {
+        auto generateEvent = [&costSummary, &cpus](quint64 time, quint32 cpuId) -> Data::Event {
             Data::Event event;
             event.cost = 10;
             event.cpuId = cpuId;
@@ -249,7 +1356,7 @@ private slots:
             event.time = time;
             ++costSummary.sampleCount;
             costSummary.totalPeriod += event.cost;
-            events.cpus[cpuId].events << event;
+            cpus[cpuId].events << event;
             return event;
         };
         for (quint64 time = 0; time < endTime; time += deltaTime) {
@@ -267,12 +1374,13 @@ private slots:
         QCOMPARE(model.columnCount(), static_cast<int>(EventModel::NUM_COLUMNS));
         QCOMPARE(model.rowCount(), 2);
 
-        auto simplifiedEvents = events;
-        simplifiedEvents.cpus.remove(1);
+        // the CPU timelines get derived from the thread events, skipping the empty CPU
+        cpus.remove(1);
+        QCOMPARE(events.cpuEvents(), cpus);
 
         auto verifyCommonData = [&](const QModelIndex& idx) {
             const auto eventResults = idx.data(EventModel::EventResultsRole).value<Data::EventResults>();
-            QCOMPARE(eventResults, simplifiedEvents);
+            QCOMPARE(eventResults, events);
             const auto maxTime = idx.data(EventModel::MaxTimeRole).value<quint64>();
             QCOMPARE(maxTime, endTime);
             const auto minTime = idx.data(EventModel::MinTimeRole).value<quint64>();
@@ -320,7 +1428,7 @@ private slots:
                 const auto cpuId = idx.data(EventModel::CpuIdRole).value<quint32>();
 
                 if (isCpuIndex) {
-                    const auto& cpu = simplifiedEvents.cpus[j];
+                    const auto& cpu = cpus[j];
                     QCOMPARE(rowEvents, cpu.events);
                     QCOMPARE(threadStart, quint64(0));
                     QCOMPARE(threadEnd, endTime);
@@ -343,8 +1451,777 @@ private slots:
 
                 auto idx2 = model.index(j, EventModel::EventsColumn, parent);
                 QCOMPARE(idx2.data(EventModel::SortRole).value<int>(), rowEvents.size());
+
+                const auto pages = idx.data(EventModel::EventPagesRole).value<EventModel::EventPages>();
+                QCOMPARE(pages.events, rowEvents);
+                QCOMPARE(pages.lowerBound(0), 0);
+                QCOMPARE(pages.lowerBound(endTime + 1), rowEvents.size());
+            }
+        }
+    }
+
+    void testCpuEvents()
+    {
+        Data::EventResults events;
+        events.numCpus = 4;
+        events.cpuNumaNodes = {1, 1, 0, 0};
+        events.offCpuTimeCostId = 1;
+        events.threads.resize(2);
+        auto addEvent = [&events](int thread, quint64 time, quint32 cpuId, qint32 type) {
+            Data::Event event;
+            event.time = time;
+            event.cost = 10;
+            event.type = type;
+            event.cpuId = cpuId;
+            events.threads[thread].events << event;
+        };
+        addEvent(0, 10, 0, 0);
+        addEvent(0, 30, 0, 0);
+        addEvent(0, 40, 3, 0);
+        addEvent(1, 20, 0, 0);
+        addEvent(1, 50, 3, 1); // off-CPU time
+        addEvent(1, 90, 3, 0);
+
+        // the events of both threads get interleaved by time
+        const auto cpus = events.cpuEvents();
+        QCOMPARE(cpus.size(), 2);
+        QCOMPARE(cpus[0].cpuId, 0u);
+        QVector<quint64> times;
+        for (const auto& event : cpus[0].events) {
+            times.push_back(event.time);
+        }
+        QCOMPARE(times, (QVector<quint64>{10, 20, 30}));
+        QCOMPARE(cpus[1].cpuId, 3u);
+        QCOMPARE(cpus[1].events.size(), 2);
+
+        // the rows are grouped by NUMA node
+        const auto utilization = events.cpuUtilization(0, {0, 99}, 2);
+        QCOMPARE(utilization.bucketDuration, quint64(50));
+        QCOMPARE(utilization.cpuIds, (QVector<quint32>{3, 0}));
+        QCOMPARE(utilization.numaNodes, (QVector<qint32>{0, 1}));
+        QCOMPARE(utilization.cost(0, 0), quint64(10));
+        QCOMPARE(utilization.cost(0, 1), quint64(10));
+        QCOMPARE(utilization.cost(1, 0), quint64(30));
+        QCOMPARE(utilization.cost(1, 1), quint64(0));
+        QCOMPARE(utilization.maxCost, quint64(30));
+    }
+
+    void testMemoryUsage()
+    {
+        const auto bottomUp = generateTree1();
+        const auto topDown = Data::TopDownResults::fromBottomUp(bottomUp);
+        Data::CallerCalleeResults callerCallee;
+        Data::callerCalleesFromBottomUpData(bottomUp, &callerCallee);
+        Data::EventResults events;
+        events.threads.resize(1);
+
+        const auto usage = Data::memoryUsage(bottomUp, topDown, callerCallee, events);
+        QVERIFY(usage.strings > 0);
+        QVERIFY(usage.symbols > 0);
+        QVERIFY(usage.bottomUp > 0);
+        QVERIFY(usage.topDown > 0);
+        QVERIFY(usage.callerCallee > 0);
+        QCOMPARE(usage.total(),
+                 usage.strings + usage.symbols + usage.locations + usage.stacks + usage.events + usage.bottomUp
+                     + usage.topDown + usage.callerCallee);
+
+        // every event adds the same amount of memory
+        events.threads[0].events.resize(100);
+        const auto withEvents = Data::memoryUsage(bottomUp, topDown, callerCallee, events);
+        QCOMPARE(withEvents.events - usage.events, 100 * Data::EVENT_SIZE);
+        QCOMPARE(withEvents.bottomUp, usage.bottomUp);
+    }
+
+    void testEventModelReusedTid()
+    {
+        Data::EventResults events;
+        events.threads.resize(2);
+        for (int i = 0; i < 2; ++i) {
+            auto& thread = events.threads[i];
+            thread.pid = 1234;
+            thread.tid = 1235;
+            thread.time = {i * 100ull, i * 100ull + 50};
+            thread.name = QStringLiteral("thread%1").arg(i);
+        }
+
+        EventModel model;
+        ModelTest tester(&model);
+        model.setData(events);
+
+        const auto processesIndex = model.index(1, 0);
+        QCOMPARE(model.rowCount(processesIndex), 1);
+        const auto processIndex = model.index(0, 0, processesIndex);
+        QCOMPARE(model.rowCount(processIndex), 2);
+        for (int i = 0; i < 2; ++i) {
+            const auto threadIndex = model.index(i, 0, processIndex);
+            QCOMPARE(threadIndex.data(EventModel::ThreadStartRole).value<quint64>(), i * 100ull);
+            QCOMPARE(threadIndex.data(EventModel::ThreadNameRole).toString(), QStringLiteral("thread%1").arg(i));
+        }
+    }
+
+    void testEventModelSessions()
+    {
+        Data::EventResults events;
+        events.files = {QStringLiteral("/tmp/a.data"), QStringLiteral("/tmp/b.data")};
+        events.threads.resize(3);
+        for (int i = 0; i < 3; ++i) {
+            auto& thread = events.threads[i];
+            // the same pid got recorded in both files
+            thread.pid = i == 2 ? 2000 : 1000;
+            thread.tid = thread.pid + i;
+            thread.fileId = i == 0 ? 0 : 1;
+            thread.time = {i * 100ull, i * 100ull + 50};
+        }
+
+        EventModel model;
+        ModelTest tester(&model);
+        model.setData(events);
+
+        const auto sessionsIndex = model.index(1, 0);
+        QCOMPARE(model.rowCount(sessionsIndex), 2);
+        const QVector<int> numProcesses = {1, 2};
+        for (int i = 0; i < 2; ++i) {
+            const auto sessionIndex = model.index(i, 0, sessionsIndex);
+            QCOMPARE(sessionIndex.data(EventModel::FileIdRole).value<qint32>(), i);
+            QCOMPARE(sessionIndex.data(EventModel::FileNameRole).toString(), QFileInfo(events.files[i]).fileName());
+            QCOMPARE(model.rowCount(sessionIndex), numProcesses[i]);
+            for (int j = 0; j < numProcesses[i]; ++j) {
+                const auto processIndex = model.index(j, 0, sessionIndex);
+                QCOMPARE(processIndex.parent(), sessionIndex);
+                QCOMPARE(model.rowCount(processIndex), 1);
+                const auto threadIndex = model.index(0, 0, processIndex);
+                QCOMPARE(threadIndex.parent(), processIndex);
+                QCOMPARE(threadIndex.data(EventModel::FileIdRole).value<qint32>(), i);
+            }
+        }
+    }
+
+    void testEventsTransform()
+    {
+        Data::Events events;
+        for (int i = 0; i < 3; ++i) {
+            Data::Event event;
+            event.time = i * 10ull;
+            event.cost = 1;
+            event.type = 0;
+            event.stackId = i;
+            events.push_back(event);
+        }
+        events.transform([](Data::Event* event) {
+            event->time += 5;
+            event->stackId *= 2;
+        });
+        QCOMPARE(events.size(), 3);
+        for (int i = 0; i < 3; ++i) {
+            QCOMPARE(events.time(i), i * 10ull + 5);
+            QCOMPARE(events.stackId(i), i * 2);
+            QCOMPARE(events.cost(i), 1ull);
+        }
+
+        // columns that don't change stay shared with the copy
+        auto copy = events;
+        copy.transform([](Data::Event* event) { event->stackId += 1; });
+        QCOMPARE(copy.times().constData(), events.times().constData());
+        QCOMPARE(copy.stackId(0), 1);
+        QCOMPARE(events.stackId(0), 0);
+    }
+
+    void testThreadIntervalIndex()
+    {
+        QVERIFY(Data::ThreadIntervalIndex().overlapping({0, 100}).isEmpty());
+
+        // overlapping threads of different lengths, including ones that end before others start
+        QVector<Data::ThreadEvents> threads(100);
+        for (int i = 0; i < threads.size(); ++i) {
+            const quint64 start = (i * 37) % 1000;
+            threads[i].time = {start, start + (i % 7) * (i % 3 ? 10 : 200)};
+        }
+        const Data::ThreadIntervalIndex index(threads);
+        QCOMPARE(index.size(), threads.size());
+
+        const QVector<Data::TimeRange> ranges = {{0, 0},     {0, 2000},   {500, 500}, {100, 150},
+                                                 {990, 995}, {1500, 1600}, {37, 37}};
+        for (const auto& range : ranges) {
+            QVector<int> expected;
+            for (int i = 0; i < threads.size(); ++i) {
+                if (threads[i].time.start <= range.end && threads[i].time.end >= range.start) {
+                    expected.append(i);
+                }
             }
+            QCOMPARE(index.overlapping(range), expected);
+        }
+    }
+
+    void testSymbolStackIndex()
+    {
+        QVERIFY(Data::SymbolStackIndex().isEmpty());
+
+        Data::BottomUpResults bottomUp;
+        for (const auto* name : {"A", "B", "C", "D"}) {
+            bottomUp.symbols.push_back(Data::Symbol {QString::fromLatin1(name), {}});
+            bottomUp.locations.push_back({-1, {}});
+        }
+        // D got inlined into A
+        bottomUp.locations[3].parentLocationId = 0;
+
+        const QVector<QVector<qint32>> stacks = {{2, 1, 0}, {3}, {2, 2, 0}, {1}, {}};
+        const Data::SymbolStackIndex index(stacks, bottomUp);
+        QCOMPARE(index.numStacks(), stacks.size());
+        QCOMPARE(index.stacks(bottomUp.symbols[0]), (QVector<qint32> {0, 1, 2}));
+        QCOMPARE(index.stacks(bottomUp.symbols[1]), (QVector<qint32> {0, 3}));
+        // the recursion in the third stack only lists it once
+        QCOMPARE(index.stacks(bottomUp.symbols[2]), (QVector<qint32> {0, 2}));
+        QCOMPARE(index.stacks(bottomUp.symbols[3]), (QVector<qint32> {1}));
+        QVERIFY(index.stacks(Data::Symbol {QStringLiteral("E"), {}}).isEmpty());
+        QVERIFY(index.stacks({}).isEmpty());
+
+        const auto mask = index.stackMask(bottomUp.symbols[2]);
+        QCOMPARE(mask.size(), stacks.size());
+        QCOMPARE(mask.count(true), 2);
+        QVERIFY(mask.testBit(0));
+        QVERIFY(mask.testBit(2));
+        QVERIFY(index.stackMask(Data::Symbol {QStringLiteral("E"), {}}).isEmpty());
+    }
+
+    void testCollapseInlinedFrames()
+    {
+        Data::BottomUpResults bottomUp;
+        for (const auto* name : {"main", "foo", "bar", "baz"}) {
+            bottomUp.symbols.push_back(Data::Symbol {QString::fromLatin1(name), {}});
+            bottomUp.locations.push_back({-1, {}});
+        }
+        // baz got inlined into bar, which got inlined into foo
+        bottomUp.locations[3].parentLocationId = 2;
+        bottomUp.locations[2].parentLocationId = 1;
+
+        QCOMPARE(bottomUp.outermostLocation(0), 0);
+        QCOMPARE(bottomUp.outermostLocation(3), 1);
+        QCOMPARE(bottomUp.outermostLocation(2), 1);
+        QCOMPARE(bottomUp.outermostLocation(-1), -1);
+        QCOMPARE(bottomUp.outermostLocation(4), -1);
+
+        const QVector<qint32> stack = {3, 0};
+        QCOMPARE(bottomUp.collapseInlinedFrames(stack), (QVector<qint32> {1, 0}));
+        QCOMPARE(bottomUp.collapseInlinedFrames({2, 1, 0}), (QVector<qint32> {1, 1, 0}));
+
+        auto frames = [&bottomUp](const QVector<qint32>& stack) {
+            QStringList ret;
+            bottomUp.foreachFrame(stack, [&ret](const Data::Symbol& symbol, const Data::Location&) {
+                ret.append(symbol.symbol);
+                return true;
+            });
+            return ret;
+        };
+        QCOMPARE(frames(stack), (QStringList {"baz", "bar", "foo", "main"}));
+        QCOMPARE(frames(bottomUp.collapseInlinedFrames(stack)), (QStringList {"foo", "main"}));
+    }
+
+    void testCollapseRecursion()
+    {
+        Data::BottomUpResults bottomUp;
+        for (const auto* name : {"main", "fib", "fib", "fib", "helper", "fib"}) {
+            bottomUp.symbols.push_back(Data::Symbol {QString::fromLatin1(name), {}});
+            bottomUp.locations.push_back({-1, {}});
+        }
+        // helper got inlined into the last call of fib
+        bottomUp.locations[4].parentLocationId = 5;
+
+        auto frames = [&bottomUp](const QVector<qint32>& stack) {
+            QStringList ret;
+            bottomUp.foreachFrame(stack, [&ret](const Data::Symbol& symbol, const Data::Location&) {
+                ret.append(symbol.symbol);
+                return true;
+            });
+            return ret;
+        };
+
+        // the innermost call of the recursion is kept
+        QCOMPARE(bottomUp.collapseRecursion({3, 2, 1, 0}), (QVector<qint32> {3, 0}));
+        QCOMPARE(frames(bottomUp.collapseRecursion({3, 2, 1, 0})), (QStringList {"fib", "main"}));
+        // indirect recursions are kept
+        QCOMPARE(bottomUp.collapseRecursion({1, 0, 2, 0}), (QVector<qint32> {1, 0, 2, 0}));
+        // the inlined frame of helper breaks the recursion, the calls of fib above it get collapsed again
+        QCOMPARE(bottomUp.collapseRecursion({3, 4, 2, 1}), (QVector<qint32> {3, 4}));
+        QCOMPARE(frames(bottomUp.collapseRecursion({3, 4, 2, 1})), (QStringList {"fib", "helper", "fib"}));
+        QVERIFY(bottomUp.collapseRecursion({}).isEmpty());
+    }
+
+    void testAddressCosts()
+    {
+        const Data::Symbol main {QStringLiteral("main"), QStringLiteral("a.out")};
+        const Data::Symbol foo {QStringLiteral("foo"), QStringLiteral("a.out")};
+        const Data::Symbol bar {QStringLiteral("bar"), QStringLiteral("a.out")};
+        const quint64 loadOffset = 0x555555554000;
+
+        Data::BottomUpResults bottomUp;
+        bottomUp.costs.addType(0, QStringLiteral("cycles"), Data::Costs::Unit::Unknown);
+        auto addLocation = [&bottomUp, loadOffset](const Data::Symbol& symbol, quint64 address,
+                                                   qint32 parentLocationId) {
+            bottomUp.symbols.push_back(symbol);
+            bottomUp.locations.push_back({parentLocationId, {loadOffset + address, {}}});
+        };
+        addLocation(main, 0x1139, -1);
+        addLocation(main, 0x1140, -1);
+        addLocation(foo, 0x1200, -1);
+        // bar got inlined into main
+        addLocation(bar, 0x1145, 4);
+        addLocation(main, 0x1145, -1);
+        // not part of the disassembly below
+        addLocation(main, 0x1300, -1);
+
+        Data::EventResults events;
+        events.stacks = {{0}, {2, 1}, {3}, {2, 1, 1}, {5}};
+        events.threads.resize(1);
+        auto& thread = events.threads[0];
+        auto addEvent = [&thread](quint64 cost, qint32 stackId) {
+            Data::Event event;
+            event.cost = cost;
+            event.type = 0;
+            event.stackId = stackId;
+            thread.events << event;
+        };
+        addEvent(10, 0);
+        addEvent(5, 1);
+        addEvent(2, 2);
+        addEvent(1, 3);
+        addEvent(3, 4);
+
+        const auto costs = Data::AddressCosts::fromEvents(main, events, bottomUp);
+        QCOMPARE(costs.addresses, (QVector<quint64> {loadOffset + 0x1139, loadOffset + 0x1140, loadOffset + 0x1145,
+                                                     loadOffset + 0x1300}));
+        QCOMPARE(costs.indexOf(loadOffset + 0x1145), 2);
+        QCOMPARE(costs.indexOf(loadOffset + 0x1200), -1);
+        QCOMPARE(costs.selfCosts.totalCost(0), qint64(21));
+        QCOMPARE(costs.inclusiveCosts.totalCost(0), qint64(21));
+        QCOMPARE(costs.selfCosts.cost(0, 0), qint64(10));
+        QCOMPARE(costs.selfCosts.cost(0, 1), qint64(0));
+        // the recursion in the fourth stack only gets counted once
+        QCOMPARE(costs.inclusiveCosts.cost(0, 1), qint64(6));
+        QCOMPARE(costs.selfCosts.cost(0, 2), qint64(2));
+
+        const auto fooCosts = Data::AddressCosts::fromEvents(foo, events, bottomUp);
+        QCOMPARE(fooCosts.addresses, (QVector<quint64> {loadOffset + 0x1200}));
+        QCOMPARE(fooCosts.selfCosts.cost(0, 0), qint64(6));
+        QCOMPARE(fooCosts.selfCosts.totalCost(0), qint64(6));
+        QVERIFY(Data::AddressCosts::fromEvents(bar, events, bottomUp).addresses.isEmpty());
+
+        const auto output = QByteArrayLiteral("\n/tmp/a.out:     file format elf64-x86-64\n\n\n"
+                                              "Disassembly of section .text:\n\n"
+                                              "0000000000001139 <main>:\n"
+                                              "main():\n"
+                                              "/tmp/main.c:2\n"
+                                              "    1139:\tpush   %rbp\n"
+                                              "    113a:\tmov    %rsp,%rbp\n"
+                                              "/tmp/main.c:3 (discriminator 1)\n"
+                                              "    1140:\tcall   1200 <foo>\n"
+                                              "    1145:\tmov    $0x0,%eax\n"
+                                              "    114a:\tret\n");
+        const auto lines = Data::DisassemblyResults::parseObjdumpOutput(output);
+        QCOMPARE(lines.size(), 5);
+        QCOMPARE(lines[0].address, quint64(0x1139));
+        QCOMPARE(lines[0].instruction, QStringLiteral("push   %rbp"));
+        QCOMPARE(lines[1].location, QStringLiteral("/tmp/main.c:2"));
+        QCOMPARE(lines[2].instruction, QStringLiteral("call   1200 <foo>"));
+        QCOMPARE(lines[4].location, QStringLiteral("/tmp/main.c:3"));
+
+        QCOMPARE(Data::DisassemblyResults::guessLoadOffset(lines, costs.addresses), loadOffset);
+        QCOMPARE(Data::DisassemblyResults::guessLoadOffset(lines, {0x1139, 0x1145}), quint64(0));
+        QCOMPARE(Data::DisassemblyResults::guessLoadOffset({}, costs.addresses), quint64(0));
+
+        const auto results = Data::DisassemblyResults::fromLines(main, lines, costs);
+        QCOMPARE(results.loadOffset, loadOffset);
+        QCOMPARE(results.numInstructions, 5);
+        // the sampled address without an instruction gets appended
+        QCOMPARE(results.lines.size(), 6);
+        QCOMPARE(results.lines[5].address, quint64(0x1300));
+        QVERIFY(results.lines[5].instruction.isEmpty());
+        QCOMPARE(results.selfCosts.cost(0, 0), qint64(10));
+        QCOMPARE(results.selfCosts.cost(0, 1), qint64(0));
+        QCOMPARE(results.inclusiveCosts.cost(0, 2), qint64(6));
+        QCOMPARE(results.selfCosts.cost(0, 3), qint64(2));
+        QCOMPARE(results.selfCosts.cost(0, 5), qint64(3));
+        QCOMPARE(results.selfCosts.totalCost(0), qint64(21));
+    }
+
+    void testJobScheduler()
+    {
+        auto* queue = ThreadWeaver::Queue::instance();
+        JobScheduler scheduler;
+        QAtomicInt runs;
+
+        // don't let the first job start before it gets superseded
+        queue->suspend();
+        const auto first = scheduler.schedule(JobScheduler::Priority::Background,
+                                              [&runs](const JobScheduler::Token&) { runs.fetchAndAddOrdered(1); });
+        QVERIFY(scheduler.isCurrent(first.generation()));
+        QVERIFY(!first.isCanceled());
+        const auto second =
+            scheduler.schedule(JobScheduler::Priority::Visible, [&runs](const JobScheduler::Token& token) {
+                runs.fetchAndAddOrdered(token.isCanceled() ? 100 : 10);
+            });
+        QVERIFY(first.isCanceled());
+        QVERIFY(!second.isCanceled());
+        QVERIFY(!scheduler.isCurrent(first.generation()));
+        QVERIFY(scheduler.isCurrent(second.generation()));
+        queue->resume();
+        queue->finish();
+        // the superseded job got dropped without running
+        QCOMPARE(runs.load(), 10);
+
+        const auto generation = scheduler.cancel();
+        QVERIFY(second.isCanceled());
+        QVERIFY(!scheduler.isCurrent(second.generation()));
+        QVERIFY(scheduler.isCurrent(generation));
+    }
+
+    void testTimeLineProxy()
+    {
+        Data::EventResults events;
+        events.threads.resize(3);
+        for (int i = 0; i < 3; ++i) {
+            auto& thread = events.threads[i];
+            thread.pid = 1234 + i / 2;
+            thread.tid = 1234 + i;
+            thread.time = {i * 100ull, i * 100ull + 50};
+            thread.name = QStringLiteral("thread%1").arg(i);
+        }
+
+        EventModel model;
+        model.setData(events);
+        TimeLineProxy proxy;
+        ModelTest tester(&proxy);
+        proxy.setSourceModel(&model);
+
+        auto numThreads = [&proxy]() {
+            int ret = 0;
+            const auto processesIndex = proxy.index(1, 0);
+            for (int i = 0, c = proxy.rowCount(processesIndex); i < c; ++i) {
+                ret += proxy.rowCount(proxy.index(i, 0, processesIndex));
+            }
+            return ret;
+        };
+        QCOMPARE(numThreads(), 3);
+
+        proxy.setVisibleTime({120, 130});
+        QCOMPARE(numThreads(), 3);
+        proxy.setOnlyActiveThreads(true);
+        QCOMPARE(numThreads(), 1);
+        // the second process got no active thread left
+        QCOMPARE(proxy.rowCount(proxy.index(1, 0)), 1);
+        QCOMPARE(proxy.index(0, 0, proxy.index(0, 0, proxy.index(1, 0))).data(EventModel::ThreadNameRole).toString(),
+                 QStringLiteral("thread1"));
+
+        proxy.setVisibleTime({40, 220});
+        QCOMPARE(numThreads(), 3);
+        proxy.setVisibleTime({40, 120});
+        QCOMPARE(numThreads(), 2);
+
+        // new data must not get filtered with the threads of the old data
+        events.threads.remove(0);
+        model.setData(events);
+        QCOMPARE(numThreads(), 1);
+
+        proxy.setVisibleTime({});
+        proxy.setOnlyActiveThreads(false);
+        QCOMPARE(numThreads(), 2);
+    }
+
+    void testLatencyHistogram()
+    {
+        // every value falls into a bucket that ends shortly after it
+        for (quint64 value = 0; value < (quint64(1) << 62); value = value * 3 + 1) {
+            const auto bucket = Data::LatencyHistogram::bucket(value);
+            QVERIFY(Data::LatencyHistogram::bucketEnd(bucket) >= value);
+            QVERIFY(Data::LatencyHistogram::bucketEnd(bucket) - value <= value / Data::LatencyHistogram::SubBuckets);
+            if (bucket > 0) {
+                QVERIFY(Data::LatencyHistogram::bucketEnd(bucket - 1) < value);
+            }
+        }
+        QCOMPARE(Data::LatencyHistogram::bucket(std::numeric_limits<quint64>::max()),
+                 Data::LatencyHistogram::bucket(std::numeric_limits<quint64>::max() - 1));
+
+        Data::LatencyHistogram histogram;
+        QCOMPARE(histogram.percentile(50), quint64(0));
+        Data::LatencyHistogram firstHalf;
+        Data::LatencyHistogram secondHalf;
+        for (quint64 value = 1; value <= 1000; ++value) {
+            histogram.add(value);
+            (value <= 500 ? firstHalf : secondHalf).add(value);
+        }
+        QCOMPARE(histogram.count(), quint64(1000));
+        QCOMPARE(histogram.total(), quint64(500500));
+        QCOMPARE(histogram.min(), quint64(1));
+        QCOMPARE(histogram.max(), quint64(1000));
+        QVERIFY(histogram.percentile(50) >= 500);
+        QVERIFY(histogram.percentile(50) <= 500 + 500 / Data::LatencyHistogram::SubBuckets);
+        QVERIFY(histogram.percentile(99.9) >= 999);
+        QCOMPARE(histogram.percentile(100), quint64(1000));
+        QCOMPARE(histogram.percentile(0), quint64(1));
+
+        firstHalf.merge(secondHalf);
+        QCOMPARE(firstHalf, histogram);
+    }
+
+    void testLatencyResults()
+    {
+        Data::BottomUpResults bottomUp;
+        addStackEvents("main;foo;wait\nmain;bar;wait", &bottomUp);
+        auto location = [&bottomUp](const char* symbol) {
+            return static_cast<qint32>(bottomUp.symbols.indexOf(Data::Symbol {symbol, {}}));
+        };
+
+        Data::EventResults events;
+        events.stacks = {{location("wait"), location("foo"), location("main")},
+                         {location("wait"), location("bar"), location("main")}};
+        events.offCpuTimeCostId = 1;
+        events.totalCosts = {Data::CostSummary("cycles", 0, 0, Data::Costs::Unit::Unknown),
+                             Data::CostSummary("off-CPU Time", 0, 0, Data::Costs::Unit::Time)};
+        events.threads.resize(1);
+        auto& thread = events.threads[0];
+        thread.pid = 1;
+        thread.tid = 1;
+        thread.time = {0, 1000};
+        thread.name = QStringLiteral("foobar");
+        auto addEvent = [&thread](quint64 time, quint64 cost, qint32 type, qint32 stackId) {
+            Data::Event event;
+            event.time = time;
+            event.cost = cost;
+            event.type = type;
+            event.stackId = stackId;
+            thread.events << event;
+        };
+        addEvent(10, 10, 1, 0);
+        addEvent(100, 1, 0, 0);
+        addEvent(200, 20, 1, 0);
+        addEvent(500, 30, 1, 0);
+        addEvent(600, 1000, 1, 1);
+
+        Data::TracepointEvents enter;
+        enter.system = QStringLiteral("syscalls");
+        enter.name = QStringLiteral("sys_enter_read");
+        enter.times = {100, 300};
+        enter.threadIds = {1, 1};
+        auto exit = enter;
+        exit.name = QStringLiteral("sys_exit_read");
+        exit.times = {150, 400};
+        events.tracepoints = {exit, enter};
+
+        const auto results = Data::LatencyResults::fromEvents(events, bottomUp);
+        QCOMPARE(results.sources.size(), 2);
+
+        const auto& offCpu = results.sources[0];
+        QCOMPARE(offCpu.name, QStringLiteral("off-CPU Time"));
+        QCOMPARE(offCpu.histogram.count(), quint64(4));
+        QCOMPARE(offCpu.histogram.max(), quint64(1000));
+        const auto& threads = offCpu.entries[Data::LatencySource::ByThread];
+        QCOMPARE(threads.size(), 1);
+        QCOMPARE(threads[0].name, QStringLiteral("foobar (#1)"));
+        QCOMPARE(threads[0].slowest.size(), 4);
+        QCOMPARE(threads[0].slowest[0].duration, quint64(1000));
+        QCOMPARE(threads[0].slowest[0].stackId, 1);
+        QCOMPARE(threads[0].slowest[3].duration, quint64(10));
+        QCOMPARE(offCpu.entries[Data::LatencySource::ByStack].size(), 2);
+        QHash<QString, quint64> symbolCounts;
+        for (const auto& entry : offCpu.entries[Data::LatencySource::BySymbol]) {
+            QVERIFY(entry.symbol.isValid());
+            symbolCounts[entry.name] = entry.histogram.count();
+        }
+        const QHash<QString, quint64> expectedCounts = {{"main", 4}, {"wait", 4}, {"foo", 3}, {"bar", 1}};
+        QCOMPARE(symbolCounts, expectedCounts);
+
+        const auto& syscalls = results.sources[1];
+        QCOMPARE(syscalls.name, QStringLiteral("syscalls:sys_enter_read - sys_exit_read"));
+        QCOMPARE(syscalls.histogram.count(), quint64(2));
+        QCOMPARE(syscalls.histogram.min(), quint64(50));
+        QCOMPARE(syscalls.histogram.max(), quint64(100));
+        // only the first enter has a sample with a stack
+        QCOMPARE(syscalls.entries[Data::LatencySource::ByStack].size(), 1);
+        QCOMPARE(syscalls.entries[Data::LatencySource::ByStack][0].slowest[0].duration, quint64(50));
+
+        LatencyModel model;
+        ModelTest tester(&model);
+        model.setEntries(threads);
+        QCOMPARE(model.rowCount(), 1);
+        QCOMPARE(model.index(0, LatencyModel::CountColumn).data().value<quint64>(), quint64(4));
+        QCOMPARE(model.index(0, LatencyModel::MaxColumn).data(LatencyModel::SortRole).value<quint64>(),
+                 quint64(1000));
+    }
+
+    void testContextSwitchTrack()
+    {
+        Data::ContextSwitchTrack track;
+        track.add(100, 1, false);
+        track.add(200, 1, true);
+        // the next thread gets switched in at the same time
+        track.add(200, 2, false);
+        // a late switch out of a thread that isn't running anymore
+        track.add(200, 1, true);
+        track.add(300, 2, true);
+        track.add(300, 1, false);
+        // older than the last switch
+        track.add(250, 3, false);
+        track.add(400, 1, false);
+        // switched out and right back in
+        track.add(500, 1, true);
+        track.add(500, 1, false);
+        QCOMPARE(track.times, (QVector<quint64>{100, 200, 300}));
+        QCOMPARE(track.threadIds, (QVector<qint32>{1, 2, 1}));
+
+        QCOMPARE(track.sliceAt(50), -1);
+        QCOMPARE(track.sliceAt(100), 0);
+        QCOMPARE(track.sliceAt(250), 1);
+        QCOMPARE(track.sliceAt(1000), 2);
+        QCOMPARE(track.sliceEnd(0), quint64(200));
+        QCOMPARE(track.sliceEnd(2), Data::MAX_TIME);
+
+        track.dropBefore(250);
+        QCOMPARE(track.times, (QVector<quint64>{200, 300}));
+        QCOMPARE(track.threadIds, (QVector<qint32>{2, 1}));
+        track.dropBefore(50);
+        QCOMPARE(track.size(), 2);
+
+        // the time between a wakeup and the next switch in of the woken thread on any CPU
+        Data::EventResults events;
+        for (qint32 tid : {1, 2}) {
+            Data::ThreadEvents thread;
+            thread.pid = 1;
+            thread.tid = tid;
+            thread.time = {0, 1000};
+            thread.name = QStringLiteral("thread%1").arg(tid);
+            events.threads << thread;
+        }
+        events.contextSwitches.resize(2);
+        events.contextSwitches[0].add(10, 1, false);
+        // tid 3 isn't part of the recorded threads
+        events.contextSwitches[0].add(90, 3, false);
+        events.contextSwitches[0].add(100, 1, false);
+        events.contextSwitches[1].add(20, 2, false);
+        events.contextSwitches[1].add(30, 2, true);
+        events.contextSwitches[1].add(60, 2, false);
+
+        Data::TracepointEvents wakeup;
+        wakeup.system = QStringLiteral("sched");
+        wakeup.name = QStringLiteral("sched_wakeup");
+        wakeup.times = {40, 45, 70, 80};
+        wakeup.threadIds = {1, 1, 2, 1};
+        Data::TracepointField woken;
+        woken.name = QStringLiteral("pid");
+        // the second wakeup of tid 2 happens while it waits in the run queue already
+        woken.values = {2, 2, 1, 3};
+        wakeup.fields = {woken};
+        events.tracepoints = {wakeup};
+
+        const auto results = Data::LatencyResults::fromEvents(events, {});
+        QCOMPARE(results.sources.size(), 1);
+        const auto& runQueue = results.sources[0];
+        QCOMPARE(runQueue.name, QStringLiteral("run-queue latency"));
+        QCOMPARE(runQueue.histogram.count(), quint64(2));
+        QCOMPARE(runQueue.histogram.min(), quint64(20));
+        QCOMPARE(runQueue.histogram.max(), quint64(30));
+        QCOMPARE(runQueue.entries[Data::LatencySource::ByThread].size(), 2);
+        QVERIFY(runQueue.entries[Data::LatencySource::ByStack].isEmpty());
+    }
+
+    void testEventPages()
+    {
+        Data::Events events;
+        const quint64 offCpuTime = 50;
+        for (quint64 time = 100; time < 40000; time += (time % 7) + 1) {
+            Data::Event event;
+            event.time = time;
+            event.cost = time % 3 ? 1 : offCpuTime;
+            event.type = time % 3 ? 0 : 1;
+            events << event;
+        }
+
+        const EventModel::EventPages pages(events, {0, 36000}, 1);
+        QVERIFY(pages.pageBegins.size() > 2);
+        QCOMPARE(pages.maxOffCpuTime, offCpuTime);
+
+        // the page lookup must match a binary search over all events, also outside of the paged time range
+        for (quint64 time = 0; time < 41000; time += 13) {
+            QCOMPARE(pages.lowerBound(time), events.lowerBound(events.begin(), events.end(), time).index());
+        }
+        QCOMPARE(EventModel::EventPages().lowerBound(100), 0);
+
+        // every level of the histograms covers all events within the paged time range
+        QCOMPARE(pages.histograms.size(), 2);
+        const auto numEventsInRange = pages.lowerBound(36001);
+        for (const auto& levels : pages.histograms) {
+            QVERIFY(levels.size() > 1);
+            QCOMPARE(levels.last().counts.size(), 1);
+            for (const auto& level : levels) {
+                const auto scale = static_cast<quint64>(levels.first().counts.size() / level.counts.size());
+                QCOMPARE(level.bucketDuration, levels.first().bucketDuration * scale);
+            }
+        }
+        QCOMPARE(static_cast<int>(pages.histograms[0].last().counts[0] + pages.histograms[1].last().counts[0]),
+                 numEventsInRange);
+        QVERIFY(!pages.histogram(0, 0));
+        QCOMPARE(pages.histogram(0, std::numeric_limits<quint64>::max()), &pages.histograms[0].last());
+        QVERIFY(pages.histogram(2, 0));
+        QVERIFY(pages.histogram(2, 0)->counts.isEmpty());
+
+        // the sums must match the ones computed from the events
+        const QVector<Data::TimeRange> ranges = {{0, 50000}, {0, 36000}, {1234, 5678}, {5000, 5010}, {35000, 39000}};
+        for (const auto& range : ranges) {
+            for (int type = 0; type < 3; ++type) {
+                EventModel::CostSum expected;
+                for (const auto& event : events) {
+                    if (event.type == type && range.contains(event.time) && event.time != range.end) {
+                        ++expected.numEvents;
+                        expected.cost += event.cost;
+                    }
+                }
+                const auto sum = pages.sum(type, range);
+                QCOMPARE(sum.numEvents, expected.numEvents);
+                QCOMPARE(sum.cost, expected.cost);
+            }
+        }
+        QCOMPARE(pages.prefixSums.size(), 2);
+        QCOMPARE(pages.prefixSums[0].times.size() + pages.prefixSums[1].times.size(), events.size());
+
+        const QVector<EventModel::EventPages> threadPages = {EventModel::EventPages(events.mid(0, 100), {0, 36000}, 1),
+                                                             pages, EventModel::EventPages()};
+        QCOMPARE(EventModel::topThreads(threadPages, 0, {0, 50000}, 5), (QVector<int>{1, 0}));
+        QCOMPARE(EventModel::topThreads(threadPages, 1, {0, 50000}, 1), QVector<int>{1});
+        QVERIFY(EventModel::topThreads(threadPages, 2, {0, 50000}, 5).isEmpty());
+    }
+
+    void testCpuTopology()
+    {
+        QCOMPARE(CpuTopology::parseCpuList("0-3,8\n"), (QVector<int>{0, 1, 2, 3, 8}));
+        QCOMPARE(CpuTopology::parseCpuList("5"), QVector<int>{5});
+        QCOMPARE(CpuTopology::parseCpuList("3-1,x,4-"), QVector<int>{});
+        // corrupt ranges must not be expanded
+        QCOMPARE(CpuTopology::parseCpuList("0-1,2-2000000000"), (QVector<int>{0, 1}));
+        QCOMPARE(CpuTopology::parseCpuList("0-3,4", 4), (QVector<int>{0, 1, 2, 3}));
+
+        // every node must have a usable CPU, and the workers must be spread over all of them in contiguous groups
+        const auto& nodes = CpuTopology::numaNodes();
+        QVERIFY(!nodes.isEmpty());
+        for (int numWorkers = 1; numWorkers < 4 * nodes.size() + 2; ++numWorkers) {
+            QVector<int> workersPerNode(nodes.size());
+            int lastNode = 0;
+            for (int worker = 0; worker < numWorkers; ++worker) {
+                const auto node = CpuTopology::workerNode(worker, numWorkers);
+                QVERIFY(node >= lastNode);
+                QVERIFY(node < nodes.size());
+                ++workersPerNode[node];
+                lastNode = node;
+            }
+            for (auto workers : workersPerNode) {
+                QVERIFY(workers > 0 || numWorkers < nodes.size());
+            }
+        }
+
+        const auto affinity = CpuTopology::threadAffinity();
+        {
+            const CpuTopology::ScopedAffinity scoped;
+            CpuTopology::setThreadAffinity({affinity.value(0)});
+            QCOMPARE(CpuTopology::threadAffinity().size(), affinity.isEmpty() ? 0 : 1);
         }
+        QCOMPARE(CpuTopology::threadAffinity(), affinity);
     }
 
     void testPrettySymbol_data()
@@ -85,13 +85,13 @@ inline QStringList printMap(const Data::CallerCalleeResults& results)
         ids.insert(it->id);
         list.push_back(it.key().symbol + '=' + printCost(it.value(), results));
         QStringList subList;
-        for (auto callersIt = it->callers.begin(), callersEnd = it->callers.end(); callersIt != callersEnd;
-             ++callersIt) {
+        const auto callers = results.callers(it->id);
+        for (auto callersIt = callers.begin(), callersEnd = callers.end(); callersIt != callersEnd; ++callersIt) {
             subList.push_back(it.key().symbol + '<' + callersIt.key().symbol + '='
                               + QString::number(callersIt.value()[0]));
         }
-        for (auto calleesIt = it->callees.begin(), calleesEnd = it->callees.end(); calleesIt != calleesEnd;
-             ++calleesIt) {
+        const auto callees = results.callees(it->id);
+        for (auto calleesIt = callees.begin(), calleesEnd = callees.end(); calleesIt != calleesEnd; ++calleesIt) {
             subList.push_back(it.key().symbol + '>' + calleesIt.key().symbol + '='
                               + QString::number(calleesIt.value()[0]));
         }